@@ -8,6 +8,7 @@
 #include <mutex>
 #include <string>
 
+#include "cloud/http_bridge.hpp"
 #include "cloud/models.hpp"
 
 class Host;
@@ -30,6 +31,7 @@ private:
     Game game;
     bool skipAttr = false;
     bool settled = false;
+    CancelToken launchCancel;
 
     std::string stageText;
     int stageIndex = 0;
@@ -1,9 +1,49 @@
 #ifndef AKIRA_CLOUD_HTTP_BRIDGE_HPP
 #define AKIRA_CLOUD_HTTP_BRIDGE_HPP
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "core/request_limiter.hpp"
+
 namespace cloud {
 
-void registerHttpBridge();
+// Shared by whoever starts a cloud operation and every transport call made on its behalf.
+// Setting it aborts the request in flight and fails the remaining ones straight away.
+using CancelToken = std::shared_ptr<std::atomic<bool>>;
+
+CancelToken makeCancelToken();
+
+// Binds a cancel token and an overall deadline to the calling thread while one of chiaki's
+// synchronous cloud operations runs on it. Transport calls made under the scope run inline
+// on that thread, stop when the token is set, and have their timeout clipped to whatever is
+// left of the deadline. Scopes nest; the innermost one applies.
+class CallScope {
+public:
+    explicit CallScope(CancelToken token, long deadlineSec = 0);
+    ~CallScope();
+
+    CallScope(const CallScope&) = delete;
+    CallScope& operator=(const CallScope&) = delete;
+
+    // The innermost scope on this thread, or nullptr outside any.
+    static const CallScope* current();
+
+    bool cancelled() const { return token && token->load(std::memory_order_relaxed); }
+    const std::atomic<bool>* flag() const { return token.get(); }
+    // Steady-clock milliseconds, 0 when the scope has no deadline.
+    int64_t deadline() const { return deadlineMs; }
+
+private:
+    CancelToken token;
+    int64_t deadlineMs = 0;
+    CallScope* outer = nullptr;
+};
+
+// Routes chiaki's cloud HTTP through the app's sessions. Every request is charged to the
+// Cloud scope of limiter, which must outlive the bridge.
+void registerHttpBridge(RequestLimiter& limiter);
 
 }
 
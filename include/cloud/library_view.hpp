@@ -7,6 +7,7 @@
 #include <set>
 #include <string>
 
+#include "cloud/search_index.hpp"
 #include "cloud/service.hpp"
 #include "views/vendored/switchfin/recycling_grid.hpp"
 
@@ -18,6 +19,7 @@ public:
     ~LibraryView() override;
 
     void willAppear(bool resetState) override;
+    void willDisappear(bool resetState) override;
 
 private:
     void refresh(bool force);
@@ -39,6 +41,7 @@ private:
     void saveFavorites();
     std::string searchQuery;
     std::vector<Game> allGames;
+    SearchIndex searchIndex;
     brls::Button* searchButton = nullptr;
     brls::Button* filterButton = nullptr;
     brls::Button* serverButton = nullptr;
@@ -64,6 +67,7 @@ private:
 
     std::shared_ptr<bool> alive = std::make_shared<bool>(true);
     int generation = 0;
+    uint64_t shownRevision = 0;
     bool launching = false;
 };
 
@@ -1,6 +1,7 @@
 #ifndef AKIRA_CLOUD_MODELS_HPP
 #define AKIRA_CLOUD_MODELS_HPP
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -26,6 +27,8 @@ struct Game {
     bool launchable() const { return !streamServiceType.empty() && !streamIdentifier.empty(); }
     bool streamableNow() const { return launchable() && (isOwned || category != "purchaseable"); }
     std::string artworkUrl() const;
+
+    bool operator==(const Game&) const = default;
 };
 
 struct Catalog {
@@ -40,8 +43,25 @@ struct Catalog {
 
     bool foreignAccountCatalog() const { return !nativeMode; }
     int launchableCount() const;
+
+    bool operator==(const Catalog&) const = default;
+};
+
+// What turns one catalog's games into the next, keyed by productId. `changed` carries the
+// new version of each entry whose fields differ.
+struct CatalogDiff {
+    std::vector<Game> added;
+    std::vector<Game> changed;
+    std::vector<std::string> removed;
+
+    bool empty() const { return added.empty() && changed.empty() && removed.empty(); }
 };
 
+CatalogDiff diffCatalogs(const std::vector<Game>& before, const std::vector<Game>& after);
+// Changed entries are replaced in place and added ones appended, so applying the diff to
+// `before` reproduces `after` up to order.
+void applyCatalogDiff(std::vector<Game>& games, const CatalogDiff& diff);
+
 enum class WarningKind {
     None,
     SessionExpired,
@@ -70,6 +90,14 @@ std::vector<Game> parseShortcuts(const std::string& json);
 std::string serializeShortcuts(const std::vector<Game>& games);
 
 bool parseCatalog(const std::string& json, Catalog& out);
+
+// The on-disk copy of an already parsed and deduplicated catalog. A snapshot written by a
+// different CATALOG_SNAPSHOT_VERSION is rejected rather than migrated; the next refresh
+// rewrites it.
+constexpr int CATALOG_SNAPSHOT_VERSION = 1;
+
+std::string serializeCatalogSnapshot(const Catalog& catalog, int64_t savedAt);
+bool parseCatalogSnapshot(const std::string& json, Catalog& out, int64_t& outSavedAt);
 WarningKind classifyWarning(const std::string& warning);
 LaunchFailureKind classifyLaunchFailure(const std::string& errorMessage);
 
@@ -0,0 +1,54 @@
+#ifndef AKIRA_CLOUD_SEARCH_INDEX_HPP
+#define AKIRA_CLOUD_SEARCH_INDEX_HPP
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "cloud/models.hpp"
+
+namespace cloud {
+
+// Title search over the cloud library. Titles are folded once when the catalog is assigned
+// (lowercase, accents stripped, apostrophes dropped, other punctuation turned into single
+// spaces) and a query matches any title whose folded form contains the folded query. A
+// trigram index narrows the candidates, a query that extends the previous one only rechecks
+// the previous hits, and every sort order is ranked up front so results never need a
+// string comparison at query time.
+class SearchIndex {
+public:
+    enum class Order : uint8_t {
+        Featured,
+        NameAscending,
+        NameDescending
+    };
+
+    static constexpr size_t ORDER_COUNT = 3;
+
+    void assign(const std::vector<Game>& games);
+    size_t size() const { return folded.size(); }
+
+    // Positions in the assigned vector of every matching game, in `order`.
+    std::vector<uint32_t> search(std::string_view query, Order order);
+
+    static std::string fold(std::string_view text);
+
+private:
+    void candidatesFor(const std::string& query, std::vector<uint32_t>& out) const;
+
+    std::vector<std::string> folded;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> trigrams;
+    std::array<std::vector<uint32_t>, ORDER_COUNT> ordered;
+    std::array<std::vector<uint32_t>, ORDER_COUNT> rank;
+
+    std::string lastQuery;
+    std::vector<uint32_t> lastMatches;
+    bool haveLast = false;
+};
+
+} // namespace cloud
+
+#endif // AKIRA_CLOUD_SEARCH_INDEX_HPP
@@ -5,9 +5,11 @@
 #include <map>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <string>
 #include <vector>
 
+#include "cloud/http_bridge.hpp"
 #include "cloud/models.hpp"
 
 class Host;
@@ -40,6 +42,12 @@ struct Snapshot {
     Status status;
     Catalog catalog;
     bool hasCatalog = false;
+    // Unique per catalog content the service has handed out, 0 for none. `changes` turns
+    // the games of revision `changesFrom` into these, so a view still showing that revision
+    // can patch its list instead of rebuilding it.
+    uint64_t revision = 0;
+    uint64_t changesFrom = 0;
+    CatalogDiff changes;
 };
 
 class Service {
@@ -51,11 +59,17 @@ public:
 
     static Service& instance();
 
-    Snapshot snapshotForActiveProfile() const;
+    // The first call for a profile renders its catalog from the snapshot saved on disk by
+    // the last successful refresh, ahead of any network fetch.
+    Snapshot snapshotForActiveProfile();
 
     void markActiveProfileDirty();
     void refreshActiveProfile(bool force, SnapshotCallback onDone = {});
-    void launchGame(const Game& game, HostCallback onSuccess, ErrorCallback onError,
+    // Abandons the active profile's refresh in flight. Its waiters are handed the snapshot
+    // from before the refresh started.
+    void cancelRefresh();
+    // Setting the returned token abandons the launch; neither callback runs afterwards.
+    CancelToken launchGame(const Game& game, HostCallback onSuccess, ErrorCallback onError,
         ProgressCallback onProgress = {}, bool forceSkipAttrCheck = false);
 
 private:
@@ -64,10 +78,16 @@ private:
         bool refreshing = false;
         int generation = 0;
         std::vector<SnapshotCallback> pending;
+        CancelToken cancel;
+        int64_t revalidatedAt = 0;
         std::string psnowDatacentersJson;
         std::string pscloudDatacentersJson;
     };
 
+    static constexpr long CATALOG_DEADLINE_SEC = 90;
+    // A non-forced refresh within this long of the last good fetch is answered from memory.
+    static constexpr int64_t REVALIDATE_AFTER_SEC = 5 * 60;
+
     Service();
 
     Snapshot defaultSnapshotForActiveProfile() const;
@@ -77,6 +97,13 @@ private:
     std::string cacheDirForProfile(int64_t profileId) const;
     void ensureCacheDirsForProfile(int64_t profileId) const;
 
+    std::string snapshotPathForProfile(int64_t profileId) const;
+    void restorePersisted(int64_t profileId);
+    void persistCatalog(int64_t profileId, const Catalog& catalog) const;
+    // Gives `next` its revision relative to `previous`. Returns true when the catalog differs
+    // from the one `previous` holds and so needs saving.
+    bool stampRevisionLocked(const Snapshot& previous, Snapshot& next);
+
     void storeSnapshot(int64_t profileId, const Snapshot& snapshot);
     void storeLaunchError(int64_t profileId, const std::string& errorMessage);
 
@@ -84,6 +111,8 @@ private:
 
     mutable std::mutex mutex;
     std::map<int64_t, Entry> entries;
+    std::set<int64_t> restoreAttempted;
+    uint64_t lastRevision = 0;
 };
 
 } // namespace cloud
@@ -0,0 +1,110 @@
+#ifndef AKIRA_CONNECT_PREWARM_HPP
+#define AKIRA_CONNECT_PREWARM_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Does the slow, side-effect-free part of a remote connect while the user is still looking
+// at the host. Focusing a host schedules its stages once focus has rested there for
+// settleMs, so scrolling across a row of tiles starts nothing. The stages then run in
+// order on a worker thread, and the result stays warm for ttlMs. Connecting claims it,
+// and a warm result that nobody claims is discarded. There is one slot: warming another
+// host discards the previous result when the new run starts. Every stage is timed, so a
+// connect can report what the prewarm saved.
+class ConnectPrewarm {
+public:
+    struct Stage {
+        std::string name;
+        std::function<bool()> run;  // false skips the stages after it
+    };
+
+    struct Timing {
+        std::string stage;
+        int64_t startMs = 0;     // from the start of the run
+        int64_t durationMs = 0;
+        bool ran = false;        // false when a failure or a claim skipped it
+        bool ok = false;
+    };
+
+    enum class State {
+        Idle,
+        Pending,     // focused, waiting for focus to settle
+        Running,
+        Warm,
+        Discarding,
+    };
+
+    struct Config {
+        int64_t settleMs = 400;
+        int64_t ttlMs = 90000;
+    };
+
+    static ConnectPrewarm& shared();
+
+    ConnectPrewarm();
+    explicit ConnectPrewarm(Config config);
+    // Stops the worker. Nothing still warm is discarded, so owners forget() their keys
+    // while what the discard touches is still alive.
+    ~ConnectPrewarm();
+
+    ConnectPrewarm(const ConnectPrewarm&) = delete;
+    ConnectPrewarm& operator=(const ConnectPrewarm&) = delete;
+
+    // The host under key gained focus. Refocusing a host that is running or warm only
+    // extends its lifetime. discard undoes whatever the stages left behind.
+    void focus(const std::string& key, std::vector<Stage> stages, std::function<void()> discard);
+    // Focus moved on: a run that has not started is dropped, one that has is kept.
+    void blur(const std::string& key);
+
+    // Takes the warm result for key, waiting for a run in progress to finish its current
+    // stage and skipping the rest. Returns the stage timings, or nothing if key was not
+    // warmed; either way the caller then does whatever is still missing itself.
+    std::optional<std::vector<Timing>> claim(const std::string& key);
+
+    // Drops key, waiting for a run in progress and discarding its result on this thread.
+    void forget(const std::string& key);
+
+    State state(const std::string& key) const;
+
+    // "name 12 ms, name failed after 40 ms, name skipped", for the log.
+    static std::string summary(const std::vector<Timing>& timings);
+
+private:
+    struct Job {
+        std::string key;
+        std::vector<Stage> stages;
+        std::function<void()> discard;
+        int64_t startAtMs = 0;
+    };
+
+    Config config;
+    mutable std::mutex mutex;
+    std::condition_variable cond;
+    std::thread worker;
+    bool stopping = false;
+
+    std::optional<Job> pending;
+    State currentState = State::Idle;
+    std::string currentKey;
+    std::string discardingKey;
+    std::function<void()> currentDiscard;
+    std::vector<Timing> timings;
+    int64_t expireAtMs = 0;
+    std::atomic<bool> skipRest{false};
+
+    void ensureStarted();
+    void run();
+    void runStages(std::vector<Stage> stages, std::unique_lock<std::mutex>& lock);
+    void discardLocked(std::unique_lock<std::mutex>& lock);
+    void waitWhileBusy(const std::string& key, std::unique_lock<std::mutex>& lock);
+    static int64_t nowMs();
+};
+
+#endif // AKIRA_CONNECT_PREWARM_HPP
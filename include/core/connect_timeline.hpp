@@ -0,0 +1,170 @@
+#ifndef AKIRA_CONNECT_TIMELINE_HPP
+#define AKIRA_CONNECT_TIMELINE_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/connect_prewarm.hpp"
+
+// The last connection attempts per host, newest last. A host past maxAttempts drops its
+// oldest attempt; past maxHosts, the host connected to least recently goes. Saved as
+// JSON, which is also the export format. Not thread-safe.
+class ConnectHistory {
+public:
+    struct Attempt {
+        std::string path;           // "lan", "vpn", "holepunch" or "cloud"
+        int64_t startedAtMs = 0;    // wall clock
+        int64_t firstFrameMs = -1;  // from the start; -1 when no frame arrived
+        std::string outcome;        // empty on success, otherwise why it was abandoned
+        std::vector<ConnectPrewarm::Timing> stages;  // timed from the start
+    };
+
+    struct Config {
+        size_t maxAttempts = 20;
+        size_t maxHosts = 16;
+    };
+
+    ConnectHistory();
+    explicit ConnectHistory(Config config);
+
+    void add(const std::string& host, Attempt attempt);
+    // Empty for a host with no attempts.
+    std::vector<Attempt> attempts(const std::string& host) const;
+    // Median time to first frame over the host's attempts on path that got one; -1 if none.
+    int64_t medianFirstFrameMs(const std::string& host, const std::string& path) const;
+    size_t hostCount() const { return hosts.size(); }
+
+    std::string toJson() const;
+    // Returns false, leaving the history empty, if json is not a saved history.
+    bool parse(const std::string& json);
+
+private:
+    struct HostAttempts {
+        std::string host;
+        std::vector<Attempt> attempts;
+    };
+
+    Config config;
+    std::vector<HostAttempts> hosts;  // least recently connected first
+};
+
+// Where the seconds go between Connect and the first presented frame. One attempt is
+// open at a time. Stages are spans opened and closed by name from whichever thread does
+// the work, so a stage can start on the connection thread and end on the decoder's. A
+// stage that already ran in this attempt is not opened again, and calls with no attempt
+// open are ignored. An attempt ends with the first frame, or is abandoned with a reason,
+// and is filed in the per-host history, which is saved after every attempt. Filing only
+// hands the attempt to a worker thread: loading and saving the history happen there, off
+// the decoder thread that reports the first frame. Stage times use the steady clock in
+// ms. Thread-safe.
+class ConnectTimeline {
+public:
+    struct Config {
+        std::string historyPath;  // empty keeps the history in memory only
+        ConnectHistory::Config history;
+    };
+
+    // Times one stage for its scope. Leaving the scope without done(), as on a throw,
+    // closes the stage as failed.
+    class Span {
+    public:
+        Span(ConnectTimeline& timeline, std::string stage);
+        ~Span();
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+        void done(bool ok = true);
+
+    private:
+        ConnectTimeline& timeline;
+        std::string stage;
+        bool ended = false;
+    };
+
+    static ConnectTimeline& shared();
+
+    ConnectTimeline();
+    explicit ConnectTimeline(Config config);
+    // Files whatever is still queued before returning.
+    ~ConnectTimeline();
+
+    ConnectTimeline(const ConnectTimeline&) = delete;
+    ConnectTimeline& operator=(const ConnectTimeline&) = delete;
+
+    // Starts an attempt for host, unless one for host is already open: each view along a
+    // connect calls this, and the first one's start counts. An open attempt for another
+    // host is abandoned.
+    void begin(const std::string& host, const std::string& path);
+    void start(const std::string& stage);
+    void finish(const std::string& stage, bool ok = true);
+    // A stage timed elsewhere; startMs is on the steady clock.
+    void record(const std::string& stage, int64_t startMs, int64_t durationMs, bool ok);
+    // The first frame is on screen. Closes whatever is still open and files the attempt.
+    void firstFrame();
+    // The attempt ended without a frame; stages still open close as failed.
+    void abandon(const std::string& reason);
+    bool active() const;
+
+    // The last filed attempt, one stage per line. The host's median on the same path is
+    // added once the worker has filed it.
+    std::string lastSummary() const;
+    // These three wait for queued attempts to be filed.
+    std::string exportJson() const;
+    bool exportTo(const std::string& path) const;
+    ConnectHistory history() const;
+
+    static int64_t nowMs();
+
+private:
+    struct OpenStage {
+        std::string name;
+        size_t index = 0;  // its slot in attempt.stages, taken when it opened
+    };
+
+    struct FileJob {
+        uint64_t serial = 0;
+        std::string host;
+        ConnectHistory::Attempt attempt;
+    };
+
+    Config config;
+    mutable std::mutex mutex;
+    std::string lastSummaryText;
+    uint64_t filedSerial = 0;  // of the attempt lastSummaryText describes
+
+    // The history is only touched under historyMutex, on the worker or by readers.
+    mutable std::mutex historyMutex;
+    mutable bool loaded = false;
+    mutable ConnectHistory filed;
+
+    mutable std::mutex queueMutex;
+    mutable std::condition_variable queueCond;
+    std::deque<FileJob> queue;
+    bool filing = false;
+    bool stopping = false;
+    std::thread worker;
+
+    bool open = false;
+    std::string host;
+    int64_t startMs = 0;
+    ConnectHistory::Attempt attempt;
+    std::vector<OpenStage> running;
+
+    bool ranLocked(const std::string& stage) const;
+    void closeLocked(const std::string& stage, bool ok, int64_t now);
+    void fileLocked();
+    void run();
+    void waitFiled() const;
+    void loadLocked() const;
+    bool saveLocked() const;
+    static std::string summarize(const ConnectHistory::Attempt& filedAttempt, int64_t median);
+};
+
+#endif // AKIRA_CONNECT_TIMELINE_HPP
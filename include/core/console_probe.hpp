@@ -0,0 +1,41 @@
+#ifndef AKIRA_CONSOLE_PROBE_HPP
+#define AKIRA_CONSOLE_PROBE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+enum class ConsoleStatus {
+    Unknown,   // no answer, e.g. while the console restarts its network on the way up
+    Standby,
+    Ready,
+};
+
+// Asks one console how it is, with the same SRCH packet the discovery service broadcasts
+// but sent straight to its address, so an answer comes back as soon as the console has
+// one instead of on the next discovery ping. Owns one UDP socket; not thread-safe.
+class ConsoleProbe {
+public:
+    ConsoleProbe();
+    ~ConsoleProbe();
+
+    ConsoleProbe(const ConsoleProbe&) = delete;
+    ConsoleProbe& operator=(const ConsoleProbe&) = delete;
+
+    // Sends one SRCH and waits up to timeoutMs for that console's answer.
+    ConsoleStatus query(const std::string& addr, uint16_t port, bool ps5, int timeoutMs);
+    bool sendWake(const std::string& addr, uint16_t port, uint64_t credential, bool ps5);
+
+    static uint16_t discoveryPort(bool ps5) { return ps5 ? 9302 : 987; }
+    static std::string searchRequest(bool ps5);
+    static std::string wakeRequest(uint64_t credential, bool ps5);
+    static ConsoleStatus parseReply(const char* data, size_t size);
+
+private:
+    int sock = -1;
+
+    bool ensureSocket();
+    bool sendTo(const std::string& addr, uint16_t port, const std::string& packet, uint32_t* resolved);
+};
+
+#endif // AKIRA_CONSOLE_PROBE_HPP
@@ -16,6 +16,8 @@
 #include <chiaki/thread.h>
 #include <chiaki/remote/holepunch.h>
 
+#include "core/host_registry.hpp"
+#include "core/sweep_scheduler.hpp"
 #include "host.hpp"
 #include "psn/auth.hpp"
 #include "util/http_pool.hpp"
@@ -87,22 +89,30 @@ private:
     ChiakiBoolPredCond sweepStopCond;
     std::atomic<bool> sweepEnabled{false};
     std::mutex sweepMutex;
-    std::vector<uint32_t> sweepTargets;
-    std::vector<uint32_t> liveForeignHosts;
+    akira::discovery::SweepScheduler sweepScheduler;
     std::vector<std::string> sweepSubnetLabels;
     std::string sweepCurrentTarget;
-    size_t sweepChunkIndex = 0;
-    static constexpr uint64_t SWEEP_TICK_MS = 1000;
-    static constexpr int SWEEP_SCAN_EVERY_TICKS = 15;
-    static constexpr int SWEEP_CHUNK = 64;
-    static constexpr int SWEEP_MAX_TARGETS = 1024;
+    // 64 packets every 250 ms is 256 pps, about 25 KB/s with UDP/IP and Ethernet headers on
+    // ~60-byte SRCH probes. It is unicast only, to subnets the user added, and lasts for at
+    // most 256 new addresses: one pass of a /24, two seconds. Past that the scheduler paces
+    // new addresses at 32 a second, so a /16 costs the router at most 32 ARP requests a
+    // second, not 128. Silent addresses back off from 15 s to 8 min, so a quiet /24 settles
+    // near 1 pps, well below the old sweep's fixed 8.5 pps.
+    static constexpr uint64_t SWEEP_TICK_MS = 250;
+    static constexpr size_t SWEEP_PACKETS_PER_TICK = 64;
 
     static void* sweepThreadFunc(void* user);
     void runSweepLoop();
-    void sendSweepChunk();
-    void pingLiveForeignHosts();
-    void pingHostAddrNet(uint32_t addrNet);
-    void noteForeignResponder(uint32_t addrNet);
+    void sendSweepProbes();
+    void pingHostAddrNet(uint32_t addrNet, uint8_t protocols);
+
+    std::mutex registryMutex;
+    akira::discovery::HostRegistry hostRegistry;
+
+    void publishHostEvents(std::vector<akira::discovery::HostEvent> events);
+    Host* findDiscoveredHost(const akira::discovery::HostSighting& data);
+    void updateDiscoveredHost(const akira::discovery::HostSighting& data);
+    bool markHostVanished(const akira::discovery::HostSighting& data);
 
     HostsChangedCallback onHostsChanged;
 
@@ -111,9 +121,11 @@ private:
 public:
     static DiscoveryManager* getInstance();
 
+    // The discovery log lives in LogRing::shared(). readDiscoveryLog() appends the lines
+    // from sequence since onwards and returns the sequence to pass next time; lines that
+    // were already overwritten are skipped.
     static void appendDiscoveryLog(const std::string& line);
-    static std::vector<std::string> getDiscoveryLogSnapshot();
-    static uint64_t getDiscoveryLogVersion();
+    static uint64_t readDiscoveryLog(uint64_t since, std::vector<std::string>& out);
     static void clearDiscoveryLog();
 
     ~DiscoveryManager();
@@ -130,7 +142,13 @@ public:
 
     std::string getLocalSubnetCidr();
 
-    void discoveryCallback(ChiakiDiscoveryHost* discoveredHost);
+    // Diffs one discovery scan against the live registry and hands what appeared, changed
+    // or vanished to the UI thread.
+    void applyDiscoveryScan(ChiakiDiscoveryHost* discoveredHosts, size_t count);
+
+    // Drops a host the user deleted from the live registry, so if it is still answering
+    // the next scan reports it as Appeared and recreates it.
+    void forgetHost(const std::string& hostId, const std::string& hostAddr);
 
     void setOnHostDiscovered(HostDiscoveredCallback callback) {
         onHostDiscovered = std::move(callback);
@@ -141,7 +159,6 @@ public:
     }
 
     SweepStatus getSweepStatus();
-    void reconcileDiscoveredHosts(const std::vector<std::string>& liveIds);
 
     void refreshRemoteDevices(RemoteRefreshCallback onComplete = nullptr, bool userInitiated = false);
 
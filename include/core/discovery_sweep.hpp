@@ -10,6 +10,9 @@
 
 namespace akira::discovery {
 
+// Wider subnets than a /16 would take the sweep hours to cover at a LAN-friendly rate.
+inline constexpr int MIN_SWEEP_PREFIX = 16;
+
 inline uint32_t prefixMask(int prefix)
 {
     if (prefix <= 0)
@@ -44,7 +47,7 @@ inline bool parseSweepCidr(const std::string& token, uint32_t& baseHost, int& pr
             return false;
     }
     int p = std::atoi(prefixPart.c_str());
-    if (p < 24 || p > 32)
+    if (p < MIN_SWEEP_PREFIX || p > 32)
         return false;
 
     struct in_addr ina = {};
@@ -1,8 +1,10 @@
 #ifndef AKIRA_HOST_HPP
 #define AKIRA_HOST_HPP
 
+#include <atomic>
 #include <functional>
 #include <map>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <vector>
@@ -18,6 +20,8 @@
 
 #include "settings_manager.hpp"
 #include "registration.hpp"
+#include "connect_prewarm.hpp"
+#include "wake_pipeline.hpp"
 
 // Forward declarations
 class SettingsManager;
@@ -85,7 +89,14 @@ private:
     bool inConfig = false;
     HostType hostType = HostType::Discovered;
 
+    // Owned by the prewarm worker until a connect sets holepunchClaimed, then by that
+    // connect until cleanupHolepunch(). prewarmMutex makes setting the flag and starting a
+    // prewarm exclusive, so the two never touch these at the same time.
     ChiakiHolepunchSession holepunchSession = nullptr;
+    bool upnpReady = false;  // the gateway was found for holepunchSession; cleared with it
+    std::mutex prewarmMutex;
+    std::atomic<bool> holepunchClaimed{false};
+    std::vector<ConnectPrewarm::Timing> connectTimings;
 
     // Session components
     ChiakiSession session;
@@ -158,6 +169,8 @@ public:
     bool isPS5() const;
     bool isCloud() const { return cloudSession.has_value(); }
     bool isRemote() const { return hostType == HostType::Remote; }
+    // How a connect reaches the console: "cloud", "holepunch", "vpn" or "lan".
+    std::string connectPath() const;
     bool isManual() const { return hostType == HostType::Manual; }
     bool isAuto() const { return hostType == HostType::Auto; }
     HostType getHostType() const { return hostType; }
@@ -213,8 +226,16 @@ public:
     void cleanupHolepunch();
     ChiakiHolepunchSession getHolepunchSession() const { return holepunchSession; }
 
+    // Warms up a remote connect while the host's tile has focus; see ConnectPrewarm.
+    void prewarmConnect();
+    void cancelPrewarm();
+    // Stages of the last holepunch, timed from its start.
+    const std::vector<ConnectPrewarm::Timing>& getConnectTimings() const { return connectTimings; }
+
     // Wakeup and registration
     int wakeup();
+    // What a WakePipeline needs to bring this host up from rest mode; polls go through probe.
+    WakePipeline::Ops wakePipelineOps(ConsoleProbe& probe);
     int registerHost(int pin);
     int registerHostAuto();
     bool canAutoRegister() const;
@@ -225,6 +246,15 @@ public:
     void upsertRegistration(const Registration& reg);
     int64_t getConsoleId() const { return consoleId; }
 
+private:
+    std::string prewarmKey() const;
+    void applyPortGuessing();
+    ChiakiErrorCode discoverUpnp();
+    // Tears down the holepunch session, leaving a connect's claim in place.
+    void releaseHolepunch();
+    ChiakiErrorCode punchHoleWithRetries(const uint8_t* duidBytes, int64_t startMs);
+
+public:
     // Event callbacks from chiaki
     void connectionEventCallback(ChiakiEvent* event);
     void registCallback(ChiakiRegistEvent* event);
@@ -0,0 +1,90 @@
+#ifndef AKIRA_HOST_REGISTRY_HPP
+#define AKIRA_HOST_REGISTRY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace akira::discovery {
+
+// One console as a discovery reply describes it.
+struct HostSighting {
+    std::string hostId;
+    std::string hostName;
+    std::string hostAddr;
+    std::string systemVersion;
+    std::string protocolVersion;
+    int state = 0;
+    int target = 0;
+
+    bool operator==(const HostSighting&) const = default;
+};
+
+enum class HostChange {
+    Appeared,
+    Changed,
+    Vanished,
+};
+
+struct HostEvent {
+    HostChange change;
+    HostSighting host;
+    uint64_t generation;
+};
+
+// The consoles answering on the LAN, keyed by host ID (by address for the rare reply that
+// carries none), with indexes by address and by the PSN remote-play device id a saved
+// host is linked to. Each scan is diffed against the last one, so a tick where nothing
+// changed costs one hash lookup and compare per responder and yields no events. Every
+// change bumps a generation counter. Not thread-safe; the owner serialises access.
+class HostRegistry {
+public:
+    // Applies one scan, the full set of consoles answering right now, and returns what
+    // appeared, changed or vanished since the last one, in that order.
+    std::vector<HostEvent> applyScan(const std::vector<HostSighting>& scan);
+
+    // Pointers stay valid until the next applyScan() or clear().
+    const HostSighting* find(const std::string& hostId) const;
+    const HostSighting* findByAddr(const std::string& hostAddr) const;
+    const HostSighting* findByRemoteDuid(const std::string& duid) const;
+
+    // Links a live console to the remote-play device id of the saved host it resolved to.
+    // The link lasts until the console vanishes.
+    void setRemoteDuid(const std::string& hostId, const std::string& duid);
+
+    // Drops a live console by host ID, or by address for one that carries none, so the
+    // next scan that still sees it reports it as Appeared. False if it was not live.
+    bool forget(const std::string& hostId, const std::string& hostAddr = {});
+
+    uint64_t generation() const { return generationCounter; }
+    // The generation of the host's last change, or 0 if it is not live.
+    uint64_t generationOf(const std::string& hostId) const;
+
+    size_t size() const { return hosts.size(); }
+    void clear();
+
+private:
+    struct Entry {
+        HostSighting host;
+        std::string remoteDuid;
+        uint64_t generation = 0;
+        uint64_t lastScan = 0;
+    };
+
+    std::unordered_map<std::string, Entry> hosts;
+    std::unordered_map<std::string, std::string> byAddr;
+    std::unordered_map<std::string, std::string> byRemoteDuid;
+    uint64_t generationCounter = 0;
+    uint64_t scanCounter = 0;
+
+    static const std::string& keyOf(const HostSighting& host);
+    const HostSighting* lookup(const std::unordered_map<std::string, std::string>& index,
+        const std::string& value) const;
+    void unindex(const std::string& key, const Entry& entry);
+};
+
+} // namespace akira::discovery
+
+#endif // AKIRA_HOST_REGISTRY_HPP
@@ -0,0 +1,98 @@
+#ifndef AKIRA_ICON_STORE_HPP
+#define AKIRA_ICON_STORE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Disk cache for downloaded images, kept as one append-only pack file plus an index
+// instead of a file per image. Live bytes are held under a cap by evicting the least
+// recently used entries; the space they leave behind is reclaimed by compact(). The index
+// is only a shortcut: records appended after it was last written, or a missing or damaged
+// index, are recovered by scanning the pack, and a torn final record is cut off. Erased
+// records are marked dead in the pack, so a scan never brings them back.
+class IconStore {
+public:
+    struct Stats {
+        size_t entries = 0;
+        size_t liveBytes = 0;
+        size_t packBytes = 0;
+    };
+
+    IconStore(std::string directory, size_t capacityBytes);
+    ~IconStore();
+
+    IconStore(const IconStore&) = delete;
+    IconStore& operator=(const IconStore&) = delete;
+
+    bool open();
+    void close();
+
+    void setCapacity(size_t capacityBytes);
+
+    bool get(const std::string& key, std::vector<uint8_t>& outBytes);
+    bool put(const std::string& key, const std::vector<uint8_t>& bytes);
+    void erase(const std::string& key);
+
+    bool needsCompaction() const;
+    // Copies the live records into a fresh pack. The copy runs outside the lock, so get()
+    // and put() carry on meanwhile; only the swap is locked. Records put during the copy are
+    // carried over then, and copied ones erased or evicted meanwhile are marked dead. A
+    // second call while one runs returns false.
+    bool compact();
+    bool flush();
+
+    Stats stats() const;
+
+private:
+    static constexpr uint32_t RECORD_MAGIC = 0x43494B41; // "AKIC"
+    static constexpr uint32_t DEAD_MAGIC = 0x44494B41;   // "AKID"
+    static constexpr uint32_t INDEX_MAGIC = 0x58494B41;  // "AKIX"
+    static constexpr uint32_t INDEX_VERSION = 1;
+    static constexpr size_t RECORD_HEADER = 16;
+    static constexpr int INDEX_FLUSH_EVERY = 16;
+    static constexpr size_t COMPACT_MIN_DEAD_BYTES = 1024 * 1024;
+
+    struct Entry {
+        uint64_t offset = 0;
+        uint32_t dataLength = 0;
+        std::list<std::string>::iterator recency;
+
+        size_t recordBytes(const std::string& key) const { return RECORD_HEADER + key.size() + dataLength; }
+    };
+
+    std::string packPath() const;
+    std::string indexPath() const;
+    std::string compactPath() const;
+
+    bool loadIndexLocked(uint64_t& outCovered);
+    bool writeIndexLocked();
+    void scanLocked(uint64_t from);
+    void insertLocked(const std::string& key, uint64_t offset, uint32_t dataLength);
+    void dropLocked(const std::string& key);
+    void evictLocked(const std::string& keep);
+    bool markDeadLocked(FILE* file, uint64_t at);
+    bool appendLocked(FILE* file, uint64_t at, const std::string& key, const uint8_t* data, uint32_t length);
+    bool readDataLocked(const std::string& key, const Entry& entry, std::vector<uint8_t>& outBytes);
+
+    std::string directory;
+    size_t capacity;
+
+    mutable std::mutex mutex;
+    FILE* pack = nullptr;
+    uint64_t packBytes = 0;
+    size_t liveBytes = 0;
+    int unflushedPuts = 0;
+    bool indexDirty = false;
+    bool compacting = false;
+
+    std::unordered_map<std::string, Entry> entries;
+    std::list<std::string> recency;
+};
+
+#endif // AKIRA_ICON_STORE_HPP
@@ -0,0 +1,110 @@
+#ifndef AKIRA_LIMITER_JOURNAL_HPP
+#define AKIRA_LIMITER_JOURNAL_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Append-only record of rate limiter events. Acquires are buffered and written behind in
+// one batch; throttles are written at once. Durability is bought in blocks instead: before
+// the first acquire of each block a reservation for the whole block is synced, so after a
+// crash any acquires the journal never saw are charged in full. Recovery can over-count by
+// less than one block but never under-counts. Every record belongs to a lane, one per
+// budget scope, and each lane keeps its own reservation.
+class LimiterJournal {
+public:
+    static constexpr size_t MAX_LANES = 4;
+
+    struct Lane {
+        std::vector<int64_t> stamps;
+        int64_t breakerUntil = 0;
+        int throttleCount = 0;
+        int64_t lastThrottleAt = 0;
+    };
+
+    struct State {
+        std::array<Lane, MAX_LANES> lanes;
+        int64_t lastSeen = 0;
+    };
+
+    enum class Replay {
+        Missing,
+        Clean,
+        Recovered,
+        Corrupt
+    };
+
+    static constexpr int RESERVE_BLOCK = 16;
+    static constexpr size_t COMPACT_BYTES = 64 * 1024;
+
+    explicit LimiterJournal(std::string path);
+    ~LimiterJournal();
+
+    LimiterJournal(const LimiterJournal&) = delete;
+    LimiterJournal& operator=(const LimiterJournal&) = delete;
+
+    // Closes the current file and points the journal at another one.
+    void retarget(std::string newPath);
+
+    // Rebuilds state from the file. Acquires covered by a reservation but never written
+    // are charged at `now`. A damaged record stops the replay and reports Corrupt.
+    Replay replay(int64_t now, State& out);
+
+    void recordAcquire(size_t lane, int64_t at);
+    void recordThrottle(size_t lane, int64_t at, int64_t breakerUntil);
+
+    bool hasPending() const { return !pending.empty(); }
+    bool flush();
+
+    // Rewrites the journal as a checkpoint plus the live stamps of each lane. Any replay that was not
+    // Clean must be followed by one, so a torn tail is cut off and charged acquires are not
+    // charged again on the next start.
+    bool compact(const State& state);
+    bool needsCompaction() const { return fileBytes + pending.size() * RECORD_BYTES >= COMPACT_BYTES; }
+
+    // Hands back the unused part of the current reservation and closes the file.
+    void close();
+
+    size_t syncedWrites() const { return syncs; }
+
+private:
+    enum class Type : uint16_t {
+        Acquire = 1,
+        Reserve = 2,
+        Throttle = 3,
+        Checkpoint = 4,
+        Release = 5
+    };
+
+    struct Record {
+        Type type;
+        uint8_t lane;
+        int32_t count;
+        int64_t at;
+        int64_t value;
+    };
+
+    static constexpr uint32_t MAGIC = 0x4A524B41; // "AKRJ"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t HEADER_BYTES = 8;
+    static constexpr size_t RECORD_BYTES = 24;
+    static constexpr int32_t MAX_CHARGE = 4096;
+
+    static void encode(const Record& record, std::string& out);
+    static bool decode(const char* at, Record& out);
+
+    bool openForAppend();
+    bool writeLocked(const std::string& bytes);
+
+    std::string path;
+    FILE* file = nullptr;
+    size_t fileBytes = 0;
+    std::vector<Record> pending;
+    std::array<int, MAX_LANES> reserved{};
+    size_t syncs = 0;
+};
+
+#endif // AKIRA_LIMITER_JOURNAL_HPP
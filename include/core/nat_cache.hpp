@@ -0,0 +1,85 @@
+#ifndef AKIRA_NAT_CACHE_HPP
+#define AKIRA_NAT_CACHE_HPP
+
+#include "core/nat_probe.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// The RFC 5780 STUN servers to probe, kept between runs. The list is refetched once it
+// is older than the TTL; measured round trips survive a refetch for servers still listed.
+// ranked() puts answering servers first, fastest first (an EWMA of their RTTs), then the
+// unmeasured ones in list order, then those that stopped answering. Times are wall-clock
+// ms, since the list is saved to disk. Not thread-safe.
+class StunServerList {
+public:
+    struct Config {
+        int64_t ttlMs = 24LL * 60 * 60 * 1000;
+        size_t maxServers = 64;
+    };
+
+    struct Entry {
+        std::string server;  // "host:port"
+        int rttMs = -1;      // -1 until one answers
+        int failures = 0;    // consecutive runs without an answer
+    };
+
+    StunServerList();
+    explicit StunServerList(Config config);
+
+    bool stale(int64_t nowMs) const;
+    void replace(const std::vector<std::string>& servers, int64_t nowMs);
+    void recordRtt(const std::string& server, int rttMs);
+    void recordFailure(const std::string& server);
+
+    std::vector<std::string> ranked(size_t limit) const;
+    const std::vector<Entry>& entries() const { return servers; }
+
+    std::string serialize() const;
+    // Returns false, leaving the list empty and stale, if text is not a saved list.
+    bool parse(const std::string& text);
+
+    // The published list: one "host:port" per line, '#' comments.
+    static std::vector<std::string> parseServerList(const std::string& body);
+
+private:
+    Config config;
+    std::vector<Entry> servers;
+    int64_t fetchedAtMs = 0;
+    bool fetched = false;
+};
+
+// The last NAT classification per network, keyed by whatever identifies the network
+// (SSID and gateway on the Switch), so a holepunch on a known network can act on it
+// without probing again. Entries expire after the TTL; the oldest goes when full.
+// Not thread-safe.
+class NatResultCache {
+public:
+    struct Config {
+        int64_t ttlMs = 30LL * 60 * 1000;
+        size_t maxNetworks = 8;
+    };
+
+    NatResultCache();
+    explicit NatResultCache(Config config);
+
+    void store(const std::string& network, const StunResult& result, int64_t nowMs);
+    std::optional<StunResult> find(const std::string& network, int64_t nowMs) const;
+    void forget(const std::string& network);
+    size_t size() const { return results.size(); }
+
+private:
+    struct Entry {
+        StunResult result;
+        int64_t storedAtMs = 0;
+    };
+
+    Config config;
+    std::unordered_map<std::string, Entry> results;
+};
+
+#endif // AKIRA_NAT_CACHE_HPP
@@ -0,0 +1,119 @@
+#ifndef AKIRA_NAT_PROBE_HPP
+#define AKIRA_NAT_PROBE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class NATType {
+    Unknown,
+    OpenInternet,
+    FullCone,
+    RestrictedCone,
+    PortRestrictedCone,
+    Symmetric,
+    SymmetricPortOnly,
+    UDPBlocked
+};
+
+enum class FilteringType {
+    Unknown,
+    EndpointIndependent,
+    AddressDependent,
+    AddressPortDependent
+};
+
+enum class MappingType {
+    Unknown,
+    EndpointIndependent,
+    AddressDependent,
+    AddressPortDependent
+};
+
+struct StunResult {
+    NATType type = NATType::Unknown;
+    FilteringType filtering = FilteringType::Unknown;
+    MappingType mapping = MappingType::Unknown;
+    std::string externalIP;
+    uint16_t externalPort = 0;
+    std::string error;
+};
+
+// An IPv4 address and port, both in host byte order.
+struct StunEndpoint {
+    uint32_t addr = 0;
+    uint16_t port = 0;
+
+    bool operator==(const StunEndpoint&) const = default;
+    std::string ip() const;
+    std::string toString() const;
+};
+
+struct StunTarget {
+    std::string server;  // "host:port" as listed, for RTT bookkeeping
+    StunEndpoint endpoint;
+};
+
+// NAT behaviour discovery (RFC 5780) over plain UDP sockets. Binding requests go to every
+// target at once; the first server to answer with an OTHER-ADDRESS becomes the one the
+// mapping and filtering tests run against, and those tests also run concurrently, each
+// with its own retransmit timer. The run ends as soon as both behaviours are known: an
+// answer to the change-IP-and-port filtering test settles filtering without waiting on
+// the change-port one, and a mapping that survives a new server address needs no third
+// test. Filtering is probed from a second socket, so the mapping tests cannot open the
+// filter it measures. Without an RFC 5780 server, mapping falls back to comparing two
+// plain servers on different addresses. Blocking; call from a worker thread.
+class NatProbe {
+public:
+    struct Config {
+        int attemptTimeoutMs = 500;
+        int attempts = 3;
+        int deadlineMs = 5000;
+        size_t maxTargets = 8;
+    };
+
+    struct Rtt {
+        std::string server;
+        int rttMs = -1;  // -1 if every attempt timed out
+    };
+
+    struct Report {
+        StunResult result;
+        std::string behaviorServer;  // the RFC 5780 server the tests ran against
+        std::vector<Rtt> rtts;       // targets that answered or gave up before the run ended
+        int elapsedMs = 0;
+    };
+
+    NatProbe();
+    explicit NatProbe(Config config);
+
+    // targets in order of preference; only the first maxTargets are probed.
+    Report run(const std::vector<StunTarget>& targets);
+
+    // STUN wire format (RFC 5389 / 5780).
+    static constexpr uint8_t CHANGE_IP = 0x04;
+    static constexpr uint8_t CHANGE_PORT = 0x02;
+    static constexpr size_t TRANSACTION_ID_BYTES = 12;
+
+    struct Binding {
+        bool valid = false;
+        StunEndpoint mapped;
+        bool hasOther = false;
+        StunEndpoint other;
+    };
+
+    static std::vector<uint8_t> bindingRequest(const uint8_t* transactionId, uint8_t changeFlags);
+    static std::vector<uint8_t> bindingResponse(const uint8_t* transactionId,
+        const StunEndpoint& mapped, const StunEndpoint* other);
+    // transactionId, when given, must match the response's.
+    static Binding parseBindingResponse(const uint8_t* buffer, size_t length,
+        const uint8_t* transactionId = nullptr);
+
+private:
+    Config config;
+};
+
+NATType classifyNat(MappingType mapping, FilteringType filtering);
+
+#endif // AKIRA_NAT_PROBE_HPP
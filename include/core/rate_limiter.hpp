@@ -1,61 +1,103 @@
 #ifndef AKIRA_RATE_LIMITER_HPP
 #define AKIRA_RATE_LIMITER_HPP
 
+#include <algorithm>
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <deque>
 #include <mutex>
 #include <string>
 
-class PersistedRateLimiter {
+#include "core/limiter_journal.hpp"
+#include "core/request_budget.hpp"
+#include "core/request_limiter.hpp"
+
+// Long-term PSN request budgets, one per BudgetScope, persisted through a journal so they
+// survive restarts. Thread-safe.
+class PersistedRateLimiter : public RequestLimiter {
 public:
-    struct Status {
-        int used = 0;
-        int limit = 0;
-        int64_t bucketResetsAt = 0;
-        int64_t breakerUntil = 0;
-        int throttleCount = 0;
-
-        bool breakerOpen(int64_t now) const { return breakerUntil > now; }
-        int remaining() const { return used >= limit ? 0 : limit - used; }
-    };
+    using Scope = BudgetScope;
+    using Status = RequestBudget::Status;
 
     static constexpr int DEFAULT_WINDOW_SECONDS = 900;
+    static constexpr int DEFAULT_TROPHY_BUDGET = 300;
+    static constexpr int DEFAULT_PRESENCE_BUDGET = 40;
+    static constexpr int DEFAULT_CLOUD_BUDGET = 240;
+    static constexpr int FLUSH_INTERVAL_SECONDS = 10;
 
-    PersistedRateLimiter(std::string path, int budget, int windowSeconds = DEFAULT_WINDOW_SECONDS);
+    explicit PersistedRateLimiter(std::string path);
+    ~PersistedRateLimiter();
 
-    void reconfigure(int budget, int windowSeconds);
+    void reconfigure(Scope scope, int budget, int windowSeconds);
 
     void retarget(std::string newPath);
 
-    bool tryAcquire(std::string& outReason);
+    bool tryAcquire(Scope scope, std::string& outReason) override;
 
-    void recordThrottle(int cooldownSeconds);
+    void recordThrottle(Scope scope, int cooldownSeconds) override;
 
-    Status status() const;
+    Status status(Scope scope) const;
 
-private:
-    static constexpr int BREAKER_MAX_SECONDS = 3600;
-    static constexpr int64_t TIGHTEN_WINDOW_SECONDS = 24 * 60 * 60;
-    static constexpr size_t MAX_STAMPS = 8192;
+    // Acquires are journaled write-behind; flush() pushes out whatever is buffered and
+    // close() also hands back the unused reservation so a clean exit charges nothing extra.
+    void flush();
+    void close();
 
+private:
     void loadLocked();
-    void persistLocked();
-    void pruneLocked(int64_t now);
-    int budgetLocked() const;
+    bool importLegacyLocked(LimiterJournal::State& out, bool& outReadable);
+    void compactLocked();
+    void flushIfDueLocked(int64_t now);
+    void spendAllLocked(int64_t now);
+    RequestBudget& budgetFor(Scope scope) { return budgets[static_cast<size_t>(scope)]; }
+    std::string legacyPath() const;
 
     std::string path;
-    int budget;
-    int windowSeconds;
+    LimiterJournal journal;
+    int64_t lastFlushAt = 0;
 
     mutable std::mutex mutex;
     bool loaded = false;
 
-    std::deque<int64_t> stamps;
-    int64_t breakerUntil = 0;
+    std::array<RequestBudget, BUDGET_SCOPE_COUNT> budgets{
+        RequestBudget{DEFAULT_TROPHY_BUDGET, DEFAULT_WINDOW_SECONDS},
+        RequestBudget{DEFAULT_PRESENCE_BUDGET, DEFAULT_WINDOW_SECONDS},
+        RequestBudget{DEFAULT_CLOUD_BUDGET, DEFAULT_WINDOW_SECONDS},
+    };
     int64_t lastSeen = 0;
-    int throttleCount = 0;
-    int64_t lastThrottleAt = 0;
+};
+
+// Short-term request pacing: at most `limit` grants in any `windowMs` span. Rather than
+// sleeping, acquire() says how long until a slot opens so the caller can park the request
+// and free its thread. Not thread-safe.
+class BurstWindow {
+public:
+    BurstWindow(int limit, int64_t windowMs)
+        : limit(std::max(1, limit))
+        , windowMs(std::max<int64_t>(1, windowMs))
+    {
+    }
+
+    // Claims a slot and returns 0, or returns the milliseconds until one frees up.
+    int64_t acquire(int64_t nowMs)
+    {
+        while (!grants.empty() && grants.front() <= nowMs - windowMs)
+            grants.pop_front();
+
+        if (static_cast<int>(grants.size()) < limit)
+        {
+            grants.push_back(nowMs);
+            return 0;
+        }
+
+        return grants.front() + windowMs - nowMs;
+    }
+
+private:
+    int limit;
+    int64_t windowMs;
+    std::deque<int64_t> grants;
 };
 
 #endif // AKIRA_RATE_LIMITER_HPP
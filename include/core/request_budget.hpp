@@ -0,0 +1,130 @@
+#ifndef AKIRA_REQUEST_BUDGET_HPP
+#define AKIRA_REQUEST_BUDGET_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Which PSN service a request is charged to. Each scope has its own budget, breaker and
+// throttle history, so a 429 from one API does not hold back the others.
+enum class BudgetScope : uint8_t {
+    Trophy = 0,
+    Presence = 1,
+    Cloud = 2
+};
+
+inline constexpr size_t BUDGET_SCOPE_COUNT = 3;
+
+const char* budgetScopeName(BudgetScope scope);
+
+// Sliding-window request counter in fixed memory. The window is split into BUCKETS equal
+// buckets; a charge lands in the bucket for its second and the running total is kept up
+// to date as buckets fall out of the window, so charging is O(1). A bucket is only dropped
+// once all of it is older than the window, so the count can run up to one bucket width
+// long but never short.
+class SlidingBuckets {
+public:
+    static constexpr size_t BUCKETS = 60;
+
+    explicit SlidingBuckets(int windowSeconds = 900);
+
+    // Changes the window, re-bucketing live charges at the end of their old bucket.
+    void resize(int windowSeconds);
+    void clear();
+
+    // Charges older than the window are ignored; charges behind the newest bucket still
+    // count if their bucket is live.
+    void add(int64_t at, int count = 1);
+
+    int used(int64_t now);
+
+    // When the oldest live charge leaves the window, or `now` when nothing is counted.
+    int64_t nextRelease(int64_t now);
+
+    int64_t bucketSeconds() const { return width; }
+
+    // Calls fn(at, count) for each live bucket, oldest first, where `at` is the last second
+    // the bucket covers. Replaying these through add() never undercounts.
+    template <typename Fn>
+    void forEachLive(Fn&& fn) const
+    {
+        for (int64_t index = head - static_cast<int64_t>(SPAN) + 1; index <= head; index++)
+        {
+            int32_t count = counts[slotOf(index)];
+            if (count > 0)
+                fn(index * width + width - 1, static_cast<int>(count));
+        }
+    }
+
+private:
+    // One bucket beyond the window, so the bucket a charge was made in is still held for
+    // a full window after the charge however late in that bucket it came.
+    static constexpr size_t SPAN = BUCKETS + 1;
+
+    void advance(int64_t now);
+    static size_t slotOf(int64_t index)
+    {
+        return static_cast<size_t>(((index % static_cast<int64_t>(SPAN)) + SPAN) % SPAN);
+    }
+
+    int windowSeconds;
+    int64_t width;
+    int64_t head = 0;
+    int total = 0;
+    std::array<int32_t, SPAN> counts{};
+};
+
+// One scope's budget: a sliding window, a breaker opened by server throttling, and a
+// temporary halving of the limit after a throttle that lapses on its own. Time is passed
+// in so traces can be replayed. Not thread-safe; the owner serialises access.
+class RequestBudget {
+public:
+    struct Status {
+        int used = 0;
+        int limit = 0;
+        int64_t bucketResetsAt = 0;
+        int64_t breakerUntil = 0;
+        int throttleCount = 0;
+
+        bool breakerOpen(int64_t now) const { return breakerUntil > now; }
+        int remaining() const { return used >= limit ? 0 : limit - used; }
+    };
+
+    static constexpr int BREAKER_MAX_SECONDS = 3600;
+    static constexpr int64_t TIGHTEN_SECONDS = 24 * 60 * 60;
+
+    explicit RequestBudget(int budget = 1, int windowSeconds = 900);
+
+    void configure(int budget, int windowSeconds);
+    void reset();
+
+    bool tryAcquire(int64_t now, std::string& outReason);
+
+    // Opens the breaker for the clamped cooldown and returns its deadline.
+    int64_t throttle(int64_t now, int cooldownSeconds);
+
+    // Replay and recovery: charge past requests, or use up what is left of the window.
+    void charge(int64_t at, int count = 1) { window.add(at, count); }
+    void spend(int64_t now);
+    void restore(int64_t breakerUntil, int throttleCount, int64_t lastThrottleAt);
+    void clampBreaker(int64_t now);
+
+    // The configured budget, halved while a recent throttle is still being served out.
+    int limitAt(int64_t now) const;
+    Status status(int64_t now);
+
+    int64_t breakerDeadline() const { return breakerUntil; }
+    int throttles() const { return throttleCount; }
+    int64_t lastThrottle() const { return lastThrottleAt; }
+    const SlidingBuckets& buckets() const { return window; }
+
+private:
+    int budget;
+    SlidingBuckets window;
+    int64_t breakerUntil = 0;
+    int throttleCount = 0;
+    int64_t lastThrottleAt = 0;
+};
+
+#endif // AKIRA_REQUEST_BUDGET_HPP
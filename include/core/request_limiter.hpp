@@ -0,0 +1,24 @@
+#ifndef AKIRA_REQUEST_LIMITER_HPP
+#define AKIRA_REQUEST_LIMITER_HPP
+
+#include <string>
+
+#include "core/request_budget.hpp"
+
+// What a transport outside core charges its PSN requests to. It claims a request from the
+// scope's budget before sending and reports a server throttle after a 429. The app hands
+// its one PersistedRateLimiter to whoever needs it, so callers never reach for the
+// feature that happens to own it.
+class RequestLimiter {
+public:
+    // False with the reason when the scope's budget or breaker refuses the request.
+    virtual bool tryAcquire(BudgetScope scope, std::string& outReason) = 0;
+
+    // Opens the scope's breaker for cooldownSeconds.
+    virtual void recordThrottle(BudgetScope scope, int cooldownSeconds) = 0;
+
+protected:
+    ~RequestLimiter() = default;
+};
+
+#endif // AKIRA_REQUEST_LIMITER_HPP
@@ -1,61 +1,31 @@
 #ifndef AKIRA_STUN_CLIENT_HPP
 #define AKIRA_STUN_CLIENT_HPP
 
+#include "core/nat_probe.hpp"
+
+#include <optional>
 #include <string>
 #include <vector>
-#include <cstdint>
-
-enum class NATType {
-    Unknown,
-    OpenInternet,
-    FullCone,
-    RestrictedCone,
-    PortRestrictedCone,
-    Symmetric,
-    SymmetricPortOnly,
-    UDPBlocked
-};
-
-enum class FilteringType {
-    Unknown,
-    EndpointIndependent,
-    AddressDependent,
-    AddressPortDependent
-};
-
-struct StunResult {
-    NATType type;
-    FilteringType filtering;
-    std::string externalIP;
-    uint16_t externalPort;
-    std::string error;
-};
 
 class StunClient {
 public:
+    // Probes the network the console is on now (NatProbe against the cached RFC 5780
+    // servers plus Google's) and remembers the result for that network.
     static StunResult detectNATType();
+    // The last result for the current network, while it is fresh.
+    static std::optional<StunResult> cachedResult();
+
     static std::string natTypeToString(NATType type);
     static std::string natTypeDescription(NATType type);
     static std::string filteringTypeToString(FilteringType type);
+    static std::string mappingTypeToString(MappingType type);
 
 private:
-    struct MappedAddress {
-        std::string ip;
-        uint16_t port;
-        bool valid;
-    };
-
-    struct OtherAddress {
-        std::string ip;
-        uint16_t port;
-        bool valid;
-    };
-
-    static MappedAddress sendBindingRequest(const char* stunServer, uint16_t stunPort, int localSocket);
-    static bool parseBindingResponse(const uint8_t* buffer, size_t length, MappedAddress& result, OtherAddress* otherAddr = nullptr);
+    static std::string networkIdentity();
+    static std::vector<std::string> rfc5780Servers();
     static std::vector<std::string> fetchRFC5780Servers();
-    static FilteringType detectFiltering();
-    static FilteringType testFilteringWithServer(const std::string& server);
+    static std::vector<StunTarget> resolveTargets(const std::vector<std::string>& servers);
+    static void recordRtts(const NatProbe::Report& report);
 };
 
 #endif
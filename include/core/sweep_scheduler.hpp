@@ -0,0 +1,144 @@
+#ifndef AKIRA_SWEEP_SCHEDULER_HPP
+#define AKIRA_SWEEP_SCHEDULER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace akira::discovery {
+
+enum SweepProtocol : uint8_t {
+    SWEEP_PS4 = 1,
+    SWEEP_PS5 = 2,
+    SWEEP_BOTH = SWEEP_PS4 | SWEEP_PS5,
+};
+
+struct SweepProbe {
+    uint32_t addrNet;
+    uint8_t protocols;
+};
+
+// Decides which foreign-subnet addresses the discovery sweep probes on each tick, within a
+// per-tick packet budget. Addresses that have answered are re-probed first, most recent
+// first, and only on the protocol they answered with. Every other address is swept in
+// passes over a bitmap of what is due; an address that stays silent waits twice as long
+// before each retry. Subnets wider than a /24 are walked one host byte at a time across
+// all their /24 blocks, and blocks that have produced a console are swept before the
+// rest. Each probe of an address with nothing behind it makes the router ARP for it, so
+// addresses that have not answered are paced by a token bucket: a /24's worth at the full
+// tick rate, then sustainedAddressesPerSecond until the sweep goes quiet and the bucket
+// refills. Times are milliseconds on a caller-supplied clock. Not thread-safe; the owner
+// serialises access.
+class SweepScheduler {
+public:
+    struct Config {
+        size_t packetsPerTick = 64;
+        int64_t responderIntervalMs = 1000;
+        // A responder missing this many probes in a row backs off like a silent address,
+        // and is forgotten after forgetAfterMisses.
+        int responderMisses = 3;
+        int forgetAfterMisses = 10;
+        int64_t silentBaseMs = 15000;
+        size_t burstAddresses = 256;
+        size_t sustainedAddressesPerSecond = 32;
+        int64_t silentMaxMs = 8 * 60 * 1000;
+        size_t maxHosts = 65536;
+        size_t maxResponders = 1024;
+    };
+
+    struct Stats {
+        size_t hosts = 0;
+        size_t responders = 0;
+        size_t pending = 0;
+        uint64_t passes = 0;
+    };
+
+    SweepScheduler();
+    explicit SweepScheduler(Config config);
+
+    // Adds every host address of baseHost/prefix (host byte order). Returns false, adding
+    // nothing, when the subnet would take the scheduler past maxHosts.
+    bool addSubnet(uint32_t baseHost, int prefix);
+    void clear();
+
+    bool contains(uint32_t addrNet) const;
+    size_t hostCount() const { return hosts; }
+
+    // The probes to send now, within packetsPerTick.
+    std::vector<SweepProbe> next(int64_t nowMs);
+
+    // A console at addrNet answered; protocols is what it answered on (SWEEP_BOTH when
+    // the reply did not say).
+    void noteResponse(uint32_t addrNet, uint8_t protocols, int64_t nowMs);
+
+    // The protocols addrNet is known to answer on, or 0 if it has not answered.
+    uint8_t protocolsOf(uint32_t addrNet) const;
+
+    Stats stats() const;
+
+private:
+    static constexpr uint32_t NEVER = 0xFFFFFFFFu;
+    static constexpr uint32_t ROWS_PER_BLOCK = 256;
+
+    struct Subnet {
+        uint32_t baseHost;
+        int prefix;
+        uint32_t firstOffset;
+        uint32_t blocks;  // /24 blocks spanned; 1 for a /24 or narrower
+        size_t firstSlot;
+        size_t slots;
+    };
+
+    struct Responder {
+        uint8_t protocols;
+        int misses;
+        int64_t lastSeenMs;
+        int64_t dueMs;
+    };
+
+    struct Block {
+        size_t subnet;
+        uint32_t block;
+    };
+
+    Config config;
+    std::vector<Subnet> subnets;
+    size_t hosts = 0;
+
+    // Per slot: when it is next due (ms since epochMs, NEVER for non-hosts and for
+    // addresses held as responders) and how many probes in a row it has gone unanswered.
+    std::vector<uint32_t> dueAt;
+    std::vector<uint8_t> silence;
+    // Slots still to probe in the current pass.
+    std::vector<uint64_t> pending;
+    std::vector<size_t> hotQueue;
+    size_t hotHead = 0;
+    std::vector<Block> hotBlocks;
+
+    std::unordered_map<uint32_t, Responder> responders;
+
+    bool haveEpoch = false;
+    int64_t epochMs = 0;
+    bool inPass = false;
+    size_t cursor = 0;
+    uint32_t earliestDue = 0;
+    uint64_t passes = 0;
+    double addressTokens = 0;
+    int64_t tokensAtMs = 0;
+    bool haveTokens = false;
+
+    uint32_t relative(int64_t nowMs);
+    int64_t silentDelay(int streak) const;
+    void refillTokens(int64_t nowMs);
+    bool slotOf(uint32_t addrNet, size_t& slot, size_t& subnet) const;
+    uint32_t addrOf(const Subnet& subnet, size_t slot) const;
+    bool takePending(size_t slot);
+    void beginPass(uint32_t now);
+    void probeSlot(size_t slot, uint32_t now, std::vector<SweepProbe>& out);
+    void forget(uint32_t addrNet, uint32_t now);
+};
+
+} // namespace akira::discovery
+
+#endif // AKIRA_SWEEP_SCHEDULER_HPP
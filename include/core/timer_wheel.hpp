@@ -0,0 +1,47 @@
+#ifndef AKIRA_TIMER_WHEEL_HPP
+#define AKIRA_TIMER_WHEEL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Hashed timer wheel over a caller-supplied millisecond clock. Deadlines are rounded up to
+// the tick, so a callback never fires early. Scheduling is O(1); advancing visits one
+// slot per elapsed tick. Deadlines further out than one revolution stay in their slot
+// until their round comes up. Not thread-safe; the owner serialises access.
+class TimerWheel {
+public:
+    using Callback = std::function<void()>;
+
+    static constexpr int64_t NOTHING_DUE = -1;
+
+    explicit TimerWheel(int64_t tickMs = 10, size_t slotCount = 256, int64_t startMs = 0);
+
+    void schedule(int64_t dueMs, Callback callback);
+
+    // Moves every callback due at or before nowMs into outDue, earliest deadline first.
+    size_t advance(int64_t nowMs, std::vector<Callback>& outDue);
+
+    // The earliest pending deadline, rounded to the tick it will fire on.
+    int64_t nextDueMs() const;
+
+    size_t size() const { return pending; }
+    bool empty() const { return pending == 0; }
+    void clear();
+
+private:
+    struct Entry {
+        int64_t dueTick;
+        uint64_t order;
+        Callback callback;
+    };
+
+    int64_t tickMs;
+    std::vector<std::vector<Entry>> slots;
+    int64_t cursor;
+    size_t pending = 0;
+    uint64_t scheduled = 0;
+};
+
+#endif // AKIRA_TIMER_WHEEL_HPP
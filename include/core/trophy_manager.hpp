@@ -4,22 +4,26 @@
 #include <atomic>
 #include <chrono>
 #include <cstdint>
-#include <deque>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <borealis.hpp>
 
+#include "core/icon_store.hpp"
 #include "core/rate_limiter.hpp"
 #include "psn/auth.hpp"
 #include "psn/client.hpp"
+#include "psn/governed_get.hpp"
 #include "psn/models.hpp"
 #include "util/http.hpp"
 #include "util/http_pool.hpp"
+#include "util/lru_cache.hpp"
 
 class SettingsManager;
 
@@ -41,19 +45,33 @@ public:
         Callback<psn::TitleDetail> onSuccess, ErrorCallback onError);
 
     void fetchIcon(const std::string& url, IconCallback onSuccess);
+    void fetchArtwork(const std::string& url, IconCallback onSuccess);
     void discardIcon(const std::string& url);
 
+    // For images that are not on screen yet. A fetch with no callback counts as one too.
+    void prefetchIcon(const std::string& url, IconCallback onArrived = nullptr);
+    void prefetchArtwork(const std::string& url, IconCallback onArrived = nullptr);
+
+    // Withdraws a prefetch that has not reached the network yet. A download already under
+    // way finishes into the cache, and a fetch an on-screen view waits on is left alone.
+    void cancelPrefetch(const std::string& url);
+
     void clearCache();
+    int exportCacheAsJson();
 
     void onActiveProfileChanged();
     void flushCache();
+    void shutdown();
 
     void startAutoRefresh();
 
     void setSummaryObserver(Callback<psn::TrophySummary> observer);
     void setLibraryObserver(Callback<std::vector<psn::TrophyTitle>> observer);
 
-    PersistedRateLimiter::Status budgetStatus() const;
+    PersistedRateLimiter::Status budgetStatus(BudgetScope scope = BudgetScope::Trophy) const;
+    bool claimRequestBudget(BudgetScope scope, std::string& outReason);
+    // The limiter behind every PSN budget, for transports outside the trophy feature.
+    RequestLimiter& requestLimiter() { return limiter; }
     void reconfigureLimiter();
     int64_t librarySavedAtSeconds() const;
 
@@ -73,37 +91,44 @@ public:
 
 private:
     static constexpr long REQUEST_TIMEOUT_S = 15;
-    static constexpr int MAX_ATTEMPTS = 3;
     static constexpr int BURST_LIMIT = 5;
     static constexpr int BURST_WINDOW_MS = 1000;
-    static constexpr int BREAKER_MINUTES = 15;
-    static constexpr int SUSTAINED_BUDGET = 300;
     static constexpr int STALE_CHECK_MINUTES = 5;
     static constexpr int FORCE_REFRESH_COOLDOWN_MINUTES = 360;
     static constexpr int LIBRARY_LOG_CAP = 50;
     static constexpr int ICON_PREFETCH_CAP = 120;
+    static constexpr int DETAIL_PREFETCH_CAP = 8;
+    static constexpr int DETAIL_PREFETCH_RESERVE = 60;
     static constexpr int SUMMARY_TTL_MINUTES = 360;
     static constexpr int PROFILE_TTL_MINUTES = 720;
     static constexpr int DETAIL_TTL_MINUTES = 360;
     static constexpr int LIBRARY_TTL_MINUTES = 360;
     static constexpr long ICON_TIMEOUT_S = 20;
-    static constexpr size_t ICON_CACHE_MAX_BYTES = 12 * 1024 * 1024;
+    // Grids draw from the decoded thumbnail cache (12 MB, ui/thumbnails.cpp), so the encoded
+    // caches only bridge a fetch to its decode and serve the few views that load bytes
+    // directly; misses come back from the SD icon store. Each still fits a largest image in
+    // half of one shard. 4 + 4 + 2 + 12 = 22 MB in all.
+    static constexpr size_t ICON_CACHE_MAX_BYTES = 4 * 1024 * 1024;
+    static constexpr size_t ARTWORK_CACHE_MAX_BYTES = 4 * 1024 * 1024;
+    static constexpr size_t DETAIL_CACHE_MAX_BYTES = 2 * 1024 * 1024;
     static constexpr size_t ICON_MAX_BYTES = 2 * 1024 * 1024;
+    static constexpr size_t ICON_STORE_MAX_BYTES = 64 * 1024 * 1024;
     static constexpr const char* CACHE_DIR = "sdmc:/switch/akira/cache";
     static constexpr const char* TROPHY_CACHE_DIR = "sdmc:/switch/akira/cache/trophies";
     static constexpr const char* ICON_CACHE_DIR = "sdmc:/switch/akira/cache/trophies/icons";
-    static constexpr const char* RATELIMIT_PATH = "sdmc:/switch/akira/cache/ratelimit.json";
+    static constexpr const char* RATELIMIT_PATH = "sdmc:/switch/akira/cache/ratelimit.journal";
 
     TrophyManager();
 
     bool hasConnectivity() const;
-    void awaitBurstSlot();
+    int64_t claimBurstSlot();
 
-    psn::Error governedGet(HttpSession& session, const std::string& url, std::string& outBody);
+    void governedGet(HttpSession& session, const std::string& url, psn::GovernedDone done);
+    psn::Error governedGetBlocking(HttpSession& session, const std::string& url, std::string& outBody);
     psn::Client clientFor(HttpSession& session);
 
     void ensureCacheDirs();
-    void ensureIconCacheDir();
+    void ensureIconStore();
 
     std::string accountKey() const;
     std::string accountCacheDir() const;
@@ -121,41 +146,69 @@ private:
     bool loadDetailFromDisk(const std::string& npCommunicationId, psn::TitleDetail& outDetail,
         int64_t& outSavedAt) const;
     void saveDetailToDisk(const psn::TitleDetail& detail) const;
+    bool detailOnDisk(const std::string& npCommunicationId) const;
+    void removeDetailFromDisk(const std::string& npCommunicationId) const;
     psn::Error fetchDetailBlocking(HttpSession& session, const psn::TrophyTitle& title,
         psn::TitleDetail& outDetail);
+    void storeDetail(const psn::TitleDetail& detail);
+    void syncLibraryDelta(const std::vector<psn::TrophyTitle>& previous,
+        const std::vector<psn::TrophyTitle>& titles);
+    void prefetchDetails(const std::vector<psn::TrophyTitle>& titles);
     void saveSummaryToDisk(const psn::TrophySummary& summary) const;
     static bool cacheEntryFresh(int64_t savedAt, int ttlMinutes);
     void loadTitleMapLocked();
     void saveTitleMapLocked() const;
     void loadForceStateLocked();
     void saveForceStateLocked() const;
-    std::string iconCachePath(const std::string& url) const;
-    bool readIconFromDisk(const std::string& path, std::vector<uint8_t>& outBytes) const;
-    void writeIconToDisk(const std::string& path, const std::vector<uint8_t>& bytes);
+    void compactIconStoreIfNeeded();
     void stopIconDiskWrites(const std::string& reason);
-    void storeIconInMemory(const std::string& url, const std::vector<uint8_t>& bytes);
+    struct ImageBytes {
+        size_t operator()(const std::vector<uint8_t>& bytes) const { return bytes.size(); }
+    };
+    struct DetailBytes {
+        size_t operator()(const psn::TitleDetail& detail) const { return psn::approximateBytes(detail); }
+    };
+    using ImageCache = akira::ShardedLruCache<std::string, std::vector<uint8_t>, ImageBytes>;
+
+    struct ImageWaiters {
+        std::vector<IconCallback> callbacks;
+        bool onScreen = false;
+    };
+
+    void fetchImage(ImageCache& cache, const std::string& url, IconCallback onSuccess, bool prefetch);
+    void storeImageInMemory(ImageCache& cache, const std::string& url, const std::vector<uint8_t>& bytes);
+    void pinAvatar(const std::string& url);
+    void logCacheMetrics() const;
     void prefetchIcons(const std::vector<psn::TrophyTitle>& titles);
     void logLibrary(const std::vector<psn::TrophyTitle>& titles) const;
     void runStaleCheck();
 
     SettingsManager* settings = nullptr;
-    PersistedRateLimiter limiter{RATELIMIT_PATH, SUSTAINED_BUDGET};
+    PersistedRateLimiter limiter{RATELIMIT_PATH};
 
     brls::RepeatingTimer staleTimer;
+    brls::RepeatingTimer limiterFlushTimer;
     bool autoRefreshStarted = false;
     Callback<psn::TrophySummary> summaryObserver;
     Callback<std::vector<psn::TrophyTitle>> libraryObserver;
-    std::atomic<bool> iconCacheDirReady{false};
+    IconStore iconStore{ICON_CACHE_DIR, ICON_STORE_MAX_BYTES};
+    std::mutex iconStoreMutex;
+    std::atomic<bool> iconStoreReady{false};
     std::atomic<bool> iconDiskWritable{true};
+    std::atomic<bool> iconCompacting{false};
+    std::thread iconCompactor;
 
     mutable std::mutex mutex;
 
+    ImageCache iconCache{ICON_CACHE_MAX_BYTES, ICON_MAX_BYTES};
+    ImageCache artworkCache{ARTWORK_CACHE_MAX_BYTES, ICON_MAX_BYTES};
+
     mutable std::mutex iconMutex;
-    std::unordered_map<std::string, std::vector<uint8_t>> iconCache;
-    std::deque<std::string> iconOrder;
-    std::unordered_map<std::string, std::vector<IconCallback>> iconWaiters;
-    size_t iconCacheBytes = 0;
-    std::deque<std::chrono::steady_clock::time_point> burstWindow;
+    std::unordered_map<std::string, ImageWaiters> iconWaiters;
+    std::unordered_set<std::string> withdrawnPrefetches;
+    std::string pinnedAvatarUrl;
+    bool avatarPinned = false;
+    BurstWindow burstWindow{BURST_LIMIT, BURST_WINDOW_MS};
 
     psn::TrophySummary cachedSummary;
     bool hasCachedSummary = false;
@@ -169,7 +222,7 @@ private:
     std::unordered_map<std::string, int64_t> forcedAt;
     bool forceStateLoaded = false;
 
-    std::unordered_map<std::string, psn::TitleDetail> cachedDetails;
+    akira::LruCache<std::string, psn::TitleDetail, DetailBytes> cachedDetails{DETAIL_CACHE_MAX_BYTES};
 
     std::unordered_map<std::string, GameProgress> gameProgress;
     bool titleMapLoaded = false;
@@ -0,0 +1,71 @@
+#ifndef AKIRA_WAKE_PIPELINE_HPP
+#define AKIRA_WAKE_PIPELINE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "core/connect_prewarm.hpp"
+#include "core/console_probe.hpp"
+
+// Wakes a console from rest mode and returns the moment it can take a session. The wake
+// goes out first, then the console is polled. Polls start close together and space out while nothing changes. Any change in the answer
+// brings them close again, and they stay close once the console has gone quiet: it was
+// restarting its network and is about to come up. A console that stays in standby
+// without ever going quiet gets the wake again, in case the first one was lost; a
+// booting console ignores a spare one.
+// run() returns as soon as the console is ready, so the session can start straight away.
+// Runs on the caller's thread; cancel() may come from any other, even before run(), and a
+// cancelled pipeline stays cancelled.
+class WakePipeline {
+public:
+    enum class Outcome {
+        Ready,
+        WakeFailed,
+        TimedOut,
+        Cancelled,
+    };
+
+    struct Ops {
+        std::function<bool()> wake;
+        std::function<ConsoleStatus(int timeoutMs)> poll;
+    };
+
+    struct Config {
+        int64_t firstPollMs = 150;
+        int64_t maxPollMs = 1500;
+        int pollTimeoutMs = 250;    // how long one poll waits for an answer
+        int64_t rewakeMs = 6000;    // resend the wake after this long still in standby
+        int64_t deadlineMs = 60000;
+    };
+
+    struct Result {
+        Outcome outcome = Outcome::Cancelled;
+        // "wake", then "boot" until the console was ready; both timed from the start of
+        // run().
+        std::vector<ConnectPrewarm::Timing> timeline;
+        int wakes = 0;
+        int polls = 0;
+        int64_t elapsedMs = 0;
+    };
+
+    WakePipeline();
+    explicit WakePipeline(Config config);
+
+    Result run(const Ops& ops);
+    void cancel();
+
+private:
+    Config config;
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::atomic<bool> cancelled{false};
+
+    bool sleepFor(int64_t ms);
+    static int64_t nowMs();
+};
+
+#endif // AKIRA_WAKE_PIPELINE_HPP
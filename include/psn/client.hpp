@@ -15,7 +15,18 @@ class Client {
 public:
     using Fetch = std::function<Error(const std::string& url, std::string& outBody)>;
 
+    // Where each API family lives. The defaults are PSN's; at() swaps the origin for all of
+    // them, e.g. to point the client at a local simulator.
+    struct Endpoints {
+        std::string trophy = "https://m.np.playstation.com/api/trophy/v1";
+        std::string gamelist = "https://m.np.playstation.com/api/gamelist/v2/users";
+        std::string userProfile = "https://m.np.playstation.com/api/userProfile/v1/internal/users";
+
+        static Endpoints at(const std::string& origin);
+    };
+
     explicit Client(Fetch fetch);
+    Client(Fetch fetch, Endpoints endpoints);
 
     Error fetchSummary(TrophySummary& out) const;
     Error fetchTitles(std::vector<TrophyTitle>& out) const;
@@ -40,24 +51,35 @@ public:
         std::vector<std::pair<std::string, std::string>>& out) const;
 
 private:
-    using RowSink = std::function<bool(json_object* row)>;
+    using RowSink = std::function<bool(JsonReader& row)>;
 
-    static constexpr const char* API_BASE = "https://m.np.playstation.com/api/trophy/v1";
-    static constexpr const char* GAMELIST_BASE = "https://m.np.playstation.com/api/gamelist/v2/users";
-    static constexpr const char* USER_BASE_URL = "https://m.np.playstation.com/api/userProfile/v1/internal/users";
     static constexpr int PAGE_SIZE = 100;
     static constexpr int PAGE_CAP = 50;
 
-    Error fetchDocument(const char* base, const std::string& path, Json& out) const;
-    Error fetchList(const char* base, const std::string& path, const char* arrayKey, const RowSink& onRow) const;
-    Error fetchPaged(const char* base, const std::string& path, const char* arrayKey, const RowSink& onRow) const;
+    Error fetchDocument(const std::string& base, const std::string& path, std::string& outBody) const;
+    Error fetchList(const std::string& base, const std::string& path, const char* arrayKey,
+        const RowSink& onRow) const;
+    Error fetchPaged(const std::string& base, const std::string& path, const char* arrayKey,
+        const RowSink& onRow) const;
 
     static std::string titlePath(const std::string& prefix, const std::string& npCommunicationId,
         const std::string& suffix, const std::string& npServiceName);
 
     Fetch fetch;
+    Endpoints endpoints;
 };
 
+// Runs every task, possibly at the same time and each with a client of its own, and
+// returns once all of them have finished.
+using FanOut = std::function<void(std::vector<std::function<void(const Client&)>> tasks)>;
+
+// A title's detail view: trophy definitions and progress, plus group definitions and
+// progress when the title has groups. The four requests are independent, so they go out
+// through `fanOut` together; once a required one has failed, any sibling that has not
+// started yet is skipped rather than spent. Group progress is optional, and without it
+// earned counts are tallied from the trophies.
+Error fetchTitleDetail(const TrophyTitle& title, const FanOut& fanOut, TitleDetail& out);
+
 } // namespace psn
 
 #endif // AKIRA_PSN_CLIENT_HPP
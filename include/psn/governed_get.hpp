@@ -0,0 +1,54 @@
+#ifndef AKIRA_PSN_GOVERNED_GET_HPP
+#define AKIRA_PSN_GOVERNED_GET_HPP
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "psn/retry_policy.hpp"
+#include "psn/status.hpp"
+
+namespace psn {
+
+// The connection a governed GET is stepping on. A parked request can resume on another
+// one, so a wire is only good for the step it was handed to.
+class Wire {
+public:
+    // One attempt on the wire; the body is only read when the reply is delivered.
+    virtual Reply get(const std::string& url, const std::string& token, std::string& outBody) = 0;
+
+    // Forces a new access token after a 401.
+    virtual Error refreshToken(std::string& outToken) = 0;
+
+protected:
+    ~Wire() = default;
+};
+
+// What a governed GET answers to besides the wire: the long-term budget, short-term burst
+// pacing, the breaker, and somewhere to wait. The app parks on the HTTP pool's timer
+// wheel; the simulator advances its virtual clock.
+struct Governance {
+    // Charges one request; false with the reason when the budget or breaker says no.
+    std::function<bool(std::string& outReason)> admit;
+
+    // Claims a burst slot and returns 0, or the milliseconds until one frees up.
+    std::function<int64_t()> claimSlot;
+
+    // Opens the breaker after a 429.
+    std::function<void(int cooldownSeconds)> throttle;
+
+    // Runs `resume` no sooner than `delayMs` from now.
+    std::function<void(int64_t delayMs, std::function<void(Wire&)> resume)> park;
+};
+
+using GovernedDone = std::function<void(Error error, std::string body)>;
+
+// One PSN GET under the budget, burst pacing and RetryPolicy. Every attempt claims its own
+// budget stamp and burst slot; waits go through Governance::park rather than blocking.
+// `done` is called exactly once, from whichever step finishes the request.
+void governedGet(Governance governance, Wire& wire, const std::string& url, std::string token,
+    GovernedDone done);
+
+} // namespace psn
+
+#endif // AKIRA_PSN_GOVERNED_GET_HPP
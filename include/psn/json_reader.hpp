@@ -0,0 +1,65 @@
+#ifndef AKIRA_PSN_JSON_READER_HPP
+#define AKIRA_PSN_JSON_READER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace psn {
+
+// Forward-only pull reader over a JSON body. Strings without escapes come back as views
+// into the body; escaped ones are decoded into scratch space that stays valid until the
+// next read. Any malformed input latches failed() and every later call returns false.
+class JsonReader {
+public:
+    enum class Kind {
+        Object,
+        Array,
+        String,
+        Number,
+        Bool,
+        Null,
+        Invalid
+    };
+
+    explicit JsonReader(std::string_view text);
+
+    Kind peek();
+    bool failed() const { return error; }
+    bool finished();
+
+    bool enterObject();
+    bool nextKey(std::string_view& key);
+    bool enterArray();
+    bool nextElement();
+
+    bool readString(std::string_view& out);
+    bool readScalar(std::string_view& out);
+    int64_t readInt64();
+    double readDouble();
+    bool readBool();
+    bool skipNull();
+    bool skip();
+
+private:
+    static constexpr int MAX_DEPTH = 64;
+
+    void skipSpace();
+    bool fail();
+    bool expect(char c);
+    bool scanString(std::string_view& out, std::string& decoded);
+    bool scanNumber(std::string_view& out);
+    bool scanLiteral(std::string_view literal);
+
+    std::string_view text;
+    size_t pos = 0;
+    bool error = false;
+    bool firstEntry = false;
+    std::string scratch;
+    std::string keyScratch;
+};
+
+} // namespace psn
+
+#endif // AKIRA_PSN_JSON_READER_HPP
@@ -1,14 +1,18 @@
 #ifndef AKIRA_PSN_MODELS_HPP
 #define AKIRA_PSN_MODELS_HPP
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 struct json_object;
 
 namespace psn {
 
+class JsonReader;
+
 class Json {
 public:
     Json() = default;
@@ -145,7 +149,7 @@ struct PsnProfile {
     }
 };
 
-int64_t parseIso8601Duration(const std::string& value);
+int64_t parseIso8601Duration(std::string_view value);
 int64_t parseIso8601Timestamp(const std::string& value);
 bool parsePlayedGame(json_object* obj, PlayedGame& out);
 
@@ -170,6 +174,21 @@ void mergeGroups(std::vector<TrophyGroup>& definitions, const std::vector<Trophy
 
 void tallyGroupEarned(std::vector<TrophyGroup>& groups, const std::vector<Trophy>& trophies);
 
+struct LibraryDelta {
+    std::vector<std::string> added;
+    std::vector<std::string> changed;
+    std::vector<std::string> removed;
+    std::vector<std::string> unchanged;
+};
+
+// A title counts as changed when PSN bumps its lastUpdatedDateTime or its earned
+// counts move; a title with no timestamp on either side is always treated as changed.
+LibraryDelta diffLibrary(const std::vector<TrophyTitle>& previous, const std::vector<TrophyTitle>& current);
+int detailRequestCount(const TrophyTitle& title);
+
+// Rough heap footprint of a decoded detail, used to budget the in-memory detail cache.
+size_t approximateBytes(const TitleDetail& detail);
+
 json_object* toJson(const TrophySummary& summary);
 json_object* toJson(const TrophyTitle& title);
 json_object* toJson(const TrophyGroup& group);
@@ -178,6 +197,21 @@ json_object* toJson(const Trophy& trophy);
 bool parseCachedGroup(json_object* obj, TrophyGroup& out);
 bool parseCachedTrophy(json_object* obj, Trophy& out);
 
+bool parseSummary(JsonReader& reader, TrophySummary& out);
+bool parseProfile(JsonReader& reader, PsnProfile& out);
+bool parseTitle(JsonReader& reader, TrophyTitle& out);
+bool parseGroupDefinition(JsonReader& reader, TrophyGroup& out);
+bool parseGroupProgress(JsonReader& reader, TrophyGroup& out);
+bool parseTrophyDefinition(JsonReader& reader, Trophy& out);
+bool parseTrophyProgress(JsonReader& reader, Trophy& out);
+bool parsePlayedGame(JsonReader& reader, PlayedGame& out);
+bool parseCachedGroup(JsonReader& reader, TrophyGroup& out);
+bool parseCachedTrophy(JsonReader& reader, Trophy& out);
+
+bool parseCachedSummary(std::string_view body, TrophySummary& out, int64_t& outSavedAt);
+bool parseCachedLibrary(std::string_view body, std::vector<TrophyTitle>& out, int64_t& outSavedAt);
+bool parseCachedDetail(std::string_view body, TitleDetail& out, int64_t& outSavedAt);
+
 } // namespace psn
 
 #endif // AKIRA_PSN_MODELS_HPP
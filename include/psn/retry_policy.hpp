@@ -0,0 +1,48 @@
+#ifndef AKIRA_PSN_RETRY_POLICY_HPP
+#define AKIRA_PSN_RETRY_POLICY_HPP
+
+#include <string>
+
+#include "psn/status.hpp"
+
+namespace psn {
+
+// One attempt's outcome, reduced to what the retry decision needs.
+struct Reply {
+    bool transportFailed = false;
+    int status = 0;
+    std::string retryAfter;
+    std::string error;
+};
+
+enum class Next {
+    Deliver,
+    RefreshToken,
+    Throttle,
+    Retry,
+    Fail
+};
+
+struct Verdict {
+    Next next = Next::Deliver;
+    Error error;
+    int cooldownSeconds = 0;
+    int backoffSeconds = 0;
+};
+
+// How a governed PSN GET reacts to each reply: a 401 earns one token refresh, a 429 opens
+// the breaker for at least THROTTLE_SECONDS or the server's Retry-After, transport
+// failures and 5xx are retried with doubling backoff, anything else is final.
+struct RetryPolicy {
+    static constexpr int MAX_ATTEMPTS = 3;
+    static constexpr int THROTTLE_SECONDS = 15 * 60;
+    static constexpr int THROTTLE_MAX_SECONDS = 60 * 60;
+    static constexpr int FIRST_BACKOFF_SECONDS = 2;
+
+    // `attempt` counts from 1.
+    static Verdict judge(const Reply& reply, int attempt, bool refreshedOn401);
+};
+
+} // namespace psn
+
+#endif // AKIRA_PSN_RETRY_POLICY_HPP
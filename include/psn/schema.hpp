@@ -0,0 +1,125 @@
+#ifndef AKIRA_PSN_SCHEMA_HPP
+#define AKIRA_PSN_SCHEMA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "psn/json_reader.hpp"
+
+namespace psn {
+
+// A model's wire format is a table of Field rows. decodeObject walks the object once and
+// dispatches each key to its row; unknown keys are skipped and nulls count as absent.
+template <typename T>
+struct Field {
+    std::string_view key;
+    void (*decode)(JsonReader& reader, T& out);
+};
+
+void assignApiText(std::string& out, std::string_view raw);
+
+void readValue(JsonReader& reader, std::string& out);
+void readValue(JsonReader& reader, int& out);
+void readValue(JsonReader& reader, int64_t& out);
+void readValue(JsonReader& reader, double& out);
+void readValue(JsonReader& reader, bool& out);
+
+template <typename M>
+struct MemberOf;
+
+template <typename C, typename V>
+struct MemberOf<V C::*> {
+    using Owner = C;
+};
+
+template <auto Member>
+constexpr Field<typename MemberOf<decltype(Member)>::Owner> field(std::string_view key)
+{
+    using Owner = typename MemberOf<decltype(Member)>::Owner;
+    return {key, [](JsonReader& reader, Owner& out) { readValue(reader, out.*Member); }};
+}
+
+template <typename T, size_t N>
+constexpr uint64_t fieldBit(const Field<T> (&fields)[N], std::string_view key)
+{
+    for (size_t i = 0; i < N; i++)
+    {
+        if (fields[i].key == key)
+            return uint64_t(1) << i;
+    }
+    return 0;
+}
+
+// Responses list their keys in a stable order, so the search resumes just past the
+// previous match and usually hits on the first comparison.
+template <typename T, size_t N>
+bool decodeObject(JsonReader& reader, const Field<T> (&fields)[N], T& out, uint64_t* seen = nullptr)
+{
+    static_assert(N <= 64, "a schema is limited to 64 fields");
+
+    if (reader.peek() != JsonReader::Kind::Object)
+    {
+        reader.skip();
+        return false;
+    }
+
+    reader.enterObject();
+
+    size_t cursor = 0;
+    std::string_view key;
+
+    while (reader.nextKey(key))
+    {
+        const Field<T>* match = nullptr;
+
+        for (size_t i = 0; i < N; i++)
+        {
+            size_t index = cursor + i < N ? cursor + i : cursor + i - N;
+            if (fields[index].key == key)
+            {
+                match = &fields[index];
+                cursor = index + 1 < N ? index + 1 : 0;
+                break;
+            }
+        }
+
+        if (!match)
+        {
+            reader.skip();
+            continue;
+        }
+
+        if (reader.skipNull())
+            continue;
+
+        match->decode(reader, out);
+
+        if (seen)
+            *seen |= uint64_t(1) << (match - fields);
+    }
+
+    return !reader.failed();
+}
+
+// onElement must consume exactly one value per call.
+template <typename Sink>
+bool decodeArray(JsonReader& reader, Sink&& onElement)
+{
+    if (reader.peek() != JsonReader::Kind::Array)
+    {
+        reader.skip();
+        return false;
+    }
+
+    reader.enterArray();
+    while (reader.nextElement())
+        onElement(reader);
+
+    return !reader.failed();
+}
+
+} // namespace psn
+
+#endif // AKIRA_PSN_SCHEMA_HPP
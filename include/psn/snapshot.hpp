@@ -0,0 +1,48 @@
+#ifndef AKIRA_PSN_SNAPSHOT_HPP
+#define AKIRA_PSN_SNAPSHOT_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "psn/models.hpp"
+
+namespace psn {
+
+// Binary form of the trophy caches. A snapshot is a 32-byte header, a table of sections of
+// fixed-size little-endian records, then one string table the records point into. Nothing
+// in it is position dependent, so a loader can decode straight out of a single read or a
+// mapping of the file. The header carries an FNV-1a checksum of everything after it.
+enum class SnapshotKind : uint16_t {
+    Summary = 1,
+    Library = 2,
+    Detail = 3,
+};
+
+constexpr uint16_t SNAPSHOT_VERSION = 1;
+
+std::string encodeSnapshot(const TrophySummary& summary, int64_t savedAt);
+std::string encodeSnapshot(const std::vector<TrophyTitle>& titles, int64_t savedAt);
+std::string encodeSnapshot(const TitleDetail& detail, int64_t savedAt);
+
+bool decodeSnapshot(std::string_view bytes, TrophySummary& out, int64_t& outSavedAt);
+bool decodeSnapshot(std::string_view bytes, std::vector<TrophyTitle>& out, int64_t& outSavedAt);
+bool decodeSnapshot(std::string_view bytes, TitleDetail& out, int64_t& outSavedAt);
+
+// Renders a snapshot of any kind as the JSON document the caches used to be stored as.
+bool snapshotToJson(std::string_view bytes, std::string& outJson);
+
+// The JSON cache a snapshot file replaced: "summary.bin" was "summary.json".
+std::string legacyCachePath(const std::string& snapshotPath);
+
+// Reads the snapshot at path. When there is none, reads the JSON cache it replaced, writes
+// that out as the snapshot with its original save time, and deletes the JSON once the
+// snapshot is in place.
+bool loadCacheFile(const std::string& path, TrophySummary& out, int64_t& outSavedAt);
+bool loadCacheFile(const std::string& path, std::vector<TrophyTitle>& out, int64_t& outSavedAt);
+bool loadCacheFile(const std::string& path, TitleDetail& out, int64_t& outSavedAt);
+
+} // namespace psn
+
+#endif // AKIRA_PSN_SNAPSHOT_HPP
@@ -144,7 +144,9 @@ private:
     void updateFrameBindings(AVFrame* frame);
     void recordStaticVideoCommands();
 
-    bool compileShaderFromSource(CShader& shader, const std::string& source, bool isVertex);
+    // Through the on-disk DKSH cache; variant names the defines injected into source.
+    bool compileShaderFromSource(CShader& shader, const std::string& source,
+        const std::string& variant, bool isVertex);
     bool ensureVertexShaderCompiled();
     CShader* getOrCreateFragmentShader(const ShaderVariantKey& key);
     bool compileVideoShaders(bool dithering);
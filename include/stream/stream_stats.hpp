@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <string>
 
 struct StreamStats
 {
@@ -36,6 +37,9 @@ struct StreamStats
     size_t frames_recovered = 0;
 
     uint64_t stream_duration_seconds = 0;
+
+    // Stage timeline of the connect that started this stream, see ConnectTimeline.
+    std::string connect_timeline;
 };
 
 #endif // AKIRA_IO_STREAM_STATS_HPP
@@ -3,12 +3,17 @@
 
 #include <borealis.hpp>
 
-#include <deque>
-#include <mutex>
+#include "util/text_layout.hpp"
+
+#include <cstdint>
 #include <string>
 
 namespace akira::ui {
 
+// Shows the tail of the borealis log. The logger callback, which may run on any thread,
+// only pushes into LogRing::shared(); render() pulls what arrived since the last frame on
+// the UI thread, so the pane's own lines need no lock. Lines are wrapped once through a
+// TextLayoutCache and only the rows that fit are drawn.
 class LogPane {
 public:
     ~LogPane();
@@ -20,9 +25,13 @@ public:
     void render(NVGcontext* vg, float x, float y, float width, float height);
 
 private:
-    std::deque<std::string> lines;
-    std::mutex linesMutex;
     static constexpr size_t MAX_LINES = 100;
+    static constexpr float FONT_SIZE = 16;
+
+    TextLayoutCache layout{MAX_LINES};
+    uint64_t nextSeq = 0;
+
+    void pullLines();
 
     brls::Event<brls::Logger::TimePoint, brls::LogLevel, std::string>::Subscription subscription;
     bool subscribed = false;
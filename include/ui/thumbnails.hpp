@@ -0,0 +1,43 @@
+#ifndef AKIRA_UI_THUMBNAILS_HPP
+#define AKIRA_UI_THUMBNAILS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "util/thumbnail_pipeline.hpp"
+
+namespace brls {
+class Image;
+}
+
+namespace akira::ui::thumbnails {
+
+enum class Source : uint8_t {
+    Icon,
+    Artwork
+};
+
+// Fetches url through TrophyManager and hands back a thumbnail for a view of width x height
+// layout units, decoded and scaled off the UI thread. onReady runs on the UI thread, before
+// load() returns when the thumbnail is already cached; a null thumbnail means the bytes did
+// not decode.
+void load(Source source, const std::string& url, float width, float height, ThumbnailPipeline::Ready onReady);
+
+// The same for a row about to scroll in: fetched and decoded into the cache, nobody called.
+// Withdrawn again with cancel() while the fetch is still queued.
+void prefetch(Source source, const std::string& url, float width, float height);
+void cancel(const std::string& url);
+
+// What one thumbnail for a view of width x height layout units holds in the cache, and how
+// much of the cache rows fetched ahead may take between them. Prefetch is budgeted in these
+// so that decoding ahead never evicts the thumbnails on screen.
+size_t bytesFor(float width, float height);
+size_t prefetchBudgetBytes();
+
+// Uploads the thumbnail as the image's texture; false when there is nothing to show.
+bool apply(brls::Image* image, const ThumbnailPipeline::Thumbnail& thumbnail);
+
+} // namespace akira::ui::thumbnails
+
+#endif // AKIRA_UI_THUMBNAILS_HPP
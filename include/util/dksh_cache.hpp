@@ -0,0 +1,78 @@
+#ifndef AKIRA_DKSH_CACHE_HPP
+#define AKIRA_DKSH_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Compiled shaders kept on disk between launches, so starting a stream or first using an
+// FSR variant loads a DKSH blob instead of running the GLSL compiler. An entry is keyed by
+// the SHA-256 of the compiler version, the stage, the variant and the source, so editing
+// a shader, changing a variant or updating the compiler misses instead of loading a stale
+// blob. Every file carries its key, its compiler version and a hash of the blob, and is
+// checked against all three on load. A file that fails the check is deleted and compiled
+// again. Files are written through akira::fileio::replace, so a crash never leaves a
+// half-written entry under a real key, and a load touches the file's modification time
+// so prune() sees it as recently used. Blobs loaded this run are also kept in memory.
+// Thread-safe; the compiler runs under the lock, since uam keeps global state.
+class DkshCache {
+public:
+    // GLSL to DKSH; empty when the source does not compile. uam on the console.
+    using Compiler = std::function<std::vector<uint8_t>(const std::string& source, bool isVertex)>;
+
+    struct Config {
+        std::string dir;              // empty keeps entries in memory only
+        std::string compilerVersion;
+        size_t maxFiles = 48;         // prune() drops the least recently used past this
+    };
+
+    struct Stats {
+        int memoryHits = 0;
+        int diskHits = 0;
+        int compiles = 0;
+        int rejected = 0;       // files that failed validation
+        int writeFailures = 0;
+    };
+
+    DkshCache(Config config, Compiler compiler);
+
+    DkshCache(const DkshCache&) = delete;
+    DkshCache& operator=(const DkshCache&) = delete;
+
+    // The compiled blob for source as variant; empty if it does not compile. variant only
+    // names the defines already in source, for the key.
+    std::vector<uint8_t> get(const std::string& source, const std::string& variant, bool isVertex);
+
+    // Deletes leftover temporary files over a minute old, entries from another compiler version and
+    // unreadable ones, then the least recently used past maxFiles. Reads only each file's
+    // header and runs outside the lock, so it can go on a background thread while get()
+    // serves the renderer. Returns how many went.
+    size_t prune();
+
+    Stats stats() const;
+
+    static std::string keyFor(const std::string& compilerVersion, const std::string& source,
+                              const std::string& variant, bool isVertex);
+    static std::vector<uint8_t> encode(const std::string& key, const std::string& compilerVersion,
+                                       const std::vector<uint8_t>& blob);
+    // The blob in a file's bytes, or false if they are not a valid entry for key.
+    static bool decode(const std::vector<uint8_t>& file, const std::string& key,
+                       const std::string& compilerVersion, std::vector<uint8_t>& blob);
+
+private:
+    Config config;
+    Compiler compiler;
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, std::vector<uint8_t>> loaded;
+    Stats counters;
+
+    std::string pathFor(const std::string& key) const;
+    bool loadLocked(const std::string& key, std::vector<uint8_t>& blob);
+    bool storeLocked(const std::string& key, const std::vector<uint8_t>& blob);
+};
+
+#endif // AKIRA_DKSH_CACHE_HPP
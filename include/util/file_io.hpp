@@ -0,0 +1,37 @@
+#ifndef AKIRA_FILE_IO_HPP
+#define AKIRA_FILE_IO_HPP
+
+#include <cstddef>
+#include <string>
+
+// Whole-file reads and crash-safe replacement for files on the SD card.
+//
+// FAT on the SD card will not rename over an existing file, so replace() writes the new
+// contents to a staging file, removes the old file and then renames. The staging file is
+// only ever left behind in place of the real one once it is complete: if the rename fails
+// or the app dies after the remove, it is kept, and the next read or recover() moves it
+// into place instead of finding nothing.
+namespace akira::fileio {
+
+// Where replace() stages new contents for `path`.
+std::string stagingPath(const std::string& path);
+
+// Moves a staging file left by an interrupted replace() into place when `path` itself is
+// missing. True when `path` exists afterwards.
+bool recover(const std::string& path);
+
+// The whole file in one read sized up front, after recover(). False when it cannot be
+// opened or read.
+bool readAll(const std::string& path, std::string& out);
+
+// As above, empty on failure.
+std::string readAll(const std::string& path);
+
+// Replaces `path` with `size` bytes. False when the new contents did not reach `path`;
+// if the old file was already gone by then, they are left staged for recover().
+bool replace(const std::string& path, const void* data, size_t size);
+bool replace(const std::string& path, const std::string& bytes);
+
+} // namespace akira::fileio
+
+#endif // AKIRA_FILE_IO_HPP
@@ -1,6 +1,7 @@
 #ifndef AKIRA_HTTP_HPP
 #define AKIRA_HTTP_HPP
 
+#include <atomic>
 #include <string>
 #include <utility>
 #include <vector>
@@ -10,6 +11,7 @@ struct HttpResponse {
     std::string body;
     std::string error;
     std::vector<std::pair<std::string, std::string>> headers;
+    bool cancelled = false;
 
     bool ok() const { return error.empty() && status >= 200 && status < 300; }
     bool transportFailed() const { return !error.empty(); }
@@ -30,6 +32,8 @@ struct HttpRequest {
     bool verifyPeer = false;
     bool followLocation = true;
     bool freshConnect = false;
+    // Checked while the transfer runs; once set the request stops and fails as cancelled.
+    const std::atomic<bool>* cancel = nullptr;
 
     void* reuseHandle = nullptr;
 };
@@ -1,6 +1,7 @@
 #ifndef AKIRA_HTTP_POOL_HPP
 #define AKIRA_HTTP_POOL_HPP
 
+#include <chrono>
 #include <condition_variable>
 #include <deque>
 #include <functional>
@@ -8,6 +9,7 @@
 #include <thread>
 #include <vector>
 
+#include "core/timer_wheel.hpp"
 #include "util/http.hpp"
 
 class HttpPool {
@@ -17,6 +19,22 @@ public:
     static HttpPool& instance();
 
     void submit(Task task);
+
+    // Runs every task in batch and returns once they have all finished. The caller works
+    // through the batch on its own session alongside any idle workers, so it is safe to call
+    // from inside a pool task even when every other worker is busy.
+    void fanOut(HttpSession& session, std::vector<Task> batch);
+
+    // Queues task once delay has passed. Nothing occupies a worker while it waits, and a
+    // delayed task runs ahead of ordinary submissions when it comes due.
+    void submitAfter(std::chrono::milliseconds delay, Task task);
+
+    // Keeps the caller's thread useful until finished() holds: due delayed tasks and
+    // queued work run on its session in the meantime. Whatever makes finished() true must
+    // call wake() afterwards.
+    void helpUntil(HttpSession& session, const std::function<bool()>& finished);
+    void wake();
+
     void stop();
 
     size_t threadCount() const { return threads.size(); }
@@ -30,11 +48,20 @@ private:
 
     void ensureStarted();
     void run(int index);
+    void releaseDueLocked();
+    bool takeLocked(Task& out, bool readyOnly);
+    void waitLocked(std::unique_lock<std::mutex>& lock);
+    static int64_t nowMs();
 
     static constexpr int THREAD_COUNT = 4;
+    // Helping runs other tasks on the waiter's stack. Past this depth a waiter only runs
+    // delayed tasks, which never wait themselves, so the stack stays bounded.
+    static constexpr int MAX_HELP_DEPTH = 2;
 
     std::vector<std::thread> threads;
     std::deque<Task> tasks;
+    std::deque<Task> ready;
+    TimerWheel timers{10, 256, nowMs()};
     mutable std::mutex mutex;
     std::condition_variable cond;
     bool stopping = false;
@@ -0,0 +1,98 @@
+#ifndef AKIRA_LOG_RING_HPP
+#define AKIRA_LOG_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Fixed-capacity ring of log records shared by any number of producer threads and
+// readers. Every category has slots of its own, so a chatty one never evicts another's
+// records, and its own sequence numbers. Slots are preallocated; a producer claims a
+// sequence number with one atomic add and publishes the record behind a per-slot stamp,
+// so it never waits on a lock or on a reader. Readers ask for the records since a
+// sequence they have already seen and copy only those. A record overwritten before it was
+// read is skipped, and one whose slot was lapped by a newer record mid-write is dropped.
+// Text longer than TEXT_BYTES is cut at a UTF-8 boundary.
+class LogRing {
+public:
+    // Same order as brls::LogLevel.
+    enum class Level : uint8_t {
+        Error,
+        Warning,
+        Info,
+        Debug,
+        Verbose,
+    };
+
+    enum class Category : uint8_t {
+        General,
+        Discovery,
+    };
+
+    struct Record {
+        uint64_t seq = 0;
+        int64_t timeMs = 0;  // system clock, ms since the epoch
+        Level level = Level::Info;
+        Category category = Category::General;
+        std::string text;
+    };
+
+    static constexpr size_t TEXT_BYTES = 240;
+
+    // capacity is per category, rounded up to a power of two.
+    explicit LogRing(size_t capacity);
+
+    // The process-wide ring behind the discovery log and LogPane.
+    static LogRing& shared();
+
+    // Returns the record's sequence number.
+    uint64_t push(Level level, Category category, std::string_view text);
+    uint64_t push(Level level, Category category, std::string_view text, int64_t timeMs);
+
+    // Appends the records of category with sequence >= since, oldest first, and returns
+    // the sequence to ask for next time.
+    uint64_t readSince(uint64_t since, Category category, std::vector<Record>& out) const;
+
+    // The sequence the next record of category will get.
+    uint64_t head(Category category) const { return laneOf(category).next.load(std::memory_order_acquire); }
+
+    // Hides everything pushed so far in category from later reads.
+    void clear(Category category);
+
+    size_t capacity() const { return mask + 1; }
+    uint64_t dropped() const { return droppedCount.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t TEXT_WORDS = TEXT_BYTES / 8;
+    static constexpr size_t CATEGORY_COUNT = 2;
+
+    // stamp is 2 * seq + 1 while seq is being written and 2 * seq + 2 once it is
+    // published; 0 for a slot never written.
+    struct Slot {
+        std::atomic<uint64_t> stamp{0};
+        std::atomic<int64_t> timeMs{0};
+        std::atomic<uint32_t> meta{0};  // level | length << 16
+        std::atomic<uint64_t> words[TEXT_WORDS];
+        // The last sequence whose producer found the slot still held by a slower one.
+        std::atomic<uint64_t> abandoned{UINT64_MAX};
+    };
+
+    struct Lane {
+        std::unique_ptr<Slot[]> slots;
+        std::atomic<uint64_t> next{0};
+        std::atomic<uint64_t> floor{0};
+    };
+
+    Lane lanes[CATEGORY_COUNT];
+    size_t mask;
+    std::atomic<uint64_t> droppedCount{0};
+
+    Lane& laneOf(Category category) { return lanes[static_cast<size_t>(category)]; }
+    const Lane& laneOf(Category category) const { return lanes[static_cast<size_t>(category)]; }
+};
+
+#endif // AKIRA_LOG_RING_HPP
@@ -0,0 +1,340 @@
+#ifndef AKIRA_LRU_CACHE_HPP
+#define AKIRA_LRU_CACHE_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace akira {
+
+struct CacheMetrics {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t insertions = 0;
+    uint64_t evictions = 0;
+    size_t entries = 0;
+    size_t bytes = 0;
+    size_t budget = 0;
+
+    double hitRate() const
+    {
+        uint64_t lookups = hits + misses;
+        return lookups ? static_cast<double>(hits) / static_cast<double>(lookups) : 0.0;
+    }
+
+    CacheMetrics& operator+=(const CacheMetrics& other)
+    {
+        hits += other.hits;
+        misses += other.misses;
+        insertions += other.insertions;
+        evictions += other.evictions;
+        entries += other.entries;
+        bytes += other.bytes;
+        budget += other.budget;
+        return *this;
+    }
+};
+
+template <typename V>
+struct UnitSize {
+    size_t operator()(const V&) const { return 1; }
+};
+
+// Least-recently-used map that evicts once the summed SizeFn of its values passes a budget.
+// Every operation is O(1). Pinned entries live on their own list, are never evicted and
+// still count against the budget. Not thread-safe; see ShardedLruCache.
+template <typename K, typename V, typename SizeFn = UnitSize<V>, typename Hash = std::hash<K>>
+class LruCache {
+public:
+    explicit LruCache(size_t budget, SizeFn sizeOf = SizeFn())
+        : limit(budget)
+        , sizeOf(std::move(sizeOf))
+    {
+    }
+
+    // The pointer stays valid until the entry is replaced, erased or evicted.
+    V* find(const K& key)
+    {
+        auto found = index.find(key);
+        if (found == index.end())
+        {
+            counters.misses++;
+            return nullptr;
+        }
+
+        counters.hits++;
+        Node& node = *found->second;
+        if (node.pins == 0)
+            recent.splice(recent.begin(), recent, found->second);
+        return &node.value;
+    }
+
+    bool get(const K& key, V& out)
+    {
+        V* value = find(key);
+        if (!value)
+            return false;
+        out = *value;
+        return true;
+    }
+
+    bool contains(const K& key) const { return index.find(key) != index.end(); }
+
+    void put(const K& key, V value)
+    {
+        size_t size = sizeOf(value);
+        auto found = index.find(key);
+
+        if (found != index.end())
+        {
+            Node& node = *found->second;
+            used -= node.size;
+            node.value = std::move(value);
+            node.size = size;
+            used += size;
+            if (node.pins == 0)
+                recent.splice(recent.begin(), recent, found->second);
+        }
+        else
+        {
+            recent.push_front(Node{key, std::move(value), size, 0});
+            index.emplace(key, recent.begin());
+            used += size;
+        }
+
+        counters.insertions++;
+        trim();
+    }
+
+    bool erase(const K& key)
+    {
+        auto found = index.find(key);
+        if (found == index.end())
+            return false;
+
+        used -= found->second->size;
+        listOf(*found->second).erase(found->second);
+        index.erase(found);
+        return true;
+    }
+
+    // Pins nest: an entry pinned twice needs two unpins before it can be evicted again.
+    bool pin(const K& key)
+    {
+        auto found = index.find(key);
+        if (found == index.end())
+            return false;
+
+        Node& node = *found->second;
+        if (node.pins++ == 0)
+            pinned.splice(pinned.begin(), recent, found->second);
+        return true;
+    }
+
+    bool unpin(const K& key)
+    {
+        auto found = index.find(key);
+        if (found == index.end() || found->second->pins == 0)
+            return false;
+
+        Node& node = *found->second;
+        if (--node.pins == 0)
+        {
+            recent.splice(recent.begin(), pinned, found->second);
+            trim();
+        }
+        return true;
+    }
+
+    void clear()
+    {
+        index.clear();
+        recent.clear();
+        pinned.clear();
+        used = 0;
+    }
+
+    void setBudget(size_t budget)
+    {
+        limit = budget;
+        trim();
+    }
+
+    size_t size() const { return index.size(); }
+    size_t bytes() const { return used; }
+    size_t budget() const { return limit; }
+
+    CacheMetrics metrics() const
+    {
+        CacheMetrics out = counters;
+        out.entries = index.size();
+        out.bytes = used;
+        out.budget = limit;
+        return out;
+    }
+
+private:
+    struct Node {
+        K key;
+        V value;
+        size_t size;
+        int pins;
+    };
+
+    using List = std::list<Node>;
+
+    List& listOf(const Node& node) { return node.pins > 0 ? pinned : recent; }
+
+    void trim()
+    {
+        while (used > limit && !recent.empty())
+        {
+            Node& oldest = recent.back();
+            used -= oldest.size;
+            index.erase(oldest.key);
+            recent.pop_back();
+            counters.evictions++;
+        }
+    }
+
+    size_t limit;
+    size_t used = 0;
+    SizeFn sizeOf;
+    List recent;
+    List pinned;
+    std::unordered_map<K, typename List::iterator, Hash> index;
+    CacheMetrics counters;
+};
+
+// Thread-safe LruCache split into independently locked shards, each with an equal share of
+// the budget. Recency is tracked per shard, so eviction is approximately LRU overall. Given
+// the largest value it will hold, the cache uses fewer of its shards when needed so that
+// such a value takes at most half of one shard's share; otherwise a value bigger than a
+// share could never be kept, and one near it would empty its shard.
+template <typename K, typename V, typename SizeFn = UnitSize<V>, typename Hash = std::hash<K>, size_t Shards = 8>
+class ShardedLruCache {
+public:
+    explicit ShardedLruCache(size_t budget, SizeFn sizeOf = SizeFn())
+        : ShardedLruCache(budget, 0, std::move(sizeOf))
+    {
+    }
+
+    ShardedLruCache(size_t budget, size_t largestValue, SizeFn sizeOf = SizeFn())
+        : used(shardsFor(budget, largestValue))
+        , shards(makeShards(budget / used, sizeOf, std::make_index_sequence<Shards>()))
+    {
+        for (size_t i = used; i < Shards; i++)
+            shards[i].cache.setBudget(0);
+    }
+
+    bool get(const K& key, V& out)
+    {
+        Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.cache.get(key, out);
+    }
+
+    bool contains(const K& key) const
+    {
+        const Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.cache.contains(key);
+    }
+
+    void put(const K& key, V value)
+    {
+        Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.cache.put(key, std::move(value));
+    }
+
+    bool erase(const K& key)
+    {
+        Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.cache.erase(key);
+    }
+
+    bool pin(const K& key)
+    {
+        Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.cache.pin(key);
+    }
+
+    bool unpin(const K& key)
+    {
+        Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.cache.unpin(key);
+    }
+
+    void clear()
+    {
+        for (Shard& shard : shards)
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.cache.clear();
+        }
+    }
+
+    void setBudget(size_t budget)
+    {
+        for (size_t i = 0; i < used; i++)
+        {
+            std::lock_guard<std::mutex> lock(shards[i].mutex);
+            shards[i].cache.setBudget(budget / used);
+        }
+    }
+
+    CacheMetrics metrics() const
+    {
+        CacheMetrics total;
+        for (const Shard& shard : shards)
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            total += shard.cache.metrics();
+        }
+        return total;
+    }
+
+private:
+    struct Shard {
+        Shard(size_t budget, const SizeFn& sizeOf)
+            : cache(budget, sizeOf)
+        {
+        }
+
+        mutable std::mutex mutex;
+        LruCache<K, V, SizeFn, Hash> cache;
+    };
+
+    static size_t shardsFor(size_t budget, size_t largestValue)
+    {
+        if (largestValue == 0)
+            return Shards;
+        return std::clamp<size_t>(budget / (2 * largestValue), 1, Shards);
+    }
+
+    template <size_t... I>
+    static std::array<Shard, Shards> makeShards(size_t shardBudget, const SizeFn& sizeOf, std::index_sequence<I...>)
+    {
+        return {{((void)I, Shard(shardBudget, sizeOf))...}};
+    }
+
+    Shard& shardFor(const K& key) { return shards[Hash()(key) % used]; }
+    const Shard& shardFor(const K& key) const { return shards[Hash()(key) % used]; }
+
+    size_t used;  // shards in use, from the front
+    std::array<Shard, Shards> shards;
+};
+
+} // namespace akira
+
+#endif // AKIRA_LRU_CACHE_HPP
@@ -0,0 +1,79 @@
+#ifndef AKIRA_PREFETCH_PLANNER_HPP
+#define AKIRA_PREFETCH_PLANNER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+// Smoothed scroll speed from successive content offsets. Samples closer together than a
+// millisecond are folded into the next one, and a gap longer than IDLE_MS means the list
+// stopped, so the speed starts again from zero.
+class ScrollVelocity {
+public:
+    static constexpr int64_t IDLE_MS = 250;
+
+    // Returns the smoothed speed in pixels per second, positive when scrolling down.
+    float sample(float offset, int64_t nowMs);
+
+    float current() const { return speed; }
+    void reset();
+
+private:
+    float lastOffset = 0;
+    int64_t lastMs = -1;
+    float speed = 0;
+};
+
+// Decides which rows of a recycling list are worth fetching before they scroll into view.
+// The window reaches further ahead the faster the list moves, keeps a row or two behind
+// for a change of direction, and stops at the first row that would push the outstanding
+// estimate past the byte budget. Rows that leave the window are handed back for
+// cancellation; rows that become visible are simply forgotten, since their cells now own
+// the request. Not thread-safe; the owner drives it from the UI thread.
+class PrefetchPlanner {
+public:
+    struct Viewport {
+        size_t first = 0;
+        size_t last = 0;          // one past the last visible row
+        size_t rowCount = 0;
+        float rowsPerSecond = 0;  // negative when scrolling up
+    };
+
+    struct Plan {
+        std::vector<size_t> fetch;   // nearest the viewport first
+        std::vector<size_t> cancel;
+
+        bool empty() const { return fetch.empty() && cancel.empty(); }
+    };
+
+    using RowCost = std::function<size_t(size_t row)>;
+
+    struct Config {
+        size_t byteBudget = 4 * 1024 * 1024;
+        float horizonSeconds = 0.75f;  // how far ahead, in time, a moving list looks
+        size_t minAhead = 2;
+        size_t maxAhead = 24;
+        size_t behind = 1;
+    };
+
+    PrefetchPlanner();
+    explicit PrefetchPlanner(Config config);
+
+    Plan update(const Viewport& view, const RowCost& cost);
+
+    // Drops every tracked row and returns them for cancellation, e.g. when the data changes.
+    std::vector<size_t> reset();
+
+    size_t outstandingBytes() const { return outstanding; }
+    size_t outstandingRows() const { return tracked.size(); }
+
+private:
+    Config config;
+    std::unordered_map<size_t, size_t> tracked;
+    size_t outstanding = 0;
+    int direction = 1;
+};
+
+#endif // AKIRA_PREFETCH_PLANNER_HPP
@@ -0,0 +1,35 @@
+#ifndef AKIRA_ROW_OFFSET_TREE_HPP
+#define AKIRA_ROW_OFFSET_TREE_HPP
+
+#include <cstddef>
+#include <vector>
+
+// Running offsets of a list of rows with differing heights, as a Fenwick tree. The offset
+// of a row, a change to one row's height, an appended row and the row under a scroll
+// position are all O(log n), where walking a height cache was O(n) per query. Sums are kept
+// in double so thousands of float heights updated in place do not drift. Not thread-safe.
+class RowOffsetTree {
+public:
+    void assign(const std::vector<float>& heights);
+    void push_back(float height);
+    void set(size_t row, float height);
+    void clear();
+
+    size_t size() const { return heights.size(); }
+    float height(size_t row) const { return heights[row]; }
+
+    // Summed height of rows [0, row); row is clamped to size().
+    double offsetOf(size_t row) const;
+    double total() const { return offsetOf(heights.size()); }
+
+    // The row covering position: offsetOf(row) <= position < offsetOf(row + 1). Positions
+    // above the first row give 0 and past the last give the last row.
+    size_t rowAt(double position) const;
+
+private:
+    std::vector<float> heights;
+    std::vector<double> tree;  // 1-based; tree[i] sums the lowbit(i) rows ending at row i - 1
+    size_t topBit = 0;
+};
+
+#endif // AKIRA_ROW_OFFSET_TREE_HPP
@@ -0,0 +1,81 @@
+#ifndef AKIRA_TEXT_LAYOUT_HPP
+#define AKIRA_TEXT_LAYOUT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Widths of text in the current font. The app measures with NanoVG; tests pass a fake.
+class GlyphMetrics {
+public:
+    virtual ~GlyphMetrics() = default;
+
+    virtual float width(std::string_view text) const = 0;
+    virtual float lineHeight() const = 0;
+};
+
+// One wrapped row of a line, as byte offsets into its text.
+struct TextRow {
+    uint32_t begin = 0;
+    uint32_t end = 0;
+};
+
+// Greedy word wrap: breaks at spaces, and inside a word only when the word alone is wider
+// than maxWidth, never splitting a UTF-8 sequence. '\n' always breaks. The spaces at a
+// break are dropped. Text that is empty still gets one (empty) row.
+std::vector<TextRow> wrapText(std::string_view text, float maxWidth, const GlyphMetrics& metrics);
+
+// The tail of a log as wrapped rows. Each line is wrapped once for a given width and font
+// size and the result kept until one of them changes; the visible tail is recomputed only
+// when a line is added or the geometry changes, and only the lines that fit in the view
+// are ever wrapped. Not thread-safe.
+class TextLayoutCache {
+public:
+    struct Line {
+        std::string text;
+        std::vector<TextRow> rows;
+        uint64_t layoutKey = 0;  // the geometry the rows were computed for; 0 if never
+    };
+
+    // The newest lines that fit, oldest first: lines [first, size()).
+    struct Tail {
+        size_t first = 0;
+        float height = 0;
+    };
+
+    explicit TextLayoutCache(size_t maxLines);
+
+    // Drops the oldest line past maxLines.
+    void append(std::string text);
+    void clear();
+
+    // Returns true if width or font size changed, which invalidates every layout.
+    bool setGeometry(float width, float fontSize);
+
+    // Wraps whatever visible line is not laid out for the current geometry yet. Lines only
+    // show whole, as nvgTextBox did.
+    Tail layoutTail(float height, const GlyphMetrics& metrics);
+
+    size_t size() const { return lines.size(); }
+    const Line& line(size_t index) const { return lines[index]; }
+
+    // Lines wrapped so far, for tests and benchmarks.
+    uint64_t wrapCount() const { return wraps; }
+
+private:
+    std::deque<Line> lines;
+    size_t maxLines;
+    float width = 0;
+    float fontSize = 0;
+    uint64_t key = 1;
+    uint64_t wraps = 0;
+
+    bool tailValid = false;
+    float tailHeight = 0;
+    Tail tail;
+};
+
+#endif // AKIRA_TEXT_LAYOUT_HPP
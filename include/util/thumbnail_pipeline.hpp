@@ -0,0 +1,102 @@
+#ifndef AKIRA_THUMBNAIL_PIPELINE_HPP
+#define AKIRA_THUMBNAIL_PIPELINE_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "util/lru_cache.hpp"
+
+// Tightly packed RGBA, four bytes a pixel, rows top to bottom.
+struct RgbaImage {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> pixels;
+
+    size_t bytes() const { return pixels.size(); }
+};
+
+// Scales a straight-alpha image down so it just covers width x height, keeping its aspect
+// ratio, crops whatever still overflows the box evenly from both sides, and premultiplies
+// it. Every output pixel is the area-weighted average of the source pixels under it, taken
+// after premultiplying so transparent pixels do not bleed their colour into the edges. An
+// image already inside the box is only premultiplied.
+RgbaImage downscalePremultiplied(const RgbaImage& source, int width, int height);
+
+// Decodes artwork and icons into premultiplied thumbnails at the size a cell draws them, on
+// a worker thread rather than in setImageFromMem on the UI thread, and keeps the results
+// in a byte-budgeted LRU keyed by url and size. Requests for a thumbnail already being
+// made join it. Finished thumbnails reach the caller through the deliver hook, which on
+// the console posts to the UI thread.
+class ThumbnailPipeline {
+public:
+    using Thumbnail = std::shared_ptr<const RgbaImage>;
+    // Turns encoded bytes into straight-alpha RGBA; false when they are not an image.
+    using Decoder = std::function<bool(const std::vector<uint8_t>& encoded, RgbaImage& out)>;
+    using Deliver = std::function<void(std::function<void()>)>;
+    // thumbnail is null when the bytes did not decode.
+    using Ready = std::function<void(const std::string& url, const Thumbnail& thumbnail)>;
+
+    enum class Priority : uint8_t {
+        Visible,  // a cell is waiting; goes ahead of everything queued
+        Ahead     // prefetch for rows not yet on screen
+    };
+
+    ThumbnailPipeline(Decoder decoder, Deliver deliver, size_t cacheBytes);
+    ~ThumbnailPipeline();
+
+    ThumbnailPipeline(const ThumbnailPipeline&) = delete;
+    ThumbnailPipeline& operator=(const ThumbnailPipeline&) = delete;
+
+    Thumbnail cached(const std::string& url, int width, int height);
+
+    // A cached thumbnail is handed to onReady before this returns, so a rebound cell never
+    // shows a blank frame; otherwise the work is queued and onReady runs via deliver.
+    void request(const std::string& url, std::vector<uint8_t> encoded, int width, int height,
+        Priority priority, Ready onReady);
+
+    // Drops queued work and joins the worker. Pending callbacks are never run.
+    void stop();
+
+    akira::CacheMetrics metrics() const;
+    size_t queued() const;
+
+private:
+    struct Job {
+        std::string key;
+        std::string url;
+        std::vector<uint8_t> encoded;
+        int width = 0;
+        int height = 0;
+    };
+
+    struct ThumbnailBytes {
+        size_t operator()(const Thumbnail& thumbnail) const { return thumbnail ? thumbnail->bytes() : 0; }
+    };
+
+    static std::string keyFor(const std::string& url, int width, int height);
+    void ensureStartedLocked();
+    void run();
+    Thumbnail render(const Job& job) const;
+
+    Decoder decoder;
+    Deliver deliver;
+
+    mutable std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<Job> jobs;
+    std::unordered_map<std::string, std::vector<Ready>> waiters;
+    akira::LruCache<std::string, Thumbnail, ThumbnailBytes> cache;
+    bool stopping = false;
+    std::thread worker;
+};
+
+#endif // AKIRA_THUMBNAIL_PIPELINE_HPP
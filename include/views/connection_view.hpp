@@ -37,6 +37,9 @@ private:
 
     brls::Event<brls::Logger::TimePoint, brls::LogLevel, std::string>::Subscription logSubscription;
 
+    // Shared with the connection thread, which may still be polling when the view goes.
+    std::shared_ptr<WakePipeline> wakePipeline = std::make_shared<WakePipeline>();
+
     ChiakiThread connectionThread;
     std::atomic<bool> threadStarted{false};
     std::atomic<bool> connectionRunning{false};
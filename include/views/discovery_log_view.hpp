@@ -3,6 +3,8 @@
 
 #include <borealis.hpp>
 #include <cstdint>
+#include <deque>
+#include <string>
 
 class DiscoveryLogView : public brls::Box {
 public:
@@ -27,7 +29,12 @@ private:
     brls::Button* clearBtn = nullptr;
 
     brls::RepeatingTimer refreshTimer;
-    uint64_t lastVersion = UINT64_MAX;
+    static constexpr size_t MAX_LINES = 300;
+
+    // Lines already pulled from the discovery log; each refresh only reads what is new.
+    std::deque<std::string> lines;
+    uint64_t nextSeq = 0;
+    bool dirty = true;
     bool needsScrollToBottom = false;
 
     void refreshLog();
@@ -19,6 +19,7 @@ private:
     BRLS_BIND(brls::BooleanCell, debugDiscoveryLogToggle, "settings/debugDiscoveryLog");
     BRLS_BIND(brls::BooleanCell, debugFfmpegLogToggle, "settings/debugFfmpegLog");
     BRLS_BIND(brls::Button, openDiscoveryLogBtn, "settings/openDiscoveryLog");
+    BRLS_BIND(brls::Button, exportConnectTimingsBtn, "settings/exportConnectTimings");
 
     SettingsManager* settings = nullptr;
 
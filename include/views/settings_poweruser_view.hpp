@@ -23,6 +23,7 @@ private:
     BRLS_BIND(brls::SliderCell, psnRequestWindowSlider, "settings/psnRequestWindow");
     BRLS_BIND(brls::Button, runBenchmarkBtn, "settings/runBenchmark");
     BRLS_BIND(brls::Button, flushTrophyCacheBtn, "settings/flushTrophyCache");
+    BRLS_BIND(brls::Button, exportTrophyCacheBtn, "settings/exportTrophyCache");
 
     SettingsManager* settings = nullptr;
 
@@ -71,6 +71,7 @@ private:
 class TrophyGridDataSource : public RecyclingGridDataSource {
 public:
     TrophyGridDataSource(std::vector<psn::TrophyTitle> titles, psn::TrophySummary summary, bool haveSummary);
+    ~TrophyGridDataSource() override;
 
     std::vector<psn::TrophyTitle> titles;
     psn::TrophySummary summary;
@@ -80,7 +81,15 @@ public:
     float heightForRow(brls::View* recycler, size_t index) override;
     RecyclingGridItem* cellForRow(RecyclingView* recycler, size_t index) override;
     void onItemSelected(brls::Box* recycler, size_t index) override;
+    void onViewportChanged(size_t first, size_t last, float rowsPerSecond) override;
     void clearData() override;
+
+private:
+    size_t firstTitleOf(size_t row) const;
+    size_t iconsInRow(size_t row) const;
+    void withdraw(const std::vector<size_t>& rows);
+
+    PrefetchPlanner prefetch;
 };
 
 enum class TitleSort {
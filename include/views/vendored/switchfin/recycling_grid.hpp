@@ -18,6 +18,12 @@
 //     loading a missing resource left an invalid texture that was redrawn every frame.
 //   - draw() renders the hint label on its own when there is no hint image.
 //   - setEmpty()/setError() null-guard their setImageFromRes calls.
+//   - itemsRecyclingLoop() reports the bound range and scroll speed to the data source
+//     through onViewportChanged(), so it can fetch artwork ahead of the viewport.
+//   - Flow-mode row offsets live in a RowOffsetTree (Fenwick tree) instead of being summed
+//     from cellHeightCache on every query. reloadData() starts at the focused row in flow
+//     mode too, and itemsRecyclingLoop() jumps straight to the row under the viewport when
+//     it no longer overlaps the rendered cells.
 //
 // This is vendored from switchfin under the Apache-2.0 license. Please check the attached
 // license for the terms of the Apache license
@@ -27,6 +33,9 @@
 
 #include <borealis.hpp>
 
+#include "util/prefetch_planner.hpp"
+#include "util/row_offset_tree.hpp"
+
 class RecyclingView;
 
 class RecyclingGridItem : public brls::Box {
@@ -88,6 +97,13 @@ public:
      */
     virtual void onItemSelected(brls::Box* recycler, size_t index) {}
 
+    /*
+     * Tells the data source which items currently have cells, [first, last), and how fast the
+     * list is moving in items per second (negative when scrolling up). Called when either
+     * changes, so the data source can fetch ahead of the viewport.
+     */
+    virtual void onViewportChanged(size_t first, size_t last, float itemsPerSecond) {}
+
     virtual void clearData() = 0;
 };
 
@@ -156,6 +172,9 @@ public:
     // 计算从start元素的顶点到index (不包含index) 元素顶点的距离
     float getHeightByCellIndex(size_t index, size_t start = 0);
 
+    // 获取距离列表顶部 height 处的元素索引
+    size_t getCellIndexByHeight(float height);
+
     View* getNextCellFocus(brls::FocusDirection direction, View* currentView) override;
 
     void forceRequestNextPage();
@@ -222,12 +241,22 @@ private:
     brls::Label* hintLabel;
     brls::Rect renderedFrame;
     std::vector<float> cellHeightCache;
+    // 瀑布流模式下每一项的高度（含间距）的前缀和
+    RowOffsetTree rowOffsets;
+
+    ScrollVelocity scrollVelocity;
+    size_t reportedMin = SIZE_MAX, reportedMax = SIZE_MAX;
+    float reportedSpeed = 0;
 
     // 检查宽度是否有变化
     bool checkWidth();
 
     void itemsRecyclingLoop();
 
+    void reportViewport();
+
+    float rowPitch(float cellHeight) const;
+
     /**
      * 在指定位置添加一个列表项
      * 内部更新 renderedFrame 的值，假设有一个每一项都绘制的超长列表，renderedFrame 的 y 表示当前截取绘制的顶部坐标，height 表示当前绘制的高度
@@ -38,6 +38,8 @@ CloudConnectionView::CloudConnectionView(const Game& game, bool skipAttr)
 
 CloudConnectionView::~CloudConnectionView()
 {
+    if (launchCancel)
+        launchCancel->store(true);
     brls::Logger::unsubscribeFromLog(logSubscription);
     SharedViewHolder::release(this);
 }
@@ -97,6 +99,8 @@ void CloudConnectionView::setupAndStart()
             if (self->settled)
                 return true;
             self->settled = true;
+            if (self->launchCancel)
+                self->launchCancel->store(true);
             brls::sync([]() { brls::Application::popActivity(); });
         }
         return true;
@@ -115,7 +119,7 @@ void CloudConnectionView::startProvision()
 {
     auto weak = weak_from_this();
 
-    Service::instance().launchGame(game,
+    launchCancel = Service::instance().launchGame(game,
         [weak](std::shared_ptr<Host> host) {
             if (auto self = weak.lock())
                 self->onProvisionSuccess(host);
@@ -1,17 +1,79 @@
 #include "cloud/http_bridge.hpp"
 
 #include "util/http.hpp"
-#include "util/http_pool.hpp"
 
 #include "cloud/curl_http.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cstdlib>
 #include <cstring>
-#include <future>
+#include <mutex>
 #include <string>
+#include <vector>
 
 namespace {
 
+constexpr int THROTTLE_COOLDOWN_S = 5 * 60;
+constexpr int THROTTLE_COOLDOWN_MAX_S = 60 * 60;
+
+int cooldownFrom(const HttpResponse& res)
+{
+    std::string retryAfter = res.header("Retry-After");
+    int cooldown = THROTTLE_COOLDOWN_S;
+    if (!retryAfter.empty())
+        cooldown = std::max(cooldown, std::atoi(retryAfter.c_str()));
+    return std::min(cooldown, THROTTLE_COOLDOWN_MAX_S);
+}
+
+int64_t steadyNowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+thread_local cloud::CallScope* currentScope = nullptr;
+
+// Chiaki's cloud calls are synchronous, so the request runs on the calling thread instead
+// of being handed to the pool while that thread waits for it. Sessions are lent out from
+// here so each call still reuses a warm connection; like the pool, the shelf is never torn
+// down, which keeps its handles alive past static destruction.
+struct SessionShelf {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<HttpSession>> idle;
+
+    static SessionShelf& instance()
+    {
+        static SessionShelf* shelf = new SessionShelf();
+        return *shelf;
+    }
+
+    std::unique_ptr<HttpSession> take()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (idle.empty())
+            return std::make_unique<HttpSession>();
+        std::unique_ptr<HttpSession> session = std::move(idle.back());
+        idle.pop_back();
+        return session;
+    }
+
+    void give(std::unique_ptr<HttpSession> session)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        idle.push_back(std::move(session));
+    }
+};
+
+HttpResponse performInline(const HttpRequest& req)
+{
+    SessionShelf& shelf = SessionShelf::instance();
+    std::unique_ptr<HttpSession> session = shelf.take();
+    HttpResponse res = session->perform(req);
+    shelf.give(std::move(session));
+    return res;
+}
+
 char* dupBytes(const std::string& value)
 {
     char* out = static_cast<char*>(std::malloc(value.size() + 1));
@@ -24,7 +86,7 @@ ChiakiErrorCode akiraCloudTransport(ChiakiLog* log, const CCHttpRequest* request
     CCHttpResponse* response, void* user)
 {
     (void)log;
-    (void)user;
+    RequestLimiter& limiter = *static_cast<RequestLimiter*>(user);
 
     std::memset(response, 0, sizeof(*response));
 
@@ -47,17 +109,44 @@ ChiakiErrorCode akiraCloudTransport(ChiakiLog* log, const CCHttpRequest* request
         if (request->headers[i])
             req.headers.emplace_back(request->headers[i]);
 
-    std::promise<HttpResponse> promise;
-    std::future<HttpResponse> future = promise.get_future();
-    HttpPool::instance().submit([&req, &promise](HttpSession& session) {
-        promise.set_value(session.perform(req));
-    });
-    HttpResponse res = future.get();
+    if (const cloud::CallScope* scope = cloud::CallScope::current())
+    {
+        if (scope->cancelled())
+            return CHIAKI_ERR_CANCELED;
+
+        req.cancel = scope->flag();
+        if (scope->deadline() > 0)
+        {
+            int64_t left = scope->deadline() - steadyNowMs();
+            if (left <= 0)
+            {
+                brls::Logger::warning("Cloud: {} skipped, operation deadline passed", req.url);
+                return CHIAKI_ERR_TIMEOUT;
+            }
+            req.timeoutSec = std::min<long>(req.timeoutSec, (left + 999) / 1000);
+        }
+    }
 
+    // Cloud calls draw on their own budget. A refusal is handed back as a 429 so callers
+    // take the same path as when the server throttles them.
+    std::string budgetReason;
+    if (!limiter.tryAcquire(BudgetScope::Cloud, budgetReason))
+    {
+        brls::Logger::warning("Cloud: {} refused, {}", req.url, budgetReason);
+        response->status_code = 429;
+        return CHIAKI_ERR_SUCCESS;
+    }
+
+    HttpResponse res = performInline(req);
+
+    if (res.cancelled)
+        return CHIAKI_ERR_CANCELED;
     if (res.transportFailed())
         return CHIAKI_ERR_NETWORK;
 
     response->status_code = res.status;
+    if (res.status == 429)
+        limiter.recordThrottle(BudgetScope::Cloud, cooldownFrom(res));
 
     if (!res.body.empty())
     {
@@ -90,9 +179,32 @@ ChiakiErrorCode akiraCloudTransport(ChiakiLog* log, const CCHttpRequest* request
 
 namespace cloud {
 
-void registerHttpBridge()
+CancelToken makeCancelToken()
+{
+    return std::make_shared<std::atomic<bool>>(false);
+}
+
+CallScope::CallScope(CancelToken token, long deadlineSec)
+    : token(std::move(token))
+    , deadlineMs(deadlineSec > 0 ? steadyNowMs() + deadlineSec * 1000 : 0)
+    , outer(currentScope)
+{
+    currentScope = this;
+}
+
+CallScope::~CallScope()
+{
+    currentScope = outer;
+}
+
+const CallScope* CallScope::current()
+{
+    return currentScope;
+}
+
+void registerHttpBridge(RequestLimiter& limiter)
 {
-    cc_http_set_transport(akiraCloudTransport, nullptr);
+    cc_http_set_transport(akiraCloudTransport, &limiter);
 }
 
 }
@@ -3,9 +3,10 @@
 #include "cloud/cloud_connection_view.hpp"
 
 #include "core/settings_manager.hpp"
-#include "core/trophy_manager.hpp"
 #include "ui/motion.hpp"
 #include "ui/theme.hpp"
+#include "ui/thumbnails.hpp"
+#include "util/prefetch_planner.hpp"
 #include "util/shared_view_holder.hpp"
 #include "views/pair_view.hpp"
 #include "views/stream_view.hpp"
@@ -13,7 +14,6 @@
 #include <borealis/core/i18n.hpp>
 
 #include <algorithm>
-#include <cctype>
 #include <functional>
 #include <string>
 #include <vector>
@@ -22,8 +22,13 @@ using namespace brls::literals;
 
 namespace cloud {
 
+namespace thumbnails = akira::ui::thumbnails;
+
 static constexpr size_t kCloudPerRow = 4;
 static constexpr float kCloudRowHeight = 258.0f;
+// A quarter of the grid's width, near enough; thumbnails are cut to cover this box.
+static constexpr float kCloudCoverWidth = 296.0f;
+static constexpr float kCloudCoverHeight = 178.0f;
 
 static brls::Box* makePill(const std::string& text, NVGcolor color)
 {
@@ -59,7 +64,7 @@ public:
         this->setBackgroundColor(akira::ui::active().surface);
 
         cover = new brls::Image();
-        cover->setHeight(178);
+        cover->setHeight(kCloudCoverHeight);
         cover->setWidthPercentage(100.0f);
         cover->setCornerRadius(10);
         cover->setScalingType(brls::ImageScalingType::FILL);
@@ -163,13 +168,11 @@ public:
         if (iconUrl.empty())
             return;
 
-        TrophyManager::getInstance()->fetchIcon(iconUrl,
-            [](const std::string& url, const std::vector<uint8_t>& bytes) {
-                if (bytes.empty())
-                    return;
+        thumbnails::load(thumbnails::Source::Artwork, iconUrl, kCloudCoverWidth, kCloudCoverHeight,
+            [](const std::string& url, const ThumbnailPipeline::Thumbnail& thumbnail) {
                 for (CloudGameCard* card : g_liveCloudCards)
                     if (card->iconUrl == url)
-                        card->cover->setImageFromMem(bytes.data(), static_cast<int>(bytes.size()));
+                        thumbnails::apply(card->cover, thumbnail);
             });
     }
 
@@ -259,11 +262,29 @@ public:
     {
     }
 
+    ~CloudCatalogDataSource() override
+    {
+        withdraw(prefetch.reset());
+    }
+
     size_t getItemCount() override
     {
         return (games.size() + kCloudPerRow - 1) / kCloudPerRow;
     }
 
+    void onViewportChanged(size_t first, size_t last, float rowsPerSecond) override
+    {
+        PrefetchPlanner::Plan plan = prefetch.update({first, last, getItemCount(), rowsPerSecond},
+            [this](size_t row) { return coversInRow(row) * thumbnails::bytesFor(kCloudCoverWidth, kCloudCoverHeight); });
+
+        for (size_t row : plan.fetch)
+            for (size_t i = row * kCloudPerRow; i < games.size() && i < (row + 1) * kCloudPerRow; i++)
+                thumbnails::prefetch(thumbnails::Source::Artwork, games[i].artworkUrl(),
+                    kCloudCoverWidth, kCloudCoverHeight);
+
+        withdraw(plan.cancel);
+    }
+
     float heightForRow(brls::View* recycler, size_t index) override
     {
         return kCloudRowHeight;
@@ -280,11 +301,30 @@ public:
 
     void clearData() override
     {
+        withdraw(prefetch.reset());
         games.clear();
     }
 
 private:
+    size_t coversInRow(size_t row) const
+    {
+        size_t count = 0;
+        for (size_t i = row * kCloudPerRow; i < games.size() && i < (row + 1) * kCloudPerRow; i++)
+            if (!games[i].artworkUrl().empty())
+                count++;
+        return count;
+    }
+
+    void withdraw(const std::vector<size_t>& rows)
+    {
+        for (size_t row : rows)
+            for (size_t i = row * kCloudPerRow; i < games.size() && i < (row + 1) * kCloudPerRow; i++)
+                if (!games[i].artworkUrl().empty())
+                    thumbnails::cancel(games[i].artworkUrl());
+    }
+
     std::vector<Game> games;
+    PrefetchPlanner prefetch{{.byteBudget = thumbnails::prefetchBudgetBytes()}};
     std::function<void(const Game&)> onLaunch;
     std::function<bool(const std::string&)> isFav;
     std::function<void(const std::string&, bool)> onFav;
@@ -404,6 +444,13 @@ void LibraryView::willAppear(bool resetState)
     refresh(false);
 }
 
+void LibraryView::willDisappear(bool resetState)
+{
+    // Backing out abandons a catalog fetch nobody is waiting to see.
+    Service::instance().cancelRefresh();
+    brls::Box::willDisappear(resetState);
+}
+
 void LibraryView::refresh(bool force)
 {
     int gen = ++generation;
@@ -481,11 +528,13 @@ void LibraryView::renderSnapshot(const Snapshot& snapshot)
             static_cast<int>(status.availability), snapshot.hasCatalog, snapshot.catalog.games.size());
         grid->setVisibility(brls::Visibility::GONE);
         grid->clearData();
+        shownRevision = 0;
         showState(snapshot);
         return;
     }
 
-    brls::Logger::info("CloudLib: renderSnapshot -> CATALOG ({} games)", snapshot.catalog.games.size());
+    brls::Logger::info("CloudLib: renderSnapshot -> CATALOG ({} games, revision {} shown {})",
+        snapshot.catalog.games.size(), snapshot.revision, shownRevision);
 
     bool refocusGrid = false;
     for (brls::View* f = brls::Application::getCurrentFocus(); f; f = f->getParent())
@@ -500,7 +549,23 @@ void LibraryView::renderSnapshot(const Snapshot& snapshot)
     stateBox->clearViews();
     stateBox->setVisibility(brls::Visibility::GONE);
     grid->setVisibility(brls::Visibility::VISIBLE);
-    showCatalog(snapshot.catalog);
+
+    // A revalidation that found nothing new leaves the grid alone, and one that did is
+    // applied as a patch when the grid still shows the revision it was computed against.
+    if (snapshot.revision == 0 || snapshot.revision != shownRevision)
+    {
+        if (shownRevision != 0 && snapshot.changesFrom == shownRevision)
+        {
+            applyCatalogDiff(allGames, snapshot.changes);
+            searchIndex.assign(allGames);
+            applyFilter();
+        }
+        else
+        {
+            showCatalog(snapshot.catalog);
+        }
+    }
+    shownRevision = snapshot.revision;
 
     if (refocusGrid)
         brls::Application::giveFocus(grid);
@@ -615,48 +680,29 @@ void LibraryView::showState(const Snapshot& snapshot)
 void LibraryView::showCatalog(const Catalog& catalog)
 {
     allGames = catalog.games;
+    searchIndex.assign(allGames);
     applyFilter();
 }
 
 void LibraryView::applyFilter()
 {
-    std::string q = searchQuery;
-    std::transform(q.begin(), q.end(), q.begin(), [](unsigned char c) { return std::tolower(c); });
+    SearchIndex::Order order = sortState == 1 ? SearchIndex::Order::NameAscending
+                             : sortState == 2 ? SearchIndex::Order::NameDescending
+                                              : SearchIndex::Order::Featured;
 
     std::vector<Game> filtered;
     filtered.reserve(allGames.size());
-    for (const Game& game : allGames)
+    for (uint32_t id : searchIndex.search(searchQuery, order))
     {
+        const Game& game = allGames[id];
         bool pass = filterMode == Filter::All ? true
                   : filterMode == Filter::Owned ? game.isOwned
                   : filterMode == Filter::Favorites ? isFavorite(game.productId)
                                                     : game.streamableNow();
-        if (!pass)
-            continue;
-        if (!q.empty())
-        {
-            std::string name = game.name;
-            std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
-            if (name.find(q) == std::string::npos)
-                continue;
-        }
-        filtered.push_back(game);
+        if (pass)
+            filtered.push_back(game);
     }
 
-    auto ciless = [](const std::string& a, const std::string& b) {
-        return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(),
-            [](unsigned char c1, unsigned char c2) { return std::tolower(c1) < std::tolower(c2); });
-    };
-    if (sortState == 1)
-        std::sort(filtered.begin(), filtered.end(),
-            [&ciless](const Game& a, const Game& b) { return ciless(a.name, b.name); });
-    else if (sortState == 2)
-        std::sort(filtered.begin(), filtered.end(),
-            [&ciless](const Game& a, const Game& b) { return ciless(b.name, a.name); });
-    else
-        std::stable_sort(filtered.begin(), filtered.end(),
-            [](const Game& a, const Game& b) { return a.streamableNow() && !b.streamableNow(); });
-
     std::string filterLabel = filterMode == Filter::All ? "akira/cloud/filter_all"_i18n
                             : filterMode == Filter::Owned ? "akira/cloud/filter_owned"_i18n
                             : filterMode == Filter::Favorites ? "akira/cloud/filter_favorites"_i18n
@@ -1,11 +1,12 @@
 #include "cloud/models.hpp"
 
-#include "psn/models.hpp"
+#include "psn/schema.hpp"
 
 #include <json-c/json.h>
 
 #include <algorithm>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -13,25 +14,95 @@ namespace cloud {
 
 namespace {
 
-bool parseGame(json_object* obj, Game& out)
+using psn::Field;
+using psn::JsonReader;
+using psn::field;
+
+constexpr Field<Game> GAME_FIELDS[] = {
+    field<&Game::productId>("productId"),
+    field<&Game::name>("name"),
+    field<&Game::imageUrl>("imageUrl"),
+    field<&Game::landscapeImageUrl>("landscapeImageUrl"),
+    field<&Game::conceptId>("conceptId"),
+    field<&Game::category>("category"),
+    field<&Game::serviceType>("serviceType"),
+    field<&Game::platform>("platform"),
+    field<&Game::isOwned>("isOwned"),
+    field<&Game::streamServiceType>("streamServiceType"),
+    field<&Game::streamIdentifier>("streamIdentifier"),
+    field<&Game::entitlementId>("entitlementId"),
+    field<&Game::storeProductId>("storeProductId"),
+    field<&Game::conceptUrl>("conceptUrl"),
+    field<&Game::plusCatalog>("plusCatalog"),
+};
+
+constexpr Field<Datacenter> DATACENTER_FIELDS[] = {
+    field<&Datacenter::name>("dataCenter"),
+    field<&Datacenter::rttMs>("rtt"),
+};
+
+void readGames(JsonReader& reader, Catalog& out)
+{
+    psn::decodeArray(reader, [&out](JsonReader& row) {
+        Game game;
+        if (psn::decodeObject(row, GAME_FIELDS, game) && !game.productId.empty() && !game.name.empty())
+            out.games.push_back(std::move(game));
+    });
+}
+
+constexpr Field<Catalog> CATALOG_FIELDS[] = {
+    field<&Catalog::schemaVersion>("schemaVersion"),
+    field<&Catalog::total>("total"),
+    field<&Catalog::nativeMode>("nativeMode"),
+    field<&Catalog::fallbackRegion>("fallbackRegion"),
+    field<&Catalog::resolvedStoreLang>("resolvedStoreLang"),
+    field<&Catalog::settledLocale>("settledLocale"),
+    field<&Catalog::warning>("warning"),
+    {"games", readGames},
+};
+
+struct StoredCatalog {
+    int snapshotVersion = 0;
+    int64_t savedAt = 0;
+    Catalog catalog;
+    bool hasCatalog = false;
+};
+
+constexpr Field<StoredCatalog> STORED_CATALOG_FIELDS[] = {
+    field<&StoredCatalog::snapshotVersion>("snapshotVersion"),
+    field<&StoredCatalog::savedAt>("savedAt"),
+    {"catalog", [](JsonReader& reader, StoredCatalog& out) {
+         out.hasCatalog = psn::decodeObject(reader, CATALOG_FIELDS, out.catalog);
+     }},
+};
+
+json_object* gameToJson(const Game& g)
 {
-    out.productId = psn::jsonString(obj, "productId");
-    out.name = psn::jsonString(obj, "name");
-    out.imageUrl = psn::jsonString(obj, "imageUrl");
-    out.landscapeImageUrl = psn::jsonString(obj, "landscapeImageUrl");
-    out.conceptId = psn::jsonString(obj, "conceptId");
-    out.category = psn::jsonString(obj, "category");
-    out.serviceType = psn::jsonString(obj, "serviceType");
-    out.platform = psn::jsonString(obj, "platform");
-    out.isOwned = psn::jsonBool(obj, "isOwned");
-    out.streamServiceType = psn::jsonString(obj, "streamServiceType");
-    out.streamIdentifier = psn::jsonString(obj, "streamIdentifier");
-    out.entitlementId = psn::jsonString(obj, "entitlementId");
-    out.storeProductId = psn::jsonString(obj, "storeProductId");
-    out.conceptUrl = psn::jsonString(obj, "conceptUrl");
-    out.plusCatalog = psn::jsonBool(obj, "plusCatalog");
+    json_object* o = json_object_new_object();
+    json_object_object_add(o, "productId", json_object_new_string(g.productId.c_str()));
+    json_object_object_add(o, "name", json_object_new_string(g.name.c_str()));
+    json_object_object_add(o, "imageUrl", json_object_new_string(g.imageUrl.c_str()));
+    json_object_object_add(o, "landscapeImageUrl", json_object_new_string(g.landscapeImageUrl.c_str()));
+    json_object_object_add(o, "conceptId", json_object_new_string(g.conceptId.c_str()));
+    json_object_object_add(o, "category", json_object_new_string(g.category.c_str()));
+    json_object_object_add(o, "serviceType", json_object_new_string(g.serviceType.c_str()));
+    json_object_object_add(o, "platform", json_object_new_string(g.platform.c_str()));
+    json_object_object_add(o, "isOwned", json_object_new_boolean(g.isOwned));
+    json_object_object_add(o, "streamServiceType", json_object_new_string(g.streamServiceType.c_str()));
+    json_object_object_add(o, "streamIdentifier", json_object_new_string(g.streamIdentifier.c_str()));
+    json_object_object_add(o, "entitlementId", json_object_new_string(g.entitlementId.c_str()));
+    json_object_object_add(o, "storeProductId", json_object_new_string(g.storeProductId.c_str()));
+    json_object_object_add(o, "conceptUrl", json_object_new_string(g.conceptUrl.c_str()));
+    json_object_object_add(o, "plusCatalog", json_object_new_boolean(g.plusCatalog));
+    return o;
+}
 
-    return !out.productId.empty() && !out.name.empty();
+std::string releaseJson(json_object* root, const char* fallback, int flags = JSON_C_TO_STRING_SPACED)
+{
+    const char* s = json_object_to_json_string_ext(root, flags);
+    std::string result = s ? s : fallback;
+    json_object_put(root);
+    return result;
 }
 
 } // namespace
@@ -55,24 +126,15 @@ std::vector<Datacenter> parseDatacenters(const std::string& json)
     if (json.empty())
         return out;
 
-    psn::Json doc(json);
-    json_object* root = doc.get();
-    if (!root || !json_object_is_type(root, json_type_array))
-        return out;
-
-    size_t count = json_object_array_length(root);
-    out.reserve(count);
-    for (size_t i = 0; i < count; i++)
-    {
-        json_object* item = json_object_array_get_idx(root, i);
-        if (!item || !json_object_is_type(item, json_type_object))
-            continue;
+    JsonReader reader(json);
+    psn::decodeArray(reader, [&out](JsonReader& row) {
         Datacenter dc;
-        dc.name = psn::jsonString(item, "dataCenter");
-        dc.rttMs = psn::jsonInt(item, "rtt");
-        if (!dc.name.empty())
+        if (psn::decodeObject(row, DATACENTER_FIELDS, dc) && !dc.name.empty())
             out.push_back(std::move(dc));
-    }
+    });
+
+    if (reader.failed())
+        out.clear();
 
     std::sort(out.begin(), out.end(), [](const Datacenter& a, const Datacenter& b) {
         return a.rttMs < b.rttMs;
@@ -86,22 +148,16 @@ std::vector<Game> parseShortcuts(const std::string& json)
     if (json.empty())
         return out;
 
-    psn::Json doc(json);
-    json_object* root = doc.get();
-    if (!root || !json_object_is_type(root, json_type_array))
-        return out;
+    JsonReader reader(json);
+    psn::decodeArray(reader, [&out](JsonReader& row) {
+        Game game;
+        if (psn::decodeObject(row, GAME_FIELDS, game) && !game.productId.empty() && !game.name.empty())
+            out.push_back(std::move(game));
+    });
+
+    if (reader.failed())
+        out.clear();
 
-    size_t count = json_object_array_length(root);
-    out.reserve(count);
-    for (size_t i = 0; i < count; i++)
-    {
-        json_object* item = json_object_array_get_idx(root, i);
-        if (!item || !json_object_is_type(item, json_type_object))
-            continue;
-        Game g;
-        if (parseGame(item, g))
-            out.push_back(std::move(g));
-    }
     return out;
 }
 
@@ -109,62 +165,21 @@ std::string serializeShortcuts(const std::vector<Game>& games)
 {
     json_object* arr = json_object_new_array();
     for (const Game& g : games)
-    {
-        json_object* o = json_object_new_object();
-        json_object_object_add(o, "productId", json_object_new_string(g.productId.c_str()));
-        json_object_object_add(o, "name", json_object_new_string(g.name.c_str()));
-        json_object_object_add(o, "imageUrl", json_object_new_string(g.imageUrl.c_str()));
-        json_object_object_add(o, "landscapeImageUrl", json_object_new_string(g.landscapeImageUrl.c_str()));
-        json_object_object_add(o, "conceptId", json_object_new_string(g.conceptId.c_str()));
-        json_object_object_add(o, "category", json_object_new_string(g.category.c_str()));
-        json_object_object_add(o, "serviceType", json_object_new_string(g.serviceType.c_str()));
-        json_object_object_add(o, "platform", json_object_new_string(g.platform.c_str()));
-        json_object_object_add(o, "isOwned", json_object_new_boolean(g.isOwned));
-        json_object_object_add(o, "streamServiceType", json_object_new_string(g.streamServiceType.c_str()));
-        json_object_object_add(o, "streamIdentifier", json_object_new_string(g.streamIdentifier.c_str()));
-        json_object_object_add(o, "entitlementId", json_object_new_string(g.entitlementId.c_str()));
-        json_object_object_add(o, "storeProductId", json_object_new_string(g.storeProductId.c_str()));
-        json_object_object_add(o, "conceptUrl", json_object_new_string(g.conceptUrl.c_str()));
-        json_object_object_add(o, "plusCatalog", json_object_new_boolean(g.plusCatalog));
-        json_object_array_add(arr, o);
-    }
-    const char* s = json_object_to_json_string(arr);
-    std::string result = s ? s : "[]";
-    json_object_put(arr);
-    return result;
+        json_object_array_add(arr, gameToJson(g));
+    return releaseJson(arr, "[]");
 }
 
 bool parseCatalog(const std::string& json, Catalog& out)
 {
-    psn::Json doc(json);
-    json_object* root = doc.get();
-    if (!root)
+    JsonReader reader(json);
+    if (reader.peek() != JsonReader::Kind::Object)
         return false;
 
     out = Catalog{};
-    out.schemaVersion = psn::jsonInt(root, "schemaVersion");
-    out.total = psn::jsonInt(root, "total");
-    out.nativeMode = psn::jsonBool(root, "nativeMode");
-    out.fallbackRegion = psn::jsonString(root, "fallbackRegion");
-    out.resolvedStoreLang = psn::jsonString(root, "resolvedStoreLang");
-    out.settledLocale = psn::jsonString(root, "settledLocale");
-    out.warning = psn::jsonString(root, "warning");
-
-    json_object* gamesObj = nullptr;
-    if (!psn::jsonField(root, "games", &gamesObj) || !json_object_is_type(gamesObj, json_type_array))
-        return true;
-
-    size_t count = json_object_array_length(gamesObj);
-    out.games.reserve(count);
-    for (size_t i = 0; i < count; i++)
+    if (!psn::decodeObject(reader, CATALOG_FIELDS, out) || !reader.finished())
     {
-        json_object* item = json_object_array_get_idx(gamesObj, i);
-        if (!item || !json_object_is_type(item, json_type_object))
-            continue;
-
-        Game game;
-        if (parseGame(item, game))
-            out.games.push_back(std::move(game));
+        out = Catalog{};
+        return false;
     }
 
     std::vector<Game> deduped;
@@ -194,6 +209,96 @@ bool parseCatalog(const std::string& json, Catalog& out)
     return true;
 }
 
+std::string serializeCatalogSnapshot(const Catalog& catalog, int64_t savedAt)
+{
+    json_object* body = json_object_new_object();
+    json_object_object_add(body, "schemaVersion", json_object_new_int(catalog.schemaVersion));
+    json_object_object_add(body, "total", json_object_new_int(catalog.total));
+    json_object_object_add(body, "nativeMode", json_object_new_boolean(catalog.nativeMode));
+    json_object_object_add(body, "fallbackRegion", json_object_new_string(catalog.fallbackRegion.c_str()));
+    json_object_object_add(body, "resolvedStoreLang", json_object_new_string(catalog.resolvedStoreLang.c_str()));
+    json_object_object_add(body, "settledLocale", json_object_new_string(catalog.settledLocale.c_str()));
+    json_object_object_add(body, "warning", json_object_new_string(catalog.warning.c_str()));
+
+    json_object* games = json_object_new_array();
+    for (const Game& g : catalog.games)
+        json_object_array_add(games, gameToJson(g));
+    json_object_object_add(body, "games", games);
+
+    json_object* root = json_object_new_object();
+    json_object_object_add(root, "snapshotVersion", json_object_new_int(CATALOG_SNAPSHOT_VERSION));
+    json_object_object_add(root, "savedAt", json_object_new_int64(savedAt));
+    json_object_object_add(root, "catalog", body);
+    return releaseJson(root, "{}", JSON_C_TO_STRING_PLAIN);
+}
+
+bool parseCatalogSnapshot(const std::string& json, Catalog& out, int64_t& outSavedAt)
+{
+    JsonReader reader(json);
+    StoredCatalog stored;
+    if (!psn::decodeObject(reader, STORED_CATALOG_FIELDS, stored) || !reader.finished())
+        return false;
+    if (stored.snapshotVersion != CATALOG_SNAPSHOT_VERSION || !stored.hasCatalog)
+        return false;
+
+    // Stored games were deduplicated before they were written, so they are taken as is.
+    out = std::move(stored.catalog);
+    outSavedAt = stored.savedAt;
+    return true;
+}
+
+CatalogDiff diffCatalogs(const std::vector<Game>& before, const std::vector<Game>& after)
+{
+    CatalogDiff diff;
+
+    std::unordered_map<std::string_view, const Game*> previous;
+    previous.reserve(before.size());
+    for (const Game& game : before)
+        previous.emplace(game.productId, &game);
+
+    std::unordered_set<std::string_view> seen;
+    seen.reserve(after.size());
+    for (const Game& game : after)
+    {
+        seen.insert(game.productId);
+        auto it = previous.find(game.productId);
+        if (it == previous.end())
+            diff.added.push_back(game);
+        else if (!(*it->second == game))
+            diff.changed.push_back(game);
+    }
+
+    for (const Game& game : before)
+        if (!seen.contains(game.productId))
+            diff.removed.push_back(game.productId);
+
+    return diff;
+}
+
+void applyCatalogDiff(std::vector<Game>& games, const CatalogDiff& diff)
+{
+    if (!diff.removed.empty())
+    {
+        std::unordered_set<std::string_view> gone(diff.removed.begin(), diff.removed.end());
+        std::erase_if(games, [&gone](const Game& game) { return gone.contains(game.productId); });
+    }
+
+    if (!diff.changed.empty())
+    {
+        std::unordered_map<std::string_view, const Game*> updates;
+        for (const Game& game : diff.changed)
+            updates.emplace(game.productId, &game);
+        for (Game& game : games)
+        {
+            auto it = updates.find(game.productId);
+            if (it != updates.end())
+                game = *it->second;
+        }
+    }
+
+    games.insert(games.end(), diff.added.begin(), diff.added.end());
+}
+
 WarningKind classifyWarning(const std::string& warning)
 {
     if (warning.empty())
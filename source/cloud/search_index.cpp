@@ -0,0 +1,272 @@
+#include "cloud/search_index.hpp"
+
+#include <algorithm>
+
+namespace cloud {
+
+namespace {
+
+// Base letters for U+00C0..U+00FF and U+0100..U+017F. The multiplication and division signs
+// sit at 0xD7 and 0xF7 and fold to a separator.
+constexpr std::string_view LATIN1_BASE = "aaaaaaaceeeeiiiidnooooo ouuuuyts"
+                                         "aaaaaaaceeeeiiiidnooooo ouuuuyty";
+constexpr std::string_view LATIN_EXT_A_BASE = "aaaaaaccccccccdd"
+                                              "ddeeeeeeeeeegggg"
+                                              "gggghhhhiiiiiiii"
+                                              "iiiijjkkklllllll"
+                                              "lllnnnnnnnnnoooo"
+                                              "oooorrrrrrssssss"
+                                              "ssttttttuuuuuuuu"
+                                              "uuuuwwyyyzzzzzzs";
+
+static_assert(LATIN1_BASE.size() == 0x40 && LATIN_EXT_A_BASE.size() == 0x80);
+
+class Folder {
+public:
+    explicit Folder(std::string& out)
+        : out(out)
+    {
+    }
+
+    void letter(char c)
+    {
+        if (pendingSpace && !out.empty())
+            out += ' ';
+        pendingSpace = false;
+        out += c;
+    }
+
+    void letters(std::string_view text)
+    {
+        for (char c : text)
+            letter(c);
+    }
+
+    void raw(std::string_view bytes)
+    {
+        if (pendingSpace && !out.empty())
+            out += ' ';
+        pendingSpace = false;
+        out += bytes;
+    }
+
+    void separator() { pendingSpace = true; }
+
+private:
+    std::string& out;
+    bool pendingSpace = false;
+};
+
+// Decodes one UTF-8 sequence at text[i]. A malformed lead or continuation byte comes back
+// as a one-byte sequence with no code point, which the caller copies through untouched.
+uint32_t decode(std::string_view text, size_t i, size_t& length)
+{
+    auto lead = static_cast<unsigned char>(text[i]);
+    size_t need = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 0;
+    uint32_t cp = need == 4 ? lead & 0x07u : need == 3 ? lead & 0x0Fu : lead & 0x1Fu;
+
+    length = 1;
+    if (need == 0 || i + need > text.size())
+        return 0;
+
+    for (size_t k = 1; k < need; k++)
+    {
+        auto next = static_cast<unsigned char>(text[i + k]);
+        if ((next & 0xC0) != 0x80)
+            return 0;
+        cp = (cp << 6) | (next & 0x3Fu);
+    }
+
+    length = need;
+    return cp;
+}
+
+void foldCodePoint(Folder& folder, uint32_t cp, std::string_view bytes)
+{
+    switch (cp)
+    {
+        case 0x00C6: case 0x00E6: folder.letters("ae"); return;
+        case 0x00DE: case 0x00FE: folder.letters("th"); return;
+        case 0x00DF: folder.letters("ss"); return;
+        case 0x0152: case 0x0153: folder.letters("oe"); return;
+        // Apostrophes vanish so "Marvel’s" and "Marvels" meet; trademark signs likewise.
+        case 0x2018: case 0x2019: case 0x02BC: case 0x00AE: case 0x00A9: case 0x2122: return;
+        default: break;
+    }
+
+    if (cp >= 0x00C0 && cp <= 0x00FF)
+    {
+        char base = LATIN1_BASE[cp - 0x00C0];
+        if (base == ' ')
+            folder.separator();
+        else
+            folder.letter(base);
+        return;
+    }
+
+    if (cp >= 0x0100 && cp <= 0x017F)
+    {
+        folder.letter(LATIN_EXT_A_BASE[cp - 0x0100]);
+        return;
+    }
+
+    // Other Latin-1 symbols, general punctuation and the ideographic space separate words.
+    if ((cp >= 0x0080 && cp <= 0x00BF) || (cp >= 0x2000 && cp <= 0x206F) || cp == 0x3000)
+    {
+        folder.separator();
+        return;
+    }
+
+    folder.raw(bytes);
+}
+
+uint32_t trigramAt(const std::string& text, size_t i)
+{
+    return uint32_t(uint8_t(text[i])) << 16 | uint32_t(uint8_t(text[i + 1])) << 8 | uint8_t(text[i + 2]);
+}
+
+} // namespace
+
+std::string SearchIndex::fold(std::string_view text)
+{
+    std::string out;
+    out.reserve(text.size());
+    Folder folder(out);
+
+    for (size_t i = 0; i < text.size();)
+    {
+        char c = text[i];
+        if (static_cast<unsigned char>(c) < 0x80)
+        {
+            if (c >= 'A' && c <= 'Z')
+                folder.letter(static_cast<char>(c - 'A' + 'a'));
+            else if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9'))
+                folder.letter(c);
+            else if (c != '\'')
+                folder.separator();
+            i++;
+            continue;
+        }
+
+        size_t length = 1;
+        uint32_t cp = decode(text, i, length);
+        if (cp == 0)
+            folder.raw(text.substr(i, 1));
+        else
+            foldCodePoint(folder, cp, text.substr(i, length));
+        i += length;
+    }
+
+    return out;
+}
+
+void SearchIndex::assign(const std::vector<Game>& games)
+{
+    folded.clear();
+    folded.reserve(games.size());
+    trigrams.clear();
+    haveLast = false;
+    lastQuery.clear();
+    lastMatches.clear();
+
+    for (const Game& game : games)
+        folded.push_back(fold(game.name));
+
+    const auto count = static_cast<uint32_t>(folded.size());
+    for (uint32_t id = 0; id < count; id++)
+    {
+        const std::string& text = folded[id];
+        for (size_t i = 0; i + 3 <= text.size(); i++)
+        {
+            std::vector<uint32_t>& postings = trigrams[trigramAt(text, i)];
+            if (postings.empty() || postings.back() != id)
+                postings.push_back(id);
+        }
+    }
+
+    std::vector<uint32_t> ids(count);
+    for (uint32_t id = 0; id < count; id++)
+        ids[id] = id;
+
+    auto& featured = ordered[size_t(Order::Featured)];
+    featured = ids;
+    std::stable_partition(featured.begin(), featured.end(),
+        [&games](uint32_t id) { return games[id].streamableNow(); });
+
+    auto& ascending = ordered[size_t(Order::NameAscending)];
+    ascending = ids;
+    std::stable_sort(ascending.begin(), ascending.end(),
+        [this](uint32_t a, uint32_t b) { return folded[a] < folded[b]; });
+
+    auto& descending = ordered[size_t(Order::NameDescending)];
+    descending = ids;
+    std::stable_sort(descending.begin(), descending.end(),
+        [this](uint32_t a, uint32_t b) { return folded[b] < folded[a]; });
+
+    for (size_t order = 0; order < ORDER_COUNT; order++)
+    {
+        rank[order].assign(count, 0);
+        for (uint32_t position = 0; position < count; position++)
+            rank[order][ordered[order][position]] = position;
+    }
+}
+
+void SearchIndex::candidatesFor(const std::string& query, std::vector<uint32_t>& out) const
+{
+    out.clear();
+
+    if (query.size() < 3)
+    {
+        out.resize(folded.size());
+        for (uint32_t id = 0; id < out.size(); id++)
+            out[id] = id;
+        return;
+    }
+
+    // Any title containing the query contains each of its trigrams, so the rarest one's
+    // postings are a superset of the answer.
+    const std::vector<uint32_t>* rarest = nullptr;
+    for (size_t i = 0; i + 3 <= query.size(); i++)
+    {
+        auto found = trigrams.find(trigramAt(query, i));
+        if (found == trigrams.end())
+            return;
+        if (!rarest || found->second.size() < rarest->size())
+            rarest = &found->second;
+    }
+
+    out = *rarest;
+}
+
+std::vector<uint32_t> SearchIndex::search(std::string_view query, Order order)
+{
+    std::string needle = fold(query);
+    if (needle.empty())
+    {
+        haveLast = false;
+        return ordered[size_t(order)];
+    }
+
+    // Every title containing the longer query also contained the one it extends.
+    std::vector<uint32_t> candidates;
+    if (haveLast && needle.find(lastQuery) != std::string::npos)
+        candidates.swap(lastMatches);
+    else
+        candidatesFor(needle, candidates);
+
+    std::vector<uint32_t> matches;
+    matches.reserve(candidates.size());
+    for (uint32_t id : candidates)
+        if (folded[id].find(needle) != std::string::npos)
+            matches.push_back(id);
+
+    lastQuery = needle;
+    lastMatches = matches;
+    haveLast = true;
+
+    const std::vector<uint32_t>& ranks = rank[size_t(order)];
+    std::sort(matches.begin(), matches.end(), [&ranks](uint32_t a, uint32_t b) { return ranks[a] < ranks[b]; });
+    return matches;
+}
+
+} // namespace cloud
@@ -8,10 +8,12 @@
 
 #include <cstdio>
 #include <cstring>
+#include <ctime>
 #include <sys/stat.h>
 
 #include "core/host.hpp"
 #include "core/settings_manager.hpp"
+#include "util/file_io.hpp"
 
 using namespace brls::literals;
 
@@ -26,6 +28,7 @@ struct CatalogFetchResult {
 
 struct ProvisionBridge {
     Service::ProgressCallback onProgress;
+    CancelToken cancel;
 };
 
 static void provisionProgress(const char* stage, void* user)
@@ -36,9 +39,10 @@ static void provisionProgress(const char* stage, void* user)
     bridge->onProgress(stage ? stage : "");
 }
 
-static bool provisionCancelled(void*)
+static bool provisionCancelled(void* user)
 {
-    return false;
+    auto* bridge = static_cast<ProvisionBridge*>(user);
+    return bridge && bridge->cancel && bridge->cancel->load(std::memory_order_relaxed);
 }
 
 ChiakiServiceType chiakiServiceFor(const std::string& value)
@@ -184,6 +188,37 @@ Status statusForCatalog(const Catalog& catalog)
     return status;
 }
 
+Snapshot snapshotForCatalog(Catalog catalog)
+{
+    Snapshot snapshot;
+    snapshot.status = statusForCatalog(catalog);
+
+    bool expired = classifyWarning(catalog.warning) == WarningKind::SessionExpired;
+    snapshot.hasCatalog = catalog.nativeMode;
+    if (!catalog.nativeMode && !expired && !catalog.games.empty())
+    {
+        snapshot.status = Status{};
+        snapshot.status.availability = Availability::Empty;
+        snapshot.status.title = "akira/cloud/status_empty_title"_i18n;
+        snapshot.status.detail = "akira/cloud/status_empty_detail"_i18n;
+        snapshot.status.canBrowse = true;
+    }
+
+    snapshot.catalog = std::move(catalog);
+    return snapshot;
+}
+
+// A failed revalidation leaves the catalog on screen and says why it may be out of date.
+Snapshot keepCatalogAfterFailure(Snapshot previous, const std::string& detail)
+{
+    previous.status.availability = Availability::Warning;
+    previous.status.title = "akira/cloud/status_warning_title"_i18n;
+    previous.status.detail = detail;
+    previous.status.canBrowse = true;
+    previous.status.degraded = true;
+    return previous;
+}
+
 CatalogFetchResult fetchCatalogBlocking(SettingsManager* settings, const Profile& profile,
     const std::string& locale, const std::string& cacheDir, bool force)
 {
@@ -199,22 +234,11 @@ CatalogFetchResult fetchCatalogBlocking(SettingsManager* settings, const Profile
     ChiakiErrorCode err = chiaki_cloudcatalog_fetch_unified(&cfg, &raw, settings->getLogger());
     (void)err;
 
-    if (raw.json && parseCatalog(raw.json, result.snapshot.catalog))
+    Catalog catalog;
+    if (raw.json && parseCatalog(raw.json, catalog))
     {
-        const Catalog& catalog = result.snapshot.catalog;
-        result.snapshot.status = statusForCatalog(catalog);
+        result.snapshot = snapshotForCatalog(std::move(catalog));
         result.ok = true;
-
-        bool expired = classifyWarning(catalog.warning) == WarningKind::SessionExpired;
-        result.snapshot.hasCatalog = catalog.nativeMode;
-        if (!catalog.nativeMode && !expired && !catalog.games.empty())
-        {
-            result.snapshot.status = Status{};
-            result.snapshot.status.availability = Availability::Empty;
-            result.snapshot.status.title = "akira/cloud/status_empty_title"_i18n;
-            result.snapshot.status.detail = "akira/cloud/status_empty_detail"_i18n;
-            result.snapshot.status.canBrowse = true;
-        }
     }
     else
     {
@@ -277,12 +301,15 @@ Snapshot Service::defaultSnapshotForActiveProfile() const
     return defaultSnapshotForProfile(true, !profile->npsso.empty());
 }
 
-Snapshot Service::snapshotForActiveProfile() const
+Snapshot Service::snapshotForActiveProfile()
 {
     const Profile* profile = settings->getActiveProfile();
     if (!profile)
         return defaultSnapshotForProfile(false, false);
 
+    if (!profile->npsso.empty())
+        restorePersisted(profile->id);
+
     std::lock_guard<std::mutex> lock(mutex);
     auto it = entries.find(profile->id);
     if (it == entries.end())
@@ -301,6 +328,10 @@ void Service::markActiveProfileDirty()
     auto it = entries.find(profile->id);
     if (it != entries.end() && !it->second.refreshing)
         entries.erase(it);
+
+    // The profile may now be linked to another account, so its saved catalog is no guide.
+    remove(snapshotPathForProfile(profile->id).c_str());
+    restoreAttempted.insert(profile->id);
 }
 
 std::string Service::selectedLocale() const
@@ -331,6 +362,63 @@ void Service::ensureCacheDirsForProfile(int64_t profileId) const
     mkdir(profileDir.c_str(), 0755);
 }
 
+std::string Service::snapshotPathForProfile(int64_t profileId) const
+{
+    return cacheDirForProfile(profileId) + "/catalog_snapshot.json";
+}
+
+void Service::restorePersisted(int64_t profileId)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!restoreAttempted.insert(profileId).second || entries.contains(profileId))
+            return;
+    }
+
+    std::string body = akira::fileio::readAll(snapshotPathForProfile(profileId));
+    Catalog catalog;
+    int64_t savedAt = 0;
+    if (body.empty() || !parseCatalogSnapshot(body, catalog, savedAt))
+        return;
+
+    brls::Logger::info("CloudLib: restored {} games for profile {} saved at {}",
+        catalog.games.size(), profileId, savedAt);
+
+    Snapshot snapshot = snapshotForCatalog(std::move(catalog));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (entries.contains(profileId))
+        return;
+    snapshot.revision = ++lastRevision;
+    entries[profileId].snapshot = std::move(snapshot);
+}
+
+void Service::persistCatalog(int64_t profileId, const Catalog& catalog) const
+{
+    ensureCacheDirsForProfile(profileId);
+    std::string path = snapshotPathForProfile(profileId);
+    if (!akira::fileio::replace(path, serializeCatalogSnapshot(catalog, static_cast<int64_t>(std::time(nullptr)))))
+        brls::Logger::warning("CloudLib: could not save {}", path);
+}
+
+bool Service::stampRevisionLocked(const Snapshot& previous, Snapshot& next)
+{
+    if (previous.revision != 0 && previous.catalog == next.catalog)
+    {
+        next.revision = previous.revision;
+        next.changesFrom = previous.revision;
+        next.changes = {};
+        return false;
+    }
+
+    next.revision = ++lastRevision;
+    next.changesFrom = previous.revision;
+    next.changes = previous.revision != 0
+        ? diffCatalogs(previous.catalog.games, next.catalog.games)
+        : CatalogDiff{};
+    return true;
+}
+
 void Service::storeSnapshot(int64_t profileId, const Snapshot& snapshot)
 {
     std::lock_guard<std::mutex> lock(mutex);
@@ -349,6 +437,21 @@ void Service::storeLaunchError(int64_t profileId, const std::string& errorMessag
     entry.snapshot.status.canPair = true;
 }
 
+void Service::cancelRefresh()
+{
+    const Profile* profile = settings->getActiveProfile();
+    if (!profile)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(profile->id);
+    if (it != entries.end() && it->second.refreshing && it->second.cancel)
+    {
+        brls::Logger::info("CloudLib: cancelling catalog refresh for profile {}", profile->id);
+        it->second.cancel->store(true, std::memory_order_relaxed);
+    }
+}
+
 void Service::refreshActiveProfile(bool force, SnapshotCallback onDone)
 {
     const Profile* profile = settings->getActiveProfile();
@@ -369,10 +472,15 @@ void Service::refreshActiveProfile(bool force, SnapshotCallback onDone)
         return;
     }
 
+    restorePersisted(profile->id);
+
     const int64_t profileId = profile->id;
     const std::string locale = selectedLocale();
     const std::string cacheDir = cacheDirForProfile(profileId);
     const std::string npsso = profile->npsso;
+    const int64_t now = static_cast<int64_t>(std::time(nullptr));
+    CancelToken cancel = makeCancelToken();
+    Snapshot previous;
 
     {
         std::lock_guard<std::mutex> lock(mutex);
@@ -384,8 +492,20 @@ void Service::refreshActiveProfile(bool force, SnapshotCallback onDone)
             return;
         }
 
+        if (!force && entry.revalidatedAt != 0 && now - entry.revalidatedAt < REVALIDATE_AFTER_SEC)
+        {
+            if (onDone)
+            {
+                Snapshot snapshot = entry.snapshot;
+                brls::sync([onDone, snapshot]() { onDone(snapshot); });
+            }
+            return;
+        }
+
         entry.refreshing = true;
         entry.generation++;
+        entry.cancel = cancel;
+        previous = entry.snapshot;
         if (!entry.snapshot.hasCatalog)
             entry.snapshot = defaultSnapshotForProfile(true, true);
         if (onDone)
@@ -394,22 +514,46 @@ void Service::refreshActiveProfile(bool force, SnapshotCallback onDone)
 
     ensureCacheDirsForProfile(profileId);
 
-    brls::async([this, profileId, locale, cacheDir, force, npsso]() {
+    brls::async([this, profileId, locale, cacheDir, force, npsso, cancel, previous]() {
         Profile copy;
         copy.id = profileId;
         copy.npsso = npsso;
 
+        CallScope scope(cancel, CATALOG_DEADLINE_SEC);
         CatalogFetchResult fetched = fetchCatalogBlocking(settings, copy, locale, cacheDir, force);
 
+        // A cancelled fetch says nothing about the catalog, so the last good one stands.
+        bool cancelled = scope.cancelled();
+        if (cancelled)
+            fetched.snapshot = previous;
+        else if (!fetched.ok && previous.hasCatalog)
+            fetched.snapshot = keepCatalogAfterFailure(previous, fetched.snapshot.status.detail);
+
+        bool changed = false;
         std::vector<SnapshotCallback> callbacks;
         {
             std::lock_guard<std::mutex> lock(mutex);
+            if (fetched.ok && !cancelled)
+                changed = stampRevisionLocked(previous, fetched.snapshot);
+
             Entry& entry = entries[profileId];
             entry.snapshot = fetched.snapshot;
             entry.refreshing = false;
+            if (fetched.ok && !cancelled)
+                entry.revalidatedAt = static_cast<int64_t>(std::time(nullptr));
+            if (entry.cancel == cancel)
+                entry.cancel.reset();
             callbacks.swap(entry.pending);
         }
 
+        if (changed)
+        {
+            brls::Logger::info("CloudLib: catalog revision {} (+{} -{} ~{})", fetched.snapshot.revision,
+                fetched.snapshot.changes.added.size(), fetched.snapshot.changes.removed.size(),
+                fetched.snapshot.changes.changed.size());
+            persistCatalog(profileId, fetched.snapshot.catalog);
+        }
+
         Snapshot snapshot = fetched.snapshot;
         brls::sync([callbacks, snapshot]() {
             for (const SnapshotCallback& cb : callbacks)
@@ -419,15 +563,17 @@ void Service::refreshActiveProfile(bool force, SnapshotCallback onDone)
     });
 }
 
-void Service::launchGame(const Game& game, HostCallback onSuccess, ErrorCallback onError,
+CancelToken Service::launchGame(const Game& game, HostCallback onSuccess, ErrorCallback onError,
     ProgressCallback onProgress, bool forceSkipAttrCheck)
 {
+    CancelToken cancel = makeCancelToken();
+
     const Profile* profile = settings->getActiveProfile();
     if (!profile || profile->npsso.empty())
     {
         if (onError)
             onError("akira/cloud/status_pair_detail"_i18n);
-        return;
+        return cancel;
     }
 
     const bool skipAttrCheck = forceSkipAttrCheck;
@@ -436,12 +582,16 @@ void Service::launchGame(const Game& game, HostCallback onSuccess, ErrorCallback
     const std::string locale = selectedLocale();
     const std::string cacheDir = cacheDirForProfile(profileId);
 
-    brls::async([this, game, profileId, npsso, locale, cacheDir, skipAttrCheck, onSuccess, onError, onProgress]() {
+    brls::async([this, game, profileId, npsso, locale, cacheDir, skipAttrCheck, onSuccess, onError, onProgress,
+                    cancel]() {
         Profile profileCopy;
         profileCopy.id = profileId;
         profileCopy.npsso = npsso;
 
+        CallScope scope(cancel);
         CatalogFetchResult catalogResult = fetchCatalogBlocking(settings, profileCopy, locale, cacheDir, false);
+        if (scope.cancelled())
+            return;
         if (!catalogResult.ok || !catalogResult.snapshot.hasCatalog)
         {
             std::string message = catalogResult.snapshot.status.detail.empty()
@@ -452,7 +602,7 @@ void Service::launchGame(const Game& game, HostCallback onSuccess, ErrorCallback
             return;
         }
 
-        ProvisionBridge bridge{onProgress};
+        ProvisionBridge bridge{onProgress, cancel};
         const bool pscloud = game.streamServiceType == "pscloud";
         const std::string forcedDatacenter = settings->getCloudDatacenter(pscloud);
         const std::string priorDatacenters = settings->getCloudDatacentersJson(pscloud);
@@ -497,6 +647,13 @@ void Service::launchGame(const Game& game, HostCallback onSuccess, ErrorCallback
             });
         }
 
+        if (scope.cancelled())
+        {
+            brls::Logger::info("CloudLaunch: abandoned by the user");
+            chiaki_cloud_provision_result_fini(&result);
+            return;
+        }
+
         if (result.err != CHIAKI_ERR_SUCCESS)
         {
             std::string raw = result.error_message ? result.error_message : "";
@@ -527,13 +684,17 @@ void Service::launchGame(const Game& game, HostCallback onSuccess, ErrorCallback
         cloudCfg.platform = result.platform;
         host->setCloudSessionConfig(cloudCfg);
 
+        bool changed = false;
         {
             std::lock_guard<std::mutex> lock(mutex);
             auto& entry = entries[profileId];
-            entry.snapshot.status = statusForCatalog(catalogResult.snapshot.catalog);
-            entry.snapshot.catalog = catalogResult.snapshot.catalog;
-            entry.snapshot.hasCatalog = true;
+            Snapshot next = catalogResult.snapshot;
+            next.status = statusForCatalog(next.catalog);
+            changed = stampRevisionLocked(entry.snapshot, next);
+            entry.snapshot = std::move(next);
         }
+        if (changed)
+            persistCatalog(profileId, catalogResult.snapshot.catalog);
 
         chiaki_cloud_provision_result_fini(&result);
 
@@ -541,6 +702,8 @@ void Service::launchGame(const Game& game, HostCallback onSuccess, ErrorCallback
         if (onSuccess)
             brls::sync([onSuccess, host]() { onSuccess(host); });
     });
+
+    return cancel;
 }
 
 } // namespace cloud
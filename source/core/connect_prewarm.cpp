@@ -0,0 +1,237 @@
+#include "core/connect_prewarm.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <limits>
+
+ConnectPrewarm& ConnectPrewarm::shared()
+{
+    static ConnectPrewarm instance;
+    return instance;
+}
+
+ConnectPrewarm::ConnectPrewarm() : ConnectPrewarm(Config()) {}
+
+ConnectPrewarm::ConnectPrewarm(Config config) : config(config) {}
+
+ConnectPrewarm::~ConnectPrewarm()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cond.notify_all();
+    if (worker.joinable())
+        worker.join();
+}
+
+void ConnectPrewarm::focus(const std::string& key, std::vector<Stage> stages, std::function<void()> discard)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    ensureStarted();
+
+    if (currentKey == key && (currentState == State::Running || currentState == State::Warm))
+    {
+        pending.reset();
+        if (currentState == State::Warm)
+            expireAtMs = nowMs() + config.ttlMs;
+        cond.notify_all();
+        return;
+    }
+    if (pending && pending->key == key)
+        return;
+
+    pending = Job{key, std::move(stages), std::move(discard), nowMs() + config.settleMs};
+    cond.notify_all();
+}
+
+void ConnectPrewarm::blur(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (pending && pending->key == key)
+        pending.reset();
+}
+
+std::optional<std::vector<ConnectPrewarm::Timing>> ConnectPrewarm::claim(const std::string& key)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (pending && pending->key == key)
+        pending.reset();
+    if (currentKey == key && currentState == State::Running)
+        skipRest = true;
+    waitWhileBusy(key, lock);
+
+    if (currentKey != key || currentState != State::Warm)
+        return std::nullopt;
+
+    std::vector<Timing> result = std::move(timings);
+    timings.clear();
+    currentState = State::Idle;
+    currentKey.clear();
+    currentDiscard = nullptr;
+    cond.notify_all();
+    return result;
+}
+
+void ConnectPrewarm::forget(const std::string& key)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (pending && pending->key == key)
+        pending.reset();
+    waitWhileBusy(key, lock);
+    if (currentKey == key && currentState == State::Warm)
+        discardLocked(lock);
+}
+
+ConnectPrewarm::State ConnectPrewarm::state(const std::string& key) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (discardingKey == key)
+        return State::Discarding;
+    if (currentKey == key && currentState != State::Idle)
+        return currentState;
+    if (pending && pending->key == key)
+        return State::Pending;
+    return State::Idle;
+}
+
+std::string ConnectPrewarm::summary(const std::vector<Timing>& timings)
+{
+    std::string text;
+    for (const Timing& timing : timings)
+    {
+        if (!text.empty())
+            text += ", ";
+        if (!timing.ran)
+            text += std::format("{} skipped", timing.stage);
+        else if (!timing.ok)
+            text += std::format("{} failed after {} ms", timing.stage, timing.durationMs);
+        else
+            text += std::format("{} {} ms", timing.stage, timing.durationMs);
+    }
+    return text;
+}
+
+void ConnectPrewarm::ensureStarted()
+{
+    if (!worker.joinable())
+        worker = std::thread([this] { run(); });
+}
+
+void ConnectPrewarm::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping)
+    {
+        int64_t now = nowMs();
+        if (pending && now >= pending->startAtMs && discardingKey != pending->key)
+        {
+            Job job = std::move(*pending);
+            pending.reset();
+
+            // Whatever was warm for another host goes first. The new key counts as running
+            // from here on, so a claim for it waits rather than racing the stages.
+            std::function<void()> previous;
+            if (currentState == State::Warm)
+            {
+                previous = std::move(currentDiscard);
+                discardingKey = currentKey;
+            }
+            currentKey = job.key;
+            currentDiscard = std::move(job.discard);
+            currentState = State::Running;
+            timings.clear();
+            skipRest = false;
+
+            if (previous)
+            {
+                lock.unlock();
+                previous();
+                lock.lock();
+            }
+            discardingKey.clear();
+            cond.notify_all();
+
+            runStages(std::move(job.stages), lock);
+            currentState = State::Warm;
+            expireAtMs = nowMs() + config.ttlMs;
+            cond.notify_all();
+            continue;
+        }
+
+        if (currentState == State::Warm && now >= expireAtMs)
+        {
+            discardLocked(lock);
+            continue;
+        }
+
+        int64_t wakeMs = std::numeric_limits<int64_t>::max();
+        if (pending)
+            wakeMs = pending->startAtMs;
+        if (currentState == State::Warm)
+            wakeMs = std::min(wakeMs, expireAtMs);
+
+        if (wakeMs == std::numeric_limits<int64_t>::max())
+            cond.wait(lock);
+        else
+            cond.wait_for(lock, std::chrono::milliseconds(std::max<int64_t>(wakeMs - now, 1)));
+    }
+}
+
+void ConnectPrewarm::runStages(std::vector<Stage> stages, std::unique_lock<std::mutex>& lock)
+{
+    lock.unlock();
+
+    std::vector<Timing> ran;
+    int64_t startMs = nowMs();
+    bool skipping = false;
+    for (Stage& stage : stages)
+    {
+        Timing timing;
+        timing.stage = stage.name;
+        timing.startMs = nowMs() - startMs;
+        if (!skipping && !skipRest)
+        {
+            timing.ran = true;
+            timing.ok = stage.run();
+            timing.durationMs = nowMs() - startMs - timing.startMs;
+            skipping = !timing.ok;
+        }
+        ran.push_back(std::move(timing));
+    }
+
+    lock.lock();
+    timings = std::move(ran);
+}
+
+void ConnectPrewarm::discardLocked(std::unique_lock<std::mutex>& lock)
+{
+    std::function<void()> discard = std::move(currentDiscard);
+    currentDiscard = nullptr;
+    discardingKey = currentKey;
+    currentKey.clear();
+    currentState = State::Idle;
+    timings.clear();
+
+    lock.unlock();
+    if (discard)
+        discard();
+    lock.lock();
+
+    discardingKey.clear();
+    cond.notify_all();
+}
+
+void ConnectPrewarm::waitWhileBusy(const std::string& key, std::unique_lock<std::mutex>& lock)
+{
+    cond.wait(lock, [&] {
+        return discardingKey != key && !(currentKey == key && currentState == State::Running);
+    });
+}
+
+int64_t ConnectPrewarm::nowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,483 @@
+#include "core/connect_timeline.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <format>
+#include <utility>
+
+#include <json-c/json.h>
+
+#include "psn/models.hpp"
+#include "util/file_io.hpp"
+
+static const char* CONNECT_HISTORY_PATH = "sdmc:/switch/akira/connect_history.json";
+static const int HISTORY_VERSION = 1;
+
+static int64_t wallClockMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static json_object* arrayField(json_object* object, const char* key)
+{
+    json_object* field = nullptr;
+    return psn::jsonField(object, key, &field) && json_object_is_type(field, json_type_array) ? field : nullptr;
+}
+
+ConnectHistory::ConnectHistory() : ConnectHistory(Config()) {}
+
+ConnectHistory::ConnectHistory(Config config) : config(config) {}
+
+void ConnectHistory::add(const std::string& host, Attempt attempt)
+{
+    auto it = std::find_if(hosts.begin(), hosts.end(),
+        [&host](const HostAttempts& entry) { return entry.host == host; });
+
+    HostAttempts entry;
+    if (it != hosts.end())
+    {
+        entry = std::move(*it);
+        hosts.erase(it);
+    }
+    else
+    {
+        entry.host = host;
+        if (hosts.size() >= config.maxHosts && !hosts.empty())
+            hosts.erase(hosts.begin());
+    }
+
+    entry.attempts.push_back(std::move(attempt));
+    if (entry.attempts.size() > config.maxAttempts)
+        entry.attempts.erase(entry.attempts.begin(),
+            entry.attempts.begin() + (entry.attempts.size() - config.maxAttempts));
+    hosts.push_back(std::move(entry));
+}
+
+std::vector<ConnectHistory::Attempt> ConnectHistory::attempts(const std::string& host) const
+{
+    for (const HostAttempts& entry : hosts)
+    {
+        if (entry.host == host)
+            return entry.attempts;
+    }
+    return {};
+}
+
+int64_t ConnectHistory::medianFirstFrameMs(const std::string& host, const std::string& path) const
+{
+    std::vector<int64_t> times;
+    for (const Attempt& attempt : attempts(host))
+    {
+        if (attempt.path == path && attempt.firstFrameMs >= 0)
+            times.push_back(attempt.firstFrameMs);
+    }
+    if (times.empty())
+        return -1;
+
+    std::sort(times.begin(), times.end());
+    size_t middle = times.size() / 2;
+    if (times.size() % 2 == 1)
+        return times[middle];
+    return (times[middle - 1] + times[middle]) / 2;
+}
+
+std::string ConnectHistory::toJson() const
+{
+    json_object* root = json_object_new_object();
+    json_object_object_add(root, "version", json_object_new_int(HISTORY_VERSION));
+
+    json_object* hostArray = json_object_new_array();
+    for (const HostAttempts& entry : hosts)
+    {
+        json_object* hostObject = json_object_new_object();
+        json_object_object_add(hostObject, "host", json_object_new_string(entry.host.c_str()));
+
+        json_object* attemptArray = json_object_new_array();
+        for (const Attempt& attempt : entry.attempts)
+        {
+            json_object* attemptObject = json_object_new_object();
+            json_object_object_add(attemptObject, "path", json_object_new_string(attempt.path.c_str()));
+            json_object_object_add(attemptObject, "started_at", json_object_new_int64(attempt.startedAtMs));
+            json_object_object_add(attemptObject, "first_frame_ms", json_object_new_int64(attempt.firstFrameMs));
+            json_object_object_add(attemptObject, "outcome", json_object_new_string(attempt.outcome.c_str()));
+
+            json_object* stageArray = json_object_new_array();
+            for (const ConnectPrewarm::Timing& stage : attempt.stages)
+            {
+                json_object* stageObject = json_object_new_object();
+                json_object_object_add(stageObject, "stage", json_object_new_string(stage.stage.c_str()));
+                json_object_object_add(stageObject, "start_ms", json_object_new_int64(stage.startMs));
+                json_object_object_add(stageObject, "duration_ms", json_object_new_int64(stage.durationMs));
+                json_object_object_add(stageObject, "ok", json_object_new_boolean(stage.ok));
+                json_object_array_add(stageArray, stageObject);
+            }
+            json_object_object_add(attemptObject, "stages", stageArray);
+            json_object_array_add(attemptArray, attemptObject);
+        }
+        json_object_object_add(hostObject, "attempts", attemptArray);
+        json_object_array_add(hostArray, hostObject);
+    }
+    json_object_object_add(root, "hosts", hostArray);
+
+    const char* text = json_object_to_json_string_ext(root, JSON_C_TO_STRING_PRETTY);
+    std::string result = text ? text : "{}";
+    json_object_put(root);
+    return result;
+}
+
+bool ConnectHistory::parse(const std::string& json)
+{
+    hosts.clear();
+
+    json_object* root = json_tokener_parse(json.c_str());
+    if (!root)
+        return false;
+
+    json_object* hostArray = arrayField(root, "hosts");
+    if (psn::jsonInt64(root, "version") != HISTORY_VERSION || !hostArray)
+    {
+        json_object_put(root);
+        return false;
+    }
+
+    for (size_t i = 0; i < json_object_array_length(hostArray); i++)
+    {
+        json_object* hostObject = json_object_array_get_idx(hostArray, i);
+        json_object* attemptArray = arrayField(hostObject, "attempts");
+        std::string host = psn::jsonString(hostObject, "host");
+        if (host.empty() || !attemptArray)
+            continue;
+
+        for (size_t j = 0; j < json_object_array_length(attemptArray); j++)
+        {
+            json_object* attemptObject = json_object_array_get_idx(attemptArray, j);
+            Attempt attempt;
+            attempt.path = psn::jsonString(attemptObject, "path");
+            attempt.startedAtMs = psn::jsonInt64(attemptObject, "started_at");
+            json_object* firstFrame = nullptr;
+            attempt.firstFrameMs = psn::jsonField(attemptObject, "first_frame_ms", &firstFrame)
+                ? psn::jsonInt64(attemptObject, "first_frame_ms") : -1;
+            attempt.outcome = psn::jsonString(attemptObject, "outcome");
+
+            if (json_object* stageArray = arrayField(attemptObject, "stages"))
+            {
+                for (size_t k = 0; k < json_object_array_length(stageArray); k++)
+                {
+                    json_object* stageObject = json_object_array_get_idx(stageArray, k);
+                    ConnectPrewarm::Timing stage;
+                    stage.stage = psn::jsonString(stageObject, "stage");
+                    stage.startMs = psn::jsonInt64(stageObject, "start_ms");
+                    stage.durationMs = psn::jsonInt64(stageObject, "duration_ms");
+                    stage.ok = psn::jsonBool(stageObject, "ok");
+                    stage.ran = true;
+                    attempt.stages.push_back(std::move(stage));
+                }
+            }
+            add(host, std::move(attempt));
+        }
+    }
+
+    json_object_put(root);
+    return true;
+}
+
+ConnectTimeline::Span::Span(ConnectTimeline& timeline, std::string stage)
+    : timeline(timeline)
+    , stage(std::move(stage))
+{
+    timeline.start(this->stage);
+}
+
+ConnectTimeline::Span::~Span()
+{
+    if (!ended)
+        timeline.finish(stage, false);
+}
+
+void ConnectTimeline::Span::done(bool ok)
+{
+    if (ended)
+        return;
+    ended = true;
+    timeline.finish(stage, ok);
+}
+
+ConnectTimeline& ConnectTimeline::shared()
+{
+    static ConnectTimeline instance(Config{CONNECT_HISTORY_PATH, {}});
+    return instance;
+}
+
+ConnectTimeline::ConnectTimeline() : ConnectTimeline(Config()) {}
+
+ConnectTimeline::ConnectTimeline(Config config)
+    : config(config)
+    , filed(config.history)
+{
+}
+
+ConnectTimeline::~ConnectTimeline()
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCond.notify_all();
+    if (worker.joinable())
+        worker.join();
+}
+
+void ConnectTimeline::begin(const std::string& forHost, const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    int64_t now = nowMs();
+    if (open)
+    {
+        if (host == forHost)
+            return;
+        for (const OpenStage& stage : std::vector<OpenStage>(running))
+            closeLocked(stage.name, false, now);
+        attempt.outcome = "superseded";
+        fileLocked();
+    }
+
+    open = true;
+    host = forHost;
+    startMs = now;
+    attempt = ConnectHistory::Attempt();
+    attempt.path = path;
+    attempt.startedAtMs = wallClockMs();
+    running.clear();
+}
+
+void ConnectTimeline::start(const std::string& stage)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!open || ranLocked(stage))
+        return;
+
+    ConnectPrewarm::Timing timing;
+    timing.stage = stage;
+    timing.startMs = nowMs() - startMs;
+    attempt.stages.push_back(std::move(timing));
+    running.push_back({stage, attempt.stages.size() - 1});
+}
+
+void ConnectTimeline::finish(const std::string& stage, bool ok)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (open)
+        closeLocked(stage, ok, nowMs());
+}
+
+void ConnectTimeline::record(const std::string& stage, int64_t stageStartMs, int64_t durationMs, bool ok)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!open || ranLocked(stage))
+        return;
+
+    ConnectPrewarm::Timing timing;
+    timing.stage = stage;
+    timing.startMs = stageStartMs - startMs;
+    timing.durationMs = durationMs;
+    timing.ran = true;
+    timing.ok = ok;
+    attempt.stages.push_back(std::move(timing));
+}
+
+void ConnectTimeline::firstFrame()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!open)
+        return;
+
+    int64_t now = nowMs();
+    for (const OpenStage& stage : std::vector<OpenStage>(running))
+        closeLocked(stage.name, true, now);
+    attempt.firstFrameMs = now - startMs;
+    fileLocked();
+}
+
+void ConnectTimeline::abandon(const std::string& reason)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!open)
+        return;
+
+    int64_t now = nowMs();
+    for (const OpenStage& stage : std::vector<OpenStage>(running))
+        closeLocked(stage.name, false, now);
+    attempt.outcome = reason.empty() ? "abandoned" : reason;
+    fileLocked();
+}
+
+bool ConnectTimeline::active() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return open;
+}
+
+std::string ConnectTimeline::lastSummary() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return lastSummaryText;
+}
+
+std::string ConnectTimeline::exportJson() const
+{
+    waitFiled();
+    std::lock_guard<std::mutex> lock(historyMutex);
+    loadLocked();
+    return filed.toJson();
+}
+
+bool ConnectTimeline::exportTo(const std::string& path) const
+{
+    std::string json = exportJson();
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+    bool written = fwrite(json.data(), 1, json.size(), file) == json.size();
+    return fclose(file) == 0 && written;
+}
+
+ConnectHistory ConnectTimeline::history() const
+{
+    waitFiled();
+    std::lock_guard<std::mutex> lock(historyMutex);
+    loadLocked();
+    return filed;
+}
+
+int64_t ConnectTimeline::nowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool ConnectTimeline::ranLocked(const std::string& stage) const
+{
+    for (const ConnectPrewarm::Timing& timing : attempt.stages)
+    {
+        if (timing.stage == stage)
+            return true;
+    }
+    return false;
+}
+
+void ConnectTimeline::closeLocked(const std::string& stage, bool ok, int64_t now)
+{
+    auto it = std::find_if(running.begin(), running.end(),
+        [&stage](const OpenStage& openStage) { return openStage.name == stage; });
+    if (it == running.end())
+        return;
+
+    ConnectPrewarm::Timing& timing = attempt.stages[it->index];
+    timing.durationMs = now - startMs - timing.startMs;
+    timing.ran = true;
+    timing.ok = ok;
+    running.erase(it);
+}
+
+void ConnectTimeline::fileLocked()
+{
+    std::stable_sort(attempt.stages.begin(), attempt.stages.end(),
+        [](const ConnectPrewarm::Timing& a, const ConnectPrewarm::Timing& b) { return a.startMs < b.startMs; });
+
+    lastSummaryText = summarize(attempt, -1);
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        queue.push_back({++filedSerial, host, std::move(attempt)});
+        if (!worker.joinable())
+            worker = std::thread([this] { run(); });
+    }
+    queueCond.notify_all();
+
+    open = false;
+    running.clear();
+    attempt = ConnectHistory::Attempt();
+}
+
+void ConnectTimeline::run()
+{
+    std::unique_lock<std::mutex> lock(queueMutex);
+    while (true)
+    {
+        queueCond.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (queue.empty())
+            return;
+
+        FileJob job = std::move(queue.front());
+        queue.pop_front();
+        filing = true;
+        lock.unlock();
+
+        int64_t median = -1;
+        bool saved = true;
+        {
+            std::lock_guard<std::mutex> history(historyMutex);
+            loadLocked();
+            filed.add(job.host, job.attempt);
+            median = filed.medianFirstFrameMs(job.host, job.attempt.path);
+            saved = saveLocked();
+        }
+
+        {
+            std::lock_guard<std::mutex> summary(mutex);
+            if (job.serial == filedSerial)
+                lastSummaryText = summarize(job.attempt, median) + (saved ? "" : ", history not saved");
+        }
+
+        lock.lock();
+        filing = false;
+        queueCond.notify_all();
+    }
+}
+
+void ConnectTimeline::waitFiled() const
+{
+    std::unique_lock<std::mutex> lock(queueMutex);
+    queueCond.wait(lock, [this] { return queue.empty() && !filing; });
+}
+
+void ConnectTimeline::loadLocked() const
+{
+    if (loaded)
+        return;
+    loaded = true;
+    if (config.historyPath.empty())
+        return;
+
+    // Also picks up a save that was cut short after the old history was removed.
+    filed.parse(akira::fileio::readAll(config.historyPath));
+}
+
+bool ConnectTimeline::saveLocked() const
+{
+    if (config.historyPath.empty())
+        return true;
+
+    // A failed rename leaves the new history staged for loadLocked() to pick up.
+    return akira::fileio::replace(config.historyPath, filed.toJson());
+}
+
+std::string ConnectTimeline::summarize(const ConnectHistory::Attempt& filedAttempt, int64_t median)
+{
+    std::string text;
+    if (filedAttempt.firstFrameMs >= 0)
+        text = std::format("First frame: {} ms ({})", filedAttempt.firstFrameMs, filedAttempt.path);
+    else
+        text = std::format("No frame ({}): {}", filedAttempt.path, filedAttempt.outcome);
+
+    if (median >= 0)
+        text += std::format("\nMedian here: {} ms", median);
+
+    for (const ConnectPrewarm::Timing& stage : filedAttempt.stages)
+    {
+        text += std::format("\n{:<20.20} +{:<6} {} ms{}", stage.stage, stage.startMs, stage.durationMs,
+                            stage.ok ? "" : " FAILED");
+    }
+    return text;
+}
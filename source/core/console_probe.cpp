@@ -0,0 +1,136 @@
+#include "core/console_probe.hpp"
+
+#include "util/net_wrappers.hpp"
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <string_view>
+
+namespace {
+
+const char* protocolVersion(bool ps5)
+{
+    return ps5 ? "00030010" : "00020020";
+}
+
+int64_t steadyMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+ConsoleProbe::ConsoleProbe() = default;
+
+ConsoleProbe::~ConsoleProbe()
+{
+    if (sock >= 0)
+        close(sock);
+}
+
+std::string ConsoleProbe::searchRequest(bool ps5)
+{
+    return std::format("SRCH * HTTP/1.1\ndevice-discovery-protocol-version:{}\n", protocolVersion(ps5));
+}
+
+std::string ConsoleProbe::wakeRequest(uint64_t credential, bool ps5)
+{
+    return std::format(
+        "WAKEUP * HTTP/1.1\n"
+        "client-type:vr\n"
+        "auth-type:R\n"
+        "model:w\n"
+        "app-type:r\n"
+        "user-credential:{}\n"
+        "device-discovery-protocol-version:{}\n",
+        credential, protocolVersion(ps5));
+}
+
+ConsoleStatus ConsoleProbe::parseReply(const char* data, size_t size)
+{
+    std::string_view reply(data, size);
+    std::string_view status = reply.substr(0, reply.find('\n'));
+    if (!status.starts_with("HTTP/1.1 "))
+        return ConsoleStatus::Unknown;
+
+    status.remove_prefix(9);
+    if (status.starts_with("200"))
+        return ConsoleStatus::Ready;
+    if (status.starts_with("620"))
+        return ConsoleStatus::Standby;
+    return ConsoleStatus::Unknown;
+}
+
+bool ConsoleProbe::ensureSocket()
+{
+    if (sock < 0)
+        sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    return sock >= 0;
+}
+
+bool ConsoleProbe::sendTo(const std::string& addr, uint16_t port, const std::string& packet, uint32_t* resolved)
+{
+    if (!ensureSocket())
+        return false;
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    AddrInfoGuard info;
+    std::string service = std::to_string(port);
+    if (getaddrinfo(addr.c_str(), service.c_str(), &hints, info.ptr()) != 0 || !info.info)
+        return false;
+
+    auto* dest = reinterpret_cast<sockaddr_in*>(info.info->ai_addr);
+    if (resolved)
+        *resolved = dest->sin_addr.s_addr;
+
+    // The console expects the terminating NUL, as chiaki sends it.
+    return sendto(sock, packet.c_str(), packet.size() + 1, 0,
+        info.info->ai_addr, info.info->ai_addrlen) >= 0;
+}
+
+bool ConsoleProbe::sendWake(const std::string& addr, uint16_t port, uint64_t credential, bool ps5)
+{
+    return sendTo(addr, port, wakeRequest(credential, ps5), nullptr);
+}
+
+ConsoleStatus ConsoleProbe::query(const std::string& addr, uint16_t port, bool ps5, int timeoutMs)
+{
+    uint32_t consoleAddr = 0;
+    if (!sendTo(addr, port, searchRequest(ps5), &consoleAddr))
+        return ConsoleStatus::Unknown;
+
+    int64_t deadlineMs = steadyMs() + timeoutMs;
+    for (int64_t now = steadyMs(); now < deadlineMs; now = steadyMs())
+    {
+        pollfd pfd{sock, POLLIN, 0};
+        if (poll(&pfd, 1, static_cast<int>(deadlineMs - now)) <= 0)
+            break;
+
+        char buffer[1024];
+        sockaddr_in from;
+        socklen_t fromLen = sizeof(from);
+        ssize_t received = recvfrom(sock, buffer, sizeof(buffer), 0,
+            reinterpret_cast<sockaddr*>(&from), &fromLen);
+        // Anything else on the socket is a late answer from someone else; keep waiting.
+        if (received <= 0 || from.sin_addr.s_addr != consoleAddr)
+            continue;
+
+        ConsoleStatus status = parseReply(buffer, static_cast<size_t>(received));
+        if (status != ConsoleStatus::Unknown)
+            return status;
+    }
+    return ConsoleStatus::Unknown;
+}
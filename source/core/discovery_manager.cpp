@@ -1,6 +1,7 @@
 #include "core/discovery_manager.hpp"
 #include "core/discovery_sweep.hpp"
 #include "core/settings_manager.hpp"
+#include "core/trophy_manager.hpp"
 
 #include <borealis.hpp>
 #include <ctime>
@@ -9,7 +10,6 @@
 #include <cstring>
 #include <cstdlib>
 #include <cstdint>
-#include <deque>
 #include <vector>
 #include <switch.h>
 
@@ -21,37 +21,33 @@
 
 #include "util/http.hpp"
 #include "util/http_pool.hpp"
+#include "util/log_ring.hpp"
 
-static std::mutex g_discoveryLogMutex;
-static std::deque<std::string> g_discoveryLogLines;
-static std::atomic<uint64_t> g_discoveryLogVersion{0};
-static constexpr size_t DISCOVERY_LOG_MAX_LINES = 300;
+static constexpr auto DISCOVERY_LOG = LogRing::Category::Discovery;
 
 void DiscoveryManager::appendDiscoveryLog(const std::string& line)
 {
-    std::lock_guard<std::mutex> lock(g_discoveryLogMutex);
-    g_discoveryLogLines.push_back(line);
-    while (g_discoveryLogLines.size() > DISCOVERY_LOG_MAX_LINES)
-        g_discoveryLogLines.pop_front();
-    g_discoveryLogVersion.fetch_add(1, std::memory_order_relaxed);
+    LogRing::shared().push(LogRing::Level::Info, DISCOVERY_LOG, line);
 }
 
-uint64_t DiscoveryManager::getDiscoveryLogVersion()
+uint64_t DiscoveryManager::readDiscoveryLog(uint64_t since, std::vector<std::string>& out)
 {
-    return g_discoveryLogVersion.load(std::memory_order_relaxed);
+    std::vector<LogRing::Record> records;
+    uint64_t next = LogRing::shared().readSince(since, DISCOVERY_LOG, records);
+    for (auto& record : records)
+        out.push_back(std::move(record.text));
+    return next;
 }
 
-std::vector<std::string> DiscoveryManager::getDiscoveryLogSnapshot()
+void DiscoveryManager::clearDiscoveryLog()
 {
-    std::lock_guard<std::mutex> lock(g_discoveryLogMutex);
-    return std::vector<std::string>(g_discoveryLogLines.begin(), g_discoveryLogLines.end());
+    LogRing::shared().clear(DISCOVERY_LOG);
 }
 
-void DiscoveryManager::clearDiscoveryLog()
+static int64_t sweepClockMs()
 {
-    std::lock_guard<std::mutex> lock(g_discoveryLogMutex);
-    g_discoveryLogLines.clear();
-    g_discoveryLogVersion.fetch_add(1, std::memory_order_relaxed);
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
 static void discovery_log_cb(ChiakiLogLevel level, const char* msg, void* user)
@@ -74,14 +70,7 @@ static void discovery_log_cb(ChiakiLogLevel level, const char* msg, void* user)
 static void DiscoveryServiceCallback(ChiakiDiscoveryHost* discovered_hosts, size_t hosts_count, void* user)
 {
     DiscoveryManager* dm = static_cast<DiscoveryManager*>(user);
-    std::vector<std::string> liveIds;
-    for (size_t i = 0; i < hosts_count; i++)
-    {
-        dm->discoveryCallback(&discovered_hosts[i]);
-        if (discovered_hosts[i].host_id)
-            liveIds.emplace_back(discovered_hosts[i].host_id);
-    }
-    dm->reconcileDiscoveredHosts(liveIds);
+    dm->applyDiscoveryScan(discovered_hosts, hosts_count);
 }
 
 DiscoveryManager* DiscoveryManager::getInstance()
@@ -199,7 +188,9 @@ void DiscoveryManager::setServiceEnabled(bool enable)
             }
         }
 
-        std::vector<uint32_t> flatTargets;
+        akira::discovery::SweepScheduler::Config sweepConfig;
+        sweepConfig.packetsPerTick = SWEEP_PACKETS_PER_TICK;
+        akira::discovery::SweepScheduler scheduler(sweepConfig);
         std::vector<std::string> labels;
 
         std::string subnetsCfg = settings->getDiscoverySubnets();
@@ -221,25 +212,19 @@ void DiscoveryManager::setServiceEnabled(bool enable)
                 continue;
             }
 
-            uint32_t firstOff = 0;
-            uint32_t lastOff = 0;
-            akira::discovery::sweepHostOffsets(prefix, firstOff, lastOff);
-            for (uint32_t off = firstOff; off <= lastOff && flatTargets.size() < static_cast<size_t>(SWEEP_MAX_TARGETS); off++)
-                flatTargets.push_back(akira::discovery::sweepAddrNet(base, off));
-
-            if (flatTargets.size() >= static_cast<size_t>(SWEEP_MAX_TARGETS))
-                brls::Logger::warning("Discovery: sweep target cap {} reached, remaining hosts skipped", SWEEP_MAX_TARGETS);
+            if (!scheduler.addSubnet(base, prefix)) {
+                brls::Logger::warning("Discovery: sweep host cap {} reached, subnet {} skipped", sweepConfig.maxHosts, token);
+                continue;
+            }
             labels.push_back(akira::discovery::normalizeSweepCidr(token));
             brls::Logger::info("Discovery: added foreign sweep subnet {} ({} hosts)", token, akira::discovery::sweepHostCount(prefix));
         }
 
         {
             std::lock_guard<std::mutex> lk(sweepMutex);
-            sweepTargets = std::move(flatTargets);
+            sweepScheduler = std::move(scheduler);
             sweepSubnetLabels = std::move(labels);
-            liveForeignHosts.clear();
             sweepCurrentTarget.clear();
-            sweepChunkIndex = 0;
         }
 
         options.broadcast_addrs = static_cast<struct sockaddr_storage*>(malloc(targets.size() * sizeof(struct sockaddr_storage)));
@@ -273,7 +258,7 @@ void DiscoveryManager::setServiceEnabled(bool enable)
         bool haveSweep = false;
         {
             std::lock_guard<std::mutex> lk(sweepMutex);
-            haveSweep = !sweepTargets.empty();
+            haveSweep = sweepScheduler.hostCount() > 0;
         }
         if (haveSweep && !sweepEnabled.load())
         {
@@ -317,13 +302,19 @@ void DiscoveryManager::setServiceEnabled(bool enable)
 
         chiaki_discovery_service_fini(&service);
 
+        // Nothing answers while the service is down; an empty scan retires every live host.
+        std::vector<akira::discovery::HostEvent> vanished;
+        {
+            std::lock_guard<std::mutex> lk(registryMutex);
+            vanished = hostRegistry.applyScan({});
+        }
+        publishHostEvents(std::move(vanished));
+
         {
             std::lock_guard<std::mutex> lk(sweepMutex);
-            sweepTargets.clear();
+            sweepScheduler.clear();
             sweepSubnetLabels.clear();
-            liveForeignHosts.clear();
             sweepCurrentTarget.clear();
-            sweepChunkIndex = 0;
         }
     }
 }
@@ -456,124 +447,198 @@ int DiscoveryManager::sendDiscovery()
     return sendDiscovery(hostAddr, hostAddrLen);
 }
 
-void DiscoveryManager::discoveryCallback(ChiakiDiscoveryHost* discoveredHost)
+void DiscoveryManager::applyDiscoveryScan(ChiakiDiscoveryHost* discoveredHosts, size_t count)
 {
-    struct DiscoveredHostData {
-        std::string hostName;
-        std::string hostAddr;
-        std::string hostId;
-        std::string systemVersion;
-        std::string deviceDiscoveryProtocolVersion;
-        ChiakiDiscoveryHostState state;
-        bool hasSystemVersion;
-    };
-
-    auto data = std::make_shared<DiscoveredHostData>();
-    data->hostName = discoveredHost->host_name ? discoveredHost->host_name : "Unknown";
-    data->hostAddr = discoveredHost->host_addr ? discoveredHost->host_addr : "";
-    data->hostId = discoveredHost->host_id ? discoveredHost->host_id : "";
-    data->systemVersion = discoveredHost->system_version ? discoveredHost->system_version : "";
-    data->deviceDiscoveryProtocolVersion = discoveredHost->device_discovery_protocol_version ? discoveredHost->device_discovery_protocol_version : "";
-    data->state = discoveredHost->state;
-    data->hasSystemVersion = discoveredHost->system_version && discoveredHost->device_discovery_protocol_version;
+    std::vector<akira::discovery::HostSighting> scan;
+    scan.reserve(count);
+    int64_t now = sweepClockMs();
 
-    if (!data->hostAddr.empty())
+    for (size_t i = 0; i < count; i++)
     {
+        ChiakiDiscoveryHost* discoveredHost = &discoveredHosts[i];
+        akira::discovery::HostSighting sighting;
+        sighting.hostName = discoveredHost->host_name ? discoveredHost->host_name : "Unknown";
+        sighting.hostAddr = discoveredHost->host_addr ? discoveredHost->host_addr : "";
+        sighting.hostId = discoveredHost->host_id ? discoveredHost->host_id : "";
+        sighting.systemVersion = discoveredHost->system_version ? discoveredHost->system_version : "";
+        sighting.protocolVersion = discoveredHost->device_discovery_protocol_version ? discoveredHost->device_discovery_protocol_version : "";
+        sighting.state = discoveredHost->state;
+        sighting.target = CHIAKI_TARGET_PS4_UNKNOWN;
+        if (discoveredHost->system_version && discoveredHost->device_discovery_protocol_version)
+            sighting.target = chiaki_discovery_host_system_version_target(discoveredHost);
+
         struct in_addr hostIna = {};
-        if (inet_pton(AF_INET, data->hostAddr.c_str(), &hostIna) == 1)
+        if (!sighting.hostAddr.empty() && inet_pton(AF_INET, sighting.hostAddr.c_str(), &hostIna) == 1)
         {
-            uint32_t addrNet = hostIna.s_addr;
-            bool isSweepTarget = false;
-            {
-                std::lock_guard<std::mutex> lk(sweepMutex);
-                for (uint32_t t : sweepTargets)
-                {
-                    if (t == addrNet)
-                    {
-                        isSweepTarget = true;
-                        break;
-                    }
-                }
-            }
-            if (isSweepTarget)
-                noteForeignResponder(addrNet);
+            uint8_t protocols = akira::discovery::SWEEP_BOTH;
+            if (sighting.protocolVersion == CHIAKI_DISCOVERY_PROTOCOL_VERSION_PS5)
+                protocols = akira::discovery::SWEEP_PS5;
+            else if (sighting.protocolVersion == CHIAKI_DISCOVERY_PROTOCOL_VERSION_PS4)
+                protocols = akira::discovery::SWEEP_PS4;
+
+            std::lock_guard<std::mutex> lk(sweepMutex);
+            sweepScheduler.noteResponse(hostIna.s_addr, protocols, now);
         }
-    }
 
-    ChiakiTarget target = CHIAKI_TARGET_PS4_UNKNOWN;
-    if (data->hasSystemVersion)
-    {
-        target = chiaki_discovery_host_system_version_target(discoveredHost);
+        scan.push_back(std::move(sighting));
     }
 
-    brls::Logger::info("--");
-    brls::Logger::info("Discovered Host:");
-    brls::Logger::info("State:                             {}", chiaki_discovery_host_state_string(data->state));
-    if (data->hasSystemVersion)
+    std::vector<akira::discovery::HostEvent> events;
     {
-        brls::Logger::info("System Version:                    {}", data->systemVersion);
-        brls::Logger::info("Device Discovery Protocol Version: {}", data->deviceDiscoveryProtocolVersion);
-        brls::Logger::info("PlayStation ChiakiTarget Version:  {}", static_cast<int>(target));
+        std::lock_guard<std::mutex> lk(registryMutex);
+        events = hostRegistry.applyScan(scan);
     }
-    if (!data->hostAddr.empty())
-    {
-        brls::Logger::info("Host Addr:                         {}", data->hostAddr);
-    }
-    if (!data->hostName.empty())
-    {
-        brls::Logger::info("Host Name:                         {}", data->hostName);
-    }
-    if (!data->hostId.empty())
-    {
-        brls::Logger::info("Host ID:                           {}", data->hostId);
-    }
-    brls::Logger::info("--");
+    publishHostEvents(std::move(events));
+}
 
-    brls::sync([this, data, target]() {
-        auto* hostsMap = settings->getHostsMap();
+void DiscoveryManager::forgetHost(const std::string& hostId, const std::string& hostAddr)
+{
+    std::lock_guard<std::mutex> lk(registryMutex);
+    hostRegistry.forget(hostId, hostAddr);
+}
 
-        Host* host = nullptr;
-        auto it = hostsMap->find(data->hostName);
-        if (it != hostsMap->end()) {
-            host = it->second.get();
-        } else if (!data->hostAddr.empty()) {
-            for (auto& entry : *hostsMap) {
-                if (entry.second && entry.second->getHostAddr() == data->hostAddr) {
-                    host = entry.second.get();
-                    break;
-                }
-            }
+void DiscoveryManager::publishHostEvents(std::vector<akira::discovery::HostEvent> events)
+{
+    if (events.empty())
+        return;
+
+    for (const auto& event : events)
+    {
+        const akira::discovery::HostSighting& data = event.host;
+        if (event.change == akira::discovery::HostChange::Vanished)
+        {
+            brls::Logger::info("Discovery: host '{}' ({}) stopped answering", data.hostName, data.hostAddr);
+            continue;
         }
-        if (!host) {
-            host = settings->getOrCreateHost(data->hostName);
-            host->setHostType(HostType::Auto);
+        if (event.change == akira::discovery::HostChange::Changed)
+        {
+            brls::Logger::info("Discovery: host '{}' ({}) is now {}", data.hostName, data.hostAddr,
+                chiaki_discovery_host_state_string(static_cast<ChiakiDiscoveryHostState>(data.state)));
+            continue;
         }
 
-        host->state = data->state;
-        host->discovered = true;
-
-        if (data->hasSystemVersion)
+        brls::Logger::info("--");
+        brls::Logger::info("Discovered Host:");
+        brls::Logger::info("State:                             {}", chiaki_discovery_host_state_string(static_cast<ChiakiDiscoveryHostState>(data.state)));
+        if (!data.systemVersion.empty() && !data.protocolVersion.empty())
         {
-            host->setChiakiTarget(target);
+            brls::Logger::info("System Version:                    {}", data.systemVersion);
+            brls::Logger::info("Device Discovery Protocol Version: {}", data.protocolVersion);
+            brls::Logger::info("PlayStation ChiakiTarget Version:  {}", data.target);
         }
-
-        if (!data->hostAddr.empty())
+        if (!data.hostAddr.empty())
         {
-            host->hostAddr = data->hostAddr;
+            brls::Logger::info("Host Addr:                         {}", data.hostAddr);
         }
-
-        if (!data->hostId.empty())
+        if (!data.hostName.empty())
+        {
+            brls::Logger::info("Host Name:                         {}", data.hostName);
+        }
+        if (!data.hostId.empty())
         {
-            host->hostId = data->hostId;
+            brls::Logger::info("Host ID:                           {}", data.hostId);
         }
+        brls::Logger::info("--");
+    }
 
-        if (onHostDiscovered)
+    auto batch = std::make_shared<std::vector<akira::discovery::HostEvent>>(std::move(events));
+    brls::sync([this, batch]() {
+        auto* hostsMap = settings->getHostsMap();
+        if (!hostsMap)
+            return;
+
+        bool vanished = false;
+        for (const auto& event : *batch)
         {
-            onHostDiscovered(host);
+            if (event.change == akira::discovery::HostChange::Vanished)
+                vanished = markHostVanished(event.host) || vanished;
+            else
+                updateDiscoveredHost(event.host);
         }
+
+        if (vanished && onHostsChanged)
+            onHostsChanged();
     });
 }
 
+Host* DiscoveryManager::findDiscoveredHost(const akira::discovery::HostSighting& data)
+{
+    auto* hostsMap = settings->getHostsMap();
+
+    auto it = hostsMap->find(data.hostName);
+    if (it != hostsMap->end())
+        return it->second.get();
+
+    if (!data.hostAddr.empty()) {
+        for (auto& entry : *hostsMap) {
+            if (entry.second && entry.second->getHostAddr() == data.hostAddr)
+                return entry.second.get();
+        }
+    }
+    return nullptr;
+}
+
+void DiscoveryManager::updateDiscoveredHost(const akira::discovery::HostSighting& data)
+{
+    Host* host = findDiscoveredHost(data);
+    if (!host) {
+        host = settings->getOrCreateHost(data.hostName);
+        host->setHostType(HostType::Auto);
+    }
+
+    host->state = static_cast<ChiakiDiscoveryHostState>(data.state);
+    host->discovered = true;
+
+    if (!data.systemVersion.empty() && !data.protocolVersion.empty())
+    {
+        host->setChiakiTarget(static_cast<ChiakiTarget>(data.target));
+    }
+
+    if (!data.hostAddr.empty())
+    {
+        host->hostAddr = data.hostAddr;
+    }
+
+    if (!data.hostId.empty())
+    {
+        host->hostId = data.hostId;
+
+        std::lock_guard<std::mutex> lk(registryMutex);
+        hostRegistry.setRemoteDuid(data.hostId, host->getRemoteDuid());
+    }
+
+    if (onHostDiscovered)
+    {
+        onHostDiscovered(host);
+    }
+}
+
+bool DiscoveryManager::markHostVanished(const akira::discovery::HostSighting& data)
+{
+    if (data.hostId.empty())
+        return false;
+
+    auto* hostsMap = settings->getHostsMap();
+    Host* host = nullptr;
+    auto it = hostsMap->find(data.hostName);
+    if (it != hostsMap->end() && it->second && it->second->hostId == data.hostId) {
+        host = it->second.get();
+    } else {
+        for (auto& entry : *hostsMap) {
+            if (entry.second && entry.second->hostId == data.hostId) {
+                host = entry.second.get();
+                break;
+            }
+        }
+    }
+
+    if (!host || host->hasRpKey() || host->isManual() || host->isRemote() || !host->isDiscovered())
+        return false;
+
+    host->discovered = false;
+    return true;
+}
+
 psn::ActionStatus DiscoveryManager::getRemoteRefreshStatus() const
 {
     std::lock_guard<std::mutex> lock(remoteRefreshMutex);
@@ -659,8 +724,20 @@ void DiscoveryManager::fetchRemoteDevicesFromPsn()
         return;
     }
 
+    // Device listing shares the presence budget, away from trophy syncs and cloud play.
+    auto claimBudget = [](const char* console) {
+        std::string reason;
+        if (TrophyManager::getInstance()->claimRequestBudget(BudgetScope::Presence, reason))
+            return true;
+        brls::Logger::warning("Skipping {} remote device listing: {}", console, reason);
+        return false;
+    };
+
     brls::Logger::info("Querying PSN for remote devices...");
 
+    if (!claimBudget("PS5"))
+        return;
+
     ChiakiHolepunchDeviceInfo* ps5Devices = nullptr;
     size_t ps5Count = 0;
     ChiakiErrorCode ps5Err = chiaki_holepunch_list_devices(
@@ -685,6 +762,9 @@ void DiscoveryManager::fetchRemoteDevicesFromPsn()
         brls::Logger::error("Failed to list PS5 devices: {}", chiaki_error_string(ps5Err));
     }
 
+    if (!claimBudget("PS4"))
+        return;
+
     ChiakiHolepunchDeviceInfo* ps4Devices = nullptr;
     size_t ps4Count = 0;
     ChiakiErrorCode ps4Err = chiaki_holepunch_list_devices(
@@ -740,7 +820,21 @@ void DiscoveryManager::processRemoteDevice(ChiakiHolepunchDeviceInfo* device, Ch
         auto* hostsMap = settings->getHostsMap();
         Host* localHost = nullptr;
 
+        // The same console answering on the LAN, if a saved host already links it.
+        akira::discovery::HostSighting live;
+        bool onLan = false;
+        {
+            std::lock_guard<std::mutex> lk(registryMutex);
+            if (const auto* sighting = hostRegistry.findByRemoteDuid(deviceUid))
+            {
+                live = *sighting;
+                onLan = true;
+            }
+        }
+
         auto it = hostsMap->find(deviceName);
+        if (it == hostsMap->end() && onLan)
+            it = hostsMap->find(live.hostName);
         if (it != hostsMap->end() && it->second->hasRpKey() && !it->second->isRemote())
         {
             localHost = it->second.get();
@@ -748,6 +842,9 @@ void DiscoveryManager::processRemoteDevice(ChiakiHolepunchDeviceInfo* device, Ch
             {
                 localHost->setRemoteDuid(deviceUid);
                 brls::Logger::info("Updated local host '{}' with remote DUID", deviceName);
+
+                std::lock_guard<std::mutex> lk(registryMutex);
+                hostRegistry.setRemoteDuid(localHost->hostId, deviceUid);
             }
         }
 
@@ -774,7 +871,7 @@ void DiscoveryManager::processRemoteDevice(ChiakiHolepunchDeviceInfo* device, Ch
             brls::Logger::info("Remote device '{}' needs linking to a local host", deviceName);
         }
 
-        host->state = CHIAKI_DISCOVERY_HOST_STATE_UNKNOWN;
+        host->state = onLan ? static_cast<ChiakiDiscoveryHostState>(live.state) : CHIAKI_DISCOVERY_HOST_STATE_UNKNOWN;
 
         settings->writeFile();
 
@@ -840,16 +937,11 @@ void DiscoveryManager::runSweepLoop()
         return;
     }
 
-    int tick = 0;
     err = chiaki_bool_pred_cond_timedwait(&sweepStopCond, 2000);
 
     while (err == CHIAKI_ERR_TIMEOUT && sweepEnabled.load())
     {
-        pingLiveForeignHosts();
-        if (tick % SWEEP_SCAN_EVERY_TICKS == 0)
-            sendSweepChunk();
-        tick++;
-
+        sendSweepProbes();
         err = chiaki_bool_pred_cond_timedwait(&sweepStopCond, SWEEP_TICK_MS);
     }
 
@@ -857,7 +949,7 @@ void DiscoveryManager::runSweepLoop()
     brls::Logger::info("Discovery sweep loop exiting");
 }
 
-void DiscoveryManager::pingHostAddrNet(uint32_t addrNet)
+void DiscoveryManager::pingHostAddrNet(uint32_t addrNet, uint8_t protocols)
 {
     struct in_addr ina = {};
     ina.s_addr = addrNet;
@@ -876,64 +968,35 @@ void DiscoveryManager::pingHostAddrNet(uint32_t addrNet)
     memset(&packet, 0, sizeof(packet));
     packet.cmd = CHIAKI_DISCOVERY_CMD_SRCH;
 
-    packet.protocol_version = const_cast<char*>(CHIAKI_DISCOVERY_PROTOCOL_VERSION_PS4);
-    dst.sin_port = htons(CHIAKI_DISCOVERY_PORT_PS4);
-    chiaki_discovery_send(&service.discovery, &packet, reinterpret_cast<struct sockaddr*>(&dst), sizeof(dst));
-
-    packet.protocol_version = const_cast<char*>(CHIAKI_DISCOVERY_PROTOCOL_VERSION_PS5);
-    dst.sin_port = htons(CHIAKI_DISCOVERY_PORT_PS5);
-    chiaki_discovery_send(&service.discovery, &packet, reinterpret_cast<struct sockaddr*>(&dst), sizeof(dst));
-}
-
-void DiscoveryManager::pingLiveForeignHosts()
-{
-    std::vector<uint32_t> hosts;
+    if (protocols & akira::discovery::SWEEP_PS4)
     {
-        std::lock_guard<std::mutex> lk(sweepMutex);
-        hosts = liveForeignHosts;
+        packet.protocol_version = const_cast<char*>(CHIAKI_DISCOVERY_PROTOCOL_VERSION_PS4);
+        dst.sin_port = htons(CHIAKI_DISCOVERY_PORT_PS4);
+        chiaki_discovery_send(&service.discovery, &packet, reinterpret_cast<struct sockaddr*>(&dst), sizeof(dst));
     }
-    for (uint32_t addr : hosts)
+
+    if (protocols & akira::discovery::SWEEP_PS5)
     {
-        if (!sweepEnabled.load())
-            return;
-        pingHostAddrNet(addr);
+        packet.protocol_version = const_cast<char*>(CHIAKI_DISCOVERY_PROTOCOL_VERSION_PS5);
+        dst.sin_port = htons(CHIAKI_DISCOVERY_PORT_PS5);
+        chiaki_discovery_send(&service.discovery, &packet, reinterpret_cast<struct sockaddr*>(&dst), sizeof(dst));
     }
 }
 
-void DiscoveryManager::noteForeignResponder(uint32_t addrNet)
+void DiscoveryManager::sendSweepProbes()
 {
-    std::lock_guard<std::mutex> lk(sweepMutex);
-    for (uint32_t existing : liveForeignHosts)
+    std::vector<akira::discovery::SweepProbe> probes;
     {
-        if (existing == addrNet)
-            return;
+        std::lock_guard<std::mutex> lk(sweepMutex);
+        probes = sweepScheduler.next(sweepClockMs());
     }
-    if (liveForeignHosts.size() >= static_cast<size_t>(SWEEP_MAX_TARGETS))
-        return;
-    liveForeignHosts.push_back(addrNet);
-}
 
-void DiscoveryManager::sendSweepChunk()
-{
-    std::vector<uint32_t> targets;
-    size_t chunk = 0;
+    for (const akira::discovery::SweepProbe& probe : probes)
     {
-        std::lock_guard<std::mutex> lk(sweepMutex);
-        if (sweepTargets.empty())
+        if (!sweepEnabled.load())
             return;
-        int numChunks = akira::discovery::sweepChunkCount(static_cast<int>(sweepTargets.size()), SWEEP_CHUNK);
-        chunk = sweepChunkIndex;
-        sweepChunkIndex = (sweepChunkIndex + 1) % (numChunks > 0 ? static_cast<size_t>(numChunks) : 1);
-        targets = sweepTargets;
+        pingHostAddrNet(probe.addrNet, probe.protocols);
     }
-
-    size_t startIdx = chunk * SWEEP_CHUNK;
-    size_t endIdx = startIdx + SWEEP_CHUNK;
-    if (endIdx > targets.size())
-        endIdx = targets.size();
-
-    for (size_t i = startIdx; i < endIdx && sweepEnabled.load(); i++)
-        pingHostAddrNet(targets[i]);
 }
 
 DiscoveryManager::SweepStatus DiscoveryManager::getSweepStatus()
@@ -946,44 +1009,3 @@ DiscoveryManager::SweepStatus DiscoveryManager::getSweepStatus()
     s.currentTarget = sweepCurrentTarget;
     return s;
 }
-
-void DiscoveryManager::reconcileDiscoveredHosts(const std::vector<std::string>& liveIds)
-{
-    auto ids = std::make_shared<std::vector<std::string>>(liveIds);
-    brls::sync([this, ids]() {
-        auto* hostsMap = settings->getHostsMap();
-        if (!hostsMap)
-            return;
-
-        bool changed = false;
-        for (auto& entry : *hostsMap)
-        {
-            Host* host = entry.second.get();
-            if (!host)
-                continue;
-            if (host->hasRpKey() || host->isManual() || host->isRemote())
-                continue;
-            if (!host->isDiscovered())
-                continue;
-
-            bool present = false;
-            for (const auto& id : *ids)
-            {
-                if (!id.empty() && id == host->hostId)
-                {
-                    present = true;
-                    break;
-                }
-            }
-
-            if (!present)
-            {
-                host->discovered = false;
-                changed = true;
-            }
-        }
-
-        if (changed && onHostsChanged)
-            onHostsChanged();
-    });
-}
@@ -2,16 +2,60 @@
 #include "stream/session.hpp"
 #include "core/exception.hpp"
 #include "core/settings_manager.hpp"
+#include "core/stun_client.hpp"
 #include "core/wireguard_manager.hpp"
+#include "core/connect_timeline.hpp"
+#include "psn/auth.hpp"
+#include "util/http.hpp"
+#include "util/net_wrappers.hpp"
 
 #include <borealis.hpp>
 #include <cstring>
 #include <format>
+#include <optional>
 #include <thread>
 #include <chrono>
+#include <netdb.h>
+#include <sys/socket.h>
 
 #include <chiaki/base64.h>
 
+// Refresh the PSN token while prewarming when it would expire this soon anyway.
+static const int64_t PREWARM_TOKEN_WINDOW_S = 300;
+
+// Where chiaki's holepunch goes for the PSN session and its push notifications. It keeps
+// its own curl handles, so the most a prewarm can do is put these in the resolver's cache.
+static const char* HOLEPUNCH_PSN_HOSTS[] = {
+    "web.np.playstation.com",
+    "mobile-pushcl.np.communication.playstation.com",
+};
+
+static int64_t steadyMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool resolveHolepunchHosts()
+{
+    bool resolved = true;
+    for (const char* name : HOLEPUNCH_PSN_HOSTS)
+    {
+        struct addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+
+        AddrInfoGuard info;
+        if (getaddrinfo(name, "443", &hints, info.ptr()) != 0 || !info.info)
+        {
+            brls::Logger::warning("Prewarm: could not resolve {}", name);
+            resolved = false;
+        }
+    }
+    return resolved;
+}
+
 static void InitAudioCallback(unsigned int channels, unsigned int rate, void* user)
 {
     Session* session = static_cast<Session*>(user);
@@ -63,12 +107,23 @@ Host::Host(const std::string& name)
 
 Host::~Host()
 {
+    ConnectPrewarm::shared().forget(prewarmKey());
+
     if (sessionInit)
     {
         finiSession();
     }
 }
 
+std::string Host::connectPath() const
+{
+    if (isCloud())
+        return "cloud";
+    if (isRemote())
+        return "holepunch";
+    return WireGuardManager::instance().isConnected() ? "vpn" : "lan";
+}
+
 bool Host::isPS5() const
 {
     return target >= CHIAKI_TARGET_PS5_UNKNOWN;
@@ -193,20 +248,8 @@ int Host::wakeup()
     if (wg.isConnected())
     {
         brls::Logger::info("Host::wakeup: sending via WireGuard tunnel");
-        const char* version = isPS5() ? "00030010" : "00020020";
-        uint16_t port = isPS5() ? 9302 : 987;
-
-        auto buf = std::format(
-            "WAKEUP * HTTP/1.1\n"
-            "client-type:vr\n"
-            "auth-type:R\n"
-            "model:w\n"
-            "app-type:r\n"
-            "user-credential:{}\n"
-            "device-discovery-protocol-version:{}\n",
-            credential, version);
-
-        int result = wg.sendUdpPacket(hostAddr, port, buf.data(), buf.size() + 1);
+        std::string buf = ConsoleProbe::wakeRequest(credential, isPS5());
+        int result = wg.sendUdpPacket(hostAddr, ConsoleProbe::discoveryPort(isPS5()), buf.data(), buf.size() + 1);
         brls::Logger::info("Host::wakeup: sendUdpPacket returned {}", result);
         return result >= 0 ? 0 : 1;
     }
@@ -215,6 +258,25 @@ int Host::wakeup()
     return ret;
 }
 
+WakePipeline::Ops Host::wakePipelineOps(ConsoleProbe& probe)
+{
+    WakePipeline::Ops ops;
+    ops.wake = [this] { return wakeup() == 0; };
+    ops.poll = [this, &probe](int timeoutMs) {
+        // The tunnel is userspace, so a plain socket cannot reach the console through it;
+        // discovery's own pings over the tunnel keep state current instead.
+        if (WireGuardManager::instance().isConnected())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+            if (state == CHIAKI_DISCOVERY_HOST_STATE_READY)
+                return ConsoleStatus::Ready;
+            return state == CHIAKI_DISCOVERY_HOST_STATE_STANDBY ? ConsoleStatus::Standby : ConsoleStatus::Unknown;
+        }
+        return probe.query(hostAddr, ConsoleProbe::discoveryPort(isPS5()), isPS5(), timeoutMs);
+    };
+    return ops;
+}
+
 void Host::applyRegistrationData(ChiakiRegisteredHost* regHost)
 {
     if (!regHost) return;
@@ -457,6 +519,7 @@ int Host::initSession(Session* streamSession)
 
 int Host::initSessionWithHolepunch(Session* streamSession, ChiakiHolepunchSession holepunch)
 {
+    ConnectTimeline::Span initSpan(ConnectTimeline::shared(), "session init");
     bool cloud = isCloud();
     ChiakiVideoResolutionPreset resolution;
     ChiakiVideoFPSPreset fps;
@@ -489,6 +552,7 @@ int Host::initSessionWithHolepunch(Session* streamSession, ChiakiHolepunchSessio
         chiaki_connect_video_profile_preset(&videoProfile, resolution, fps);
         videoProfile.bitrate = settings->getVpnVideoBitrate();
         brls::Logger::info("Host::initSession: WireGuard connected, starting relays to {} (PS5:{})", hostAddr, isPS5());
+        ConnectTimeline::Span relays(ConnectTimeline::shared(), "wireguard relays");
         uint16_t tcpPort = wg.startTcpRelay(hostAddr, 9295, 9295);
         uint16_t udp9295Port = wg.startUdpRelay(hostAddr, 9295, 9295);
         uint16_t udp9296Port = wg.startUdpRelay(hostAddr, 9296, 9296);
@@ -503,6 +567,7 @@ int Host::initSessionWithHolepunch(Session* streamSession, ChiakiHolepunchSessio
             success = success && udp987Port;
             brls::Logger::info("Host::initSession: PS4 relays TCP:{} UDP987:{} UDP9295:{} UDP9296:{} UDP9297:{}", tcpPort, udp987Port, udp9295Port, udp9296Port, udp9297Port);
         }
+        relays.done(success);
         if (success) {
             effectiveHost = "127.0.0.1";
             brls::Logger::info("Host::initSession: All relays started, using {}", effectiveHost);
@@ -588,15 +653,19 @@ int Host::initSessionWithHolepunch(Session* streamSession, ChiakiHolepunchSessio
 
     connectInfo.ps5 = isPS5();
 
+    ConnectTimeline::Span decoderInit(ConnectTimeline::shared(), "decoder init");
     if (!streamSession->InitAVCodec(isPS5(), connectInfo.video_profile.width, connectInfo.video_profile.height))
     {
         throw Exception("Failed to initiate libav codec");
     }
+    decoderInit.done();
 
+    ConnectTimeline::Span rendererInit(ConnectTimeline::shared(), "renderer init");
     if (!streamSession->InitVideo(connectInfo.video_profile.width, connectInfo.video_profile.height))
     {
         throw Exception("Failed to initiate video");
     }
+    rendererInit.done();
 
     if (cloud && cloudSession)
     {
@@ -633,6 +702,7 @@ int Host::initSessionWithHolepunch(Session* streamSession, ChiakiHolepunchSessio
     if (holepunch)
     {
         holepunchSession = nullptr;
+        upnpReady = false;
     }
 
     sessionInit = true;
@@ -652,6 +722,7 @@ int Host::initSessionWithHolepunch(Session* streamSession, ChiakiHolepunchSessio
 
     chiaki_controller_state_set_idle(&controllerState);
 
+    initSpan.done();
     return 0;
 }
 
@@ -697,9 +768,12 @@ void Host::gotoBed()
 void Host::startSession()
 {
     brls::Logger::info("Starting chiaki session...");
+    // Ends when the console's CTRL and Takion handshakes are through (CHIAKI_EVENT_CONNECTED).
+    ConnectTimeline::shared().start("takion handshake");
     ChiakiErrorCode err = chiaki_session_start(&session);
     if (err != CHIAKI_ERR_SUCCESS)
     {
+        ConnectTimeline::shared().finish("takion handshake", false);
         brls::Logger::error("chiaki_session_start failed with error: {}", chiaki_error_string(err));
         sessionInit = false;
         chiaki_session_fini(&session);
@@ -745,6 +819,8 @@ void Host::connectionEventCallback(ChiakiEvent* event)
     {
         case CHIAKI_EVENT_CONNECTED:
             brls::Logger::info("EventCB CHIAKI_EVENT_CONNECTED");
+            ConnectTimeline::shared().finish("takion handshake");
+            ConnectTimeline::shared().start("first idr");
             if (onConnected)
             {
                 onConnected();
@@ -770,6 +846,7 @@ void Host::connectionEventCallback(ChiakiEvent* event)
 
         case CHIAKI_EVENT_QUIT:
             brls::Logger::info("EventCB CHIAKI_EVENT_QUIT");
+            ConnectTimeline::shared().abandon(chiaki_quit_reason_string(event->quit.reason));
             if (onQuit)
             {
                 onQuit(&event->quit);
@@ -866,36 +943,120 @@ ChiakiErrorCode Host::initHolepunchSession()
     }
 
     holepunchSession = chiaki_holepunch_session_init(accessToken.c_str(), log);
+    upnpReady = false;
     if (!holepunchSession)
     {
         brls::Logger::error("Failed to initialize holepunch session");
         return CHIAKI_ERR_MEMORY;
     }
 
-    if (settings->getPortGuessing())
+    applyPortGuessing();
+
+    brls::Logger::info("Holepunch session initialized for {}", hostName);
+    return CHIAKI_ERR_SUCCESS;
+}
+
+void Host::applyPortGuessing()
+{
+    // Port guessing is what gets through a symmetric NAT; turn it on when this network
+    // was last classified as one, even if the setting is off.
+    bool portGuessing = settings->getPortGuessing();
+    if (!portGuessing)
+    {
+        std::optional<StunResult> nat = StunClient::cachedResult();
+        if (nat && (nat->type == NATType::Symmetric || nat->type == NATType::SymmetricPortOnly))
+        {
+            brls::Logger::info("Known {} on this network, guessing ports", StunClient::natTypeToString(nat->type));
+            portGuessing = true;
+        }
+    }
+
+    if (portGuessing)
     {
         chiaki_holepunch_session_force_port_guessing(holepunchSession, true);
         chiaki_holepunch_session_set_port_guessing_ports(holepunchSession, settings->getPortGuessingCount());
         chiaki_holepunch_session_set_port_guessing_socks(holepunchSession, settings->getPortGuessingSocks());
         brls::Logger::info("Port guessing enabled: {} guesses, {} sockets", settings->getPortGuessingCount(), settings->getPortGuessingSocks());
     }
+}
 
-    brls::Logger::info("Holepunch session initialized for {}", hostName);
+ChiakiErrorCode Host::discoverUpnp()
+{
+    ChiakiErrorCode err = chiaki_holepunch_upnp_discover(holepunchSession);
+    if (err != CHIAKI_ERR_SUCCESS)
+    {
+        brls::Logger::warning("UPNP discovery failed (non-fatal): {}", chiaki_error_string(err));
+        return err;
+    }
+    brls::Logger::info("UPNP discovery completed");
+    upnpReady = true;
     return CHIAKI_ERR_SUCCESS;
 }
 
-ChiakiErrorCode Host::connectHolepunch()
+std::string Host::prewarmKey() const
 {
-    bool retryEnabled = SettingsManager::getInstance()->getHolepunchRetry();
-    const int maxRetries = retryEnabled ? 4 : 1;
-    ChiakiErrorCode err = CHIAKI_ERR_UNKNOWN;
+    return std::format("{}", static_cast<const void*>(this));
+}
 
+void Host::prewarmConnect()
+{
+    if (!isRemote() || needsLinking || !hasRpKey() || remoteDuid.empty())
+        return;
+
+    // A connect or a session started from this host owns its holepunch session until it
+    // is cleaned up; a prewarm now could re-run UPnP on it or fini it when it expires.
+    std::lock_guard<std::mutex> lock(prewarmMutex);
+    if (holepunchClaimed.load())
+        return;
+
+    // Everything here is either local or reversible: no PSN session is created, so the
+    // console never hears about a connect the user did not make.
+    std::vector<ConnectPrewarm::Stage> stages = {
+        {"psn token", [] {
+            HttpSession http;
+            psn::Auth& auth = psn::Auth::instance();
+            return auth.ensureSession(http, auth.needsProactiveRefresh(PREWARM_TOKEN_WINDOW_S)).ok();
+        }},
+        {"holepunch session", [this] { return initHolepunchSession() == CHIAKI_ERR_SUCCESS; }},
+        // Plenty of gateways have no UPnP; the stages after this one still help.
+        {"upnp", [this] { discoverUpnp(); return true; }},
+        {"dns", [] { return resolveHolepunchHosts(); }},
+        {"nat type", [this] {
+            if (!StunClient::cachedResult())
+            {
+                StunClient::detectNATType();
+                applyPortGuessing();
+            }
+            return true;
+        }},
+    };
+    ConnectPrewarm::shared().focus(prewarmKey(), std::move(stages), [this] { releaseHolepunch(); });
+}
+
+void Host::cancelPrewarm()
+{
+    ConnectPrewarm::shared().blur(prewarmKey());
+}
+
+ChiakiErrorCode Host::connectHolepunch()
+{
     if (remoteDuid.empty())
     {
         brls::Logger::error("No remote DUID available for holepunch");
         return CHIAKI_ERR_INVALID_DATA;
     }
 
+    {
+        std::lock_guard<std::mutex> lock(prewarmMutex);
+        holepunchClaimed.store(true);
+    }
+
+    // Whatever the prewarm finished while the tile had focus is ours now; the stages
+    // below skip it.
+    std::optional<std::vector<ConnectPrewarm::Timing>> prewarmed = ConnectPrewarm::shared().claim(prewarmKey());
+    if (prewarmed)
+        brls::Logger::info("Holepunch for {} prewarmed: {}", hostName, ConnectPrewarm::summary(*prewarmed));
+
     size_t duidLen = remoteDuid.size();
     size_t duidBytesLen = duidLen / 2;
     uint8_t duidBytes[32] = {0};
@@ -909,33 +1070,61 @@ ChiakiErrorCode Host::connectHolepunch()
         }
     }
 
+    connectTimings.clear();
+    int64_t startMs = steadyMs();
+    ChiakiErrorCode err = punchHoleWithRetries(duidBytes, startMs);
+    brls::Logger::info("Holepunch for {} {} after {} ms: {}", hostName,
+        err == CHIAKI_ERR_SUCCESS ? "connected" : "failed", steadyMs() - startMs,
+        ConnectPrewarm::summary(connectTimings));
+
+    ConnectTimeline& timeline = ConnectTimeline::shared();
+    timeline.record("holepunch", startMs, steadyMs() - startMs, err == CHIAKI_ERR_SUCCESS);
+    for (const ConnectPrewarm::Timing& timing : connectTimings)
+    {
+        if (timing.ran)
+            timeline.record(timing.stage, startMs + timing.startMs, timing.durationMs, timing.ok);
+    }
+    return err;
+}
+
+ChiakiErrorCode Host::punchHoleWithRetries(const uint8_t* duidBytes, int64_t startMs)
+{
+    bool retryEnabled = SettingsManager::getInstance()->getHolepunchRetry();
+    const int maxRetries = retryEnabled ? 4 : 1;
+    ChiakiErrorCode err = CHIAKI_ERR_UNKNOWN;
+
     ChiakiHolepunchConsoleType consoleType = isPS5() ?
         CHIAKI_HOLEPUNCH_CONSOLE_TYPE_PS5 : CHIAKI_HOLEPUNCH_CONSOLE_TYPE_PS4;
 
-    for (int attempt = 1; attempt <= maxRetries; attempt++)
-    {
-        if (!holepunchSession)
+    auto timed = [&](const char* stage, bool needed, const std::function<ChiakiErrorCode()>& step) {
+        ConnectPrewarm::Timing timing;
+        timing.stage = stage;
+        timing.startMs = steadyMs() - startMs;
+        ChiakiErrorCode result = CHIAKI_ERR_SUCCESS;
+        if (needed)
         {
-            err = initHolepunchSession();
-            if (err != CHIAKI_ERR_SUCCESS)
-                return err;
+            timing.ran = true;
+            result = step();
+            timing.durationMs = steadyMs() - startMs - timing.startMs;
+            timing.ok = result == CHIAKI_ERR_SUCCESS;
         }
+        connectTimings.push_back(timing);
+        return result;
+    };
+
+    for (int attempt = 1; attempt <= maxRetries; attempt++)
+    {
+        err = timed("holepunch session", !holepunchSession, [this] { return initHolepunchSession(); });
+        if (err != CHIAKI_ERR_SUCCESS)
+            return err;
 
         brls::Logger::info("Starting holepunch connection sequence for {} ({}) - attempt {}/{}",
             hostName, isPS5() ? "PS5" : "PS4", attempt, maxRetries);
 
-        err = chiaki_holepunch_upnp_discover(holepunchSession);
-        if (err != CHIAKI_ERR_SUCCESS)
-        {
-            brls::Logger::warning("UPNP discovery failed (non-fatal): {}", chiaki_error_string(err));
-        }
-        else
-        {
-            brls::Logger::info("UPNP discovery completed");
-        }
+        timed("upnp", !upnpReady, [this] { return discoverUpnp(); });
 
         brls::Logger::info("Creating holepunch session on PSN...");
-        err = chiaki_holepunch_session_create(holepunchSession);
+        err = timed("psn session", true, [this] { return chiaki_holepunch_session_create(holepunchSession); });
         if (err != CHIAKI_ERR_SUCCESS)
         {
             brls::Logger::error("Failed to create holepunch session: {}", chiaki_error_string(err));
@@ -944,7 +1133,7 @@ ChiakiErrorCode Host::connectHolepunch()
         brls::Logger::info("Holepunch session created on PSN");
 
         brls::Logger::info("Creating CTRL offer...");
-        err = holepunch_session_create_offer(holepunchSession);
+        err = timed("ctrl offer", true, [this] { return holepunch_session_create_offer(holepunchSession); });
         if (err != CHIAKI_ERR_SUCCESS)
         {
             brls::Logger::error("Failed to create CTRL offer: {}", chiaki_error_string(err));
@@ -953,7 +1142,9 @@ ChiakiErrorCode Host::connectHolepunch()
         brls::Logger::info("CTRL offer created");
 
         brls::Logger::info("Starting holepunch session for device...");
-        err = chiaki_holepunch_session_start(holepunchSession, duidBytes, consoleType);
+        err = timed("session start", true, [&] {
+            return chiaki_holepunch_session_start(holepunchSession, duidBytes, consoleType);
+        });
         if (err != CHIAKI_ERR_SUCCESS)
         {
             brls::Logger::error("Failed to start holepunch session: {}", chiaki_error_string(err));
@@ -962,7 +1153,9 @@ ChiakiErrorCode Host::connectHolepunch()
         brls::Logger::info("Holepunch session started for device");
 
         brls::Logger::info("Punching CTRL hole...");
-        err = chiaki_holepunch_session_punch_hole(holepunchSession, CHIAKI_HOLEPUNCH_PORT_TYPE_CTRL);
+        err = timed("ctrl punch", true, [this] {
+            return chiaki_holepunch_session_punch_hole(holepunchSession, CHIAKI_HOLEPUNCH_PORT_TYPE_CTRL);
+        });
         if (err == CHIAKI_ERR_SUCCESS)
         {
             brls::Logger::info("CTRL hole punched successfully!");
@@ -975,7 +1168,7 @@ ChiakiErrorCode Host::connectHolepunch()
         {
             int delaySeconds = attempt * 3;
             brls::Logger::warning("Holepunch attempt {}/{} failed, retrying in {} seconds...", attempt, maxRetries, delaySeconds);
-            cleanupHolepunch();
+            releaseHolepunch();
             std::this_thread::sleep_for(std::chrono::seconds(delaySeconds));
             continue;
         }
@@ -996,6 +1189,12 @@ void Host::cancelHolepunch()
 }
 
 void Host::cleanupHolepunch()
+{
+    releaseHolepunch();
+    holepunchClaimed.store(false);
+}
+
+void Host::releaseHolepunch()
 {
     if (holepunchSession)
     {
@@ -1003,4 +1202,5 @@ void Host::cleanupHolepunch()
         chiaki_holepunch_session_fini(holepunchSession);
         holepunchSession = nullptr;
     }
+    upnpReady = false;
 }
@@ -0,0 +1,159 @@
+#include "core/host_registry.hpp"
+
+namespace akira::discovery {
+
+std::vector<HostEvent> HostRegistry::applyScan(const std::vector<HostSighting>& scan)
+{
+    std::vector<HostEvent> appeared;
+    std::vector<HostEvent> changed;
+    uint64_t serial = ++scanCounter;
+    size_t seen = 0;
+
+    for (const HostSighting& sighting : scan)
+    {
+        const std::string& key = keyOf(sighting);
+        if (key.empty())
+            continue;
+
+        auto [it, inserted] = hosts.try_emplace(key);
+        Entry& entry = it->second;
+        if (entry.lastScan != serial)
+            seen++;
+        entry.lastScan = serial;
+
+        if (inserted)
+        {
+            entry.host = sighting;
+            entry.generation = ++generationCounter;
+            if (!sighting.hostAddr.empty())
+                byAddr[sighting.hostAddr] = key;
+            appeared.push_back({HostChange::Appeared, sighting, entry.generation});
+            continue;
+        }
+
+        if (entry.host == sighting)
+            continue;
+
+        if (entry.host.hostAddr != sighting.hostAddr)
+        {
+            auto old = byAddr.find(entry.host.hostAddr);
+            if (old != byAddr.end() && old->second == key)
+                byAddr.erase(old);
+            if (!sighting.hostAddr.empty())
+                byAddr[sighting.hostAddr] = key;
+        }
+        entry.host = sighting;
+        entry.generation = ++generationCounter;
+        changed.push_back({HostChange::Changed, sighting, entry.generation});
+    }
+
+    std::vector<HostEvent> events = std::move(appeared);
+    events.insert(events.end(), changed.begin(), changed.end());
+
+    // Everything live answered: nothing can have vanished.
+    if (seen == hosts.size())
+        return events;
+
+    for (auto it = hosts.begin(); it != hosts.end();)
+    {
+        if (it->second.lastScan == serial)
+        {
+            ++it;
+            continue;
+        }
+        events.push_back({HostChange::Vanished, it->second.host, ++generationCounter});
+        unindex(it->first, it->second);
+        it = hosts.erase(it);
+    }
+    return events;
+}
+
+const HostSighting* HostRegistry::find(const std::string& hostId) const
+{
+    auto it = hosts.find(hostId);
+    return it == hosts.end() ? nullptr : &it->second.host;
+}
+
+const HostSighting* HostRegistry::findByAddr(const std::string& hostAddr) const
+{
+    return lookup(byAddr, hostAddr);
+}
+
+const HostSighting* HostRegistry::findByRemoteDuid(const std::string& duid) const
+{
+    return lookup(byRemoteDuid, duid);
+}
+
+void HostRegistry::setRemoteDuid(const std::string& hostId, const std::string& duid)
+{
+    auto it = hosts.find(hostId);
+    if (it == hosts.end() || it->second.remoteDuid == duid)
+        return;
+
+    auto old = byRemoteDuid.find(it->second.remoteDuid);
+    if (old != byRemoteDuid.end() && old->second == hostId)
+        byRemoteDuid.erase(old);
+
+    it->second.remoteDuid = duid;
+    if (!duid.empty())
+        byRemoteDuid[duid] = hostId;
+}
+
+uint64_t HostRegistry::generationOf(const std::string& hostId) const
+{
+    auto it = hosts.find(hostId);
+    return it == hosts.end() ? 0 : it->second.generation;
+}
+
+bool HostRegistry::forget(const std::string& hostId, const std::string& hostAddr)
+{
+    auto it = hosts.find(hostId.empty() ? hostAddr : hostId);
+    if (hostId.empty() && it == hosts.end())
+    {
+        auto addr = byAddr.find(hostAddr);
+        if (addr != byAddr.end())
+            it = hosts.find(addr->second);
+    }
+    if (it == hosts.end())
+        return false;
+
+    unindex(it->first, it->second);
+    hosts.erase(it);
+    generationCounter++;
+    return true;
+}
+
+void HostRegistry::clear()
+{
+    hosts.clear();
+    byAddr.clear();
+    byRemoteDuid.clear();
+    generationCounter++;
+}
+
+const std::string& HostRegistry::keyOf(const HostSighting& host)
+{
+    return host.hostId.empty() ? host.hostAddr : host.hostId;
+}
+
+const HostSighting* HostRegistry::lookup(const std::unordered_map<std::string, std::string>& index,
+    const std::string& value) const
+{
+    auto it = index.find(value);
+    if (it == index.end())
+        return nullptr;
+    return find(it->second);
+}
+
+void HostRegistry::unindex(const std::string& key, const Entry& entry)
+{
+    auto addr = byAddr.find(entry.host.hostAddr);
+    if (addr != byAddr.end() && addr->second == key)
+        byAddr.erase(addr);
+
+    auto duid = byRemoteDuid.find(entry.remoteDuid);
+    if (duid != byRemoteDuid.end() && duid->second == key)
+        byRemoteDuid.erase(duid);
+}
+
+} // namespace akira::discovery
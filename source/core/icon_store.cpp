@@ -0,0 +1,550 @@
+#include "core/icon_store.hpp"
+
+#include <cstring>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+static uint32_t checksumOf(const std::string& key, const uint8_t* data, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : key)
+    {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static bool fileExists(const std::string& path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+template <typename T>
+static void appendRaw(std::string& out, T value)
+{
+    char raw[sizeof(T)];
+    std::memcpy(raw, &value, sizeof(T));
+    out.append(raw, sizeof(T));
+}
+
+template <typename T>
+static T readRaw(const char* at)
+{
+    T value;
+    std::memcpy(&value, at, sizeof(T));
+    return value;
+}
+
+IconStore::IconStore(std::string directory, size_t capacityBytes)
+    : directory(std::move(directory))
+    , capacity(capacityBytes)
+{
+}
+
+IconStore::~IconStore()
+{
+    close();
+}
+
+std::string IconStore::packPath() const { return directory + "/icons.pack"; }
+std::string IconStore::indexPath() const { return directory + "/icons.idx"; }
+std::string IconStore::compactPath() const { return directory + "/icons.pack.compact"; }
+
+bool IconStore::open()
+{
+    close();
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // compact() deletes the old pack before renaming the new one into place, so a pack
+    // that is missing next to a compacted copy means the rename never happened.
+    if (!fileExists(packPath()) && fileExists(compactPath()))
+        rename(compactPath().c_str(), packPath().c_str());
+    else
+        remove(compactPath().c_str());
+
+    pack = fopen(packPath().c_str(), "r+b");
+    if (!pack)
+        pack = fopen(packPath().c_str(), "w+b");
+    if (!pack)
+        return false;
+
+    fseek(pack, 0, SEEK_END);
+    long size = ftell(pack);
+    packBytes = size > 0 ? static_cast<uint64_t>(size) : 0;
+
+    entries.clear();
+    recency.clear();
+    liveBytes = 0;
+    unflushedPuts = 0;
+    indexDirty = false;
+
+    uint64_t covered = 0;
+    if (!loadIndexLocked(covered))
+    {
+        entries.clear();
+        recency.clear();
+        liveBytes = 0;
+        covered = 0;
+        indexDirty = true;
+    }
+
+    scanLocked(covered);
+    evictLocked(std::string());
+
+    if (indexDirty)
+        writeIndexLocked();
+
+    return true;
+}
+
+void IconStore::close()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!pack)
+        return;
+
+    if (unflushedPuts > 0 || indexDirty)
+        writeIndexLocked();
+
+    fclose(pack);
+    pack = nullptr;
+}
+
+void IconStore::setCapacity(size_t capacityBytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    capacity = capacityBytes;
+    evictLocked(std::string());
+}
+
+bool IconStore::loadIndexLocked(uint64_t& outCovered)
+{
+    FILE* file = fopen(indexPath().c_str(), "rb");
+    if (!file)
+        return false;
+
+    std::string body;
+    char buffer[8192];
+    size_t read = 0;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        body.append(buffer, read);
+    fclose(file);
+
+    constexpr size_t HEADER = 24;
+    if (body.size() < HEADER || readRaw<uint32_t>(body.data()) != INDEX_MAGIC ||
+        readRaw<uint32_t>(body.data() + 4) != INDEX_VERSION)
+        return false;
+
+    uint64_t covered = readRaw<uint64_t>(body.data() + 8);
+    uint32_t count = readRaw<uint32_t>(body.data() + 16);
+    uint32_t expectedSum = readRaw<uint32_t>(body.data() + 20);
+
+    if (covered > packBytes ||
+        checksumOf(std::string(), reinterpret_cast<const uint8_t*>(body.data() + HEADER), body.size() - HEADER) != expectedSum)
+        return false;
+
+    size_t at = HEADER;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (body.size() - at < 16)
+            return false;
+
+        uint64_t offset = readRaw<uint64_t>(body.data() + at);
+        uint32_t dataLength = readRaw<uint32_t>(body.data() + at + 8);
+        uint32_t keyLength = readRaw<uint32_t>(body.data() + at + 12);
+        at += 16;
+
+        if (body.size() - at < keyLength || offset + RECORD_HEADER + keyLength + dataLength > covered)
+            return false;
+
+        insertLocked(body.substr(at, keyLength), offset, dataLength);
+        at += keyLength;
+    }
+
+    outCovered = covered;
+    return at == body.size();
+}
+
+bool IconStore::writeIndexLocked()
+{
+    std::string entriesBody;
+    uint32_t count = 0;
+
+    // Oldest first, so reloading the index rebuilds the same recency order.
+    for (const std::string& key : recency)
+    {
+        const Entry& entry = entries.at(key);
+        appendRaw(entriesBody, entry.offset);
+        appendRaw(entriesBody, entry.dataLength);
+        appendRaw(entriesBody, static_cast<uint32_t>(key.size()));
+        entriesBody += key;
+        count++;
+    }
+
+    std::string body;
+    body.reserve(24 + entriesBody.size());
+    appendRaw(body, INDEX_MAGIC);
+    appendRaw(body, INDEX_VERSION);
+    appendRaw(body, packBytes);
+    appendRaw(body, count);
+    appendRaw(body, checksumOf(std::string(), reinterpret_cast<const uint8_t*>(entriesBody.data()), entriesBody.size()));
+    body += entriesBody;
+
+    std::string temp = indexPath() + ".tmp";
+    FILE* file = fopen(temp.c_str(), "wb");
+    if (!file)
+        return false;
+
+    size_t written = fwrite(body.data(), 1, body.size(), file);
+    fclose(file);
+
+    if (written != body.size())
+    {
+        remove(temp.c_str());
+        return false;
+    }
+
+    remove(indexPath().c_str());
+    if (rename(temp.c_str(), indexPath().c_str()) != 0)
+    {
+        remove(temp.c_str());
+        return false;
+    }
+
+    unflushedPuts = 0;
+    indexDirty = false;
+    return true;
+}
+
+void IconStore::scanLocked(uint64_t from)
+{
+    uint64_t at = from;
+    std::string key;
+    std::vector<uint8_t> data;
+
+    while (packBytes - at >= RECORD_HEADER)
+    {
+        uint32_t header[4];
+        if (fseek(pack, static_cast<long>(at), SEEK_SET) != 0 || fread(header, 1, sizeof(header), pack) != sizeof(header))
+            break;
+
+        uint32_t keyLength = header[1];
+        uint32_t dataLength = header[2];
+        bool dead = header[0] == DEAD_MAGIC;
+        if ((header[0] != RECORD_MAGIC && !dead) || RECORD_HEADER + uint64_t(keyLength) + dataLength > packBytes - at)
+            break;
+
+        key.resize(keyLength);
+        data.resize(dataLength);
+        if (fread(key.data(), 1, keyLength, pack) != keyLength || fread(data.data(), 1, dataLength, pack) != dataLength)
+            break;
+
+        if (checksumOf(key, data.data(), data.size()) != header[3])
+            break;
+
+        if (!dead)
+            insertLocked(key, at, dataLength);
+        at += RECORD_HEADER + keyLength + dataLength;
+        indexDirty = true;
+    }
+
+    if (at < packBytes)
+    {
+        fflush(pack);
+        if (ftruncate(fileno(pack), static_cast<off_t>(at)) == 0)
+            packBytes = at;
+        indexDirty = true;
+    }
+}
+
+void IconStore::insertLocked(const std::string& key, uint64_t offset, uint32_t dataLength)
+{
+    dropLocked(key);
+
+    recency.push_back(key);
+    Entry entry;
+    entry.offset = offset;
+    entry.dataLength = dataLength;
+    entry.recency = std::prev(recency.end());
+
+    liveBytes += entry.recordBytes(key);
+    entries.emplace(key, entry);
+}
+
+void IconStore::dropLocked(const std::string& key)
+{
+    auto found = entries.find(key);
+    if (found == entries.end())
+        return;
+
+    liveBytes -= found->second.recordBytes(key);
+    recency.erase(found->second.recency);
+    entries.erase(found);
+}
+
+// Evictions are not written to the index straight away. If the store is reopened before
+// the next index write, evicted entries reappear and are simply evicted again.
+void IconStore::evictLocked(const std::string& keep)
+{
+    while (liveBytes > capacity && !recency.empty())
+    {
+        std::string oldest = recency.front();
+        if (oldest == keep)
+            break;
+        dropLocked(oldest);
+    }
+}
+
+bool IconStore::markDeadLocked(FILE* file, uint64_t at)
+{
+    uint32_t magic = DEAD_MAGIC;
+    if (fseek(file, static_cast<long>(at), SEEK_SET) != 0)
+        return false;
+
+    bool written = fwrite(&magic, 1, sizeof(magic), file) == sizeof(magic);
+    return fflush(file) == 0 && written;
+}
+
+bool IconStore::appendLocked(FILE* file, uint64_t at, const std::string& key, const uint8_t* data, uint32_t length)
+{
+    uint32_t header[4] = {RECORD_MAGIC, static_cast<uint32_t>(key.size()), length, checksumOf(key, data, length)};
+
+    if (fseek(file, static_cast<long>(at), SEEK_SET) != 0)
+        return false;
+
+    bool written = fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+        fwrite(key.data(), 1, key.size(), file) == key.size() &&
+        fwrite(data, 1, length, file) == length;
+
+    return fflush(file) == 0 && written;
+}
+
+bool IconStore::readDataLocked(const std::string& key, const Entry& entry, std::vector<uint8_t>& outBytes)
+{
+    outBytes.resize(entry.dataLength);
+
+    long dataAt = static_cast<long>(entry.offset + RECORD_HEADER + key.size());
+    if (fseek(pack, dataAt, SEEK_SET) != 0 || fread(outBytes.data(), 1, outBytes.size(), pack) != outBytes.size())
+    {
+        outBytes.clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool IconStore::get(const std::string& key, std::vector<uint8_t>& outBytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!pack)
+        return false;
+
+    auto found = entries.find(key);
+    if (found == entries.end())
+        return false;
+
+    if (!readDataLocked(key, found->second, outBytes))
+    {
+        dropLocked(key);
+        indexDirty = true;
+        return false;
+    }
+
+    recency.splice(recency.end(), recency, found->second.recency);
+    return true;
+}
+
+bool IconStore::put(const std::string& key, const std::vector<uint8_t>& bytes)
+{
+    if (bytes.empty() || bytes.size() > UINT32_MAX)
+        return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!pack)
+        return false;
+
+    uint32_t length = static_cast<uint32_t>(bytes.size());
+    if (!appendLocked(pack, packBytes, key, bytes.data(), length))
+    {
+        ftruncate(fileno(pack), static_cast<off_t>(packBytes));
+        return false;
+    }
+
+    insertLocked(key, packBytes, length);
+    packBytes += RECORD_HEADER + key.size() + length;
+    evictLocked(key);
+
+    if (++unflushedPuts >= INDEX_FLUSH_EVERY || indexDirty)
+        writeIndexLocked();
+
+    return true;
+}
+
+void IconStore::erase(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto found = entries.find(key);
+    if (found == entries.end())
+        return;
+
+    if (pack)
+        markDeadLocked(pack, found->second.offset);
+    dropLocked(key);
+    if (pack)
+        writeIndexLocked();
+}
+
+bool IconStore::needsCompaction() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    uint64_t dead = packBytes - liveBytes;
+    return dead >= COMPACT_MIN_DEAD_BYTES && dead * 2 >= packBytes;
+}
+
+bool IconStore::compact()
+{
+    struct Live {
+        std::string key;
+        uint64_t offset;
+        uint32_t dataLength;
+    };
+
+    std::vector<Live> live;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (!pack || compacting)
+            return false;
+        compacting = true;
+
+        live.reserve(entries.size());
+        for (const std::string& key : recency)
+        {
+            const Entry& entry = entries.at(key);
+            live.push_back({key, entry.offset, entry.dataLength});
+        }
+    }
+
+    // Records are never rewritten in place, so the copy can read them through its own
+    // handle while the store's handle keeps serving get() and put().
+    FILE* source = fopen(packPath().c_str(), "rb");
+    FILE* out = source ? fopen(compactPath().c_str(), "w+b") : nullptr;
+
+    std::unordered_map<std::string, std::pair<uint64_t, uint64_t>> moved; // old offset, new offset
+    moved.reserve(live.size());
+
+    uint64_t at = 0;
+    bool copied = out != nullptr;
+    std::vector<uint8_t> data;
+
+    for (const Live& record : live)
+    {
+        data.resize(record.dataLength);
+        long dataAt = static_cast<long>(record.offset + RECORD_HEADER + record.key.size());
+        if (fseek(source, dataAt, SEEK_SET) != 0 || fread(data.data(), 1, data.size(), source) != data.size() ||
+            !appendLocked(out, at, record.key, data.data(), record.dataLength))
+        {
+            copied = false;
+            break;
+        }
+
+        moved[record.key] = {record.offset, at};
+        at += RECORD_HEADER + record.key.size() + record.dataLength;
+    }
+
+    if (source)
+        fclose(source);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    compacting = false;
+
+    auto abandon = [&] {
+        if (out)
+            fclose(out);
+        remove(compactPath().c_str());
+        return false;
+    };
+
+    if (!copied || !pack)
+        return abandon();
+
+    // Copies of entries erased or evicted while the copy ran are marked dead before the new
+    // pack goes live; left as they are, a scan after a crash would bring them back.
+    for (const auto& [key, offsets] : moved)
+    {
+        auto entry = entries.find(key);
+        if ((entry == entries.end() || entry->second.offset != offsets.first) && !markDeadLocked(out, offsets.second))
+            return abandon();
+    }
+
+    // Entries put while the copy ran sit past the snapshot in the old pack; carry them over.
+    for (const std::string& key : recency)
+    {
+        const Entry& entry = entries.at(key);
+        auto found = moved.find(key);
+        if (found != moved.end() && found->second.first == entry.offset)
+            continue;
+
+        if (!readDataLocked(key, entry, data) || !appendLocked(out, at, key, data.data(), entry.dataLength))
+            return abandon();
+
+        moved[key] = {entry.offset, at};
+        at += entry.recordBytes(key);
+    }
+
+    fclose(out);
+    fclose(pack);
+    pack = nullptr;
+
+    // Drop the index first: until the new one is written, open() rebuilds from the pack.
+    remove(indexPath().c_str());
+    remove(packPath().c_str());
+    rename(compactPath().c_str(), packPath().c_str());
+
+    pack = fopen(packPath().c_str(), "r+b");
+    if (!pack)
+    {
+        entries.clear();
+        recency.clear();
+        liveBytes = 0;
+        packBytes = 0;
+        return false;
+    }
+
+    for (auto& [key, entry] : entries)
+        entry.offset = moved[key].second;
+    packBytes = at;
+
+    return writeIndexLocked();
+}
+
+bool IconStore::flush()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return pack && writeIndexLocked();
+}
+
+IconStore::Stats IconStore::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    Stats out;
+    out.entries = entries.size();
+    out.liveBytes = liveBytes;
+    out.packBytes = static_cast<size_t>(packBytes);
+    return out;
+}
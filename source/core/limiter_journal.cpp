@@ -0,0 +1,322 @@
+#include "core/limiter_journal.hpp"
+#include "util/file_io.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+static uint16_t checkOf(const char* bytes, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= static_cast<unsigned char>(bytes[i]);
+        hash *= 16777619u;
+    }
+    return static_cast<uint16_t>(hash ^ (hash >> 16));
+}
+
+template <typename T>
+static void appendRaw(std::string& out, T value)
+{
+    char raw[sizeof(T)];
+    std::memcpy(raw, &value, sizeof(T));
+    out.append(raw, sizeof(T));
+}
+
+template <typename T>
+static T readRaw(const char* at)
+{
+    T value;
+    std::memcpy(&value, at, sizeof(T));
+    return value;
+}
+
+LimiterJournal::LimiterJournal(std::string path)
+    : path(std::move(path))
+{
+}
+
+LimiterJournal::~LimiterJournal()
+{
+    close();
+}
+
+void LimiterJournal::retarget(std::string newPath)
+{
+    close();
+    path = std::move(newPath);
+    fileBytes = 0;
+}
+
+// Layout: u8 type, u8 lane, u16 check, i32 count, i64 at, i64 value. The check covers the
+// other fields so a half-written or scribbled record is told apart from a real one. Files
+// from before lanes existed read back with every record in lane 0.
+void LimiterJournal::encode(const Record& record, std::string& out)
+{
+    std::string body;
+    appendRaw(body, static_cast<uint8_t>(record.type));
+    appendRaw(body, record.lane);
+    appendRaw(body, record.count);
+    appendRaw(body, record.at);
+    appendRaw(body, record.value);
+
+    out.append(body, 0, 2);
+    appendRaw(out, checkOf(body.data(), body.size()));
+    out.append(body, 2, std::string::npos);
+}
+
+bool LimiterJournal::decode(const char* at, Record& out)
+{
+    uint8_t type = readRaw<uint8_t>(at);
+    uint8_t lane = readRaw<uint8_t>(at + 1);
+    if (type < static_cast<uint8_t>(Type::Acquire) || type > static_cast<uint8_t>(Type::Release) ||
+        lane >= MAX_LANES)
+        return false;
+
+    char body[RECORD_BYTES - sizeof(uint16_t)];
+    std::memcpy(body, at, 2);
+    std::memcpy(body + 2, at + 4, RECORD_BYTES - 4);
+    if (readRaw<uint16_t>(at + 2) != checkOf(body, sizeof(body)))
+        return false;
+
+    out.type = static_cast<Type>(type);
+    out.lane = lane;
+    out.count = readRaw<int32_t>(at + 4);
+    out.at = readRaw<int64_t>(at + 8);
+    out.value = readRaw<int64_t>(at + 16);
+    return true;
+}
+
+LimiterJournal::Replay LimiterJournal::replay(int64_t now, State& out)
+{
+    close();
+    out = State{};
+    reserved.fill(0);
+    pending.clear();
+
+    // A compaction cut short after the old journal was removed left its replacement staged.
+    std::string bytes;
+    if (!akira::fileio::readAll(path, bytes))
+        return Replay::Missing;
+
+    fileBytes = bytes.size();
+
+    if (bytes.size() < HEADER_BYTES || readRaw<uint32_t>(bytes.data()) != MAGIC ||
+        readRaw<uint32_t>(bytes.data() + 4) != VERSION)
+        return Replay::Corrupt;
+
+    Replay result = Replay::Clean;
+    std::array<int64_t, MAX_LANES> openReserve{};
+    std::array<int64_t, MAX_LANES> seenSinceReserve{};
+    std::array<int64_t, MAX_LANES> unseen{};
+
+    size_t offset = HEADER_BYTES;
+    for (; offset + RECORD_BYTES <= bytes.size(); offset += RECORD_BYTES)
+    {
+        Record record{};
+        if (!decode(bytes.data() + offset, record))
+        {
+            result = Replay::Corrupt;
+            break;
+        }
+
+        out.lastSeen = std::max(out.lastSeen, record.at);
+        Lane& lane = out.lanes[record.lane];
+        size_t index = record.lane;
+
+        switch (record.type)
+        {
+            case Type::Acquire:
+            {
+                int32_t charged = std::clamp(record.count, 1, MAX_CHARGE);
+                lane.stamps.insert(lane.stamps.end(), static_cast<size_t>(charged), record.at);
+                seenSinceReserve[index] += charged;
+                break;
+            }
+            case Type::Reserve:
+                unseen[index] += std::max<int64_t>(0, openReserve[index] - seenSinceReserve[index]);
+                openReserve[index] = record.count;
+                seenSinceReserve[index] = 0;
+                break;
+            case Type::Release:
+                openReserve[index] = std::max<int64_t>(0, openReserve[index] - record.count);
+                break;
+            case Type::Throttle:
+                lane.throttleCount++;
+                lane.lastThrottleAt = std::max(lane.lastThrottleAt, record.at);
+                lane.breakerUntil = std::max(lane.breakerUntil, record.value);
+                break;
+            case Type::Checkpoint:
+                lane.throttleCount = record.count;
+                lane.lastThrottleAt = record.at;
+                lane.breakerUntil = record.value;
+                break;
+        }
+    }
+
+    if (result != Replay::Corrupt && offset != bytes.size())
+        result = Replay::Recovered;
+
+    for (size_t index = 0; index < MAX_LANES; index++)
+    {
+        Lane& lane = out.lanes[index];
+        unseen[index] += std::max<int64_t>(0, openReserve[index] - seenSinceReserve[index]);
+        if (unseen[index] > 0)
+        {
+            lane.stamps.insert(lane.stamps.end(), static_cast<size_t>(unseen[index]), now);
+            if (result == Replay::Clean)
+                result = Replay::Recovered;
+        }
+        std::sort(lane.stamps.begin(), lane.stamps.end());
+    }
+
+    return result;
+}
+
+void LimiterJournal::recordAcquire(size_t lane, int64_t at)
+{
+    uint8_t tag = static_cast<uint8_t>(lane);
+    if (reserved[lane] > 0)
+    {
+        pending.push_back({Type::Acquire, tag, 1, at, 0});
+        reserved[lane]--;
+        return;
+    }
+
+    pending.push_back({Type::Reserve, tag, RESERVE_BLOCK, at, 0});
+    pending.push_back({Type::Acquire, tag, 1, at, 0});
+    reserved[lane] = RESERVE_BLOCK - 1;
+    flush();
+}
+
+void LimiterJournal::recordThrottle(size_t lane, int64_t at, int64_t breakerUntil)
+{
+    pending.push_back({Type::Throttle, static_cast<uint8_t>(lane), 0, at, breakerUntil});
+    flush();
+}
+
+bool LimiterJournal::openForAppend()
+{
+    if (file)
+        return true;
+
+    // Appending to a fresh file while a staged compaction holds the real history would
+    // start the window from zero.
+    akira::fileio::recover(path);
+    file = fopen(path.c_str(), "ab");
+    if (!file)
+        return false;
+
+    fseek(file, 0, SEEK_END);
+    long existing = ftell(file);
+    if (existing > 0)
+    {
+        fileBytes = static_cast<size_t>(existing);
+        return true;
+    }
+
+    std::string header;
+    appendRaw(header, MAGIC);
+    appendRaw(header, VERSION);
+    if (fwrite(header.data(), 1, header.size(), file) != header.size())
+    {
+        fclose(file);
+        file = nullptr;
+        return false;
+    }
+    fileBytes = header.size();
+    return true;
+}
+
+bool LimiterJournal::writeLocked(const std::string& bytes)
+{
+    if (!openForAppend())
+        return false;
+
+    bool written = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    written = fflush(file) == 0 && written;
+    if (written)
+        fileBytes += bytes.size();
+    syncs++;
+    return written;
+}
+
+bool LimiterJournal::flush()
+{
+    if (pending.empty())
+        return true;
+
+    std::string bytes;
+    bytes.reserve(pending.size() * RECORD_BYTES);
+    for (const Record& record : pending)
+        encode(record, bytes);
+    pending.clear();
+
+    return writeLocked(bytes);
+}
+
+bool LimiterJournal::compact(const State& state)
+{
+    if (file)
+    {
+        fclose(file);
+        file = nullptr;
+    }
+
+    std::string bytes;
+    appendRaw(bytes, MAGIC);
+    appendRaw(bytes, VERSION);
+
+    for (size_t index = 0; index < MAX_LANES; index++)
+    {
+        const Lane& lane = state.lanes[index];
+        uint8_t tag = static_cast<uint8_t>(index);
+
+        if (lane.throttleCount > 0 || lane.breakerUntil > 0)
+            encode({Type::Checkpoint, tag, lane.throttleCount, lane.lastThrottleAt, lane.breakerUntil}, bytes);
+
+        // Runs of the same second collapse into one record.
+        for (size_t i = 0; i < lane.stamps.size();)
+        {
+            size_t run = 1;
+            while (i + run < lane.stamps.size() && lane.stamps[i + run] == lane.stamps[i] && run < MAX_CHARGE)
+                run++;
+            encode({Type::Acquire, tag, static_cast<int32_t>(run), lane.stamps[i], 0}, bytes);
+            i += run;
+        }
+
+        // The rest of the block in flight stays reserved so a crash still charges for it.
+        if (reserved[index] > 0)
+            encode({Type::Reserve, tag, reserved[index], state.lastSeen, 0}, bytes);
+    }
+
+    if (!akira::fileio::replace(path, bytes))
+        return false;
+
+    pending.clear();
+    fileBytes = bytes.size();
+    syncs++;
+    return true;
+}
+
+void LimiterJournal::close()
+{
+    int64_t at = pending.empty() ? 0 : pending.back().at;
+    for (size_t index = 0; index < MAX_LANES; index++)
+    {
+        if (reserved[index] > 0)
+        {
+            pending.push_back({Type::Release, static_cast<uint8_t>(index), reserved[index], at, 0});
+            reserved[index] = 0;
+        }
+    }
+
+    if (!pending.empty())
+        flush();
+
+    if (file)
+    {
+        fclose(file);
+        file = nullptr;
+    }
+}
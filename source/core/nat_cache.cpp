@@ -0,0 +1,181 @@
+#include "core/nat_cache.hpp"
+
+#include <algorithm>
+#include <format>
+#include <sstream>
+
+namespace {
+
+constexpr const char* SERVER_LIST_HEADER = "# akira stun servers v1";
+
+std::string trimmed(const std::string& line)
+{
+    size_t start = line.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos)
+        return "";
+    size_t end = line.find_last_not_of(" \t\r\n");
+    return line.substr(start, end - start + 1);
+}
+
+} // namespace
+
+StunServerList::StunServerList() : StunServerList(Config()) {}
+
+StunServerList::StunServerList(Config config) : config(config) {}
+
+bool StunServerList::stale(int64_t nowMs) const
+{
+    return !fetched || nowMs - fetchedAtMs >= config.ttlMs || nowMs < fetchedAtMs;
+}
+
+void StunServerList::replace(const std::vector<std::string>& list, int64_t nowMs)
+{
+    std::vector<Entry> next;
+    for (const std::string& server : list)
+    {
+        if (next.size() >= config.maxServers)
+            break;
+        if (std::any_of(next.begin(), next.end(), [&](const Entry& e) { return e.server == server; }))
+            continue;
+
+        auto known = std::find_if(servers.begin(), servers.end(),
+            [&](const Entry& e) { return e.server == server; });
+        next.push_back(known != servers.end() ? *known : Entry{server});
+    }
+    servers = std::move(next);
+    fetchedAtMs = nowMs;
+    fetched = true;
+}
+
+void StunServerList::recordRtt(const std::string& server, int rttMs)
+{
+    for (Entry& entry : servers)
+    {
+        if (entry.server != server)
+            continue;
+        entry.rttMs = entry.rttMs < 0 ? rttMs : (entry.rttMs * 3 + rttMs) / 4;
+        entry.failures = 0;
+        return;
+    }
+}
+
+void StunServerList::recordFailure(const std::string& server)
+{
+    for (Entry& entry : servers)
+    {
+        if (entry.server == server)
+        {
+            entry.failures++;
+            return;
+        }
+    }
+}
+
+std::vector<std::string> StunServerList::ranked(size_t limit) const
+{
+    std::vector<const Entry*> order;
+    for (const Entry& entry : servers)
+        order.push_back(&entry);
+
+    // 0: answered last time, by RTT; 1: never measured; 2: stopped answering.
+    auto tier = [](const Entry* e) { return e->failures > 0 ? 2 : e->rttMs < 0 ? 1 : 0; };
+    std::stable_sort(order.begin(), order.end(), [&](const Entry* a, const Entry* b) {
+        if (tier(a) != tier(b))
+            return tier(a) < tier(b);
+        if (tier(a) == 0)
+            return a->rttMs < b->rttMs;
+        if (tier(a) == 2)
+            return a->failures < b->failures;
+        return false;
+    });
+
+    std::vector<std::string> out;
+    for (size_t i = 0; i < order.size() && out.size() < limit; i++)
+        out.push_back(order[i]->server);
+    return out;
+}
+
+std::string StunServerList::serialize() const
+{
+    std::string out = std::format("{}\nfetched {}\n", SERVER_LIST_HEADER, fetchedAtMs);
+    for (const Entry& entry : servers)
+        out += std::format("{} {} {}\n", entry.server, entry.rttMs, entry.failures);
+    return out;
+}
+
+bool StunServerList::parse(const std::string& text)
+{
+    servers.clear();
+    fetched = false;
+    fetchedAtMs = 0;
+
+    std::istringstream stream(text);
+    std::string line;
+    if (!std::getline(stream, line) || trimmed(line) != SERVER_LIST_HEADER)
+        return false;
+
+    std::string keyword;
+    int64_t fetchedAt = 0;
+    if (!std::getline(stream, line) || !(std::istringstream(line) >> keyword >> fetchedAt) ||
+        keyword != "fetched")
+        return false;
+
+    std::vector<Entry> parsed;
+    while (std::getline(stream, line))
+    {
+        Entry entry;
+        if (!(std::istringstream(line) >> entry.server >> entry.rttMs >> entry.failures))
+            continue;
+        parsed.push_back(entry);
+    }
+
+    servers = std::move(parsed);
+    fetchedAtMs = fetchedAt;
+    fetched = true;
+    return true;
+}
+
+std::vector<std::string> StunServerList::parseServerList(const std::string& body)
+{
+    std::vector<std::string> servers;
+    std::istringstream stream(body);
+    std::string line;
+    while (std::getline(stream, line))
+    {
+        std::string server = trimmed(line);
+        if (!server.empty() && server[0] != '#' && server.find(':') != std::string::npos)
+            servers.push_back(server);
+    }
+    return servers;
+}
+
+NatResultCache::NatResultCache() : NatResultCache(Config()) {}
+
+NatResultCache::NatResultCache(Config config) : config(config) {}
+
+void NatResultCache::store(const std::string& network, const StunResult& result, int64_t nowMs)
+{
+    if (network.empty())
+        return;
+
+    if (!results.contains(network) && results.size() >= config.maxNetworks)
+    {
+        auto oldest = std::min_element(results.begin(), results.end(),
+            [](const auto& a, const auto& b) { return a.second.storedAtMs < b.second.storedAtMs; });
+        results.erase(oldest);
+    }
+    results[network] = {result, nowMs};
+}
+
+std::optional<StunResult> NatResultCache::find(const std::string& network, int64_t nowMs) const
+{
+    auto it = results.find(network);
+    if (it == results.end() || nowMs - it->second.storedAtMs >= config.ttlMs)
+        return std::nullopt;
+    return it->second.result;
+}
+
+void NatResultCache::forget(const std::string& network)
+{
+    results.erase(network);
+}
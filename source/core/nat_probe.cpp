@@ -0,0 +1,562 @@
+#include "core/nat_probe.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <random>
+
+#include "util/net_wrappers.hpp"
+
+namespace {
+
+constexpr uint16_t STUN_BINDING_REQUEST = 0x0001;
+constexpr uint16_t STUN_BINDING_RESPONSE = 0x0101;
+constexpr uint32_t STUN_MAGIC_COOKIE = 0x2112A442;
+constexpr uint16_t STUN_ATTR_MAPPED_ADDRESS = 0x0001;
+constexpr uint16_t STUN_ATTR_CHANGE_REQUEST = 0x0003;
+constexpr uint16_t STUN_ATTR_XOR_MAPPED_ADDRESS = 0x0020;
+constexpr uint16_t STUN_ATTR_OTHER_ADDRESS = 0x802C;
+constexpr size_t STUN_HEADER_BYTES = 20;
+
+int64_t clockMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void put16(std::vector<uint8_t>& out, uint16_t value)
+{
+    out.push_back(uint8_t(value >> 8));
+    out.push_back(uint8_t(value));
+}
+
+void put32(std::vector<uint8_t>& out, uint32_t value)
+{
+    put16(out, uint16_t(value >> 16));
+    put16(out, uint16_t(value));
+}
+
+uint16_t get16(const uint8_t* p)
+{
+    return uint16_t(p[0] << 8 | p[1]);
+}
+
+uint32_t get32(const uint8_t* p)
+{
+    return uint32_t(get16(p)) << 16 | get16(p + 2);
+}
+
+void putHeader(std::vector<uint8_t>& out, uint16_t type, const uint8_t* transactionId)
+{
+    put16(out, type);
+    put16(out, 0);
+    put32(out, STUN_MAGIC_COOKIE);
+    out.insert(out.end(), transactionId, transactionId + NatProbe::TRANSACTION_ID_BYTES);
+}
+
+void finishLength(std::vector<uint8_t>& out)
+{
+    uint16_t length = uint16_t(out.size() - STUN_HEADER_BYTES);
+    out[2] = uint8_t(length >> 8);
+    out[3] = uint8_t(length);
+}
+
+void putAddress(std::vector<uint8_t>& out, uint16_t type, uint16_t port, uint32_t addr)
+{
+    put16(out, type);
+    put16(out, 8);
+    out.push_back(0);
+    out.push_back(0x01);
+    put16(out, port);
+    put32(out, addr);
+}
+
+bool readAddress(const uint8_t* value, uint16_t length, bool xored, StunEndpoint& out)
+{
+    if (length < 8 || value[1] != 0x01)
+        return false;
+    out.port = get16(value + 2);
+    out.addr = get32(value + 4);
+    if (xored)
+    {
+        out.port ^= uint16_t(STUN_MAGIC_COOKIE >> 16);
+        out.addr ^= STUN_MAGIC_COOKIE;
+    }
+    return true;
+}
+
+sockaddr_in toSockaddr(const StunEndpoint& endpoint)
+{
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(endpoint.addr);
+    addr.sin_port = htons(endpoint.port);
+    return addr;
+}
+
+int openSocket()
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (fd < 0)
+        return -1;
+
+    sockaddr_in local = toSockaddr({INADDR_ANY, 0});
+    if (bind(fd, reinterpret_cast<sockaddr*>(&local), sizeof(local)) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// One run of NatProbe: the open transactions and what their answers have settled so far.
+class ProbeRun {
+public:
+    ProbeRun(const NatProbe::Config& config, const std::vector<StunTarget>& targets,
+        int mappingSock, int filteringSock)
+        : config(config), targets(targets), mappingSock(mappingSock),
+          filteringSock(filteringSock), rng(uint64_t(clockMs()) ^ uint64_t(uintptr_t(this)))
+    {
+    }
+
+    NatProbe::Report run();
+
+private:
+    enum class Kind {
+        Binding,
+        MappingII,
+        MappingIII,
+        FilteringII,
+        FilteringIII,
+    };
+
+    struct Transaction {
+        Kind kind;
+        size_t target;
+        int sock;
+        StunEndpoint dest;
+        uint8_t change;
+        uint8_t id[NatProbe::TRANSACTION_ID_BYTES];
+        int attempts = 0;
+        int64_t sentAtMs = 0;
+        bool open = true;
+    };
+
+    const NatProbe::Config& config;
+    const std::vector<StunTarget>& targets;
+    int mappingSock;
+    int filteringSock;
+    std::mt19937_64 rng;
+
+    std::vector<Transaction> transactions;
+    std::vector<int> rtts;  // per target: -2 still open, -1 failed
+
+    bool anyAnswer = false;
+    StunEndpoint firstMapped;
+    std::vector<std::pair<StunEndpoint, StunEndpoint>> plainAnswers;  // server, mapped
+
+    bool havePrimary = false;
+    size_t primary = 0;
+    StunEndpoint primaryMapped;
+    StunEndpoint other;
+
+    MappingType mapping = MappingType::Unknown;
+    bool mappingSettled = false;
+    StunEndpoint mappedII;
+
+    FilteringType filtering = FilteringType::Unknown;
+    bool filteringSettled = false;
+    enum class Outcome { Pending, Answered, Failed, Ignored };
+    Outcome filteringII = Outcome::Pending;
+    Outcome filteringIII = Outcome::Pending;
+
+    void start(Kind kind, size_t target, int sock, const StunEndpoint& dest, uint8_t change);
+    void send(Transaction& txn, int64_t nowMs);
+    void receive(int sock, int64_t nowMs);
+    void answered(Transaction& txn, const NatProbe::Binding& binding, const StunEndpoint& from,
+        int64_t nowMs);
+    void failed(Transaction& txn);
+    void settleFiltering();
+    bool finished() const;
+    NatProbe::Report report(int64_t startedMs) const;
+};
+
+void ProbeRun::start(Kind kind, size_t target, int sock, const StunEndpoint& dest, uint8_t change)
+{
+    Transaction txn{kind, target, sock, dest, change, {}};
+    for (auto& byte : txn.id)
+        byte = uint8_t(rng());
+    transactions.push_back(txn);
+    send(transactions.back(), clockMs());
+}
+
+void ProbeRun::send(Transaction& txn, int64_t nowMs)
+{
+    std::vector<uint8_t> request = NatProbe::bindingRequest(txn.id, txn.change);
+    sockaddr_in dest = toSockaddr(txn.dest);
+    sendto(txn.sock, request.data(), request.size(), 0, reinterpret_cast<sockaddr*>(&dest),
+        sizeof(dest));
+    txn.attempts++;
+    txn.sentAtMs = nowMs;
+}
+
+void ProbeRun::receive(int sock, int64_t nowMs)
+{
+    uint8_t buffer[512];
+    sockaddr_in from;
+    socklen_t fromLen = sizeof(from);
+    ssize_t received = recvfrom(sock, buffer, sizeof(buffer), 0,
+        reinterpret_cast<sockaddr*>(&from), &fromLen);
+    if (received < ssize_t(STUN_HEADER_BYTES))
+        return;
+
+    for (Transaction& txn : transactions)
+    {
+        if (!txn.open || txn.sock != sock ||
+            std::memcmp(buffer + 8, txn.id, NatProbe::TRANSACTION_ID_BYTES) != 0)
+            continue;
+
+        NatProbe::Binding binding = NatProbe::parseBindingResponse(buffer, size_t(received), txn.id);
+        if (!binding.valid)
+            return;
+        txn.open = false;
+        answered(txn, binding, {ntohl(from.sin_addr.s_addr), ntohs(from.sin_port)}, nowMs);
+        return;
+    }
+}
+
+void ProbeRun::answered(Transaction& txn, const NatProbe::Binding& binding,
+    const StunEndpoint& from, int64_t nowMs)
+{
+    switch (txn.kind)
+    {
+    case Kind::Binding:
+    {
+        rtts[txn.target] = int(nowMs - txn.sentAtMs);
+        if (!anyAnswer)
+            firstMapped = binding.mapped;
+        anyAnswer = true;
+
+        // Copied: start() below grows transactions, which txn lives in.
+        StunEndpoint server = txn.dest;
+        bool usable = binding.hasOther && binding.other.addr != server.addr &&
+            binding.other.port != server.port;
+        if (!usable || havePrimary)
+        {
+            plainAnswers.push_back({server, binding.mapped});
+            return;
+        }
+
+        havePrimary = true;
+        primary = txn.target;
+        primaryMapped = binding.mapped;
+        other = binding.other;
+        start(Kind::MappingII, primary, mappingSock, {other.addr, server.port}, 0);
+        start(Kind::FilteringII, primary, filteringSock, server,
+            NatProbe::CHANGE_IP | NatProbe::CHANGE_PORT);
+        start(Kind::FilteringIII, primary, filteringSock, server, NatProbe::CHANGE_PORT);
+        return;
+    }
+    case Kind::MappingII:
+        if (binding.mapped == primaryMapped)
+        {
+            mapping = MappingType::EndpointIndependent;
+            mappingSettled = true;
+            return;
+        }
+        mappedII = binding.mapped;
+        start(Kind::MappingIII, primary, mappingSock, other, 0);
+        return;
+    case Kind::MappingIII:
+        mapping = binding.mapped == mappedII ? MappingType::AddressDependent
+                                             : MappingType::AddressPortDependent;
+        mappingSettled = true;
+        return;
+    case Kind::FilteringII:
+    {
+        // Only an answer from the other address and port shows the filter let it in;
+        // one from the primary means the server ignored CHANGE-REQUEST.
+        const StunEndpoint& server = targets[primary].endpoint;
+        filteringII = from.addr != server.addr && from.port != server.port ? Outcome::Answered
+                                                                           : Outcome::Ignored;
+        settleFiltering();
+        return;
+    }
+    case Kind::FilteringIII:
+    {
+        const StunEndpoint& server = targets[primary].endpoint;
+        filteringIII = from.addr == server.addr && from.port != server.port ? Outcome::Answered
+                                                                            : Outcome::Ignored;
+        settleFiltering();
+        return;
+    }
+    }
+}
+
+void ProbeRun::failed(Transaction& txn)
+{
+    txn.open = false;
+    switch (txn.kind)
+    {
+    case Kind::Binding:
+        rtts[txn.target] = -1;
+        return;
+    case Kind::MappingII:
+    case Kind::MappingIII:
+        mappingSettled = true;
+        return;
+    case Kind::FilteringII:
+        filteringII = Outcome::Failed;
+        settleFiltering();
+        return;
+    case Kind::FilteringIII:
+        filteringIII = Outcome::Failed;
+        settleFiltering();
+        return;
+    }
+}
+
+void ProbeRun::settleFiltering()
+{
+    if (filteringSettled)
+        return;
+
+    if (filteringII == Outcome::Answered)
+        filtering = FilteringType::EndpointIndependent;
+    else if (filteringII == Outcome::Pending || filteringIII == Outcome::Pending)
+        return;
+    else if (filteringIII == Outcome::Answered)
+        filtering = FilteringType::AddressDependent;
+    else if (filteringII == Outcome::Failed && filteringIII == Outcome::Failed)
+        filtering = FilteringType::AddressPortDependent;
+    filteringSettled = true;
+
+    // Nothing left to learn from the change-port test.
+    for (Transaction& txn : transactions)
+        if (txn.kind == Kind::FilteringIII)
+            txn.open = false;
+}
+
+bool ProbeRun::finished() const
+{
+    if (havePrimary && mappingSettled && filteringSettled)
+        return true;
+    return std::none_of(transactions.begin(), transactions.end(),
+        [](const Transaction& txn) { return txn.open; });
+}
+
+NatProbe::Report ProbeRun::run()
+{
+    int64_t startedMs = clockMs();
+    int64_t deadlineMs = startedMs + config.deadlineMs;
+
+    size_t count = std::min(targets.size(), config.maxTargets);
+    rtts.assign(count, -2);
+    for (size_t i = 0; i < count; i++)
+        start(Kind::Binding, i, mappingSock, targets[i].endpoint, 0);
+
+    while (!finished())
+    {
+        int64_t nowMs = clockMs();
+        if (nowMs >= deadlineMs)
+            break;
+
+        int64_t wakeMs = deadlineMs;
+        for (Transaction& txn : transactions)
+        {
+            if (!txn.open)
+                continue;
+            if (txn.sentAtMs + config.attemptTimeoutMs <= nowMs)
+            {
+                if (txn.attempts >= config.attempts)
+                {
+                    failed(txn);
+                    continue;
+                }
+                send(txn, nowMs);
+            }
+            wakeMs = std::min(wakeMs, txn.sentAtMs + config.attemptTimeoutMs);
+        }
+        if (finished())
+            break;
+
+        pollfd fds[2] = {{mappingSock, POLLIN, 0}, {filteringSock, POLLIN, 0}};
+        int ready = poll(fds, 2, int(std::max<int64_t>(wakeMs - nowMs, 1)));
+        if (ready <= 0)
+            continue;
+
+        nowMs = clockMs();
+        if (fds[0].revents & POLLIN)
+            receive(mappingSock, nowMs);
+        if (fds[1].revents & POLLIN)
+            receive(filteringSock, nowMs);
+    }
+
+    return report(startedMs);
+}
+
+NatProbe::Report ProbeRun::report(int64_t startedMs) const
+{
+    NatProbe::Report out;
+    out.elapsedMs = int(clockMs() - startedMs);
+    for (size_t i = 0; i < rtts.size(); i++)
+        if (rtts[i] != -2)
+            out.rtts.push_back({targets[i].server, rtts[i]});
+
+    StunResult& result = out.result;
+    if (!anyAnswer)
+    {
+        result.type = NATType::UDPBlocked;
+        result.error = "No response from STUN server";
+        return out;
+    }
+
+    StunEndpoint external = havePrimary ? primaryMapped : firstMapped;
+    result.externalIP = external.ip();
+    result.externalPort = external.port;
+
+    if (havePrimary)
+    {
+        out.behaviorServer = targets[primary].server;
+        result.mapping = mapping;
+        result.filtering = filtering;
+    }
+    else
+    {
+        // No RFC 5780 server: two plain servers on different addresses still tell a
+        // mapping that follows the destination address from one that does not.
+        for (size_t i = 1; i < plainAnswers.size() && result.mapping == MappingType::Unknown; i++)
+        {
+            if (plainAnswers[i].first.addr == plainAnswers[0].first.addr)
+                continue;
+            result.mapping = plainAnswers[i].second == plainAnswers[0].second
+                ? MappingType::EndpointIndependent
+                : MappingType::AddressDependent;
+        }
+    }
+
+    result.type = classifyNat(result.mapping, result.filtering);
+    if (result.mapping == MappingType::Unknown)
+        result.error = "Not enough STUN servers answered to tell the mapping";
+    return out;
+}
+
+} // namespace
+
+std::string StunEndpoint::ip() const
+{
+    return std::format("{}.{}.{}.{}", addr >> 24, (addr >> 16) & 0xFF, (addr >> 8) & 0xFF,
+        addr & 0xFF);
+}
+
+std::string StunEndpoint::toString() const
+{
+    return std::format("{}:{}", ip(), port);
+}
+
+NatProbe::NatProbe() : NatProbe(Config()) {}
+
+NatProbe::NatProbe(Config config) : config(config) {}
+
+NatProbe::Report NatProbe::run(const std::vector<StunTarget>& targets)
+{
+    SocketGuard mappingSock(openSocket());
+    SocketGuard filteringSock(openSocket());
+    if (mappingSock < 0 || filteringSock < 0)
+    {
+        Report report;
+        report.result.error = "Failed to create socket";
+        return report;
+    }
+
+    ProbeRun probe(config, targets, mappingSock, filteringSock);
+    return probe.run();
+}
+
+std::vector<uint8_t> NatProbe::bindingRequest(const uint8_t* transactionId, uint8_t changeFlags)
+{
+    std::vector<uint8_t> out;
+    putHeader(out, STUN_BINDING_REQUEST, transactionId);
+    if (changeFlags)
+    {
+        put16(out, STUN_ATTR_CHANGE_REQUEST);
+        put16(out, 4);
+        put32(out, changeFlags);
+    }
+    finishLength(out);
+    return out;
+}
+
+std::vector<uint8_t> NatProbe::bindingResponse(const uint8_t* transactionId,
+    const StunEndpoint& mapped, const StunEndpoint* other)
+{
+    std::vector<uint8_t> out;
+    putHeader(out, STUN_BINDING_RESPONSE, transactionId);
+    putAddress(out, STUN_ATTR_XOR_MAPPED_ADDRESS, uint16_t(mapped.port ^ (STUN_MAGIC_COOKIE >> 16)),
+        mapped.addr ^ STUN_MAGIC_COOKIE);
+    if (other)
+        putAddress(out, STUN_ATTR_OTHER_ADDRESS, other->port, other->addr);
+    finishLength(out);
+    return out;
+}
+
+NatProbe::Binding NatProbe::parseBindingResponse(const uint8_t* buffer, size_t length,
+    const uint8_t* transactionId)
+{
+    Binding result;
+    if (length < STUN_HEADER_BYTES || get16(buffer) != STUN_BINDING_RESPONSE)
+        return result;
+    if (transactionId && std::memcmp(buffer + 8, transactionId, TRANSACTION_ID_BYTES) != 0)
+        return result;
+
+    size_t end = STUN_HEADER_BYTES + get16(buffer + 2);
+    if (length < end)
+        return result;
+
+    bool haveXor = false;
+    size_t offset = STUN_HEADER_BYTES;
+    while (offset + 4 <= end)
+    {
+        uint16_t type = get16(buffer + offset);
+        uint16_t attrLength = get16(buffer + offset + 2);
+        const uint8_t* value = buffer + offset + 4;
+        if (offset + 4 + attrLength > end)
+            break;
+
+        if (type == STUN_ATTR_XOR_MAPPED_ADDRESS && readAddress(value, attrLength, true, result.mapped))
+            result.valid = haveXor = true;
+        else if (type == STUN_ATTR_MAPPED_ADDRESS && !haveXor)
+            result.valid = readAddress(value, attrLength, false, result.mapped) || result.valid;
+        else if (type == STUN_ATTR_OTHER_ADDRESS)
+            result.hasOther = readAddress(value, attrLength, false, result.other);
+
+        offset += 4 + ((attrLength + 3) & ~3u);
+    }
+    return result;
+}
+
+NATType classifyNat(MappingType mapping, FilteringType filtering)
+{
+    switch (mapping)
+    {
+    case MappingType::EndpointIndependent:
+        if (filtering == FilteringType::AddressDependent)
+            return NATType::RestrictedCone;
+        if (filtering == FilteringType::AddressPortDependent)
+            return NATType::PortRestrictedCone;
+        return NATType::FullCone;
+    case MappingType::AddressDependent:
+        return NATType::Symmetric;
+    case MappingType::AddressPortDependent:
+        return NATType::SymmetricPortOnly;
+    default:
+        return NATType::Unknown;
+    }
+}
@@ -8,57 +8,59 @@
 
 #include <json-c/json.h>
 
-PersistedRateLimiter::PersistedRateLimiter(std::string path, int budget, int windowSeconds)
-    : path(std::move(path))
-    , budget(std::max(1, budget))
-    , windowSeconds(std::max(1, windowSeconds))
+PersistedRateLimiter::PersistedRateLimiter(std::string path)
+    : path(path)
+    , journal(path)
 {
 }
 
-void PersistedRateLimiter::reconfigure(int newBudget, int newWindowSeconds)
+PersistedRateLimiter::~PersistedRateLimiter()
+{
+    close();
+}
+
+void PersistedRateLimiter::reconfigure(Scope scope, int budget, int windowSeconds)
 {
     std::lock_guard<std::mutex> lock(mutex);
-    budget = std::max(1, newBudget);
-    windowSeconds = std::max(1, newWindowSeconds);
+    budgetFor(scope).configure(budget, windowSeconds);
 }
 
 void PersistedRateLimiter::retarget(std::string newPath)
 {
     std::lock_guard<std::mutex> lock(mutex);
     path = std::move(newPath);
+    journal.retarget(path);
     loaded = false;
-    stamps.clear();
-    breakerUntil = 0;
+    for (RequestBudget& budget : budgets)
+        budget.reset();
     lastSeen = 0;
-    throttleCount = 0;
-    lastThrottleAt = 0;
 }
 
-void PersistedRateLimiter::pruneLocked(int64_t now)
+void PersistedRateLimiter::spendAllLocked(int64_t now)
 {
-    int64_t cutoff = now - windowSeconds;
-    while (!stamps.empty() && stamps.front() <= cutoff)
-        stamps.pop_front();
-    while (!stamps.empty() && stamps.back() > now)
-        stamps.pop_back();
+    for (RequestBudget& budget : budgets)
+        budget.spend(now);
 }
 
-void PersistedRateLimiter::loadLocked()
+std::string PersistedRateLimiter::legacyPath() const
 {
-    if (loaded)
-        return;
-
-    loaded = true;
+    size_t dot = path.rfind('.');
+    size_t slash = path.rfind('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return path + ".json";
+    return path.substr(0, dot) + ".json";
+}
 
-    int64_t now = static_cast<int64_t>(std::time(nullptr));
-    lastSeen = now;
+// State from before the journal was a JSON document rewritten on every acquire. It only
+// ever counted trophy requests, so it lands in that lane. Returns false when there is no
+// such file; an unreadable one is reported through outReadable.
+bool PersistedRateLimiter::importLegacyLocked(LimiterJournal::State& out, bool& outReadable)
+{
+    outReadable = false;
 
-    FILE* file = fopen(path.c_str(), "rb");
+    FILE* file = fopen(legacyPath().c_str(), "rb");
     if (!file)
-    {
-        brls::Logger::info("Rate limiter: no state at {}, starting a fresh window", path);
-        return;
-    }
+        return false;
 
     std::string body;
     char buffer[512];
@@ -69,11 +71,9 @@ void PersistedRateLimiter::loadLocked()
 
     json_object* parsed = json_tokener_parse(body.c_str());
     if (!parsed)
-    {
-        stamps.assign(static_cast<size_t>(budgetLocked()), now);
-        brls::Logger::warning("Rate limiter: state at {} is unreadable, treating this window as spent", path);
-        return;
-    }
+        return true;
+
+    outReadable = true;
 
     auto readInt64 = [parsed](const char* key) -> int64_t {
         json_object* field = nullptr;
@@ -82,10 +82,11 @@ void PersistedRateLimiter::loadLocked()
         return json_object_get_int64(field);
     };
 
-    breakerUntil = readInt64("breaker_until");
-    int64_t storedLastSeen = readInt64("last_seen");
-    throttleCount = static_cast<int>(readInt64("throttle_count"));
-    lastThrottleAt = readInt64("last_throttle_at");
+    LimiterJournal::Lane& lane = out.lanes[static_cast<size_t>(Scope::Trophy)];
+    lane.breakerUntil = readInt64("breaker_until");
+    out.lastSeen = readInt64("last_seen");
+    lane.throttleCount = static_cast<int>(readInt64("throttle_count"));
+    lane.lastThrottleAt = readInt64("last_throttle_at");
 
     json_object* stampsArray = nullptr;
     if (json_object_object_get_ex(parsed, "stamps", &stampsArray) && stampsArray &&
@@ -96,72 +97,137 @@ void PersistedRateLimiter::loadLocked()
         {
             json_object* entry = json_object_array_get_idx(stampsArray, i);
             if (entry)
-                stamps.push_back(json_object_get_int64(entry));
+                lane.stamps.push_back(json_object_get_int64(entry));
         }
     }
 
     json_object_put(parsed);
 
-    std::sort(stamps.begin(), stamps.end());
+    std::sort(lane.stamps.begin(), lane.stamps.end());
+    return true;
+}
 
-    if (storedLastSeen > now)
-    {
-        stamps.assign(static_cast<size_t>(budgetLocked()), now);
-        breakerUntil = std::min(breakerUntil, now + BREAKER_MAX_SECONDS);
-        brls::Logger::warning("Rate limiter: clock moved backwards, treating this window as spent");
+void PersistedRateLimiter::loadLocked()
+{
+    if (loaded)
         return;
+
+    loaded = true;
+
+    int64_t now = static_cast<int64_t>(std::time(nullptr));
+    lastSeen = now;
+    lastFlushAt = now;
+
+    LimiterJournal::State state;
+    LimiterJournal::Replay replayed = journal.replay(now, state);
+    bool spent = false;
+
+    if (replayed == LimiterJournal::Replay::Missing)
+    {
+        bool readable = false;
+        if (!importLegacyLocked(state, readable))
+        {
+            brls::Logger::info("Rate limiter: no state at {}, starting a fresh window", path);
+            return;
+        }
+
+        if (readable)
+        {
+            brls::Logger::info("Rate limiter: moved {} into the journal at {}", legacyPath(), path);
+        }
+        else
+        {
+            spent = true;
+            brls::Logger::warning("Rate limiter: state at {} is unreadable, treating this window as spent",
+                legacyPath());
+        }
+    }
+    else if (replayed == LimiterJournal::Replay::Corrupt)
+    {
+        spent = true;
+        brls::Logger::warning("Rate limiter: journal at {} is damaged, treating this window as spent", path);
+    }
+    else if (replayed == LimiterJournal::Replay::Recovered)
+    {
+        brls::Logger::warning("Rate limiter: {} was not closed cleanly, unsaved requests charged in full", path);
     }
 
-    pruneLocked(now);
+    for (size_t index = 0; index < BUDGET_SCOPE_COUNT; index++)
+    {
+        const LimiterJournal::Lane& lane = state.lanes[index];
+        RequestBudget& budget = budgets[index];
+        budget.restore(lane.breakerUntil, lane.throttleCount, lane.lastThrottleAt);
+        for (int64_t stamp : lane.stamps)
+        {
+            if (stamp <= now)
+                budget.charge(stamp);
+        }
+    }
 
-    if (breakerUntil > now + BREAKER_MAX_SECONDS)
+    if (state.lastSeen > now)
     {
-        brls::Logger::warning("Rate limiter: breaker deadline is implausibly far out, clamping");
-        breakerUntil = now + BREAKER_MAX_SECONDS;
+        spent = true;
+        for (RequestBudget& budget : budgets)
+            budget.clampBreaker(now);
+        brls::Logger::warning("Rate limiter: clock moved backwards, treating this window as spent");
     }
-}
 
-int PersistedRateLimiter::budgetLocked() const
-{
-    if (lastThrottleAt > 0)
+    if (spent)
+        spendAllLocked(now);
+
+    for (size_t index = 0; index < BUDGET_SCOPE_COUNT; index++)
     {
-        int64_t now = static_cast<int64_t>(std::time(nullptr));
-        if (now - lastThrottleAt < TIGHTEN_WINDOW_SECONDS)
-            return std::max(1, budget / 2);
+        RequestBudget& budget = budgets[index];
+        if (budget.breakerDeadline() > now + RequestBudget::BREAKER_MAX_SECONDS)
+        {
+            brls::Logger::warning("Rate limiter: {} breaker deadline is implausibly far out, clamping",
+                budgetScopeName(static_cast<Scope>(index)));
+            budget.clampBreaker(now);
+        }
     }
 
-    return budget;
+    if (replayed != LimiterJournal::Replay::Clean)
+        compactLocked();
+
+    if (replayed == LimiterJournal::Replay::Missing)
+        remove(legacyPath().c_str());
 }
 
-void PersistedRateLimiter::persistLocked()
+void PersistedRateLimiter::compactLocked()
 {
-    lastSeen = static_cast<int64_t>(std::time(nullptr));
+    LimiterJournal::State state;
+    state.lastSeen = lastSeen;
 
-    std::string joined;
-    for (size_t i = 0; i < stamps.size(); i++)
+    for (size_t index = 0; index < BUDGET_SCOPE_COUNT; index++)
     {
-        if (i > 0)
-            joined += ",";
-        joined += std::to_string(stamps[i]);
+        const RequestBudget& budget = budgets[index];
+        LimiterJournal::Lane& lane = state.lanes[index];
+        lane.breakerUntil = budget.breakerDeadline();
+        lane.throttleCount = budget.throttles();
+        lane.lastThrottleAt = budget.lastThrottle();
+        budget.buckets().forEachLive([&lane](int64_t at, int count) {
+            lane.stamps.insert(lane.stamps.end(), static_cast<size_t>(count), at);
+        });
     }
 
-    std::string body = std::format(
-        "{{\"stamps\":[{}],\"breaker_until\":{},\"last_seen\":{},"
-        "\"throttle_count\":{},\"last_throttle_at\":{}}}\n",
-        joined, breakerUntil, lastSeen, throttleCount, lastThrottleAt);
+    if (!journal.compact(state))
+        brls::Logger::warning("Rate limiter: could not compact {}", path);
+}
 
-    FILE* file = fopen(path.c_str(), "wb");
-    if (!file)
+void PersistedRateLimiter::flushIfDueLocked(int64_t now)
+{
+    if (journal.hasPending() && now - lastFlushAt >= FLUSH_INTERVAL_SECONDS)
     {
-        brls::Logger::warning("Rate limiter: could not write {}", path);
-        return;
+        if (!journal.flush())
+            brls::Logger::warning("Rate limiter: could not write {}", path);
+        lastFlushAt = now;
     }
 
-    fwrite(body.data(), 1, body.size(), file);
-    fclose(file);
+    if (journal.needsCompaction())
+        compactLocked();
 }
 
-bool PersistedRateLimiter::tryAcquire(std::string& outReason)
+bool PersistedRateLimiter::tryAcquire(Scope scope, std::string& outReason)
 {
     std::lock_guard<std::mutex> lock(mutex);
     loadLocked();
@@ -170,70 +236,59 @@ bool PersistedRateLimiter::tryAcquire(std::string& outReason)
 
     if (now < lastSeen)
     {
-        stamps.assign(static_cast<size_t>(budgetLocked()), now);
+        spendAllLocked(now);
         brls::Logger::warning("Rate limiter: clock moved backwards mid-session, spending this window");
+        compactLocked();
     }
 
     lastSeen = now;
-    pruneLocked(now);
-
-    if (breakerUntil > now)
-    {
-        outReason = std::format("PSN throttled us; requests resume in {}s", breakerUntil - now);
-        return false;
-    }
 
-    int limit = budgetLocked();
-    if (static_cast<int>(stamps.size()) >= limit)
-    {
-        int64_t resetsAt = stamps.empty() ? now : stamps.front() + windowSeconds;
-        outReason = std::format("Request budget used up ({}/{}), resets in {}s",
-            stamps.size(), limit, std::max<int64_t>(0, resetsAt - now));
+    if (!budgetFor(scope).tryAcquire(now, outReason))
         return false;
-    }
-
-    stamps.push_back(now);
-    while (stamps.size() > MAX_STAMPS)
-        stamps.pop_front();
 
-    persistLocked();
+    journal.recordAcquire(static_cast<size_t>(scope), now);
+    flushIfDueLocked(now);
     return true;
 }
 
-void PersistedRateLimiter::recordThrottle(int cooldownSeconds)
+void PersistedRateLimiter::recordThrottle(Scope scope, int cooldownSeconds)
 {
     std::lock_guard<std::mutex> lock(mutex);
     loadLocked();
 
     int64_t now = static_cast<int64_t>(std::time(nullptr));
-    int clamped = std::clamp(cooldownSeconds, 1, BREAKER_MAX_SECONDS);
+    RequestBudget& budget = budgetFor(scope);
+    int64_t breakerUntil = budget.throttle(now, cooldownSeconds);
 
-    breakerUntil = std::max(breakerUntil, now + clamped);
-    throttleCount++;
-    lastThrottleAt = now;
+    brls::Logger::error("Rate limiter: {} throttled by the server ({} lifetime), breaker open for {}s",
+        budgetScopeName(scope), budget.throttles(), breakerUntil - now);
 
-    brls::Logger::error("Rate limiter: throttled by the server ({} lifetime), breaker open for {}s",
-        throttleCount, clamped);
-
-    persistLocked();
+    journal.recordThrottle(static_cast<size_t>(scope), now, breakerUntil);
 }
 
-PersistedRateLimiter::Status PersistedRateLimiter::status() const
+PersistedRateLimiter::Status PersistedRateLimiter::status(Scope scope) const
 {
     std::lock_guard<std::mutex> lock(mutex);
     auto* self = const_cast<PersistedRateLimiter*>(this);
     self->loadLocked();
 
     int64_t now = static_cast<int64_t>(std::time(nullptr));
-    self->pruneLocked(now);
-
-    Status result;
-    result.limit = budgetLocked();
-    result.used = std::min(static_cast<int>(stamps.size()), result.limit);
-    result.bucketResetsAt = (result.used >= result.limit && !stamps.empty())
-        ? stamps.front() + windowSeconds
-        : now;
-    result.breakerUntil = breakerUntil;
-    result.throttleCount = throttleCount;
-    return result;
+    return self->budgetFor(scope).status(now);
+}
+
+void PersistedRateLimiter::flush()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!loaded)
+        return;
+
+    int64_t now = static_cast<int64_t>(std::time(nullptr));
+    lastFlushAt = now - FLUSH_INTERVAL_SECONDS;
+    flushIfDueLocked(now);
+}
+
+void PersistedRateLimiter::close()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    journal.close();
 }
@@ -0,0 +1,191 @@
+#include "core/request_budget.hpp"
+
+#include <algorithm>
+#include <format>
+#include <utility>
+#include <vector>
+
+const char* budgetScopeName(BudgetScope scope)
+{
+    switch (scope)
+    {
+        case BudgetScope::Trophy: return "trophy";
+        case BudgetScope::Presence: return "presence";
+        case BudgetScope::Cloud: return "cloud";
+    }
+    return "unknown";
+}
+
+static int64_t widthFor(int windowSeconds)
+{
+    int64_t buckets = static_cast<int64_t>(SlidingBuckets::BUCKETS);
+    return std::max<int64_t>(1, (windowSeconds + buckets - 1) / buckets);
+}
+
+SlidingBuckets::SlidingBuckets(int windowSeconds)
+    : windowSeconds(std::max(1, windowSeconds))
+    , width(widthFor(this->windowSeconds))
+{
+}
+
+void SlidingBuckets::resize(int newWindowSeconds)
+{
+    newWindowSeconds = std::max(1, newWindowSeconds);
+    if (newWindowSeconds == windowSeconds)
+        return;
+
+    std::vector<std::pair<int64_t, int>> live;
+    forEachLive([&live](int64_t at, int count) { live.emplace_back(at, count); });
+    int64_t newest = head * width + width - 1;
+
+    windowSeconds = newWindowSeconds;
+    width = widthFor(windowSeconds);
+    clear();
+    advance(newest);
+    for (const auto& [at, count] : live)
+        add(at, count);
+}
+
+void SlidingBuckets::clear()
+{
+    counts.fill(0);
+    total = 0;
+    head = 0;
+}
+
+// Steps the newest bucket forward to `now`, emptying every bucket that falls out of the
+// window on the way. A jump of a whole window or more touches each bucket once.
+void SlidingBuckets::advance(int64_t now)
+{
+    int64_t index = now / width;
+    if (index <= head)
+        return;
+
+    int64_t steps = std::min<int64_t>(index - head, static_cast<int64_t>(SPAN));
+    for (int64_t step = 1; step <= steps; step++)
+    {
+        int32_t& count = counts[slotOf(head + step)];
+        total -= count;
+        count = 0;
+    }
+    head = index;
+}
+
+void SlidingBuckets::add(int64_t at, int count)
+{
+    if (count <= 0)
+        return;
+
+    advance(at);
+
+    int64_t index = at / width;
+    if (index <= head - static_cast<int64_t>(SPAN))
+        return;
+
+    counts[slotOf(index)] += count;
+    total += count;
+}
+
+int SlidingBuckets::used(int64_t now)
+{
+    advance(now);
+    return total;
+}
+
+int64_t SlidingBuckets::nextRelease(int64_t now)
+{
+    advance(now);
+    if (total == 0)
+        return now;
+
+    int64_t oldest = head - static_cast<int64_t>(SPAN) + 1;
+    while (oldest < head && counts[slotOf(oldest)] == 0)
+        oldest++;
+    return (oldest + static_cast<int64_t>(SPAN)) * width;
+}
+
+RequestBudget::RequestBudget(int budget, int windowSeconds)
+    : budget(std::max(1, budget))
+    , window(windowSeconds)
+{
+}
+
+void RequestBudget::configure(int newBudget, int windowSeconds)
+{
+    budget = std::max(1, newBudget);
+    window.resize(windowSeconds);
+}
+
+void RequestBudget::reset()
+{
+    window.clear();
+    breakerUntil = 0;
+    throttleCount = 0;
+    lastThrottleAt = 0;
+}
+
+int RequestBudget::limitAt(int64_t now) const
+{
+    if (lastThrottleAt > 0 && now - lastThrottleAt < TIGHTEN_SECONDS)
+        return std::max(1, budget / 2);
+    return budget;
+}
+
+bool RequestBudget::tryAcquire(int64_t now, std::string& outReason)
+{
+    if (breakerUntil > now)
+    {
+        outReason = std::format("PSN throttled us; requests resume in {}s", breakerUntil - now);
+        return false;
+    }
+
+    int limit = limitAt(now);
+    int used = window.used(now);
+    if (used >= limit)
+    {
+        outReason = std::format("Request budget used up ({}/{}), resets in {}s",
+            used, limit, std::max<int64_t>(0, window.nextRelease(now) - now));
+        return false;
+    }
+
+    window.add(now);
+    return true;
+}
+
+int64_t RequestBudget::throttle(int64_t now, int cooldownSeconds)
+{
+    int clamped = std::clamp(cooldownSeconds, 1, BREAKER_MAX_SECONDS);
+    breakerUntil = std::max(breakerUntil, now + clamped);
+    throttleCount++;
+    lastThrottleAt = now;
+    return breakerUntil;
+}
+
+void RequestBudget::spend(int64_t now)
+{
+    window.clear();
+    window.add(now, limitAt(now));
+}
+
+void RequestBudget::restore(int64_t newBreakerUntil, int newThrottleCount, int64_t newLastThrottleAt)
+{
+    breakerUntil = newBreakerUntil;
+    throttleCount = newThrottleCount;
+    lastThrottleAt = newLastThrottleAt;
+}
+
+void RequestBudget::clampBreaker(int64_t now)
+{
+    breakerUntil = std::min(breakerUntil, now + BREAKER_MAX_SECONDS);
+}
+
+RequestBudget::Status RequestBudget::status(int64_t now)
+{
+    Status result;
+    result.limit = limitAt(now);
+    result.used = std::min(window.used(now), result.limit);
+    result.bucketResetsAt = result.used >= result.limit ? window.nextRelease(now) : now;
+    result.breakerUntil = breakerUntil;
+    result.throttleCount = throttleCount;
+    return result;
+}
@@ -0,0 +1,429 @@
+#include "core/sweep_scheduler.hpp"
+
+#include "core/discovery_sweep.hpp"
+
+#include <algorithm>
+#include <bit>
+
+#include <arpa/inet.h>
+
+namespace akira::discovery {
+
+SweepScheduler::SweepScheduler()
+    : SweepScheduler(Config())
+{
+}
+
+SweepScheduler::SweepScheduler(Config config)
+    : config(config)
+{
+}
+
+bool SweepScheduler::addSubnet(uint32_t baseHost, int prefix)
+{
+    if (prefix < MIN_SWEEP_PREFIX || prefix > 32)
+        return false;
+
+    baseHost &= prefixMask(prefix);
+    for (const Subnet& existing : subnets)
+    {
+        // Already swept as part of a wider subnet.
+        if (existing.prefix <= prefix && (baseHost & prefixMask(existing.prefix)) == existing.baseHost)
+            return true;
+    }
+
+    uint32_t count = sweepHostCount(prefix);
+    if (hosts + count > config.maxHosts)
+        return false;
+
+    Subnet subnet;
+    subnet.baseHost = baseHost;
+    subnet.prefix = prefix;
+    subnet.firstSlot = dueAt.size();
+    if (prefix >= 24)
+    {
+        uint32_t last = 0;
+        sweepHostOffsets(prefix, subnet.firstOffset, last);
+        subnet.blocks = 1;
+        subnet.slots = last - subnet.firstOffset + 1;
+    }
+    else
+    {
+        subnet.firstOffset = 0;
+        subnet.blocks = 1u << (24 - prefix);
+        subnet.slots = size_t(subnet.blocks) * ROWS_PER_BLOCK;
+    }
+
+    dueAt.resize(subnet.firstSlot + subnet.slots, 0);
+    silence.resize(dueAt.size(), 0);
+    pending.resize((dueAt.size() + 63) / 64, 0);
+
+    if (subnet.blocks > 1)
+    {
+        // The subnet's own network and broadcast addresses: host byte 0 of the first block
+        // and 255 of the last, which sit in the last two rows.
+        dueAt[subnet.firstSlot + size_t(254) * subnet.blocks] = NEVER;
+        dueAt[subnet.firstSlot + subnet.slots - 1] = NEVER;
+    }
+
+    // Joins a pass already under way rather than waiting for the next one.
+    if (inPass)
+    {
+        for (size_t slot = subnet.firstSlot; slot < dueAt.size(); slot++)
+        {
+            if (dueAt[slot] != NEVER)
+                pending[slot / 64] |= uint64_t(1) << (slot % 64);
+        }
+    }
+    earliestDue = 0;
+
+    subnets.push_back(subnet);
+    hosts += count;
+    return true;
+}
+
+void SweepScheduler::clear()
+{
+    subnets.clear();
+    hosts = 0;
+    dueAt.clear();
+    silence.clear();
+    pending.clear();
+    hotQueue.clear();
+    hotHead = 0;
+    hotBlocks.clear();
+    responders.clear();
+    haveEpoch = false;
+    epochMs = 0;
+    inPass = false;
+    cursor = 0;
+    earliestDue = 0;
+    passes = 0;
+    addressTokens = 0;
+    tokensAtMs = 0;
+    haveTokens = false;
+}
+
+bool SweepScheduler::contains(uint32_t addrNet) const
+{
+    size_t slot = 0;
+    size_t subnet = 0;
+    return slotOf(addrNet, slot, subnet);
+}
+
+std::vector<SweepProbe> SweepScheduler::next(int64_t nowMs)
+{
+    std::vector<SweepProbe> out;
+    uint32_t now = relative(nowMs);
+    size_t budget = config.packetsPerTick;
+
+    std::vector<std::pair<uint32_t, Responder*>> due;
+    for (auto& [addr, responder] : responders)
+    {
+        if (responder.dueMs <= nowMs)
+            due.push_back({addr, &responder});
+    }
+    std::sort(due.begin(), due.end(), [](const auto& a, const auto& b) {
+        return a.second->lastSeenMs > b.second->lastSeenMs;
+    });
+
+    std::vector<uint32_t> forgotten;
+    for (auto& [addr, responder] : due)
+    {
+        if (responder->misses >= config.forgetAfterMisses)
+        {
+            forgotten.push_back(addr);
+            continue;
+        }
+
+        size_t cost = static_cast<size_t>(std::popcount(responder->protocols));
+        if (cost > budget)
+            break;
+        budget -= cost;
+        out.push_back({addr, responder->protocols});
+
+        responder->misses++;
+        if (responder->misses <= config.responderMisses)
+            responder->dueMs = nowMs + config.responderIntervalMs;
+        else
+            responder->dueMs = nowMs + silentDelay(responder->misses - config.responderMisses);
+    }
+    for (uint32_t addr : forgotten)
+        forget(addr, now);
+
+    if (!inPass)
+    {
+        if (dueAt.empty() || now < earliestDue)
+            return out;
+        beginPass(now);
+    }
+
+    refillTokens(nowMs);
+    while (budget >= 2 && addressTokens >= 1)
+    {
+        size_t slot = 0;
+        if (hotHead < hotQueue.size())
+        {
+            slot = hotQueue[hotHead++];
+        }
+        else
+        {
+            size_t word = cursor / 64;
+            uint64_t bits = word < pending.size() ? pending[word] & (~uint64_t(0) << (cursor % 64)) : 0;
+            while (bits == 0 && ++word < pending.size())
+                bits = pending[word];
+
+            if (bits == 0)
+            {
+                inPass = false;
+                passes++;
+                break;
+            }
+
+            slot = word * 64 + static_cast<size_t>(std::countr_zero(bits));
+            pending[word] &= ~(uint64_t(1) << (slot % 64));
+            cursor = slot + 1;
+        }
+
+        if (dueAt[slot] == NEVER)
+            continue;
+        probeSlot(slot, now, out);
+        budget -= 2;
+        addressTokens -= 1;
+    }
+
+    return out;
+}
+
+void SweepScheduler::noteResponse(uint32_t addrNet, uint8_t protocols, int64_t nowMs)
+{
+    relative(nowMs);
+    size_t slot = 0;
+    size_t subnetIndex = 0;
+    if (!slotOf(addrNet, slot, subnetIndex))
+        return;
+
+    protocols &= SWEEP_BOTH;
+    if (protocols == 0)
+        protocols = SWEEP_BOTH;
+
+    auto it = responders.find(addrNet);
+    if (it != responders.end())
+    {
+        // A reply that does not name its protocol keeps what is already known.
+        if (protocols != SWEEP_BOTH)
+            it->second.protocols = protocols;
+        it->second.misses = 0;
+        it->second.lastSeenMs = nowMs;
+        it->second.dueMs = nowMs + config.responderIntervalMs;
+        return;
+    }
+
+    if (responders.size() >= config.maxResponders)
+        return;
+
+    responders[addrNet] = Responder{protocols, 0, nowMs, nowMs + config.responderIntervalMs};
+    dueAt[slot] = NEVER;
+    silence[slot] = 0;
+    takePending(slot);
+
+    const Subnet& subnet = subnets[subnetIndex];
+    if (subnet.blocks == 1)
+        return;
+
+    uint32_t block = static_cast<uint32_t>((slot - subnet.firstSlot) % subnet.blocks);
+    for (const Block& hot : hotBlocks)
+    {
+        if (hot.subnet == subnetIndex && hot.block == block)
+            return;
+    }
+    hotBlocks.push_back({subnetIndex, block});
+
+    // Consoles tend to share a /24: finish this block before the rest of the pass.
+    if (inPass)
+    {
+        for (uint32_t row = 0; row < ROWS_PER_BLOCK; row++)
+        {
+            size_t neighbour = subnet.firstSlot + size_t(row) * subnet.blocks + block;
+            if (takePending(neighbour))
+                hotQueue.push_back(neighbour);
+        }
+    }
+}
+
+uint8_t SweepScheduler::protocolsOf(uint32_t addrNet) const
+{
+    auto it = responders.find(addrNet);
+    return it == responders.end() ? 0 : it->second.protocols;
+}
+
+SweepScheduler::Stats SweepScheduler::stats() const
+{
+    Stats s;
+    s.hosts = hosts;
+    s.responders = responders.size();
+    s.passes = passes;
+    if (inPass)
+    {
+        s.pending = hotQueue.size() - hotHead;
+        for (uint64_t word : pending)
+            s.pending += static_cast<size_t>(std::popcount(word));
+    }
+    return s;
+}
+
+uint32_t SweepScheduler::relative(int64_t nowMs)
+{
+    if (!haveEpoch)
+    {
+        haveEpoch = true;
+        epochMs = nowMs;
+    }
+    int64_t elapsed = nowMs - epochMs;
+    if (elapsed < 0)
+        return 0;
+    if (elapsed >= int64_t(NEVER))
+        return NEVER - 1;
+    return static_cast<uint32_t>(elapsed);
+}
+
+int64_t SweepScheduler::silentDelay(int streak) const
+{
+    if (streak <= 0)
+        return 0;
+    int shift = std::min(streak - 1, 20);
+    return std::min(config.silentBaseMs << shift, config.silentMaxMs);
+}
+
+void SweepScheduler::refillTokens(int64_t nowMs)
+{
+    double burst = static_cast<double>(config.burstAddresses);
+    if (!haveTokens)
+    {
+        haveTokens = true;
+        addressTokens = burst;
+        tokensAtMs = nowMs;
+        return;
+    }
+    if (nowMs <= tokensAtMs)
+        return;
+
+    double earned = double(nowMs - tokensAtMs) * double(config.sustainedAddressesPerSecond) / 1000.0;
+    addressTokens = std::min(burst, addressTokens + earned);
+    tokensAtMs = nowMs;
+}
+
+bool SweepScheduler::slotOf(uint32_t addrNet, size_t& slot, size_t& subnetIndex) const
+{
+    uint32_t host = ntohl(addrNet);
+    for (size_t i = 0; i < subnets.size(); i++)
+    {
+        const Subnet& subnet = subnets[i];
+        if ((host & prefixMask(subnet.prefix)) != subnet.baseHost)
+            continue;
+
+        uint32_t offset = host - subnet.baseHost;
+        size_t index = 0;
+        if (subnet.blocks == 1)
+        {
+            if (offset < subnet.firstOffset || offset - subnet.firstOffset >= subnet.slots)
+                return false;
+            index = offset - subnet.firstOffset;
+        }
+        else
+        {
+            if (offset == 0 || offset == subnetAddrCount(subnet.prefix) - 1)
+                return false;
+            uint32_t hostByte = offset & 0xFF;
+            uint32_t row = hostByte == 0 ? 254 : hostByte == 255 ? 255 : hostByte - 1;
+            index = size_t(row) * subnet.blocks + (offset >> 8);
+        }
+
+        slot = subnet.firstSlot + index;
+        subnetIndex = i;
+        return true;
+    }
+    return false;
+}
+
+uint32_t SweepScheduler::addrOf(const Subnet& subnet, size_t index) const
+{
+    if (subnet.blocks == 1)
+        return sweepAddrNet(subnet.baseHost, subnet.firstOffset + static_cast<uint32_t>(index));
+
+    // Slots run host byte first, so a pass reaches .1 of every block before .2 of any.
+    uint32_t row = static_cast<uint32_t>(index / subnet.blocks);
+    uint32_t block = static_cast<uint32_t>(index % subnet.blocks);
+    uint32_t hostByte = row < 254 ? row + 1 : row == 254 ? 0 : 255;
+    return sweepAddrNet(subnet.baseHost, block * 256 + hostByte);
+}
+
+bool SweepScheduler::takePending(size_t slot)
+{
+    uint64_t bit = uint64_t(1) << (slot % 64);
+    if (slot / 64 >= pending.size() || !(pending[slot / 64] & bit))
+        return false;
+    pending[slot / 64] &= ~bit;
+    return true;
+}
+
+void SweepScheduler::beginPass(uint32_t now)
+{
+    inPass = true;
+    cursor = 0;
+    hotQueue.clear();
+    hotHead = 0;
+    earliestDue = NEVER;
+
+    std::fill(pending.begin(), pending.end(), 0);
+    for (size_t slot = 0; slot < dueAt.size(); slot++)
+    {
+        if (dueAt[slot] <= now)
+            pending[slot / 64] |= uint64_t(1) << (slot % 64);
+        else if (dueAt[slot] < earliestDue)
+            earliestDue = dueAt[slot];
+    }
+
+    for (const Block& hot : hotBlocks)
+    {
+        const Subnet& subnet = subnets[hot.subnet];
+        for (uint32_t row = 0; row < ROWS_PER_BLOCK; row++)
+        {
+            size_t slot = subnet.firstSlot + size_t(row) * subnet.blocks + hot.block;
+            if (takePending(slot))
+                hotQueue.push_back(slot);
+        }
+    }
+}
+
+void SweepScheduler::probeSlot(size_t slot, uint32_t now, std::vector<SweepProbe>& out)
+{
+    auto subnet = std::upper_bound(subnets.begin(), subnets.end(), slot,
+        [](size_t value, const Subnet& s) { return value < s.firstSlot; });
+    --subnet;
+    out.push_back({addrOf(*subnet, slot - subnet->firstSlot), SWEEP_BOTH});
+
+    if (silence[slot] < 255)
+        silence[slot]++;
+    int64_t due = int64_t(now) + silentDelay(silence[slot]);
+    dueAt[slot] = due >= int64_t(NEVER) ? NEVER - 1 : static_cast<uint32_t>(due);
+    earliestDue = std::min(earliestDue, dueAt[slot]);
+}
+
+void SweepScheduler::forget(uint32_t addrNet, uint32_t now)
+{
+    responders.erase(addrNet);
+
+    size_t slot = 0;
+    size_t subnetIndex = 0;
+    if (!slotOf(addrNet, slot, subnetIndex))
+        return;
+
+    int streak = std::min(config.forgetAfterMisses - config.responderMisses, 255);
+    silence[slot] = static_cast<uint8_t>(std::max(streak, 1));
+    int64_t due = int64_t(now) + silentDelay(silence[slot]);
+    dueAt[slot] = due >= int64_t(NEVER) ? NEVER - 1 : static_cast<uint32_t>(due);
+    earliestDue = std::min(earliestDue, dueAt[slot]);
+}
+
+} // namespace akira::discovery
@@ -0,0 +1,81 @@
+#include "core/timer_wheel.hpp"
+
+#include <algorithm>
+
+TimerWheel::TimerWheel(int64_t tickMs, size_t slotCount, int64_t startMs)
+    : tickMs(std::max<int64_t>(1, tickMs))
+    , slots(std::max<size_t>(1, slotCount))
+    , cursor(startMs / this->tickMs)
+{
+}
+
+void TimerWheel::schedule(int64_t dueMs, Callback callback)
+{
+    int64_t dueTick = (dueMs + tickMs - 1) / tickMs;
+    dueTick = std::max(dueTick, cursor + 1);
+
+    slots[static_cast<size_t>(dueTick) % slots.size()].push_back({dueTick, scheduled++, std::move(callback)});
+    pending++;
+}
+
+size_t TimerWheel::advance(int64_t nowMs, std::vector<Callback>& outDue)
+{
+    int64_t target = nowMs / tickMs;
+    if (target <= cursor)
+        return 0;
+
+    // A jump longer than one revolution only needs each slot visited once.
+    int64_t steps = std::min<int64_t>(target - cursor, static_cast<int64_t>(slots.size()));
+    std::vector<Entry> due;
+
+    for (int64_t step = 1; step <= steps; step++)
+    {
+        std::vector<Entry>& slot = slots[static_cast<size_t>(cursor + step) % slots.size()];
+
+        auto keep = std::partition(slot.begin(), slot.end(),
+            [target](const Entry& entry) { return entry.dueTick > target; });
+
+        for (auto it = keep; it != slot.end(); ++it)
+            due.push_back(std::move(*it));
+        slot.erase(keep, slot.end());
+    }
+
+    cursor = target;
+    pending -= due.size();
+
+    std::sort(due.begin(), due.end(), [](const Entry& a, const Entry& b) {
+        return a.dueTick != b.dueTick ? a.dueTick < b.dueTick : a.order < b.order;
+    });
+
+    for (Entry& entry : due)
+        outDue.push_back(std::move(entry.callback));
+    return due.size();
+}
+
+int64_t TimerWheel::nextDueMs() const
+{
+    if (pending == 0)
+        return NOTHING_DUE;
+
+    // Walk one revolution ahead of the cursor; the first slot holding an entry for the
+    // current round has the earliest deadline. Only far-future entries need the full scan.
+    int64_t earliest = INT64_MAX;
+    for (size_t step = 1; step <= slots.size(); step++)
+    {
+        int64_t tick = cursor + static_cast<int64_t>(step);
+        for (const Entry& entry : slots[static_cast<size_t>(tick) % slots.size()])
+        {
+            if (entry.dueTick == tick)
+                return tick * tickMs;
+            earliest = std::min(earliest, entry.dueTick);
+        }
+    }
+    return earliest * tickMs;
+}
+
+void TimerWheel::clear()
+{
+    for (std::vector<Entry>& slot : slots)
+        slot.clear();
+    pending = 0;
+}
@@ -2,12 +2,12 @@
 #include "core/settings_manager.hpp"
 #include "psn/auth.hpp"
 #include "psn/log.hpp"
+#include "psn/snapshot.hpp"
 
 #include <chiaki/base64.h>
 
 #include <borealis.hpp>
 #include <algorithm>
-#include <cerrno>
 #include <cstdio>
 #include <cstring>
 #include <format>
@@ -21,6 +21,7 @@
 
 #include <json-c/json.h>
 
+#include "util/file_io.hpp"
 #include "util/http.hpp"
 
 static void forwardPsnLog(psn::LogLevel level, const std::string& message)
@@ -42,7 +43,7 @@ TrophyManager* TrophyManager::getInstance()
 TrophyManager::TrophyManager()
 {
     settings = SettingsManager::getInstance();
-    limiter.reconfigure(settings->getPsnRequestBudget(), settings->getPsnRequestWindowSeconds());
+    limiter.reconfigure(BudgetScope::Trophy, settings->getPsnRequestBudget(), settings->getPsnRequestWindowSeconds());
     limiter.retarget(rateLimitPath());
     psn::setLogSink(forwardPsnLog);
 }
@@ -75,12 +76,12 @@ std::string TrophyManager::accountCacheDir() const
     return std::string(TROPHY_CACHE_DIR) + "/" + accountKey();
 }
 
-std::string TrophyManager::summaryCachePath() const { return accountCacheDir() + "/summary.json"; }
-std::string TrophyManager::libraryCachePath() const { return accountCacheDir() + "/library.json"; }
+std::string TrophyManager::summaryCachePath() const { return accountCacheDir() + "/summary.bin"; }
+std::string TrophyManager::libraryCachePath() const { return accountCacheDir() + "/library.bin"; }
 std::string TrophyManager::detailCacheDir() const { return accountCacheDir() + "/detail"; }
 std::string TrophyManager::titleMapPath() const { return accountCacheDir() + "/title_map.json"; }
 std::string TrophyManager::forceStatePath() const { return accountCacheDir() + "/refresh_state.json"; }
-std::string TrophyManager::rateLimitPath() const { return accountCacheDir() + "/ratelimit.json"; }
+std::string TrophyManager::rateLimitPath() const { return accountCacheDir() + "/ratelimit.journal"; }
 
 static void removeCacheTree(const std::string& path)
 {
@@ -104,6 +105,13 @@ static void removeCacheTree(const std::string& path)
 
 void TrophyManager::flushCache()
 {
+    {
+        std::lock_guard<std::mutex> storeLock(iconStoreMutex);
+        if (iconCompactor.joinable())
+            iconCompactor.join();
+        iconStore.close();
+        iconStoreReady.store(false);
+    }
     {
         std::lock_guard<std::mutex> lock(mutex);
         removeCacheTree(TROPHY_CACHE_DIR);
@@ -132,7 +140,7 @@ void TrophyManager::onActiveProfileChanged()
         cachedProfile = psn::PsnProfile{};
     }
     ensureCacheDirs();
-    limiter.reconfigure(settings->getPsnRequestBudget(), settings->getPsnRequestWindowSeconds());
+    limiter.reconfigure(BudgetScope::Trophy, settings->getPsnRequestBudget(), settings->getPsnRequestWindowSeconds());
     limiter.retarget(rateLimitPath());
     brls::Logger::info("Trophy: active profile changed, budget repointed to {}", rateLimitPath());
 }
@@ -145,15 +153,56 @@ void TrophyManager::ensureCacheDirs()
     mkdir(detailCacheDir().c_str(), 0755);
 }
 
-void TrophyManager::ensureIconCacheDir()
+// Icons used to be stored one .img file per URL; those are swept away the first time the
+// pack is opened so they stop counting against the SD card.
+static void removeLegacyIconFiles(const char* directory)
 {
-    if (iconCacheDirReady.load())
+    DIR* dir = opendir(directory);
+    if (!dir)
+        return;
+
+    int removed = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr)
+    {
+        std::string name = entry->d_name;
+        if (name.ends_with(".img") || name.ends_with(".img.tmp"))
+        {
+            remove(std::format("{}/{}", directory, name).c_str());
+            removed++;
+        }
+    }
+    closedir(dir);
+
+    if (removed > 0)
+        brls::Logger::info("Trophy: removed {} loose icon file(s) left from the old cache layout", removed);
+}
+
+void TrophyManager::ensureIconStore()
+{
+    if (iconStoreReady.load())
+        return;
+
+    std::lock_guard<std::mutex> lock(iconStoreMutex);
+    if (iconStoreReady.load())
         return;
 
     ensureCacheDirs();
     mkdir(ICON_CACHE_DIR, 0755);
+    removeLegacyIconFiles(ICON_CACHE_DIR);
 
-    iconCacheDirReady.store(true);
+    if (iconStore.open())
+    {
+        IconStore::Stats stats = iconStore.stats();
+        brls::Logger::info("Trophy: icon pack holds {} icon(s), {} of {} bytes live",
+            stats.entries, stats.liveBytes, stats.packBytes);
+    }
+    else
+    {
+        stopIconDiskWrites(std::format("could not open the icon pack in {}", ICON_CACHE_DIR));
+    }
+
+    iconStoreReady.store(true);
 }
 
 bool TrophyManager::cacheEntryFresh(int64_t savedAt, int ttlMinutes)
@@ -169,127 +218,36 @@ bool TrophyManager::cacheEntryFresh(int64_t savedAt, int ttlMinutes)
     return (now - savedAt) < static_cast<int64_t>(ttlMinutes) * 60;
 }
 
-static std::string readWholeFile(const std::string& path)
-{
-    FILE* file = fopen(path.c_str(), "rb");
-    if (!file)
-        return std::string();
-
-    std::string body;
-    char buffer[4096];
-    size_t read = 0;
-    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
-        body.append(buffer, read);
-
-    fclose(file);
-    return body;
-}
-
-static bool replaceFile(const std::string& temp, const std::string& path)
-{
-    remove(path.c_str());
-
-    if (rename(temp.c_str(), path.c_str()) == 0)
-        return true;
-
-    brls::Logger::warning("Trophy: rename {} -> {} failed: {}", temp, path, strerror(errno));
-    remove(temp.c_str());
-    return false;
-}
-
-static bool writeWholeFile(const std::string& path, const std::string& body)
-{
-    std::string temp = path + ".tmp";
-
-    FILE* file = fopen(temp.c_str(), "wb");
-    if (!file)
-    {
-        brls::Logger::warning("Trophy: could not open {}: {}", temp, strerror(errno));
-        return false;
-    }
-
-    size_t written = fwrite(body.data(), 1, body.size(), file);
-    fclose(file);
-
-    if (written != body.size())
-    {
-        brls::Logger::warning("Trophy: short write to {} ({}/{} bytes)", temp, written, body.size());
-        remove(temp.c_str());
-        return false;
-    }
-
-    return replaceFile(temp, path);
-}
-
 bool TrophyManager::loadSummaryFromDisk(psn::TrophySummary& outSummary, int64_t& outSavedAt) const
 {
-    psn::Json doc(readWholeFile(summaryCachePath()));
-    if (!doc)
-        return false;
-
-    outSavedAt = psn::jsonInt64(doc.get(), "savedAt");
-
-    json_object* payload = nullptr;
-    if (!psn::jsonField(doc.get(), "summary", &payload))
-        return false;
-
-    return psn::parseSummary(payload, outSummary);
+    return psn::loadCacheFile(summaryCachePath(), outSummary, outSavedAt);
 }
 
 void TrophyManager::saveSummaryToDisk(const psn::TrophySummary& summary) const
 {
-    json_object* root = json_object_new_object();
-    json_object_object_add(root, "savedAt", json_object_new_int64(static_cast<int64_t>(std::time(nullptr))));
-    json_object_object_add(root, "summary", psn::toJson(summary));
-
-    const char* text = json_object_to_json_string(root);
-    if (!writeWholeFile(summaryCachePath(), text ? text : ""))
+    if (!akira::fileio::replace(summaryCachePath(), psn::encodeSnapshot(summary, static_cast<int64_t>(std::time(nullptr)))))
+    {
         brls::Logger::warning("Trophy: could not write {}", summaryCachePath());
+        return;
+    }
 
-    json_object_put(root);
+    remove(psn::legacyCachePath(summaryCachePath()).c_str());
 }
 
 bool TrophyManager::loadLibraryFromDisk(std::vector<psn::TrophyTitle>& outTitles, int64_t& outSavedAt) const
 {
-    psn::Json doc(readWholeFile(libraryCachePath()));
-    if (!doc)
-        return false;
-
-    outSavedAt = psn::jsonInt64(doc.get(), "savedAt");
-
-    json_object* array = nullptr;
-    if (!psn::jsonField(doc.get(), "titles", &array) || !json_object_is_type(array, json_type_array))
-        return false;
-
-    size_t count = json_object_array_length(array);
-    outTitles.reserve(count);
-
-    for (size_t i = 0; i < count; i++)
-    {
-        psn::TrophyTitle title;
-        if (psn::parseTitle(json_object_array_get_idx(array, i), title))
-            outTitles.push_back(std::move(title));
-    }
-
-    return true;
+    return psn::loadCacheFile(libraryCachePath(), outTitles, outSavedAt);
 }
 
 void TrophyManager::saveLibraryToDisk(const std::vector<psn::TrophyTitle>& titles) const
 {
-    json_object* array = json_object_new_array();
-
-    for (const psn::TrophyTitle& title : titles)
-        json_object_array_add(array, psn::toJson(title));
-
-    json_object* root = json_object_new_object();
-    json_object_object_add(root, "savedAt", json_object_new_int64(static_cast<int64_t>(std::time(nullptr))));
-    json_object_object_add(root, "titles", array);
-
-    const char* text = json_object_to_json_string(root);
-    if (!writeWholeFile(libraryCachePath(), text ? text : ""))
+    if (!akira::fileio::replace(libraryCachePath(), psn::encodeSnapshot(titles, static_cast<int64_t>(std::time(nullptr)))))
+    {
         brls::Logger::warning("Trophy: could not write {}", libraryCachePath());
+        return;
+    }
 
-    json_object_put(root);
+    remove(psn::legacyCachePath(libraryCachePath()).c_str());
 }
 
 std::string TrophyManager::detailCachePath(const std::string& npCommunicationId) const
@@ -304,86 +262,92 @@ std::string TrophyManager::detailCachePath(const std::string& npCommunicationId)
         safe += allowed ? c : '_';
     }
 
-    return std::format("{}/{}.json", detailCacheDir(), safe);
+    return std::format("{}/{}.bin", detailCacheDir(), safe);
 }
 
 bool TrophyManager::loadDetailFromDisk(const std::string& npCommunicationId,
     psn::TitleDetail& outDetail, int64_t& outSavedAt) const
 {
-    psn::Json doc(readWholeFile(detailCachePath(npCommunicationId)));
-    if (!doc)
-        return false;
-
-    outSavedAt = psn::jsonInt64(doc.get(), "savedAt");
-    outDetail.npCommunicationId = psn::jsonString(doc.get(), "npCommunicationId");
-    outDetail.npServiceName = psn::jsonString(doc.get(), "npServiceName");
-    outDetail.lastUpdatedDateTime = psn::jsonString(doc.get(), "lastUpdatedDateTime");
+    return psn::loadCacheFile(detailCachePath(npCommunicationId), outDetail, outSavedAt) &&
+        outDetail.npCommunicationId == npCommunicationId;
+}
 
-    if (outDetail.npCommunicationId != npCommunicationId)
-        return false;
+void TrophyManager::saveDetailToDisk(const psn::TitleDetail& detail) const
+{
+    std::string path = detailCachePath(detail.npCommunicationId);
 
-    json_object* groups = nullptr;
-    if (psn::jsonField(doc.get(), "groups", &groups) && json_object_is_type(groups, json_type_array))
+    if (!akira::fileio::replace(path, psn::encodeSnapshot(detail, static_cast<int64_t>(std::time(nullptr)))))
     {
-        size_t count = json_object_array_length(groups);
-        for (size_t i = 0; i < count; i++)
-        {
-            psn::TrophyGroup group;
-            if (psn::parseCachedGroup(json_object_array_get_idx(groups, i), group))
-                outDetail.groups.push_back(std::move(group));
-        }
+        brls::Logger::warning("Trophy: could not write the detail cache for {}", detail.npCommunicationId);
+        return;
     }
 
-    json_object* trophies = nullptr;
-    if (!psn::jsonField(doc.get(), "trophies", &trophies) || !json_object_is_type(trophies, json_type_array))
-        return false;
-
-    size_t count = json_object_array_length(trophies);
-    outDetail.trophies.reserve(count);
+    remove(psn::legacyCachePath(path).c_str());
+}
 
-    for (size_t i = 0; i < count; i++)
-    {
-        psn::Trophy trophy;
-        if (psn::parseCachedTrophy(json_object_array_get_idx(trophies, i), trophy))
-            outDetail.trophies.push_back(std::move(trophy));
-    }
+bool TrophyManager::detailOnDisk(const std::string& npCommunicationId) const
+{
+    std::string path = detailCachePath(npCommunicationId);
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 || stat(psn::legacyCachePath(path).c_str(), &st) == 0;
+}
 
-    return !outDetail.trophies.empty();
+void TrophyManager::removeDetailFromDisk(const std::string& npCommunicationId) const
+{
+    std::string path = detailCachePath(npCommunicationId);
+    remove(path.c_str());
+    remove(psn::legacyCachePath(path).c_str());
 }
 
-void TrophyManager::saveDetailToDisk(const psn::TitleDetail& detail) const
+int TrophyManager::exportCacheAsJson()
 {
-    json_object* groups = json_object_new_array();
-    for (const psn::TrophyGroup& group : detail.groups)
-        json_object_array_add(groups, psn::toJson(group));
+    std::string exportDir = accountCacheDir() + "/export";
+    mkdir(exportDir.c_str(), 0755);
 
-    json_object* trophies = json_object_new_array();
-    for (const psn::Trophy& trophy : detail.trophies)
-        json_object_array_add(trophies, psn::toJson(trophy));
+    std::vector<std::pair<std::string, std::string>> files = {
+        {summaryCachePath(), "summary"},
+        {libraryCachePath(), "library"},
+    };
 
-    json_object* root = json_object_new_object();
-    json_object_object_add(root, "savedAt", json_object_new_int64(static_cast<int64_t>(std::time(nullptr))));
-    json_object_object_add(root, "npCommunicationId", json_object_new_string(detail.npCommunicationId.c_str()));
-    json_object_object_add(root, "npServiceName", json_object_new_string(detail.npServiceName.c_str()));
-    json_object_object_add(root, "lastUpdatedDateTime", json_object_new_string(detail.lastUpdatedDateTime.c_str()));
-    json_object_object_add(root, "groups", groups);
-    json_object_object_add(root, "trophies", trophies);
+    if (DIR* dir = opendir(detailCacheDir().c_str()))
+    {
+        while (struct dirent* entry = readdir(dir))
+        {
+            std::string name = entry->d_name;
+            if (name.size() > 4 && name.ends_with(".bin"))
+                files.emplace_back(detailCacheDir() + "/" + name, "detail_" + name.substr(0, name.size() - 4));
+        }
+        closedir(dir);
+    }
 
-    const char* text = json_object_to_json_string(root);
-    if (!writeWholeFile(detailCachePath(detail.npCommunicationId), text ? text : ""))
-        brls::Logger::warning("Trophy: could not write the detail cache for {}", detail.npCommunicationId);
+    int exported = 0;
+    for (const auto& [path, name] : files)
+    {
+        std::string json;
+        if (!psn::snapshotToJson(akira::fileio::readAll(path), json))
+            continue;
 
-    json_object_put(root);
+        if (akira::fileio::replace(std::format("{}/{}.json", exportDir, name), json))
+            exported++;
+    }
+
+    brls::Logger::info("Trophy: exported {} cache file(s) as JSON to {}", exported, exportDir);
+    return exported;
+}
+
+PersistedRateLimiter::Status TrophyManager::budgetStatus(BudgetScope scope) const
+{
+    return limiter.status(scope);
 }
 
-PersistedRateLimiter::Status TrophyManager::budgetStatus() const
+bool TrophyManager::claimRequestBudget(BudgetScope scope, std::string& outReason)
 {
-    return limiter.status();
+    return limiter.tryAcquire(scope, outReason);
 }
 
 void TrophyManager::reconfigureLimiter()
 {
-    limiter.reconfigure(settings->getPsnRequestBudget(), settings->getPsnRequestWindowSeconds());
+    limiter.reconfigure(BudgetScope::Trophy, settings->getPsnRequestBudget(), settings->getPsnRequestWindowSeconds());
 }
 
 int64_t TrophyManager::librarySavedAtSeconds() const
@@ -399,7 +363,7 @@ void TrophyManager::loadForceStateLocked()
 
     forceStateLoaded = true;
 
-    psn::Json doc(readWholeFile(forceStatePath()));
+    psn::Json doc(akira::fileio::readAll(forceStatePath()));
     if (!doc)
         return;
 
@@ -418,7 +382,7 @@ void TrophyManager::saveForceStateLocked() const
         json_object_object_add(root, entry.first.c_str(), json_object_new_int64(entry.second));
 
     const char* text = json_object_to_json_string(root);
-    if (!writeWholeFile(forceStatePath(), text ? text : ""))
+    if (!akira::fileio::replace(forceStatePath(), text ? text : ""))
         brls::Logger::warning("Trophy: could not write {}", forceStatePath());
 
     json_object_put(root);
@@ -431,7 +395,7 @@ void TrophyManager::loadTitleMapLocked()
 
     titleMapLoaded = true;
 
-    psn::Json doc(readWholeFile(titleMapPath()));
+    psn::Json doc(akira::fileio::readAll(titleMapPath()));
     if (!doc)
         return;
 
@@ -464,7 +428,7 @@ void TrophyManager::saveTitleMapLocked() const
     }
 
     const char* text = json_object_to_json_string(root);
-    if (!writeWholeFile(titleMapPath(), text ? text : ""))
+    if (!akira::fileio::replace(titleMapPath(), text ? text : ""))
         brls::Logger::warning("Trophy: could not write {}", titleMapPath());
 
     json_object_put(root);
@@ -652,70 +616,32 @@ void TrophyManager::recordForcedRefresh(const std::string& scope)
         scope, FORCE_REFRESH_COOLDOWN_MINUTES);
 }
 
-std::string TrophyManager::iconCachePath(const std::string& url) const
-{
-    uint64_t hash = 1469598103934665603ULL;
-    for (unsigned char c : url)
-    {
-        hash ^= c;
-        hash *= 1099511628211ULL;
-    }
-
-    return std::format("{}/{:016x}.img", ICON_CACHE_DIR, hash);
-}
-
-bool TrophyManager::readIconFromDisk(const std::string& path, std::vector<uint8_t>& outBytes) const
-{
-    FILE* file = fopen(path.c_str(), "rb");
-    if (!file)
-        return false;
-
-    fseek(file, 0, SEEK_END);
-    long size = ftell(file);
-    fseek(file, 0, SEEK_SET);
-
-    if (size <= 0 || static_cast<size_t>(size) > ICON_MAX_BYTES)
-    {
-        fclose(file);
-        return false;
-    }
-
-    outBytes.resize(static_cast<size_t>(size));
-    size_t read = fread(outBytes.data(), 1, outBytes.size(), file);
-    fclose(file);
-
-    if (read != outBytes.size())
-    {
-        outBytes.clear();
-        return false;
-    }
-
-    return true;
-}
-
-void TrophyManager::writeIconToDisk(const std::string& path, const std::vector<uint8_t>& bytes)
+void TrophyManager::compactIconStoreIfNeeded()
 {
-    std::string temp = path + ".tmp";
-
-    FILE* file = fopen(temp.c_str(), "wb");
-    if (!file)
-    {
-        stopIconDiskWrites(std::format("could not open {}: {}", temp, strerror(errno)));
+    if (!iconStore.needsCompaction() || iconCompacting.exchange(true))
         return;
-    }
 
-    size_t written = fwrite(bytes.data(), 1, bytes.size(), file);
-    fclose(file);
+    // Copying a pack of up to 64 MB would hold one of the pool's few network workers for
+    // the whole copy, so it gets a thread of its own at the lowest priority instead.
+    std::lock_guard<std::mutex> storeLock(iconStoreMutex);
+    if (iconCompactor.joinable())
+        iconCompactor.join();
 
-    if (written != bytes.size())
-    {
-        remove(temp.c_str());
-        stopIconDiskWrites(std::format("short write to {} ({}/{} bytes)", temp, written, bytes.size()));
-        return;
-    }
+    iconCompactor = std::thread([this]() {
+        svcSetThreadPriority(CUR_THREAD_HANDLE, 0x3F);
 
-    if (!replaceFile(temp, path))
-        stopIconDiskWrites(std::format("could not replace {}", path));
+        IconStore::Stats before = iconStore.stats();
+        if (iconStore.compact())
+        {
+            brls::Logger::info("Trophy: compacted the icon pack from {} to {} bytes",
+                before.packBytes, iconStore.stats().packBytes);
+        }
+        else
+        {
+            brls::Logger::warning("Trophy: icon pack compaction failed, the old pack is still in use");
+        }
+        iconCompacting.store(false);
+    });
 }
 
 void TrophyManager::stopIconDiskWrites(const std::string& reason)
@@ -726,32 +652,42 @@ void TrophyManager::stopIconDiskWrites(const std::string& reason)
     brls::Logger::error("Trophy: icon disk cache disabled for this session ({}); icons will still load from memory", reason);
 }
 
-void TrophyManager::storeIconInMemory(const std::string& url, const std::vector<uint8_t>& bytes)
+void TrophyManager::storeImageInMemory(ImageCache& cache, const std::string& url, const std::vector<uint8_t>& bytes)
 {
+    cache.put(url, bytes);
+
     std::lock_guard<std::mutex> lock(iconMutex);
+    if (&cache == &iconCache && url == pinnedAvatarUrl && !avatarPinned)
+        avatarPinned = iconCache.pin(url);
+}
 
-    if (iconCache.find(url) == iconCache.end())
-    {
-        iconCacheBytes += bytes.size();
-        iconCache[url] = bytes;
-        iconOrder.push_back(url);
-    }
+// The avatar sits in the header of most views, so it is kept out of reach of eviction.
+void TrophyManager::pinAvatar(const std::string& url)
+{
+    std::lock_guard<std::mutex> lock(iconMutex);
 
-    while (iconCacheBytes > ICON_CACHE_MAX_BYTES && !iconOrder.empty())
-    {
-        const std::string oldest = iconOrder.front();
-        iconOrder.pop_front();
+    if (url == pinnedAvatarUrl)
+        return;
 
-        if (oldest == url)
-            continue;
+    if (avatarPinned)
+        iconCache.unpin(pinnedAvatarUrl);
 
-        auto entry = iconCache.find(oldest);
-        if (entry != iconCache.end())
-        {
-            iconCacheBytes -= entry->second.size();
-            iconCache.erase(entry);
-        }
-    }
+    pinnedAvatarUrl = url;
+    avatarPinned = !url.empty() && iconCache.pin(url);
+}
+
+void TrophyManager::logCacheMetrics() const
+{
+    auto describe = [](const char* name, const akira::CacheMetrics& m) {
+        brls::Logger::info("Trophy: {} cache {} entries, {}/{} KB, {} hits, {} misses ({:.0f}%), {} evictions",
+            name, m.entries, m.bytes / 1024, m.budget / 1024, m.hits, m.misses, m.hitRate() * 100.0, m.evictions);
+    };
+
+    describe("icon", iconCache.metrics());
+    describe("artwork", artworkCache.metrics());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    describe("detail", cachedDetails.metrics());
 }
 
 bool TrophyManager::hasConnectivity() const
@@ -773,31 +709,13 @@ bool TrophyManager::hasConnectivity() const
     return status == NifmInternetConnectionStatus_Connected;
 }
 
-void TrophyManager::awaitBurstSlot()
+int64_t TrophyManager::claimBurstSlot()
 {
-    while (true)
-    {
-        std::chrono::steady_clock::time_point waitUntil;
-
-        {
-            std::lock_guard<std::mutex> lock(mutex);
-
-            auto now = std::chrono::steady_clock::now();
-            auto cutoff = now - std::chrono::milliseconds(BURST_WINDOW_MS);
-            while (!burstWindow.empty() && burstWindow.front() <= cutoff)
-                burstWindow.pop_front();
+    int64_t nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
 
-            if (static_cast<int>(burstWindow.size()) < BURST_LIMIT)
-            {
-                burstWindow.push_back(now);
-                return;
-            }
-
-            waitUntil = burstWindow.front() + std::chrono::milliseconds(BURST_WINDOW_MS);
-        }
-
-        std::this_thread::sleep_until(waitUntil);
-    }
+    std::lock_guard<std::mutex> lock(mutex);
+    return burstWindow.acquire(nowMs);
 }
 
 static psn::Credential credentialForUrl(const std::string& url)
@@ -808,135 +726,143 @@ static psn::Credential credentialForUrl(const std::string& url)
         : psn::Credential::RemotePlay;
 }
 
-psn::Error TrophyManager::governedGet(HttpSession& session, const std::string& url, std::string& outBody)
+// The profile endpoint feeds presence and the avatar; everything else here is trophy data.
+static BudgetScope budgetScopeForUrl(const std::string& url)
+{
+    return url.find("/api/userProfile/") != std::string::npos ? BudgetScope::Presence : BudgetScope::Trophy;
+}
+
+namespace {
+
+// An HTTP pool worker's session, as the wire for one step of a governed GET.
+class SessionWire : public psn::Wire {
+public:
+    SessionWire(HttpSession& session, psn::Auth& auth, long timeoutSeconds)
+        : session(session)
+        , auth(auth)
+        , timeoutSeconds(timeoutSeconds)
+    {
+    }
+
+    psn::Reply get(const std::string& url, const std::string& token, std::string& outBody) override
+    {
+        HttpResponse response = session.get(url, token, timeoutSeconds);
+
+        psn::Reply reply;
+        reply.transportFailed = response.transportFailed();
+        reply.status = response.status;
+        reply.error = response.error;
+        if (!reply.transportFailed && response.status == 429)
+            reply.retryAfter = response.header("Retry-After");
+
+        outBody = std::move(response.body);
+        return reply;
+    }
+
+    psn::Error refreshToken(std::string& outToken) override
+    {
+        psn::Error error = auth.ensureSession(session, true);
+        if (error.ok())
+            outToken = auth.accessToken();
+        return error;
+    }
+
+private:
+    HttpSession& session;
+    psn::Auth& auth;
+    long timeoutSeconds;
+};
+
+} // namespace
+
+// Continuation-style GET against PSN through psn::governedGet. Waiting out a burst slot or
+// a retry backoff parks the request on the pool's timer wheel instead of sleeping, so the
+// worker goes back to other HTTP work and a later step resumes the request on whichever
+// worker is free.
+void TrophyManager::governedGet(HttpSession& session, const std::string& url, psn::GovernedDone done)
 {
     psn::Auth& auth = psn::Auth::forCredential(credentialForUrl(url));
 
+    BudgetScope scope = budgetScopeForUrl(url);
     int64_t nowSeconds = static_cast<int64_t>(std::time(nullptr));
-    PersistedRateLimiter::Status budget = limiter.status();
+    PersistedRateLimiter::Status budget = limiter.status(scope);
     if (budget.breakerOpen(nowSeconds))
     {
         psn::Error blocked{psn::Status::RateLimited,
             std::format("PSN rate limit cooldown active, {}s remaining", budget.breakerUntil - nowSeconds)};
         brls::Logger::warning("Trophy: {} blocked, {}", url, blocked.message);
-        return blocked;
+        done(blocked, {});
+        return;
     }
 
     if (auth.state() == psn::SessionState::NotLinked)
-        return {psn::Status::NotLinked, "PSN account not linked"};
+    {
+        done({psn::Status::NotLinked, "PSN account not linked"}, {});
+        return;
+    }
 
     if (!hasConnectivity())
     {
         brls::Logger::info("Trophy: {} skipped, no network connection", url);
-        return {psn::Status::Offline, "No network connection"};
+        done({psn::Status::Offline, "No network connection"}, {});
+        return;
     }
 
     psn::Error sessionError = auth.ensureSession(session);
     if (!sessionError.ok())
-        return sessionError;
-
-    std::string token = auth.accessToken();
-
-    psn::Error result;
-    bool refreshedOn401 = false;
-    int backoffSeconds = 2;
-
-    for (int attempt = 1; attempt <= MAX_ATTEMPTS; attempt++)
     {
-        std::string budgetReason;
-        if (!limiter.tryAcquire(budgetReason))
-        {
-            brls::Logger::warning("Trophy: {} refused, {}", url, budgetReason);
-            return {psn::Status::RateLimited, budgetReason};
-        }
-
-        awaitBurstSlot();
-
-        HttpResponse response = session.get(url, token, REQUEST_TIMEOUT_S);
-
-        if (!response.transportFailed() && response.status == 200)
-        {
-            outBody = std::move(response.body);
-            return {};
-        }
-
-        if (!response.transportFailed() && response.status == 401)
-        {
-            if (refreshedOn401)
-            {
-                brls::Logger::error("Trophy: {} still 401 after refresh, giving up", url);
-                return {psn::Status::SessionExpired, "PSN rejected the access token after a refresh"};
-            }
-
-            refreshedOn401 = true;
-            brls::Logger::info("Trophy: {} returned 401, refreshing token once", url);
-
-            psn::Error refreshError = auth.ensureSession(session, true);
-            if (!refreshError.ok())
-                return refreshError;
-
-            token = auth.accessToken();
-            continue;
-        }
-
-        if (!response.transportFailed() && response.status == 429)
-        {
-            int cooldown = BREAKER_MINUTES * 60;
-
-            std::string retryAfter = response.header("Retry-After");
-            if (!retryAfter.empty())
-            {
-                try
-                {
-                    cooldown = std::max(cooldown, std::stoi(retryAfter));
-                }
-                catch (const std::exception&)
-                {
-                }
-            }
-
-            cooldown = std::min(cooldown, 60 * 60);
-            limiter.recordThrottle(cooldown);
+        done(sessionError, {});
+        return;
+    }
 
-            brls::Logger::error("Trophy: {} returned 429 (Retry-After '{}'), tripping breaker for {}s",
-                url, retryAfter, cooldown);
-            return {psn::Status::RateLimited,
-                std::format("PSN is rate-limiting, backing off for {}s", cooldown)};
-        }
+    psn::Auth* authFor = &auth;
+    psn::Governance governance;
+    governance.admit = [this, scope](std::string& outReason) { return limiter.tryAcquire(scope, outReason); };
+    governance.claimSlot = [this]() { return claimBurstSlot(); };
+    governance.throttle = [this, scope](int cooldownSeconds) { limiter.recordThrottle(scope, cooldownSeconds); };
+    governance.park = [authFor](int64_t delayMs, std::function<void(psn::Wire&)> resume) {
+        HttpPool::instance().submitAfter(std::chrono::milliseconds(delayMs),
+            [authFor, resume](HttpSession& worker) {
+                SessionWire wire(worker, *authFor, REQUEST_TIMEOUT_S);
+                resume(wire);
+            });
+    };
+
+    SessionWire wire(session, auth, REQUEST_TIMEOUT_S);
+    psn::governedGet(std::move(governance), wire, url, auth.accessToken(), std::move(done));
+}
 
-        bool retryable = response.transportFailed() || response.status >= 500;
+// psn::Client is written against a blocking fetch. The calling worker helps the pool while
+// the request is parked, so the wait never takes a worker away from other HTTP work.
+psn::Error TrophyManager::governedGetBlocking(HttpSession& session, const std::string& url, std::string& outBody)
+{
+    struct Outcome {
+        std::atomic<bool> finished{false};
+        psn::Error error;
+        std::string body;
+    };
+
+    auto outcome = std::make_shared<Outcome>();
+    governedGet(session, url, [outcome](psn::Error error, std::string body) {
+        outcome->error = std::move(error);
+        outcome->body = std::move(body);
+        outcome->finished.store(true);
+        HttpPool::instance().wake();
+    });
 
-        if (response.transportFailed())
-        {
-            result = {psn::Status::Offline, response.error};
-            brls::Logger::warning("Trophy: {} attempt {}/{} transport failure: {}",
-                url, attempt, MAX_ATTEMPTS, response.error);
-        }
-        else
-        {
-            result = {psn::Status::ServerError, std::format("HTTP {}", response.status)};
-            brls::Logger::warning("Trophy: {} attempt {}/{} returned HTTP {}",
-                url, attempt, MAX_ATTEMPTS, response.status);
-        }
+    HttpPool::instance().helpUntil(session, [&outcome]() { return outcome->finished.load(); });
 
-        if (!retryable)
-            return result;
+    if (!outcome->finished.load())
+        return {psn::Status::Offline, "HTTP pool stopped"};
 
-        if (attempt < MAX_ATTEMPTS)
-        {
-            brls::Logger::info("Trophy: retrying {} in {}s", url, backoffSeconds);
-            std::this_thread::sleep_for(std::chrono::seconds(backoffSeconds));
-            backoffSeconds *= 2;
-        }
-    }
-
-    return result;
+    outBody = std::move(outcome->body);
+    return outcome->error;
 }
 
 psn::Client TrophyManager::clientFor(HttpSession& session)
 {
     return psn::Client([this, &session](const std::string& url, std::string& outBody) {
-        return governedGet(session, url, outBody);
+        return governedGetBlocking(session, url, outBody);
     });
 }
 
@@ -1042,6 +968,18 @@ void TrophyManager::fetchSummary(bool forceRefresh, Callback<psn::TrophySummary>
     });
 }
 
+// Called once the HTTP pool has stopped, so no request can still be charging the budget.
+void TrophyManager::shutdown()
+{
+    limiter.close();
+
+    std::lock_guard<std::mutex> storeLock(iconStoreMutex);
+    if (iconCompactor.joinable())
+        iconCompactor.join();
+    iconStore.close();
+    iconStoreReady.store(false);
+}
+
 void TrophyManager::fetchProfile(bool forceRefresh, Callback<psn::PsnProfile> onSuccess, ErrorCallback onError)
 {
     std::string accountId;
@@ -1107,6 +1045,8 @@ void TrophyManager::fetchProfile(bool forceRefresh, Callback<psn::PsnProfile> on
                 profileSavedAt = static_cast<int64_t>(std::time(nullptr));
             }
 
+            pinAvatar(profile.avatarUrl());
+
             brls::Logger::info("PSN profile: {} plus={} verified={} avatars={} avatarUrl='{}'",
                 profile.onlineId, static_cast<int>(profile.isPlus),
                 static_cast<int>(profile.isOfficiallyVerified), profile.avatars.size(),
@@ -1163,6 +1103,18 @@ void TrophyManager::fetchLibrary(bool forceRefresh, Callback<std::vector<psn::Tr
             }
         }
 
+        std::vector<psn::TrophyTitle> previous;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (hasCachedLibrary)
+                previous = cachedLibrary;
+        }
+        if (previous.empty())
+        {
+            int64_t savedAt = 0;
+            loadLibraryFromDisk(previous, savedAt);
+        }
+
         std::vector<psn::TrophyTitle> titles;
         psn::Error error = clientFor(session).fetchTitles(titles);
 
@@ -1176,6 +1128,7 @@ void TrophyManager::fetchLibrary(bool forceRefresh, Callback<std::vector<psn::Tr
             }
 
             ensureCacheDirs();
+            syncLibraryDelta(previous, titles);
             saveLibraryToDisk(titles);
             logLibrary(titles);
             prefetchIcons(titles);
@@ -1205,66 +1158,122 @@ void TrophyManager::fetchLibrary(bool forceRefresh, Callback<std::vector<psn::Tr
 psn::Error TrophyManager::fetchDetailBlocking(HttpSession& session, const psn::TrophyTitle& title,
     psn::TitleDetail& outDetail)
 {
-    psn::Client client = clientFor(session);
+    // Each endpoint still passes through governedGet on its own pool worker.
+    return psn::fetchTitleDetail(title, [this, &session](std::vector<std::function<void(const psn::Client&)>> tasks) {
+        std::vector<HttpPool::Task> batch;
+        for (auto& task : tasks)
+        {
+            batch.push_back([this, task = std::move(task)](HttpSession& worker) {
+                task(clientFor(worker));
+            });
+        }
+        HttpPool::instance().fanOut(session, std::move(batch));
+    }, outDetail);
+}
 
-    outDetail.npCommunicationId = title.npCommunicationId;
-    outDetail.npServiceName = title.npServiceName;
-    outDetail.lastUpdatedDateTime = title.lastUpdatedDateTime;
+void TrophyManager::storeDetail(const psn::TitleDetail& detail)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cachedDetails.put(detail.npCommunicationId, detail);
+    }
 
-    std::vector<psn::Trophy> definitions;
-    psn::Error error = client.fetchTrophyDefinitions(title.npCommunicationId, title.npServiceName, definitions);
-    if (!error.ok())
-        return error;
+    ensureCacheDirs();
+    mkdir(detailCacheDir().c_str(), 0755);
+    saveDetailToDisk(detail);
+}
 
-    std::vector<psn::Trophy> progress;
-    error = client.fetchTrophyProgress(title.npCommunicationId, title.npServiceName, progress);
-    if (!error.ok())
-        return error;
+// Only titles whose lastUpdatedDateTime or counts moved lose their cached detail. Changed
+// titles the user had already opened are refetched in the background while the budget
+// has room; everything else waits until it is opened.
+void TrophyManager::syncLibraryDelta(const std::vector<psn::TrophyTitle>& previous,
+    const std::vector<psn::TrophyTitle>& titles)
+{
+    if (previous.empty())
+        return;
+
+    psn::LibraryDelta delta = psn::diffLibrary(previous, titles);
+
+    std::unordered_map<std::string, const psn::TrophyTitle*> byId;
+    byId.reserve(titles.size());
+    for (const psn::TrophyTitle& title : titles)
+        byId[title.npCommunicationId] = &title;
 
-    psn::mergeTrophies(definitions, progress);
-    outDetail.trophies = std::move(definitions);
+    // Memory is dropped under the lock; the SD checks and removals happen after it, so UI
+    // getters are not held up by a library's worth of stat() calls.
+    std::vector<bool> changedInMemory;
+    changedInMemory.reserve(delta.changed.size());
 
-    if (!title.hasTrophyGroups)
     {
-        psn::TrophyGroup base;
-        base.trophyGroupId = "default";
-        base.trophyGroupName = title.trophyTitleName;
-        base.trophyGroupIconUrl = title.trophyTitleIconUrl;
-        base.definedTrophies = title.definedTrophies;
-        base.earnedTrophies = title.earnedTrophies;
-        base.progress = title.progress;
-        base.lastUpdatedDateTime = title.lastUpdatedDateTime;
-        outDetail.groups.push_back(std::move(base));
-
-        brls::Logger::info("Trophy detail {}: {} trophies, single group",
-            title.npCommunicationId, outDetail.trophies.size());
-        return {};
-    }
+        std::lock_guard<std::mutex> lock(mutex);
 
-    std::vector<psn::TrophyGroup> groups;
-    error = client.fetchGroupDefinitions(title.npCommunicationId, title.npServiceName, groups);
-    if (!error.ok())
-        return error;
+        for (const std::string& id : delta.removed)
+            cachedDetails.erase(id);
+
+        for (const std::string& id : delta.changed)
+        {
+            changedInMemory.push_back(cachedDetails.contains(id));
+            cachedDetails.erase(id);
+        }
+    }
 
-    std::vector<psn::TrophyGroup> groupProgress;
-    psn::Error progressError = client.fetchGroupProgress(title.npCommunicationId, title.npServiceName, groupProgress);
+    for (const std::string& id : delta.removed)
+        removeDetailFromDisk(id);
 
-    if (progressError.ok())
+    std::vector<psn::TrophyTitle> refetch;
+    for (size_t i = 0; i < delta.changed.size(); i++)
     {
-        psn::mergeGroups(groups, groupProgress);
+        const std::string& id = delta.changed[i];
+        if (!changedInMemory[i] && !detailOnDisk(id))
+            continue;
+
+        removeDetailFromDisk(id);
+        refetch.push_back(*byId[id]);
     }
-    else
+
+    brls::Logger::info("Trophy: library sync {} unchanged, {} changed, {} added, {} removed",
+        delta.unchanged.size(), delta.changed.size(), delta.added.size(), delta.removed.size());
+
+    prefetchDetails(refetch);
+}
+
+void TrophyManager::prefetchDetails(const std::vector<psn::TrophyTitle>& titles)
+{
+    if (titles.empty())
+        return;
+
+    int affordable = limiter.status(BudgetScope::Trophy).remaining() - DETAIL_PREFETCH_RESERVE;
+    int queued = 0;
+    int skipped = 0;
+
+    for (const psn::TrophyTitle& title : titles)
     {
-        psn::tallyGroupEarned(groups, outDetail.trophies);
-        brls::Logger::warning("Trophy detail {}: group progress failed ({}), earned counts tallied from trophies",
-            title.npCommunicationId, progressError.message);
-    }
+        int cost = psn::detailRequestCount(title);
+        if (queued >= DETAIL_PREFETCH_CAP || cost > affordable)
+        {
+            skipped++;
+            continue;
+        }
 
-    outDetail.groups = std::move(groups);
+        affordable -= cost;
+        queued++;
 
-    brls::Logger::info("Trophy detail {}: {} trophies across {} group(s)",
-        title.npCommunicationId, outDetail.trophies.size(), outDetail.groups.size());
-    return {};
+        HttpPool::instance().submit([this, title](HttpSession& session) {
+            psn::TitleDetail detail;
+            psn::Error error = fetchDetailBlocking(session, title, detail);
+            if (!error.ok())
+            {
+                brls::Logger::warning("Trophy: background detail refresh for {} failed with {} ({})",
+                    title.npCommunicationId, psn::statusName(error.status), error.message);
+                return;
+            }
+
+            storeDetail(detail);
+        });
+    }
+
+    brls::Logger::info("Trophy: refreshing {} changed detail(s) in the background, {} left until opened",
+        queued, skipped);
 }
 
 void TrophyManager::fetchTitleDetail(const psn::TrophyTitle& title, bool forceRefresh,
@@ -1280,10 +1289,10 @@ void TrophyManager::fetchTitleDetail(const psn::TrophyTitle& title, bool forceRe
 
             {
                 std::lock_guard<std::mutex> lock(mutex);
-                auto entry = cachedDetails.find(id);
-                if (entry != cachedDetails.end() && entry->second.lastUpdatedDateTime == title.lastUpdatedDateTime)
+                const psn::TitleDetail* entry = cachedDetails.find(id);
+                if (entry && entry->lastUpdatedDateTime == title.lastUpdatedDateTime)
                 {
-                    cached = entry->second;
+                    cached = *entry;
                     haveCached = true;
                 }
             }
@@ -1301,7 +1310,7 @@ void TrophyManager::fetchTitleDetail(const psn::TrophyTitle& title, bool forceRe
                     if (signalMatches || cacheEntryFresh(savedAt, DETAIL_TTL_MINUTES))
                     {
                         std::lock_guard<std::mutex> lock(mutex);
-                        cachedDetails[id] = fromDisk;
+                        cachedDetails.put(id, fromDisk);
                         cached = std::move(fromDisk);
                         haveCached = true;
 
@@ -1327,14 +1336,7 @@ void TrophyManager::fetchTitleDetail(const psn::TrophyTitle& title, bool forceRe
 
         if (error.ok())
         {
-            {
-                std::lock_guard<std::mutex> lock(mutex);
-                cachedDetails[id] = detail;
-            }
-
-            ensureCacheDirs();
-            mkdir(detailCacheDir().c_str(), 0755);
-            saveDetailToDisk(detail);
+            storeDetail(detail);
 
             brls::sync([onSuccess, detail]() { if (onSuccess) onSuccess(detail); });
             return;
@@ -1348,42 +1350,88 @@ void TrophyManager::fetchTitleDetail(const psn::TrophyTitle& title, bool forceRe
 }
 
 void TrophyManager::fetchIcon(const std::string& url, IconCallback onSuccess)
+{
+    bool prefetch = onSuccess == nullptr;
+    fetchImage(iconCache, url, std::move(onSuccess), prefetch);
+}
+
+// Cloud covers are several times the size of a trophy icon, so they get their own budget
+// rather than pushing the icons of the trophy list out of memory.
+void TrophyManager::fetchArtwork(const std::string& url, IconCallback onSuccess)
+{
+    bool prefetch = onSuccess == nullptr;
+    fetchImage(artworkCache, url, std::move(onSuccess), prefetch);
+}
+
+void TrophyManager::prefetchIcon(const std::string& url, IconCallback onArrived)
+{
+    fetchImage(iconCache, url, std::move(onArrived), true);
+}
+
+void TrophyManager::prefetchArtwork(const std::string& url, IconCallback onArrived)
+{
+    fetchImage(artworkCache, url, std::move(onArrived), true);
+}
+
+void TrophyManager::fetchImage(ImageCache& cache, const std::string& url, IconCallback onSuccess, bool prefetch)
 {
     if (url.empty())
         return;
 
+    std::vector<uint8_t> bytes;
+    if (cache.get(url, bytes))
+    {
+        if (onSuccess)
+            brls::sync([onSuccess, url, bytes]() { onSuccess(url, bytes); });
+        return;
+    }
+
     {
         std::lock_guard<std::mutex> lock(iconMutex);
 
-        auto cached = iconCache.find(url);
-        if (cached != iconCache.end())
+        // Checked again under the waiter lock: a fetch that finished since the first look
+        // has already handed out its waiters and would never call this one back.
+        if (cache.get(url, bytes))
         {
             if (onSuccess)
-            {
-                std::vector<uint8_t> bytes = cached->second;
                 brls::sync([onSuccess, url, bytes]() { onSuccess(url, bytes); });
-            }
             return;
         }
 
         auto existing = iconWaiters.find(url);
         bool alreadyInFlight = existing != iconWaiters.end();
 
+        ImageWaiters& waiters = iconWaiters[url];
         if (onSuccess)
-            iconWaiters[url].push_back(std::move(onSuccess));
-        else if (!alreadyInFlight)
-            iconWaiters[url];
+            waiters.callbacks.push_back(std::move(onSuccess));
+        if (!prefetch)
+            waiters.onScreen = true;
+
+        // Asking again, for any reason, takes back an earlier withdrawal.
+        withdrawnPrefetches.erase(url);
 
         if (alreadyInFlight)
             return;
     }
 
-    HttpPool::instance().submit([this, url](HttpSession& session) {
-        ensureIconCacheDir();
+    HttpPool::instance().submit([this, &cache, url](HttpSession& session) {
+        {
+            std::lock_guard<std::mutex> lock(iconMutex);
+            if (withdrawnPrefetches.erase(url) > 0)
+            {
+                auto entry = iconWaiters.find(url);
+                if (entry != iconWaiters.end() && !entry->second.onScreen)
+                {
+                    iconWaiters.erase(entry);
+                    return;
+                }
+            }
+        }
+
+        ensureIconStore();
 
-        std::string path = iconCachePath(url);
         std::vector<uint8_t> bytes;
-        bool usable = readIconFromDisk(path, bytes);
+        bool usable = iconStore.get(url, bytes);
         bool fromDisk = usable;
 
         if (!usable)
@@ -1415,7 +1463,7 @@ void TrophyManager::fetchIcon(const std::string& url, IconCallback onSuccess)
         }
 
         if (usable)
-            storeIconInMemory(url, bytes);
+            storeImageInMemory(cache, url, bytes);
 
         std::vector<IconCallback> waiters;
         {
@@ -1423,16 +1471,22 @@ void TrophyManager::fetchIcon(const std::string& url, IconCallback onSuccess)
             auto entry = iconWaiters.find(url);
             if (entry != iconWaiters.end())
             {
-                waiters.swap(entry->second);
+                waiters.swap(entry->second.callbacks);
                 iconWaiters.erase(entry);
             }
+            withdrawnPrefetches.erase(url);
         }
 
         if (!usable)
             return;
 
         if (!fromDisk && iconDiskWritable.load())
-            writeIconToDisk(path, bytes);
+        {
+            if (iconStore.put(url, bytes))
+                compactIconStoreIfNeeded();
+            else
+                stopIconDiskWrites(std::format("could not append {} to the icon pack", url));
+        }
 
         if (waiters.empty())
             return;
@@ -1444,24 +1498,30 @@ void TrophyManager::fetchIcon(const std::string& url, IconCallback onSuccess)
     });
 }
 
+void TrophyManager::cancelPrefetch(const std::string& url)
+{
+    std::lock_guard<std::mutex> lock(iconMutex);
+
+    // The queued task checks the mark when it comes up and is only dropped if nothing on
+    // screen waits on it by then, so a card that binds the url meanwhile still gets its image.
+    auto entry = iconWaiters.find(url);
+    if (entry != iconWaiters.end() && !entry->second.onScreen)
+        withdrawnPrefetches.insert(url);
+}
+
 void TrophyManager::discardIcon(const std::string& url)
 {
     {
         std::lock_guard<std::mutex> lock(iconMutex);
 
-        auto entry = iconCache.find(url);
-        if (entry != iconCache.end())
-        {
-            iconCacheBytes -= entry->second.size();
-            iconCache.erase(entry);
-        }
+        iconCache.erase(url);
+        artworkCache.erase(url);
 
-        auto position = std::find(iconOrder.begin(), iconOrder.end(), url);
-        if (position != iconOrder.end())
-            iconOrder.erase(position);
+        if (url == pinnedAvatarUrl)
+            avatarPinned = false;
     }
 
-    remove(iconCachePath(url).c_str());
+    iconStore.erase(url);
     brls::Logger::warning("Trophy: discarded the cached icon for {}", url);
 }
 
@@ -1485,11 +1545,16 @@ void TrophyManager::startAutoRefresh()
     staleTimer.setCallback([this]() { runStaleCheck(); });
     staleTimer.start(STALE_CHECK_MINUTES * 60 * 1000);
 
+    limiterFlushTimer.setCallback([this]() { limiter.flush(); });
+    limiterFlushTimer.start(PersistedRateLimiter::FLUSH_INTERVAL_SECONDS * 1000);
+
     brls::Logger::info("Trophy: auto refresh checking every {} min", STALE_CHECK_MINUTES);
 }
 
 void TrophyManager::runStaleCheck()
 {
+    logCacheMetrics();
+
     bool stale = false;
 
     {
@@ -1571,6 +1636,8 @@ void TrophyManager::clearCache()
 
     remove(summaryCachePath().c_str());
     remove(libraryCachePath().c_str());
+    remove(psn::legacyCachePath(summaryCachePath()).c_str());
+    remove(psn::legacyCachePath(libraryCachePath()).c_str());
 
     brls::Logger::info("Trophy: cache cleared (memory and disk)");
 }
@@ -0,0 +1,114 @@
+#include "core/wake_pipeline.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+WakePipeline::WakePipeline() : WakePipeline(Config()) {}
+
+WakePipeline::WakePipeline(Config config) : config(config) {}
+
+WakePipeline::Result WakePipeline::run(const Ops& ops)
+{
+    Result result;
+    int64_t startMs = nowMs();
+
+    ConnectPrewarm::Timing wake;
+    wake.stage = "wake";
+    wake.ran = true;
+    wake.ok = ops.wake();
+    wake.durationMs = nowMs() - startMs;
+    result.timeline.push_back(wake);
+    result.wakes = 1;
+    if (!wake.ok)
+    {
+        result.outcome = Outcome::WakeFailed;
+        result.elapsedMs = nowMs() - startMs;
+        return result;
+    }
+
+    ConnectPrewarm::Timing boot;
+    boot.stage = "boot";
+    boot.startMs = nowMs() - startMs;
+    boot.ran = true;
+
+    int64_t intervalMs = config.firstPollMs;
+    int64_t lastWakeMs = startMs + wake.durationMs;
+    ConsoleStatus last = ConsoleStatus::Standby;
+    bool booting = false;
+    while (true)
+    {
+        int64_t pollStartMs = nowMs();
+        if (cancelled)
+        {
+            result.outcome = Outcome::Cancelled;
+            break;
+        }
+        if (pollStartMs - startMs >= config.deadlineMs)
+        {
+            result.outcome = Outcome::TimedOut;
+            break;
+        }
+
+        ConsoleStatus status = ops.poll(config.pollTimeoutMs);
+        result.polls++;
+        if (status == ConsoleStatus::Ready)
+        {
+            result.outcome = Outcome::Ready;
+            break;
+        }
+
+        // Going quiet means the wake got through, and standby after that is the last of
+        // the boot, so the polls stay close from then on.
+        bool backInStandby = booting && status == ConsoleStatus::Standby;
+        booting = booting || status == ConsoleStatus::Unknown;
+        if (status != last || backInStandby)
+            intervalMs = config.firstPollMs;
+        else
+            intervalMs = std::min(intervalMs * 3 / 2, config.maxPollMs);
+        last = status;
+
+        int64_t now = nowMs();
+        if (!booting && now - lastWakeMs >= config.rewakeMs)
+        {
+            ops.wake();
+            result.wakes++;
+            lastWakeMs = now;
+            intervalMs = config.firstPollMs;
+        }
+
+        if (!sleepFor(pollStartMs + intervalMs - nowMs()))
+        {
+            result.outcome = Outcome::Cancelled;
+            break;
+        }
+    }
+    boot.durationMs = nowMs() - startMs - boot.startMs;
+    boot.ok = result.outcome == Outcome::Ready;
+    result.timeline.push_back(boot);
+
+    result.elapsedMs = nowMs() - startMs;
+    return result;
+}
+
+void WakePipeline::cancel()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancelled = true;
+    }
+    cond.notify_all();
+}
+
+bool WakePipeline::sleepFor(int64_t ms)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (ms > 0)
+        cond.wait_for(lock, std::chrono::milliseconds(ms), [this] { return cancelled.load(); });
+    return !cancelled;
+}
+
+int64_t WakePipeline::nowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
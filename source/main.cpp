@@ -45,6 +45,7 @@
 #include "cloud/http_bridge.hpp"
 #include "core/update_manager.hpp"
 #include "core/discovery_manager.hpp"
+#include "core/trophy_manager.hpp"
 #include "ui/akira_header.hpp"
 #include "psn/token_refresher.hpp"
 #include "views/update_flow.hpp"
@@ -490,7 +491,7 @@ int main(int argc, char* argv[])
 #endif
     SettingsManager::getInstance()->setLogger(&chiakiLog);
     Session::GetInstance()->SetLogger(&chiakiLog);
-    cloud::registerHttpBridge();
+    cloud::registerHttpBridge(TrophyManager::getInstance()->requestLimiter());
 
     static FILE* logFile = nullptr;
     if (SettingsManager::getInstance()->getEnableFileLogging()) {
@@ -562,6 +563,7 @@ int main(int argc, char* argv[])
     psn::TokenRefresher::instance().stop();
 
     HttpPool::instance().stop();
+    TrophyManager::getInstance()->shutdown();
 
     SDL_Quit();
     curl_global_cleanup();
@@ -1,17 +1,72 @@
 #include "psn/client.hpp"
 #include "psn/log.hpp"
+#include "psn/schema.hpp"
 
+#include <atomic>
 #include <format>
 
-#include <json-c/json.h>
-
 namespace psn {
 
+namespace {
+
+struct TrophySetRow {
+    std::string npCommunicationId;
+};
+
+constexpr Field<TrophySetRow> TROPHY_SET_FIELDS[] = {
+    field<&TrophySetRow::npCommunicationId>("npCommunicationId"),
+};
+
+struct TitleMappingRow {
+    std::string npTitleId;
+    std::string npCommunicationId;
+};
+
+void readFirstTrophySet(JsonReader& reader, TitleMappingRow& out)
+{
+    bool first = true;
+
+    decodeArray(reader, [&](JsonReader& row) {
+        if (!first)
+        {
+            row.skip();
+            return;
+        }
+
+        first = false;
+        TrophySetRow set;
+        decodeObject(row, TROPHY_SET_FIELDS, set);
+        out.npCommunicationId = std::move(set.npCommunicationId);
+    });
+}
+
+constexpr Field<TitleMappingRow> TITLE_MAPPING_FIELDS[] = {
+    field<&TitleMappingRow::npTitleId>("npTitleId"),
+    {"trophyTitles", readFirstTrophySet},
+};
+
+} // namespace
+
+Client::Endpoints Client::Endpoints::at(const std::string& origin)
+{
+    Endpoints endpoints;
+    endpoints.trophy = origin + "/api/trophy/v1";
+    endpoints.gamelist = origin + "/api/gamelist/v2/users";
+    endpoints.userProfile = origin + "/api/userProfile/v1/internal/users";
+    return endpoints;
+}
+
 Client::Client(Fetch fetch)
     : fetch(std::move(fetch))
 {
 }
 
+Client::Client(Fetch fetch, Endpoints endpoints)
+    : fetch(std::move(fetch))
+    , endpoints(std::move(endpoints))
+{
+}
+
 std::string Client::titlePath(const std::string& prefix, const std::string& npCommunicationId,
     const std::string& suffix, const std::string& npServiceName)
 {
@@ -23,53 +78,68 @@ std::string Client::titlePath(const std::string& prefix, const std::string& npCo
     return path;
 }
 
-Error Client::fetchDocument(const char* base, const std::string& path, Json& out) const
+Error Client::fetchDocument(const std::string& base, const std::string& path, std::string& outBody) const
 {
-    std::string body;
-    Error error = fetch(std::string(base) + path, body);
-    if (!error.ok())
-        return error;
-
-    out = Json(body);
-    if (!out)
-    {
-        Error parseError{Status::ServerError, std::format("Could not parse the response to {}", path)};
-        logError("PSN: {}", parseError.message);
-        return parseError;
-    }
+    return fetch(base + path, outBody);
+}
 
-    return {};
+static Error unparseable(const std::string& path)
+{
+    Error parseError{Status::ServerError, std::format("Could not parse the response to {}", path)};
+    logError("PSN: {}", parseError.message);
+    return parseError;
 }
 
-Error Client::fetchList(const char* base, const std::string& path, const char* arrayKey, const RowSink& onRow) const
+Error Client::fetchList(const std::string& base, const std::string& path, const char* arrayKey,
+    const RowSink& onRow) const
 {
-    Json doc;
-    Error error = fetchDocument(base, path, doc);
+    std::string body;
+    Error error = fetchDocument(base, path, body);
     if (!error.ok())
         return error;
 
-    json_object* array = nullptr;
-    if (!jsonField(doc.get(), arrayKey, &array) || !json_object_is_type(array, json_type_array))
+    JsonReader reader(body);
+    if (!reader.enterObject())
+        return unparseable(path);
+
+    bool sawArray = false;
+    int rows = 0;
+    std::string_view key;
+
+    while (reader.nextKey(key))
     {
-        Error missing{Status::ServerError, std::format("Response to {} has no {} array", path, arrayKey)};
-        logError("PSN: {}", missing.message);
-        return missing;
+        if (key != arrayKey || reader.peek() != JsonReader::Kind::Array)
+        {
+            reader.skip();
+            continue;
+        }
+
+        sawArray = true;
+        reader.enterArray();
+
+        while (reader.nextElement())
+        {
+            if (onRow(reader))
+                rows++;
+        }
     }
 
-    size_t count = json_object_array_length(array);
-    int rows = 0;
+    if (reader.failed() || !reader.finished())
+        return unparseable(path);
 
-    for (size_t i = 0; i < count; i++)
+    if (!sawArray)
     {
-        if (onRow(json_object_array_get_idx(array, i)))
-            rows++;
+        Error missing{Status::ServerError, std::format("Response to {} has no {} array", path, arrayKey)};
+        logError("PSN: {}", missing.message);
+        return missing;
     }
 
     logInfo("PSN: read {} {} row(s)", rows, arrayKey);
     return {};
 }
 
-Error Client::fetchPaged(const char* base, const std::string& path, const char* arrayKey, const RowSink& onRow) const
+Error Client::fetchPaged(const std::string& base, const std::string& path, const char* arrayKey,
+    const RowSink& onRow) const
 {
     const char* separator = path.find('?') == std::string::npos ? "?" : "&";
 
@@ -82,32 +152,55 @@ Error Client::fetchPaged(const char* base, const std::string& path, const char*
     {
         page++;
 
-        Json doc;
-        Error error = fetchDocument(base,
-            std::format("{}{}limit={}&offset={}", path, separator, PAGE_SIZE, offset), doc);
+        std::string pagePath = std::format("{}{}limit={}&offset={}", path, separator, PAGE_SIZE, offset);
+        std::string body;
+        Error error = fetchDocument(base, pagePath, body);
         if (!error.ok())
             return error;
 
-        if (totalItemCount < 0)
-            totalItemCount = jsonInt(doc.get(), "totalItemCount");
+        JsonReader reader(body);
+        if (!reader.enterObject())
+            return unparseable(pagePath);
 
-        json_object* array = nullptr;
+        int pageTotal = 0;
         int pageCount = 0;
+        bool hasNext = false;
+        int nextOffset = 0;
+        std::string_view key;
 
-        if (jsonField(doc.get(), arrayKey, &array) && json_object_is_type(array, json_type_array))
+        while (reader.nextKey(key))
         {
-            pageCount = static_cast<int>(json_object_array_length(array));
-
-            for (int i = 0; i < pageCount; i++)
+            if (key == arrayKey && reader.peek() == JsonReader::Kind::Array)
+            {
+                reader.enterArray();
+
+                while (reader.nextElement())
+                {
+                    pageCount++;
+                    if (onRow(reader))
+                        rows++;
+                }
+            }
+            else if (key == "totalItemCount" && !reader.skipNull())
             {
-                if (onRow(json_object_array_get_idx(array, i)))
-                    rows++;
+                pageTotal = static_cast<int>(reader.readInt64());
+            }
+            else if (key == "nextOffset" && !reader.skipNull())
+            {
+                hasNext = true;
+                nextOffset = static_cast<int>(reader.readInt64());
+            }
+            else
+            {
+                reader.skip();
             }
         }
 
-        json_object* nextField = nullptr;
-        bool hasNext = jsonField(doc.get(), "nextOffset", &nextField);
-        int nextOffset = hasNext ? jsonInt(doc.get(), "nextOffset") : 0;
+        if (reader.failed() || !reader.finished())
+            return unparseable(pagePath);
+
+        if (totalItemCount < 0)
+            totalItemCount = pageTotal;
 
         if (pageCount == 0 || !hasNext)
             break;
@@ -147,25 +240,39 @@ Error Client::fetchPaged(const char* base, const std::string& path, const char*
 
 Error Client::fetchSummary(TrophySummary& out) const
 {
-    Json doc;
-    Error error = fetchDocument(API_BASE, "/users/me/trophySummary", doc);
+    const std::string path = "/users/me/trophySummary";
+    std::string body;
+    Error error = fetchDocument(endpoints.trophy, path, body);
     if (!error.ok())
         return error;
 
-    if (!parseSummary(doc.get(), out))
-        return {Status::ServerError, "trophySummary response was empty"};
+    JsonReader reader(body);
+    if (reader.peek() != JsonReader::Kind::Object)
+        return unparseable(path);
+
+    if (!parseSummary(reader, out) || !reader.finished())
+        return unparseable(path);
 
     return {};
 }
 
 Error Client::fetchProfile(const std::string& accountId, PsnProfile& out) const
 {
-    Json doc;
-    Error error = fetchDocument(USER_BASE_URL, "/" + accountId + "/profiles", doc);
+    const std::string path = "/" + accountId + "/profiles";
+    std::string body;
+    Error error = fetchDocument(endpoints.userProfile, path, body);
     if (!error.ok())
         return error;
 
-    if (!parseProfile(doc.get(), out))
+    JsonReader reader(body);
+    if (reader.peek() != JsonReader::Kind::Object)
+        return unparseable(path);
+
+    bool parsed = parseProfile(reader, out);
+    if (reader.failed() || !reader.finished())
+        return unparseable(path);
+
+    if (!parsed)
         return {Status::ServerError, "profile response had no onlineId"};
 
     return {};
@@ -173,7 +280,7 @@ Error Client::fetchProfile(const std::string& accountId, PsnProfile& out) const
 
 Error Client::fetchTitles(std::vector<TrophyTitle>& out) const
 {
-    return fetchPaged(API_BASE, "/users/me/trophyTitles", "trophyTitles", [&out](json_object* row) {
+    return fetchPaged(endpoints.trophy, "/users/me/trophyTitles", "trophyTitles", [&out](JsonReader& row) {
         TrophyTitle title;
         if (!parseTitle(row, title))
         {
@@ -189,8 +296,8 @@ Error Client::fetchTitles(std::vector<TrophyTitle>& out) const
 Error Client::fetchGroupDefinitions(const std::string& npCommunicationId,
     const std::string& npServiceName, std::vector<TrophyGroup>& out) const
 {
-    return fetchList(API_BASE, titlePath("", npCommunicationId, "/trophyGroups", npServiceName),
-        "trophyGroups", [&out](json_object* row) {
+    return fetchList(endpoints.trophy, titlePath("", npCommunicationId, "/trophyGroups", npServiceName),
+        "trophyGroups", [&out](JsonReader& row) {
             TrophyGroup group;
             if (!parseGroupDefinition(row, group))
                 return false;
@@ -203,8 +310,8 @@ Error Client::fetchGroupDefinitions(const std::string& npCommunicationId,
 Error Client::fetchGroupProgress(const std::string& npCommunicationId,
     const std::string& npServiceName, std::vector<TrophyGroup>& out) const
 {
-    return fetchList(API_BASE, titlePath("/users/me", npCommunicationId, "/trophyGroups", npServiceName),
-        "trophyGroups", [&out](json_object* row) {
+    return fetchList(endpoints.trophy, titlePath("/users/me", npCommunicationId, "/trophyGroups", npServiceName),
+        "trophyGroups", [&out](JsonReader& row) {
             TrophyGroup group;
             if (!parseGroupProgress(row, group))
                 return false;
@@ -217,8 +324,8 @@ Error Client::fetchGroupProgress(const std::string& npCommunicationId,
 Error Client::fetchTrophyDefinitions(const std::string& npCommunicationId,
     const std::string& npServiceName, std::vector<Trophy>& out) const
 {
-    return fetchPaged(API_BASE, titlePath("", npCommunicationId, "/trophyGroups/all/trophies", npServiceName),
-        "trophies", [&out](json_object* row) {
+    return fetchPaged(endpoints.trophy, titlePath("", npCommunicationId, "/trophyGroups/all/trophies", npServiceName),
+        "trophies", [&out](JsonReader& row) {
             Trophy trophy;
             if (!parseTrophyDefinition(row, trophy))
                 return false;
@@ -231,8 +338,8 @@ Error Client::fetchTrophyDefinitions(const std::string& npCommunicationId,
 Error Client::fetchTrophyProgress(const std::string& npCommunicationId,
     const std::string& npServiceName, std::vector<Trophy>& out) const
 {
-    return fetchPaged(API_BASE, titlePath("/users/me", npCommunicationId, "/trophyGroups/all/trophies", npServiceName),
-        "trophies", [&out](json_object* row) {
+    return fetchPaged(endpoints.trophy, titlePath("/users/me", npCommunicationId, "/trophyGroups/all/trophies", npServiceName),
+        "trophies", [&out](JsonReader& row) {
             Trophy trophy;
             if (!parseTrophyProgress(row, trophy))
                 return false;
@@ -244,7 +351,7 @@ Error Client::fetchTrophyProgress(const std::string& npCommunicationId,
 
 Error Client::fetchPlayedGames(std::vector<PlayedGame>& out) const
 {
-    return fetchPaged(GAMELIST_BASE, "/me/titles", "titles", [&out](json_object* row) {
+    return fetchPaged(endpoints.gamelist, "/me/titles", "titles", [&out](JsonReader& row) {
         PlayedGame game;
         if (!parsePlayedGame(row, game))
             return false;
@@ -276,26 +383,108 @@ Error Client::fetchTitleMapping(const std::vector<std::string>& titleIds,
         joined += titleIds[i];
     }
 
-    return fetchList(API_BASE, "/users/me/titles/trophyTitles?npTitleIds=" + joined,
-        "titles", [&out](json_object* row) {
-            std::string npTitleId = jsonString(row, "npTitleId");
-            if (npTitleId.empty())
+    return fetchList(endpoints.trophy, "/users/me/titles/trophyTitles?npTitleIds=" + joined,
+        "titles", [&out](JsonReader& row) {
+            TitleMappingRow mapping;
+            if (!decodeObject(row, TITLE_MAPPING_FIELDS, mapping))
                 return false;
 
-            json_object* sets = nullptr;
-            if (!jsonField(row, "trophyTitles", &sets) || !json_object_is_type(sets, json_type_array))
+            if (mapping.npTitleId.empty() || mapping.npCommunicationId.empty())
                 return false;
 
-            if (json_object_array_length(sets) == 0)
-                return false;
-
-            std::string npCommunicationId = jsonString(json_object_array_get_idx(sets, 0), "npCommunicationId");
-            if (npCommunicationId.empty())
-                return false;
-
-            out.emplace_back(npTitleId, npCommunicationId);
+            out.emplace_back(std::move(mapping.npTitleId), std::move(mapping.npCommunicationId));
             return true;
         });
 }
 
+Error fetchTitleDetail(const TrophyTitle& title, const FanOut& fanOut, TitleDetail& out)
+{
+    out.npCommunicationId = title.npCommunicationId;
+    out.npServiceName = title.npServiceName;
+    out.lastUpdatedDateTime = title.lastUpdatedDateTime;
+
+    std::vector<Trophy> definitions;
+    std::vector<Trophy> progress;
+    std::vector<TrophyGroup> groups;
+    std::vector<TrophyGroup> groupProgress;
+    Error definitionsError, progressError, groupsError, groupProgressError;
+    std::atomic<bool> abandoned{false};
+
+    const std::string& id = title.npCommunicationId;
+    const std::string& service = title.npServiceName;
+
+    auto required = [&abandoned](auto fetch, Error& outError) {
+        return [fetch, &abandoned, &outError](const Client& client) {
+            if (abandoned.load())
+                return;
+            outError = fetch(client);
+            if (!outError.ok())
+                abandoned.store(true);
+        };
+    };
+
+    std::vector<std::function<void(const Client&)>> tasks;
+    tasks.push_back(required([&](const Client& client) {
+        return client.fetchTrophyDefinitions(id, service, definitions);
+    }, definitionsError));
+    tasks.push_back(required([&](const Client& client) {
+        return client.fetchTrophyProgress(id, service, progress);
+    }, progressError));
+
+    if (title.hasTrophyGroups)
+    {
+        tasks.push_back(required([&](const Client& client) {
+            return client.fetchGroupDefinitions(id, service, groups);
+        }, groupsError));
+        tasks.push_back([&](const Client& client) {
+            if (!abandoned.load())
+                groupProgressError = client.fetchGroupProgress(id, service, groupProgress);
+        });
+    }
+
+    fanOut(std::move(tasks));
+
+    for (const Error* error : {&definitionsError, &progressError, &groupsError})
+    {
+        if (!error->ok())
+            return *error;
+    }
+
+    mergeTrophies(definitions, progress);
+    out.trophies = std::move(definitions);
+
+    if (!title.hasTrophyGroups)
+    {
+        TrophyGroup base;
+        base.trophyGroupId = "default";
+        base.trophyGroupName = title.trophyTitleName;
+        base.trophyGroupIconUrl = title.trophyTitleIconUrl;
+        base.definedTrophies = title.definedTrophies;
+        base.earnedTrophies = title.earnedTrophies;
+        base.progress = title.progress;
+        base.lastUpdatedDateTime = title.lastUpdatedDateTime;
+        out.groups.push_back(std::move(base));
+
+        logInfo("Trophy detail {}: {} trophies, single group", title.npCommunicationId, out.trophies.size());
+        return {};
+    }
+
+    if (groupProgressError.ok())
+    {
+        mergeGroups(groups, groupProgress);
+    }
+    else
+    {
+        tallyGroupEarned(groups, out.trophies);
+        logWarning("Trophy detail {}: group progress failed ({}), earned counts tallied from trophies",
+            title.npCommunicationId, groupProgressError.message);
+    }
+
+    out.groups = std::move(groups);
+
+    logInfo("Trophy detail {}: {} trophies across {} group(s)",
+        title.npCommunicationId, out.trophies.size(), out.groups.size());
+    return {};
+}
+
 } // namespace psn
@@ -0,0 +1,145 @@
+#include "psn/governed_get.hpp"
+#include "psn/log.hpp"
+
+#include <memory>
+#include <utility>
+
+namespace psn {
+
+namespace {
+
+struct GovernedRequest {
+    Governance governance;
+    std::string url;
+    std::string token;
+    int attempt = 1;
+    bool refreshedOn401 = false;
+    bool budgetClaimed = false;
+    Error lastError;
+    GovernedDone done;
+};
+
+void step(Wire& wire, std::shared_ptr<GovernedRequest> request);
+
+void park(std::shared_ptr<GovernedRequest> request, int64_t delayMs)
+{
+    Governance& governance = request->governance;
+    governance.park(delayMs, [request](Wire& wire) { step(wire, request); });
+}
+
+void step(Wire& wire, std::shared_ptr<GovernedRequest> request)
+{
+    const std::string& url = request->url;
+
+    if (!request->budgetClaimed)
+    {
+        std::string budgetReason;
+        if (!request->governance.admit(budgetReason))
+        {
+            logWarning("PSN: {} refused, {}", url, budgetReason);
+            request->done({Status::RateLimited, budgetReason}, {});
+            return;
+        }
+        request->budgetClaimed = true;
+    }
+
+    int64_t slotWaitMs = request->governance.claimSlot();
+    if (slotWaitMs > 0)
+    {
+        park(request, slotWaitMs);
+        return;
+    }
+
+    std::string body;
+    Reply reply = wire.get(url, request->token, body);
+    Verdict verdict = RetryPolicy::judge(reply, request->attempt, request->refreshedOn401);
+
+    switch (verdict.next)
+    {
+        case Next::Deliver:
+            request->done({}, std::move(body));
+            return;
+
+        case Next::RefreshToken:
+        {
+            request->refreshedOn401 = true;
+            logInfo("PSN: {} returned 401, refreshing token once", url);
+
+            Error refreshError = wire.refreshToken(request->token);
+            if (!refreshError.ok())
+            {
+                request->done(refreshError, {});
+                return;
+            }
+
+            if (++request->attempt > RetryPolicy::MAX_ATTEMPTS)
+            {
+                request->done(request->lastError.ok()
+                    ? Error{Status::SessionExpired, "Out of attempts after a token refresh"}
+                    : request->lastError, {});
+                return;
+            }
+
+            request->budgetClaimed = false;
+            step(wire, request);
+            return;
+        }
+
+        case Next::Throttle:
+            request->governance.throttle(verdict.cooldownSeconds);
+            logError("PSN: {} returned 429 (Retry-After '{}'), tripping breaker for {}s",
+                url, reply.retryAfter, verdict.cooldownSeconds);
+            request->done(verdict.error, {});
+            return;
+
+        case Next::Retry:
+        case Next::Fail:
+            break;
+    }
+
+    if (!reply.transportFailed && reply.status == 401)
+    {
+        logError("PSN: {} still 401 after refresh, giving up", url);
+        request->done(verdict.error, {});
+        return;
+    }
+
+    request->lastError = verdict.error;
+    if (reply.transportFailed)
+    {
+        logWarning("PSN: {} attempt {}/{} transport failure: {}",
+            url, request->attempt, RetryPolicy::MAX_ATTEMPTS, reply.error);
+    }
+    else
+    {
+        logWarning("PSN: {} attempt {}/{} returned HTTP {}",
+            url, request->attempt, RetryPolicy::MAX_ATTEMPTS, reply.status);
+    }
+
+    if (verdict.next == Next::Fail)
+    {
+        request->done(request->lastError, {});
+        return;
+    }
+
+    logInfo("PSN: retrying {} in {}s", url, verdict.backoffSeconds);
+    request->attempt++;
+    request->budgetClaimed = false;
+    park(request, static_cast<int64_t>(verdict.backoffSeconds) * 1000);
+}
+
+} // namespace
+
+void governedGet(Governance governance, Wire& wire, const std::string& url, std::string token,
+    GovernedDone done)
+{
+    auto request = std::make_shared<GovernedRequest>();
+    request->governance = std::move(governance);
+    request->url = url;
+    request->token = std::move(token);
+    request->done = std::move(done);
+
+    step(wire, request);
+}
+
+} // namespace psn
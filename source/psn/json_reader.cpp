@@ -0,0 +1,554 @@
+#include "psn/json_reader.hpp"
+
+#include <charconv>
+#include <limits>
+
+namespace psn {
+
+JsonReader::JsonReader(std::string_view text)
+    : text(text)
+{
+}
+
+void JsonReader::skipSpace()
+{
+    while (pos < text.size())
+    {
+        char c = text[pos];
+        if (c != ' ' && c != '\n' && c != '\r' && c != '\t')
+            break;
+        pos++;
+    }
+}
+
+bool JsonReader::fail()
+{
+    error = true;
+    return false;
+}
+
+bool JsonReader::expect(char c)
+{
+    skipSpace();
+    if (pos >= text.size() || text[pos] != c)
+        return fail();
+
+    pos++;
+    return true;
+}
+
+JsonReader::Kind JsonReader::peek()
+{
+    if (error)
+        return Kind::Invalid;
+
+    skipSpace();
+    if (pos >= text.size())
+        return Kind::Invalid;
+
+    switch (text[pos])
+    {
+        case '{': return Kind::Object;
+        case '[': return Kind::Array;
+        case '"': return Kind::String;
+        case 't':
+        case 'f': return Kind::Bool;
+        case 'n': return Kind::Null;
+        default:
+            if (text[pos] == '-' || (text[pos] >= '0' && text[pos] <= '9'))
+                return Kind::Number;
+            return Kind::Invalid;
+    }
+}
+
+bool JsonReader::finished()
+{
+    skipSpace();
+    return !error && pos == text.size();
+}
+
+bool JsonReader::enterObject()
+{
+    if (error || !expect('{'))
+        return false;
+
+    firstEntry = true;
+    return true;
+}
+
+bool JsonReader::nextKey(std::string_view& key)
+{
+    if (error)
+        return false;
+
+    skipSpace();
+    if (pos < text.size() && text[pos] == '}')
+    {
+        pos++;
+        firstEntry = false;
+        return false;
+    }
+
+    if (!firstEntry && !expect(','))
+        return false;
+
+    firstEntry = false;
+    skipSpace();
+
+    if (!scanString(key, keyScratch))
+        return false;
+
+    return expect(':');
+}
+
+bool JsonReader::enterArray()
+{
+    if (error || !expect('['))
+        return false;
+
+    firstEntry = true;
+    return true;
+}
+
+bool JsonReader::nextElement()
+{
+    if (error)
+        return false;
+
+    skipSpace();
+    if (pos < text.size() && text[pos] == ']')
+    {
+        pos++;
+        firstEntry = false;
+        return false;
+    }
+
+    if (!firstEntry && !expect(','))
+        return false;
+
+    firstEntry = false;
+    return true;
+}
+
+static void appendUtf8(std::string& out, uint32_t codepoint)
+{
+    if (codepoint < 0x80)
+    {
+        out += static_cast<char>(codepoint);
+    }
+    else if (codepoint < 0x800)
+    {
+        out += static_cast<char>(0xC0 | (codepoint >> 6));
+        out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    }
+    else if (codepoint < 0x10000)
+    {
+        out += static_cast<char>(0xE0 | (codepoint >> 12));
+        out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    }
+    else
+    {
+        out += static_cast<char>(0xF0 | (codepoint >> 18));
+        out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    }
+}
+
+static bool readHex4(std::string_view text, size_t at, uint32_t& out)
+{
+    if (at + 4 > text.size())
+        return false;
+
+    out = 0;
+    for (size_t i = at; i < at + 4; i++)
+    {
+        char c = text[i];
+        out <<= 4;
+        if (c >= '0' && c <= '9')
+            out |= static_cast<uint32_t>(c - '0');
+        else if (c >= 'a' && c <= 'f')
+            out |= static_cast<uint32_t>(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F')
+            out |= static_cast<uint32_t>(c - 'A' + 10);
+        else
+            return false;
+    }
+    return true;
+}
+
+bool JsonReader::scanString(std::string_view& out, std::string& decoded)
+{
+    if (pos >= text.size() || text[pos] != '"')
+        return fail();
+
+    size_t begin = ++pos;
+
+    while (pos < text.size() && text[pos] != '"' && text[pos] != '\\')
+    {
+        if (static_cast<unsigned char>(text[pos]) < 0x20)
+            return fail();
+        pos++;
+    }
+
+    if (pos >= text.size())
+        return fail();
+
+    if (text[pos] == '"')
+    {
+        out = text.substr(begin, pos - begin);
+        pos++;
+        return true;
+    }
+
+    decoded.assign(text.data() + begin, pos - begin);
+
+    while (pos < text.size())
+    {
+        char c = text[pos];
+
+        if (c == '"')
+        {
+            pos++;
+            out = decoded;
+            return true;
+        }
+
+        if (static_cast<unsigned char>(c) < 0x20)
+            return fail();
+
+        if (c != '\\')
+        {
+            decoded += c;
+            pos++;
+            continue;
+        }
+
+        if (++pos >= text.size())
+            return fail();
+
+        char escape = text[pos++];
+        switch (escape)
+        {
+            case '"': decoded += '"'; break;
+            case '\\': decoded += '\\'; break;
+            case '/': decoded += '/'; break;
+            case 'b': decoded += '\b'; break;
+            case 'f': decoded += '\f'; break;
+            case 'n': decoded += '\n'; break;
+            case 'r': decoded += '\r'; break;
+            case 't': decoded += '\t'; break;
+            case 'u':
+            {
+                uint32_t codepoint = 0;
+                if (!readHex4(text, pos, codepoint))
+                    return fail();
+                pos += 4;
+
+                if (codepoint >= 0xD800 && codepoint <= 0xDBFF)
+                {
+                    uint32_t low = 0;
+                    if (pos + 1 < text.size() && text[pos] == '\\' && text[pos + 1] == 'u' &&
+                        readHex4(text, pos + 2, low) && low >= 0xDC00 && low <= 0xDFFF)
+                    {
+                        pos += 6;
+                        codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    else
+                    {
+                        codepoint = 0xFFFD;
+                    }
+                }
+                else if (codepoint >= 0xDC00 && codepoint <= 0xDFFF)
+                {
+                    codepoint = 0xFFFD;
+                }
+
+                appendUtf8(decoded, codepoint);
+                break;
+            }
+            default:
+                return fail();
+        }
+    }
+
+    return fail();
+}
+
+bool JsonReader::scanNumber(std::string_view& out)
+{
+    size_t begin = pos;
+
+    if (pos < text.size() && text[pos] == '-')
+        pos++;
+
+    size_t digits = pos;
+    while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9')
+        pos++;
+    if (pos == digits)
+        return fail();
+
+    if (pos < text.size() && text[pos] == '.')
+    {
+        size_t fraction = ++pos;
+        while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9')
+            pos++;
+        if (pos == fraction)
+            return fail();
+    }
+
+    if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E'))
+    {
+        pos++;
+        if (pos < text.size() && (text[pos] == '+' || text[pos] == '-'))
+            pos++;
+
+        size_t exponent = pos;
+        while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9')
+            pos++;
+        if (pos == exponent)
+            return fail();
+    }
+
+    out = text.substr(begin, pos - begin);
+    return true;
+}
+
+bool JsonReader::scanLiteral(std::string_view literal)
+{
+    if (text.substr(pos, literal.size()) != literal)
+        return fail();
+
+    pos += literal.size();
+    return true;
+}
+
+bool JsonReader::readString(std::string_view& out)
+{
+    if (peek() != Kind::String)
+        return fail();
+
+    return scanString(out, scratch);
+}
+
+bool JsonReader::readScalar(std::string_view& out)
+{
+    switch (peek())
+    {
+        case Kind::String: return scanString(out, scratch);
+        case Kind::Number: return scanNumber(out);
+        case Kind::Bool:
+            out = text[pos] == 't' ? "true" : "false";
+            return scanLiteral(out);
+        case Kind::Null:
+            out = std::string_view();
+            return scanLiteral("null");
+        case Kind::Object:
+        case Kind::Array:
+            out = std::string_view();
+            skip();
+            return false;
+        case Kind::Invalid:
+            break;
+    }
+
+    return fail();
+}
+
+static bool isIntegral(std::string_view token)
+{
+    return token.find_first_of(".eE") == std::string_view::npos;
+}
+
+static std::string_view trimNumeric(std::string_view value)
+{
+    size_t begin = 0;
+    while (begin < value.size() && (value[begin] == ' ' || value[begin] == '\t' ||
+        value[begin] == '\n' || value[begin] == '\r'))
+        begin++;
+
+    if (begin < value.size() && value[begin] == '+')
+        begin++;
+
+    return value.substr(begin);
+}
+
+static bool parseDouble(std::string_view value, double& out)
+{
+    auto result = std::from_chars(value.data(), value.data() + value.size(), out);
+    return result.ec == std::errc() && result.ptr != value.data();
+}
+
+int64_t JsonReader::readInt64()
+{
+    Kind kind = peek();
+    std::string_view token;
+
+    if (kind == Kind::Number)
+    {
+        if (!scanNumber(token))
+            return 0;
+
+        if (!isIntegral(token))
+        {
+            double value = 0.0;
+            if (!parseDouble(token, value))
+                return 0;
+            if (value >= static_cast<double>(std::numeric_limits<int64_t>::max()))
+                return std::numeric_limits<int64_t>::max();
+            if (value <= static_cast<double>(std::numeric_limits<int64_t>::min()))
+                return std::numeric_limits<int64_t>::min();
+            return static_cast<int64_t>(value);
+        }
+
+        int64_t value = 0;
+        auto result = std::from_chars(token.data(), token.data() + token.size(), value);
+        if (result.ec == std::errc::result_out_of_range)
+            return token[0] == '-' ? std::numeric_limits<int64_t>::min() : std::numeric_limits<int64_t>::max();
+        return value;
+    }
+
+    if (kind == Kind::String)
+    {
+        if (!scanString(token, scratch))
+            return 0;
+
+        token = trimNumeric(token);
+        int64_t value = 0;
+        auto result = std::from_chars(token.data(), token.data() + token.size(), value);
+        return result.ec == std::errc() && result.ptr != token.data() ? value : 0;
+    }
+
+    if (kind == Kind::Bool)
+        return readBool() ? 1 : 0;
+
+    skip();
+    return 0;
+}
+
+double JsonReader::readDouble()
+{
+    Kind kind = peek();
+    std::string_view token;
+    double value = 0.0;
+
+    if (kind == Kind::Number)
+    {
+        if (!scanNumber(token) || !parseDouble(token, value))
+            return 0.0;
+        return value;
+    }
+
+    if (kind == Kind::String)
+    {
+        if (!scanString(token, scratch) || !parseDouble(trimNumeric(token), value))
+            return 0.0;
+        return value;
+    }
+
+    if (kind == Kind::Bool)
+        return readBool() ? 1.0 : 0.0;
+
+    skip();
+    return 0.0;
+}
+
+bool JsonReader::readBool()
+{
+    Kind kind = peek();
+    std::string_view token;
+
+    switch (kind)
+    {
+        case Kind::Bool:
+            if (text[pos] == 't')
+                return scanLiteral("true");
+            scanLiteral("false");
+            return false;
+        case Kind::Number:
+        {
+            double value = 0.0;
+            return scanNumber(token) && parseDouble(token, value) && value != 0.0;
+        }
+        case Kind::String:
+            return scanString(token, scratch) && !token.empty();
+        default:
+            skip();
+            return false;
+    }
+}
+
+bool JsonReader::skipNull()
+{
+    if (peek() != Kind::Null)
+        return false;
+
+    return scanLiteral("null");
+}
+
+bool JsonReader::skip()
+{
+    int depth = 0;
+    std::string_view ignored;
+
+    do
+    {
+        if (error)
+            return false;
+
+        skipSpace();
+        if (pos >= text.size())
+            return fail();
+
+        char c = text[pos];
+
+        if (depth > 0 && (c == ',' || c == ':'))
+        {
+            pos++;
+            continue;
+        }
+
+        switch (c)
+        {
+            case '{':
+            case '[':
+                if (++depth > MAX_DEPTH)
+                    return fail();
+                pos++;
+                break;
+            case '}':
+            case ']':
+                if (depth == 0)
+                    return fail();
+                depth--;
+                pos++;
+                break;
+            case '"':
+                if (!scanString(ignored, scratch))
+                    return false;
+                break;
+            case 't':
+                if (!scanLiteral("true"))
+                    return false;
+                break;
+            case 'f':
+                if (!scanLiteral("false"))
+                    return false;
+                break;
+            case 'n':
+                if (!scanLiteral("null"))
+                    return false;
+                break;
+            default:
+                if (!scanNumber(ignored))
+                    return false;
+                break;
+        }
+    } while (depth > 0);
+
+    firstEntry = false;
+    return true;
+}
+
+} // namespace psn
@@ -1,4 +1,5 @@
 #include "psn/models.hpp"
+#include "psn/schema.hpp"
 
 #include <cstdlib>
 #include <cerrno>
@@ -48,23 +49,10 @@ bool jsonField(json_object* parent, const char* key, json_object** out)
 
 static std::string sanitizeApiText(const char* raw)
 {
-    if (!raw)
-        return std::string();
-
-    std::string value(raw);
-
-    for (char& c : value)
-    {
-        if (c == '\r' || c == '\n' || c == '\t')
-            c = ' ';
-    }
-
-    size_t begin = value.find_first_not_of(' ');
-    if (begin == std::string::npos)
-        return std::string();
-
-    size_t end = value.find_last_not_of(' ');
-    return value.substr(begin, end - begin + 1);
+    std::string value;
+    if (raw)
+        assignApiText(value, raw);
+    return value;
 }
 
 std::string jsonString(json_object* parent, const char* key)
@@ -181,7 +169,7 @@ TrophyRarity rarityOf(int trophyRare)
     }
 }
 
-int64_t parseIso8601Duration(const std::string& value)
+int64_t parseIso8601Duration(std::string_view value)
 {
     if (value.size() < 2 || value[0] != 'P')
         return 0;
@@ -504,6 +492,78 @@ void tallyGroupEarned(std::vector<TrophyGroup>& groups, const std::vector<Trophy
     }
 }
 
+static bool sameCounts(const TrophyCounts& a, const TrophyCounts& b)
+{
+    return a.bronze == b.bronze && a.silver == b.silver && a.gold == b.gold && a.platinum == b.platinum;
+}
+
+LibraryDelta diffLibrary(const std::vector<TrophyTitle>& previous, const std::vector<TrophyTitle>& current)
+{
+    std::unordered_map<std::string, const TrophyTitle*> before;
+    before.reserve(previous.size());
+
+    for (const TrophyTitle& title : previous)
+        before[title.npCommunicationId] = &title;
+
+    LibraryDelta delta;
+
+    for (const TrophyTitle& title : current)
+    {
+        auto found = before.find(title.npCommunicationId);
+        if (found == before.end())
+        {
+            delta.added.push_back(title.npCommunicationId);
+            continue;
+        }
+
+        const TrophyTitle& old = *found->second;
+        before.erase(found);
+
+        bool same = !title.lastUpdatedDateTime.empty() &&
+            title.lastUpdatedDateTime == old.lastUpdatedDateTime &&
+            title.progress == old.progress &&
+            sameCounts(title.earnedTrophies, old.earnedTrophies) &&
+            sameCounts(title.definedTrophies, old.definedTrophies);
+
+        (same ? delta.unchanged : delta.changed).push_back(title.npCommunicationId);
+    }
+
+    for (const TrophyTitle& title : previous)
+    {
+        if (before.count(title.npCommunicationId))
+            delta.removed.push_back(title.npCommunicationId);
+    }
+
+    return delta;
+}
+
+int detailRequestCount(const TrophyTitle& title)
+{
+    return title.hasTrophyGroups ? 4 : 2;
+}
+
+size_t approximateBytes(const TitleDetail& detail)
+{
+    size_t bytes = sizeof(TitleDetail) + detail.npCommunicationId.capacity() +
+        detail.npServiceName.capacity() + detail.lastUpdatedDateTime.capacity();
+
+    for (const TrophyGroup& group : detail.groups)
+    {
+        bytes += sizeof(TrophyGroup) + group.trophyGroupId.capacity() + group.trophyGroupName.capacity() +
+            group.trophyGroupDetail.capacity() + group.trophyGroupIconUrl.capacity() +
+            group.lastUpdatedDateTime.capacity();
+    }
+
+    for (const Trophy& trophy : detail.trophies)
+    {
+        bytes += sizeof(Trophy) + trophy.trophyName.capacity() + trophy.trophyDetail.capacity() +
+            trophy.trophyIconUrl.capacity() + trophy.trophyType.capacity() + trophy.trophyGroupId.capacity() +
+            trophy.earnedDateTime.capacity() + trophy.progressedDateTime.capacity();
+    }
+
+    return bytes;
+}
+
 json_object* toJson(const TrophyGroup& group)
 {
     json_object* obj = json_object_new_object();
@@ -635,4 +695,370 @@ bool parseProfile(json_object* obj, PsnProfile& out)
     return !out.onlineId.empty();
 }
 
+static void readValue(JsonReader& reader, TrophyCounts& out);
+
+namespace {
+
+constexpr Field<TrophyCounts> COUNTS_FIELDS[] = {
+    field<&TrophyCounts::bronze>("bronze"),
+    field<&TrophyCounts::silver>("silver"),
+    field<&TrophyCounts::gold>("gold"),
+    field<&TrophyCounts::platinum>("platinum"),
+};
+
+constexpr Field<TrophySummary> SUMMARY_FIELDS[] = {
+    field<&TrophySummary::accountId>("accountId"),
+    field<&TrophySummary::trophyLevel>("trophyLevel"),
+    field<&TrophySummary::progress>("progress"),
+    field<&TrophySummary::tier>("tier"),
+    field<&TrophySummary::earnedTrophies>("earnedTrophies"),
+    field<&TrophySummary::trophyPoint>("trophyPoint"),
+    field<&TrophySummary::trophyLevelBasePoint>("trophyLevelBasePoint"),
+    field<&TrophySummary::trophyLevelNextPoint>("trophyLevelNextPoint"),
+};
+
+constexpr Field<TrophyTitle> TITLE_FIELDS[] = {
+    field<&TrophyTitle::npServiceName>("npServiceName"),
+    field<&TrophyTitle::npCommunicationId>("npCommunicationId"),
+    field<&TrophyTitle::trophySetVersion>("trophySetVersion"),
+    field<&TrophyTitle::trophyTitleName>("trophyTitleName"),
+    field<&TrophyTitle::trophyTitleDetail>("trophyTitleDetail"),
+    field<&TrophyTitle::trophyTitleIconUrl>("trophyTitleIconUrl"),
+    field<&TrophyTitle::trophyTitlePlatform>("trophyTitlePlatform"),
+    field<&TrophyTitle::hasTrophyGroups>("hasTrophyGroups"),
+    field<&TrophyTitle::trophyGroupCount>("trophyGroupCount"),
+    field<&TrophyTitle::definedTrophies>("definedTrophies"),
+    field<&TrophyTitle::progress>("progress"),
+    field<&TrophyTitle::earnedTrophies>("earnedTrophies"),
+    field<&TrophyTitle::hiddenFlag>("hiddenFlag"),
+    field<&TrophyTitle::lastUpdatedDateTime>("lastUpdatedDateTime"),
+};
+
+constexpr Field<TrophyGroup> GROUP_DEFINITION_FIELDS[] = {
+    field<&TrophyGroup::trophyGroupId>("trophyGroupId"),
+    field<&TrophyGroup::trophyGroupName>("trophyGroupName"),
+    field<&TrophyGroup::trophyGroupDetail>("trophyGroupDetail"),
+    field<&TrophyGroup::trophyGroupIconUrl>("trophyGroupIconUrl"),
+    field<&TrophyGroup::definedTrophies>("definedTrophies"),
+};
+
+constexpr Field<TrophyGroup> GROUP_PROGRESS_FIELDS[] = {
+    field<&TrophyGroup::trophyGroupId>("trophyGroupId"),
+    field<&TrophyGroup::progress>("progress"),
+    field<&TrophyGroup::earnedTrophies>("earnedTrophies"),
+    field<&TrophyGroup::lastUpdatedDateTime>("lastUpdatedDateTime"),
+};
+
+constexpr Field<TrophyGroup> CACHED_GROUP_FIELDS[] = {
+    field<&TrophyGroup::trophyGroupId>("trophyGroupId"),
+    field<&TrophyGroup::trophyGroupName>("trophyGroupName"),
+    field<&TrophyGroup::trophyGroupDetail>("trophyGroupDetail"),
+    field<&TrophyGroup::trophyGroupIconUrl>("trophyGroupIconUrl"),
+    field<&TrophyGroup::definedTrophies>("definedTrophies"),
+    field<&TrophyGroup::earnedTrophies>("earnedTrophies"),
+    field<&TrophyGroup::progress>("progress"),
+    field<&TrophyGroup::lastUpdatedDateTime>("lastUpdatedDateTime"),
+};
+
+void readProgressTarget(JsonReader& reader, Trophy& out)
+{
+    out.hasProgress = true;
+    out.progressTarget = reader.readInt64();
+}
+
+void readProgressValue(JsonReader& reader, Trophy& out)
+{
+    out.hasProgress = true;
+    out.progress = reader.readInt64();
+}
+
+constexpr Field<Trophy> TROPHY_DEFINITION_FIELDS[] = {
+    field<&Trophy::trophyId>("trophyId"),
+    field<&Trophy::trophyHidden>("trophyHidden"),
+    field<&Trophy::trophyType>("trophyType"),
+    field<&Trophy::trophyName>("trophyName"),
+    field<&Trophy::trophyDetail>("trophyDetail"),
+    field<&Trophy::trophyIconUrl>("trophyIconUrl"),
+    field<&Trophy::trophyGroupId>("trophyGroupId"),
+    {"trophyProgressTargetValue", readProgressTarget},
+};
+
+constexpr Field<Trophy> TROPHY_PROGRESS_FIELDS[] = {
+    field<&Trophy::trophyId>("trophyId"),
+    field<&Trophy::trophyHidden>("trophyHidden"),
+    field<&Trophy::earned>("earned"),
+    field<&Trophy::earnedDateTime>("earnedDateTime"),
+    {"progress", readProgressValue},
+    field<&Trophy::progressRate>("progressRate"),
+    field<&Trophy::progressedDateTime>("progressedDateTime"),
+    field<&Trophy::trophyType>("trophyType"),
+    field<&Trophy::trophyRare>("trophyRare"),
+    field<&Trophy::trophyEarnedRate>("trophyEarnedRate"),
+};
+
+constexpr Field<Trophy> CACHED_TROPHY_FIELDS[] = {
+    field<&Trophy::trophyId>("trophyId"),
+    field<&Trophy::trophyName>("trophyName"),
+    field<&Trophy::trophyDetail>("trophyDetail"),
+    field<&Trophy::trophyIconUrl>("trophyIconUrl"),
+    field<&Trophy::trophyType>("trophyType"),
+    field<&Trophy::trophyGroupId>("trophyGroupId"),
+    field<&Trophy::trophyHidden>("trophyHidden"),
+    field<&Trophy::earned>("earned"),
+    field<&Trophy::earnedDateTime>("earnedDateTime"),
+    field<&Trophy::trophyRare>("trophyRare"),
+    field<&Trophy::trophyEarnedRate>("trophyEarnedRate"),
+    field<&Trophy::hasProgress>("hasProgress"),
+    field<&Trophy::progress>("progress"),
+    field<&Trophy::progressTarget>("progressTarget"),
+    field<&Trophy::progressRate>("progressRate"),
+    field<&Trophy::progressedDateTime>("progressedDateTime"),
+    {"trophyProgressTargetValue", readProgressTarget},
+};
+
+void assignIfPresent(JsonReader& reader, std::string& out, bool overwrite)
+{
+    std::string_view raw;
+    if (!reader.readScalar(raw))
+        return;
+
+    if (!overwrite && !out.empty())
+        return;
+
+    if (raw.find_first_not_of(" \r\n\t") != std::string_view::npos)
+        assignApiText(out, raw);
+}
+
+constexpr Field<PlayedGame> PLAYED_GAME_FIELDS[] = {
+    field<&PlayedGame::titleId>("titleId"),
+    {"name", [](JsonReader& reader, PlayedGame& out) { assignIfPresent(reader, out.name, false); }},
+    {"localizedName", [](JsonReader& reader, PlayedGame& out) { assignIfPresent(reader, out.name, true); }},
+    {"imageUrl", [](JsonReader& reader, PlayedGame& out) { assignIfPresent(reader, out.imageUrl, false); }},
+    {"localizedImageUrl", [](JsonReader& reader, PlayedGame& out) { assignIfPresent(reader, out.imageUrl, true); }},
+    field<&PlayedGame::category>("category"),
+    field<&PlayedGame::playCount>("playCount"),
+    {"playDuration", [](JsonReader& reader, PlayedGame& out) {
+        std::string_view raw;
+        if (reader.readScalar(raw))
+            out.playDurationSeconds = parseIso8601Duration(raw);
+    }},
+    field<&PlayedGame::firstPlayedDateTime>("firstPlayedDateTime"),
+    field<&PlayedGame::lastPlayedDateTime>("lastPlayedDateTime"),
+};
+
+constexpr Field<PsnAvatar> AVATAR_FIELDS[] = {
+    field<&PsnAvatar::size>("size"),
+    field<&PsnAvatar::url>("url"),
+};
+
+void readAvatars(JsonReader& reader, PsnProfile& out)
+{
+    decodeArray(reader, [&out](JsonReader& row) {
+        PsnAvatar avatar;
+        if (decodeObject(row, AVATAR_FIELDS, avatar) && !avatar.url.empty())
+            out.avatars.push_back(std::move(avatar));
+    });
+}
+
+constexpr Field<PsnProfile> PROFILE_FIELDS[] = {
+    field<&PsnProfile::onlineId>("onlineId"),
+    field<&PsnProfile::aboutMe>("aboutMe"),
+    {"avatars", readAvatars},
+    field<&PsnProfile::isPlus>("isPlus"),
+    field<&PsnProfile::isOfficiallyVerified>("isOfficiallyVerified"),
+};
+
+constexpr uint64_t TROPHY_DEFINITION_ID = fieldBit(TROPHY_DEFINITION_FIELDS, "trophyId");
+constexpr uint64_t TROPHY_PROGRESS_ID = fieldBit(TROPHY_PROGRESS_FIELDS, "trophyId");
+constexpr uint64_t TROPHY_PROGRESS_VALUE = fieldBit(TROPHY_PROGRESS_FIELDS, "progress");
+constexpr uint64_t TROPHY_PROGRESS_RARE = fieldBit(TROPHY_PROGRESS_FIELDS, "trophyRare");
+constexpr uint64_t CACHED_TROPHY_ID = fieldBit(CACHED_TROPHY_FIELDS, "trophyId");
+constexpr uint64_t CACHED_TROPHY_RARE = fieldBit(CACHED_TROPHY_FIELDS, "trophyRare");
+
+} // namespace
+
+static void readValue(JsonReader& reader, TrophyCounts& out)
+{
+    out = TrophyCounts{};
+    decodeObject(reader, COUNTS_FIELDS, out);
+}
+
+bool parseSummary(JsonReader& reader, TrophySummary& out)
+{
+    out = TrophySummary{};
+    return decodeObject(reader, SUMMARY_FIELDS, out);
+}
+
+bool parseProfile(JsonReader& reader, PsnProfile& out)
+{
+    out = PsnProfile{};
+    return decodeObject(reader, PROFILE_FIELDS, out) && !out.onlineId.empty();
+}
+
+bool parseTitle(JsonReader& reader, TrophyTitle& out)
+{
+    out = TrophyTitle{};
+    return decodeObject(reader, TITLE_FIELDS, out) && !out.npCommunicationId.empty();
+}
+
+bool parseGroupDefinition(JsonReader& reader, TrophyGroup& out)
+{
+    out = TrophyGroup{};
+    return decodeObject(reader, GROUP_DEFINITION_FIELDS, out) && !out.trophyGroupId.empty();
+}
+
+bool parseGroupProgress(JsonReader& reader, TrophyGroup& out)
+{
+    out = TrophyGroup{};
+    return decodeObject(reader, GROUP_PROGRESS_FIELDS, out) && !out.trophyGroupId.empty();
+}
+
+bool parseCachedGroup(JsonReader& reader, TrophyGroup& out)
+{
+    out = TrophyGroup{};
+    return decodeObject(reader, CACHED_GROUP_FIELDS, out) && !out.trophyGroupId.empty();
+}
+
+bool parseTrophyDefinition(JsonReader& reader, Trophy& out)
+{
+    out = Trophy{};
+    uint64_t seen = 0;
+    return decodeObject(reader, TROPHY_DEFINITION_FIELDS, out, &seen) && (seen & TROPHY_DEFINITION_ID);
+}
+
+bool parseTrophyProgress(JsonReader& reader, Trophy& out)
+{
+    out = Trophy{};
+    uint64_t seen = 0;
+    if (!decodeObject(reader, TROPHY_PROGRESS_FIELDS, out, &seen) || !(seen & TROPHY_PROGRESS_ID))
+        return false;
+
+    if (!(seen & TROPHY_PROGRESS_VALUE))
+        out.progressRate = 0;
+    if (!(seen & TROPHY_PROGRESS_RARE))
+        out.trophyRare = 0;
+    return true;
+}
+
+bool parseCachedTrophy(JsonReader& reader, Trophy& out)
+{
+    out = Trophy{};
+    uint64_t seen = 0;
+    if (!decodeObject(reader, CACHED_TROPHY_FIELDS, out, &seen) || !(seen & CACHED_TROPHY_ID))
+        return false;
+
+    if (!out.hasProgress)
+    {
+        out.progress = 0;
+        out.progressTarget = 0;
+        out.progressRate = 0;
+    }
+    if (!(seen & CACHED_TROPHY_RARE))
+        out.trophyRare = 0;
+    return true;
+}
+
+bool parsePlayedGame(JsonReader& reader, PlayedGame& out)
+{
+    out = PlayedGame{};
+    return decodeObject(reader, PLAYED_GAME_FIELDS, out) && !out.titleId.empty();
+}
+
+namespace {
+
+struct SummaryDocument {
+    int64_t savedAt = 0;
+    TrophySummary summary;
+    bool hasSummary = false;
+};
+
+constexpr Field<SummaryDocument> SUMMARY_DOCUMENT_FIELDS[] = {
+    field<&SummaryDocument::savedAt>("savedAt"),
+    {"summary", [](JsonReader& reader, SummaryDocument& out) {
+        out.hasSummary = parseSummary(reader, out.summary);
+    }},
+};
+
+struct LibraryDocument {
+    int64_t savedAt = 0;
+    std::vector<TrophyTitle>* titles = nullptr;
+    bool hasTitles = false;
+};
+
+constexpr Field<LibraryDocument> LIBRARY_DOCUMENT_FIELDS[] = {
+    field<&LibraryDocument::savedAt>("savedAt"),
+    {"titles", [](JsonReader& reader, LibraryDocument& out) {
+        out.hasTitles = decodeArray(reader, [&out](JsonReader& row) {
+            TrophyTitle title;
+            if (parseTitle(row, title))
+                out.titles->push_back(std::move(title));
+        });
+    }},
+};
+
+struct DetailDocument {
+    int64_t savedAt = 0;
+    TitleDetail* detail = nullptr;
+    bool hasTrophies = false;
+};
+
+constexpr Field<DetailDocument> DETAIL_DOCUMENT_FIELDS[] = {
+    field<&DetailDocument::savedAt>("savedAt"),
+    {"npCommunicationId", [](JsonReader& reader, DetailDocument& out) { readValue(reader, out.detail->npCommunicationId); }},
+    {"npServiceName", [](JsonReader& reader, DetailDocument& out) { readValue(reader, out.detail->npServiceName); }},
+    {"lastUpdatedDateTime", [](JsonReader& reader, DetailDocument& out) { readValue(reader, out.detail->lastUpdatedDateTime); }},
+    {"groups", [](JsonReader& reader, DetailDocument& out) {
+        decodeArray(reader, [&out](JsonReader& row) {
+            TrophyGroup group;
+            if (parseCachedGroup(row, group))
+                out.detail->groups.push_back(std::move(group));
+        });
+    }},
+    {"trophies", [](JsonReader& reader, DetailDocument& out) {
+        out.hasTrophies = decodeArray(reader, [&out](JsonReader& row) {
+            Trophy trophy;
+            if (parseCachedTrophy(row, trophy))
+                out.detail->trophies.push_back(std::move(trophy));
+        });
+    }},
+};
+
+} // namespace
+
+bool parseCachedSummary(std::string_view body, TrophySummary& out, int64_t& outSavedAt)
+{
+    JsonReader reader(body);
+    SummaryDocument doc;
+    if (!decodeObject(reader, SUMMARY_DOCUMENT_FIELDS, doc) || !doc.hasSummary)
+        return false;
+
+    outSavedAt = doc.savedAt;
+    out = std::move(doc.summary);
+    return true;
+}
+
+bool parseCachedLibrary(std::string_view body, std::vector<TrophyTitle>& out, int64_t& outSavedAt)
+{
+    JsonReader reader(body);
+    LibraryDocument doc;
+    doc.titles = &out;
+    if (!decodeObject(reader, LIBRARY_DOCUMENT_FIELDS, doc) || !doc.hasTitles)
+        return false;
+
+    outSavedAt = doc.savedAt;
+    return true;
+}
+
+bool parseCachedDetail(std::string_view body, TitleDetail& out, int64_t& outSavedAt)
+{
+    JsonReader reader(body);
+    DetailDocument doc;
+    doc.detail = &out;
+    if (!decodeObject(reader, DETAIL_DOCUMENT_FIELDS, doc) || !doc.hasTrophies)
+        return false;
+
+    outSavedAt = doc.savedAt;
+    return !out.trophies.empty();
+}
+
 } // namespace psn
@@ -0,0 +1,66 @@
+#include "psn/retry_policy.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <format>
+
+namespace psn {
+
+static int cooldownFor(const std::string& retryAfter)
+{
+    int cooldown = RetryPolicy::THROTTLE_SECONDS;
+
+    // Only the delta-seconds form is honoured; an HTTP date falls back to the default.
+    if (!retryAfter.empty() && std::all_of(retryAfter.begin(), retryAfter.end(),
+            [](char c) { return c >= '0' && c <= '9'; }))
+        cooldown = std::max(cooldown, std::atoi(retryAfter.substr(0, 9).c_str()));
+
+    return std::min(cooldown, RetryPolicy::THROTTLE_MAX_SECONDS);
+}
+
+Verdict RetryPolicy::judge(const Reply& reply, int attempt, bool refreshedOn401)
+{
+    Verdict verdict;
+
+    if (!reply.transportFailed && reply.status == 200)
+        return verdict;
+
+    if (!reply.transportFailed && reply.status == 401)
+    {
+        if (refreshedOn401)
+        {
+            verdict.next = Next::Fail;
+            verdict.error = {Status::SessionExpired, "PSN rejected the access token after a refresh"};
+            return verdict;
+        }
+
+        verdict.next = Next::RefreshToken;
+        return verdict;
+    }
+
+    if (!reply.transportFailed && reply.status == 429)
+    {
+        verdict.next = Next::Throttle;
+        verdict.cooldownSeconds = cooldownFor(reply.retryAfter);
+        verdict.error = {Status::RateLimited,
+            std::format("PSN is rate-limiting, backing off for {}s", verdict.cooldownSeconds)};
+        return verdict;
+    }
+
+    bool retryable = reply.transportFailed || reply.status >= 500;
+    verdict.error = reply.transportFailed
+        ? Error{Status::Offline, reply.error}
+        : Error{Status::ServerError, std::format("HTTP {}", reply.status)};
+
+    if (!retryable || attempt >= MAX_ATTEMPTS)
+    {
+        verdict.next = Next::Fail;
+        return verdict;
+    }
+
+    verdict.next = Next::Retry;
+    verdict.backoffSeconds = FIRST_BACKOFF_SECONDS << std::clamp(attempt - 1, 0, 16);
+    return verdict;
+}
+
+} // namespace psn
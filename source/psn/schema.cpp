@@ -0,0 +1,58 @@
+#include "psn/schema.hpp"
+
+namespace psn {
+
+static bool isApiSpace(char c)
+{
+    return c == ' ' || c == '\r' || c == '\n' || c == '\t';
+}
+
+void assignApiText(std::string& out, std::string_view raw)
+{
+    size_t begin = 0;
+    while (begin < raw.size() && isApiSpace(raw[begin]))
+        begin++;
+
+    size_t end = raw.size();
+    while (end > begin && isApiSpace(raw[end - 1]))
+        end--;
+
+    out.assign(raw.data() + begin, end - begin);
+
+    for (char& c : out)
+    {
+        if (c == '\r' || c == '\n' || c == '\t')
+            c = ' ';
+    }
+}
+
+void readValue(JsonReader& reader, std::string& out)
+{
+    std::string_view raw;
+    if (reader.readScalar(raw))
+        assignApiText(out, raw);
+    else
+        out.clear();
+}
+
+void readValue(JsonReader& reader, int& out)
+{
+    out = static_cast<int>(reader.readInt64());
+}
+
+void readValue(JsonReader& reader, int64_t& out)
+{
+    out = reader.readInt64();
+}
+
+void readValue(JsonReader& reader, double& out)
+{
+    out = reader.readDouble();
+}
+
+void readValue(JsonReader& reader, bool& out)
+{
+    out = reader.readBool();
+}
+
+} // namespace psn
@@ -0,0 +1,637 @@
+#include "psn/snapshot.hpp"
+#include "util/file_io.hpp"
+
+#include <json-c/json.h>
+
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+namespace psn {
+
+static_assert(std::endian::native == std::endian::little, "snapshots are stored in host byte order");
+
+namespace {
+
+constexpr char MAGIC[4] = {'A', 'K', 'T', 'S'};
+constexpr size_t HEADER_SIZE = 32;
+constexpr size_t SECTION_SIZE = 16;
+
+constexpr uint32_t sectionTag(const char (&name)[5])
+{
+    return uint32_t(uint8_t(name[0])) | uint32_t(uint8_t(name[1])) << 8 |
+        uint32_t(uint8_t(name[2])) << 16 | uint32_t(uint8_t(name[3])) << 24;
+}
+
+constexpr uint32_t TAG_SUMMARY = sectionTag("SUMM");
+constexpr uint32_t TAG_TITLES = sectionTag("TITL");
+constexpr uint32_t TAG_DETAIL = sectionTag("DETL");
+constexpr uint32_t TAG_GROUPS = sectionTag("GRUP");
+constexpr uint32_t TAG_TROPHIES = sectionTag("TROP");
+
+// Record sizes for version 1. A string is an (offset, length) pair into the string table.
+constexpr uint32_t STRING = 8;
+constexpr uint32_t COUNTS = 16;
+constexpr uint32_t SUMMARY_RECORD = STRING + 6 * 4 + COUNTS;
+constexpr uint32_t TITLE_RECORD = 8 * STRING + 2 + 2 * 4 + 2 * COUNTS;
+constexpr uint32_t DETAIL_RECORD = 3 * STRING;
+constexpr uint32_t GROUP_RECORD = 5 * STRING + 2 * COUNTS + 4;
+constexpr uint32_t TROPHY_RECORD = 4 + 7 * STRING + 3 + 4 + 8 + 2 * 8 + 4;
+
+uint32_t checksum(std::string_view bytes)
+{
+    uint32_t hash = 2166136261u;
+    for (char c : bytes)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+class SnapshotWriter {
+public:
+    void section(uint32_t tag, uint32_t recordSize, uint32_t count)
+    {
+        sections.push_back({tag, recordSize, count, static_cast<uint32_t>(records.size())});
+        records.reserve(records.size() + size_t(recordSize) * count);
+    }
+
+    template <typename T>
+    void put(T value)
+    {
+        char raw[sizeof(T)];
+        std::memcpy(raw, &value, sizeof(T));
+        records.append(raw, sizeof(T));
+    }
+
+    void putBool(bool value) { put<uint8_t>(value ? 1 : 0); }
+
+    void putString(const std::string& value)
+    {
+        auto found = interned.find(value);
+        uint32_t offset = 0;
+
+        if (found != interned.end())
+        {
+            offset = found->second;
+        }
+        else
+        {
+            offset = static_cast<uint32_t>(strings.size());
+            strings += value;
+            interned.emplace(value, offset);
+        }
+
+        put<uint32_t>(offset);
+        put<uint32_t>(static_cast<uint32_t>(value.size()));
+    }
+
+    void putCounts(const TrophyCounts& counts)
+    {
+        put<int32_t>(counts.bronze);
+        put<int32_t>(counts.silver);
+        put<int32_t>(counts.gold);
+        put<int32_t>(counts.platinum);
+    }
+
+    std::string finish(SnapshotKind kind, int64_t savedAt)
+    {
+        uint32_t tableBytes = static_cast<uint32_t>(sections.size() * SECTION_SIZE);
+
+        std::string body;
+        body.reserve(tableBytes + records.size() + strings.size());
+
+        for (const Section& entry : sections)
+        {
+            uint32_t fields[4] = {entry.tag, entry.recordSize, entry.count, entry.offset + tableBytes};
+            body.append(reinterpret_cast<const char*>(fields), sizeof(fields));
+        }
+        body += records;
+        body += strings;
+
+        std::string out;
+        out.reserve(HEADER_SIZE + body.size());
+        out.append(MAGIC, sizeof(MAGIC));
+        appendRaw(out, SNAPSHOT_VERSION);
+        appendRaw(out, static_cast<uint16_t>(kind));
+        appendRaw(out, savedAt);
+        appendRaw(out, static_cast<uint32_t>(sections.size()));
+        appendRaw(out, static_cast<uint32_t>(strings.size()));
+        appendRaw(out, checksum(body));
+        appendRaw(out, uint32_t(0));
+        out += body;
+        return out;
+    }
+
+private:
+    struct Section {
+        uint32_t tag;
+        uint32_t recordSize;
+        uint32_t count;
+        uint32_t offset;
+    };
+
+    template <typename T>
+    static void appendRaw(std::string& out, T value)
+    {
+        char raw[sizeof(T)];
+        std::memcpy(raw, &value, sizeof(T));
+        out.append(raw, sizeof(T));
+    }
+
+    std::vector<Section> sections;
+    std::string records;
+    std::string strings;
+    std::unordered_map<std::string, uint32_t> interned;
+};
+
+// Reads one record. Every accessor checks bounds, and a bad string reference marks the
+// whole snapshot corrupt rather than yielding a truncated value.
+class RecordReader {
+public:
+    RecordReader(const char* at, std::string_view strings, bool& ok)
+        : at(at), strings(strings), ok(ok)
+    {
+    }
+
+    template <typename T>
+    T get()
+    {
+        T value;
+        std::memcpy(&value, at, sizeof(T));
+        at += sizeof(T);
+        return value;
+    }
+
+    bool getBool() { return get<uint8_t>() != 0; }
+
+    void getString(std::string& out)
+    {
+        uint32_t offset = get<uint32_t>();
+        uint32_t length = get<uint32_t>();
+
+        if (size_t(offset) + length > strings.size())
+        {
+            ok = false;
+            out.clear();
+            return;
+        }
+
+        out.assign(strings.data() + offset, length);
+    }
+
+    void getCounts(TrophyCounts& out)
+    {
+        out.bronze = get<int32_t>();
+        out.silver = get<int32_t>();
+        out.gold = get<int32_t>();
+        out.platinum = get<int32_t>();
+    }
+
+private:
+    const char* at;
+    std::string_view strings;
+    bool& ok;
+};
+
+class SnapshotView {
+public:
+    struct Section {
+        const char* records = nullptr;
+        uint32_t recordSize = 0;
+        uint32_t count = 0;
+    };
+
+    bool open(std::string_view bytes, SnapshotKind expected)
+    {
+        if (bytes.size() < HEADER_SIZE || std::memcmp(bytes.data(), MAGIC, sizeof(MAGIC)) != 0)
+            return false;
+
+        uint16_t version = read<uint16_t>(bytes, 4);
+        uint16_t kind = read<uint16_t>(bytes, 6);
+        if (version != SNAPSHOT_VERSION || kind != static_cast<uint16_t>(expected))
+            return false;
+
+        savedAt = read<int64_t>(bytes, 8);
+        uint32_t sectionCount = read<uint32_t>(bytes, 16);
+        uint32_t stringBytes = read<uint32_t>(bytes, 20);
+        uint32_t expectedSum = read<uint32_t>(bytes, 24);
+
+        body = bytes.substr(HEADER_SIZE);
+        if (checksum(body) != expectedSum)
+            return false;
+
+        size_t tableBytes = size_t(sectionCount) * SECTION_SIZE;
+        if (tableBytes > body.size() || stringBytes > body.size() - tableBytes)
+            return false;
+
+        size_t recordsEnd = body.size() - stringBytes;
+        strings = body.substr(recordsEnd);
+
+        for (uint32_t i = 0; i < sectionCount; i++)
+        {
+            size_t at = size_t(i) * SECTION_SIZE;
+            Entry entry;
+            entry.tag = read<uint32_t>(body, at);
+            entry.section.recordSize = read<uint32_t>(body, at + 4);
+            entry.section.count = read<uint32_t>(body, at + 8);
+            uint32_t offset = read<uint32_t>(body, at + 12);
+
+            uint64_t span = uint64_t(entry.section.recordSize) * entry.section.count;
+            if (offset < tableBytes || offset > recordsEnd || span > recordsEnd - offset)
+                return false;
+
+            entry.section.records = body.data() + offset;
+            entries.push_back(entry);
+        }
+
+        return true;
+    }
+
+    // A newer writer may append fields to a record, so a larger record size is accepted and
+    // the tail ignored; a smaller one cannot be read.
+    bool section(uint32_t tag, uint32_t minimumRecordSize, Section& out) const
+    {
+        for (const Entry& entry : entries)
+        {
+            if (entry.tag != tag)
+                continue;
+            if (entry.section.recordSize < minimumRecordSize)
+                return false;
+            out = entry.section;
+            return true;
+        }
+        return false;
+    }
+
+    RecordReader record(const Section& section, uint32_t index, bool& ok) const
+    {
+        return RecordReader(section.records + size_t(section.recordSize) * index, strings, ok);
+    }
+
+    int64_t savedAt = 0;
+
+private:
+    struct Entry {
+        uint32_t tag = 0;
+        Section section;
+    };
+
+    template <typename T>
+    static T read(std::string_view bytes, size_t at)
+    {
+        T value;
+        std::memcpy(&value, bytes.data() + at, sizeof(T));
+        return value;
+    }
+
+    std::string_view body;
+    std::string_view strings;
+    std::vector<Entry> entries;
+};
+
+void putSummary(SnapshotWriter& writer, const TrophySummary& summary)
+{
+    writer.putString(summary.accountId);
+    writer.put<int32_t>(summary.trophyLevel);
+    writer.put<int32_t>(summary.tier);
+    writer.put<int32_t>(summary.progress);
+    writer.put<int32_t>(summary.trophyPoint);
+    writer.put<int32_t>(summary.trophyLevelBasePoint);
+    writer.put<int32_t>(summary.trophyLevelNextPoint);
+    writer.putCounts(summary.earnedTrophies);
+}
+
+void getSummary(RecordReader& record, TrophySummary& out)
+{
+    record.getString(out.accountId);
+    out.trophyLevel = record.get<int32_t>();
+    out.tier = record.get<int32_t>();
+    out.progress = record.get<int32_t>();
+    out.trophyPoint = record.get<int32_t>();
+    out.trophyLevelBasePoint = record.get<int32_t>();
+    out.trophyLevelNextPoint = record.get<int32_t>();
+    record.getCounts(out.earnedTrophies);
+}
+
+void putTitle(SnapshotWriter& writer, const TrophyTitle& title)
+{
+    writer.putString(title.npCommunicationId);
+    writer.putString(title.npServiceName);
+    writer.putString(title.trophyTitleName);
+    writer.putString(title.trophyTitleDetail);
+    writer.putString(title.trophyTitleIconUrl);
+    writer.putString(title.trophyTitlePlatform);
+    writer.putString(title.trophySetVersion);
+    writer.putString(title.lastUpdatedDateTime);
+    writer.putBool(title.hasTrophyGroups);
+    writer.putBool(title.hiddenFlag);
+    writer.put<int32_t>(title.trophyGroupCount);
+    writer.put<int32_t>(title.progress);
+    writer.putCounts(title.definedTrophies);
+    writer.putCounts(title.earnedTrophies);
+}
+
+void getTitle(RecordReader& record, TrophyTitle& out)
+{
+    record.getString(out.npCommunicationId);
+    record.getString(out.npServiceName);
+    record.getString(out.trophyTitleName);
+    record.getString(out.trophyTitleDetail);
+    record.getString(out.trophyTitleIconUrl);
+    record.getString(out.trophyTitlePlatform);
+    record.getString(out.trophySetVersion);
+    record.getString(out.lastUpdatedDateTime);
+    out.hasTrophyGroups = record.getBool();
+    out.hiddenFlag = record.getBool();
+    out.trophyGroupCount = record.get<int32_t>();
+    out.progress = record.get<int32_t>();
+    record.getCounts(out.definedTrophies);
+    record.getCounts(out.earnedTrophies);
+}
+
+void putGroup(SnapshotWriter& writer, const TrophyGroup& group)
+{
+    writer.putString(group.trophyGroupId);
+    writer.putString(group.trophyGroupName);
+    writer.putString(group.trophyGroupDetail);
+    writer.putString(group.trophyGroupIconUrl);
+    writer.putString(group.lastUpdatedDateTime);
+    writer.putCounts(group.definedTrophies);
+    writer.putCounts(group.earnedTrophies);
+    writer.put<int32_t>(group.progress);
+}
+
+void getGroup(RecordReader& record, TrophyGroup& out)
+{
+    record.getString(out.trophyGroupId);
+    record.getString(out.trophyGroupName);
+    record.getString(out.trophyGroupDetail);
+    record.getString(out.trophyGroupIconUrl);
+    record.getString(out.lastUpdatedDateTime);
+    record.getCounts(out.definedTrophies);
+    record.getCounts(out.earnedTrophies);
+    out.progress = record.get<int32_t>();
+}
+
+void putTrophy(SnapshotWriter& writer, const Trophy& trophy)
+{
+    writer.put<int32_t>(trophy.trophyId);
+    writer.putString(trophy.trophyName);
+    writer.putString(trophy.trophyDetail);
+    writer.putString(trophy.trophyIconUrl);
+    writer.putString(trophy.trophyType);
+    writer.putString(trophy.trophyGroupId);
+    writer.putString(trophy.earnedDateTime);
+    writer.putString(trophy.progressedDateTime);
+    writer.putBool(trophy.trophyHidden);
+    writer.putBool(trophy.earned);
+    writer.putBool(trophy.hasProgress);
+    writer.put<int32_t>(trophy.trophyRare);
+    writer.put<double>(trophy.trophyEarnedRate);
+    writer.put<int64_t>(trophy.progress);
+    writer.put<int64_t>(trophy.progressTarget);
+    writer.put<int32_t>(trophy.progressRate);
+}
+
+void getTrophy(RecordReader& record, Trophy& out)
+{
+    out.trophyId = record.get<int32_t>();
+    record.getString(out.trophyName);
+    record.getString(out.trophyDetail);
+    record.getString(out.trophyIconUrl);
+    record.getString(out.trophyType);
+    record.getString(out.trophyGroupId);
+    record.getString(out.earnedDateTime);
+    record.getString(out.progressedDateTime);
+    out.trophyHidden = record.getBool();
+    out.earned = record.getBool();
+    out.hasProgress = record.getBool();
+    out.trophyRare = record.get<int32_t>();
+    out.trophyEarnedRate = record.get<double>();
+    out.progress = record.get<int64_t>();
+    out.progressTarget = record.get<int64_t>();
+    out.progressRate = record.get<int32_t>();
+}
+
+template <typename T, typename Get>
+bool readSection(const SnapshotView& view, uint32_t tag, uint32_t recordSize, std::vector<T>& out, Get get)
+{
+    SnapshotView::Section section;
+    if (!view.section(tag, recordSize, section))
+        return false;
+
+    bool ok = true;
+    out.resize(section.count);
+    for (uint32_t i = 0; i < section.count && ok; i++)
+    {
+        RecordReader record = view.record(section, i, ok);
+        get(record, out[i]);
+    }
+    return ok;
+}
+
+} // namespace
+
+std::string encodeSnapshot(const TrophySummary& summary, int64_t savedAt)
+{
+    SnapshotWriter writer;
+    writer.section(TAG_SUMMARY, SUMMARY_RECORD, 1);
+    putSummary(writer, summary);
+    return writer.finish(SnapshotKind::Summary, savedAt);
+}
+
+std::string encodeSnapshot(const std::vector<TrophyTitle>& titles, int64_t savedAt)
+{
+    SnapshotWriter writer;
+    writer.section(TAG_TITLES, TITLE_RECORD, static_cast<uint32_t>(titles.size()));
+    for (const TrophyTitle& title : titles)
+        putTitle(writer, title);
+    return writer.finish(SnapshotKind::Library, savedAt);
+}
+
+std::string encodeSnapshot(const TitleDetail& detail, int64_t savedAt)
+{
+    SnapshotWriter writer;
+
+    writer.section(TAG_DETAIL, DETAIL_RECORD, 1);
+    writer.putString(detail.npCommunicationId);
+    writer.putString(detail.npServiceName);
+    writer.putString(detail.lastUpdatedDateTime);
+
+    writer.section(TAG_GROUPS, GROUP_RECORD, static_cast<uint32_t>(detail.groups.size()));
+    for (const TrophyGroup& group : detail.groups)
+        putGroup(writer, group);
+
+    writer.section(TAG_TROPHIES, TROPHY_RECORD, static_cast<uint32_t>(detail.trophies.size()));
+    for (const Trophy& trophy : detail.trophies)
+        putTrophy(writer, trophy);
+
+    return writer.finish(SnapshotKind::Detail, savedAt);
+}
+
+bool decodeSnapshot(std::string_view bytes, TrophySummary& out, int64_t& outSavedAt)
+{
+    SnapshotView view;
+    std::vector<TrophySummary> rows;
+    if (!view.open(bytes, SnapshotKind::Summary) ||
+        !readSection(view, TAG_SUMMARY, SUMMARY_RECORD, rows, getSummary) || rows.size() != 1)
+        return false;
+
+    out = std::move(rows.front());
+    outSavedAt = view.savedAt;
+    return true;
+}
+
+bool decodeSnapshot(std::string_view bytes, std::vector<TrophyTitle>& out, int64_t& outSavedAt)
+{
+    SnapshotView view;
+    std::vector<TrophyTitle> titles;
+    if (!view.open(bytes, SnapshotKind::Library) || !readSection(view, TAG_TITLES, TITLE_RECORD, titles, getTitle))
+        return false;
+
+    out = std::move(titles);
+    outSavedAt = view.savedAt;
+    return true;
+}
+
+bool decodeSnapshot(std::string_view bytes, TitleDetail& out, int64_t& outSavedAt)
+{
+    SnapshotView view;
+    if (!view.open(bytes, SnapshotKind::Detail))
+        return false;
+
+    SnapshotView::Section header;
+    if (!view.section(TAG_DETAIL, DETAIL_RECORD, header) || header.count != 1)
+        return false;
+
+    TitleDetail detail;
+    bool ok = true;
+    RecordReader record = view.record(header, 0, ok);
+    record.getString(detail.npCommunicationId);
+    record.getString(detail.npServiceName);
+    record.getString(detail.lastUpdatedDateTime);
+
+    if (!ok || !readSection(view, TAG_GROUPS, GROUP_RECORD, detail.groups, getGroup) ||
+        !readSection(view, TAG_TROPHIES, TROPHY_RECORD, detail.trophies, getTrophy) ||
+        detail.trophies.empty())
+        return false;
+
+    out = std::move(detail);
+    outSavedAt = view.savedAt;
+    return true;
+}
+
+bool snapshotToJson(std::string_view bytes, std::string& outJson)
+{
+    if (bytes.size() < HEADER_SIZE)
+        return false;
+
+    uint16_t kind = 0;
+    std::memcpy(&kind, bytes.data() + 6, sizeof(kind));
+
+    int64_t savedAt = 0;
+    json_object* root = json_object_new_object();
+
+    switch (static_cast<SnapshotKind>(kind))
+    {
+        case SnapshotKind::Summary:
+        {
+            TrophySummary summary;
+            if (!decodeSnapshot(bytes, summary, savedAt))
+                break;
+            json_object_object_add(root, "summary", toJson(summary));
+            break;
+        }
+        case SnapshotKind::Library:
+        {
+            std::vector<TrophyTitle> titles;
+            if (!decodeSnapshot(bytes, titles, savedAt))
+                break;
+            json_object* array = json_object_new_array();
+            for (const TrophyTitle& title : titles)
+                json_object_array_add(array, toJson(title));
+            json_object_object_add(root, "titles", array);
+            break;
+        }
+        case SnapshotKind::Detail:
+        {
+            TitleDetail detail;
+            if (!decodeSnapshot(bytes, detail, savedAt))
+                break;
+            json_object_object_add(root, "npCommunicationId", json_object_new_string(detail.npCommunicationId.c_str()));
+            json_object_object_add(root, "npServiceName", json_object_new_string(detail.npServiceName.c_str()));
+            json_object_object_add(root, "lastUpdatedDateTime",
+                json_object_new_string(detail.lastUpdatedDateTime.c_str()));
+            json_object* groups = json_object_new_array();
+            for (const TrophyGroup& group : detail.groups)
+                json_object_array_add(groups, toJson(group));
+            json_object_object_add(root, "groups", groups);
+            json_object* trophies = json_object_new_array();
+            for (const Trophy& trophy : detail.trophies)
+                json_object_array_add(trophies, toJson(trophy));
+            json_object_object_add(root, "trophies", trophies);
+            break;
+        }
+    }
+
+    bool decoded = json_object_object_length(root) > 0;
+    if (decoded)
+    {
+        json_object_object_add(root, "savedAt", json_object_new_int64(savedAt));
+        outJson = json_object_to_json_string_ext(root, JSON_C_TO_STRING_PRETTY);
+    }
+
+    json_object_put(root);
+    return decoded;
+}
+
+namespace {
+
+template <typename T, typename ParseLegacy>
+bool loadOrMigrate(const std::string& path, T& out, int64_t& outSavedAt, ParseLegacy parseLegacy)
+{
+    if (decodeSnapshot(akira::fileio::readAll(path), out, outSavedAt))
+        return true;
+
+    std::string legacyPath = legacyCachePath(path);
+    std::string legacy = akira::fileio::readAll(legacyPath);
+    // Builds between the snapshot format and the .bin names wrote snapshots to the JSON
+    // path, so those are taken too.
+    if (legacy.empty() || !(decodeSnapshot(legacy, out, outSavedAt) || parseLegacy(legacy, out, outSavedAt)))
+        return false;
+
+    // A failed write leaves the JSON to be read again next time.
+    if (akira::fileio::replace(path, encodeSnapshot(out, outSavedAt)))
+        remove(legacyPath.c_str());
+    return true;
+}
+
+} // namespace
+
+std::string legacyCachePath(const std::string& snapshotPath)
+{
+    std::string_view stem = snapshotPath;
+    if (stem.ends_with(".bin"))
+        stem.remove_suffix(4);
+    return std::string(stem) + ".json";
+}
+
+bool loadCacheFile(const std::string& path, TrophySummary& out, int64_t& outSavedAt)
+{
+    return loadOrMigrate(path, out, outSavedAt, parseCachedSummary);
+}
+
+bool loadCacheFile(const std::string& path, std::vector<TrophyTitle>& out, int64_t& outSavedAt)
+{
+    return loadOrMigrate(path, out, outSavedAt, parseCachedLibrary);
+}
+
+bool loadCacheFile(const std::string& path, TitleDetail& out, int64_t& outSavedAt)
+{
+    return loadOrMigrate(path, out, outSavedAt, parseCachedDetail);
+}
+
+} // namespace psn
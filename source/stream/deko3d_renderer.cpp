@@ -4,6 +4,9 @@
 #include "stream/bitmap_font.hpp"
 #include "core/wireguard_manager.hpp"
 #include "core/settings_manager.hpp"
+#include "core/connect_timeline.hpp"
+#include "core/version.hpp"
+#include "util/dksh_cache.hpp"
 #include "crypto/libnx/gmac.h"
 #include <borealis.hpp>
 #include <borealis/platforms/switch/switch_platform.hpp>
@@ -11,6 +14,7 @@
 #include <cstdio>
 #include <cstring>
 #include <format>
+#include <thread>
 #include <uam.h>
 
 extern "C"
@@ -144,6 +148,40 @@ static std::string buildVideoFragmentDefines(bool dithering, bool fsrEasu, bool
     return defines;
 }
 
+// uam is linked into the build, so the build's version and commit stand in for the
+// compiler's. The renderer is recreated per stream; the cache outlives it.
+static DkshCache& shaderCache()
+{
+    static DkshCache cache(
+        DkshCache::Config{
+            "sdmc:/switch/akira/cache/shaders",
+            std::format("uam-glsl3/{}/{}", akira::version::string(), akira::version::commit()),
+        },
+        [](const std::string& source, bool isVertex) {
+            uam_pipeline_stage stage = isVertex ? uam_pipeline_stage_vertex : uam_pipeline_stage_fragment;
+            uint8_t* dksh_out = nullptr;
+            uint32_t dksh_size = 0;
+            if (!uam_compileDksh(stage, source.c_str(), 3, &dksh_out, &dksh_size))
+                return std::vector<uint8_t>();
+
+            std::vector<uint8_t> dksh(dksh_out, dksh_out + dksh_size);
+            std::free(dksh_out);
+            return dksh;
+        });
+
+    // Pruning reads the cache directory, so it stays off the stream start the cache speeds up.
+    static bool pruned = [] {
+        std::thread([] {
+            size_t removed = cache.prune();
+            if (removed > 0)
+                brls::Logger::info("Deko3dRenderer: pruned {} cached shaders", removed);
+        }).detach();
+        return true;
+    }();
+    (void)pruned;
+    return cache;
+}
+
 Deko3dRenderer::Deko3dRenderer()
 {
     uam_init();
@@ -215,11 +253,13 @@ bool Deko3dRenderer::initialize(int frame_width, int frame_height, ChiakiLog* lo
     m_overlay_cmdmem = m_pool_data->allocate(OverlayCmdSize);
 
     bool dithering = SettingsManager::getInstance()->getEnableDithering();
+    ConnectTimeline::Span shaderCompile(ConnectTimeline::shared(), "shader compile");
     if (!compileVideoShaders(dithering))
     {
         brls::Logger::error("Failed to compile video shaders");
         return false;
     }
+    shaderCompile.done();
 
     m_vertex_buffer = m_pool_data->allocate(sizeof(QuadVertexData), alignof(Vertex));
     memcpy(m_vertex_buffer.getCpuAddr(), QuadVertexData.data(), m_vertex_buffer.getSize());
@@ -307,29 +347,29 @@ void Deko3dRenderer::recordStaticVideoCommands()
     brls::Logger::info("Deko3dRenderer: static video command list recorded");
 }
 
-bool Deko3dRenderer::compileShaderFromSource(CShader& shader, const std::string& source, bool isVertex)
+bool Deko3dRenderer::compileShaderFromSource(CShader& shader, const std::string& source,
+    const std::string& variant, bool isVertex)
 {
-    uint8_t* dksh_out = nullptr;
-    uint32_t dksh_size = 0;
-
-    uam_pipeline_stage stage = isVertex ? uam_pipeline_stage_vertex : uam_pipeline_stage_fragment;
-
-    brls::Logger::info("Deko3dRenderer: compiling {} shader ({} bytes)",
-        isVertex ? "vertex" : "fragment", source.size());
+    DkshCache& cache = shaderCache();
+    DkshCache::Stats before = cache.stats();
+    std::vector<uint8_t> dksh = cache.get(source, variant, isVertex);
+    DkshCache::Stats after = cache.stats();
 
-    if (!uam_compileDksh(stage, source.c_str(), 3, &dksh_out, &dksh_size))
+    if (dksh.empty())
     {
         brls::Logger::error("Deko3dRenderer: failed to compile {} shader",
             isVertex ? "vertex" : "fragment");
         return false;
     }
 
-    brls::Logger::info("Deko3dRenderer: {} shader compiled ({} bytes dksh)",
-        isVertex ? "vertex" : "fragment", dksh_size);
+    brls::Logger::info("Deko3dRenderer: {} shader {} ({} bytes dksh)",
+        isVertex ? "vertex" : "fragment",
+        after.compiles > before.compiles ? "compiled" : "loaded from cache", dksh.size());
+    if (after.writeFailures > before.writeFailures)
+        brls::Logger::warning("Deko3dRenderer: could not write the compiled shader to the cache");
 
     shader.destroy();
-    bool result = shader.loadFromMemory(*m_pool_code, dksh_out, dksh_size);
-    std::free(dksh_out);
+    bool result = shader.loadFromMemory(*m_pool_code, dksh.data(), static_cast<uint32_t>(dksh.size()));
 
     if (!result)
         brls::Logger::error("Deko3dRenderer: failed to load compiled {} shader into GPU memory",
@@ -344,7 +384,7 @@ bool Deko3dRenderer::ensureVertexShaderCompiled()
     if (vsh_source.empty())
         return false;
 
-    return compileShaderFromSource(m_vertex_shader, vsh_source, true);
+    return compileShaderFromSource(m_vertex_shader, vsh_source, "", true);
 }
 
 CShader* Deko3dRenderer::getOrCreateFragmentShader(const ShaderVariantKey& key)
@@ -362,9 +402,8 @@ CShader* Deko3dRenderer::getOrCreateFragmentShader(const ShaderVariantKey& key)
     auto variant = std::make_unique<CachedFragmentShader>();
     variant->key = key;
 
-    if (!compileShaderFromSource(variant->shader,
-        injectShaderDefines(fsh_source,
-            buildVideoFragmentDefines(key.dithering, key.fsrEasu, key.fsrRcas, key.fsrPass)), false))
+    std::string defines = buildVideoFragmentDefines(key.dithering, key.fsrEasu, key.fsrRcas, key.fsrPass);
+    if (!compileShaderFromSource(variant->shader, injectShaderDefines(fsh_source, defines), defines, false))
         return nullptr;
 
     CShader* shader = &variant->shader;
@@ -1207,7 +1246,8 @@ void Deko3dRenderer::renderStatsOverlay()
         "Frame Loss: {} (Rec: {})\n"
         "Duration: {}m{:02}s\n"
         "GHASH: {}\n"
-        "VPN: {}",
+        "VPN: {}"
+        "{}",
         m_stats.requested_width,
         m_stats.requested_height,
         m_stats.requested_fps,
@@ -1221,7 +1261,8 @@ void Deko3dRenderer::renderStatsOverlay()
         mins,
         secs,
         ghashMode,
-        vpnStatus
+        vpnStatus,
+        m_stats.connect_timeline.empty() ? "" : "\n\n=== Connect ===\n" + m_stats.connect_timeline
     );
 
     // Calculate overlay dimensions
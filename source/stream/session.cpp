@@ -1,5 +1,6 @@
 #include "stream/session.hpp"
 #include "core/settings_manager.hpp"
+#include "core/connect_timeline.hpp"
 #include <borealis.hpp>
 
 #include "stream/audio_manager.hpp"
@@ -260,8 +261,11 @@ void Session::presentDecodedFrame(AVFrame* frame)
     if (!frame || !frame->data[0] || !m_video_renderer)
         return;
 
-    if (!m_first_frame_received)
+    bool firstFrame = !m_first_frame_received;
+    if (firstFrame)
     {
+        ConnectTimeline::shared().finish("first idr");
+        ConnectTimeline::shared().start("first present");
         m_first_frame_received = true;
         brls::Application::setRenderSuspended(true);
         updateActualResolution(frame->width, frame->height);
@@ -280,6 +284,8 @@ void Session::presentDecodedFrame(AVFrame* frame)
     }
 
     m_video_renderer->presentFrame(frame);
+    if (firstFrame)
+        ConnectTimeline::shared().firstFrame();
 }
 
 StreamStats Session::getStreamStats()
@@ -322,6 +328,7 @@ StreamStats Session::getStreamStats()
     auto now = std::chrono::steady_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::seconds>(now - m_stream_start_time);
     stats.stream_duration_seconds = duration.count();
+    stats.connect_timeline = ConnectTimeline::shared().lastSummary();
 
     return stats;
 }
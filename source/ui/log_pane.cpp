@@ -1,13 +1,36 @@
 #include "ui/log_pane.hpp"
 
 #include "ui/theme.hpp"
+#include "util/log_ring.hpp"
 
 #include <chrono>
 #include <ctime>
 #include <format>
+#include <vector>
 
 namespace akira::ui {
 
+namespace {
+
+class NvgGlyphMetrics : public GlyphMetrics {
+public:
+    explicit NvgGlyphMetrics(NVGcontext* vg) : vg(vg) {
+        nvgTextMetrics(vg, nullptr, nullptr, &lineH);
+    }
+
+    float width(std::string_view text) const override {
+        return nvgTextBounds(vg, 0, 0, text.data(), text.data() + text.size(), nullptr);
+    }
+
+    float lineHeight() const override { return lineH; }
+
+private:
+    NVGcontext* vg;
+    float lineH = 0;
+};
+
+} // namespace
+
 LogPane::~LogPane()
 {
     unsubscribe();
@@ -18,9 +41,12 @@ void LogPane::subscribe()
     if (subscribed)
         return;
 
+    // Start from the records logged after this point, not what the ring still holds.
+    nextSeq = LogRing::shared().head(LogRing::Category::General);
     subscription = brls::Logger::subscribeToLog(
-        [this](brls::Logger::TimePoint time, brls::LogLevel level, std::string msg) {
-            this->addLine(msg);
+        [](brls::Logger::TimePoint time, brls::LogLevel level, std::string msg) {
+            LogRing::shared().push(static_cast<LogRing::Level>(level),
+                LogRing::Category::General, msg);
         });
     subscribed = true;
 }
@@ -36,30 +62,33 @@ void LogPane::unsubscribe()
 
 void LogPane::addLine(const std::string& line)
 {
-    std::lock_guard<std::mutex> lock(linesMutex);
+    LogRing::shared().push(LogRing::Level::Info, LogRing::Category::General, line);
+}
 
-    auto now = std::chrono::system_clock::now();
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now.time_since_epoch()).count() % 1000;
-    std::time_t tt = std::chrono::system_clock::to_time_t(now);
-    std::tm time_tm = *std::localtime(&tt);
+void LogPane::pullLines()
+{
+    std::vector<LogRing::Record> records;
+    nextSeq = LogRing::shared().readSince(nextSeq, LogRing::Category::General, records);
 
-    lines.push_back(std::format("{:02}:{:02}:{:02}.{:03} {}",
-        time_tm.tm_hour, time_tm.tm_min, time_tm.tm_sec, static_cast<int>(ms), line));
+    for (const auto& record : records) {
+        auto time = std::chrono::system_clock::time_point(std::chrono::milliseconds(record.timeMs));
+        std::time_t tt = std::chrono::system_clock::to_time_t(time);
+        std::tm time_tm = *std::localtime(&tt);
 
-    while (lines.size() > MAX_LINES) {
-        lines.pop_front();
+        layout.append(std::format("{:02}:{:02}:{:02}.{:03} {}",
+            time_tm.tm_hour, time_tm.tm_min, time_tm.tm_sec,
+            static_cast<int>(record.timeMs % 1000), record.text));
     }
 }
 
 void LogPane::render(NVGcontext* vg, float x, float y, float width, float height)
 {
-    std::lock_guard<std::mutex> lock(linesMutex);
+    pullLines();
 
     nvgSave(vg);
     nvgScissor(vg, x, y, width, height);
 
-    nvgFontSize(vg, 16);
+    nvgFontSize(vg, FONT_SIZE);
     nvgFillColor(vg, akira::ui::active().textMuted);
     nvgTextAlign(vg, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
 
@@ -67,25 +96,18 @@ void LogPane::render(NVGcontext* vg, float x, float y, float width, float height
     float maxTextWidth = width - padding * 2;
     float availableHeight = height - padding * 2;
 
-    size_t startIdx = lines.size();
-    float totalHeight = 0;
-    while (startIdx > 0) {
-        float bounds[4];
-        nvgTextBoxBounds(vg, 0, 0, maxTextWidth, lines[startIdx - 1].c_str(), nullptr, bounds);
-        float lineH = bounds[3] - bounds[1];
-        if (totalHeight + lineH > availableHeight)
-            break;
-        totalHeight += lineH;
-        startIdx--;
-    }
+    NvgGlyphMetrics metrics(vg);
+    layout.setGeometry(maxTextWidth, FONT_SIZE);
+    TextLayoutCache::Tail tail = layout.layoutTail(availableHeight, metrics);
 
     float currentY = y + padding;
-    for (size_t i = startIdx; i < lines.size(); i++) {
-        nvgTextBox(vg, x + padding, currentY, maxTextWidth, lines[i].c_str(), nullptr);
-
-        float bounds[4];
-        nvgTextBoxBounds(vg, x + padding, currentY, maxTextWidth, lines[i].c_str(), nullptr, bounds);
-        currentY += (bounds[3] - bounds[1]);
+    for (size_t i = tail.first; i < layout.size(); i++) {
+        const TextLayoutCache::Line& line = layout.line(i);
+        for (const TextRow& row : line.rows) {
+            const char* text = line.text.data();
+            nvgText(vg, x + padding, currentY, text + row.begin, text + row.end);
+            currentY += metrics.lineHeight();
+        }
     }
 
     nvgRestore(vg);
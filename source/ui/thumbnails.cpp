@@ -0,0 +1,135 @@
+#include "ui/thumbnails.hpp"
+
+#include "core/trophy_manager.hpp"
+
+#include <borealis.hpp>
+#include <borealis/extern/nanovg/stb_image.h>
+
+#include <cmath>
+#include <cstring>
+
+namespace akira::ui::thumbnails {
+
+namespace {
+
+// Layouts are in 720p units; docked, the framebuffer is 1080p, so thumbnails are cut for that.
+constexpr float OUTPUT_SCALE = 1.5f;
+// A docked screen of cloud covers, four rows of four at about 474 KB each, is 7.6 MB; the
+// rest is the row or so fetched ahead.
+constexpr size_t CACHE_MAX_BYTES = 12 * 1024 * 1024;
+constexpr size_t PREFETCH_SHARE = 4;
+
+// stb_image is compiled into borealis alongside nanovg, which decodes with it too.
+bool decode(const std::vector<uint8_t>& encoded, RgbaImage& out)
+{
+    if (encoded.empty())
+        return false;
+
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    stbi_uc* pixels = stbi_load_from_memory(encoded.data(), static_cast<int>(encoded.size()),
+        &width, &height, &channels, 4);
+    if (!pixels)
+        return false;
+
+    out.width = width;
+    out.height = height;
+    out.pixels.resize(size_t(width) * size_t(height) * 4);
+    std::memcpy(out.pixels.data(), pixels, out.pixels.size());
+    stbi_image_free(pixels);
+    return true;
+}
+
+ThumbnailPipeline& pipeline()
+{
+    static ThumbnailPipeline* shared = new ThumbnailPipeline(decode,
+        [](std::function<void()> task) { brls::sync(std::move(task)); }, CACHE_MAX_BYTES);
+    return *shared;
+}
+
+int pixels(float layoutUnits)
+{
+    return static_cast<int>(std::lround(layoutUnits * OUTPUT_SCALE));
+}
+
+} // namespace
+
+void load(Source source, const std::string& url, float width, float height, ThumbnailPipeline::Ready onReady)
+{
+    if (url.empty())
+        return;
+
+    int w = pixels(width);
+    int h = pixels(height);
+    if (ThumbnailPipeline::Thumbnail hit = pipeline().cached(url, w, h))
+    {
+        if (onReady)
+            onReady(url, hit);
+        return;
+    }
+
+    auto decodeArrived = [w, h, onReady = std::move(onReady)](const std::string& url, const std::vector<uint8_t>& bytes) {
+        if (bytes.empty())
+            return;
+        pipeline().request(url, bytes, w, h, ThumbnailPipeline::Priority::Visible, onReady);
+    };
+
+    if (source == Source::Artwork)
+        TrophyManager::getInstance()->fetchArtwork(url, std::move(decodeArrived));
+    else
+        TrophyManager::getInstance()->fetchIcon(url, std::move(decodeArrived));
+}
+
+void prefetch(Source source, const std::string& url, float width, float height)
+{
+    if (url.empty())
+        return;
+
+    int w = pixels(width);
+    int h = pixels(height);
+    if (pipeline().cached(url, w, h))
+        return;
+
+    auto decodeArrived = [w, h](const std::string& url, const std::vector<uint8_t>& bytes) {
+        if (!bytes.empty())
+            pipeline().request(url, bytes, w, h, ThumbnailPipeline::Priority::Ahead, nullptr);
+    };
+
+    if (source == Source::Artwork)
+        TrophyManager::getInstance()->prefetchArtwork(url, std::move(decodeArrived));
+    else
+        TrophyManager::getInstance()->prefetchIcon(url, std::move(decodeArrived));
+}
+
+void cancel(const std::string& url)
+{
+    TrophyManager::getInstance()->cancelPrefetch(url);
+}
+
+size_t bytesFor(float width, float height)
+{
+    return size_t(pixels(width)) * size_t(pixels(height)) * 4;
+}
+
+size_t prefetchBudgetBytes()
+{
+    return CACHE_MAX_BYTES / PREFETCH_SHARE;
+}
+
+bool apply(brls::Image* image, const ThumbnailPipeline::Thumbnail& thumbnail)
+{
+    if (!image || !thumbnail)
+        return false;
+
+    NVGcontext* vg = brls::Application::getNVGContext();
+    int texture = nvgCreateImageRGBA(vg, thumbnail->width, thumbnail->height, NVG_IMAGE_PREMULTIPLIED,
+        thumbnail->pixels.data());
+    if (texture <= 0)
+        return false;
+
+    image->innerSetImage(texture);
+    return true;
+}
+
+} // namespace akira::ui::thumbnails
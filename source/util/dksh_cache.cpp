@@ -0,0 +1,329 @@
+#include "util/dksh_cache.hpp"
+
+#include "util/file_io.hpp"
+#include "util/sha256.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <utility>
+
+namespace {
+
+// "AKDK", format, key (hex), compiler version (u16 length, then bytes), blob size, blob
+// SHA-256, blob. Integers are little-endian.
+constexpr char MAGIC[4] = {'A', 'K', 'D', 'K'};
+constexpr uint32_t FORMAT = 1;
+constexpr size_t KEY_LENGTH = 64;
+constexpr const char* ENTRY_SUFFIX = ".dksh";
+constexpr const char* TEMP_SUFFIX = ".dksh.tmp";
+// A temporary file younger than this may belong to a store in progress.
+constexpr int64_t TEMP_STALE_SECONDS = 60;
+
+void putU16(std::vector<uint8_t>& out, uint16_t value)
+{
+    out.push_back(static_cast<uint8_t>(value));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+void putU32(std::vector<uint8_t>& out, uint32_t value)
+{
+    for (int shift = 0; shift < 32; shift += 8)
+        out.push_back(static_cast<uint8_t>(value >> shift));
+}
+
+// Reads the bytes of a file written by encode() one field at a time; any read past the
+// end fails the reader for good.
+struct Reader {
+    const std::vector<uint8_t>& bytes;
+    size_t at = 0;
+    bool ok = true;
+
+    const uint8_t* take(size_t count)
+    {
+        if (!ok || bytes.size() - at < count)
+        {
+            ok = false;
+            return nullptr;
+        }
+        const uint8_t* start = bytes.data() + at;
+        at += count;
+        return start;
+    }
+
+    uint32_t u32()
+    {
+        const uint8_t* p = take(4);
+        return p ? p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24) : 0;
+    }
+
+    uint16_t u16()
+    {
+        const uint8_t* p = take(2);
+        return p ? static_cast<uint16_t>(p[0] | (p[1] << 8)) : 0;
+    }
+
+    std::string text(size_t count)
+    {
+        const uint8_t* p = take(count);
+        return p ? std::string(reinterpret_cast<const char*>(p), count) : "";
+    }
+};
+
+// The key and compiler version in an entry's header, or false if it does not start like one.
+bool readHeader(const std::vector<uint8_t>& file, std::string& key, std::string& compilerVersion)
+{
+    Reader reader{file};
+    const uint8_t* magic = reader.take(sizeof(MAGIC));
+    if (!magic || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || reader.u32() != FORMAT)
+        return false;
+    key = reader.text(KEY_LENGTH);
+    compilerVersion = reader.text(reader.u16());
+    return reader.ok;
+}
+
+void blobHash(const std::vector<uint8_t>& blob, uint8_t hash[32])
+{
+    akira::sha256::Ctx ctx;
+    akira::sha256::init(ctx);
+    akira::sha256::update(ctx, blob.data(), blob.size());
+    akira::sha256::final(ctx, hash);
+}
+
+// Reads just enough of a file for readHeader(): the fixed fields, then the version string.
+bool readHeaderOf(const std::string& path, std::string& key, std::string& compilerVersion)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+
+    constexpr size_t FIXED = sizeof(MAGIC) + 4 + KEY_LENGTH + 2;
+    std::vector<uint8_t> head(FIXED);
+    bool ok = fread(head.data(), 1, FIXED, file) == FIXED;
+    if (ok)
+    {
+        size_t versionLength = head[FIXED - 2] | (head[FIXED - 1] << 8);
+        head.resize(FIXED + versionLength);
+        ok = fread(head.data() + FIXED, 1, versionLength, file) == versionLength;
+    }
+    fclose(file);
+    return ok && readHeader(head, key, compilerVersion);
+}
+
+bool endsWith(const std::string& text, const char* suffix)
+{
+    size_t length = std::strlen(suffix);
+    return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+// mkdir -p; the sdmc: root and directories that already exist just fail harmlessly.
+void makeDirs(const std::string& dir)
+{
+    for (size_t slash = dir.find('/'); slash != std::string::npos; slash = dir.find('/', slash + 1))
+    {
+        if (slash > 0)
+            mkdir(dir.substr(0, slash).c_str(), 0755);
+    }
+    mkdir(dir.c_str(), 0755);
+}
+
+} // namespace
+
+DkshCache::DkshCache(Config config, Compiler compiler)
+    : config(std::move(config))
+    , compiler(std::move(compiler))
+{
+}
+
+std::vector<uint8_t> DkshCache::get(const std::string& source, const std::string& variant, bool isVertex)
+{
+    std::string key = keyFor(config.compilerVersion, source, variant, isVertex);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = loaded.find(key);
+    if (it != loaded.end())
+    {
+        counters.memoryHits++;
+        return it->second;
+    }
+
+    std::vector<uint8_t> blob;
+    if (loadLocked(key, blob))
+    {
+        counters.diskHits++;
+    }
+    else
+    {
+        counters.compiles++;
+        blob = compiler(source, isVertex);
+        if (blob.empty())
+            return {};
+        if (!storeLocked(key, blob))
+            counters.writeFailures++;
+    }
+
+    loaded[key] = blob;
+    return blob;
+}
+
+size_t DkshCache::prune()
+{
+    // Only the directory is touched, so get() is not held up while this runs.
+    if (config.dir.empty())
+        return 0;
+
+    DIR* dir = opendir(config.dir.c_str());
+    if (!dir)
+        return 0;
+
+    std::vector<std::string> names;
+    while (struct dirent* entry = readdir(dir))
+        names.push_back(entry->d_name);
+    closedir(dir);
+
+    size_t removed = 0;
+    int64_t now = static_cast<int64_t>(std::time(nullptr));
+    std::vector<std::pair<int64_t, std::string>> kept;  // last used, path
+    for (const std::string& name : names)
+    {
+        std::string path = config.dir + "/" + name;
+        struct stat info;
+        int64_t modifiedAt = stat(path.c_str(), &info) == 0 ? static_cast<int64_t>(info.st_mtime) : 0;
+        if (endsWith(name, TEMP_SUFFIX))
+        {
+            if (now - modifiedAt >= TEMP_STALE_SECONDS)
+                removed += std::remove(path.c_str()) == 0;
+            continue;
+        }
+        if (!endsWith(name, ENTRY_SUFFIX))
+            continue;
+
+        std::string key;
+        std::string version;
+        if (!readHeaderOf(path, key, version) || version != config.compilerVersion)
+        {
+            removed += std::remove(path.c_str()) == 0;
+            continue;
+        }
+
+        kept.emplace_back(modifiedAt, path);
+    }
+
+    if (kept.size() > config.maxFiles)
+    {
+        std::sort(kept.begin(), kept.end());
+        for (size_t i = 0; i < kept.size() - config.maxFiles; i++)
+            removed += std::remove(kept[i].second.c_str()) == 0;
+    }
+    return removed;
+}
+
+DkshCache::Stats DkshCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
+
+std::string DkshCache::keyFor(const std::string& compilerVersion, const std::string& source,
+                              const std::string& variant, bool isVertex)
+{
+    // NULs between the parts keep ("ab", "c") and ("a", "bc") apart.
+    akira::sha256::Ctx ctx;
+    akira::sha256::init(ctx);
+    auto add = [&ctx](const std::string& part) {
+        akira::sha256::update(ctx, reinterpret_cast<const uint8_t*>(part.data()), part.size());
+        akira::sha256::update(ctx, reinterpret_cast<const uint8_t*>(""), 1);
+    };
+    add(compilerVersion);
+    add(isVertex ? "vertex" : "fragment");
+    add(variant);
+    add(source);
+
+    uint8_t hash[32];
+    akira::sha256::final(ctx, hash);
+    return akira::sha256::toHex(hash);
+}
+
+std::vector<uint8_t> DkshCache::encode(const std::string& key, const std::string& compilerVersion,
+                                       const std::vector<uint8_t>& blob)
+{
+    std::vector<uint8_t> out(MAGIC, MAGIC + sizeof(MAGIC));
+    putU32(out, FORMAT);
+    out.insert(out.end(), key.begin(), key.end());
+    putU16(out, static_cast<uint16_t>(compilerVersion.size()));
+    out.insert(out.end(), compilerVersion.begin(), compilerVersion.end());
+    putU32(out, static_cast<uint32_t>(blob.size()));
+
+    uint8_t hash[32];
+    blobHash(blob, hash);
+    out.insert(out.end(), hash, hash + sizeof(hash));
+    out.insert(out.end(), blob.begin(), blob.end());
+    return out;
+}
+
+bool DkshCache::decode(const std::vector<uint8_t>& file, const std::string& key,
+                       const std::string& compilerVersion, std::vector<uint8_t>& blob)
+{
+    std::string fileKey;
+    std::string fileVersion;
+    if (!readHeader(file, fileKey, fileVersion) || fileKey != key || fileVersion != compilerVersion)
+        return false;
+
+    Reader reader{file};
+    reader.take(sizeof(MAGIC) + 4 + KEY_LENGTH + 2 + fileVersion.size());
+    uint32_t size = reader.u32();
+    const uint8_t* expected = reader.take(32);
+    const uint8_t* payload = reader.take(size);
+    if (!payload || reader.at != file.size())
+        return false;
+
+    std::vector<uint8_t> candidate(payload, payload + size);
+    uint8_t hash[32];
+    blobHash(candidate, hash);
+    if (std::memcmp(hash, expected, sizeof(hash)) != 0)
+        return false;
+
+    blob = std::move(candidate);
+    return true;
+}
+
+std::string DkshCache::pathFor(const std::string& key) const
+{
+    return config.dir + "/" + key + ENTRY_SUFFIX;
+}
+
+bool DkshCache::loadLocked(const std::string& key, std::vector<uint8_t>& blob)
+{
+    if (config.dir.empty())
+        return false;
+
+    std::string path = pathFor(key);
+    std::string bytes;
+    if (!akira::fileio::readAll(path, bytes))
+        return false;
+
+    if (!decode(std::vector<uint8_t>(bytes.begin(), bytes.end()), key, config.compilerVersion, blob))
+    {
+        counters.rejected++;
+        std::remove(path.c_str());
+        return false;
+    }
+
+    // prune() goes by modification time, so a hit counts as a use.
+    utimes(path.c_str(), nullptr);
+    return true;
+}
+
+bool DkshCache::storeLocked(const std::string& key, const std::vector<uint8_t>& blob)
+{
+    if (config.dir.empty())
+        return true;
+
+    makeDirs(config.dir);
+    std::vector<uint8_t> bytes = encode(key, config.compilerVersion, blob);
+    return akira::fileio::replace(pathFor(key), bytes.data(), bytes.size());
+}
@@ -0,0 +1,85 @@
+#include "util/file_io.hpp"
+
+#include <cstdio>
+#include <sys/stat.h>
+
+namespace akira::fileio {
+
+namespace {
+
+bool exists(const std::string& path)
+{
+    struct stat info;
+    return stat(path.c_str(), &info) == 0;
+}
+
+} // namespace
+
+std::string stagingPath(const std::string& path)
+{
+    return path + ".tmp";
+}
+
+bool recover(const std::string& path)
+{
+    if (exists(path))
+        return true;
+
+    std::string staged = stagingPath(path);
+    return exists(staged) && std::rename(staged.c_str(), path.c_str()) == 0;
+}
+
+bool readAll(const std::string& path, std::string& out)
+{
+    out.clear();
+    recover(path);
+
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+
+    bool ok = fseek(file, 0, SEEK_END) == 0;
+    long size = ok ? ftell(file) : -1;
+    if (size > 0 && fseek(file, 0, SEEK_SET) == 0)
+    {
+        out.resize(static_cast<size_t>(size));
+        out.resize(fread(out.data(), 1, out.size(), file));
+    }
+    ok = ok && size >= 0 && out.size() == static_cast<size_t>(size) && ferror(file) == 0;
+    fclose(file);
+    return ok;
+}
+
+std::string readAll(const std::string& path)
+{
+    std::string bytes;
+    readAll(path, bytes);
+    return bytes;
+}
+
+bool replace(const std::string& path, const void* data, size_t size)
+{
+    std::string staged = stagingPath(path);
+    FILE* file = fopen(staged.c_str(), "wb");
+    if (!file)
+        return false;
+
+    bool written = fwrite(data, 1, size, file) == size;
+    if (fclose(file) != 0 || !written)
+    {
+        std::remove(staged.c_str());
+        return false;
+    }
+
+    // The staging file is complete from here on; it is kept if the old copy goes and the
+    // rename does not follow.
+    std::remove(path.c_str());
+    return std::rename(staged.c_str(), path.c_str()) == 0;
+}
+
+bool replace(const std::string& path, const std::string& bytes)
+{
+    return replace(path, bytes.data(), bytes.size());
+}
+
+} // namespace akira::fileio
@@ -82,6 +82,11 @@ static size_t curlCollectHeader(void* contents, size_t size, size_t nmemb, void*
     return total;
 }
 
+static int curlCheckCancel(void* userp, curl_off_t, curl_off_t, curl_off_t, curl_off_t)
+{
+    return static_cast<const std::atomic<bool>*>(userp)->load(std::memory_order_relaxed) ? 1 : 0;
+}
+
 std::string HttpResponse::header(const std::string& name) const
 {
     auto equalsIgnoreCase = [](const std::string& a, const std::string& b) {
@@ -104,6 +109,13 @@ HttpResponse httpPerform(const HttpRequest& request)
 {
     HttpResponse response;
 
+    if (request.cancel && request.cancel->load(std::memory_order_relaxed))
+    {
+        response.error = "Cancelled";
+        response.cancelled = true;
+        return response;
+    }
+
     CurlHandle ownHandle;
     CURL* curl = static_cast<CURL*>(request.reuseHandle);
     if (curl)
@@ -169,10 +181,17 @@ HttpResponse httpPerform(const HttpRequest& request)
     {
         curl_easy_setopt(curl, CURLOPT_SHARE, share);
     }
+    if (request.cancel)
+    {
+        curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+        curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, curlCheckCancel);
+        curl_easy_setopt(curl, CURLOPT_XFERINFODATA, const_cast<std::atomic<bool>*>(request.cancel));
+    }
 
     CURLcode res = curl_easy_perform(curl);
     if (res != CURLE_OK)
     {
+        response.cancelled = res == CURLE_ABORTED_BY_CALLBACK;
         response.error = errorBuffer[0] != '\0'
             ? std::string(errorBuffer)
             : std::string(curl_easy_strerror(res));
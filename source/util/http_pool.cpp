@@ -2,6 +2,9 @@
 
 #include <borealis.hpp>
 
+#include <atomic>
+#include <memory>
+
 HttpPool& HttpPool::instance()
 {
     static HttpPool* pool = new HttpPool();
@@ -25,7 +28,135 @@ void HttpPool::submit(Task task)
     ensureStarted();
 
     tasks.push_back(std::move(task));
-    cond.notify_one();
+    cond.notify_all();
+}
+
+void HttpPool::submitAfter(std::chrono::milliseconds delay, Task task)
+{
+    if (!task)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stopping)
+        return;
+
+    ensureStarted();
+
+    timers.schedule(nowMs() + delay.count(), [this, task = std::move(task)]() mutable {
+        ready.push_back(std::move(task));
+    });
+    cond.notify_all();
+}
+
+void HttpPool::wake()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    cond.notify_all();
+}
+
+namespace {
+
+thread_local int helpDepth = 0;
+
+struct FanOutBatch {
+    std::vector<HttpPool::Task> tasks;
+    std::atomic<size_t> next{0};
+    size_t finished = 0;
+    std::mutex mutex;
+    std::condition_variable cond;
+
+    void drain(HttpSession& session)
+    {
+        for (size_t i = next.fetch_add(1); i < tasks.size(); i = next.fetch_add(1))
+        {
+            tasks[i](session);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (++finished == tasks.size())
+                cond.notify_all();
+        }
+    }
+};
+
+} // namespace
+
+void HttpPool::fanOut(HttpSession& session, std::vector<Task> batch)
+{
+    if (batch.empty())
+        return;
+
+    auto shared = std::make_shared<FanOutBatch>();
+    shared->tasks = std::move(batch);
+
+    for (size_t i = 1; i < shared->tasks.size(); i++)
+        submit([shared](HttpSession& workerSession) { shared->drain(workerSession); });
+
+    shared->drain(session);
+
+    std::unique_lock<std::mutex> lock(shared->mutex);
+    shared->cond.wait(lock, [&shared]() { return shared->finished == shared->tasks.size(); });
+}
+
+void HttpPool::helpUntil(HttpSession& session, const std::function<bool()>& finished)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (!finished())
+    {
+        Task task;
+        if (!takeLocked(task, helpDepth >= MAX_HELP_DEPTH))
+        {
+            if (stopping)
+                return;
+
+            waitLocked(lock);
+            continue;
+        }
+
+        lock.unlock();
+        helpDepth++;
+        task(session);
+        helpDepth--;
+        lock.lock();
+    }
+}
+
+int64_t HttpPool::nowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void HttpPool::releaseDueLocked()
+{
+    std::vector<TimerWheel::Callback> due;
+    timers.advance(nowMs(), due);
+    for (TimerWheel::Callback& release : due)
+        release();
+}
+
+bool HttpPool::takeLocked(Task& out, bool readyOnly)
+{
+    releaseDueLocked();
+
+    std::deque<Task>* from = !ready.empty() ? &ready : (!readyOnly && !tasks.empty()) ? &tasks : nullptr;
+    if (!from)
+        return false;
+
+    out = std::move(from->front());
+    from->pop_front();
+    return true;
+}
+
+// One bounded sleep: until notified or until the next delayed task comes due. Callers
+// re-check their condition in a loop, so a spurious wakeup is harmless.
+void HttpPool::waitLocked(std::unique_lock<std::mutex>& lock)
+{
+    int64_t due = timers.nextDueMs();
+    if (due == TimerWheel::NOTHING_DUE)
+        cond.wait(lock);
+    else
+        cond.wait_until(lock, std::chrono::steady_clock::time_point(std::chrono::milliseconds(due)));
 }
 
 void HttpPool::ensureStarted()
@@ -51,6 +182,8 @@ void HttpPool::stop()
 
         stopping = true;
         tasks.clear();
+        ready.clear();
+        timers.clear();
         cond.notify_all();
         joining.swap(threads);
     }
@@ -72,13 +205,11 @@ void HttpPool::run(int index)
 
         {
             std::unique_lock<std::mutex> lock(mutex);
-            cond.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            while (!stopping && !takeLocked(task, false))
+                waitLocked(lock);
 
             if (stopping)
                 break;
-
-            task = std::move(tasks.front());
-            tasks.pop_front();
         }
 
         task(session);
@@ -0,0 +1,143 @@
+#include "util/log_ring.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+// Per category: LogPane shows 100 lines and the discovery log 300.
+constexpr size_t SHARED_CAPACITY = 512;
+
+int64_t wallClockMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Longest prefix of text within limit that does not split a UTF-8 sequence.
+size_t clippedLength(std::string_view text, size_t limit)
+{
+    if (text.size() <= limit)
+        return text.size();
+
+    size_t length = limit;
+    while (length > 0 && (static_cast<unsigned char>(text[length]) & 0xC0) == 0x80)
+        length--;
+    return length;
+}
+
+} // namespace
+
+LogRing::LogRing(size_t capacity)
+    : mask(std::bit_ceil(capacity < 2 ? size_t(2) : capacity) - 1)
+{
+    for (Lane& lane : lanes)
+    {
+        lane.slots.reset(new Slot[mask + 1]);
+        for (size_t i = 0; i <= mask; i++)
+        {
+            for (auto& word : lane.slots[i].words)
+                word.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+LogRing& LogRing::shared()
+{
+    static LogRing* ring = new LogRing(SHARED_CAPACITY);
+    return *ring;
+}
+
+uint64_t LogRing::push(Level level, Category category, std::string_view text)
+{
+    return push(level, category, text, wallClockMs());
+}
+
+uint64_t LogRing::push(Level level, Category category, std::string_view text, int64_t timeMs)
+{
+    Lane& lane = laneOf(category);
+    uint64_t seq = lane.next.fetch_add(1, std::memory_order_acq_rel);
+    Slot& slot = lane.slots[seq & mask];
+
+    // Claim the slot unless a producer that lapped this one holds or has filled it.
+    uint64_t writing = 2 * seq + 1;
+    uint64_t current = slot.stamp.load(std::memory_order_relaxed);
+    do
+    {
+        if ((current & 1) || current >= writing)
+        {
+            // Let readers step over this sequence instead of waiting for it.
+            slot.abandoned.store(seq, std::memory_order_release);
+            droppedCount.fetch_add(1, std::memory_order_relaxed);
+            return seq;
+        }
+    } while (!slot.stamp.compare_exchange_weak(current, writing, std::memory_order_relaxed));
+    std::atomic_thread_fence(std::memory_order_release);
+
+    size_t length = clippedLength(text, TEXT_BYTES);
+    uint64_t buffer[TEXT_WORDS] = {};
+    std::memcpy(buffer, text.data(), length);
+
+    slot.timeMs.store(timeMs, std::memory_order_relaxed);
+    slot.meta.store(static_cast<uint32_t>(level) | static_cast<uint32_t>(length) << 16,
+        std::memory_order_relaxed);
+    for (size_t i = 0; i < (length + 7) / 8; i++)
+        slot.words[i].store(buffer[i], std::memory_order_relaxed);
+
+    slot.stamp.store(writing + 1, std::memory_order_release);
+    return seq;
+}
+
+uint64_t LogRing::readSince(uint64_t since, Category category, std::vector<Record>& out) const
+{
+    const Lane& lane = laneOf(category);
+    uint64_t end = lane.next.load(std::memory_order_acquire);
+    uint64_t floor = lane.floor.load(std::memory_order_acquire);
+    uint64_t oldest = end > capacity() ? end - capacity() : 0;
+    uint64_t seq = std::max({since, floor, oldest});
+
+    for (; seq < end; seq++)
+    {
+        const Slot& slot = lane.slots[seq & mask];
+        uint64_t published = 2 * seq + 2;
+        uint64_t before = slot.stamp.load(std::memory_order_acquire);
+        if (before < published)
+        {
+            // Not written yet: stop here and pick it up next time, unless its producer
+            // gave up on the slot or the ring has lapped it since.
+            if (slot.abandoned.load(std::memory_order_acquire) == seq ||
+                lane.next.load(std::memory_order_acquire) - seq >= capacity())
+                continue;
+            break;
+        }
+        if (before != published)
+            continue;
+
+        uint32_t meta = slot.meta.load(std::memory_order_relaxed);
+        size_t length = std::min<size_t>(meta >> 16, TEXT_BYTES);
+        uint64_t buffer[TEXT_WORDS];
+        for (size_t i = 0; i < (length + 7) / 8; i++)
+            buffer[i] = slot.words[i].load(std::memory_order_relaxed);
+        int64_t timeMs = slot.timeMs.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.stamp.load(std::memory_order_relaxed) != before)
+            continue;
+
+        Record record;
+        record.seq = seq;
+        record.timeMs = timeMs;
+        record.level = static_cast<Level>(meta & 0xFF);
+        record.category = category;
+        record.text.assign(reinterpret_cast<const char*>(buffer), length);
+        out.push_back(std::move(record));
+    }
+    return seq;
+}
+
+void LogRing::clear(Category category)
+{
+    laneOf(category).floor.store(head(category), std::memory_order_release);
+}
@@ -0,0 +1,135 @@
+#include "util/prefetch_planner.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Weight of the newest sample. Frame-to-frame offsets jitter with touch input, and a
+// window that flips direction on one noisy frame cancels everything it just queued.
+constexpr float SMOOTHING = 0.4f;
+
+} // namespace
+
+float ScrollVelocity::sample(float offset, int64_t nowMs)
+{
+    if (lastMs < 0 || nowMs - lastMs > IDLE_MS)
+    {
+        speed = 0;
+        lastOffset = offset;
+        lastMs = nowMs;
+        return speed;
+    }
+
+    int64_t elapsed = nowMs - lastMs;
+    if (elapsed < 1)
+        return speed;
+
+    float instant = (offset - lastOffset) * 1000.0f / static_cast<float>(elapsed);
+    speed += (instant - speed) * SMOOTHING;
+    lastOffset = offset;
+    lastMs = nowMs;
+    return speed;
+}
+
+void ScrollVelocity::reset()
+{
+    lastOffset = 0;
+    lastMs = -1;
+    speed = 0;
+}
+
+PrefetchPlanner::PrefetchPlanner()
+    : PrefetchPlanner(Config())
+{
+}
+
+PrefetchPlanner::PrefetchPlanner(Config config)
+    : config(config)
+{
+}
+
+PrefetchPlanner::Plan PrefetchPlanner::update(const Viewport& view, const RowCost& cost)
+{
+    // A list at rest keeps looking the way it last moved.
+    if (view.rowsPerSecond > 0)
+        direction = 1;
+    else if (view.rowsPerSecond < 0)
+        direction = -1;
+
+    float reach = std::fabs(view.rowsPerSecond) * config.horizonSeconds;
+    size_t ahead = std::min(config.maxAhead, config.minAhead + static_cast<size_t>(reach));
+
+    std::vector<size_t> order;
+    order.reserve(ahead + config.behind);
+
+    auto collect = [&](int towards, size_t count) {
+        for (size_t step = 0; step < count; step++)
+        {
+            if (towards > 0)
+            {
+                if (view.last + step >= view.rowCount)
+                    break;
+                order.push_back(view.last + step);
+            }
+            else
+            {
+                if (step >= view.first)
+                    break;
+                order.push_back(view.first - 1 - step);
+            }
+        }
+    };
+
+    collect(direction, ahead);
+    size_t aheadRows = order.size();
+    collect(-direction, config.behind);
+
+    // Each side stops at its first row over budget so the window stays contiguous; a
+    // hole would be filled by the cells' own fetches anyway, out of order.
+    std::unordered_map<size_t, size_t> wanted;
+    size_t spent = 0;
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        size_t bytes = cost ? cost(order[i]) : 0;
+        if (spent + bytes > config.byteBudget)
+        {
+            if (i >= aheadRows)
+                break;
+            i = aheadRows - 1;
+            continue;
+        }
+        spent += bytes;
+        wanted.emplace(order[i], bytes);
+    }
+
+    Plan plan;
+    for (size_t row : order)
+        if (wanted.count(row) && !tracked.count(row))
+            plan.fetch.push_back(row);
+
+    for (const auto& [row, bytes] : tracked)
+    {
+        bool visible = row >= view.first && row < view.last;
+        if (!visible && !wanted.count(row))
+            plan.cancel.push_back(row);
+    }
+    std::sort(plan.cancel.begin(), plan.cancel.end());
+
+    tracked.swap(wanted);
+    outstanding = spent;
+    return plan;
+}
+
+std::vector<size_t> PrefetchPlanner::reset()
+{
+    std::vector<size_t> rows;
+    rows.reserve(tracked.size());
+    for (const auto& [row, bytes] : tracked)
+        rows.push_back(row);
+    std::sort(rows.begin(), rows.end());
+
+    tracked.clear();
+    outstanding = 0;
+    return rows;
+}
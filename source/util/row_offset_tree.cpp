@@ -0,0 +1,94 @@
+#include "util/row_offset_tree.hpp"
+
+#include <bit>
+
+namespace {
+
+size_t lowBit(size_t i)
+{
+    return i & (~i + 1);
+}
+
+} // namespace
+
+void RowOffsetTree::assign(const std::vector<float>& values)
+{
+    heights = values;
+    tree.assign(heights.size() + 1, 0.0);
+
+    // Linear build: each node hands its sum on to its parent once.
+    for (size_t i = 1; i < tree.size(); i++)
+    {
+        tree[i] += heights[i - 1];
+        size_t parent = i + lowBit(i);
+        if (parent < tree.size())
+            tree[parent] += tree[i];
+    }
+
+    topBit = heights.empty() ? 0 : std::bit_floor(heights.size());
+}
+
+void RowOffsetTree::push_back(float height)
+{
+    if (tree.empty())
+        tree.push_back(0.0);
+
+    // The new node covers itself plus the lowbit - 1 rows before it.
+    size_t i = heights.size() + 1;
+    double covered = offsetOf(heights.size()) - offsetOf(i - lowBit(i));
+    heights.push_back(height);
+    tree.push_back(covered + height);
+
+    topBit = std::bit_floor(heights.size());
+}
+
+void RowOffsetTree::set(size_t row, float height)
+{
+    if (row >= heights.size())
+        return;
+
+    double delta = double(height) - double(heights[row]);
+    heights[row] = height;
+    for (size_t i = row + 1; i < tree.size(); i += lowBit(i))
+        tree[i] += delta;
+}
+
+void RowOffsetTree::clear()
+{
+    heights.clear();
+    tree.clear();
+    topBit = 0;
+}
+
+double RowOffsetTree::offsetOf(size_t row) const
+{
+    if (row > heights.size())
+        row = heights.size();
+
+    double sum = 0;
+    for (size_t i = row; i > 0; i -= lowBit(i))
+        sum += tree[i];
+    return sum;
+}
+
+size_t RowOffsetTree::rowAt(double position) const
+{
+    if (heights.empty() || position <= 0)
+        return 0;
+
+    // Descends from the top bit, taking every node whose rows still end at or above
+    // position; what is taken is the count of rows wholly above it.
+    size_t above = 0;
+    double remaining = position;
+    for (size_t step = topBit; step > 0; step >>= 1)
+    {
+        size_t next = above + step;
+        if (next < tree.size() && tree[next] <= remaining)
+        {
+            above = next;
+            remaining -= tree[next];
+        }
+    }
+
+    return above < heights.size() ? above : heights.size() - 1;
+}
@@ -0,0 +1,167 @@
+#include "util/text_layout.hpp"
+
+namespace {
+
+size_t codepointLength(std::string_view text, size_t pos)
+{
+    size_t length = 1;
+    while (pos + length < text.size() &&
+        (static_cast<unsigned char>(text[pos + length]) & 0xC0) == 0x80)
+        length++;
+    return length;
+}
+
+// Rows for one paragraph (no '\n') starting at byte offset base in the full text.
+void wrapParagraph(std::string_view text, size_t base, size_t stop, float maxWidth,
+    const GlyphMetrics& metrics, std::vector<TextRow>& rows)
+{
+    bool open = false;
+    size_t rowBegin = base;
+    size_t rowEnd = base;
+    float rowWidth = 0;
+
+    size_t pos = base;
+    while (pos < stop)
+    {
+        size_t wordBegin = pos;
+        while (wordBegin < stop && text[wordBegin] == ' ')
+            wordBegin++;
+        if (wordBegin == stop)
+            break;
+        size_t wordEnd = wordBegin;
+        while (wordEnd < stop && text[wordEnd] != ' ')
+            wordEnd++;
+        pos = wordEnd;
+
+        float wordWidth = metrics.width(text.substr(wordBegin, wordEnd - wordBegin));
+        if (open)
+        {
+            float gap = metrics.width(text.substr(rowEnd, wordBegin - rowEnd));
+            if (rowWidth + gap + wordWidth <= maxWidth)
+            {
+                rowEnd = wordEnd;
+                rowWidth += gap + wordWidth;
+                continue;
+            }
+            rows.push_back({uint32_t(rowBegin), uint32_t(rowEnd)});
+            open = false;
+        }
+
+        if (wordWidth <= maxWidth)
+        {
+            open = true;
+            rowBegin = wordBegin;
+            rowEnd = wordEnd;
+            rowWidth = wordWidth;
+            continue;
+        }
+
+        // A word wider than the row: split it between codepoints, at least one per row.
+        size_t chunkBegin = wordBegin;
+        float chunkWidth = 0;
+        for (size_t cp = wordBegin; cp < wordEnd;)
+        {
+            size_t length = codepointLength(text, cp);
+            float cpWidth = metrics.width(text.substr(cp, length));
+            if (cp > chunkBegin && chunkWidth + cpWidth > maxWidth)
+            {
+                rows.push_back({uint32_t(chunkBegin), uint32_t(cp)});
+                chunkBegin = cp;
+                chunkWidth = 0;
+            }
+            chunkWidth += cpWidth;
+            cp += length;
+        }
+        open = true;
+        rowBegin = chunkBegin;
+        rowEnd = wordEnd;
+        rowWidth = chunkWidth;
+    }
+
+    if (open)
+        rows.push_back({uint32_t(rowBegin), uint32_t(rowEnd)});
+    else
+        rows.push_back({uint32_t(base), uint32_t(base)});
+}
+
+} // namespace
+
+std::vector<TextRow> wrapText(std::string_view text, float maxWidth, const GlyphMetrics& metrics)
+{
+    std::vector<TextRow> rows;
+    size_t begin = 0;
+    while (true)
+    {
+        size_t stop = text.find('\n', begin);
+        if (stop == std::string_view::npos)
+            stop = text.size();
+
+        if (maxWidth > 0)
+            wrapParagraph(text, begin, stop, maxWidth, metrics, rows);
+        else
+            rows.push_back({uint32_t(begin), uint32_t(stop)});
+
+        if (stop == text.size())
+            break;
+        begin = stop + 1;
+    }
+    return rows;
+}
+
+TextLayoutCache::TextLayoutCache(size_t maxLines) : maxLines(maxLines) {}
+
+void TextLayoutCache::append(std::string text)
+{
+    lines.push_back({std::move(text), {}, 0});
+    while (lines.size() > maxLines)
+        lines.pop_front();
+    tailValid = false;
+}
+
+void TextLayoutCache::clear()
+{
+    lines.clear();
+    tailValid = false;
+}
+
+bool TextLayoutCache::setGeometry(float newWidth, float newFontSize)
+{
+    if (newWidth == width && newFontSize == fontSize)
+        return false;
+
+    width = newWidth;
+    fontSize = newFontSize;
+    key++;
+    tailValid = false;
+    return true;
+}
+
+TextLayoutCache::Tail TextLayoutCache::layoutTail(float height, const GlyphMetrics& metrics)
+{
+    if (tailValid && height == tailHeight)
+        return tail;
+
+    float lineHeight = metrics.lineHeight();
+    Tail result{lines.size(), 0};
+    while (result.first > 0)
+    {
+        Line& line = lines[result.first - 1];
+        if (line.layoutKey != key)
+        {
+            line.rows = wrapText(line.text, width, metrics);
+            line.layoutKey = key;
+            wraps++;
+        }
+
+        float lineH = float(line.rows.size()) * lineHeight;
+        if (result.height + lineH > height)
+            break;
+        result.height += lineH;
+        result.first--;
+    }
+
+    tail = result;
+    tailHeight = height;
+    tailValid = true;
+    return tail;
+}
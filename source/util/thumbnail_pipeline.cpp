@@ -0,0 +1,329 @@
+#include "util/thumbnail_pipeline.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+
+namespace {
+
+// Filter weights are 14-bit fixed point. The horizontal pass keeps 8 fractional bits in
+// a uint16 and the vertical pass sums into a uint32, so neither can overflow.
+constexpr int WEIGHT_BITS = 14;
+constexpr uint32_t WEIGHT_ONE = 1u << WEIGHT_BITS;
+constexpr int CARRY_BITS = 8;
+
+struct Taps {
+    std::vector<int> first;
+    std::vector<int> count;
+    std::vector<uint32_t> offset;
+    std::vector<uint32_t> weights;
+};
+
+// Output pixel i covers the source span [offset + i * ratio, offset + (i + 1) * ratio); each
+// source pixel under it weighs in by how much of itself lies inside.
+Taps buildTaps(int source, double offset, double span, int target)
+{
+    Taps taps;
+    taps.first.resize(target);
+    taps.count.resize(target);
+    taps.offset.resize(target);
+
+    double ratio = span / target;
+    for (int i = 0; i < target; i++)
+    {
+        double begin = offset + i * ratio;
+        double end = std::min<double>(source, offset + (i + 1) * ratio);
+        int lo = static_cast<int>(begin);
+        int hi = std::min(source, static_cast<int>(std::ceil(end)));
+
+        taps.first[i] = lo;
+        taps.count[i] = hi - lo;
+        taps.offset[i] = static_cast<uint32_t>(taps.weights.size());
+
+        uint32_t total = 0;
+        size_t heaviest = taps.weights.size();
+        for (int k = lo; k < hi; k++)
+        {
+            double cover = std::min<double>(end, k + 1) - std::max<double>(begin, k);
+            auto weight = static_cast<uint32_t>(std::lround(cover / (end - begin) * WEIGHT_ONE));
+            if (k == lo || weight > taps.weights[heaviest])
+                heaviest = taps.weights.size();
+            taps.weights.push_back(weight);
+            total += weight;
+        }
+
+        // Rounding can leave the sum a unit or two off; the heaviest tap absorbs it so a
+        // flat colour stays exactly flat.
+        taps.weights[heaviest] += WEIGHT_ONE - total;
+    }
+
+    return taps;
+}
+
+inline uint8_t premultiply(uint8_t channel, uint8_t alpha)
+{
+    uint32_t t = uint32_t(channel) * alpha + 128;
+    return static_cast<uint8_t>((t + (t >> 8)) >> 8);
+}
+
+void premultiplyRow(const uint8_t* in, uint8_t* out, int width)
+{
+    for (int x = 0; x < width; x++, in += 4, out += 4)
+    {
+        uint8_t alpha = in[3];
+        out[0] = premultiply(in[0], alpha);
+        out[1] = premultiply(in[1], alpha);
+        out[2] = premultiply(in[2], alpha);
+        out[3] = alpha;
+    }
+}
+
+} // namespace
+
+RgbaImage downscalePremultiplied(const RgbaImage& source, int width, int height)
+{
+    RgbaImage out;
+    if (source.width <= 0 || source.height <= 0 ||
+        source.pixels.size() != size_t(source.width) * size_t(source.height) * 4)
+        return out;
+
+    double scale = width > 0 && height > 0
+        ? std::max(double(width) / source.width, double(height) / source.height)
+        : 1.0;
+
+    if (scale >= 1.0)
+    {
+        out.width = source.width;
+        out.height = source.height;
+        out.pixels.resize(source.pixels.size());
+        premultiplyRow(source.pixels.data(), out.pixels.data(), source.width * source.height);
+        return out;
+    }
+
+    out.width = std::clamp(static_cast<int>(std::lround(source.width * scale)), 1, width);
+    out.height = std::clamp(static_cast<int>(std::lround(source.height * scale)), 1, height);
+    out.pixels.resize(size_t(out.width) * out.height * 4);
+
+    // The side that overflows the box is cropped evenly, as FILL scaling would anyway.
+    double spanX = out.width / scale;
+    double spanY = out.height / scale;
+    Taps across = buildTaps(source.width, (source.width - spanX) / 2, spanX, out.width);
+    Taps down = buildTaps(source.height, (source.height - spanY) / 2, spanY, out.height);
+
+    // Horizontal pass: every source row the vertical taps read, narrowed to the output width.
+    const int rowFirst = down.first.front();
+    const int rowEnd = down.first.back() + down.count.back();
+    std::vector<uint8_t> row(size_t(source.width) * 4);
+    std::vector<uint16_t> narrow(size_t(out.width) * (rowEnd - rowFirst) * 4);
+    for (int y = rowFirst; y < rowEnd; y++)
+    {
+        premultiplyRow(source.pixels.data() + size_t(y) * source.width * 4, row.data(), source.width);
+        uint16_t* dst = narrow.data() + size_t(y - rowFirst) * out.width * 4;
+
+        for (int x = 0; x < out.width; x++, dst += 4)
+        {
+            const uint32_t* weight = across.weights.data() + across.offset[x];
+            const uint8_t* src = row.data() + size_t(across.first[x]) * 4;
+            uint32_t sum[4] = {0, 0, 0, 0};
+            for (int k = 0; k < across.count[x]; k++, src += 4)
+            {
+                sum[0] += src[0] * weight[k];
+                sum[1] += src[1] * weight[k];
+                sum[2] += src[2] * weight[k];
+                sum[3] += src[3] * weight[k];
+            }
+            constexpr int SHIFT = WEIGHT_BITS - CARRY_BITS;
+            for (int c = 0; c < 4; c++)
+                dst[c] = static_cast<uint16_t>((sum[c] + (1u << (SHIFT - 1))) >> SHIFT);
+        }
+    }
+
+    // Vertical pass, a column of narrowed rows at a time.
+    const size_t stride = size_t(out.width) * 4;
+    std::vector<uint32_t> sum(stride);
+    for (int y = 0; y < out.height; y++)
+    {
+        std::fill(sum.begin(), sum.end(), 0);
+        const uint32_t* weight = down.weights.data() + down.offset[y];
+        for (int k = 0; k < down.count[y]; k++)
+        {
+            const uint16_t* src = narrow.data() + size_t(down.first[y] + k - rowFirst) * stride;
+            for (size_t i = 0; i < stride; i++)
+                sum[i] += src[i] * weight[k];
+        }
+
+        constexpr int SHIFT = WEIGHT_BITS + CARRY_BITS;
+        uint8_t* dst = out.pixels.data() + size_t(y) * stride;
+        for (size_t i = 0; i < stride; i++)
+            dst[i] = static_cast<uint8_t>(std::min<uint32_t>(255, (sum[i] + (1u << (SHIFT - 1))) >> SHIFT));
+    }
+
+    return out;
+}
+
+ThumbnailPipeline::ThumbnailPipeline(Decoder decoder, Deliver deliver, size_t cacheBytes)
+    : decoder(std::move(decoder))
+    , deliver(std::move(deliver))
+    , cache(cacheBytes)
+{
+}
+
+ThumbnailPipeline::~ThumbnailPipeline()
+{
+    stop();
+}
+
+std::string ThumbnailPipeline::keyFor(const std::string& url, int width, int height)
+{
+    return std::format("{}@{}x{}", url, width, height);
+}
+
+ThumbnailPipeline::Thumbnail ThumbnailPipeline::cached(const std::string& url, int width, int height)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Thumbnail* found = cache.find(keyFor(url, width, height));
+    return found ? *found : nullptr;
+}
+
+void ThumbnailPipeline::request(const std::string& url, std::vector<uint8_t> encoded, int width, int height,
+    Priority priority, Ready onReady)
+{
+    std::string key = keyFor(url, width, height);
+    Thumbnail hit;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping)
+            return;
+
+        if (Thumbnail* found = cache.find(key))
+        {
+            hit = *found;
+        }
+        else
+        {
+            auto existing = waiters.find(key);
+            bool inFlight = existing != waiters.end();
+            std::vector<Ready>& list = inFlight ? existing->second : waiters[key];
+            if (onReady)
+                list.push_back(std::move(onReady));
+
+            if (inFlight)
+            {
+                // A cell waiting on a thumbnail queued as a prefetch moves it to the front.
+                if (priority == Priority::Visible)
+                {
+                    auto queued = std::find_if(jobs.begin(), jobs.end(), [&key](const Job& job) { return job.key == key; });
+                    if (queued != jobs.end() && queued != jobs.begin())
+                    {
+                        Job job = std::move(*queued);
+                        jobs.erase(queued);
+                        jobs.push_front(std::move(job));
+                    }
+                }
+                return;
+            }
+
+            Job job{key, url, std::move(encoded), width, height};
+            if (priority == Priority::Visible)
+                jobs.push_front(std::move(job));
+            else
+                jobs.push_back(std::move(job));
+
+            ensureStartedLocked();
+            cond.notify_one();
+            return;
+        }
+    }
+
+    if (onReady)
+        onReady(url, hit);
+}
+
+void ThumbnailPipeline::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        jobs.clear();
+        waiters.clear();
+        cond.notify_all();
+    }
+
+    if (worker.joinable())
+        worker.join();
+}
+
+akira::CacheMetrics ThumbnailPipeline::metrics() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return cache.metrics();
+}
+
+size_t ThumbnailPipeline::queued() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return jobs.size();
+}
+
+void ThumbnailPipeline::ensureStartedLocked()
+{
+    if (!worker.joinable())
+        worker = std::thread([this]() { run(); });
+}
+
+ThumbnailPipeline::Thumbnail ThumbnailPipeline::render(const Job& job) const
+{
+    RgbaImage decoded;
+    if (!decoder || !decoder(job.encoded, decoded))
+        return nullptr;
+
+    RgbaImage scaled = downscalePremultiplied(decoded, job.width, job.height);
+    if (scaled.pixels.empty())
+        return nullptr;
+
+    return std::make_shared<const RgbaImage>(std::move(scaled));
+}
+
+void ThumbnailPipeline::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        cond.wait(lock, [this]() { return stopping || !jobs.empty(); });
+        if (stopping)
+            return;
+
+        Job job = std::move(jobs.front());
+        jobs.pop_front();
+
+        lock.unlock();
+        Thumbnail thumbnail = render(job);
+        lock.lock();
+
+        if (stopping)
+            return;
+
+        // A failed decode is not cached: the caller usually discards the bytes and
+        // fetches them again, and the retry should not hit a remembered failure.
+        if (thumbnail)
+            cache.put(job.key, thumbnail);
+
+        std::vector<Ready> ready;
+        auto entry = waiters.find(job.key);
+        if (entry != waiters.end())
+        {
+            ready.swap(entry->second);
+            waiters.erase(entry);
+        }
+
+        if (ready.empty() || !deliver)
+            continue;
+
+        lock.unlock();
+        deliver([ready = std::move(ready), url = job.url, thumbnail]() {
+            for (const Ready& callback : ready)
+                callback(url, thumbnail);
+        });
+        lock.lock();
+    }
+}
@@ -7,6 +7,7 @@
 #include <chrono>
 #include <future>
 #include "core/discovery_manager.hpp"
+#include "core/connect_timeline.hpp"
 #include "psn/auth.hpp"
 #include "core/settings_manager.hpp"
 #include "core/thread_affinity.h"
@@ -43,7 +44,9 @@ void ConnectionView::setupAndStart()
     cancelBtn->registerClickAction([weak](brls::View* view) {
         if (auto self = weak.lock()) {
             brls::Logger::info("Connection cancelled by user");
+            ConnectTimeline::shared().abandon("cancelled");
             if (self->connectionRunning) {
+                self->wakePipeline->cancel();
                 self->host->cancelHolepunch();
             }
             brls::sync([]() {
@@ -76,6 +79,7 @@ ConnectionView::~ConnectionView()
 {
     brls::Logger::unsubscribeFromLog(logSubscription);
     if (connectionRunning) {
+        wakePipeline->cancel();
         host->cancelHolepunch();
     }
     if (threadStarted) {
@@ -187,6 +191,7 @@ void ConnectionView::renderLogs(NVGcontext* vg, float x, float y, float width, f
 struct ConnectionThreadArgs {
     std::weak_ptr<ConnectionView> weak;
     Host* host;  // Host pointer is safe - it outlives the connection
+    std::shared_ptr<WakePipeline> wakePipeline;
 };
 
 void ConnectionView::startConnection()
@@ -196,7 +201,7 @@ void ConnectionView::startConnection()
     connectionSuccess = false;
     threadStarted = false;
 
-    auto args = std::make_unique<ConnectionThreadArgs>(ConnectionThreadArgs{weak_from_this(), host});
+    auto args = std::make_unique<ConnectionThreadArgs>(ConnectionThreadArgs{weak_from_this(), host, wakePipeline});
 
     ChiakiErrorCode err = chiaki_thread_create(&connectionThread, connectionThreadFunc, args.get());
     if (err != CHIAKI_ERR_SUCCESS) {
@@ -216,6 +221,7 @@ void* ConnectionView::connectionThreadFunc(void* user)
     auto* args = static_cast<ConnectionThreadArgs*>(user);
     auto weak = args->weak;
     Host* host = args->host;
+    std::shared_ptr<WakePipeline> wakePipeline = args->wakePipeline;
     delete args;
 
     brls::Logger::info("Connection thread started");
@@ -284,6 +290,35 @@ void* ConnectionView::connectionThreadFunc(void* user)
             view->connectionRunning = false;
         }
     } else {
+        // A console in rest mode is woken here and polled until it takes the session,
+        // rather than left for the stream to fail against and retry on a timer.
+        if (host->isStandby() && host->hasRpKey()) {
+            brls::Logger::info("Waking {} before connecting", host->getHostName());
+
+            ConsoleProbe probe;
+            int64_t wakeStartMs = ConnectTimeline::nowMs();
+            WakePipeline::Result woken = wakePipeline->run(host->wakePipelineOps(probe));
+            ConnectTimeline::shared().record("wake", wakeStartMs, woken.elapsedMs,
+                                             woken.outcome == WakePipeline::Outcome::Ready);
+            brls::Logger::info("Wake of {}: {} in {} ms, {} wake(s), {} poll(s)", host->getHostName(),
+                               ConnectPrewarm::summary(woken.timeline), woken.elapsedMs, woken.wakes, woken.polls);
+
+            if (woken.outcome != WakePipeline::Outcome::Ready) {
+                if (auto view = weak.lock()) {
+                    if (woken.outcome == WakePipeline::Outcome::WakeFailed)
+                        view->connectionError = "akira/stream/wake_failed"_i18n;
+                    else if (woken.outcome == WakePipeline::Outcome::TimedOut)
+                        view->connectionError = "akira/connection/fail_wake"_i18n;
+                    if (woken.outcome != WakePipeline::Outcome::Cancelled)
+                        brls::Logger::error("{}", view->connectionError);
+                    view->connectionSuccess = false;
+                    view->connectionFinished = woken.outcome != WakePipeline::Outcome::Cancelled;
+                    view->connectionRunning = false;
+                }
+                return nullptr;
+            }
+        }
+
         if (auto view = weak.lock()) {
             view->connectionSuccess = true;
             view->connectionFinished = true;
@@ -308,7 +343,11 @@ void ConnectionView::onConnectionComplete()
             brls::Application::pushActivity(new brls::Activity(streamView.get()));
             streamView->startStream();
         });
-    } else if (SettingsManager::getInstance()->getConnectionShowStages()) {
+        return;
+    }
+
+    ConnectTimeline::shared().abandon(connectionError);
+    if (SettingsManager::getInstance()->getConnectionShowStages()) {
         ConnectionStage stage = static_cast<ConnectionStage>(currentStage.load());
         failureText = brls::getStr(connectionFailureKeyForStage(stage));
         connectFailed = true;
@@ -27,6 +27,8 @@ DiscoveryLogView::DiscoveryLogView()
 
     clearBtn->registerClickAction([this](brls::View*) {
         DiscoveryManager::clearDiscoveryLog();
+        lines.clear();
+        dirty = true;
         refreshLog();
         return true;
     });
@@ -49,7 +51,7 @@ brls::View* DiscoveryLogView::create()
 void DiscoveryLogView::willAppear(bool resetState)
 {
     Box::willAppear(resetState);
-    lastVersion = UINT64_MAX;
+    dirty = true;
     refreshLog();
     refreshTimer.start(300);
 }
@@ -62,12 +64,16 @@ void DiscoveryLogView::willDisappear(bool resetState)
 
 void DiscoveryLogView::refreshLog()
 {
-    uint64_t version = DiscoveryManager::getDiscoveryLogVersion();
-    if (version == lastVersion)
+    std::vector<std::string> fresh;
+    nextSeq = DiscoveryManager::readDiscoveryLog(nextSeq, fresh);
+    if (!dirty && fresh.empty())
         return;
-    lastVersion = version;
+    dirty = false;
 
-    std::vector<std::string> lines = DiscoveryManager::getDiscoveryLogSnapshot();
+    for (auto& line : fresh)
+        lines.push_back(std::move(line));
+    while (lines.size() > MAX_LINES)
+        lines.pop_front();
 
     if (statusLabel) {
         if (!SettingsManager::getInstance()->getDebugDiscoveryLog())
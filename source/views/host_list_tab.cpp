@@ -11,6 +11,7 @@
 #include "views/enter_pin_view.hpp"
 #include "views/pair_view.hpp"
 #include "core/host.hpp"
+#include "core/connect_timeline.hpp"
 #include "core/trophy_manager.hpp"
 #include "psn/auth.hpp"
 #include "psn/models.hpp"
@@ -178,6 +179,10 @@ public:
 
         akira::ui::motion::liftOnFocus(this, focusAnim);
 
+        // A remote connect starts warming up while the tile has focus.
+        this->getFocusEvent()->subscribe([this](brls::View*) { this->host->prewarmConnect(); });
+        this->getFocusLostEvent()->subscribe([this](brls::View*) { this->host->cancelPrewarm(); });
+
         updateState();
     }
 
@@ -253,7 +258,6 @@ public:
     void doPrimaryAction() {
         if (host->isRemote() && host->needsLink()) doLink();
         else if (!host->hasRpKey() && (host->isDiscovered() || host->canAutoRegister())) doRegister();
-        else if (host->isStandby() && host->hasRpKey() && !host->isRemote()) doWake();
         else if (host->hasRpKey()) doConnect();
         else brls::Logger::warning("No primary action for {} (remote={}, needsLink={}, discovered={}, rpkey={}, canAuto={})",
             host->getHostName(), host->isRemote(), host->needsLink(), host->isDiscovered(), host->hasRpKey(), host->canAutoRegister());
@@ -266,6 +270,10 @@ public:
             options.push_back("akira/host_settings/console_pin"_i18n);
             ids.push_back(0);
         }
+        if (host->isStandby() && host->hasRpKey() && !host->isRemote()) {
+            options.push_back("akira/hosts/wake"_i18n);
+            ids.push_back(2);
+        }
         if (host->isRegistered()) {
             options.push_back("akira/hosts/delete"_i18n);
             ids.push_back(1);
@@ -276,6 +284,7 @@ public:
             [this, ids](int sel) {
                 if (sel < 0 || sel >= static_cast<int>(ids.size())) return;
                 if (ids[sel] == 0) doConsolePIN();
+                else if (ids[sel] == 2) doWake();
                 else doDelete();
             });
         brls::Application::pushActivity(new brls::Activity(dropdown));
@@ -655,14 +664,17 @@ private:
 
     void doDelete() {
             std::string hostName = host->getHostName();
+            std::string hostId = host->hostId;
+            std::string hostAddr = host->getHostAddr();
             brls::Logger::info("Delete button clicked for {}", hostName);
 
             auto* dialog = new brls::Dialog(brls::getStr("akira/hosts/delete_confirm", hostName));
             dialog->addButton("akira/common/cancel"_i18n, []() {});
-            dialog->addButton("akira/common/delete"_i18n, [hostName]() {
+            dialog->addButton("akira/common/delete"_i18n, [hostName, hostId, hostAddr]() {
                 auto* settings = SettingsManager::getInstance();
                 settings->removeActiveProfileRegistration(hostName);
                 settings->writeFile();
+                DiscoveryManager::getInstance()->forgetHost(hostId, hostAddr);
                 brls::Application::notify("akira/hosts/host_deleted"_i18n);
                 if (HostListTab::currentInstance) {
                     // If this was the last host, give focus to Find Remote button first
@@ -1070,8 +1082,10 @@ void HostListTab::connectToHost(Host* host) {
 
     HostListTab::isConnecting = true;
     HostListTab::connectionActive = true;
+    ConnectTimeline::shared().begin(host->getHostName(), host->connectPath());
 
-    if (host->isRemote()) {
+    // Remote hosts need the holepunch and standby ones the wake; both show their progress.
+    if (host->isRemote() || host->isStandby()) {
         auto connectionView = SharedViewHolder::holdNew<ConnectionView>(host);
         brls::Application::pushActivity(new brls::Activity(connectionView.get()));
         connectionView->setupAndStart();
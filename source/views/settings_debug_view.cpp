@@ -1,7 +1,9 @@
 #include "views/settings_debug_view.hpp"
 #include "views/discovery_log_view.hpp"
+#include "core/connect_timeline.hpp"
 
 #include <borealis/core/i18n.hpp>
+#include <sys/stat.h>
 
 using namespace brls::literals;
 
@@ -22,6 +24,16 @@ SettingsDebugView::SettingsDebugView() {
         brls::Application::pushActivity(new brls::Activity(new DiscoveryLogView()));
         return true;
     });
+
+    exportConnectTimingsBtn->registerClickAction([](brls::View*) {
+        mkdir(SettingsManager::LOG_DIR, 0755);
+        std::string path = std::string(SettingsManager::LOG_DIR) + "/connect_timings.json";
+        if (ConnectTimeline::shared().exportTo(path))
+            brls::Application::notify(brls::getStr("akira/settings/connect_timings_exported", path));
+        else
+            brls::Application::notify("akira/settings/connect_timings_export_failed"_i18n);
+        return true;
+    });
 }
 
 void SettingsDebugView::initEnableFileLoggingToggle() {
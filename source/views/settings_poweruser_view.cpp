@@ -35,6 +35,12 @@ SettingsPowerUserView::SettingsPowerUserView() {
         return true;
     });
 
+    exportTrophyCacheBtn->registerClickAction([](brls::View*) {
+        int exported = TrophyManager::getInstance()->exportCacheAsJson();
+        brls::Application::notify(std::format("{} ({})", "akira/settings/trophy_cache_exported"_i18n, exported));
+        return true;
+    });
+
 }
 
 void SettingsPowerUserView::initUnlockBitrateMaxToggle() {
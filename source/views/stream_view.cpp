@@ -8,6 +8,7 @@
 #include <format>
 #include "core/exception.hpp"
 #include "core/wireguard_manager.hpp"
+#include "core/connect_timeline.hpp"
 #include "stream/input_manager.hpp"
 #include "core/discovery_manager.hpp"
 #include "psn/auth.hpp"
@@ -138,6 +139,7 @@ void StreamView::startStream()
     }
 
     brls::Logger::info("Starting stream to {}", host->getHostName());
+    ConnectTimeline::shared().begin(host->getHostName(), host->connectPath());
 
     try
     {
@@ -203,6 +205,7 @@ void StreamView::startStream()
     catch (const Exception& e)
     {
         brls::Logger::error("Failed to start stream: {}", e.what());
+        ConnectTimeline::shared().abandon(e.what());
 
         session->FreeController();
         host->cleanupHolepunch();
@@ -228,6 +231,7 @@ void StreamView::stopStream()
     }
 
     brls::Logger::info("Stopping stream");
+    ConnectTimeline::shared().abandon("stopped before the first frame");
 
     brls::Application::forceUnblockInputs();
     brls::Application::setRenderSuspended(false);
@@ -1,6 +1,7 @@
 #include "views/trophy_detail_view.hpp"
 #include "ui/theme.hpp"
 #include "ui/motion.hpp"
+#include "ui/thumbnails.hpp"
 #include "views/trophy_list_tab.hpp"
 
 #include <algorithm>
@@ -9,6 +10,8 @@
 
 using namespace brls::literals;
 
+namespace thumbnails = akira::ui::thumbnails;
+
 static const brls::ButtonStyle BUTTONSTYLE_BLUE = {
     .shadowType              = brls::ShadowType::GENERIC,
     .hideHighlightBackground = true,
@@ -328,25 +331,17 @@ void TrophyRowCell::bindTrophy(const psn::Trophy& trophy)
     if (iconUrl.empty())
         return;
 
-    TrophyManager::getInstance()->fetchIcon(iconUrl,
-        [](const std::string& url, const std::vector<uint8_t>& bytes) {
-            bool decodeFailed = false;
-
-            for (TrophyRowCell* cell : liveCells)
+    thumbnails::load(thumbnails::Source::Icon, iconUrl, ROW_ICON_SIZE, ROW_ICON_SIZE,
+        [](const std::string& url, const ThumbnailPipeline::Thumbnail& thumbnail) {
+            if (thumbnail)
             {
-                if (cell->iconUrl != url)
-                    continue;
-
-                cell->icon->setImageFromMem(bytes.data(), static_cast<int>(bytes.size()));
-
-                if (cell->icon->getTexture() <= 0)
-                    decodeFailed = true;
-            }
-
-            if (!decodeFailed)
+                for (TrophyRowCell* cell : liveCells)
+                    if (cell->iconUrl == url)
+                        thumbnails::apply(cell->icon, thumbnail);
                 return;
+            }
 
-            brls::Logger::warning("Trophy icon failed to decode ({} bytes) {}", bytes.size(), url);
+            brls::Logger::warning("Trophy icon failed to decode {}", url);
 
             if (retriedIcons.insert(url).second)
                 TrophyManager::getInstance()->discardIcon(url);
@@ -1,6 +1,7 @@
 #include "views/trophy_list_tab.hpp"
 #include "ui/theme.hpp"
 #include "ui/motion.hpp"
+#include "ui/thumbnails.hpp"
 #include "views/trophy_detail_view.hpp"
 
 #include <algorithm>
@@ -9,6 +10,8 @@
 
 using namespace brls::literals;
 
+namespace thumbnails = akira::ui::thumbnails;
+
 static const brls::ButtonStyle BUTTONSTYLE_BLUE = {
     .shadowType              = brls::ShadowType::GENERIC,
     .hideHighlightBackground = true,
@@ -28,9 +31,12 @@ TitleFilter TrophyListTab::filterMode = TitleFilter::All;
 std::unordered_set<TrophyGameCard*> TrophyGameCard::liveCards;
 std::unordered_set<std::string> TrophyGameCard::retriedIcons;
 
+// A third of the grid's width, near enough; thumbnails are cut to cover this box.
+static constexpr float CARD_COVER_WIDTH = 330;
 static constexpr float CARD_COVER_HEIGHT = 206;
 static constexpr float CARD_ROW_HEIGHT = 332;
 static constexpr float PROFILE_HEADER_HEIGHT = 150;
+static constexpr size_t CARDS_PER_ROW = 3;
 
 std::string formatPlayDuration(int64_t seconds)
 {
@@ -262,25 +268,17 @@ void TrophyGameCard::bind(const psn::TrophyTitle& title, std::function<void()> o
     if (iconUrl.empty())
         return;
 
-    TrophyManager::getInstance()->fetchIcon(iconUrl,
-        [](const std::string& url, const std::vector<uint8_t>& bytes) {
-            bool decodeFailed = false;
-
-            for (TrophyGameCard* card : liveCards)
+    thumbnails::load(thumbnails::Source::Icon, iconUrl, CARD_COVER_WIDTH, CARD_COVER_HEIGHT,
+        [](const std::string& url, const ThumbnailPipeline::Thumbnail& thumbnail) {
+            if (thumbnail)
             {
-                if (card->iconUrl != url)
-                    continue;
-
-                card->cover->setImageFromMem(bytes.data(), static_cast<int>(bytes.size()));
-
-                if (card->cover->getTexture() <= 0)
-                    decodeFailed = true;
-            }
-
-            if (!decodeFailed)
+                for (TrophyGameCard* card : liveCards)
+                    if (card->iconUrl == url)
+                        thumbnails::apply(card->cover, thumbnail);
                 return;
+            }
 
-            brls::Logger::warning("Trophy cover failed to decode ({} bytes) {}", bytes.size(), url);
+            brls::Logger::warning("Trophy cover failed to decode {}", url);
 
             if (retriedIcons.insert(url).second)
                 TrophyManager::getInstance()->discardIcon(url);
@@ -453,13 +451,19 @@ RecyclingGridItem* TrophyProfileCell::create()
 }
 
 TrophyGridDataSource::TrophyGridDataSource(std::vector<psn::TrophyTitle> titles, psn::TrophySummary summary, bool haveSummary)
-    : titles(std::move(titles)), summary(std::move(summary)), haveSummary(haveSummary)
+    : titles(std::move(titles)), summary(std::move(summary)), haveSummary(haveSummary),
+      prefetch({.byteBudget = thumbnails::prefetchBudgetBytes()})
+{
+}
+
+TrophyGridDataSource::~TrophyGridDataSource()
 {
+    withdraw(prefetch.reset());
 }
 
 size_t TrophyGridDataSource::getItemCount()
 {
-    return 1 + (titles.size() + 2) / 3;
+    return 1 + (titles.size() + CARDS_PER_ROW - 1) / CARDS_PER_ROW;
 }
 
 float TrophyGridDataSource::heightForRow(brls::View* recycler, size_t index)
@@ -485,7 +489,7 @@ RecyclingGridItem* TrophyGridDataSource::cellForRow(RecyclingView* recycler, siz
     if (!cell)
         return nullptr;
 
-    cell->bindRow(titles, (index - 1) * 3);
+    cell->bindRow(titles, (index - 1) * CARDS_PER_ROW);
 
     return cell;
 }
@@ -494,11 +498,48 @@ void TrophyGridDataSource::onItemSelected(brls::Box* recycler, size_t index)
 {
 }
 
+void TrophyGridDataSource::onViewportChanged(size_t first, size_t last, float rowsPerSecond)
+{
+    PrefetchPlanner::Plan plan = prefetch.update({first, last, getItemCount(), rowsPerSecond},
+        [this](size_t row) { return iconsInRow(row) * thumbnails::bytesFor(CARD_COVER_WIDTH, CARD_COVER_HEIGHT); });
+
+    for (size_t row : plan.fetch)
+        for (size_t i = firstTitleOf(row); i < firstTitleOf(row + 1); i++)
+            thumbnails::prefetch(thumbnails::Source::Icon, titles[i].trophyTitleIconUrl,
+                CARD_COVER_WIDTH, CARD_COVER_HEIGHT);
+
+    withdraw(plan.cancel);
+}
+
 void TrophyGridDataSource::clearData()
 {
+    withdraw(prefetch.reset());
     titles.clear();
 }
 
+// Row 0 is the profile header; title rows start at 1.
+size_t TrophyGridDataSource::firstTitleOf(size_t row) const
+{
+    return row == 0 ? 0 : std::min(titles.size(), (row - 1) * CARDS_PER_ROW);
+}
+
+size_t TrophyGridDataSource::iconsInRow(size_t row) const
+{
+    size_t count = 0;
+    for (size_t i = firstTitleOf(row); i < firstTitleOf(row + 1); i++)
+        if (!titles[i].trophyTitleIconUrl.empty())
+            count++;
+    return count;
+}
+
+void TrophyGridDataSource::withdraw(const std::vector<size_t>& rows)
+{
+    for (size_t row : rows)
+        for (size_t i = firstTitleOf(row); i < firstTitleOf(row + 1); i++)
+            if (!titles[i].trophyTitleIconUrl.empty())
+                thumbnails::cancel(titles[i].trophyTitleIconUrl);
+}
+
 TrophyListTab::TrophyListTab()
 {
     this->inflateFromXMLRes("xml/tabs/trophies.xml");
@@ -18,11 +18,18 @@
 //     loading a missing resource left an invalid texture that was redrawn every frame.
 //   - draw() renders the hint label on its own when there is no hint image.
 //   - setEmpty()/setError() null-guard their setImageFromRes calls.
+//   - itemsRecyclingLoop() reports the bound range and scroll speed to the data source
+//     through onViewportChanged(), so it can fetch artwork ahead of the viewport.
+//   - Flow-mode row offsets live in a RowOffsetTree (Fenwick tree) instead of being summed
+//     from cellHeightCache on every query. reloadData() starts at the focused row in flow
+//     mode too, and itemsRecyclingLoop() jumps straight to the row under the viewport when
+//     it no longer overlaps the rendered cells.
 //
 // This is vendored from switchfin under the Apache-2.0 license. Please check the attached
 // license for the terms of the Apache license
 //
 
+#include <cmath>
 #include <utility>
 #include "views/vendored/switchfin/recycling_grid.hpp"
 
@@ -279,6 +286,7 @@ void RecyclingGrid::addCellAt(size_t index, bool downSide) {
                 cellHeight = estimatedRowHeight;
             }
             cellHeightCache[index] = cellHeight;
+            rowOffsets.set(index, rowPitch(cellHeight));
         } else {
             // dataSource 中指定了cell的高度，使用预定义的值
             cellHeight = cellHeightCache[index];
@@ -348,6 +356,10 @@ void RecyclingGrid::reloadData() {
     visibleMin = UINT_MAX;
     visibleMax = 0;
 
+    scrollVelocity.reset();
+    reportedMin = reportedMax = SIZE_MAX;
+    reportedSpeed = 0;
+
     renderedFrame = brls::Rect();
     renderedFrame.size.width = getWidth();
     if (renderedFrame.size.width != renderedFrame.size.width) {
@@ -385,14 +397,17 @@ void RecyclingGrid::reloadData() {
     } else {
         // 获取每个cell的高度并缓存起来
         cellHeightCache.clear();
+        std::vector<float> pitches;
         for (size_t section = 0; section < dataSource->getItemCount(); section++) {
             float height = dataSource->heightForRow(this, section);
             cellHeightCache.push_back(height);
+            pitches.push_back(rowPitch(height));
         }
+        rowOffsets.assign(pitches);
         contentBox->setHeight(getHeightByCellIndex(dataSource->getItemCount()) + paddingTop + paddingBottom);
-        // 流式布局无法准确确定焦点cell的位置，因此暂时只添加第一项，在 itemsRecyclingLoop 中会逐渐添加到 cellFocusIndex，再按需删除
-        // 当 cellFocusIndex 过于大时，会导致添加的元素过多，因此需要考虑优化
-        this->addCellAt(0, true);
+        // 行偏移由 rowOffsets 给出，与固定高度时一样直接从 cellFocusIndex 开始添加
+        renderedFrame.origin.y = getHeightByCellIndex(cellFocusIndex);
+        this->addCellAt(cellFocusIndex, true);
     }
 
     // 在前面的操作中，列表增加了一项，通过 selectRowAt 再精确地显示出具体选中项
@@ -408,6 +423,7 @@ void RecyclingGrid::notifyDataChanged() {
             for (size_t i = cellHeightCache.size(); i < dataSource->getItemCount(); i++) {
                 float height = dataSource->heightForRow(this, i);
                 cellHeightCache.push_back(height);
+                rowOffsets.push_back(rowPitch(height));
             }
             contentBox->setHeight(getHeightByCellIndex(this->dataSource->getItemCount()) + paddingTop + paddingBottom);
         } else {
@@ -467,6 +483,27 @@ void RecyclingGrid::itemsRecyclingLoop() {
 
     brls::Rect visibleFrame = getVisibleFrame();
 
+    // 可见区域与已渲染区域完全错开时（例如快速滑动或跳转到顶部），不再逐项增删中间的列表项，
+    // 而是回收全部列表项，从可见区域顶部所在的行重新开始
+    if (!contentBox->getChildren().empty() && dataSource->getItemCount() > 0 &&
+        (visibleFrame.getMaxY() - paddingTop < renderedFrame.getMinY() ||
+            visibleFrame.getMinY() - paddingTop > renderedFrame.getMaxY())) {
+        std::vector<brls::View*> children = contentBox->getChildren();
+        for (auto child : children) {
+            queueReusableCell((RecyclingGridItem*)child);
+            this->removeCell(child);
+        }
+
+        size_t lineHeadIndex = getCellIndexByHeight(visibleFrame.getMinY() - paddingTop) / spanCount * spanCount;
+        visibleMin = UINT_MAX;
+        visibleMax = 0;
+        renderedFrame.origin.y = getHeightByCellIndex(lineHeadIndex);
+        renderedFrame.size.height = 0;
+        addCellAt(lineHeadIndex, true);
+
+        brls::Logger::verbose("RecyclingGrid jumped to cell #{}", lineHeadIndex);
+    }
+
     // 上方元素自动销毁
     while (true) {
         RecyclingGridItem* minCell = nullptr;
@@ -557,6 +594,25 @@ void RecyclingGrid::itemsRecyclingLoop() {
             }
         }
     }
+
+    reportViewport();
+}
+
+void RecyclingGrid::reportViewport() {
+    if (visibleMin > visibleMax || visibleMax >= dataSource->getItemCount()) return;
+
+    int64_t nowMs = brls::getCPUTimeUsec() / 1000;
+    float rowPitch = estimatedRowHeight + estimatedRowSpace;
+    float itemsPerSecond = scrollVelocity.sample(getContentOffsetY(), nowMs) / rowPitch * spanCount;
+
+    // 速度变化不足半项/秒且可见范围未变时不通知，避免每帧都重新规划预取
+    if (visibleMin == reportedMin && visibleMax == reportedMax && std::fabs(itemsPerSecond - reportedSpeed) < 0.5f)
+        return;
+
+    reportedMin = visibleMin;
+    reportedMax = visibleMax;
+    reportedSpeed = itemsPerSecond;
+    dataSource->onViewportChanged(visibleMin, visibleMax + 1, itemsPerSecond);
 }
 
 void RecyclingGrid::selectRowAt(size_t index, bool animated) {
@@ -575,22 +631,28 @@ float RecyclingGrid::getHeightByCellIndex(size_t index, size_t start) {
     if (index <= start) return 0;
     if (!isFlowMode) return (estimatedRowHeight + estimatedRowSpace) * (size_t)((index - start) / spanCount);
 
-    if (cellHeightCache.size() == 0) {
+    if (rowOffsets.size() == 0) {
         brls::Logger::error("cellHeightCache.size() cannot be zero in flow mode {} {}", start, index);
         return 0;
     }
 
-    if (start < 0) start = 0;
-    if (index > this->cellHeightCache.size()) index = this->cellHeightCache.size();
+    return rowOffsets.offsetOf(index) - rowOffsets.offsetOf(start);
+}
 
-    float res = 0;
-    for (size_t i = start; i < index && i < cellHeightCache.size(); i++) {
-        if (cellHeightCache[i] != -1)
-            res += cellHeightCache[i] + estimatedRowSpace;
-        else
-            res += estimatedRowHeight + estimatedRowSpace;
+size_t RecyclingGrid::getCellIndexByHeight(float height) {
+    size_t count = dataSource ? dataSource->getItemCount() : 0;
+    if (count == 0 || height <= 0) return 0;
+
+    if (!isFlowMode) {
+        size_t index = (size_t)(height / (estimatedRowHeight + estimatedRowSpace)) * spanCount;
+        return index < count ? index : count - 1;
     }
-    return res;
+
+    return rowOffsets.rowAt(height);
+}
+
+float RecyclingGrid::rowPitch(float cellHeight) const {
+    return (cellHeight != -1 ? cellHeight : estimatedRowHeight) + estimatedRowSpace;
 }
 
 void RecyclingGrid::forceRequestNextPage() { this->requestNextPage = false; }
@@ -0,0 +1,110 @@
+#include "test_util.hpp"
+
+#include "catalog_fixture.hpp"
+#include "cloud/models.hpp"
+#include "cloud/search_index.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace cloud;
+
+// Opening the library on a big subscription catalog. Before, the grid waited for the unified
+// fetch and then parseCatalog's deduplication; now it draws from the saved snapshot and the
+// revalidation that follows only hands the view a diff.
+BENCH(cloud_catalog_snapshot_open)
+{
+    Catalog catalog = fixtures::syntheticCatalog(5000);
+    std::string payload = fixtures::catalogPayload(catalog);
+    Catalog parsed;
+    parseCatalog(payload, parsed);
+    std::string saved = serializeCatalogSnapshot(parsed, 0);
+
+    std::printf("      payload %zu bytes, snapshot %zu bytes, %zu games after dedup\n", payload.size(),
+        saved.size(), parsed.games.size());
+
+    tests::measure("parseCatalog, 5000 entries", 20, [&] {
+        Catalog out;
+        parseCatalog(payload, out);
+        return out.games.size();
+    });
+
+    tests::measure("parseCatalogSnapshot, 5000 entries", 20, [&] {
+        Catalog out;
+        int64_t savedAt = 0;
+        parseCatalogSnapshot(saved, out, savedAt);
+        return out.games.size();
+    });
+
+    tests::measure("serializeCatalogSnapshot, 5000 entries", 20, [&] {
+        return serializeCatalogSnapshot(parsed, 0).size();
+    });
+
+    Catalog next = parsed;
+    for (size_t i = 0; i < next.games.size(); i += 250)
+        next.games[i].isOwned = !next.games[i].isOwned;
+    next.games.resize(next.games.size() - 10);
+
+    tests::measure("diffCatalogs, 20 changed 10 removed", 50, [&] {
+        return diffCatalogs(parsed.games, next.games).changed.size();
+    });
+
+    CatalogDiff diff = diffCatalogs(parsed.games, next.games);
+    tests::measure("applyCatalogDiff", 50, [&] {
+        std::vector<Game> games = parsed.games;
+        applyCatalogDiff(games, diff);
+        return games.size();
+    });
+}
+
+// Typing a title into the library search, one keystroke at a time. The scan is what
+// applyFilter did before SearchIndex: lowercase every title, substring test, then sort.
+BENCH(cloud_library_search)
+{
+    std::vector<Game> games = fixtures::syntheticCatalog(5000).games;
+    const char* const keystrokes[] = {"s", "sp", "spi", "spid", "spide", "spider", "spider ", "spider s"};
+
+    auto lower = [](std::string text) {
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+        return text;
+    };
+
+    tests::measure("scan and sort, 8 keystrokes", 20, [&] {
+        size_t hits = 0;
+        for (const char* query : keystrokes)
+        {
+            std::string q = lower(query);
+            std::vector<Game> filtered;
+            for (const Game& game : games)
+                if (lower(game.name).find(q) != std::string::npos)
+                    filtered.push_back(game);
+            std::sort(filtered.begin(), filtered.end(), [&lower](const Game& a, const Game& b) {
+                return lower(a.name) < lower(b.name);
+            });
+            hits += filtered.size();
+        }
+        return hits / std::size(keystrokes);
+    });
+
+    SearchIndex index;
+    tests::measure("SearchIndex::assign, 5000 entries", 20, [&] {
+        index.assign(games);
+        return index.size();
+    });
+
+    tests::measure("SearchIndex::search, 8 keystrokes", 200, [&] {
+        size_t hits = 0;
+        for (const char* query : keystrokes)
+            hits += index.search(query, SearchIndex::Order::NameAscending).size();
+        return hits / std::size(keystrokes);
+    });
+
+    tests::measure("SearchIndex::search, cold 3-letter query", 200, [&] {
+        index.search("", SearchIndex::Order::Featured);
+        return index.search("tsu", SearchIndex::Order::Featured).size();
+    });
+}
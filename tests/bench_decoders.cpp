@@ -0,0 +1,268 @@
+#include "test_util.hpp"
+
+#include "cloud/models.hpp"
+#include "psn/json_reader.hpp"
+#include "psn/models.hpp"
+#include "psn/schema.hpp"
+#include "psn/snapshot.hpp"
+
+#include <json-c/json.h>
+
+#include <format>
+#include <string>
+#include <vector>
+
+// Bodies are synthesized to the shape and size of real responses for a large account: a
+// full 800-title library page, a 1500-trophy detail set and a 3000-game cloud catalog.
+
+using namespace psn;
+
+namespace {
+
+std::string titlePage(int count)
+{
+    std::string body = R"({"trophyTitles":[)";
+    for (int i = 0; i < count; i++)
+    {
+        if (i)
+            body += ',';
+        body += std::format(
+            R"({{"npServiceName":"trophy2","npCommunicationId":"NPWR{:05}_00","trophySetVersion":"01.00",)"
+            R"("trophyTitleName":"Synthesized Title {}","trophyTitleDetail":"Detail text for title {}",)"
+            R"("trophyTitleIconUrl":"https://image.api.playstation.com/trophy/np/NPWR{:05}_00/icon.png",)"
+            R"("trophyTitlePlatform":"PS5","hasTrophyGroups":true,"trophyGroupCount":2,)"
+            R"("definedTrophies":{{"bronze":40,"silver":10,"gold":4,"platinum":1}},"progress":{},)"
+            R"("earnedTrophies":{{"bronze":20,"silver":5,"gold":1,"platinum":0}},"hiddenFlag":false,)"
+            R"("lastUpdatedDateTime":"2024-03-{:02}T10:20:30Z"}})",
+            i, i, i, i, i % 100, i % 28 + 1);
+    }
+    body += std::format(R"(],"totalItemCount":{}}})", count);
+    return body;
+}
+
+std::string trophyDefinitions(int count)
+{
+    std::string body = R"({"trophySetVersion":"01.00","hasTrophyGroups":true,"trophies":[)";
+    for (int i = 0; i < count; i++)
+    {
+        if (i)
+            body += ',';
+        body += std::format(
+            R"({{"trophyId":{},"trophyHidden":false,"trophyType":"bronze","trophyName":"Trophy \"{}\"",)"
+            R"("trophyDetail":"Complete objective {} of the synthesized set.\nBonus line.",)"
+            R"("trophyIconUrl":"https://image.api.playstation.com/trophy/np/NPWR00001_00/{}.png",)"
+            R"("trophyGroupId":"default","trophyProgressTargetValue":"{}"}})",
+            i, i, i, i, i % 7 ? 0 : 50);
+    }
+    body += R"(],"totalItemCount":1500})";
+    return body;
+}
+
+std::string cloudCatalog(int count)
+{
+    std::string body = R"({"schemaVersion":2,"total":)" + std::to_string(count) +
+        R"(,"nativeMode":true,"fallbackRegion":"","resolvedStoreLang":"en-US","settledLocale":"en-US","warning":"","games":[)";
+    for (int i = 0; i < count; i++)
+    {
+        if (i)
+            body += ',';
+        body += std::format(
+            R"({{"productId":"UP0000-PPSA{:05}_00-GAME0000000000000","name":"Cloud Game {}",)"
+            R"("imageUrl":"https://image.api.playstation.com/vulcan/ap/rnd/{}/square.png",)"
+            R"("landscapeImageUrl":"https://image.api.playstation.com/vulcan/ap/rnd/{}/landscape.png",)"
+            R"("conceptId":"{}","category":"subscription","serviceType":"PS_PLUS","platform":"PS5",)"
+            R"("isOwned":{},"streamServiceType":"ps5","streamIdentifier":"PPSA{:05}_00",)"
+            R"("entitlementId":"","storeProductId":"","conceptUrl":"","plusCatalog":true}})",
+            i, i, i, i, 10000 + i, i % 3 == 0 ? "true" : "false", i);
+    }
+    body += "]}";
+    return body;
+}
+
+// The tree-walking cloud decoder this change replaced, kept here as the baseline.
+bool legacyParseCatalog(const std::string& json, cloud::Catalog& out)
+{
+    Json doc(json);
+    json_object* root = doc.get();
+    if (!root || !json_object_is_type(root, json_type_object))
+        return false;
+
+    out.schemaVersion = jsonInt(root, "schemaVersion");
+    out.total = jsonInt(root, "total");
+    out.nativeMode = jsonBool(root, "nativeMode");
+    out.games.clear();
+
+    json_object* games = nullptr;
+    if (!jsonField(root, "games", &games) || !json_object_is_type(games, json_type_array))
+        return true;
+
+    size_t count = json_object_array_length(games);
+    out.games.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        json_object* obj = json_object_array_get_idx(games, i);
+        cloud::Game game;
+        game.productId = jsonString(obj, "productId");
+        game.name = jsonString(obj, "name");
+        game.imageUrl = jsonString(obj, "imageUrl");
+        game.landscapeImageUrl = jsonString(obj, "landscapeImageUrl");
+        game.conceptId = jsonString(obj, "conceptId");
+        game.category = jsonString(obj, "category");
+        game.serviceType = jsonString(obj, "serviceType");
+        game.platform = jsonString(obj, "platform");
+        game.isOwned = jsonBool(obj, "isOwned");
+        game.streamServiceType = jsonString(obj, "streamServiceType");
+        game.streamIdentifier = jsonString(obj, "streamIdentifier");
+        game.entitlementId = jsonString(obj, "entitlementId");
+        game.storeProductId = jsonString(obj, "storeProductId");
+        game.conceptUrl = jsonString(obj, "conceptUrl");
+        game.plusCatalog = jsonBool(obj, "plusCatalog");
+        if (!game.productId.empty() && !game.name.empty())
+            out.games.push_back(std::move(game));
+    }
+    return true;
+}
+
+template <typename T, typename Parse>
+std::vector<T> treeRows(const std::string& body, const char* key, Parse parse)
+{
+    std::vector<T> rows;
+    Json doc(body);
+    json_object* array = nullptr;
+    if (!jsonField(doc.get(), key, &array))
+        return rows;
+
+    size_t count = json_object_array_length(array);
+    rows.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        T row;
+        if (parse(json_object_array_get_idx(array, i), row))
+            rows.push_back(std::move(row));
+    }
+    return rows;
+}
+
+template <typename T, typename Parse>
+std::vector<T> streamedRows(const std::string& body, std::string_view key, Parse parse)
+{
+    std::vector<T> rows;
+    JsonReader reader(body);
+    std::string_view name;
+
+    reader.enterObject();
+    while (reader.nextKey(name))
+    {
+        if (name != key)
+        {
+            reader.skip();
+            continue;
+        }
+
+        decodeArray(reader, [&rows, &parse](JsonReader& row) {
+            T value;
+            if (parse(row, value))
+                rows.push_back(std::move(value));
+        });
+    }
+    return rows;
+}
+
+} // namespace
+
+BENCH(decode_title_page)
+{
+    std::string body = titlePage(800);
+
+    auto tree = [](json_object* obj, TrophyTitle& out) { return parseTitle(obj, out); };
+    auto stream = [](JsonReader& reader, TrophyTitle& out) { return parseTitle(reader, out); };
+
+    double before = tests::measure("json-c tree", 50, [&] {
+        return treeRows<TrophyTitle>(body, "trophyTitles", tree);
+    });
+    double after = tests::measure("schema reader", 50, [&] {
+        return streamedRows<TrophyTitle>(body, "trophyTitles", stream);
+    });
+    std::printf("      %.1fx\n", before / after);
+}
+
+BENCH(decode_trophy_definitions)
+{
+    std::string body = trophyDefinitions(1500);
+
+    auto tree = [](json_object* obj, Trophy& out) { return parseTrophyDefinition(obj, out); };
+    auto stream = [](JsonReader& reader, Trophy& out) { return parseTrophyDefinition(reader, out); };
+
+    double before = tests::measure("json-c tree", 50, [&] {
+        return treeRows<Trophy>(body, "trophies", tree);
+    });
+    double after = tests::measure("schema reader", 50, [&] {
+        return streamedRows<Trophy>(body, "trophies", stream);
+    });
+    std::printf("      %.1fx\n", before / after);
+}
+
+BENCH(decode_cloud_catalog)
+{
+    std::string body = cloudCatalog(3000);
+
+    double before = tests::measure("json-c tree", 30, [&] {
+        cloud::Catalog catalog;
+        legacyParseCatalog(body, catalog);
+        return catalog;
+    });
+    double after = tests::measure("schema reader", 30, [&] {
+        cloud::Catalog catalog;
+        cloud::parseCatalog(body, catalog);
+        return catalog;
+    });
+    std::printf("      %.1fx\n", before / after);
+}
+
+BENCH(load_cached_library)
+{
+    std::string body = titlePage(800);
+    std::vector<TrophyTitle> titles;
+    JsonReader reader(body);
+    reader.enterObject();
+    std::string_view key;
+    while (reader.nextKey(key))
+    {
+        if (key != "trophyTitles")
+        {
+            reader.skip();
+            continue;
+        }
+        decodeArray(reader, [&titles](JsonReader& row) {
+            TrophyTitle title;
+            if (parseTitle(row, title))
+                titles.push_back(std::move(title));
+        });
+    }
+
+    json_object* array = json_object_new_array();
+    for (const TrophyTitle& title : titles)
+        json_object_array_add(array, toJson(title));
+    json_object* root = json_object_new_object();
+    json_object_object_add(root, "savedAt", json_object_new_int64(1));
+    json_object_object_add(root, "titles", array);
+    std::string json = json_object_to_json_string(root);
+    json_object_put(root);
+
+    std::string snapshot = encodeSnapshot(titles, 1);
+    std::printf("      json %zu bytes, snapshot %zu bytes\n", json.size(), snapshot.size());
+
+    double before = tests::measure("json document", 50, [&] {
+        std::vector<TrophyTitle> out;
+        int64_t savedAt = 0;
+        parseCachedLibrary(json, out, savedAt);
+        return out;
+    });
+    double after = tests::measure("binary snapshot", 50, [&] {
+        std::vector<TrophyTitle> out;
+        int64_t savedAt = 0;
+        decodeSnapshot(snapshot, out, savedAt);
+        return out;
+    });
+    std::printf("      %.1fx\n", before / after);
+}
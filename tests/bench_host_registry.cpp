@@ -0,0 +1,113 @@
+#include "test_util.hpp"
+
+#include "core/host_registry.hpp"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace akira::discovery;
+
+namespace {
+
+constexpr int RESPONDERS = 400;
+
+struct SavedHost {
+    std::string hostId;
+    std::string hostAddr;
+    int state = 0;
+    bool discovered = false;
+};
+
+std::vector<HostSighting> scanOf(int count)
+{
+    std::vector<HostSighting> scan;
+    for (int i = 0; i < count; i++)
+    {
+        HostSighting host;
+        host.hostId = "HOST" + std::to_string(100000 + i);
+        host.hostName = "PS5-" + std::to_string(i);
+        host.hostAddr = "10.1." + std::to_string(i / 250) + "." + std::to_string(1 + i % 250);
+        host.systemVersion = "09060000";
+        host.protocolVersion = "00030010";
+        host.state = 1;
+        scan.push_back(host);
+    }
+    return scan;
+}
+
+} // namespace
+
+// One discovery tick on a network with 400 consoles answering, none of them changed. The
+// old tick looked up every responder by name (then address) in the saved-host map and
+// rewrote it, then checked every saved host against the list of live IDs.
+BENCH(host_registry_discovery_tick)
+{
+    std::vector<HostSighting> scan = scanOf(RESPONDERS);
+
+    std::map<std::string, std::unique_ptr<SavedHost>> saved;
+    for (const HostSighting& host : scan)
+        saved[host.hostName] = std::make_unique<SavedHost>(SavedHost{host.hostId, host.hostAddr, host.state, true});
+
+    tests::measure("old tick: per-host lookup + nested reconcile", 200, [&] {
+        std::vector<std::string> liveIds;
+        for (const HostSighting& host : scan)
+        {
+            SavedHost* match = nullptr;
+            auto it = saved.find(host.hostName);
+            if (it != saved.end())
+                match = it->second.get();
+            else
+            {
+                for (auto& entry : saved)
+                {
+                    if (entry.second->hostAddr == host.hostAddr)
+                    {
+                        match = entry.second.get();
+                        break;
+                    }
+                }
+            }
+            if (match)
+            {
+                match->state = host.state;
+                match->discovered = true;
+                match->hostAddr = host.hostAddr;
+                match->hostId = host.hostId;
+            }
+            liveIds.push_back(host.hostId);
+        }
+
+        size_t dropped = 0;
+        for (auto& entry : saved)
+        {
+            bool present = false;
+            for (const std::string& id : liveIds)
+            {
+                if (id == entry.second->hostId)
+                {
+                    present = true;
+                    break;
+                }
+            }
+            dropped += !present;
+        }
+        return dropped;
+    });
+
+    HostRegistry registry;
+    registry.applyScan(scan);
+    tests::measure("registry tick, nothing changed", 200, [&] {
+        return registry.applyScan(scan).size();
+    });
+
+    std::vector<HostSighting> flipped = scan;
+    int round = 0;
+    tests::measure("registry tick, 4 changed", 200, [&] {
+        for (int i = 0; i < 4; i++)
+            flipped[(round * 4 + i) % RESPONDERS].state ^= 3;
+        round++;
+        return registry.applyScan(flipped).size();
+    });
+}
@@ -0,0 +1,85 @@
+#include "test_util.hpp"
+
+#include "core/limiter_journal.hpp"
+
+#include <cstdio>
+#include <deque>
+#include <format>
+#include <string>
+
+#include <unistd.h>
+
+// Per-acquire cost of persisting the request budget: the JSON document the limiter used to
+// rewrite on every acquire, against the journal with its block reservations.
+
+namespace {
+
+// What PersistedRateLimiter::persistLocked did before the journal.
+void legacyPersist(const std::string& path, const std::deque<int64_t>& stamps, int64_t now)
+{
+    std::string joined;
+    for (size_t i = 0; i < stamps.size(); i++)
+    {
+        if (i > 0)
+            joined += ",";
+        joined += std::to_string(stamps[i]);
+    }
+
+    std::string body = std::format(
+        "{{\"stamps\":[{}],\"breaker_until\":{},\"last_seen\":{},"
+        "\"throttle_count\":{},\"last_throttle_at\":{}}}\n",
+        joined, 0, now, 0, 0);
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file)
+        return;
+    fwrite(body.data(), 1, body.size(), file);
+    fclose(file);
+}
+
+std::string tempDir()
+{
+    char pattern[] = "/tmp/akira_bench_journal_XXXXXX";
+    return mkdtemp(pattern);
+}
+
+} // namespace
+
+BENCH(limiter_acquire_persistence)
+{
+    std::string dir = tempDir();
+    std::string legacyPath = dir + "/ratelimit.json";
+    std::string journalPath = dir + "/ratelimit.journal";
+
+    for (size_t held : {300u, 2000u})
+    {
+        std::printf("      %zu stamps in the window\n", held);
+
+        std::deque<int64_t> stamps;
+        for (size_t i = 0; i < held; i++)
+            stamps.push_back(1700000000 + static_cast<int64_t>(i));
+
+        int64_t now = 1700100000;
+        double before = tests::measure("json rewrite per acquire", 500, [&] {
+            stamps.pop_front();
+            stamps.push_back(++now);
+            legacyPersist(legacyPath, stamps, now);
+            return now;
+        });
+
+        LimiterJournal journal(journalPath);
+        double after = tests::measure("journal append", 500, [&] {
+            journal.recordAcquire(0, ++now);
+            if (now % 10 == 0)
+                journal.flush();
+            return now;
+        });
+        std::printf("      %.1fx, %zu synced writes for 500 acquires\n", before / after, journal.syncedWrites());
+
+        journal.close();
+        remove(journalPath.c_str());
+    }
+
+    remove(legacyPath.c_str());
+    rmdir(dir.c_str());
+}
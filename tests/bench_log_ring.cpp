@@ -0,0 +1,131 @@
+#include "test_util.hpp"
+
+#include "util/log_ring.hpp"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t LOG_LINES = 300;
+
+// The discovery log before the ring: a locked deque the view copied whole whenever its
+// version counter moved.
+struct LockedLog {
+    std::mutex mutex;
+    std::deque<std::string> lines;
+    std::atomic<uint64_t> version{0};
+
+    void append(const std::string& line)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        lines.push_back(line);
+        while (lines.size() > LOG_LINES)
+            lines.pop_front();
+        version.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::vector<std::string> snapshot()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return std::vector<std::string>(lines.begin(), lines.end());
+    }
+};
+
+std::string sampleLine(int i)
+{
+    return "[discovery] sweep probe 192.168.1." + std::to_string(i % 254 + 1) +
+        " PS5 reply state=standby seq=" + std::to_string(i);
+}
+
+} // namespace
+
+// A full 300-line discovery log with a view refreshing every 300 ms while a handful of
+// new lines arrive per refresh.
+BENCH(log_ring_view_refresh)
+{
+    LockedLog locked;
+    LogRing ring(1024);
+    for (int i = 0; i < int(LOG_LINES); i++)
+    {
+        locked.append(sampleLine(i));
+        ring.push(LogRing::Level::Info, LogRing::Category::Discovery, sampleLine(i));
+    }
+
+    int counter = int(LOG_LINES);
+    tests::measure("mutex deque: append 4, snapshot", 2000, [&] {
+        for (int i = 0; i < 4; i++)
+            locked.append(sampleLine(counter++));
+        return locked.snapshot().size();
+    });
+
+    uint64_t next = ring.head(LogRing::Category::Discovery);
+    std::vector<LogRing::Record> records;
+    tests::measure("ring: append 4, read since", 2000, [&] {
+        for (int i = 0; i < 4; i++)
+            ring.push(LogRing::Level::Info, LogRing::Category::Discovery, sampleLine(counter++));
+        records.clear();
+        next = ring.readSince(next, LogRing::Category::Discovery, records);
+        return records.size();
+    });
+}
+
+// Four threads logging at once, as the discovery, holepunch and session threads do,
+// while the UI thread keeps polling the log.
+BENCH(log_ring_contended_push)
+{
+    constexpr int THREADS = 4;
+    constexpr int PER_THREAD = 5000;
+    const std::string line = sampleLine(7);
+
+    LockedLog locked;
+    tests::measure("mutex deque: 4 threads x 5000 lines, 1 reader", 5, [&] {
+        std::atomic<bool> done{false};
+        std::thread reader([&] {
+            size_t seen = 0;
+            while (!done.load(std::memory_order_acquire))
+                seen += locked.snapshot().size();
+            return seen;
+        });
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; t++)
+            threads.emplace_back([&] {
+                for (int i = 0; i < PER_THREAD; i++)
+                    locked.append(line);
+            });
+        for (auto& thread : threads)
+            thread.join();
+        done.store(true, std::memory_order_release);
+        reader.join();
+        return locked.version.load();
+    });
+
+    LogRing ring(1024);
+    tests::measure("ring: 4 threads x 5000 lines, 1 reader", 5, [&] {
+        std::atomic<bool> done{false};
+        std::thread reader([&] {
+            uint64_t next = ring.head(LogRing::Category::Discovery);
+            std::vector<LogRing::Record> records;
+            while (!done.load(std::memory_order_acquire))
+            {
+                records.clear();
+                next = ring.readSince(next, LogRing::Category::Discovery, records);
+            }
+        });
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; t++)
+            threads.emplace_back([&] {
+                for (int i = 0; i < PER_THREAD; i++)
+                    ring.push(LogRing::Level::Info, LogRing::Category::Discovery, line);
+            });
+        for (auto& thread : threads)
+            thread.join();
+        done.store(true, std::memory_order_release);
+        reader.join();
+        return ring.head(LogRing::Category::Discovery);
+    });
+}
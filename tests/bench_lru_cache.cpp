@@ -0,0 +1,194 @@
+#include "test_util.hpp"
+
+#include "util/lru_cache.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// The workload mirrors the trophy list: a few thousand icon URLs with a skewed access
+// pattern, a byte budget that holds roughly a third of them and the odd discard.
+
+namespace {
+
+struct ImageBytes {
+    size_t operator()(const std::vector<uint8_t>& bytes) const { return bytes.size(); }
+};
+
+constexpr int KEYS = 3000;
+constexpr size_t ICON_BYTES = 4096;
+constexpr size_t BUDGET = KEYS / 3 * ICON_BYTES;
+
+std::vector<std::string> makeKeys()
+{
+    std::vector<std::string> keys;
+    keys.reserve(KEYS);
+    for (int i = 0; i < KEYS; i++)
+        keys.push_back("https://image.api.playstation.com/trophy/np/NPWR" + std::to_string(10000 + i) + "_00/icon.png");
+    return keys;
+}
+
+// Mostly hot keys, with a cold tail that keeps the cache evicting.
+std::vector<int> makeTrace(int length)
+{
+    std::vector<int> trace;
+    trace.reserve(length);
+    uint32_t state = 12345;
+    for (int i = 0; i < length; i++)
+    {
+        state = state * 1103515245u + 12345u;
+        int pick = static_cast<int>((state >> 8) % 100);
+        int key = static_cast<int>((state >> 16) % KEYS);
+        trace.push_back(pick < 80 ? key % (KEYS / 5) : key);
+    }
+    return trace;
+}
+
+// The map, FIFO deque and linear discard TrophyManager used before LruCache.
+struct FifoIconCache {
+    std::unordered_map<std::string, std::vector<uint8_t>> entries;
+    std::deque<std::string> order;
+    size_t bytes = 0;
+
+    bool get(const std::string& key, std::vector<uint8_t>& out)
+    {
+        auto found = entries.find(key);
+        if (found == entries.end())
+            return false;
+        out = found->second;
+        return true;
+    }
+
+    void put(const std::string& key, const std::vector<uint8_t>& value)
+    {
+        if (entries.find(key) == entries.end())
+        {
+            bytes += value.size();
+            entries[key] = value;
+            order.push_back(key);
+        }
+        while (bytes > BUDGET && !order.empty())
+        {
+            std::string oldest = order.front();
+            order.pop_front();
+            if (oldest == key)
+                continue;
+            auto found = entries.find(oldest);
+            if (found != entries.end())
+            {
+                bytes -= found->second.size();
+                entries.erase(found);
+            }
+        }
+    }
+
+    void erase(const std::string& key)
+    {
+        auto found = entries.find(key);
+        if (found != entries.end())
+        {
+            bytes -= found->second.size();
+            entries.erase(found);
+        }
+        auto position = std::find(order.begin(), order.end(), key);
+        if (position != order.end())
+            order.erase(position);
+    }
+};
+
+template <typename Cache>
+size_t replay(Cache& cache, const std::vector<std::string>& keys, const std::vector<int>& trace,
+    const std::vector<uint8_t>& icon)
+{
+    size_t hits = 0;
+    std::vector<uint8_t> out;
+    for (size_t i = 0; i < trace.size(); i++)
+    {
+        const std::string& key = keys[trace[i]];
+        if (cache.get(key, out))
+            hits++;
+        else
+            cache.put(key, icon);
+        if (i % 50 == 0)
+            cache.erase(key);
+    }
+    return hits;
+}
+
+} // namespace
+
+BENCH(icon_cache_replay)
+{
+    std::vector<std::string> keys = makeKeys();
+    std::vector<int> trace = makeTrace(20000);
+    std::vector<uint8_t> icon(ICON_BYTES, 0x5A);
+
+    size_t fifoHits = 0;
+    size_t lruHits = 0;
+
+    double before = tests::measure("fifo map + deque", 5, [&] {
+        FifoIconCache cache;
+        fifoHits = replay(cache, keys, trace, icon);
+        return fifoHits;
+    });
+    double after = tests::measure("LruCache", 5, [&] {
+        akira::LruCache<std::string, std::vector<uint8_t>, ImageBytes> cache(BUDGET);
+        lruHits = replay(cache, keys, trace, icon);
+        return lruHits;
+    });
+    std::printf("      %.1fx, hit rate %.1f%% -> %.1f%%\n", before / after,
+        100.0 * fifoHits / trace.size(), 100.0 * lruHits / trace.size());
+}
+
+BENCH(icon_cache_contention)
+{
+    std::vector<std::string> keys = makeKeys();
+    std::vector<int> trace = makeTrace(20000);
+    std::vector<uint8_t> icon(ICON_BYTES, 0x5A);
+
+    struct Locked {
+        std::mutex mutex;
+        akira::LruCache<std::string, std::vector<uint8_t>, ImageBytes> cache{BUDGET};
+
+        bool get(const std::string& key, std::vector<uint8_t>& out)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return cache.get(key, out);
+        }
+        void put(const std::string& key, const std::vector<uint8_t>& value)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            cache.put(key, value);
+        }
+        void erase(const std::string& key)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            cache.erase(key);
+        }
+    };
+
+    auto hammer = [&](auto& cache) {
+        std::vector<std::thread> threads;
+        size_t hits[4] = {};
+        for (int t = 0; t < 4; t++)
+            threads.emplace_back([&, t] { hits[t] = replay(cache, keys, trace, icon); });
+        for (std::thread& thread : threads)
+            thread.join();
+        return hits[0] + hits[1] + hits[2] + hits[3];
+    };
+
+    double before = tests::measure("single mutex, 4 threads", 3, [&] {
+        Locked cache;
+        return hammer(cache);
+    });
+    double after = tests::measure("8 shards, 4 threads", 3, [&] {
+        akira::ShardedLruCache<std::string, std::vector<uint8_t>, ImageBytes> cache(BUDGET);
+        return hammer(cache);
+    });
+    std::printf("      %.1fx\n", before / after);
+}
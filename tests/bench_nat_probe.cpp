@@ -0,0 +1,117 @@
+#include "test_util.hpp"
+
+#include "core/nat_probe.hpp"
+#include "stun_standin.hpp"
+
+#include <sys/time.h>
+
+#include <vector>
+
+namespace {
+
+constexpr int TIMEOUT_MS = 200;
+constexpr int SERVER_DELAY_MS = 20;
+
+struct Answer {
+    bool valid = false;
+    StunEndpoint mapped;
+    StunEndpoint from;
+};
+
+// One blocking request and wait, as StunClient used to make them.
+Answer ask(int sock, const StunEndpoint& dest, uint8_t change, int attempts)
+{
+    static uint8_t counter = 0;
+    for (int attempt = 0; attempt < attempts; attempt++)
+    {
+        uint8_t id[NatProbe::TRANSACTION_ID_BYTES] = {++counter};
+        std::vector<uint8_t> request = NatProbe::bindingRequest(id, change);
+        sockaddr_in to;
+        std::memset(&to, 0, sizeof(to));
+        to.sin_family = AF_INET;
+        to.sin_addr.s_addr = htonl(dest.addr);
+        to.sin_port = htons(dest.port);
+        sendto(sock, request.data(), request.size(), 0, reinterpret_cast<sockaddr*>(&to), sizeof(to));
+
+        uint8_t buffer[512];
+        sockaddr_in from;
+        socklen_t fromLen = sizeof(from);
+        ssize_t received = recvfrom(sock, buffer, sizeof(buffer), 0,
+            reinterpret_cast<sockaddr*>(&from), &fromLen);
+        if (received <= 0)
+            continue;
+        NatProbe::Binding binding = NatProbe::parseBindingResponse(buffer, size_t(received), id);
+        if (binding.valid)
+            return {true, binding.mapped, {ntohl(from.sin_addr.s_addr), ntohs(from.sin_port)}};
+    }
+    return {};
+}
+
+int blockingSocket()
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    timeval tv{0, TIMEOUT_MS * 1000};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return sock;
+}
+
+// The old detectNATType: two plain servers in turn, then the RFC 5780 list in order
+// until one answers, then the filtering tests against the list in order again.
+FilteringType sequentialDetect(const StunEndpoint& plainA, const StunEndpoint& plainB,
+    const std::vector<StunEndpoint>& rfc5780)
+{
+    int sock = blockingSocket();
+    ask(sock, plainA, 0, 3);
+    ask(sock, plainB, 0, 3);
+    for (const StunEndpoint& server : rfc5780)
+        if (ask(sock, server, 0, 3).valid)
+            break;
+    close(sock);
+
+    FilteringType filtering = FilteringType::Unknown;
+    for (const StunEndpoint& server : rfc5780)
+    {
+        int filterSock = blockingSocket();
+        if (ask(filterSock, server, 0, 1).valid)
+        {
+            Answer changed = ask(filterSock, server, NatProbe::CHANGE_IP | NatProbe::CHANGE_PORT, 1);
+            Answer port = changed.valid ? changed : ask(filterSock, server, NatProbe::CHANGE_PORT, 1);
+            filtering = changed.valid ? FilteringType::EndpointIndependent
+                : port.valid          ? FilteringType::AddressDependent
+                                      : FilteringType::AddressPortDependent;
+        }
+        close(filterSock);
+        if (filtering != FilteringType::Unknown)
+            break;
+    }
+    return filtering;
+}
+
+} // namespace
+
+// A restricted-cone NAT, two plain servers, and an RFC 5780 list whose first entry has
+// gone dead, every live server taking 20 ms to answer and every wait 200 ms.
+BENCH(nat_probe_restricted_cone)
+{
+    sim::SimulatedNat nat(MappingType::EndpointIndependent, FilteringType::AddressDependent);
+    sim::StunStandin plainA(nat, sim::loopback(3), sim::loopback(4),
+        {.rfc5780 = false, .delayMs = SERVER_DELAY_MS});
+    sim::StunStandin plainB(nat, sim::loopback(5), sim::loopback(6),
+        {.rfc5780 = false, .delayMs = SERVER_DELAY_MS});
+    sim::StunStandin dead(nat, sim::loopback(7), sim::loopback(8), {.silent = true});
+    sim::StunStandin live(nat, sim::loopback(1), sim::loopback(2), {.delayMs = SERVER_DELAY_MS});
+
+    tests::measure("sequential: one request at a time", 3, [&] {
+        return sequentialDetect(plainA.target().endpoint, plainB.target().endpoint,
+            {dead.target().endpoint, live.target().endpoint});
+    });
+
+    NatProbe::Config config;
+    config.attemptTimeoutMs = TIMEOUT_MS;
+    config.attempts = 3;
+    NatProbe probe(config);
+    tests::measure("NatProbe: concurrent, settles early", 3, [&] {
+        return probe.run({dead.target(), live.target(), plainA.target(), plainB.target()})
+            .result.filtering;
+    });
+}
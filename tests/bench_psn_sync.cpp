@@ -0,0 +1,42 @@
+#include "test_util.hpp"
+
+#include "psn_simulator.hpp"
+
+#include <cstdio>
+
+using sim::Governor;
+using sim::PsnSimulator;
+
+// Load scenarios against the simulator. Sync time is on the simulated clock, i.e. what a
+// user would wait given PSN latency, burst pacing and the request budget; the us/op line
+// is what the client-side parsing and bookkeeping cost on this machine.
+BENCH(psn_library_sync_load)
+{
+    struct Scenario {
+        const char* label;
+        int titles;
+        int budget;
+        int64_t latencyMs;
+    };
+
+    for (const Scenario& scenario : {
+             Scenario{"1000 titles, unbudgeted", 1000, 1'000'000, 40},
+             Scenario{"1000 titles, 300 per 15 min", 1000, 300, 40},
+             Scenario{"1000 titles, 300 ms latency", 1000, 1'000'000, 300},
+         })
+    {
+        sim::SyncReport report;
+        tests::measure(scenario.label, 3, [&] {
+            PsnSimulator server;
+            server.seedLibrary(scenario.titles);
+            server.latencyMs = scenario.latencyMs;
+            Governor governor(server, scenario.budget);
+            governor.waitForBudget = true;
+            report = sim::syncLibrary(server, governor);
+            return report.requests;
+        });
+
+        std::printf("      %d requests, %.1f min simulated sync time%s\n", report.requests,
+            static_cast<double>(report.elapsedMs) / 60000.0, report.error.ok() ? "" : " (failed)");
+    }
+}
@@ -0,0 +1,96 @@
+#include "test_util.hpp"
+
+#include "util/row_offset_tree.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+constexpr size_t ROWS = 10000;
+constexpr float ESTIMATED_ROW = 120;
+constexpr float ROW_SPACE = 10;
+
+// What RecyclingGrid::getHeightByCellIndex did in flow mode before the tree.
+float walkHeight(const std::vector<float>& cache, size_t index)
+{
+    float res = 0;
+    for (size_t i = 0; i < index && i < cache.size(); i++)
+    {
+        if (cache[i] != -1)
+            res += cache[i] + ROW_SPACE;
+        else
+            res += ESTIMATED_ROW + ROW_SPACE;
+    }
+    return res;
+}
+
+} // namespace
+
+// A 10k-row flow-mode list where every row starts as an estimate (-1) and is measured as
+// it scrolls into view. Each bound cell queries its own offset and each measured cell
+// changes one height; a jump needs the row under an arbitrary scroll position.
+BENCH(row_offsets_10k_rows)
+{
+    std::vector<float> cache(ROWS, -1);
+    std::vector<float> pitches(ROWS, ESTIMATED_ROW + ROW_SPACE);
+    RowOffsetTree tree;
+    tree.assign(pitches);
+
+    uint32_t state = 0x12345678;
+    auto next = [&state] {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    };
+
+    tests::measure("walk: offset of 100 random rows", 100, [&] {
+        double sum = 0;
+        for (int i = 0; i < 100; i++)
+            sum += walkHeight(cache, next() % ROWS);
+        return sum;
+    });
+
+    tests::measure("tree: offset of 100 random rows", 100, [&] {
+        double sum = 0;
+        for (int i = 0; i < 100; i++)
+            sum += tree.offsetOf(next() % ROWS);
+        return sum;
+    });
+
+    tests::measure("tree: measure 100 random rows", 100, [&] {
+        for (int i = 0; i < 100; i++)
+            tree.set(next() % ROWS, float(80 + next() % 200) + ROW_SPACE);
+        return tree.total();
+    });
+
+    // The old way to find a row under a position was to add rows from the top until
+    // the position was passed.
+    tests::measure("walk: row under 100 random positions", 100, [&] {
+        size_t found = 0;
+        for (int i = 0; i < 100; i++)
+        {
+            float position = float(next() % uint32_t(ROWS * (ESTIMATED_ROW + ROW_SPACE)));
+            float y = 0;
+            size_t row = 0;
+            while (row + 1 < ROWS && y + ESTIMATED_ROW + ROW_SPACE <= position)
+                y += (cache[row] != -1 ? cache[row] : ESTIMATED_ROW) + ROW_SPACE, row++;
+            found += row;
+        }
+        return found;
+    });
+
+    tests::measure("tree: row under 100 random positions", 100, [&] {
+        size_t found = 0;
+        for (int i = 0; i < 100; i++)
+            found += tree.rowAt(double(next() % uint32_t(tree.total())));
+        return found;
+    });
+
+    tests::measure("tree: build 10k rows", 100, [&] {
+        RowOffsetTree built;
+        built.assign(pitches);
+        return built.total();
+    });
+}
@@ -0,0 +1,101 @@
+#include "test_util.hpp"
+
+#include "core/discovery_sweep.hpp"
+#include "core/sweep_scheduler.hpp"
+
+#include <arpa/inet.h>
+#include <cstdint>
+#include <cstdio>
+
+using namespace akira::discovery;
+
+namespace {
+
+constexpr int64_t TICK_MS = 250;
+
+uint32_t ipNet(const char* s)
+{
+    struct in_addr ina = {};
+    inet_pton(AF_INET, s, &ina);
+    return ina.s_addr;
+}
+
+// Simulated seconds until the scheduler first probes console, and packets sent by then.
+double secondsToReach(SweepScheduler& scheduler, uint32_t console, size_t& packets)
+{
+    packets = 0;
+    for (int64_t t = 0; t < 60 * 60 * 1000; t += TICK_MS)
+    {
+        for (const SweepProbe& probe : scheduler.next(t))
+        {
+            packets += probe.protocols == SWEEP_BOTH ? 2 : 1;
+            if (probe.addrNet == console)
+                return t / 1000.0;
+        }
+    }
+    return -1;
+}
+
+// The sweep this replaced: 64 addresses of a /24 or narrower every 15 s, both protocols each.
+double legacySecondsToReach(uint32_t hostOffset)
+{
+    return double((hostOffset - 1) / 64) * 15.0;
+}
+
+} // namespace
+
+// Time to first probe of a console, in simulated seconds at 64 packets per 250 ms tick
+// and the default address pacing, then the real cost of a tick.
+BENCH(sweep_scheduler_find_console)
+{
+    size_t packets = 0;
+
+    SweepScheduler lan;
+    lan.addSubnet(ntohl(ipNet("192.168.50.0")), 24);
+    double lanSeconds = secondsToReach(lan, ipNet("192.168.50.231"), packets);
+    std::printf("      /24, console at .231: %.2f s, %zu packets (legacy sweep: %.0f s)\n", lanSeconds, packets,
+        legacySecondsToReach(231));
+
+    SweepScheduler dorm;
+    dorm.addSubnet(ntohl(ipNet("10.20.0.0")), 22);
+    double dormSeconds = secondsToReach(dorm, ipNet("10.20.3.87"), packets);
+    std::printf("      /22, console at 10.20.3.87: %.2f s, %zu packets (legacy sweep: not accepted)\n", dormSeconds,
+        packets);
+
+    SweepScheduler campus;
+    campus.addSubnet(ntohl(ipNet("172.16.0.0")), 16);
+    double campusSeconds = secondsToReach(campus, ipNet("172.16.201.14"), packets);
+    std::printf("      /16, console at 172.16.201.14: %.2f s, %zu packets\n", campusSeconds, packets);
+
+    // A second console in the same /24 as one already found.
+    campus.noteResponse(ipNet("172.16.201.14"), SWEEP_PS5, int64_t(campusSeconds * 1000));
+    SweepScheduler::Stats before = campus.stats();
+    size_t neighbourPackets = 0;
+    double neighbourAt = -1;
+    for (int64_t t = int64_t(campusSeconds * 1000) + TICK_MS; neighbourAt < 0 && t < 60 * 60 * 1000; t += TICK_MS)
+    {
+        for (const SweepProbe& probe : campus.next(t))
+        {
+            neighbourPackets += probe.protocols == SWEEP_BOTH ? 2 : 1;
+            if (probe.addrNet == ipNet("172.16.201.230"))
+                neighbourAt = t / 1000.0 - campusSeconds;
+        }
+    }
+    std::printf("      /16, neighbour at 172.16.201.230 after the first: +%.2f s, %zu packets (%zu still pending)\n",
+        neighbourAt, neighbourPackets, before.pending);
+
+    SweepScheduler ticking;
+    ticking.addSubnet(ntohl(ipNet("172.16.0.0")), 16);
+    int64_t now = 0;
+    tests::measure("next() on a /16, mid-pass", 1000, [&] {
+        now += TICK_MS;
+        return ticking.next(now).size();
+    });
+
+    // Once a pass is done, ticks where nothing is due cost next to nothing.
+    for (now += TICK_MS; ticking.stats().passes == 0; now += TICK_MS)
+        ticking.next(now);
+    tests::measure("next() on a /16, all hosts backed off", 1000, [&] {
+        return ticking.next(now).size();
+    });
+}
@@ -0,0 +1,82 @@
+#include "test_util.hpp"
+
+#include "util/text_layout.hpp"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t LINES = 100;
+constexpr float WIDTH = 560;
+constexpr float HEIGHT = 320;
+
+// Stands in for NanoVG: a per-byte walk, as fonsTextBounds walks glyphs.
+class WalkingMetrics : public GlyphMetrics {
+public:
+    float width(std::string_view text) const override
+    {
+        float width = 0;
+        for (unsigned char c : text)
+            width += 7.5f + float(c & 3);
+        return width;
+    }
+
+    float lineHeight() const override { return 20; }
+};
+
+std::string sampleLine(int i)
+{
+    return "12:00:00." + std::to_string(100 + i % 900) + " [chiaki] holepunch candidate " +
+        std::to_string(i) + " 192.168.1." + std::to_string(i % 254 + 1) +
+        ":9303 answered after " + std::to_string(i * 7 % 300) + " ms, waiting for the console";
+}
+
+} // namespace
+
+// LogPane's 100-line buffer during a stream, drawn every frame. Before the cache every
+// frame wrapped every buffered line (bounds for all, then again for each one drawn);
+// now an idle frame reuses the last layout and a frame with one new line wraps one line.
+BENCH(text_layout_log_pane_frame)
+{
+    WalkingMetrics metrics;
+    std::vector<std::string> lines;
+    for (int i = 0; i < int(LINES); i++)
+        lines.push_back(sampleLine(i));
+
+    tests::measure("uncached: wrap all lines, wrap visible again", 500, [&] {
+        float total = 0;
+        size_t first = lines.size();
+        while (first > 0)
+        {
+            float h = float(wrapText(lines[first - 1], WIDTH, metrics).size()) * metrics.lineHeight();
+            if (total + h > HEIGHT)
+                break;
+            total += h;
+            first--;
+        }
+        for (size_t i = 0; i < lines.size(); i++)
+            total += float(wrapText(lines[i], WIDTH, metrics).size());
+        for (size_t i = first; i < lines.size(); i++)
+            total += float(wrapText(lines[i], WIDTH, metrics).size());
+        return total;
+    });
+
+    TextLayoutCache cache(LINES);
+    for (const auto& line : lines)
+        cache.append(line);
+    cache.setGeometry(WIDTH, 16);
+    cache.layoutTail(HEIGHT, metrics);
+
+    tests::measure("cached: idle frame", 500, [&] {
+        cache.setGeometry(WIDTH, 16);
+        return cache.layoutTail(HEIGHT, metrics).first;
+    });
+
+    int counter = int(LINES);
+    tests::measure("cached: frame with one new line", 500, [&] {
+        cache.append(sampleLine(counter++));
+        cache.setGeometry(WIDTH, 16);
+        return cache.layoutTail(HEIGHT, metrics).first;
+    });
+}
@@ -0,0 +1,104 @@
+#include "test_util.hpp"
+
+#include "util/thumbnail_pipeline.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// A 512x512 trophy icon with a soft alpha edge, the shape PSN serves them in.
+RgbaImage trophyIcon()
+{
+    RgbaImage icon;
+    icon.width = 512;
+    icon.height = 512;
+    icon.pixels.resize(512 * 512 * 4);
+    for (int y = 0; y < 512; y++)
+    {
+        for (int x = 0; x < 512; x++)
+        {
+            uint8_t* p = icon.pixels.data() + (size_t(y) * 512 + x) * 4;
+            p[0] = static_cast<uint8_t>(x);
+            p[1] = static_cast<uint8_t>(y);
+            p[2] = static_cast<uint8_t>(x ^ y);
+            p[3] = x < 8 || y < 8 || x > 503 || y > 503 ? 0 : 255;
+        }
+    }
+    return icon;
+}
+
+} // namespace
+
+// Trophy icons arrive at 512x512 and were handed to setImageFromMem at that size, so the
+// UI thread decoded and uploaded a megabyte of RGBA per icon. The pipeline scales them to
+// the cell on a worker: 96x96 for a trophy row (64 units docked), 495x309 for a card cover.
+BENCH(thumbnail_downscale_512_icon)
+{
+    RgbaImage icon = trophyIcon();
+
+    RgbaImage row = downscalePremultiplied(icon, 96, 96);
+    RgbaImage card = downscalePremultiplied(icon, 495, 309);
+    std::printf("      source %zu bytes, row thumbnail %zu bytes, card thumbnail %zu bytes (%dx%d)\n",
+        icon.bytes(), row.bytes(), card.bytes(), card.width, card.height);
+
+    tests::measure("premultiply only, 512x512", 50, [&] {
+        return downscalePremultiplied(icon, 0, 0).bytes();
+    });
+
+    tests::measure("downscale 512x512 to 96x96", 50, [&] {
+        return downscalePremultiplied(icon, 96, 96).bytes();
+    });
+
+    tests::measure("downscale 512x512 to fill 495x309", 50, [&] {
+        return downscalePremultiplied(icon, 495, 309).bytes();
+    });
+
+    // A screenful of trophy rows through the worker, cold and then from the cache. The
+    // decoder copies raw pixels, so this is the pipeline's own overhead plus the scaling.
+    std::vector<uint8_t> encoded(8);
+    std::memcpy(encoded.data(), &icon.width, 4);
+    std::memcpy(encoded.data() + 4, &icon.height, 4);
+    encoded.insert(encoded.end(), icon.pixels.begin(), icon.pixels.end());
+
+    auto decodeRaw = [](const std::vector<uint8_t>& in, RgbaImage& out) {
+        std::memcpy(&out.width, in.data(), 4);
+        std::memcpy(&out.height, in.data() + 4, 4);
+        out.pixels.assign(in.begin() + 8, in.end());
+        return true;
+    };
+
+    int round = 0;
+    tests::measure("pipeline, 12 cold icons to 96x96", 10, [&] {
+        std::atomic<int> done{0};
+        ThumbnailPipeline pipeline(decodeRaw, [](std::function<void()> task) { task(); }, 4 * 1024 * 1024);
+        for (int i = 0; i < 12; i++)
+            pipeline.request("icon" + std::to_string(round) + "-" + std::to_string(i), encoded, 96, 96,
+                ThumbnailPipeline::Priority::Visible,
+                [&done](const std::string&, const ThumbnailPipeline::Thumbnail&) { done++; });
+        while (done.load() < 12)
+            std::this_thread::yield();
+        round++;
+        return done.load();
+    });
+
+    ThumbnailPipeline warm(decodeRaw, [](std::function<void()> task) { task(); }, 4 * 1024 * 1024);
+    std::atomic<int> done{0};
+    for (int i = 0; i < 12; i++)
+        warm.request("icon" + std::to_string(i), encoded, 96, 96, ThumbnailPipeline::Priority::Visible,
+            [&done](const std::string&, const ThumbnailPipeline::Thumbnail&) { done++; });
+    while (done.load() < 12)
+        std::this_thread::yield();
+
+    tests::measure("pipeline, 12 cached icons", 1000, [&] {
+        int hits = 0;
+        for (int i = 0; i < 12; i++)
+            hits += warm.cached("icon" + std::to_string(i), 96, 96) != nullptr;
+        return hits;
+    });
+}
@@ -0,0 +1,50 @@
+#include "test_util.hpp"
+
+#include "core/console_probe.hpp"
+#include "core/wake_pipeline.hpp"
+#include "console_standin.hpp"
+
+#include <chrono>
+#include <thread>
+
+namespace {
+
+constexpr int DISCOVERY_PING_MS = 500;  // DiscoveryManager's PING_MS
+
+sim::BootingConsole::Options bootFromRest()
+{
+    sim::BootingConsole::Options options;
+    options.silentAfterMs = 300;
+    options.silentForMs = 500;
+    options.bootMs = 1500;
+    return options;
+}
+
+} // namespace
+
+// Time from the wake to the moment a session could start, for a console that boots in
+// 1.5 s and goes quiet for half a second along the way. Before, the host list noticed the
+// console on a discovery ping (the user's reaction time is left out, so this is the best
+// case). The whole difference is the tighter polling.
+BENCH(wake_to_session_start)
+{
+    tests::measure("wake, then discovery pings", 3, [] {
+        sim::BootingConsole console(bootFromRest());
+        ConsoleProbe probe;
+        probe.sendWake("127.0.0.1", console.port(), console.credential(), true);
+        while (probe.query("127.0.0.1", console.port(), true, 50) != ConsoleStatus::Ready)
+            std::this_thread::sleep_for(std::chrono::milliseconds(DISCOVERY_PING_MS - 50));
+        return console.searches();
+    });
+
+    tests::measure("WakePipeline", 3, [] {
+        sim::BootingConsole console(bootFromRest());
+        ConsoleProbe probe;
+        WakePipeline::Ops ops;
+        ops.wake = [&] { return probe.sendWake("127.0.0.1", console.port(), console.credential(), true); };
+        ops.poll = [&](int timeoutMs) { return probe.query("127.0.0.1", console.port(), true, timeoutMs); };
+        WakePipeline::Config config;
+        config.pollTimeoutMs = 50;
+        return WakePipeline(config).run(ops).polls;
+    });
+}
@@ -0,0 +1,72 @@
+#ifndef AKIRA_TEST_CATALOG_FIXTURE_HPP
+#define AKIRA_TEST_CATALOG_FIXTURE_HPP
+
+#include <cstdint>
+#include <string>
+
+#include "cloud/models.hpp"
+
+namespace fixtures {
+
+// A subscription-sized catalog: mixed platforms and categories, titles built from a small
+// vocabulary so searches hit many entries, and every tenth concept listed twice the way the
+// unified payload lists a game's PS4 and PS5 editions.
+inline cloud::Catalog syntheticCatalog(int count)
+{
+    static const char* const WORDS[] = {"Astro", "Gran", "Turismo", "Horizon", "Ratchet", "Clank",
+        "Dreams", "Knack", "Ghost", "Tsushima", "Returnal", "Shadow", "Colossus", "Journey", "Flower",
+        "Killzone", "Infamous", "Resistance", "Uncharted", "Spider", "Sackboy", "Destruction",
+        "AllStars", "Medievil", "Pokémon", "Café", "Öde", "Señor"};
+    constexpr uint32_t WORD_COUNT = sizeof(WORDS) / sizeof(WORDS[0]);
+
+    cloud::Catalog catalog;
+    catalog.schemaVersion = 3;
+    catalog.total = count;
+    catalog.nativeMode = true;
+    catalog.fallbackRegion = "US";
+    catalog.resolvedStoreLang = "en";
+    catalog.settledLocale = "en-US";
+    catalog.games.reserve(count);
+
+    uint32_t state = 2463534242u;
+    for (int i = 0; i < count; i++)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+
+        cloud::Game game;
+        game.productId = "UP9000-PPSA" + std::to_string(10000 + i) + "_00-GAME";
+        game.name = std::string(WORDS[state % WORD_COUNT]) + " " + WORDS[(state >> 8) % WORD_COUNT] + " " +
+            std::to_string(i % 97);
+        game.imageUrl = "https://image.api.playstation.com/vulcan/ap/rnd/" + std::to_string(i) + "/portrait.png";
+        game.landscapeImageUrl = "https://image.api.playstation.com/vulcan/ap/rnd/" + std::to_string(i) + "/wide.png";
+        game.conceptId = std::to_string(200000 + (i % 10 == 9 ? i - 1 : i));
+        game.category = (state >> 16) % 4 == 0 ? "owned" : (state >> 16) % 4 == 1 ? "purchaseable" : "streamable";
+        game.isOwned = game.category == "owned";
+        game.platform = (state >> 20) % 3 == 0 ? "ps4" : (state >> 20) % 3 == 1 ? "ps5" : "ps3";
+        game.serviceType = game.platform == "ps5" ? "pscloud" : "psnow";
+        game.streamServiceType = game.serviceType;
+        game.streamIdentifier = "ENT-" + std::to_string(i);
+        game.entitlementId = game.isOwned ? "ENT-" + std::to_string(i) : "";
+        game.plusCatalog = game.category == "streamable";
+        catalog.games.push_back(std::move(game));
+    }
+
+    return catalog;
+}
+
+// The same catalog as the unified payload chiaki returns, i.e. before deduplication.
+inline std::string catalogPayload(const cloud::Catalog& catalog)
+{
+    int64_t savedAt = 0;
+    std::string snapshot = cloud::serializeCatalogSnapshot(catalog, savedAt);
+
+    // The snapshot wraps the payload object; peel the envelope off.
+    size_t begin = snapshot.find("\"catalog\":");
+    return begin == std::string::npos ? std::string() : snapshot.substr(begin + 10, snapshot.size() - begin - 11);
+}
+
+} // namespace fixtures
+
+#endif // AKIRA_TEST_CATALOG_FIXTURE_HPP
@@ -0,0 +1,133 @@
+#ifndef AKIRA_TESTS_CONSOLE_STANDIN_HPP
+#define AKIRA_TESTS_CONSOLE_STANDIN_HPP
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <string>
+#include <thread>
+
+namespace sim {
+
+// A console in rest mode on a loopback UDP port, answering SRCH the way a PS5 does:
+// "620 Server Standby" until a WAKEUP with its credential arrives, then nothing for a
+// while as it restarts its network, then standby again until it has booted, then
+// "200 Ok". The first dropWakes wake packets are ignored, as if lost on the way.
+class BootingConsole {
+public:
+    struct Options {
+        uint64_t credential = 0x1234abcd;
+        int silentAfterMs = 100;  // after the wake, when it stops answering
+        int silentForMs = 150;
+        int bootMs = 400;         // after the wake, when it is ready
+        int dropWakes = 0;
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    explicit BootingConsole(Options options) : options(options)
+    {
+        fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        socklen_t length = sizeof(addr);
+        getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &length);
+        boundPort = ntohs(addr.sin_port);
+        worker = std::thread([this] { serve(); });
+    }
+
+    ~BootingConsole()
+    {
+        stopping = true;
+        worker.join();
+        close(fd);
+    }
+
+    uint16_t port() const { return boundPort; }
+    uint64_t credential() const { return options.credential; }
+    int wakes() const { return wakeCount.load(); }
+    int searches() const { return searchCount.load(); }
+
+    // When it was ready to answer 200, or the epoch if it has not been woken.
+    Clock::time_point bootedAt() const
+    {
+        Clock::rep woken = wokenAtTicks.load();
+        if (woken == 0)
+            return {};
+        return Clock::time_point(Clock::duration(woken)) + std::chrono::milliseconds(options.bootMs);
+    }
+
+private:
+    Options options;
+    int fd = -1;
+    uint16_t boundPort = 0;
+    std::atomic<bool> stopping{false};
+    std::atomic<int> wakeCount{0};
+    std::atomic<int> searchCount{0};
+    std::atomic<Clock::rep> wokenAtTicks{0};
+    std::thread worker;
+
+    void serve()
+    {
+        while (!stopping)
+        {
+            pollfd pfd{fd, POLLIN, 0};
+            if (poll(&pfd, 1, 10) <= 0)
+                continue;
+
+            char buffer[512] = {};
+            sockaddr_in from;
+            socklen_t fromLen = sizeof(from);
+            ssize_t received = recvfrom(fd, buffer, sizeof(buffer) - 1, 0,
+                reinterpret_cast<sockaddr*>(&from), &fromLen);
+            if (received <= 0)
+                continue;
+
+            std::string request(buffer);
+            if (request.starts_with("WAKEUP "))
+                wake(request);
+            else if (request.starts_with("SRCH "))
+                answer(from, fromLen);
+        }
+    }
+
+    void wake(const std::string& request)
+    {
+        if (request.find(std::format("user-credential:{}\n", options.credential)) == std::string::npos)
+            return;
+        if (wakeCount++ < options.dropWakes || wokenAtTicks.load() != 0)
+            return;
+        wokenAtTicks = Clock::now().time_since_epoch().count();
+    }
+
+    void answer(const sockaddr_in& to, socklen_t toLen)
+    {
+        searchCount++;
+        std::string reply = "HTTP/1.1 620 Server Standby\nhost-type:PS5\n";
+        if (Clock::rep woken = wokenAtTicks.load())
+        {
+            int sinceWakeMs = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                Clock::now() - Clock::time_point(Clock::duration(woken))).count());
+            if (sinceWakeMs >= options.silentAfterMs && sinceWakeMs < options.silentAfterMs + options.silentForMs)
+                return;
+            if (sinceWakeMs >= options.bootMs)
+                reply = "HTTP/1.1 200 Ok\nhost-type:PS5\nhost-request-port:997\n";
+        }
+        sendto(fd, reply.c_str(), reply.size() + 1, 0, reinterpret_cast<const sockaddr*>(&to), toLen);
+    }
+};
+
+} // namespace sim
+
+#endif // AKIRA_TESTS_CONSOLE_STANDIN_HPP
@@ -0,0 +1,463 @@
+#ifndef AKIRA_TESTS_PSN_SIMULATOR_HPP
+#define AKIRA_TESTS_PSN_SIMULATOR_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <format>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "core/rate_limiter.hpp"
+#include "core/request_budget.hpp"
+#include "psn/client.hpp"
+#include "psn/governed_get.hpp"
+
+namespace sim {
+
+// In-process stand-in for the PSN trophy, gamelist and profile APIs. It answers on a
+// virtual millisecond clock, so latency, timeouts and backoff cost no wall time, and
+// serves either recorded fixtures or a generated library of any size.
+class PsnSimulator {
+public:
+    static constexpr const char* ORIGIN = "http://psn.sim";
+
+    struct Response {
+        bool transportFailed = false;
+        std::string error;
+        int status = 200;
+        std::string retryAfter;
+        std::string body;
+    };
+
+    struct Fault {
+        enum class Kind {
+            Latency,
+            Unauthorized,
+            Throttle,
+            Truncate,
+            Timeout,
+            ServerError
+        };
+
+        Kind kind;
+        std::string match;     // substring of the path; empty matches every request
+        int times = 1;         // requests it applies to, or -1 for all of them
+        int64_t value = 0;     // extra latency in ms, Retry-After seconds, or bytes kept
+    };
+
+    int64_t nowMs = 0;
+    int64_t latencyMs = 40;
+    int64_t bytesPerMs = 1000;
+    int64_t timeoutMs = 15000;
+
+    int requests = 0;
+    std::map<int, int> statuses;
+    std::map<std::string, int> perRoute;
+
+    // A library of `titles` trophy sets. Every fourth title has groups; each has
+    // `trophiesPerTitle` trophies, the first third of them earned.
+    void seedLibrary(int titles, int trophiesPerTitle = 20)
+    {
+        libraryTitles = titles;
+        libraryTrophies = trophiesPerTitle;
+    }
+
+    // A recorded response for one exact path and query, checked before the generated library.
+    void serve(const std::string& pathAndQuery, std::string body) { fixtures[pathAndQuery] = std::move(body); }
+
+    void inject(Fault fault) { faults.push_back(std::move(fault)); }
+
+    // Invalidates the current access token; requests carrying it get a 401 until refreshed.
+    void revokeToken() { tokenGeneration++; }
+    std::string currentToken() const { return std::format("token-{}", tokenGeneration); }
+
+    Response handle(const std::string& url, const std::string& token)
+    {
+        requests++;
+
+        size_t api = url.find("/api/");
+        std::string path = api == std::string::npos ? url : url.substr(api);
+        perRoute[routeOf(path)]++;
+
+        nowMs += latencyMs;
+
+        Response response;
+        int64_t keepBytes = -1;
+
+        for (Fault& fault : faults)
+        {
+            if (fault.times == 0 || (!fault.match.empty() && path.find(fault.match) == std::string::npos))
+                continue;
+            if (fault.times > 0)
+                fault.times--;
+
+            switch (fault.kind)
+            {
+                case Fault::Kind::Latency:
+                    nowMs += fault.value;
+                    continue;
+                case Fault::Kind::Timeout:
+                    nowMs += timeoutMs;
+                    response.transportFailed = true;
+                    response.error = "Operation timed out";
+                    response.status = 0;
+                    return finish(response);
+                case Fault::Kind::Unauthorized:
+                    response.status = 401;
+                    return finish(response);
+                case Fault::Kind::Throttle:
+                    response.status = 429;
+                    response.retryAfter = std::to_string(fault.value);
+                    return finish(response);
+                case Fault::Kind::ServerError:
+                    response.status = 503;
+                    return finish(response);
+                case Fault::Kind::Truncate:
+                    keepBytes = fault.value;
+                    continue;
+            }
+        }
+
+        if (token != currentToken())
+        {
+            response.status = 401;
+            return finish(response);
+        }
+
+        if (!route(path, response.body))
+            response.status = 404;
+
+        if (keepBytes >= 0 && static_cast<size_t>(keepBytes) < response.body.size())
+            response.body.resize(static_cast<size_t>(keepBytes));
+
+        nowMs += static_cast<int64_t>(response.body.size()) / std::max<int64_t>(1, bytesPerMs);
+        return finish(response);
+    }
+
+    static std::string titleId(int index) { return std::format("NPWR{:05}_00", index); }
+
+private:
+    Response finish(Response& response)
+    {
+        statuses[response.status]++;
+        return response;
+    }
+
+    static std::string routeOf(const std::string& path)
+    {
+        std::string bare = path.substr(0, path.find('?'));
+        size_t id = bare.find("/NPWR");
+        if (id != std::string::npos)
+            bare.replace(id + 1, bare.find('/', id + 1) - id - 1, "{id}");
+        size_t users = bare.find("/internal/users/");
+        if (users != std::string::npos)
+            bare = bare.substr(0, users) + "/internal/users/{id}/profiles";
+        return bare;
+    }
+
+    static int queryInt(const std::string& path, const char* key, int fallback)
+    {
+        std::string needle = std::string(key) + "=";
+        size_t at = path.find(needle);
+        if (at == std::string::npos)
+            return fallback;
+        return std::atoi(path.c_str() + at + needle.size());
+    }
+
+    static std::string join(const std::vector<std::string>& rows)
+    {
+        std::string joined;
+        for (size_t i = 0; i < rows.size(); i++)
+        {
+            if (i > 0)
+                joined += ",";
+            joined += rows[i];
+        }
+        return joined;
+    }
+
+    static std::string page(const char* arrayKey, const std::vector<std::string>& rows, const std::string& path)
+    {
+        int limit = queryInt(path, "limit", 100);
+        int offset = queryInt(path, "offset", 0);
+        int total = static_cast<int>(rows.size());
+        int end = std::min(total, offset + limit);
+
+        std::vector<std::string> slice;
+        for (int i = offset; i < end; i++)
+            slice.push_back(rows[static_cast<size_t>(i)]);
+
+        std::string body = std::format(R"({{"{}":[{}],"totalItemCount":{})", arrayKey, join(slice), total);
+        if (end < total)
+            body += std::format(R"(,"nextOffset":{})", end);
+        return body + "}";
+    }
+
+    int titleIndex(const std::string& path) const
+    {
+        size_t at = path.find("/NPWR");
+        if (at == std::string::npos)
+            return -1;
+        int index = std::atoi(path.c_str() + at + 5);
+        return index < libraryTitles ? index : -1;
+    }
+
+    bool route(const std::string& path, std::string& body) const
+    {
+        auto fixture = fixtures.find(path);
+        if (fixture != fixtures.end())
+        {
+            body = fixture->second;
+            return true;
+        }
+
+        std::string bare = path.substr(0, path.find('?'));
+        bool progress = bare.find("/users/me/npCommunicationIds/") != std::string::npos;
+
+        if (bare == "/api/trophy/v1/users/me/trophySummary")
+        {
+            body = std::format(R"({{"accountId":"1","trophyLevel":{},"progress":40,"tier":3,)"
+                R"("earnedTrophies":{{"bronze":{},"silver":0,"gold":0,"platinum":0}}}})",
+                100 + libraryTitles / 10, libraryTitles * libraryTrophies / 3);
+            return true;
+        }
+
+        if (bare == "/api/trophy/v1/users/me/trophyTitles")
+        {
+            std::vector<std::string> rows;
+            for (int i = 0; i < libraryTitles; i++)
+            {
+                rows.push_back(std::format(R"({{"npServiceName":"trophy","npCommunicationId":"{}",)"
+                    R"("trophySetVersion":"01.00","trophyTitleName":"Game {}","trophyTitlePlatform":"PS5",)"
+                    R"("hasTrophyGroups":{},"definedTrophies":{{"bronze":{},"silver":0,"gold":0,"platinum":0}},)"
+                    R"("progress":33,"lastUpdatedDateTime":"2024-01-01T00:00:00Z"}})",
+                    titleId(i), i, i % 4 == 0 ? "true" : "false", libraryTrophies));
+            }
+            body = page("trophyTitles", rows, path);
+            return true;
+        }
+
+        if (titleIndex(path) < 0)
+        {
+            if (bare.rfind("/api/gamelist/", 0) == 0)
+            {
+                body = page("titles", {}, path);
+                return true;
+            }
+            return profile(bare, body);
+        }
+
+        if (bare.ends_with("/trophyGroups"))
+        {
+            std::vector<std::string> rows;
+            for (const char* group : {"default", "001"})
+            {
+                rows.push_back(progress
+                    ? std::format(R"({{"trophyGroupId":"{}","progress":33}})", group)
+                    : std::format(R"({{"trophyGroupId":"{}","trophyGroupName":"Group {}"}})", group, group));
+            }
+            body = std::format(R"({{"trophyGroups":[{}]}})", join(rows));
+            return true;
+        }
+
+        if (bare.ends_with("/trophyGroups/all/trophies"))
+        {
+            std::vector<std::string> rows;
+            for (int id = 0; id < libraryTrophies; id++)
+            {
+                rows.push_back(progress
+                    ? std::format(R"({{"trophyId":{},"earned":{}}})", id, id < libraryTrophies / 3 ? "true" : "false")
+                    : std::format(R"({{"trophyId":{},"trophyName":"Trophy {}","trophyType":"bronze"}})", id, id));
+            }
+            body = page("trophies", rows, path);
+            return true;
+        }
+
+        return false;
+    }
+
+    static bool profile(const std::string& bare, std::string& body)
+    {
+        if (bare.rfind("/api/userProfile/", 0) != 0 || !bare.ends_with("/profiles"))
+            return false;
+        body = R"({"onlineId":"simulated","aboutMe":"","isPlus":true,"avatars":[]})";
+        return true;
+    }
+
+    int libraryTitles = 0;
+    int libraryTrophies = 0;
+    int tokenGeneration = 1;
+    std::map<std::string, std::string> fixtures;
+    std::vector<Fault> faults;
+};
+
+// The simulator's side of psn::governedGet: the app's own budget, burst pacing and
+// RetryPolicy loop, with the wire answered by the server and parked steps run on the
+// simulator's clock instead of a timer wheel.
+class Governor : public psn::Wire {
+public:
+    explicit Governor(PsnSimulator& server, int budget = 300, int windowSeconds = 900)
+        : budget(budget, windowSeconds)
+        , server(server)
+        , token(server.currentToken())
+    {
+    }
+
+    // When set, a spent budget is waited out on the virtual clock instead of refused, so a
+    // sync can be timed end to end.
+    bool waitForBudget = false;
+
+    int refreshes = 0;
+    int refused = 0;
+    int retries = 0;
+    int64_t waitedForBudgetMs = 0;
+
+    RequestBudget budget;
+    BurstWindow burst{5, 1000};
+
+    psn::Client client()
+    {
+        return psn::Client([this](const std::string& url, std::string& body) { return get(url, body); },
+            psn::Client::Endpoints::at(PsnSimulator::ORIGIN));
+    }
+
+    // The details of a title fetched the way TrophyManager fetches them. The simulator has
+    // one clock, so the fanned-out requests run one after another.
+    psn::Error fetchDetail(const psn::TrophyTitle& title, psn::TitleDetail& out)
+    {
+        return psn::fetchTitleDetail(title, [this](std::vector<std::function<void(const psn::Client&)>> tasks) {
+            for (auto& task : tasks)
+                task(client());
+        }, out);
+    }
+
+    psn::Error get(const std::string& url, std::string& outBody)
+    {
+        bool finished = false;
+        psn::Error error;
+        psn::governedGet(governance(), *this, url, token, [&](psn::Error result, std::string body) {
+            finished = true;
+            error = std::move(result);
+            outBody = std::move(body);
+        });
+
+        while (!finished && !parked.empty())
+        {
+            std::function<void(psn::Wire&)> resume = std::move(parked.front());
+            parked.pop_front();
+            resume(*this);
+        }
+        return error;
+    }
+
+    psn::Reply get(const std::string& url, const std::string& requestToken, std::string& outBody) override
+    {
+        PsnSimulator::Response response = server.handle(url, requestToken);
+
+        psn::Reply reply;
+        reply.transportFailed = response.transportFailed;
+        reply.status = response.status;
+        reply.retryAfter = response.retryAfter;
+        reply.error = response.error;
+        outBody = std::move(response.body);
+        return reply;
+    }
+
+    psn::Error refreshToken(std::string& outToken) override
+    {
+        refreshes++;
+        server.nowMs += server.latencyMs;
+        token = server.currentToken();
+        outToken = token;
+        return {};
+    }
+
+private:
+    psn::Governance governance()
+    {
+        psn::Governance governance;
+        governance.admit = [this](std::string& outReason) {
+            while (true)
+            {
+                int64_t now = server.nowMs / 1000;
+                RequestBudget::Status status = budget.status(now);
+                if (budget.tryAcquire(now, outReason))
+                    return true;
+                if (!waitForBudget || status.breakerOpen(now))
+                {
+                    refused++;
+                    return false;
+                }
+                int64_t until = std::max(status.bucketResetsAt, now + 1) * 1000;
+                waitedForBudgetMs += until - server.nowMs;
+                server.nowMs = until;
+            }
+        };
+        governance.claimSlot = [this]() {
+            int64_t waitMs = burst.acquire(server.nowMs);
+            slotWait = waitMs > 0;
+            return waitMs;
+        };
+        governance.throttle = [this](int cooldownSeconds) { budget.throttle(server.nowMs / 1000, cooldownSeconds); };
+        governance.park = [this](int64_t delayMs, std::function<void(psn::Wire&)> resume) {
+            // Anything parked other than a burst wait is a retry's backoff.
+            if (!slotWait)
+                retries++;
+            slotWait = false;
+            server.nowMs += delayMs;
+            parked.push_back(std::move(resume));
+        };
+        return governance;
+    }
+
+    PsnSimulator& server;
+    std::string token;
+    bool slotWait = false;
+    std::deque<std::function<void(psn::Wire&)>> parked;
+};
+
+struct SyncReport {
+    psn::Error error;
+    int titles = 0;
+    int details = 0;
+    int requests = 0;
+    int64_t elapsedMs = 0;
+};
+
+// What a full library sync costs: the paged title list, then every title's detail through
+// psn::fetchTitleDetail, the same path TrophyManager takes. Stops at the first failure.
+inline SyncReport syncLibrary(PsnSimulator& server, Governor& governor)
+{
+    SyncReport report;
+    int64_t startedMs = server.nowMs;
+    int startedRequests = server.requests;
+    psn::Client client = governor.client();
+
+    std::vector<psn::TrophyTitle> titles;
+    report.error = client.fetchTitles(titles);
+    report.titles = static_cast<int>(titles.size());
+
+    for (const psn::TrophyTitle& title : titles)
+    {
+        if (!report.error.ok())
+            break;
+
+        psn::TitleDetail detail;
+        report.error = governor.fetchDetail(title, detail);
+        if (report.error.ok())
+            report.details++;
+    }
+
+    report.requests = server.requests - startedRequests;
+    report.elapsedMs = server.nowMs - startedMs;
+    return report;
+}
+
+} // namespace sim
+
+#endif // AKIRA_TESTS_PSN_SIMULATOR_HPP
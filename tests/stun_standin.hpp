@@ -0,0 +1,225 @@
+#ifndef AKIRA_TESTS_STUN_STANDIN_HPP
+#define AKIRA_TESTS_STUN_STANDIN_HPP
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "core/nat_probe.hpp"
+
+namespace sim {
+
+constexpr uint32_t loopback(uint8_t last)
+{
+    return 0x7F000000u | last;
+}
+
+// The NAT between the prober and the stand-in servers. Every stand-in consults the same
+// one, so a client socket keeps one mapping per the configured behaviour across servers,
+// and a reply only gets through if the filtering behaviour lets it: endpoint-independent
+// lets everything in, address-dependent only addresses the socket has sent to, and
+// address-and-port-dependent only exact endpoints.
+class SimulatedNat {
+public:
+    static constexpr uint32_t EXTERNAL_IP = 0xCB007107;  // 203.0.113.7
+
+    SimulatedNat(MappingType mapping, FilteringType filtering)
+        : mapping(mapping), filtering(filtering)
+    {
+    }
+
+    StunEndpoint outbound(uint16_t clientPort, const StunEndpoint& dest)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        contacts.insert({clientPort, dest.addr, dest.port});
+
+        uint32_t addr = mapping == MappingType::EndpointIndependent ? 0 : dest.addr;
+        uint16_t port = mapping == MappingType::AddressPortDependent ? dest.port : 0;
+        auto [it, inserted] = mappings.try_emplace({clientPort, addr, port}, nextPort);
+        if (inserted)
+            nextPort++;
+        return {EXTERNAL_IP, it->second};
+    }
+
+    bool admits(uint16_t clientPort, const StunEndpoint& from)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& [port, addr, destPort] : contacts)
+        {
+            if (port != clientPort)
+                continue;
+            if (filtering == FilteringType::EndpointIndependent)
+                return true;
+            if (addr == from.addr &&
+                (filtering == FilteringType::AddressDependent || destPort == from.port))
+                return true;
+        }
+        return false;
+    }
+
+private:
+    MappingType mapping;
+    FilteringType filtering;
+    std::mutex mutex;
+    std::map<std::tuple<uint16_t, uint32_t, uint16_t>, uint16_t> mappings;
+    std::set<std::tuple<uint16_t, uint32_t, uint16_t>> contacts;
+    uint16_t nextPort = 40000;
+};
+
+// A STUN server on loopback, listening on two addresses times two ports like an RFC 5780
+// server, answering from the address and port a CHANGE-REQUEST asks for, through a
+// SimulatedNat.
+class StunStandin {
+public:
+    struct Options {
+        bool rfc5780 = true;      // advertise OTHER-ADDRESS
+        bool honorChange = true;  // answer CHANGE-REQUEST from the other address/port
+        bool silent = false;      // never answer
+        int delayMs = 0;          // before each answer
+    };
+
+    StunStandin(SimulatedNat& nat, uint32_t primaryIp, uint32_t otherIp, Options options)
+        : nat(nat), options(options)
+    {
+        for (int tries = 0; tries < 20 && !bindAll(primaryIp, otherIp); tries++)
+            closeAll();
+        worker = std::thread([this] { serve(); });
+    }
+
+    ~StunStandin()
+    {
+        stopping = true;
+        worker.join();
+        closeAll();
+    }
+
+    StunTarget target() const
+    {
+        return {endpoints[0].toString(), endpoints[0]};
+    }
+
+    int requests() const { return requestCount.load(); }
+
+private:
+    // 0: primary address and port, 1: primary address, other port,
+    // 2: other address, primary port, 3: other address and port.
+    SimulatedNat& nat;
+    Options options;
+    int fds[4] = {-1, -1, -1, -1};
+    StunEndpoint endpoints[4];
+    std::atomic<bool> stopping{false};
+    std::atomic<int> requestCount{0};
+    std::thread worker;
+
+    bool bindOne(int index, uint32_t ip, uint16_t port)
+    {
+        fds[index] = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(ip);
+        addr.sin_port = htons(port);
+        if (fds[index] < 0 || bind(fds[index], reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+            return false;
+
+        socklen_t length = sizeof(addr);
+        getsockname(fds[index], reinterpret_cast<sockaddr*>(&addr), &length);
+        endpoints[index] = {ip, ntohs(addr.sin_port)};
+        return true;
+    }
+
+    bool bindAll(uint32_t primaryIp, uint32_t otherIp)
+    {
+        return bindOne(0, primaryIp, 0) && bindOne(1, primaryIp, 0) &&
+            bindOne(2, otherIp, endpoints[0].port) && bindOne(3, otherIp, endpoints[1].port);
+    }
+
+    void closeAll()
+    {
+        for (int& fd : fds)
+        {
+            if (fd >= 0)
+                close(fd);
+            fd = -1;
+        }
+    }
+
+    void serve()
+    {
+        while (!stopping)
+        {
+            pollfd polls[4];
+            for (int i = 0; i < 4; i++)
+                polls[i] = {fds[i], POLLIN, 0};
+            if (poll(polls, 4, 10) <= 0)
+                continue;
+            for (int i = 0; i < 4; i++)
+                if (polls[i].revents & POLLIN)
+                    answer(i);
+        }
+    }
+
+    void answer(int index)
+    {
+        uint8_t buffer[512];
+        sockaddr_in from;
+        socklen_t fromLen = sizeof(from);
+        ssize_t received = recvfrom(fds[index], buffer, sizeof(buffer), 0,
+            reinterpret_cast<sockaddr*>(&from), &fromLen);
+        if (received < 20 || buffer[0] != 0x00 || buffer[1] != 0x01)
+            return;
+        requestCount++;
+
+        uint16_t clientPort = ntohs(from.sin_port);
+        StunEndpoint mapped = nat.outbound(clientPort, endpoints[index]);
+        if (options.silent)
+            return;
+
+        uint8_t change = 0;
+        for (size_t offset = 20; offset + 8 <= size_t(received); offset += 4)
+        {
+            if (buffer[offset] == 0x00 && buffer[offset + 1] == 0x03)
+            {
+                change = buffer[offset + 7];
+                break;
+            }
+        }
+
+        int replyFrom = index;
+        if (options.honorChange)
+        {
+            if (change & NatProbe::CHANGE_IP)
+                replyFrom ^= 2;
+            if (change & NatProbe::CHANGE_PORT)
+                replyFrom ^= 1;
+        }
+        if (!nat.admits(clientPort, endpoints[replyFrom]))
+            return;
+
+        if (options.delayMs > 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(options.delayMs));
+
+        std::vector<uint8_t> response = NatProbe::bindingResponse(buffer + 8, mapped,
+            options.rfc5780 ? &endpoints[3] : nullptr);
+        sendto(fds[replyFrom], response.data(), response.size(), 0,
+            reinterpret_cast<sockaddr*>(&from), fromLen);
+    }
+};
+
+} // namespace sim
+
+#endif // AKIRA_TESTS_STUN_STANDIN_HPP
@@ -1,7 +1,10 @@
 #include "test_util.hpp"
 
+#include "catalog_fixture.hpp"
 #include "cloud/models.hpp"
 
+#include <algorithm>
+
 using namespace cloud;
 
 TEST(parse_catalog_reads_the_unified_payload)
@@ -81,3 +84,53 @@ TEST(catalog_warning_and_launch_errors_are_classified)
         == LaunchFailureKind::DatacenterUnavailable);
     CHECK(classifyLaunchFailure("odd failure") == LaunchFailureKind::Other);
 }
+
+TEST(catalog_snapshot_round_trips_without_deduplicating_again)
+{
+    Catalog catalog = fixtures::syntheticCatalog(40);
+    Catalog parsed;
+    CHECK(parseCatalog(fixtures::catalogPayload(catalog), parsed));
+    CHECK_EQ(parsed.games.size(), size_t(36));
+
+    std::string saved = serializeCatalogSnapshot(parsed, 1700000000);
+    Catalog restored;
+    int64_t savedAt = 0;
+    CHECK(parseCatalogSnapshot(saved, restored, savedAt));
+    CHECK_EQ(savedAt, int64_t(1700000000));
+    CHECK(restored == parsed);
+
+    // Accents survive the trip, and a snapshot from another version is not trusted.
+    CHECK(saved.find("Pok\\u00e9mon") != std::string::npos || saved.find("Pokémon") != std::string::npos);
+    std::string other = saved;
+    other.replace(other.find("\"snapshotVersion\":1"), 19, "\"snapshotVersion\":2");
+    CHECK(!parseCatalogSnapshot(other, restored, savedAt));
+    CHECK(!parseCatalogSnapshot(saved.substr(0, saved.size() / 2), restored, savedAt));
+}
+
+TEST(catalog_diff_reports_added_removed_and_changed_games)
+{
+    std::vector<Game> before = fixtures::syntheticCatalog(12).games;
+    std::vector<Game> after = before;
+
+    after.erase(after.begin() + 3);
+    after[5].isOwned = !after[5].isOwned;
+    after[7].name = "Astro Bot";
+    Game added = after[0];
+    added.productId = "EP9000-PPSA99999_00-NEW";
+    after.insert(after.begin() + 2, added);
+
+    CatalogDiff diff = diffCatalogs(before, after);
+    CHECK_EQ(diff.added.size(), size_t(1));
+    CHECK_EQ(diff.added[0].productId, added.productId);
+    CHECK_EQ(diff.removed.size(), size_t(1));
+    CHECK_EQ(diff.removed[0], before[3].productId);
+    CHECK_EQ(diff.changed.size(), size_t(2));
+    CHECK(diffCatalogs(after, after).empty());
+
+    std::vector<Game> patched = before;
+    applyCatalogDiff(patched, diff);
+    auto byId = [](const Game& a, const Game& b) { return a.productId < b.productId; };
+    std::sort(patched.begin(), patched.end(), byId);
+    std::sort(after.begin(), after.end(), byId);
+    CHECK(patched == after);
+}
@@ -0,0 +1,168 @@
+#include "test_util.hpp"
+
+#include "core/connect_prewarm.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+void sleepMs(int ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+bool waitFor(const std::function<bool()>& done, int timeoutMs = 2000)
+{
+    auto deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (!done())
+    {
+        if (Clock::now() > deadline)
+            return false;
+        sleepMs(2);
+    }
+    return true;
+}
+
+// Stages that log their names as they run, sleeping for the given time first.
+struct Recorder {
+    std::mutex mutex;
+    std::vector<std::string> ran;
+    std::atomic<int> discards{0};
+
+    ConnectPrewarm::Stage stage(const std::string& name, int ms = 0, bool ok = true)
+    {
+        return {name, [this, name, ms, ok] {
+            sleepMs(ms);
+            std::lock_guard<std::mutex> lock(mutex);
+            ran.push_back(name);
+            return ok;
+        }};
+    }
+
+    std::function<void()> discard()
+    {
+        return [this] { discards++; };
+    }
+
+    std::vector<std::string> names()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return ran;
+    }
+};
+
+} // namespace
+
+TEST(connect_prewarm_waits_for_focus_to_settle_and_hands_over_timings)
+{
+    ConnectPrewarm::Config config;
+    config.settleMs = 60;
+    ConnectPrewarm prewarm(config);
+    Recorder recorder;
+
+    // Scrolling past: focus leaves before it settles, so nothing runs.
+    prewarm.focus("a", {recorder.stage("upnp")}, recorder.discard());
+    CHECK(prewarm.state("a") == ConnectPrewarm::State::Pending);
+    prewarm.blur("a");
+    CHECK(prewarm.state("a") == ConnectPrewarm::State::Idle);
+    sleepMs(120);
+    CHECK(recorder.names().empty());
+
+    auto focusedAt = Clock::now();
+    prewarm.focus("b", {recorder.stage("token"), recorder.stage("upnp", 20), recorder.stage("nat")},
+        recorder.discard());
+    CHECK(waitFor([&] { return prewarm.state("b") == ConnectPrewarm::State::Warm; }));
+    CHECK(Clock::now() - focusedAt >= std::chrono::milliseconds(config.settleMs));
+    CHECK(recorder.names() == (std::vector<std::string>{"token", "upnp", "nat"}));
+
+    // Losing focus once the run has started keeps the result.
+    prewarm.blur("b");
+    CHECK(prewarm.state("b") == ConnectPrewarm::State::Warm);
+
+    std::optional<std::vector<ConnectPrewarm::Timing>> timings = prewarm.claim("b");
+    CHECK(timings.has_value());
+    CHECK_EQ(timings->size(), size_t(3));
+    CHECK_EQ((*timings)[1].stage, std::string("upnp"));
+    CHECK((*timings)[1].ran && (*timings)[1].ok);
+    CHECK((*timings)[1].durationMs >= 20);
+    CHECK((*timings)[2].startMs >= (*timings)[1].startMs + (*timings)[1].durationMs);
+
+    // Claimed results belong to the connect; they are never discarded, nor claimed twice.
+    CHECK(!prewarm.claim("b"));
+    CHECK(!prewarm.claim("a"));
+    CHECK_EQ(recorder.discards.load(), 0);
+}
+
+TEST(connect_prewarm_expires_and_gives_way_to_the_next_host)
+{
+    ConnectPrewarm::Config config;
+    config.settleMs = 10;
+    config.ttlMs = 80;
+    ConnectPrewarm prewarm(config);
+    Recorder a;
+    Recorder b;
+
+    prewarm.focus("a", {a.stage("upnp")}, a.discard());
+    CHECK(waitFor([&] { return prewarm.state("a") == ConnectPrewarm::State::Warm; }));
+    CHECK(waitFor([&] { return prewarm.state("a") == ConnectPrewarm::State::Idle; }));
+    CHECK_EQ(a.discards.load(), 1);
+    CHECK(!prewarm.claim("a"));
+
+    // A warm host stays warm while another is only being scrolled past, and is discarded
+    // once the other one's run starts.
+    prewarm.focus("a", {a.stage("upnp")}, a.discard());
+    CHECK(waitFor([&] { return prewarm.state("a") == ConnectPrewarm::State::Warm; }));
+    prewarm.focus("b", {b.stage("upnp")}, b.discard());
+    prewarm.blur("b");
+    sleepMs(30);
+    CHECK(prewarm.state("a") == ConnectPrewarm::State::Warm);
+
+    prewarm.focus("b", {b.stage("upnp")}, b.discard());
+    CHECK(waitFor([&] { return prewarm.state("b") == ConnectPrewarm::State::Warm; }));
+    CHECK_EQ(a.discards.load(), 2);
+    CHECK(prewarm.state("a") == ConnectPrewarm::State::Idle);
+
+    // Forgetting a host discards on the caller's thread, before returning.
+    prewarm.forget("b");
+    CHECK_EQ(b.discards.load(), 1);
+    CHECK(prewarm.state("b") == ConnectPrewarm::State::Idle);
+}
+
+TEST(connect_prewarm_claim_mid_run_skips_the_rest)
+{
+    ConnectPrewarm::Config config;
+    config.settleMs = 0;
+    ConnectPrewarm prewarm(config);
+    Recorder recorder;
+
+    prewarm.focus("a", {recorder.stage("session", 60), recorder.stage("upnp"), recorder.stage("nat")},
+        recorder.discard());
+    CHECK(waitFor([&] { return prewarm.state("a") == ConnectPrewarm::State::Running; }));
+
+    // The claim waits for the stage in flight, not for the ones after it.
+    std::optional<std::vector<ConnectPrewarm::Timing>> timings = prewarm.claim("a");
+    CHECK(timings.has_value());
+    CHECK(recorder.names() == (std::vector<std::string>{"session"}));
+    CHECK((*timings)[0].ran);
+    CHECK(!(*timings)[1].ran && !(*timings)[2].ran);
+
+    // A failing stage skips the ones after it, and the result is still claimable.
+    prewarm.focus("b", {recorder.stage("token", 0, false), recorder.stage("upnp")}, recorder.discard());
+    CHECK(waitFor([&] { return prewarm.state("b") == ConnectPrewarm::State::Warm; }));
+    timings = prewarm.claim("b");
+    CHECK(timings.has_value());
+    CHECK((*timings)[0].ran && !(*timings)[0].ok);
+    CHECK(!(*timings)[1].ran);
+    CHECK_EQ(ConnectPrewarm::summary(*timings), std::string("token failed after 0 ms, upnp skipped"));
+    CHECK_EQ(recorder.names().size(), size_t(2));
+    CHECK_EQ(recorder.discards.load(), 0);
+}
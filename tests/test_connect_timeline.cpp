@@ -0,0 +1,226 @@
+#include "test_util.hpp"
+
+#include "core/connect_timeline.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <format>
+#include <future>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+void sleepMs(int ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+ConnectHistory::Attempt attemptWith(const std::string& path, int64_t firstFrameMs)
+{
+    ConnectHistory::Attempt attempt;
+    attempt.path = path;
+    attempt.firstFrameMs = firstFrameMs;
+    return attempt;
+}
+
+std::vector<std::string> stageNames(const ConnectHistory::Attempt& attempt)
+{
+    std::vector<std::string> names;
+    for (const ConnectPrewarm::Timing& stage : attempt.stages)
+        names.push_back(stage.stage);
+    return names;
+}
+
+} // namespace
+
+// Stages open and close by name across threads, in start order, and the first frame files
+// the attempt with whatever was still open closed at that moment.
+TEST(connect_timeline_times_stages_up_to_the_first_frame)
+{
+    ConnectTimeline timeline;
+    timeline.start("ignored");  // nothing is open yet
+    timeline.begin("PS5-1", "lan");
+    timeline.begin("PS5-1", "lan");  // a later view joining the same connect
+
+    {
+        ConnectTimeline::Span session(timeline, "session init");
+        ConnectTimeline::Span decoder(timeline, "decoder init");
+        sleepMs(10);
+        decoder.done();
+        session.done();
+    }
+    timeline.record("wake", ConnectTimeline::nowMs() - 5, 5, true);
+    timeline.start("takion handshake");
+    std::thread([&timeline] {
+        sleepMs(20);
+        timeline.finish("takion handshake");
+        timeline.start("first idr");
+        timeline.start("first idr");  // per-frame callers repeat themselves
+    }).join();
+    timeline.firstFrame();
+    timeline.finish("first idr", false);  // filed already
+
+    CHECK(!timeline.active());
+    std::vector<ConnectHistory::Attempt> attempts = timeline.history().attempts("PS5-1");
+    CHECK_EQ(attempts.size(), size_t(1));
+    const ConnectHistory::Attempt& attempt = attempts[0];
+    CHECK_EQ(attempt.path, std::string("lan"));
+    CHECK(attempt.outcome.empty());
+    CHECK(attempt.firstFrameMs >= 30);
+    CHECK(stageNames(attempt) ==
+          (std::vector<std::string>{"session init", "decoder init", "wake", "takion handshake", "first idr"}));
+    CHECK(attempt.stages[1].durationMs >= 10);
+    CHECK(attempt.stages[3].durationMs >= 20);
+    CHECK(attempt.stages[4].ok);
+    CHECK(timeline.lastSummary().starts_with("First frame: "));
+    CHECK(timeline.lastSummary().find("takion handshake") != std::string::npos);
+}
+
+TEST(connect_timeline_abandons_with_the_reason)
+{
+    ConnectTimeline timeline;
+    timeline.begin("PS5-1", "holepunch");
+    {
+        ConnectTimeline::Span holepunch(timeline, "holepunch");
+        // Left without done(), as when the holepunch throws.
+    }
+    timeline.start("takion handshake");
+    timeline.abandon("Connection refused");
+
+    timeline.begin("PS4-2", "vpn");
+    timeline.begin("PS5-1", "lan");  // another host supersedes the open attempt
+
+    ConnectHistory history = timeline.history();
+    ConnectHistory::Attempt failed = history.attempts("PS5-1")[0];
+    CHECK_EQ(failed.outcome, std::string("Connection refused"));
+    CHECK_EQ(failed.firstFrameMs, int64_t(-1));
+    CHECK(!failed.stages[0].ok);
+    CHECK(!failed.stages[1].ok);
+    CHECK_EQ(history.attempts("PS4-2")[0].outcome, std::string("superseded"));
+    CHECK(timeline.active());
+}
+
+TEST(connect_history_is_bounded_per_host_and_keeps_a_median_per_path)
+{
+    ConnectHistory::Config config;
+    config.maxAttempts = 3;
+    config.maxHosts = 2;
+    ConnectHistory history(config);
+
+    for (int64_t ms : {900, 100, 200, 400})
+        history.add("a", attemptWith("lan", ms));
+    history.add("a", attemptWith("holepunch", 5000));
+    history.add("a", attemptWith("lan", -1));
+    CHECK_EQ(history.attempts("a").size(), size_t(3));
+    CHECK_EQ(history.attempts("a")[0].firstFrameMs, int64_t(400));
+    CHECK_EQ(history.medianFirstFrameMs("a", "lan"), int64_t(400));
+    CHECK_EQ(history.medianFirstFrameMs("a", "holepunch"), int64_t(5000));
+    CHECK_EQ(history.medianFirstFrameMs("a", "vpn"), int64_t(-1));
+
+    history.add("b", attemptWith("lan", 300));
+    history.add("a", attemptWith("lan", 300));
+    history.add("c", attemptWith("lan", 300));  // "b" was connected to least recently
+    CHECK_EQ(history.hostCount(), size_t(2));
+    CHECK(history.attempts("b").empty());
+    CHECK_EQ(history.attempts("a").size(), size_t(3));
+}
+
+TEST(connect_history_round_trips_through_its_json_file)
+{
+    std::string path = std::format("/tmp/akira_connect_history_{}.json", getpid());
+    std::remove(path.c_str());
+
+    {
+        ConnectTimeline timeline(ConnectTimeline::Config{path, {}});
+        timeline.begin("PS5 \"Living room\"", "vpn");
+        timeline.record("wireguard relays", ConnectTimeline::nowMs(), 12, true);
+        timeline.firstFrame();
+    }
+
+    ConnectTimeline reloaded(ConnectTimeline::Config{path, {}});
+    std::vector<ConnectHistory::Attempt> attempts = reloaded.history().attempts("PS5 \"Living room\"");
+    CHECK_EQ(attempts.size(), size_t(1));
+    CHECK_EQ(attempts[0].path, std::string("vpn"));
+    CHECK(attempts[0].startedAtMs > 0);
+    CHECK_EQ(attempts[0].stages[0].stage, std::string("wireguard relays"));
+    CHECK_EQ(attempts[0].stages[0].durationMs, int64_t(12));
+    CHECK(attempts[0].stages[0].ok);
+
+    std::string exported = std::format("{}.export", path);
+    CHECK(reloaded.exportTo(exported));
+    ConnectHistory parsed;
+    FILE* file = fopen(exported.c_str(), "rb");
+    std::string body(4096, '\0');
+    body.resize(fread(body.data(), 1, body.size(), file));
+    fclose(file);
+    CHECK(parsed.parse(body));
+    CHECK_EQ(parsed.attempts("PS5 \"Living room\"").size(), size_t(1));
+
+    CHECK(!parsed.parse("{\"version\": 99, \"hosts\": []}"));
+    CHECK(!parsed.parse("not json"));
+    CHECK_EQ(parsed.hostCount(), size_t(0));
+
+    std::remove(path.c_str());
+    std::remove(exported.c_str());
+}
+
+// A save cut short after the old history was removed leaves only the staged copy, which
+// the next load takes up.
+TEST(connect_history_recovers_a_save_cut_short_before_the_rename)
+{
+    std::string path = std::format("/tmp/akira_connect_staged_{}.json", getpid());
+    std::string staged = path + ".tmp";
+    std::remove(path.c_str());
+    std::remove(staged.c_str());
+
+    {
+        ConnectTimeline timeline(ConnectTimeline::Config{path, {}});
+        timeline.begin("PS5-1", "lan");
+        timeline.firstFrame();
+    }
+    CHECK_EQ(std::rename(path.c_str(), staged.c_str()), 0);
+
+    ConnectTimeline reloaded(ConnectTimeline::Config{path, {}});
+    CHECK_EQ(reloaded.history().attempts("PS5-1").size(), size_t(1));
+    struct stat info;
+    CHECK(stat(path.c_str(), &info) == 0);
+    CHECK(stat(staged.c_str(), &info) != 0);
+
+    std::remove(path.c_str());
+}
+
+// The first frame arrives on the decoder thread, so filing must not touch the SD card there.
+// The history path is a FIFO with no writer: opening it blocks until one shows up, so any
+// load or save done by firstFrame() would hang it.
+TEST(connect_timeline_files_attempts_off_the_calling_thread)
+{
+    std::string path = std::format("/tmp/akira_connect_fifo_{}.json", getpid());
+    std::remove(path.c_str());
+    CHECK_EQ(mkfifo(path.c_str(), 0600), 0);
+
+    {
+        ConnectTimeline timeline(ConnectTimeline::Config{path, {}});
+        timeline.begin("PS5-1", "lan");
+        timeline.record("session init", ConnectTimeline::nowMs(), 3, true);
+
+        std::future<void> filed = std::async(std::launch::async, [&timeline] { timeline.firstFrame(); });
+        CHECK(filed.wait_for(std::chrono::seconds(2)) == std::future_status::ready);
+        CHECK(!timeline.active());
+        CHECK(timeline.lastSummary().starts_with("First frame: "));
+
+        // Let the worker's read through: an empty file, then it saves over the FIFO.
+        int writer = open(path.c_str(), O_WRONLY);
+        close(writer);
+        filed.wait();
+        CHECK_EQ(timeline.history().attempts("PS5-1").size(), size_t(1));
+    }
+
+    struct stat info;
+    CHECK(stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode));
+    std::remove(path.c_str());
+}
@@ -33,7 +33,7 @@ std::string netToStr(uint32_t sAddrNet)
 
 } // namespace
 
-TEST(sweep_parse_accepts_24_to_32)
+TEST(sweep_parse_accepts_16_to_32)
 {
     uint32_t base = 0;
     int prefix = 0;
@@ -55,14 +55,22 @@ TEST(sweep_parse_accepts_24_to_32)
 
     CHECK(parseSweepCidr("10.0.0.200/25", base, prefix));
     CHECK_EQ(base, ipHost("10.0.0.128"));
+
+    CHECK(parseSweepCidr("192.168.51.7/23", base, prefix));
+    CHECK_EQ(base, ipHost("192.168.50.0"));
+    CHECK_EQ(prefix, 23);
+
+    CHECK(parseSweepCidr("172.16.40.9/16", base, prefix));
+    CHECK_EQ(base, ipHost("172.16.0.0"));
+    CHECK_EQ(prefix, 16);
 }
 
 TEST(sweep_parse_rejects_bigger_and_malformed)
 {
     uint32_t base = 0;
     int prefix = 0;
-    CHECK(!parseSweepCidr("192.168.50.0/23", base, prefix));
-    CHECK(!parseSweepCidr("192.168.0.0/16", base, prefix));
+    CHECK(!parseSweepCidr("192.168.0.0/15", base, prefix));
+    CHECK(!parseSweepCidr("10.0.0.0/8", base, prefix));
     CHECK(!parseSweepCidr("192.168.50.0/0", base, prefix));
     CHECK(!parseSweepCidr("192.168.50.0/33", base, prefix));
     CHECK(!parseSweepCidr("192.168.50.99", base, prefix));
@@ -79,7 +87,9 @@ TEST(sweep_is_valid_matches_parse)
     CHECK(isValidSweepCidr("192.168.50.99/32"));
     CHECK(!isValidSweepCidr("192.168.1.5"));
     CHECK(!isValidSweepCidr("10.0.0.0/8"));
-    CHECK(!isValidSweepCidr("192.168.1.0/23"));
+    CHECK(isValidSweepCidr("192.168.0.0/23"));
+    CHECK(isValidSweepCidr("172.16.0.0/16"));
+    CHECK(!isValidSweepCidr("172.16.0.0/12"));
 }
 
 TEST(sweep_normalize)
@@ -0,0 +1,262 @@
+#include "test_util.hpp"
+
+#include "util/dksh_cache.hpp"
+
+#include <cstdio>
+#include <dirent.h>
+#include <fcntl.h>
+#include <format>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// Stands in for uam: the "blob" is the stage and source, and a source containing "error"
+// does not compile.
+struct FakeCompiler {
+    int calls = 0;
+
+    DkshCache::Compiler bind()
+    {
+        return [this](const std::string& source, bool isVertex) {
+            calls++;
+            if (source.find("error") != std::string::npos)
+                return std::vector<uint8_t>();
+            std::string blob = std::string(isVertex ? "vsh:" : "fsh:") + source;
+            return std::vector<uint8_t>(blob.begin(), blob.end());
+        };
+    }
+};
+
+std::string blobText(const std::vector<uint8_t>& blob)
+{
+    return std::string(blob.begin(), blob.end());
+}
+
+std::string freshDir(const std::string& name)
+{
+    std::string dir = std::format("/tmp/akira_dksh_{}_{}", name, getpid());
+    if (DIR* handle = opendir(dir.c_str()))
+    {
+        while (struct dirent* entry = readdir(handle))
+            std::remove((dir + "/" + entry->d_name).c_str());
+        closedir(handle);
+    }
+    rmdir(dir.c_str());
+    return dir;
+}
+
+std::vector<std::string> filesIn(const std::string& dir)
+{
+    std::vector<std::string> names;
+    if (DIR* handle = opendir(dir.c_str()))
+    {
+        while (struct dirent* entry = readdir(handle))
+        {
+            std::string name = entry->d_name;
+            if (name != "." && name != "..")
+                names.push_back(name);
+        }
+        closedir(handle);
+    }
+    return names;
+}
+
+void writeFile(const std::string& path, const std::vector<uint8_t>& bytes)
+{
+    FILE* file = fopen(path.c_str(), "wb");
+    fwrite(bytes.data(), 1, bytes.size(), file);
+    fclose(file);
+}
+
+std::string entryPath(const std::string& dir, const std::string& version, const std::string& source,
+                      const std::string& variant, bool isVertex)
+{
+    return dir + "/" + DkshCache::keyFor(version, source, variant, isVertex) + ".dksh";
+}
+
+} // namespace
+
+// A miss compiles and writes the entry; the next launch reads it back without compiling,
+// and a different source, variant, stage or compiler version is a different entry.
+TEST(dksh_cache_serves_later_launches_from_disk)
+{
+    std::string dir = freshDir("hits");
+    FakeCompiler compiler;
+
+    {
+        DkshCache cache({dir, "uam-1"}, compiler.bind());
+        CHECK_EQ(blobText(cache.get("void main(){}", "", true)), std::string("vsh:void main(){}"));
+        CHECK_EQ(blobText(cache.get("void main(){}", "", true)), std::string("vsh:void main(){}"));
+        CHECK_EQ(compiler.calls, 1);
+        CHECK_EQ(cache.stats().memoryHits, 1);
+        CHECK_EQ(filesIn(dir).size(), size_t(1));
+    }
+
+    DkshCache relaunched({dir, "uam-1"}, compiler.bind());
+    CHECK_EQ(blobText(relaunched.get("void main(){}", "", true)), std::string("vsh:void main(){}"));
+    CHECK_EQ(compiler.calls, 1);
+    CHECK_EQ(relaunched.stats().diskHits, 1);
+
+    relaunched.get("void main(){ }", "", true);
+    relaunched.get("void main(){}", "#define EASU 1\n", true);
+    relaunched.get("void main(){}", "", false);
+    CHECK_EQ(compiler.calls, 4);
+
+    DkshCache updated({dir, "uam-2"}, compiler.bind());
+    updated.get("void main(){}", "", true);
+    CHECK_EQ(compiler.calls, 5);
+    CHECK_EQ(updated.stats().rejected, 0);  // another key, not a bad file
+    CHECK(DkshCache::keyFor("uam-1", "ab", "c", false) != DkshCache::keyFor("uam-1", "a", "bc", false));
+
+    freshDir("hits");
+}
+
+// Files that fail validation are deleted, compiled again and rewritten.
+TEST(dksh_cache_replaces_corrupt_and_mismatched_files)
+{
+    std::string dir = freshDir("corrupt");
+    FakeCompiler compiler;
+    std::string path = entryPath(dir, "uam-1", "src", "", false);
+
+    {
+        DkshCache cache({dir, "uam-1"}, compiler.bind());
+        cache.get("src", "", false);
+    }
+    std::string key = DkshCache::keyFor("uam-1", "src", "", false);
+    std::vector<uint8_t> good = DkshCache::encode(key, "uam-1", {'f', 's', 'h', ':', 's', 'r', 'c'});
+
+    std::vector<uint8_t> flipped = good;
+    flipped.back() ^= 0xff;
+    std::vector<uint8_t> truncated(good.begin(), good.end() - 2);
+    std::vector<uint8_t> padded = good;
+    padded.push_back(0);
+    std::vector<uint8_t> otherKey =
+        DkshCache::encode(DkshCache::keyFor("uam-1", "other", "", false), "uam-1", {'x'});
+    std::vector<uint8_t> blob;
+    CHECK(DkshCache::decode(good, key, "uam-1", blob));
+    CHECK_EQ(blobText(blob), std::string("fsh:src"));
+    CHECK(!DkshCache::decode(good, key, "uam-2", blob));
+
+    int expectedCalls = compiler.calls;
+    for (const std::vector<uint8_t>& bad : {flipped, truncated, padded, otherKey, std::vector<uint8_t>{'A', 'K'}})
+    {
+        writeFile(path, bad);
+        DkshCache cache({dir, "uam-1"}, compiler.bind());
+        CHECK_EQ(blobText(cache.get("src", "", false)), std::string("fsh:src"));
+        CHECK_EQ(compiler.calls, ++expectedCalls);
+        CHECK_EQ(cache.stats().rejected, 1);
+    }
+
+    DkshCache repaired({dir, "uam-1"}, compiler.bind());
+    repaired.get("src", "", false);
+    CHECK_EQ(repaired.stats().diskHits, 1);
+    CHECK_EQ(compiler.calls, expectedCalls);
+
+    freshDir("corrupt");
+}
+
+// A shader that does not compile leaves nothing behind, and an unwritable directory still
+// returns the compiled blob.
+TEST(dksh_cache_survives_compile_and_write_failures)
+{
+    std::string dir = freshDir("failures");
+    FakeCompiler compiler;
+
+    DkshCache cache({dir, "uam-1"}, compiler.bind());
+    CHECK(cache.get("syntax error", "", false).empty());
+    CHECK(cache.get("syntax error", "", false).empty());
+    CHECK_EQ(compiler.calls, 2);  // failures are not cached
+    CHECK(filesIn(dir).empty());
+
+    std::string blocker = freshDir("blocker");
+    writeFile(blocker, {'x'});
+    DkshCache unwritable({blocker + "/shaders", "uam-1"}, compiler.bind());
+    CHECK_EQ(blobText(unwritable.get("src", "", true)), std::string("vsh:src"));
+    CHECK_EQ(unwritable.stats().writeFailures, 1);
+    std::remove(blocker.c_str());
+
+    DkshCache memoryOnly({"", "uam-1"}, compiler.bind());
+    CHECK_EQ(blobText(memoryOnly.get("src", "", true)), std::string("vsh:src"));
+    CHECK_EQ(memoryOnly.stats().writeFailures, 0);
+
+    freshDir("failures");
+}
+
+// prune() clears leftover temporary files, entries from another compiler and unreadable
+// ones, then the oldest written past the cap.
+TEST(dksh_cache_prunes_stale_and_excess_entries)
+{
+    std::string dir = freshDir("prune");
+    FakeCompiler compiler;
+    {
+        DkshCache old({dir, "uam-0"}, compiler.bind());
+        old.get("old", "", false);
+    }
+
+    DkshCache::Config config{dir, "uam-1"};
+    config.maxFiles = 2;
+    DkshCache cache(config, compiler.bind());
+    for (const char* source : {"a", "b", "c"})
+        cache.get(source, "", false);
+    std::string leftover = dir + "/" + std::string(64, '0') + ".dksh.tmp";
+    writeFile(leftover, {'x'});
+    std::string inProgress = dir + "/" + std::string(64, '2') + ".dksh.tmp";
+    writeFile(inProgress, {'x'});
+    writeFile(dir + "/" + std::string(64, '1') + ".dksh", {'x'});
+    writeFile(dir + "/notes.txt", {'x'});
+
+    // mtime has a one second resolution; age "a" so it is the one past the cap.
+    std::string oldest = entryPath(dir, "uam-1", "a", "", false);
+    struct timespec times[2] = {{1000, 0}, {1000, 0}};
+    utimensat(AT_FDCWD, oldest.c_str(), times, 0);
+    utimensat(AT_FDCWD, leftover.c_str(), times, 0);
+
+    CHECK_EQ(cache.prune(), size_t(4));
+    std::vector<std::string> left = filesIn(dir);
+    CHECK_EQ(left.size(), size_t(4));
+    struct stat info;
+    CHECK(stat(oldest.c_str(), &info) != 0);
+    CHECK(stat(entryPath(dir, "uam-1", "b", "", false).c_str(), &info) == 0);
+    CHECK(stat((dir + "/notes.txt").c_str(), &info) == 0);
+    CHECK(stat(inProgress.c_str(), &info) == 0);  // may still be being written
+    CHECK_EQ(cache.prune(), size_t(0));
+
+    std::remove((dir + "/notes.txt").c_str());
+    std::remove(inProgress.c_str());
+    freshDir("prune");
+}
+
+// A disk hit counts as a use, so an entry loaded every stream outlives a newer one-off.
+TEST(dksh_cache_prunes_by_last_use_not_write_time)
+{
+    std::string dir = freshDir("use");
+    FakeCompiler compiler;
+    DkshCache::Config config{dir, "uam-1"};
+    config.maxFiles = 1;
+    {
+        DkshCache cache(config, compiler.bind());
+        cache.get("everyday", "", false);
+        cache.get("oneoff", "", false);
+    }
+
+    std::string everyday = entryPath(dir, "uam-1", "everyday", "", false);
+    std::string oneoff = entryPath(dir, "uam-1", "oneoff", "", false);
+    struct timespec written[2] = {{1000, 0}, {1000, 0}};
+    struct timespec later[2] = {{2000, 0}, {2000, 0}};
+    utimensat(AT_FDCWD, everyday.c_str(), written, 0);
+    utimensat(AT_FDCWD, oneoff.c_str(), later, 0);
+
+    DkshCache relaunched(config, compiler.bind());
+    relaunched.get("everyday", "", false);
+    CHECK_EQ(relaunched.stats().diskHits, 1);
+    CHECK_EQ(relaunched.prune(), size_t(1));
+
+    struct stat info;
+    CHECK(stat(everyday.c_str(), &info) == 0);
+    CHECK(stat(oneoff.c_str(), &info) != 0);
+
+    freshDir("use");
+}
@@ -0,0 +1,71 @@
+#include "test_util.hpp"
+
+#include "util/file_io.hpp"
+
+#include <cstdio>
+#include <format>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+std::string scratchPath(const std::string& name)
+{
+    std::string path = std::format("/tmp/akira_file_io_{}_{}", name, getpid());
+    std::remove(path.c_str());
+    std::remove(akira::fileio::stagingPath(path).c_str());
+    return path;
+}
+
+bool exists(const std::string& path)
+{
+    struct stat info;
+    return stat(path.c_str(), &info) == 0;
+}
+
+} // namespace
+
+TEST(file_io_replaces_and_reads_whole_files)
+{
+    std::string path = scratchPath("replace");
+
+    std::string missing;
+    CHECK(!akira::fileio::readAll(path, missing));
+    CHECK(akira::fileio::readAll(path).empty());
+
+    CHECK(akira::fileio::replace(path, std::string("first")));
+    CHECK(akira::fileio::replace(path, std::string("second, longer")));
+    CHECK_EQ(akira::fileio::readAll(path), std::string("second, longer"));
+    CHECK(!exists(akira::fileio::stagingPath(path)));
+
+    CHECK(akira::fileio::replace(path, std::string()));
+    std::string empty = "stale";
+    CHECK(akira::fileio::readAll(path, empty));
+    CHECK(empty.empty());
+
+    CHECK(!akira::fileio::replace("/tmp/akira_no_such_dir/file", std::string("x")));
+    std::remove(path.c_str());
+}
+
+// A crash between removing the old copy and the rename leaves only the staged one; the
+// next read adopts it rather than finding nothing.
+TEST(file_io_recovers_a_staged_copy_when_the_file_is_gone)
+{
+    std::string path = scratchPath("recover");
+    std::string staged = akira::fileio::stagingPath(path);
+
+    CHECK(akira::fileio::replace(staged, std::string("staged")));
+    CHECK(!exists(path));
+    CHECK_EQ(akira::fileio::readAll(path), std::string("staged"));
+    CHECK(exists(path));
+    CHECK(!exists(staged));
+
+    // With the real file present, a leftover staging file is not taken.
+    CHECK(akira::fileio::replace(staged, std::string("leftover")));
+    CHECK(akira::fileio::recover(path));
+    CHECK_EQ(akira::fileio::readAll(path), std::string("staged"));
+
+    std::remove(staged.c_str());
+    std::remove(path.c_str());
+}
@@ -0,0 +1,179 @@
+#include "test_util.hpp"
+
+#include "core/host_registry.hpp"
+
+#include <string>
+#include <vector>
+
+using namespace akira::discovery;
+
+namespace {
+
+constexpr int STANDBY = 1;
+constexpr int READY = 2;
+
+HostSighting responder(int i)
+{
+    HostSighting host;
+    host.hostId = "HOST" + std::to_string(100000 + i);
+    host.hostName = "PS5-" + std::to_string(i);
+    host.hostAddr = "10.1." + std::to_string(i / 250) + "." + std::to_string(1 + i % 250);
+    host.systemVersion = "09060000";
+    host.protocolVersion = "00030010";
+    host.state = STANDBY;
+    return host;
+}
+
+std::vector<HostSighting> responders(int count)
+{
+    std::vector<HostSighting> scan;
+    for (int i = 0; i < count; i++)
+        scan.push_back(responder(i));
+    return scan;
+}
+
+size_t countOf(const std::vector<HostEvent>& events, HostChange change)
+{
+    size_t n = 0;
+    for (const HostEvent& event : events)
+        n += event.change == change;
+    return n;
+}
+
+} // namespace
+
+TEST(host_registry_diffs_scans_of_hundreds_of_responders)
+{
+    HostRegistry registry;
+    std::vector<HostSighting> scan = responders(600);
+
+    std::vector<HostEvent> first = registry.applyScan(scan);
+    CHECK_EQ(first.size(), size_t(600));
+    CHECK_EQ(countOf(first, HostChange::Appeared), size_t(600));
+    CHECK_EQ(registry.size(), size_t(600));
+    uint64_t settled = registry.generation();
+    CHECK_EQ(settled, uint64_t(600));
+
+    // The same answers again: no events, no generation bump.
+    for (int tick = 0; tick < 5; tick++)
+        CHECK(registry.applyScan(scan).empty());
+    CHECK_EQ(registry.generation(), settled);
+
+    // Reordered answers are the same set.
+    std::vector<HostSighting> reversed(scan.rbegin(), scan.rend());
+    CHECK(registry.applyScan(reversed).empty());
+
+    // A handful wake up; one changes address; fifty stop answering.
+    scan[7].state = READY;
+    scan[300].state = READY;
+    scan[450].hostAddr = "10.1.99.9";
+    std::vector<HostSighting> next(scan.begin(), scan.begin() + 550);
+    std::vector<HostEvent> events = registry.applyScan(next);
+    CHECK_EQ(countOf(events, HostChange::Appeared), size_t(0));
+    CHECK_EQ(countOf(events, HostChange::Changed), size_t(3));
+    CHECK_EQ(countOf(events, HostChange::Vanished), size_t(50));
+    CHECK_EQ(events.size(), size_t(53));
+    CHECK(events[0].change == HostChange::Changed);
+    CHECK(events.back().change == HostChange::Vanished);
+    CHECK_EQ(registry.size(), size_t(550));
+    CHECK_EQ(registry.generation(), settled + 53);
+
+    // Each change carries the generation it was made at.
+    CHECK_EQ(registry.generationOf(scan[7].hostId), events[0].generation);
+    CHECK(registry.generationOf(scan[8].hostId) <= settled);
+    CHECK_EQ(registry.generationOf(scan[599].hostId), uint64_t(0));
+
+    const HostSighting* woke = registry.find(scan[300].hostId);
+    CHECK(woke && woke->state == READY);
+    CHECK(registry.find(scan[599].hostId) == nullptr);
+
+    // A vanished console that answers again appears again.
+    next.push_back(scan[599]);
+    events = registry.applyScan(next);
+    CHECK_EQ(events.size(), size_t(1));
+    CHECK(events[0].change == HostChange::Appeared);
+    CHECK_EQ(events[0].host.hostId, scan[599].hostId);
+
+    // A scan of nothing retires everyone.
+    events = registry.applyScan({});
+    CHECK_EQ(countOf(events, HostChange::Vanished), size_t(551));
+    CHECK_EQ(registry.size(), size_t(0));
+}
+
+TEST(host_registry_indexes_by_address_and_remote_device_id)
+{
+    HostRegistry registry;
+    std::vector<HostSighting> scan = responders(300);
+    registry.applyScan(scan);
+
+    const HostSighting* byAddr = registry.findByAddr("10.1.0.42");
+    CHECK(byAddr && byAddr->hostId == scan[41].hostId);
+    CHECK(registry.findByAddr("10.9.9.9") == nullptr);
+
+    // Two consoles swap addresses in one scan: the index follows both.
+    std::swap(scan[10].hostAddr, scan[20].hostAddr);
+    std::vector<HostEvent> swapped = registry.applyScan(scan);
+    CHECK_EQ(swapped.size(), size_t(2));
+    CHECK_EQ(registry.findByAddr(scan[10].hostAddr)->hostId, scan[10].hostId);
+    CHECK_EQ(registry.findByAddr(scan[20].hostAddr)->hostId, scan[20].hostId);
+
+    // A DHCP move frees the old address.
+    std::string oldAddr = scan[30].hostAddr;
+    scan[30].hostAddr = "10.1.200.1";
+    registry.applyScan(scan);
+    CHECK(registry.findByAddr(oldAddr) == nullptr);
+    CHECK_EQ(registry.findByAddr("10.1.200.1")->hostId, scan[30].hostId);
+
+    std::string duid = std::string(64, 'a');
+    registry.setRemoteDuid(scan[5].hostId, duid);
+    registry.setRemoteDuid("NOT-LIVE", std::string(64, 'b'));
+    CHECK_EQ(registry.findByRemoteDuid(duid)->hostId, scan[5].hostId);
+    CHECK(registry.findByRemoteDuid(std::string(64, 'b')) == nullptr);
+
+    // Relinking moves the index; vanishing drops it.
+    std::string relinked = std::string(64, 'c');
+    registry.setRemoteDuid(scan[5].hostId, relinked);
+    CHECK(registry.findByRemoteDuid(duid) == nullptr);
+    CHECK_EQ(registry.findByRemoteDuid(relinked)->hostId, scan[5].hostId);
+
+    scan.erase(scan.begin() + 5);
+    registry.applyScan(scan);
+    CHECK(registry.findByRemoteDuid(relinked) == nullptr);
+    CHECK(registry.findByAddr("10.1.0.6") == nullptr);
+
+    // A reply without a host ID is tracked by its address.
+    HostSighting anonymous;
+    anonymous.hostName = "Unknown";
+    anonymous.hostAddr = "10.2.0.7";
+    scan.push_back(anonymous);
+    std::vector<HostEvent> events = registry.applyScan(scan);
+    CHECK_EQ(events.size(), size_t(1));
+    CHECK(registry.find("10.2.0.7") != nullptr);
+    CHECK(registry.applyScan(scan).empty());
+}
+
+// A console the user deleted while it still answers is forgotten, so the next scan
+// reports it as Appeared and the host is recreated.
+TEST(host_registry_forgotten_host_reappears_on_the_next_scan)
+{
+    HostRegistry registry;
+    std::vector<HostSighting> scan = responders(3);
+    HostSighting anonymous = responder(7);
+    anonymous.hostId.clear();
+    scan.push_back(anonymous);
+    registry.applyScan(scan);
+    CHECK(registry.applyScan(scan).empty());
+
+    CHECK(registry.forget(scan[1].hostId));
+    CHECK(!registry.forget(scan[1].hostId));
+    CHECK(registry.find(scan[1].hostId) == nullptr);
+    CHECK(registry.findByAddr(scan[1].hostAddr) == nullptr);
+    CHECK(registry.forget("", anonymous.hostAddr));
+    CHECK_EQ(registry.size(), size_t(2));
+
+    std::vector<HostEvent> events = registry.applyScan(scan);
+    CHECK_EQ(events.size(), size_t(2));
+    CHECK_EQ(countOf(events, HostChange::Appeared), size_t(2));
+    CHECK_EQ(events[0].host.hostId, scan[1].hostId);
+    CHECK(registry.applyScan(scan).empty());
+}
@@ -0,0 +1,344 @@
+#include "test_util.hpp"
+
+#include "core/icon_store.hpp"
+
+#include <cstdio>
+#include <atomic>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+struct TempDir {
+    std::string path;
+
+    TempDir()
+    {
+        char pattern[] = "/tmp/akira_icons_XXXXXX";
+        path = mkdtemp(pattern);
+    }
+
+    ~TempDir()
+    {
+        for (const char* name : {"icons.pack", "icons.idx", "icons.idx.tmp", "icons.pack.compact"})
+            remove((path + "/" + name).c_str());
+        rmdir(path.c_str());
+    }
+};
+
+std::vector<uint8_t> image(size_t size, uint8_t seed)
+{
+    std::vector<uint8_t> bytes(size);
+    for (size_t i = 0; i < size; i++)
+        bytes[i] = static_cast<uint8_t>(seed + i * 31);
+    return bytes;
+}
+
+long fileSize(const std::string& path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? static_cast<long>(st.st_size) : -1;
+}
+
+void appendGarbage(const std::string& path, const std::string& bytes)
+{
+    FILE* file = fopen(path.c_str(), "ab");
+    fwrite(bytes.data(), 1, bytes.size(), file);
+    fclose(file);
+}
+
+} // namespace
+
+TEST(icon_store_round_trips_and_survives_a_reopen)
+{
+    TempDir dir;
+
+    {
+        IconStore store(dir.path, 1024 * 1024);
+        CHECK(store.open());
+        CHECK(store.put("https://a/1.png", image(500, 1)));
+        CHECK(store.put("https://a/2.png", image(700, 2)));
+
+        std::vector<uint8_t> out;
+        CHECK(store.get("https://a/1.png", out));
+        CHECK(out == image(500, 1));
+        CHECK(!store.get("https://a/missing.png", out));
+    }
+
+    IconStore reopened(dir.path, 1024 * 1024);
+    CHECK(reopened.open());
+    CHECK_EQ(reopened.stats().entries, size_t(2));
+
+    std::vector<uint8_t> out;
+    CHECK(reopened.get("https://a/2.png", out));
+    CHECK(out == image(700, 2));
+}
+
+TEST(icon_store_replacing_a_key_keeps_the_newest_bytes)
+{
+    TempDir dir;
+    IconStore store(dir.path, 1024 * 1024);
+    CHECK(store.open());
+
+    CHECK(store.put("k", image(100, 1)));
+    CHECK(store.put("k", image(200, 2)));
+
+    std::vector<uint8_t> out;
+    CHECK(store.get("k", out));
+    CHECK(out == image(200, 2));
+    CHECK_EQ(store.stats().entries, size_t(1));
+}
+
+TEST(icon_store_evicts_the_least_recently_used_under_the_cap)
+{
+    TempDir dir;
+    IconStore store(dir.path, 3 * 1100);
+    CHECK(store.open());
+
+    CHECK(store.put("a", image(1000, 1)));
+    CHECK(store.put("b", image(1000, 2)));
+    CHECK(store.put("c", image(1000, 3)));
+
+    std::vector<uint8_t> out;
+    CHECK(store.get("a", out));
+
+    CHECK(store.put("d", image(1000, 4)));
+
+    CHECK(store.get("a", out));
+    CHECK(!store.get("b", out));
+    CHECK(store.get("c", out));
+    CHECK(store.get("d", out));
+    CHECK(store.stats().liveBytes <= size_t(3 * 1100));
+}
+
+TEST(icon_store_erase_is_durable)
+{
+    TempDir dir;
+
+    {
+        IconStore store(dir.path, 1024 * 1024);
+        CHECK(store.open());
+        CHECK(store.put("keep", image(100, 1)));
+        CHECK(store.put("drop", image(100, 2)));
+        CHECK(store.flush());
+        store.erase("drop");
+    }
+
+    IconStore reopened(dir.path, 1024 * 1024);
+    CHECK(reopened.open());
+
+    std::vector<uint8_t> out;
+    CHECK(reopened.get("keep", out));
+    CHECK(!reopened.get("drop", out));
+
+    // Rebuilt from the pack alone, the erased record stays gone too.
+    reopened.close();
+    remove((dir.path + "/icons.idx").c_str());
+    IconStore rebuilt(dir.path, 1024 * 1024);
+    CHECK(rebuilt.open());
+    CHECK(rebuilt.get("keep", out));
+    CHECK(!rebuilt.get("drop", out));
+}
+
+TEST(icon_store_recovers_records_written_after_the_last_index)
+{
+    TempDir dir;
+
+    {
+        IconStore store(dir.path, 1024 * 1024);
+        CHECK(store.open());
+        CHECK(store.put("indexed", image(300, 1)));
+        CHECK(store.flush());
+        CHECK(store.put("unindexed", image(300, 2)));
+
+        // Simulate a crash: the index on disk only knows about the first record.
+        std::string index = dir.path + "/icons.idx";
+        std::string saved = dir.path + "/saved.idx";
+        rename(index.c_str(), saved.c_str());
+        store.close();
+        remove(index.c_str());
+        rename(saved.c_str(), index.c_str());
+    }
+
+    IconStore reopened(dir.path, 1024 * 1024);
+    CHECK(reopened.open());
+    CHECK_EQ(reopened.stats().entries, size_t(2));
+
+    std::vector<uint8_t> out;
+    CHECK(reopened.get("unindexed", out));
+    CHECK(out == image(300, 2));
+}
+
+TEST(icon_store_cuts_off_a_torn_final_record)
+{
+    TempDir dir;
+    std::string pack = dir.path + "/icons.pack";
+
+    {
+        IconStore store(dir.path, 1024 * 1024);
+        CHECK(store.open());
+        CHECK(store.put("whole", image(400, 1)));
+    }
+
+    long intact = fileSize(pack);
+    appendGarbage(pack, std::string("AKIC\x05\x00\x00\x00\xff\x00\x00\x00", 12));
+
+    IconStore reopened(dir.path, 1024 * 1024);
+    CHECK(reopened.open());
+    CHECK_EQ(fileSize(pack), intact);
+
+    std::vector<uint8_t> out;
+    CHECK(reopened.get("whole", out));
+    CHECK(reopened.put("after", image(50, 9)));
+    CHECK(reopened.get("after", out));
+    CHECK(out == image(50, 9));
+}
+
+TEST(icon_store_rebuilds_from_the_pack_when_the_index_is_damaged)
+{
+    TempDir dir;
+    std::string index = dir.path + "/icons.idx";
+
+    {
+        IconStore store(dir.path, 1024 * 1024);
+        CHECK(store.open());
+        CHECK(store.put("one", image(100, 1)));
+        CHECK(store.put("two", image(100, 2)));
+    }
+
+    FILE* file = fopen(index.c_str(), "r+b");
+    fseek(file, 30, SEEK_SET);
+    fputc('X', file);
+    fclose(file);
+
+    IconStore reopened(dir.path, 1024 * 1024);
+    CHECK(reopened.open());
+    CHECK_EQ(reopened.stats().entries, size_t(2));
+
+    std::vector<uint8_t> out;
+    CHECK(reopened.get("two", out));
+    CHECK(out == image(100, 2));
+}
+
+TEST(icon_store_compaction_reclaims_dead_space)
+{
+    TempDir dir;
+    IconStore store(dir.path, 64 * 1024);
+    CHECK(store.open());
+
+    for (int i = 0; i < 80; i++)
+        CHECK(store.put("icon" + std::to_string(i % 10), image(16 * 1024, static_cast<uint8_t>(i))));
+
+    CHECK(store.needsCompaction());
+    size_t before = store.stats().packBytes;
+    CHECK(store.compact());
+
+    IconStore::Stats after = store.stats();
+    CHECK(after.packBytes < before);
+    CHECK_EQ(after.packBytes, after.liveBytes);
+    CHECK(!store.needsCompaction());
+
+    std::vector<uint8_t> out;
+    CHECK(store.get("icon9", out));
+    CHECK(out == image(16 * 1024, 79));
+
+    store.close();
+    IconStore reopened(dir.path, 64 * 1024);
+    CHECK(reopened.open());
+    CHECK_EQ(reopened.stats().entries, after.entries);
+    CHECK(reopened.get("icon9", out));
+    CHECK(out == image(16 * 1024, 79));
+}
+
+// Compaction copies without holding the store, so puts, replacements and erases keep
+// landing while it runs; whatever the interleaving, the result matches the last writes.
+TEST(icon_store_compaction_keeps_writes_made_while_it_copies)
+{
+    TempDir dir;
+    IconStore store(dir.path, 64 * 1024 * 1024);
+    CHECK(store.open());
+
+    for (int round = 0; round < 4; round++)
+    {
+        for (int i = 0; i < 100; i++)
+            CHECK(store.put("icon" + std::to_string(i), image(32 * 1024, static_cast<uint8_t>(round + i))));
+    }
+    CHECK(store.needsCompaction());
+
+    std::atomic<bool> done{false};
+    bool compacted = false;
+    std::thread compactor([&] {
+        compacted = store.compact();
+        done = true;
+    });
+
+    int writes = 0;
+    std::vector<uint8_t> out;
+    do
+    {
+        int i = writes % 50;
+        CHECK(store.put("late" + std::to_string(i), image(1000, static_cast<uint8_t>(writes))));
+        CHECK(store.put("icon" + std::to_string(i), image(2000, static_cast<uint8_t>(writes))));
+        store.erase("icon" + std::to_string(50 + i));
+        CHECK(store.get("icon" + std::to_string(i), out));
+        writes++;
+    } while (!done || writes < 50);
+    compactor.join();
+    CHECK(compacted);
+
+    auto expectLatest = [&](IconStore& check) {
+        for (int i = 0; i < 50; i++)
+        {
+            int last = writes - 1 - ((writes - 1 - i) % 50);
+            std::vector<uint8_t> bytes;
+            CHECK(check.get("late" + std::to_string(i), bytes) && bytes == image(1000, static_cast<uint8_t>(last)));
+            CHECK(check.get("icon" + std::to_string(i), bytes) && bytes == image(2000, static_cast<uint8_t>(last)));
+            CHECK(!check.get("icon" + std::to_string(50 + i), bytes));
+        }
+    };
+    expectLatest(store);
+    CHECK_EQ(store.stats().entries, size_t(100));
+
+    store.close();
+    IconStore reopened(dir.path, 64 * 1024 * 1024);
+    CHECK(reopened.open());
+    expectLatest(reopened);
+
+    // As if the store went down before the compacted pack's index was written: a scan of
+    // the pack alone must not bring back what was erased during the copy.
+    reopened.close();
+    remove((dir.path + "/icons.idx").c_str());
+    IconStore rebuilt(dir.path, 64 * 1024 * 1024);
+    CHECK(rebuilt.open());
+    expectLatest(rebuilt);
+    CHECK_EQ(rebuilt.stats().entries, size_t(100));
+}
+
+TEST(icon_store_finishes_a_compaction_interrupted_before_the_rename)
+{
+    TempDir dir;
+    std::string pack = dir.path + "/icons.pack";
+    std::string compacted = dir.path + "/icons.pack.compact";
+
+    {
+        IconStore store(dir.path, 1024 * 1024);
+        CHECK(store.open());
+        CHECK(store.put("survivor", image(200, 5)));
+    }
+
+    rename(pack.c_str(), compacted.c_str());
+    remove((dir.path + "/icons.idx").c_str());
+
+    IconStore reopened(dir.path, 1024 * 1024);
+    CHECK(reopened.open());
+
+    std::vector<uint8_t> out;
+    CHECK(reopened.get("survivor", out));
+    CHECK(out == image(200, 5));
+    CHECK_EQ(fileSize(compacted), -1L);
+}
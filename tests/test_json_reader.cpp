@@ -0,0 +1,368 @@
+#include "test_util.hpp"
+
+#include "psn/json_reader.hpp"
+#include "psn/models.hpp"
+#include "psn/schema.hpp"
+
+#include <json-c/json.h>
+
+#include <string>
+#include <string_view>
+
+using namespace psn;
+
+namespace {
+
+std::string cachedText(json_object* obj)
+{
+    std::string text = json_object_to_json_string(obj);
+    json_object_put(obj);
+    return text;
+}
+
+// skip() only tracks depth, so walk structurally to exercise the comma and colon checks.
+void walk(JsonReader& reader)
+{
+    std::string_view key;
+
+    switch (reader.peek())
+    {
+        case JsonReader::Kind::Object:
+            reader.enterObject();
+            while (reader.nextKey(key))
+                walk(reader);
+            break;
+        case JsonReader::Kind::Array:
+            reader.enterArray();
+            while (reader.nextElement())
+                walk(reader);
+            break;
+        default:
+            reader.skip();
+            break;
+    }
+}
+
+} // namespace
+
+TEST(reader_walks_nested_objects_and_arrays)
+{
+    JsonReader reader(R"({"a": [1, {"b": "x"}, []], "c": {}, "d": null})");
+
+    std::string_view key;
+    CHECK(reader.enterObject());
+    CHECK(reader.nextKey(key));
+    CHECK_EQ(std::string(key), std::string("a"));
+    CHECK(reader.enterArray());
+    CHECK(reader.nextElement());
+    CHECK_EQ(reader.readInt64(), int64_t(1));
+    CHECK(reader.nextElement());
+    CHECK(reader.skip());
+    CHECK(reader.nextElement());
+    CHECK(reader.enterArray());
+    CHECK(!reader.nextElement());
+    CHECK(!reader.nextElement());
+    CHECK(reader.nextKey(key));
+    CHECK_EQ(std::string(key), std::string("c"));
+    CHECK(reader.skip());
+    CHECK(reader.nextKey(key));
+    CHECK(reader.skipNull());
+    CHECK(!reader.nextKey(key));
+    CHECK(reader.finished());
+    CHECK(!reader.failed());
+}
+
+TEST(reader_returns_views_into_the_body_for_plain_strings)
+{
+    std::string body = R"(["plain", "esc\"apedé"])";
+    JsonReader reader(body);
+
+    std::string_view value;
+    CHECK(reader.enterArray());
+    CHECK(reader.nextElement());
+    CHECK(reader.readString(value));
+    CHECK_EQ(std::string(value), std::string("plain"));
+    CHECK(value.data() >= body.data() && value.data() < body.data() + body.size());
+
+    CHECK(reader.nextElement());
+    CHECK(reader.readString(value));
+    CHECK_EQ(std::string(value), std::string("esc\"aped\xc3\xa9"));
+}
+
+TEST(reader_decodes_surrogate_pairs)
+{
+    JsonReader reader(R"("🏆")");
+
+    std::string_view value;
+    CHECK(reader.readString(value));
+    CHECK_EQ(std::string(value), std::string("\xf0\x9f\x8f\x86"));
+}
+
+TEST(reader_latches_failure_on_malformed_input)
+{
+    const char* broken[] = {
+        R"({"a": 1)",
+        R"({"a" 1})",
+        R"({"a": 1,, "b": 2})",
+        R"({"a": 1 "b": 2})",
+        R"(["unterminated)",
+        R"({"a": tru})",
+        R"({"a": -})",
+    };
+
+    for (const char* text : broken)
+    {
+        JsonReader reader(text);
+        walk(reader);
+        CHECK(reader.failed() || !reader.finished());
+    }
+}
+
+TEST(reader_numbers_follow_the_json_c_coercions)
+{
+    JsonReader reader(R"([165, "165", "4294967296", "abc", 12.9, true, "0.4", 9223372036854775808])");
+
+    CHECK(reader.enterArray());
+    CHECK(reader.nextElement());
+    CHECK_EQ(reader.readInt64(), int64_t(165));
+    CHECK(reader.nextElement());
+    CHECK_EQ(reader.readInt64(), int64_t(165));
+    CHECK(reader.nextElement());
+    CHECK_EQ(reader.readInt64(), int64_t(4294967296LL));
+    CHECK(reader.nextElement());
+    CHECK_EQ(reader.readInt64(), int64_t(0));
+    CHECK(reader.nextElement());
+    CHECK_EQ(reader.readInt64(), int64_t(12));
+    CHECK(reader.nextElement());
+    CHECK_EQ(reader.readInt64(), int64_t(1));
+    CHECK(reader.nextElement());
+    double rate = reader.readDouble();
+    CHECK(rate > 0.39 && rate < 0.41);
+    CHECK(reader.nextElement());
+    CHECK_EQ(reader.readInt64(), INT64_MAX);
+    CHECK(!reader.nextElement());
+    CHECK(!reader.failed());
+}
+
+TEST(schema_title_matches_the_json_c_decoder)
+{
+    const char* row = R"({
+        "npServiceName": "trophy2",
+        "npCommunicationId": "NPWR12345_00",
+        "trophySetVersion": "01.03",
+        "trophyTitleName": " Some Game\n",
+        "trophyTitleDetail": "A\tgame",
+        "trophyTitleIconUrl": "https://image.api.playstation.com/x.png",
+        "trophyTitlePlatform": "PS5,PSPC",
+        "hasTrophyGroups": true,
+        "trophyGroupCount": 4,
+        "definedTrophies": {"bronze": 30, "silver": 8, "gold": 3, "platinum": 1},
+        "progress": 25,
+        "earnedTrophies": {"bronze": 12, "silver": 2, "gold": 0, "platinum": 0},
+        "hiddenFlag": false,
+        "lastUpdatedDateTime": "2024-01-15T10:20:30Z",
+        "unknownField": {"nested": [1, 2, 3]}
+    })";
+
+    Json doc(row);
+    TrophyTitle expected;
+    CHECK(parseTitle(doc.get(), expected));
+
+    JsonReader reader(row);
+    TrophyTitle actual;
+    CHECK(parseTitle(reader, actual));
+    CHECK(reader.finished());
+
+    CHECK_EQ(actual.npCommunicationId, expected.npCommunicationId);
+    CHECK_EQ(actual.trophyTitleName, std::string("Some Game"));
+    CHECK_EQ(actual.trophyTitleName, expected.trophyTitleName);
+    CHECK_EQ(actual.trophyTitleDetail, expected.trophyTitleDetail);
+    CHECK_EQ(actual.trophyTitlePlatform, expected.trophyTitlePlatform);
+    CHECK_EQ(actual.hasTrophyGroups, expected.hasTrophyGroups);
+    CHECK_EQ(actual.trophyGroupCount, expected.trophyGroupCount);
+    CHECK_EQ(actual.definedTrophies.total(), expected.definedTrophies.total());
+    CHECK_EQ(actual.earnedTrophies.bronze, expected.earnedTrophies.bronze);
+    CHECK_EQ(actual.progress, expected.progress);
+    CHECK_EQ(actual.lastUpdatedDateTime, expected.lastUpdatedDateTime);
+}
+
+TEST(schema_title_without_an_id_is_rejected_but_consumed)
+{
+    JsonReader reader(R"([{"trophyTitleName": "Broken"}, {"npCommunicationId": "NPWR1_00"}])");
+
+    TrophyTitle title;
+    CHECK(reader.enterArray());
+    CHECK(reader.nextElement());
+    CHECK(!parseTitle(reader, title));
+    CHECK(reader.nextElement());
+    CHECK(parseTitle(reader, title));
+    CHECK_EQ(title.npCommunicationId, std::string("NPWR1_00"));
+}
+
+TEST(schema_trophy_definition_needs_the_id_field_even_when_zero)
+{
+    JsonReader present(R"({"trophyId": 0, "trophyName": "First", "trophyProgressTargetValue": "50"})");
+    Trophy trophy;
+    CHECK(parseTrophyDefinition(present, trophy));
+    CHECK_EQ(trophy.trophyId, 0);
+    CHECK_EQ(trophy.hasProgress, true);
+    CHECK_EQ(trophy.progressTarget, int64_t(50));
+
+    JsonReader missing(R"({"trophyName": "No id"})");
+    CHECK(!parseTrophyDefinition(missing, trophy));
+
+    JsonReader nulled(R"({"trophyId": null})");
+    CHECK(!parseTrophyDefinition(nulled, trophy));
+}
+
+TEST(schema_trophy_progress_matches_the_json_c_decoder)
+{
+    const char* rows[] = {
+        R"({"trophyId": 7, "trophyHidden": false, "earned": true, "earnedDateTime": "2024-02-01T00:00:00Z",
+            "progress": "12", "progressRate": 40, "progressedDateTime": "2024-01-30T00:00:00Z",
+            "trophyType": "gold", "trophyRare": 1, "trophyEarnedRate": "3.2"})",
+        R"({"trophyId": 4, "earned": false, "trophyRare": 3, "trophyEarnedRate": "88.1", "trophyType": "bronze"})",
+        R"({"trophyId": 9, "progressRate": 80})",
+    };
+
+    for (const char* row : rows)
+    {
+        Json doc(row);
+        Trophy expected;
+        CHECK(parseTrophyProgress(doc.get(), expected));
+
+        JsonReader reader(row);
+        Trophy actual;
+        CHECK(parseTrophyProgress(reader, actual));
+
+        CHECK_EQ(actual.trophyId, expected.trophyId);
+        CHECK_EQ(actual.earned, expected.earned);
+        CHECK_EQ(actual.earnedDateTime, expected.earnedDateTime);
+        CHECK_EQ(actual.hasProgress, expected.hasProgress);
+        CHECK_EQ(actual.progress, expected.progress);
+        CHECK_EQ(actual.progressRate, expected.progressRate);
+        CHECK_EQ(actual.trophyRare, expected.trophyRare);
+        CHECK_EQ(actual.trophyEarnedRate, expected.trophyEarnedRate);
+        CHECK_EQ(actual.trophyType, expected.trophyType);
+    }
+}
+
+TEST(schema_played_game_prefers_localized_fields_in_either_order)
+{
+    const char* rows[] = {
+        R"({"titleId": "CUSA1_00", "name": "Plain", "localizedName": "Localised", "playDuration": "PT2H"})",
+        R"({"titleId": "CUSA1_00", "localizedName": "Localised", "name": "Plain", "playDuration": "PT2H"})",
+        R"({"titleId": "CUSA1_00", "localizedName": "  ", "name": "Localised", "playDuration": "PT2H"})",
+    };
+
+    for (const char* row : rows)
+    {
+        JsonReader reader(row);
+        PlayedGame game;
+        CHECK(parsePlayedGame(reader, game));
+        CHECK_EQ(game.name, std::string("Localised"));
+        CHECK_EQ(game.playDurationSeconds, int64_t(7200));
+    }
+}
+
+TEST(schema_profile_reads_avatars)
+{
+    JsonReader reader(R"({"onlineId": "Hakoom", "isPlus": true,
+        "avatars": [{"size": "s", "url": "http://a/s.png"}, {"size": "xl", "url": ""}, {"size": "l", "url": "http://a/l.png"}]})");
+
+    PsnProfile profile;
+    CHECK(parseProfile(reader, profile));
+    CHECK_EQ(profile.isPlus, true);
+    CHECK_EQ(profile.avatars.size(), size_t(2));
+    CHECK_EQ(profile.avatarUrl(), std::string("http://a/l.png"));
+}
+
+TEST(cached_detail_document_round_trips_through_to_json)
+{
+    Trophy trophy;
+    trophy.trophyId = 3;
+    trophy.trophyName = "Speedrunner";
+    trophy.trophyType = "gold";
+    trophy.trophyGroupId = "default";
+    trophy.earned = true;
+    trophy.trophyRare = 1;
+    trophy.trophyEarnedRate = 4.5;
+    trophy.hasProgress = true;
+    trophy.progress = 7;
+    trophy.progressTarget = 10;
+    trophy.progressRate = 70;
+
+    TrophyGroup group;
+    group.trophyGroupId = "default";
+    group.trophyGroupName = "Base";
+    group.definedTrophies.gold = 1;
+    group.earnedTrophies.gold = 1;
+    group.progress = 100;
+
+    json_object* root = json_object_new_object();
+    json_object_object_add(root, "savedAt", json_object_new_int64(1700000000));
+    json_object_object_add(root, "npCommunicationId", json_object_new_string("NPWR1_00"));
+    json_object_object_add(root, "npServiceName", json_object_new_string("trophy2"));
+    json_object_object_add(root, "lastUpdatedDateTime", json_object_new_string("2024-01-01T00:00:00Z"));
+    json_object* groups = json_object_new_array();
+    json_object_array_add(groups, toJson(group));
+    json_object_object_add(root, "groups", groups);
+    json_object* trophies = json_object_new_array();
+    json_object_array_add(trophies, toJson(trophy));
+    json_object_object_add(root, "trophies", trophies);
+
+    TitleDetail detail;
+    int64_t savedAt = 0;
+    CHECK(parseCachedDetail(cachedText(root), detail, savedAt));
+    CHECK_EQ(savedAt, int64_t(1700000000));
+    CHECK_EQ(detail.npCommunicationId, std::string("NPWR1_00"));
+    CHECK_EQ(detail.groups.size(), size_t(1));
+    CHECK_EQ(detail.groups[0].earnedTrophies.gold, 1);
+    CHECK_EQ(detail.trophies.size(), size_t(1));
+    CHECK_EQ(detail.trophies[0].trophyName, std::string("Speedrunner"));
+    CHECK_EQ(detail.trophies[0].progress, int64_t(7));
+    CHECK_EQ(detail.trophies[0].progressTarget, int64_t(10));
+    CHECK_EQ(detail.trophies[0].trophyRare, 1);
+}
+
+TEST(cached_detail_without_trophies_is_a_miss)
+{
+    TitleDetail detail;
+    int64_t savedAt = 0;
+    CHECK(!parseCachedDetail(R"({"savedAt": 1, "npCommunicationId": "NPWR1_00", "trophies": []})", detail, savedAt));
+    CHECK(!parseCachedDetail(R"({"savedAt": 1, "npCommunicationId": "NPWR1_00"})", detail, savedAt));
+    CHECK(!parseCachedDetail("", detail, savedAt));
+}
+
+TEST(cached_library_and_summary_documents_parse)
+{
+    TrophyTitle title;
+    title.npCommunicationId = "NPWR2_00";
+    title.trophyTitleName = "Cached";
+
+    json_object* titles = json_object_new_array();
+    json_object_array_add(titles, toJson(title));
+    json_object* library = json_object_new_object();
+    json_object_object_add(library, "savedAt", json_object_new_int64(42));
+    json_object_object_add(library, "titles", titles);
+
+    std::vector<TrophyTitle> parsed;
+    int64_t savedAt = 0;
+    CHECK(parseCachedLibrary(cachedText(library), parsed, savedAt));
+    CHECK_EQ(savedAt, int64_t(42));
+    CHECK_EQ(parsed.size(), size_t(1));
+    CHECK_EQ(parsed[0].trophyTitleName, std::string("Cached"));
+
+    TrophySummary summary;
+    summary.trophyLevel = 328;
+    json_object* wrapper = json_object_new_object();
+    json_object_object_add(wrapper, "savedAt", json_object_new_int64(43));
+    json_object_object_add(wrapper, "summary", toJson(summary));
+
+    TrophySummary parsedSummary;
+    CHECK(parseCachedSummary(cachedText(wrapper), parsedSummary, savedAt));
+    CHECK_EQ(savedAt, int64_t(43));
+    CHECK_EQ(parsedSummary.trophyLevel, 328);
+
+    CHECK(!parseCachedSummary(R"({"savedAt": 43})", parsedSummary, savedAt));
+}
@@ -0,0 +1,343 @@
+#include "test_util.hpp"
+
+#include "core/limiter_journal.hpp"
+
+#include <cstdio>
+#include <string>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+struct TempJournal {
+    std::string dir;
+    std::string path;
+
+    TempJournal()
+    {
+        char pattern[] = "/tmp/akira_journal_XXXXXX";
+        dir = mkdtemp(pattern);
+        path = dir + "/ratelimit.journal";
+    }
+
+    ~TempJournal()
+    {
+        remove(path.c_str());
+        remove((path + ".tmp").c_str());
+        rmdir(dir.c_str());
+    }
+
+    long size() const
+    {
+        struct stat st;
+        return stat(path.c_str(), &st) == 0 ? static_cast<long>(st.st_size) : -1;
+    }
+};
+
+std::string readFile(const std::string& path)
+{
+    std::string bytes;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return bytes;
+    char buffer[4096];
+    size_t read = 0;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        bytes.append(buffer, read);
+    fclose(file);
+    return bytes;
+}
+
+void writeFile(const std::string& path, const std::string& bytes)
+{
+    FILE* file = fopen(path.c_str(), "wb");
+    fwrite(bytes.data(), 1, bytes.size(), file);
+    fclose(file);
+}
+
+} // namespace
+
+TEST(journal_round_trips_acquires_and_throttles)
+{
+    TempJournal temp;
+    {
+        LimiterJournal journal(temp.path);
+        for (int64_t t = 100; t < 110; t++)
+            journal.recordAcquire(0, t);
+        journal.recordThrottle(0, 120, 1020);
+        journal.close();
+    }
+
+    LimiterJournal journal(temp.path);
+    LimiterJournal::State state;
+    CHECK(journal.replay(500, state) == LimiterJournal::Replay::Clean);
+    CHECK_EQ(state.lanes[0].stamps.size(), 10u);
+    CHECK_EQ(state.lanes[0].stamps.front(), 100);
+    CHECK_EQ(state.lanes[0].throttleCount, 1);
+    CHECK_EQ(state.lanes[0].lastThrottleAt, 120);
+    CHECK_EQ(state.lanes[0].breakerUntil, 1020);
+    CHECK_EQ(state.lastSeen, 120);
+}
+
+TEST(journal_only_syncs_once_per_reserved_block)
+{
+    TempJournal temp;
+    LimiterJournal journal(temp.path);
+
+    for (int i = 0; i < LimiterJournal::RESERVE_BLOCK * 4; i++)
+        journal.recordAcquire(0, 1000 + i);
+
+    CHECK_EQ(journal.syncedWrites(), 4u);
+    CHECK(journal.hasPending());
+}
+
+TEST(journal_never_undercounts_after_a_crash)
+{
+    TempJournal temp;
+    std::string onDisk;
+    {
+        LimiterJournal journal(temp.path);
+        for (int i = 0; i < 5; i++)
+            journal.recordAcquire(0, 100 + i);
+
+        // Power is lost here: the four buffered acquires never reach the card.
+        onDisk = readFile(temp.path);
+    }
+    writeFile(temp.path, onDisk);
+
+    LimiterJournal journal(temp.path);
+    LimiterJournal::State state;
+    CHECK(journal.replay(300, state) == LimiterJournal::Replay::Recovered);
+
+    // One acquire was written with its reservation; the rest of the block is charged at `now`.
+    CHECK_EQ(state.lanes[0].stamps.size(), static_cast<size_t>(LimiterJournal::RESERVE_BLOCK));
+    CHECK_EQ(state.lanes[0].stamps.front(), 100);
+    CHECK_EQ(state.lanes[0].stamps.back(), 300);
+
+    // Compacting settles the charge so the next start does not add it again.
+    CHECK(journal.compact(state));
+    LimiterJournal::State again;
+    CHECK(journal.replay(400, again) == LimiterJournal::Replay::Clean);
+    CHECK_EQ(again.lanes[0].stamps.size(), state.lanes[0].stamps.size());
+}
+
+TEST(journal_crash_after_a_flush_keeps_the_real_stamps)
+{
+    TempJournal temp;
+    std::string onDisk;
+    {
+        LimiterJournal journal(temp.path);
+        for (int i = 0; i < 20; i++)
+            journal.recordAcquire(0, 100 + i);
+        journal.flush();
+        onDisk = readFile(temp.path);
+    }
+    writeFile(temp.path, onDisk);
+
+    LimiterJournal journal(temp.path);
+    LimiterJournal::State state;
+    journal.replay(300, state);
+
+    // 20 real stamps, plus the 12 still reserved in the second block.
+    CHECK_EQ(state.lanes[0].stamps.size(), static_cast<size_t>(2 * LimiterJournal::RESERVE_BLOCK));
+    CHECK_EQ(state.lanes[0].stamps[19], 119);
+    CHECK_EQ(state.lanes[0].stamps[20], 300);
+}
+
+TEST(journal_clean_close_returns_the_unused_reservation)
+{
+    TempJournal temp;
+    {
+        LimiterJournal journal(temp.path);
+        for (int i = 0; i < 3; i++)
+            journal.recordAcquire(0, 100 + i);
+    }
+
+    LimiterJournal journal(temp.path);
+    LimiterJournal::State state;
+    CHECK(journal.replay(200, state) == LimiterJournal::Replay::Clean);
+    CHECK_EQ(state.lanes[0].stamps.size(), 3u);
+}
+
+TEST(journal_torn_tail_is_recovered_and_cut_off)
+{
+    TempJournal temp;
+    {
+        LimiterJournal journal(temp.path);
+        for (int i = 0; i < 4; i++)
+            journal.recordAcquire(0, 100 + i);
+    }
+
+    long full = temp.size();
+    CHECK(truncate(temp.path.c_str(), full - 7) == 0);
+
+    LimiterJournal journal(temp.path);
+    LimiterJournal::State state;
+    CHECK(journal.replay(200, state) == LimiterJournal::Replay::Recovered);
+    CHECK(state.lanes[0].stamps.size() >= 4u);
+
+    CHECK(journal.compact(state));
+    CHECK_EQ((temp.size() - 8) % 24, 0);
+}
+
+TEST(journal_damaged_record_is_reported)
+{
+    TempJournal temp;
+    {
+        LimiterJournal journal(temp.path);
+        for (int i = 0; i < 4; i++)
+            journal.recordAcquire(0, 100 + i);
+    }
+
+    FILE* file = fopen(temp.path.c_str(), "r+b");
+    fseek(file, 8 + 24 + 10, SEEK_SET);
+    fputc(0x5A, file);
+    fclose(file);
+
+    LimiterJournal journal(temp.path);
+    LimiterJournal::State state;
+    CHECK(journal.replay(200, state) == LimiterJournal::Replay::Corrupt);
+}
+
+TEST(journal_missing_file_and_foreign_file)
+{
+    TempJournal temp;
+    LimiterJournal journal(temp.path);
+    LimiterJournal::State state;
+    CHECK(journal.replay(1, state) == LimiterJournal::Replay::Missing);
+
+    FILE* file = fopen(temp.path.c_str(), "wb");
+    fputs("{\"stamps\":[1,2,3]}", file);
+    fclose(file);
+    CHECK(journal.replay(1, state) == LimiterJournal::Replay::Corrupt);
+}
+
+TEST(journal_compaction_keeps_state_and_shrinks_the_file)
+{
+    TempJournal temp;
+    LimiterJournal journal(temp.path);
+    for (int i = 0; i < 3000; i++)
+        journal.recordAcquire(0, i);
+    journal.flush();
+    CHECK(journal.needsCompaction());
+
+    LimiterJournal::State live;
+    for (int64_t t = 2900; t < 3000; t++)
+        live.lanes[0].stamps.push_back(t);
+    live.lanes[0].breakerUntil = 4000;
+    live.lanes[0].throttleCount = 2;
+    live.lanes[0].lastThrottleAt = 2500;
+    live.lastSeen = 2999;
+    CHECK(journal.compact(live));
+    CHECK(!journal.needsCompaction());
+
+    journal.recordAcquire(0, 3000);
+    journal.close();
+
+    LimiterJournal::State state;
+    CHECK(journal.replay(3001, state) == LimiterJournal::Replay::Clean);
+    CHECK_EQ(state.lanes[0].stamps.size(), 101u);
+    CHECK_EQ(state.lanes[0].breakerUntil, 4000);
+    CHECK_EQ(state.lanes[0].throttleCount, 2);
+    CHECK_EQ(state.lanes[0].lastThrottleAt, 2500);
+}
+
+TEST(journal_keeps_lanes_apart)
+{
+    TempJournal temp;
+    std::string onDisk;
+    {
+        LimiterJournal journal(temp.path);
+        for (int i = 0; i < 3; i++)
+            journal.recordAcquire(0, 100 + i);
+        journal.recordAcquire(2, 150);
+        journal.recordThrottle(1, 160, 1060);
+        journal.flush();
+        onDisk = readFile(temp.path);
+    }
+    writeFile(temp.path, onDisk);
+
+    LimiterJournal journal(temp.path);
+    LimiterJournal::State state;
+    CHECK(journal.replay(300, state) == LimiterJournal::Replay::Recovered);
+
+    // Each lane is charged only for its own open reservation.
+    CHECK_EQ(state.lanes[0].stamps.size(), static_cast<size_t>(LimiterJournal::RESERVE_BLOCK));
+    CHECK_EQ(state.lanes[1].stamps.size(), 0u);
+    CHECK_EQ(state.lanes[2].stamps.size(), static_cast<size_t>(LimiterJournal::RESERVE_BLOCK));
+    CHECK_EQ(state.lanes[0].throttleCount, 0);
+    CHECK_EQ(state.lanes[1].throttleCount, 1);
+    CHECK_EQ(state.lanes[1].breakerUntil, 1060);
+}
+
+TEST(journal_compaction_collapses_repeated_stamps)
+{
+    TempJournal temp;
+    LimiterJournal journal(temp.path);
+
+    LimiterJournal::State live;
+    live.lanes[0].stamps.assign(300, 500);
+    live.lanes[2].stamps.assign(40, 510);
+    live.lastSeen = 510;
+    CHECK(journal.compact(live));
+    CHECK_EQ(temp.size(), 8 + 2 * 24);
+
+    LimiterJournal::State state;
+    CHECK(journal.replay(600, state) == LimiterJournal::Replay::Clean);
+    CHECK_EQ(state.lanes[0].stamps.size(), 300u);
+    CHECK_EQ(state.lanes[2].stamps.size(), 40u);
+}
+
+// The second compaction replaces the file the first one left, which FAT only allows once the
+// old journal is gone.
+TEST(journal_compacts_twice_in_a_row)
+{
+    TempJournal temp;
+    LimiterJournal journal(temp.path);
+
+    LimiterJournal::State first;
+    first.lanes[0].stamps.assign(10, 500);
+    first.lastSeen = 500;
+    CHECK(journal.compact(first));
+
+    LimiterJournal::State second;
+    second.lanes[1].stamps.assign(3, 520);
+    second.lastSeen = 520;
+    CHECK(journal.compact(second));
+    CHECK_EQ(readFile(temp.path + ".tmp"), std::string());
+
+    LimiterJournal::State state;
+    CHECK(journal.replay(600, state) == LimiterJournal::Replay::Clean);
+    CHECK_EQ(state.lanes[0].stamps.size(), 0u);
+    CHECK_EQ(state.lanes[1].stamps.size(), 3u);
+}
+
+// A crash after compaction removed the old journal but before the new one was renamed in
+// leaves only the staged copy. Replay and the next append both take it up rather than
+// starting the window again from zero.
+TEST(journal_adopts_a_compaction_cut_short_before_the_rename)
+{
+    TempJournal temp;
+    LimiterJournal journal(temp.path);
+
+    LimiterJournal::State compacted;
+    compacted.lanes[0].stamps.assign(7, 500);
+    compacted.lastSeen = 500;
+    CHECK(journal.compact(compacted));
+    CHECK_EQ(rename(temp.path.c_str(), (temp.path + ".tmp").c_str()), 0);
+
+    LimiterJournal::State state;
+    CHECK(journal.replay(600, state) == LimiterJournal::Replay::Clean);
+    CHECK_EQ(state.lanes[0].stamps.size(), 7u);
+    CHECK_EQ(readFile(temp.path + ".tmp"), std::string());
+
+    CHECK_EQ(rename(temp.path.c_str(), (temp.path + ".tmp").c_str()), 0);
+    LimiterJournal appending(temp.path);
+    appending.recordAcquire(0, 610);
+    CHECK(appending.flush());
+    appending.close();
+
+    CHECK(appending.replay(620, state) != LimiterJournal::Replay::Missing);
+    CHECK(state.lanes[0].stamps.size() >= 8u);
+}
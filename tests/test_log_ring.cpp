@@ -0,0 +1,186 @@
+#include "test_util.hpp"
+
+#include "util/log_ring.hpp"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr auto GENERAL = LogRing::Category::General;
+constexpr auto DISCOVERY = LogRing::Category::Discovery;
+
+std::vector<std::string> texts(const std::vector<LogRing::Record>& records)
+{
+    std::vector<std::string> out;
+    for (const auto& record : records)
+        out.push_back(record.text);
+    return out;
+}
+
+} // namespace
+
+TEST(log_ring_reads_incrementally_by_category_and_skips_overwritten)
+{
+    LogRing ring(6);
+    CHECK_EQ(ring.capacity(), size_t(8));
+
+    ring.push(LogRing::Level::Info, GENERAL, "one", 1000);
+    ring.push(LogRing::Level::Warning, DISCOVERY, "sweep 10.0.1.0/24", 1001);
+    ring.push(LogRing::Level::Error, GENERAL, "two", 1002);
+
+    // Each category numbers its own records.
+    std::vector<LogRing::Record> records;
+    uint64_t next = ring.readSince(0, GENERAL, records);
+    CHECK_EQ(next, uint64_t(2));
+    CHECK_EQ(ring.head(DISCOVERY), uint64_t(1));
+    CHECK(texts(records) == (std::vector<std::string>{"one", "two"}));
+    CHECK(records[1].level == LogRing::Level::Error);
+    CHECK_EQ(records[1].timeMs, int64_t(1002));
+
+    // Nothing new: nothing copied.
+    records.clear();
+    CHECK_EQ(ring.readSince(next, GENERAL, records), next);
+    CHECK(records.empty());
+
+    ring.push(LogRing::Level::Info, GENERAL, "three");
+    CHECK_EQ(ring.readSince(next, GENERAL, records), uint64_t(3));
+    CHECK(texts(records) == (std::vector<std::string>{"three"}));
+
+    // Clearing one category leaves the other readable.
+    ring.clear(DISCOVERY);
+    records.clear();
+    ring.readSince(0, DISCOVERY, records);
+    CHECK(records.empty());
+    ring.readSince(0, GENERAL, records);
+    CHECK_EQ(records.size(), size_t(3));
+
+    // A reader that fell more than a lap behind resumes at the oldest record still held.
+    for (int i = 0; i < 20; i++)
+        ring.push(LogRing::Level::Debug, GENERAL, "line " + std::to_string(i));
+    records.clear();
+    next = ring.readSince(next, GENERAL, records);
+    CHECK_EQ(next, ring.head(GENERAL));
+    CHECK_EQ(records.size(), ring.capacity());
+    CHECK_EQ(records.front().text, std::string("line 12"));
+    CHECK_EQ(records.back().text, std::string("line 19"));
+    CHECK_EQ(ring.dropped(), uint64_t(0));
+}
+
+// A burst of general lines, as a busy borealis log makes, leaves the discovery lines alone.
+TEST(log_ring_keeps_a_chatty_category_out_of_the_others_slots)
+{
+    LogRing ring(8);
+    for (int i = 0; i < 3; i++)
+        ring.push(LogRing::Level::Info, DISCOVERY, "probe " + std::to_string(i));
+    for (int i = 0; i < 100; i++)
+        ring.push(LogRing::Level::Debug, GENERAL, "frame " + std::to_string(i));
+
+    std::vector<LogRing::Record> records;
+    CHECK_EQ(ring.readSince(0, DISCOVERY, records), uint64_t(3));
+    CHECK(texts(records) == (std::vector<std::string>{"probe 0", "probe 1", "probe 2"}));
+
+    records.clear();
+    ring.readSince(0, GENERAL, records);
+    CHECK_EQ(records.size(), ring.capacity());
+    CHECK_EQ(records.back().text, std::string("frame 99"));
+}
+
+TEST(log_ring_truncates_on_utf8_boundary)
+{
+    LogRing ring(4);
+
+    // Two-byte characters straddling the limit: the partial one is dropped whole.
+    std::string text(LogRing::TEXT_BYTES - 1, 'a');
+    text += "\xC3\xA9\xC3\xA9";
+    ring.push(LogRing::Level::Info, GENERAL, text);
+
+    std::string fits(LogRing::TEXT_BYTES, 'b');
+    ring.push(LogRing::Level::Info, GENERAL, fits);
+
+    std::vector<LogRing::Record> records;
+    ring.readSince(0, GENERAL, records);
+    CHECK_EQ(records.size(), size_t(2));
+    CHECK_EQ(records[0].text, std::string(LogRing::TEXT_BYTES - 1, 'a'));
+    CHECK_EQ(records[1].text, fits);
+}
+
+// Several producers race a reader that polls incrementally. Every record the reader gets
+// must be one that was pushed, intact, in increasing sequence order, and in per-producer
+// order; when producers stop, the reader has every record still in the ring.
+TEST(log_ring_concurrent_producers_never_tear_records)
+{
+    constexpr int PRODUCERS = 4;
+    constexpr int PER_PRODUCER = 20000;
+    LogRing ring(256);
+
+    auto makeText = [](int producer, int i) {
+        std::string text = std::to_string(producer) + ":" + std::to_string(i) + ":";
+        // Varying lengths, so a torn copy would mismatch its own header.
+        text.append(size_t(i % 97), char('a' + producer));
+        return text;
+    };
+
+    std::atomic<bool> done{false};
+    bool torn = false;
+    bool outOfOrder = false;
+    size_t received = 0;
+
+    std::thread reader([&] {
+        uint64_t next = 0;
+        std::vector<int> lastIndex(PRODUCERS, -1);
+        std::vector<LogRing::Record> records;
+        auto drain = [&] {
+            records.clear();
+            uint64_t before = next;
+            next = ring.readSince(next, GENERAL, records);
+            for (const auto& record : records)
+            {
+                if (record.seq < before)
+                    outOfOrder = true;
+                before = record.seq + 1;
+
+                int producer = std::stoi(record.text);
+                int i = std::stoi(record.text.substr(record.text.find(':') + 1));
+                if (producer < 0 || producer >= PRODUCERS || record.text != makeText(producer, i))
+                {
+                    torn = true;
+                    continue;
+                }
+                if (i <= lastIndex[producer])
+                    outOfOrder = true;
+                lastIndex[producer] = i;
+                received++;
+            }
+        };
+        while (!done.load(std::memory_order_acquire))
+            drain();
+        drain();
+    });
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; p++)
+    {
+        producers.emplace_back([&, p] {
+            for (int i = 0; i < PER_PRODUCER; i++)
+                ring.push(LogRing::Level::Info, GENERAL, makeText(p, i));
+        });
+    }
+    for (auto& producer : producers)
+        producer.join();
+    done.store(true, std::memory_order_release);
+    reader.join();
+
+    CHECK(!torn);
+    CHECK(!outOfOrder);
+    CHECK_EQ(ring.head(GENERAL), uint64_t(PRODUCERS * PER_PRODUCER));
+    CHECK(received + ring.dropped() >= ring.capacity());
+
+    // Quiescent: the last lap is all there, except slots a lapped producer gave up on.
+    std::vector<LogRing::Record> tail;
+    ring.readSince(0, GENERAL, tail);
+    CHECK(tail.size() + ring.dropped() >= ring.capacity());
+    CHECK(tail.size() <= ring.capacity());
+}
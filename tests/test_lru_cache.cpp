@@ -0,0 +1,222 @@
+#include "test_util.hpp"
+
+#include "util/lru_cache.hpp"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using akira::LruCache;
+using akira::ShardedLruCache;
+
+namespace {
+
+struct StringBytes {
+    size_t operator()(const std::string& value) const { return value.size(); }
+};
+
+using ByteCache = LruCache<std::string, std::string, StringBytes>;
+
+} // namespace
+
+TEST(lru_evicts_the_least_recently_used_entry)
+{
+    LruCache<int, int> cache(3);
+    cache.put(1, 10);
+    cache.put(2, 20);
+    cache.put(3, 30);
+
+    int value = 0;
+    CHECK(cache.get(1, value));
+    cache.put(4, 40);
+
+    CHECK(cache.contains(1));
+    CHECK(!cache.contains(2));
+    CHECK(cache.contains(3));
+    CHECK(cache.contains(4));
+    CHECK_EQ(cache.metrics().evictions, 1u);
+}
+
+TEST(lru_budget_is_measured_in_bytes)
+{
+    ByteCache cache(10);
+    cache.put("a", std::string(4, 'a'));
+    cache.put("b", std::string(4, 'b'));
+    CHECK_EQ(cache.bytes(), 8u);
+
+    cache.put("c", std::string(6, 'c'));
+    CHECK(!cache.contains("a"));
+    CHECK(cache.contains("b"));
+    CHECK(cache.contains("c"));
+    CHECK_EQ(cache.bytes(), 10u);
+}
+
+TEST(lru_replacing_a_value_recounts_its_size)
+{
+    ByteCache cache(100);
+    cache.put("a", std::string(10, 'a'));
+    cache.put("a", std::string(30, 'a'));
+
+    CHECK_EQ(cache.size(), 1u);
+    CHECK_EQ(cache.bytes(), 30u);
+}
+
+TEST(lru_value_larger_than_the_budget_is_not_kept)
+{
+    ByteCache cache(8);
+    cache.put("small", "1234");
+    cache.put("huge", std::string(20, 'x'));
+
+    CHECK(!cache.contains("huge"));
+    CHECK(!cache.contains("small"));
+    CHECK_EQ(cache.bytes(), 0u);
+}
+
+TEST(lru_pinned_entries_survive_eviction)
+{
+    ByteCache cache(10);
+    cache.put("avatar", std::string(4, 'a'));
+    CHECK(cache.pin("avatar"));
+
+    for (int i = 0; i < 10; i++)
+        cache.put("icon" + std::to_string(i), std::string(4, 'i'));
+
+    CHECK(cache.contains("avatar"));
+    CHECK(cache.bytes() <= 10u);
+
+    CHECK(cache.unpin("avatar"));
+    CHECK(!cache.unpin("avatar"));
+    cache.put("next", std::string(10, 'n'));
+    CHECK(!cache.contains("avatar"));
+    CHECK(cache.contains("next"));
+}
+
+TEST(lru_pins_nest_and_can_exceed_the_budget)
+{
+    ByteCache cache(4);
+    cache.put("a", "aaa");
+    cache.pin("a");
+    cache.pin("a");
+    cache.put("b", "bbb");
+
+    CHECK(cache.contains("a"));
+    CHECK(!cache.contains("b"));
+
+    cache.setBudget(2);
+    CHECK(cache.contains("a"));
+    cache.unpin("a");
+    CHECK(cache.contains("a"));
+    cache.unpin("a");
+    CHECK(!cache.contains("a"));
+    CHECK(!cache.pin("a"));
+}
+
+TEST(lru_erase_works_on_pinned_and_unpinned_entries)
+{
+    ByteCache cache(100);
+    cache.put("a", "1");
+    cache.put("b", "22");
+    cache.pin("b");
+
+    CHECK(cache.erase("a"));
+    CHECK(cache.erase("b"));
+    CHECK(!cache.erase("b"));
+    CHECK_EQ(cache.size(), 0u);
+    CHECK_EQ(cache.bytes(), 0u);
+}
+
+TEST(lru_counts_hits_and_misses)
+{
+    LruCache<int, int> cache(4);
+    cache.put(1, 1);
+
+    CHECK(cache.find(1) != nullptr);
+    CHECK(cache.find(1) != nullptr);
+    CHECK(cache.find(2) == nullptr);
+    CHECK(cache.contains(2) == false);
+
+    akira::CacheMetrics metrics = cache.metrics();
+    CHECK_EQ(metrics.hits, 2u);
+    CHECK_EQ(metrics.misses, 1u);
+    CHECK_EQ(metrics.insertions, 1u);
+    CHECK_EQ(metrics.entries, 1u);
+    CHECK(metrics.hitRate() > 0.66 && metrics.hitRate() < 0.67);
+}
+
+TEST(lru_clear_keeps_the_counters)
+{
+    LruCache<int, int> cache(4);
+    cache.put(1, 1);
+    cache.find(1);
+    cache.clear();
+
+    CHECK_EQ(cache.size(), 0u);
+    CHECK(!cache.contains(1));
+    CHECK_EQ(cache.metrics().hits, 1u);
+}
+
+TEST(sharded_lru_splits_the_budget_across_shards)
+{
+    ShardedLruCache<int, int, akira::UnitSize<int>, std::hash<int>, 4> cache(400);
+    for (int i = 0; i < 1000; i++)
+        cache.put(i, i);
+
+    akira::CacheMetrics metrics = cache.metrics();
+    CHECK(metrics.entries <= 400u);
+    CHECK_EQ(metrics.budget, 400u);
+    CHECK_EQ(metrics.insertions, 1000u);
+    CHECK_EQ(metrics.evictions, 1000u - metrics.entries);
+
+    int value = -1;
+    CHECK(cache.get(999, value));
+    CHECK_EQ(value, 999);
+}
+
+// 8 MiB over 8 shards is 1 MiB a shard, too small for 2 MiB artwork; told the largest
+// value, the cache spreads over 2 shards of 4 MiB instead.
+TEST(sharded_lru_keeps_values_larger_than_an_even_share)
+{
+    constexpr size_t MiB = 1024 * 1024;
+    ShardedLruCache<int, std::string, StringBytes> cache(8 * MiB, 2 * MiB);
+    cache.put(1, std::string(2 * MiB, 'a'));
+    cache.put(2, std::string(1 * MiB, 'b'));
+    cache.put(3, std::string(1 * MiB, 'c'));
+
+    std::string value;
+    CHECK(cache.get(1, value));
+    CHECK_EQ(value.size(), 2 * MiB);
+    CHECK_EQ(cache.metrics().budget, 8 * MiB);
+    CHECK_EQ(cache.metrics().evictions, 0u);
+
+    ShardedLruCache<int, std::string, StringBytes> even(8 * MiB);
+    even.put(1, std::string(2 * MiB, 'a'));
+    CHECK(!even.contains(1));
+}
+
+TEST(sharded_lru_survives_concurrent_writers)
+{
+    ShardedLruCache<int, std::string, StringBytes> cache(64 * 1024);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++)
+    {
+        threads.emplace_back([&cache, t] {
+            for (int i = 0; i < 5000; i++)
+            {
+                int key = (i * 7 + t) % 2000;
+                std::string value;
+                if (!cache.get(key, value))
+                    cache.put(key, std::string(64, static_cast<char>('a' + t)));
+                if (i % 97 == 0)
+                    cache.erase(key);
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    akira::CacheMetrics metrics = cache.metrics();
+    CHECK(metrics.bytes <= 64u * 1024u);
+    CHECK_EQ(metrics.hits + metrics.misses, 20000u);
+    CHECK_EQ(metrics.bytes, metrics.entries * 64u);
+}
@@ -1,6 +1,7 @@
 #include "test_util.hpp"
 
 #include <cstdio>
+#include <cstring>
 
 namespace tests {
 
@@ -10,12 +11,42 @@ std::vector<TestCase>& registry()
     return cases;
 }
 
+std::vector<TestCase>& benchRegistry()
+{
+    static std::vector<TestCase> cases;
+    return cases;
+}
+
 int failures = 0;
 
+const void* volatile lastSunk = nullptr;
+
+void sink(const void* value)
+{
+    lastSunk = value;
+}
+
 } // namespace tests
 
-int main()
+static int runBenches(const char* filter)
 {
+    for (const tests::TestCase& bench : tests::benchRegistry())
+    {
+        if (filter && !std::strstr(bench.name, filter))
+            continue;
+
+        std::printf("bench %s\n", bench.name);
+        bench.body();
+    }
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && std::strcmp(argv[1], "--bench") == 0)
+        return runBenches(argc > 2 ? argv[2] : nullptr);
+
     int failed = 0;
     int passed = 0;
 
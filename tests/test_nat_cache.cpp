@@ -0,0 +1,92 @@
+#include "test_util.hpp"
+
+#include "core/nat_cache.hpp"
+
+#include <string>
+#include <vector>
+
+TEST(stun_server_list_ranks_by_rtt_and_survives_refetch_and_reload)
+{
+    using Servers = std::vector<std::string>;
+
+    Servers published = StunServerList::parseServerList(
+        "# always-online-stun\n"
+        "stun.a.example:3478\n"
+        "  stun.b.example:3478\r\n"
+        "\n"
+        "not-a-server\n"
+        "stun.c.example:3478\n"
+        "stun.d.example:3478\n");
+    CHECK(published == (Servers{"stun.a.example:3478", "stun.b.example:3478",
+        "stun.c.example:3478", "stun.d.example:3478"}));
+
+    StunServerList::Config config;
+    config.ttlMs = 1000;
+    StunServerList list(config);
+    CHECK(list.stale(0));
+
+    list.replace(published, 10000);
+    CHECK(!list.stale(10500));
+    CHECK(list.stale(11000));
+    CHECK(list.ranked(2) == (Servers{"stun.a.example:3478", "stun.b.example:3478"}));
+
+    // Answering servers first by RTT, then unmeasured ones, then the silent.
+    list.recordRtt("stun.c.example:3478", 80);
+    list.recordRtt("stun.d.example:3478", 30);
+    list.recordFailure("stun.a.example:3478");
+    CHECK(list.ranked(4) == (Servers{"stun.d.example:3478", "stun.c.example:3478",
+        "stun.b.example:3478", "stun.a.example:3478"}));
+
+    // RTTs are smoothed, and an answer clears the failures.
+    list.recordRtt("stun.c.example:3478", 0);
+    CHECK_EQ(list.entries()[2].rttMs, 60);
+    list.recordRtt("stun.a.example:3478", 10);
+    CHECK_EQ(list.ranked(1)[0], std::string("stun.a.example:3478"));
+
+    // A refetch keeps what was measured for servers still listed.
+    list.replace({"stun.e.example:3478", "stun.d.example:3478"}, 20000);
+    CHECK_EQ(list.entries().size(), size_t(2));
+    CHECK_EQ(list.entries()[1].rttMs, 30);
+    CHECK(list.ranked(2) == (Servers{"stun.d.example:3478", "stun.e.example:3478"}));
+
+    StunServerList reloaded(config);
+    CHECK(reloaded.parse(list.serialize()));
+    CHECK(!reloaded.stale(20500));
+    CHECK(reloaded.ranked(2) == list.ranked(2));
+
+    StunServerList garbage(config);
+    CHECK(!garbage.parse("stun.a.example:3478\n"));
+    CHECK(garbage.stale(20500));
+    CHECK(garbage.entries().empty());
+}
+
+TEST(nat_result_cache_is_per_network_with_ttl)
+{
+    NatResultCache::Config config;
+    config.ttlMs = 1000;
+    config.maxNetworks = 2;
+    NatResultCache cache(config);
+
+    StunResult symmetric;
+    symmetric.type = NATType::Symmetric;
+    StunResult cone;
+    cone.type = NATType::FullCone;
+
+    cache.store("home|192.168.1.1", symmetric, 0);
+    cache.store("", cone, 0);
+    CHECK_EQ(cache.size(), size_t(1));
+
+    CHECK(cache.find("home|192.168.1.1", 999)->type == NATType::Symmetric);
+    CHECK(!cache.find("home|192.168.1.1", 1000));
+    CHECK(!cache.find("cafe|10.0.0.1", 10));
+
+    // Full: the oldest network goes.
+    cache.store("cafe|10.0.0.1", cone, 100);
+    cache.store("work|172.16.0.1", cone, 200);
+    CHECK_EQ(cache.size(), size_t(2));
+    CHECK(!cache.find("home|192.168.1.1", 300));
+    CHECK(cache.find("cafe|10.0.0.1", 300)->type == NATType::FullCone);
+
+    cache.forget("cafe|10.0.0.1");
+    CHECK(!cache.find("cafe|10.0.0.1", 300));
+}
@@ -0,0 +1,143 @@
+#include "test_util.hpp"
+
+#include "core/nat_probe.hpp"
+#include "stun_standin.hpp"
+
+#include <vector>
+
+namespace {
+
+NatProbe::Config fastConfig()
+{
+    NatProbe::Config config;
+    config.attemptTimeoutMs = 150;
+    config.attempts = 2;
+    config.deadlineMs = 3000;
+    return config;
+}
+
+} // namespace
+
+TEST(nat_probe_wire_format_round_trips)
+{
+    const uint8_t id[NatProbe::TRANSACTION_ID_BYTES] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+
+    std::vector<uint8_t> plain = NatProbe::bindingRequest(id, 0);
+    CHECK_EQ(plain.size(), size_t(20));
+    std::vector<uint8_t> change = NatProbe::bindingRequest(id, NatProbe::CHANGE_IP | NatProbe::CHANGE_PORT);
+    CHECK_EQ(change.size(), size_t(28));
+    CHECK_EQ(int(change[3]), 8);
+    CHECK_EQ(int(change[27]), 0x06);
+
+    StunEndpoint mapped{0xCB007107, 40001};
+    StunEndpoint other{sim::loopback(2), 3479};
+    std::vector<uint8_t> response = NatProbe::bindingResponse(id, mapped, &other);
+
+    NatProbe::Binding binding = NatProbe::parseBindingResponse(response.data(), response.size(), id);
+    CHECK(binding.valid);
+    CHECK(binding.mapped == mapped);
+    CHECK(binding.hasOther);
+    CHECK(binding.other == other);
+    CHECK_EQ(binding.mapped.toString(), std::string("203.0.113.7:40001"));
+
+    // Someone else's transaction, a truncated packet, and a request are all rejected.
+    uint8_t otherId[NatProbe::TRANSACTION_ID_BYTES] = {};
+    CHECK(!NatProbe::parseBindingResponse(response.data(), response.size(), otherId).valid);
+    CHECK(!NatProbe::parseBindingResponse(response.data(), response.size() - 4, id).valid);
+    CHECK(!NatProbe::parseBindingResponse(plain.data(), plain.size(), id).valid);
+}
+
+// Each NAT behaviour, simulated in front of one RFC 5780 stand-in and one plain one.
+TEST(nat_probe_classifies_simulated_nats)
+{
+    struct Case {
+        MappingType mapping;
+        FilteringType filtering;
+        NATType expected;
+    };
+    const Case cases[] = {
+        {MappingType::EndpointIndependent, FilteringType::EndpointIndependent, NATType::FullCone},
+        {MappingType::EndpointIndependent, FilteringType::AddressDependent, NATType::RestrictedCone},
+        {MappingType::EndpointIndependent, FilteringType::AddressPortDependent, NATType::PortRestrictedCone},
+        {MappingType::AddressDependent, FilteringType::AddressPortDependent, NATType::Symmetric},
+        {MappingType::AddressPortDependent, FilteringType::AddressPortDependent, NATType::SymmetricPortOnly},
+    };
+
+    for (const Case& c : cases)
+    {
+        sim::SimulatedNat nat(c.mapping, c.filtering);
+        sim::StunStandin rfc5780(nat, sim::loopback(1), sim::loopback(2), {});
+        sim::StunStandin plain(nat, sim::loopback(3), sim::loopback(4), {.rfc5780 = false});
+
+        NatProbe probe(fastConfig());
+        NatProbe::Report report = probe.run({plain.target(), rfc5780.target()});
+
+        CHECK(report.result.mapping == c.mapping);
+        CHECK(report.result.filtering == c.filtering);
+        CHECK(report.result.type == c.expected);
+        CHECK_EQ(report.result.externalIP, std::string("203.0.113.7"));
+        CHECK_EQ(report.behaviorServer, rfc5780.target().server);
+        CHECK(report.result.error.empty());
+    }
+}
+
+// An open NAT is settled by the first answers; a dead server ahead of it in the list
+// neither delays the run nor gets retried past it.
+TEST(nat_probe_finishes_once_behaviour_is_known)
+{
+    sim::SimulatedNat nat(MappingType::EndpointIndependent, FilteringType::EndpointIndependent);
+    sim::StunStandin dead(nat, sim::loopback(5), sim::loopback(6), {.silent = true});
+    sim::StunStandin live(nat, sim::loopback(1), sim::loopback(2), {});
+
+    NatProbe::Config config = fastConfig();
+    config.attemptTimeoutMs = 400;
+    config.attempts = 3;
+    NatProbe probe(config);
+    NatProbe::Report report = probe.run({dead.target(), live.target()});
+
+    CHECK(report.result.type == NATType::FullCone);
+    CHECK(report.elapsedMs < config.attemptTimeoutMs);
+    CHECK_EQ(dead.requests(), 1);
+    // Only the live server's round trip is known; the dead one was still pending.
+    CHECK_EQ(report.rtts.size(), size_t(1));
+    CHECK_EQ(report.rtts[0].server, live.target().server);
+}
+
+TEST(nat_probe_falls_back_without_rfc5780_and_reports_blocked_udp)
+{
+    {
+        // Two plain servers on different addresses see different mappings.
+        sim::SimulatedNat nat(MappingType::AddressDependent, FilteringType::EndpointIndependent);
+        sim::StunStandin first(nat, sim::loopback(1), sim::loopback(2), {.rfc5780 = false});
+        sim::StunStandin second(nat, sim::loopback(3), sim::loopback(4), {.rfc5780 = false});
+
+        NatProbe::Report report = NatProbe(fastConfig()).run({first.target(), second.target()});
+        CHECK(report.result.type == NATType::Symmetric);
+        CHECK(report.result.filtering == FilteringType::Unknown);
+        CHECK(report.behaviorServer.empty());
+        CHECK_EQ(report.rtts.size(), size_t(2));
+    }
+    {
+        // A server that answers CHANGE-REQUEST from its primary address says nothing
+        // about filtering.
+        sim::SimulatedNat nat(MappingType::EndpointIndependent, FilteringType::AddressDependent);
+        sim::StunStandin stubborn(nat, sim::loopback(1), sim::loopback(2), {.honorChange = false});
+
+        NatProbe::Report report = NatProbe(fastConfig()).run({stubborn.target()});
+        CHECK(report.result.mapping == MappingType::EndpointIndependent);
+        CHECK(report.result.filtering == FilteringType::Unknown);
+        CHECK(report.result.type == NATType::FullCone);
+    }
+    {
+        sim::SimulatedNat nat(MappingType::EndpointIndependent, FilteringType::EndpointIndependent);
+        sim::StunStandin dead(nat, sim::loopback(1), sim::loopback(2), {.silent = true});
+
+        NatProbe::Config config = fastConfig();
+        NatProbe::Report report = NatProbe(config).run({dead.target()});
+        CHECK(report.result.type == NATType::UDPBlocked);
+        CHECK(!report.result.error.empty());
+        CHECK_EQ(dead.requests(), config.attempts);
+        CHECK_EQ(report.rtts.size(), size_t(1));
+        CHECK_EQ(report.rtts[0].rttMs, -1);
+    }
+}
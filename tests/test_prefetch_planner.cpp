@@ -0,0 +1,122 @@
+#include "test_util.hpp"
+
+#include "util/prefetch_planner.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+constexpr size_t ROW_BYTES = 100;
+
+PrefetchPlanner::RowCost flat()
+{
+    return [](size_t) { return ROW_BYTES; };
+}
+
+PrefetchPlanner::Config config(size_t budgetRows)
+{
+    PrefetchPlanner::Config out;
+    out.byteBudget = budgetRows * ROW_BYTES;
+    out.horizonSeconds = 1.0f;
+    out.minAhead = 2;
+    out.maxAhead = 10;
+    out.behind = 1;
+    return out;
+}
+
+} // namespace
+
+TEST(prefetch_reaches_further_ahead_when_scrolling_faster)
+{
+    PrefetchPlanner idle(config(100));
+    auto plan = idle.update({10, 14, 200, 0}, flat());
+    CHECK(plan.fetch == (std::vector<size_t>{14, 15, 9}));
+    CHECK(plan.cancel.empty());
+
+    PrefetchPlanner fast(config(100));
+    plan = fast.update({10, 14, 200, 5.5f}, flat());
+    CHECK(plan.fetch == (std::vector<size_t>{14, 15, 16, 17, 18, 19, 20, 9}));
+
+    PrefetchPlanner flung(config(100));
+    plan = flung.update({10, 14, 200, 80.0f}, flat());
+    CHECK_EQ(plan.fetch.size(), size_t(11));
+    CHECK_EQ(plan.fetch[9], size_t(23));
+}
+
+TEST(prefetch_follows_the_scroll_direction)
+{
+    PrefetchPlanner planner(config(100));
+    auto plan = planner.update({10, 14, 200, -3.0f}, flat());
+    CHECK(plan.fetch == (std::vector<size_t>{9, 8, 7, 6, 5, 14}));
+
+    // Stopping keeps the last direction instead of flipping back to downwards.
+    plan = planner.update({10, 14, 200, 0}, flat());
+    CHECK(plan.fetch.empty());
+    CHECK(plan.cancel == (std::vector<size_t>{5, 6, 7}));
+}
+
+TEST(prefetch_stays_inside_the_byte_budget)
+{
+    PrefetchPlanner planner(config(3));
+    auto plan = planner.update({0, 4, 200, 20.0f}, flat());
+    CHECK(plan.fetch == (std::vector<size_t>{4, 5, 6}));
+    CHECK_EQ(planner.outstandingBytes(), 3 * ROW_BYTES);
+
+    // An expensive row ahead stops the window there; the row behind still fits.
+    PrefetchPlanner lumpy(config(3));
+    plan = lumpy.update({5, 8, 200, 20.0f}, [](size_t row) { return row == 9 ? 5 * ROW_BYTES : ROW_BYTES; });
+    CHECK(plan.fetch == (std::vector<size_t>{8, 4}));
+    CHECK_EQ(lumpy.outstandingBytes(), 2 * ROW_BYTES);
+
+    // Rows past either end of the list are never planned.
+    PrefetchPlanner edge(config(100));
+    plan = edge.update({0, 3, 5, -4.0f}, flat());
+    CHECK(plan.fetch == (std::vector<size_t>{3}));
+}
+
+TEST(prefetch_cancels_rows_that_leave_the_window)
+{
+    PrefetchPlanner planner(config(100));
+    planner.update({10, 14, 200, 6.0f}, flat());
+
+    // A flick back up: everything queued below is dropped, nothing visible is.
+    auto plan = planner.update({8, 12, 200, -6.0f}, flat());
+    std::vector<size_t> cancelled = plan.cancel;
+    CHECK(std::find(cancelled.begin(), cancelled.end(), 14) != cancelled.end());
+    CHECK(std::find(cancelled.begin(), cancelled.end(), 19) != cancelled.end());
+    CHECK(std::find(cancelled.begin(), cancelled.end(), 12) == cancelled.end());
+    CHECK(std::find(cancelled.begin(), cancelled.end(), 9) == cancelled.end());
+    CHECK(std::is_sorted(cancelled.begin(), cancelled.end()));
+
+    // Rows that scrolled into view belong to their cells now and are forgotten, not cancelled.
+    PrefetchPlanner steady(config(100));
+    steady.update({0, 4, 200, 3.0f}, flat());
+    plan = steady.update({2, 6, 200, 3.0f}, flat());
+    CHECK(plan.cancel.empty());
+    CHECK(plan.fetch == (std::vector<size_t>{9, 10, 1}));
+
+    CHECK(steady.reset() == (std::vector<size_t>{1, 6, 7, 8, 9, 10}));
+    CHECK_EQ(steady.outstandingRows(), size_t(0));
+}
+
+TEST(scroll_velocity_smooths_and_settles)
+{
+    ScrollVelocity velocity;
+    CHECK_EQ(velocity.sample(0, 1000), 0.0f);
+
+    float speed = 0;
+    for (int frame = 1; frame <= 30; frame++)
+        speed = velocity.sample(frame * 20.0f, 1000 + frame * 16);
+    CHECK(speed > 1200.0f && speed < 1260.0f);
+
+    // Two samples in the same millisecond count once.
+    CHECK_EQ(velocity.sample(700.0f, 1000 + 30 * 16), speed);
+
+    // A pause longer than IDLE_MS starts over from rest.
+    CHECK_EQ(velocity.sample(900.0f, 2000), 0.0f);
+
+    for (int frame = 1; frame <= 30; frame++)
+        speed = velocity.sample(900.0f - frame * 10.0f, 2000 + frame * 16);
+    CHECK(speed < -600.0f);
+}
@@ -465,6 +465,71 @@ TEST(group_earned_counts_can_be_tallied_without_the_progress_call)
     CHECK_EQ(groups[1].earnedTrophies.total(), 1);
 }
 
+TEST(library_diff_sorts_titles_by_what_changed)
+{
+    std::vector<TrophyTitle> previous(4);
+    previous[0].npCommunicationId = "NPWR00001_00";
+    previous[0].lastUpdatedDateTime = "2026-01-01T00:00:00Z";
+    previous[1].npCommunicationId = "NPWR00002_00";
+    previous[1].lastUpdatedDateTime = "2026-01-01T00:00:00Z";
+    previous[2].npCommunicationId = "NPWR00003_00";
+    previous[2].lastUpdatedDateTime = "2026-01-01T00:00:00Z";
+    previous[3].npCommunicationId = "NPWR00004_00";
+
+    std::vector<TrophyTitle> current = previous;
+    current.erase(current.begin() + 2);
+    current[1].lastUpdatedDateTime = "2026-02-01T00:00:00Z";
+    current.push_back(TrophyTitle{});
+    current.back().npCommunicationId = "NPWR00005_00";
+
+    LibraryDelta delta = diffLibrary(previous, current);
+
+    CHECK_EQ(delta.unchanged.size(), size_t(1));
+    CHECK_EQ(delta.unchanged[0], std::string("NPWR00001_00"));
+    CHECK_EQ(delta.changed.size(), size_t(2));
+    CHECK_EQ(delta.changed[0], std::string("NPWR00002_00"));
+    CHECK_EQ(delta.changed[1], std::string("NPWR00004_00"));
+    CHECK_EQ(delta.removed.size(), size_t(1));
+    CHECK_EQ(delta.removed[0], std::string("NPWR00003_00"));
+    CHECK_EQ(delta.added.size(), size_t(1));
+    CHECK_EQ(delta.added[0], std::string("NPWR00005_00"));
+}
+
+TEST(library_diff_catches_earned_counts_moving_under_the_same_timestamp)
+{
+    std::vector<TrophyTitle> previous(1);
+    previous[0].npCommunicationId = "NPWR00001_00";
+    previous[0].lastUpdatedDateTime = "2026-01-01T00:00:00Z";
+    previous[0].hasTrophyGroups = true;
+
+    std::vector<TrophyTitle> current = previous;
+    current[0].earnedTrophies.bronze = 1;
+
+    LibraryDelta delta = diffLibrary(previous, current);
+
+    CHECK_EQ(delta.changed.size(), size_t(1));
+    CHECK_EQ(delta.unchanged.size(), size_t(0));
+    CHECK_EQ(detailRequestCount(current[0]), 4);
+}
+
+TEST(detail_size_estimate_grows_with_its_trophies)
+{
+    TitleDetail empty;
+    TitleDetail full;
+    full.npCommunicationId = "NPWR00001_00";
+    for (int i = 0; i < 40; i++)
+    {
+        Trophy trophy;
+        trophy.trophyId = i;
+        trophy.trophyName = std::string(48, 'n');
+        trophy.trophyDetail = std::string(120, 'd');
+        full.trophies.push_back(trophy);
+    }
+
+    CHECK(approximateBytes(empty) >= sizeof(TitleDetail));
+    CHECK(approximateBytes(full) > approximateBytes(empty) + 40 * (sizeof(Trophy) + 168));
+}
+
 TEST(merged_trophy_round_trips_through_the_detail_cache_format)
 {
     Trophy original;
@@ -0,0 +1,194 @@
+#include "test_util.hpp"
+
+#include "psn_simulator.hpp"
+
+#include <string>
+#include <vector>
+
+using sim::Governor;
+using sim::PsnSimulator;
+using Fault = sim::PsnSimulator::Fault;
+
+namespace {
+
+// Titles plus two detail requests per title and two more for every fourth, grouped one.
+int syncRequestCount(int titles)
+{
+    return (titles + 99) / 100 + titles * 2 + ((titles + 3) / 4) * 2;
+}
+
+} // namespace
+
+TEST(simulator_serves_recorded_fixtures)
+{
+    PsnSimulator server;
+    server.serve("/api/trophy/v1/users/me/trophySummary",
+        R"({"accountId":"42","trophyLevel":328,"earnedTrophies":{"bronze":95,"silver":26,"gold":6,"platinum":1}})");
+    Governor governor(server);
+
+    psn::TrophySummary summary;
+    CHECK(governor.client().fetchSummary(summary).ok());
+    CHECK_EQ(summary.accountId, std::string("42"));
+    CHECK_EQ(summary.trophyLevel, 328);
+    CHECK_EQ(server.requests, 1);
+    CHECK_EQ(server.nowMs, server.latencyMs);
+}
+
+TEST(simulated_full_library_sync_of_1000_titles)
+{
+    PsnSimulator server;
+    server.seedLibrary(1000);
+    Governor governor(server, 100000);
+
+    sim::SyncReport report = sim::syncLibrary(server, governor);
+
+    CHECK(report.error.ok());
+    CHECK_EQ(report.titles, 1000);
+    CHECK_EQ(report.details, 1000);
+    CHECK_EQ(report.requests, syncRequestCount(1000));
+    CHECK_EQ(server.statuses[200], report.requests);
+    CHECK_EQ(server.perRoute["/api/trophy/v1/users/me/trophyTitles"], 10);
+    CHECK_EQ(server.perRoute["/api/trophy/v1/npCommunicationIds/{id}/trophyGroups"], 250);
+
+    // The burst limit, not latency, sets the pace: five requests a second.
+    CHECK(report.elapsedMs >= (report.requests / 5 - 1) * 1000);
+    CHECK(report.elapsedMs <= (report.requests / 5 + 1) * 1000 + report.requests * server.latencyMs);
+}
+
+TEST(simulated_sync_stops_at_the_budget_or_waits_it_out)
+{
+    PsnSimulator server;
+    server.seedLibrary(200);
+    Governor refusing(server, 300, 900);
+
+    sim::SyncReport cut = sim::syncLibrary(server, refusing);
+    CHECK(cut.error.status == psn::Status::RateLimited);
+    CHECK_EQ(cut.requests, 300);
+    CHECK(refusing.refused == 1);
+
+    PsnSimulator patient;
+    patient.seedLibrary(200);
+    Governor waiting(patient, 300, 900);
+    waiting.waitForBudget = true;
+
+    sim::SyncReport full = sim::syncLibrary(patient, waiting);
+    CHECK(full.error.ok());
+    CHECK_EQ(full.requests, syncRequestCount(200));
+    CHECK(full.elapsedMs >= 900 * 1000);
+    CHECK(waiting.waitedForBudgetMs > 0);
+}
+
+TEST(simulated_expired_token_is_refreshed_once)
+{
+    PsnSimulator server;
+    server.seedLibrary(3);
+    Governor governor(server);
+    server.revokeToken();
+
+    std::vector<psn::TrophyTitle> titles;
+    CHECK(governor.client().fetchTitles(titles).ok());
+    CHECK_EQ(titles.size(), 3u);
+    CHECK_EQ(governor.refreshes, 1);
+    CHECK_EQ(server.statuses[401], 1);
+
+    server.inject({Fault::Kind::Unauthorized, "trophyTitles", 2});
+    titles.clear();
+    psn::Error error = governor.client().fetchTitles(titles);
+    CHECK(error.status == psn::Status::SessionExpired);
+    CHECK_EQ(governor.refreshes, 2);
+}
+
+TEST(simulated_429_opens_the_breaker_for_retry_after)
+{
+    PsnSimulator server;
+    server.seedLibrary(50);
+    server.nowMs = 10'000'000;
+    Governor governor(server);
+    server.inject({Fault::Kind::Throttle, "/trophyGroups/all/trophies", 1, 1800});
+
+    sim::SyncReport report = sim::syncLibrary(server, governor);
+    CHECK(report.error.status == psn::Status::RateLimited);
+    CHECK_EQ(report.details, 0);
+    CHECK_EQ(server.statuses[429], 1);
+
+    int64_t now = server.nowMs / 1000;
+    CHECK_EQ(governor.budget.status(now).breakerUntil, now + 1800);
+
+    // Nothing more reaches the server while the breaker is open.
+    int before = server.requests;
+    std::string body;
+    CHECK(governor.get(std::string(PsnSimulator::ORIGIN) + "/api/trophy/v1/users/me/trophySummary", body).status ==
+        psn::Status::RateLimited);
+    CHECK_EQ(server.requests, before);
+}
+
+TEST(simulated_truncated_body_fails_without_a_retry)
+{
+    PsnSimulator server;
+    server.seedLibrary(5);
+    Governor governor(server);
+    server.inject({Fault::Kind::Truncate, "trophyTitles", 1, 40});
+
+    std::vector<psn::TrophyTitle> titles;
+    psn::Error error = governor.client().fetchTitles(titles);
+    CHECK(error.status == psn::Status::ServerError);
+    CHECK_EQ(server.requests, 1);
+    CHECK_EQ(governor.retries, 0);
+}
+
+TEST(simulated_timeouts_and_5xx_are_retried_with_backoff)
+{
+    PsnSimulator server;
+    server.seedLibrary(5);
+    Governor governor(server);
+    server.inject({Fault::Kind::Timeout, "trophyTitles", 2});
+
+    std::vector<psn::TrophyTitle> titles;
+    CHECK(governor.client().fetchTitles(titles).ok());
+    CHECK_EQ(titles.size(), 5u);
+    CHECK_EQ(governor.retries, 2);
+    CHECK(server.nowMs >= 2 * server.timeoutMs + 2000 + 4000);
+
+    server.inject({Fault::Kind::ServerError, "trophySummary", -1});
+    psn::TrophySummary summary;
+    psn::Error error = governor.client().fetchSummary(summary);
+    CHECK(error.status == psn::Status::ServerError);
+    CHECK_EQ(server.statuses[503], psn::RetryPolicy::MAX_ATTEMPTS);
+}
+
+TEST(simulated_latency_shows_up_in_sync_time)
+{
+    PsnSimulator fast;
+    fast.seedLibrary(40);
+    Governor fastGovernor(fast, 100000);
+    sim::SyncReport quick = sim::syncLibrary(fast, fastGovernor);
+
+    PsnSimulator slow;
+    slow.seedLibrary(40);
+    slow.inject({Fault::Kind::Latency, "", -1, 400});
+    Governor slowGovernor(slow, 100000);
+    sim::SyncReport laggy = sim::syncLibrary(slow, slowGovernor);
+
+    CHECK(quick.error.ok() && laggy.error.ok());
+    CHECK_EQ(quick.requests, laggy.requests);
+    CHECK(laggy.elapsedMs >= quick.elapsedMs + 400 * (laggy.requests / 2));
+}
+
+TEST(retry_policy_reads_retry_after_and_caps_it)
+{
+    psn::Reply throttled{false, 429, "120", ""};
+    CHECK_EQ(psn::RetryPolicy::judge(throttled, 1, false).cooldownSeconds, psn::RetryPolicy::THROTTLE_SECONDS);
+
+    throttled.retryAfter = "7200";
+    CHECK_EQ(psn::RetryPolicy::judge(throttled, 1, false).cooldownSeconds, psn::RetryPolicy::THROTTLE_MAX_SECONDS);
+
+    throttled.retryAfter = "Wed, 21 Oct 2015 07:28:00 GMT";
+    CHECK_EQ(psn::RetryPolicy::judge(throttled, 1, false).cooldownSeconds, psn::RetryPolicy::THROTTLE_SECONDS);
+
+    psn::Reply notFound{false, 404, "", ""};
+    CHECK(psn::RetryPolicy::judge(notFound, 1, false).next == psn::Next::Fail);
+
+    psn::Reply dropped{true, 0, "", "reset"};
+    CHECK_EQ(psn::RetryPolicy::judge(dropped, 2, false).backoffSeconds, 4);
+    CHECK(psn::RetryPolicy::judge(dropped, psn::RetryPolicy::MAX_ATTEMPTS, false).next == psn::Next::Fail);
+}
@@ -0,0 +1,232 @@
+#include "test_util.hpp"
+
+#include "core/request_budget.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int WINDOW = 900;
+
+struct Request {
+    int64_t at;
+    BudgetScope scope;
+};
+
+// A two-hour session: a full trophy library sync on launch and a smaller one later, the
+// home screen polling presence every minute plus device listings on each visit to the
+// host list, and cloud catalog refreshes while browsing the cloud tab.
+std::vector<Request> sessionTrace()
+{
+    std::vector<Request> trace;
+    for (int i = 0; i < 180; i++)
+        trace.push_back({i / 2, BudgetScope::Trophy});
+    for (int i = 0; i < 60; i++)
+        trace.push_back({3600 + i, BudgetScope::Trophy});
+
+    for (int64_t t = 0; t < 7200; t += 60)
+        trace.push_back({t, BudgetScope::Presence});
+    for (int64_t t = 30; t < 7200; t += 900)
+    {
+        trace.push_back({t, BudgetScope::Presence});
+        trace.push_back({t + 1, BudgetScope::Presence});
+    }
+
+    for (int64_t t = 120; t < 7200; t += 600)
+        for (int i = 0; i < 12; i++)
+            trace.push_back({t + i, BudgetScope::Cloud});
+
+    std::stable_sort(trace.begin(), trace.end(),
+        [](const Request& a, const Request& b) { return a.at < b.at; });
+    return trace;
+}
+
+struct Outcome {
+    std::array<int, BUDGET_SCOPE_COUNT> granted{};
+    std::array<int, BUDGET_SCOPE_COUNT> refused{};
+};
+
+// Replays a trace; the first trophy request at or after `throttleAt` is answered with a 429.
+Outcome replay(std::array<RequestBudget, BUDGET_SCOPE_COUNT>& budgets, const std::vector<Request>& trace,
+    int64_t throttleAt, bool shared)
+{
+    Outcome outcome;
+    bool throttled = false;
+    for (const Request& request : trace)
+    {
+        size_t scope = static_cast<size_t>(request.scope);
+        RequestBudget& budget = budgets[shared ? 0 : scope];
+
+        std::string reason;
+        if (!budget.tryAcquire(request.at, reason))
+        {
+            outcome.refused[scope]++;
+            continue;
+        }
+        outcome.granted[scope]++;
+
+        if (!throttled && request.scope == BudgetScope::Trophy && request.at >= throttleAt)
+        {
+            budget.throttle(request.at, 900);
+            throttled = true;
+        }
+    }
+    return outcome;
+}
+
+int maxInAnyWindow(const std::vector<int64_t>& granted, int64_t window)
+{
+    int worst = 0;
+    size_t start = 0;
+    for (size_t end = 0; end < granted.size(); end++)
+    {
+        while (granted[end] - granted[start] >= window)
+            start++;
+        worst = std::max(worst, static_cast<int>(end - start + 1));
+    }
+    return worst;
+}
+
+} // namespace
+
+TEST(sliding_buckets_count_and_expire_whole_buckets)
+{
+    SlidingBuckets window(WINDOW);
+    CHECK_EQ(window.bucketSeconds(), 15);
+
+    window.add(1000);
+    window.add(1010, 2);
+    window.add(1020);
+    CHECK_EQ(window.used(1020), 4);
+
+    // The first bucket covers 990..1004 and leaves once all of it is older than the window.
+    CHECK_EQ(window.nextRelease(1020), 990 + WINDOW + 15);
+    CHECK_EQ(window.used(1000 + WINDOW), 4);
+    CHECK_EQ(window.used(990 + WINDOW + 15), 3);
+    CHECK_EQ(window.used(5000), 0);
+    CHECK_EQ(window.nextRelease(5000), 5000);
+
+    // Stale charges are dropped rather than resurrected.
+    window.add(100);
+    CHECK_EQ(window.used(5000), 0);
+}
+
+TEST(sliding_buckets_never_undercount_an_exact_window)
+{
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> gap(0, 40);
+
+    SlidingBuckets window(WINDOW);
+    std::deque<int64_t> exact;
+    int64_t now = 1'000'000;
+
+    for (int i = 0; i < 5000; i++)
+    {
+        now += gap(rng);
+        window.add(now);
+        exact.push_back(now);
+
+        while (!exact.empty() && exact.front() <= now - WINDOW)
+            exact.pop_front();
+        int slack = static_cast<int>(std::count_if(exact.begin(), exact.end(),
+            [&](int64_t at) { return at > now - WINDOW - window.bucketSeconds(); }));
+
+        int used = window.used(now);
+        CHECK(used >= static_cast<int>(exact.size()));
+        CHECK(used <= slack + static_cast<int>(exact.size()));
+    }
+}
+
+TEST(sliding_buckets_resize_keeps_live_charges)
+{
+    SlidingBuckets window(WINDOW);
+    for (int64_t t = 0; t < 300; t += 10)
+        window.add(10'000 + t);
+    CHECK_EQ(window.used(10'300), 30);
+
+    window.resize(3600);
+    CHECK_EQ(window.used(10'300), 30);
+    CHECK_EQ(window.used(10'000 + 3600 + 300 + 60), 0);
+}
+
+TEST(request_budget_holds_the_limit_in_every_window)
+{
+    RequestBudget budget(100, WINDOW);
+    std::vector<int64_t> granted;
+    std::string reason;
+
+    for (int64_t t = 0; t < 4 * WINDOW; t++)
+    {
+        for (int burst = 0; burst < 3; burst++)
+        {
+            if (budget.tryAcquire(t, reason))
+                granted.push_back(t);
+        }
+    }
+
+    CHECK(maxInAnyWindow(granted, WINDOW) <= 100);
+    // Bucketing costs at most one bucket of extra wait per window.
+    CHECK(static_cast<int>(granted.size()) >= 4 * 100 * WINDOW / (WINDOW + 15));
+    CHECK(reason.find("Request budget used up") != std::string::npos);
+}
+
+TEST(request_budget_tightens_after_a_throttle_then_recovers)
+{
+    RequestBudget budget(300, WINDOW);
+    CHECK_EQ(budget.limitAt(1000), 300);
+
+    CHECK_EQ(budget.throttle(1000, 100000), 1000 + RequestBudget::BREAKER_MAX_SECONDS);
+    CHECK_EQ(budget.limitAt(1001), 150);
+
+    std::string reason;
+    CHECK(!budget.tryAcquire(1500, reason));
+    CHECK(reason.find("resume in") != std::string::npos);
+    CHECK(budget.tryAcquire(1000 + RequestBudget::BREAKER_MAX_SECONDS, reason));
+
+    CHECK_EQ(budget.limitAt(1000 + RequestBudget::TIGHTEN_SECONDS), 300);
+    CHECK_EQ(budget.status(1000 + RequestBudget::TIGHTEN_SECONDS).throttleCount, 1);
+}
+
+TEST(request_budget_throttle_stays_in_its_own_scope)
+{
+    std::vector<Request> trace = sessionTrace();
+
+    std::array<RequestBudget, BUDGET_SCOPE_COUNT> scoped{
+        RequestBudget{300, WINDOW}, RequestBudget{40, WINDOW}, RequestBudget{240, WINDOW}};
+    Outcome split = replay(scoped, trace, 60, false);
+
+    // The trophy sync is cut short by its breaker, and the later sync meets a halved limit...
+    CHECK(split.refused[0] > 0);
+    CHECK(scoped[0].status(3700).limit == 150);
+
+    // ...while presence polling and cloud browsing never notice.
+    CHECK_EQ(split.refused[1], 0);
+    CHECK_EQ(split.refused[2], 0);
+    CHECK_EQ(scoped[1].status(3700).limit, 40);
+    CHECK_EQ(scoped[2].status(3700).limit, 240);
+
+    // The single shared budget this replaces stalls every feature behind the trophy 429.
+    std::array<RequestBudget, BUDGET_SCOPE_COUNT> shared{
+        RequestBudget{300, WINDOW}, RequestBudget{}, RequestBudget{}};
+    Outcome global = replay(shared, trace, 60, true);
+    CHECK(global.refused[1] > 0);
+    CHECK(global.refused[2] > 0);
+}
+
+TEST(request_budget_spend_uses_up_the_window)
+{
+    RequestBudget budget(50, WINDOW);
+    budget.spend(2000);
+
+    std::string reason;
+    CHECK(!budget.tryAcquire(2001, reason));
+    CHECK_EQ(budget.status(2001).remaining(), 0);
+    CHECK(budget.status(2001).bucketResetsAt <= 2000 + WINDOW + 15);
+    CHECK(budget.tryAcquire(2000 + WINDOW + 15, reason));
+}
@@ -0,0 +1,125 @@
+#include "test_util.hpp"
+
+#include "util/row_offset_tree.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+double naiveOffset(const std::vector<float>& heights, size_t row)
+{
+    double sum = 0;
+    for (size_t i = 0; i < row && i < heights.size(); i++)
+        sum += heights[i];
+    return sum;
+}
+
+// xorshift, so the sequence is the same on every run.
+uint32_t nextRandom(uint32_t& state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+bool offsetsMatch(const RowOffsetTree& tree, const std::vector<float>& heights)
+{
+    for (size_t row = 0; row <= heights.size(); row++)
+        if (std::abs(tree.offsetOf(row) - naiveOffset(heights, row)) > 1e-6)
+            return false;
+    return true;
+}
+
+} // namespace
+
+TEST(row_offset_tree_matches_prefix_sums_through_edits)
+{
+    uint32_t state = 0x2545f491;
+    std::vector<float> heights;
+    for (int i = 0; i < 37; i++)
+        heights.push_back(float(20 + nextRandom(state) % 200));
+
+    RowOffsetTree tree;
+    tree.assign(heights);
+    CHECK_EQ(tree.size(), heights.size());
+    CHECK(offsetsMatch(tree, heights));
+
+    // A measured cell replacing its estimate, as addCellAt does.
+    for (int i = 0; i < 200; i++)
+    {
+        size_t row = nextRandom(state) % heights.size();
+        heights[row] = float(nextRandom(state) % 300);
+        tree.set(row, heights[row]);
+    }
+    CHECK(offsetsMatch(tree, heights));
+    CHECK(std::abs(tree.total() - naiveOffset(heights, heights.size())) < 1e-6);
+
+    // Appended pages, as notifyDataChanged does, crossing several powers of two.
+    for (int i = 0; i < 100; i++)
+    {
+        heights.push_back(float(10 + nextRandom(state) % 90));
+        tree.push_back(heights.back());
+    }
+    CHECK(offsetsMatch(tree, heights));
+    tree.set(3, 0);
+    heights[3] = 0;
+    tree.set(heights.size() - 1, 500);
+    heights.back() = 500;
+    CHECK(offsetsMatch(tree, heights));
+
+    // Rows past the end are clamped and ignored.
+    CHECK(std::abs(tree.offsetOf(heights.size() + 10) - tree.total()) < 1e-6);
+    tree.set(heights.size() + 10, 999);
+    CHECK(offsetsMatch(tree, heights));
+
+    RowOffsetTree grown;
+    for (float h : heights)
+        grown.push_back(h);
+    CHECK(offsetsMatch(grown, heights));
+
+    grown.clear();
+    CHECK_EQ(grown.size(), size_t(0));
+    CHECK(grown.total() == 0);
+}
+
+TEST(row_offset_tree_finds_the_row_under_a_position)
+{
+    RowOffsetTree tree;
+    CHECK_EQ(tree.rowAt(100), size_t(0));
+
+    tree.assign({100, 50, 0, 25, 200});
+    CHECK_EQ(tree.rowAt(-5), size_t(0));
+    CHECK_EQ(tree.rowAt(0), size_t(0));
+    CHECK_EQ(tree.rowAt(99.5), size_t(0));
+    CHECK_EQ(tree.rowAt(100), size_t(1));
+    CHECK_EQ(tree.rowAt(149), size_t(1));
+    // The zero-height row never covers anything.
+    CHECK_EQ(tree.rowAt(150), size_t(3));
+    CHECK_EQ(tree.rowAt(175), size_t(4));
+    CHECK_EQ(tree.rowAt(374), size_t(4));
+    CHECK_EQ(tree.rowAt(375), size_t(4));
+    CHECK_EQ(tree.rowAt(1e9), size_t(4));
+
+    // Against a linear scan over random heights and positions.
+    uint32_t state = 0x9e3779b9;
+    std::vector<float> heights;
+    for (int i = 0; i < 1000; i++)
+        heights.push_back(float(1 + nextRandom(state) % 400));
+    tree.assign(heights);
+
+    bool agree = true;
+    for (int i = 0; i < 500; i++)
+    {
+        double position = double(nextRandom(state) % uint32_t(tree.total()));
+        size_t expected = 0;
+        while (expected + 1 < heights.size() && naiveOffset(heights, expected + 1) <= position)
+            expected++;
+        size_t row = tree.rowAt(position);
+        agree = agree && row == expected && tree.offsetOf(row) <= position &&
+            position < tree.offsetOf(row + 1);
+    }
+    CHECK(agree);
+}
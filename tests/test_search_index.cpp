@@ -0,0 +1,107 @@
+#include "test_util.hpp"
+
+#include "catalog_fixture.hpp"
+#include "cloud/search_index.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using cloud::Game;
+using cloud::SearchIndex;
+
+namespace {
+
+Game titled(const std::string& name, bool streamable = true)
+{
+    Game game;
+    game.productId = name;
+    game.name = name;
+    if (streamable)
+    {
+        game.streamServiceType = "psnow";
+        game.streamIdentifier = name;
+        game.category = "streamable";
+    }
+    return game;
+}
+
+std::vector<std::string> names(const std::vector<Game>& games, const std::vector<uint32_t>& ids)
+{
+    std::vector<std::string> out;
+    for (uint32_t id : ids)
+        out.push_back(games[id].name);
+    return out;
+}
+
+// The scan LibraryView did before the index, on folded titles.
+std::vector<uint32_t> scan(const std::vector<Game>& games, const std::string& query)
+{
+    std::string needle = SearchIndex::fold(query);
+    std::vector<uint32_t> out;
+    for (uint32_t id = 0; id < games.size(); id++)
+        if (SearchIndex::fold(games[id].name).find(needle) != std::string::npos)
+            out.push_back(id);
+    return out;
+}
+
+} // namespace
+
+TEST(search_folding_strips_case_accents_and_punctuation)
+{
+    CHECK_EQ(SearchIndex::fold("Pokémon Café"), std::string("pokemon cafe"));
+    CHECK_EQ(SearchIndex::fold("ÖDE: Señor!"), std::string("ode senor"));
+    CHECK_EQ(SearchIndex::fold("Marvel’s Spider-Man™"), std::string("marvels spider man"));
+    CHECK_EQ(SearchIndex::fold("  Straße  Œuvre  "), std::string("strasse oeuvre"));
+    CHECK_EQ(SearchIndex::fold("ŁÓDŹ Ǉ"), std::string("lodz Ǉ"));
+    CHECK_EQ(SearchIndex::fold("グランツーリスモ 7"), std::string("グランツーリスモ 7"));
+    CHECK_EQ(SearchIndex::fold(std::string("bad\xC3")), std::string("bad\xC3"));
+}
+
+TEST(search_matches_substrings_of_folded_titles)
+{
+    std::vector<Game> games = {titled("Marvel's Spider-Man"), titled("Pokémon Café Mix"),
+        titled("Gran Turismo 7"), titled("Spidersaurs", false), titled("Astro Bot")};
+    SearchIndex index;
+    index.assign(games);
+
+    CHECK(names(games, index.search("spider man", SearchIndex::Order::NameAscending)) ==
+        std::vector<std::string>{"Marvel's Spider-Man"});
+    CHECK(names(games, index.search("POKEMON", SearchIndex::Order::Featured)) ==
+        std::vector<std::string>{"Pokémon Café Mix"});
+    CHECK(names(games, index.search("ider", SearchIndex::Order::NameAscending)) ==
+        (std::vector<std::string>{"Marvel's Spider-Man", "Spidersaurs"}));
+    CHECK(index.search("xyz", SearchIndex::Order::Featured).empty());
+    CHECK_EQ(index.search("", SearchIndex::Order::Featured).size(), games.size());
+}
+
+TEST(search_orders_are_precomputed)
+{
+    std::vector<Game> games = {titled("beta", false), titled("Alpha"), titled("Ölfass"), titled("gamma", false)};
+    SearchIndex index;
+    index.assign(games);
+
+    CHECK(names(games, index.search("", SearchIndex::Order::Featured)) ==
+        (std::vector<std::string>{"Alpha", "Ölfass", "beta", "gamma"}));
+    CHECK(names(games, index.search("", SearchIndex::Order::NameAscending)) ==
+        (std::vector<std::string>{"Alpha", "beta", "gamma", "Ölfass"}));
+    CHECK(names(games, index.search("a", SearchIndex::Order::NameDescending)) ==
+        (std::vector<std::string>{"Ölfass", "gamma", "beta", "Alpha"}));
+}
+
+TEST(search_narrowing_agrees_with_a_full_scan)
+{
+    std::vector<Game> games = fixtures::syntheticCatalog(600).games;
+    SearchIndex index;
+    index.assign(games);
+
+    // Typed one character at a time, then edited back and retyped differently.
+    for (const char* query : {"s", "sh", "sha", "shad", "shado", "shadow", "shadow ", "shadow c", "sha",
+             "sac", "sackboy 1", "ö", "öd", "ode", "cafe", "café 4", "x", ""})
+    {
+        std::vector<uint32_t> got = index.search(query, SearchIndex::Order::Featured);
+        std::sort(got.begin(), got.end());
+        CHECK_EQ(got.size(), scan(games, query).size());
+        CHECK(got == scan(games, query));
+    }
+}
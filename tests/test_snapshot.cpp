@@ -0,0 +1,354 @@
+#include "test_util.hpp"
+
+#include "psn/snapshot.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <format>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace psn;
+
+namespace {
+
+std::vector<TrophyTitle> sampleLibrary()
+{
+    std::vector<TrophyTitle> titles(3);
+
+    titles[0].npCommunicationId = "NPWR00001_00";
+    titles[0].npServiceName = "trophy2";
+    titles[0].trophyTitleName = "Astro's Playroom";
+    titles[0].trophyTitleIconUrl = "https://image.api.playstation.com/trophy/np/NPWR00001_00/icon.png";
+    titles[0].trophyTitlePlatform = "PS5";
+    titles[0].hasTrophyGroups = true;
+    titles[0].trophyGroupCount = 2;
+    titles[0].definedTrophies = {40, 10, 4, 1};
+    titles[0].earnedTrophies = {40, 10, 4, 1};
+    titles[0].progress = 100;
+    titles[0].lastUpdatedDateTime = "2026-01-01T00:00:00Z";
+
+    titles[1].npCommunicationId = "NPWR00002_00";
+    titles[1].npServiceName = "trophy";
+    titles[1].trophyTitleName = "\xe3\x83\x88\xe3\x83\xad\xe3\x83\x95\xe3\x82\xa3\xe3\x83\xbc";
+    titles[1].trophyTitlePlatform = "PS4";
+    titles[1].hiddenFlag = true;
+    titles[1].lastUpdatedDateTime = "2026-01-01T00:00:00Z";
+
+    titles[2].npCommunicationId = "NPWR00003_00";
+
+    return titles;
+}
+
+TitleDetail sampleDetail()
+{
+    TitleDetail detail;
+    detail.npCommunicationId = "NPWR00001_00";
+    detail.npServiceName = "trophy2";
+    detail.lastUpdatedDateTime = "2026-01-01T00:00:00Z";
+
+    detail.groups.resize(2);
+    detail.groups[0].trophyGroupId = "default";
+    detail.groups[0].trophyGroupName = "Base game";
+    detail.groups[0].definedTrophies = {30, 5, 2, 1};
+    detail.groups[0].earnedTrophies = {3, 0, 0, 0};
+    detail.groups[0].progress = 9;
+    detail.groups[1].trophyGroupId = "001";
+    detail.groups[1].trophyGroupName = "DLC";
+
+    detail.trophies.resize(2);
+    detail.trophies[0].trophyId = 0;
+    detail.trophies[0].trophyName = "Everything";
+    detail.trophies[0].trophyType = "platinum";
+    detail.trophies[0].trophyGroupId = "default";
+    detail.trophies[0].trophyRare = 0;
+    detail.trophies[0].trophyEarnedRate = 1.25;
+    detail.trophies[1].trophyId = 42;
+    detail.trophies[1].trophyName = "Grinder";
+    detail.trophies[1].trophyType = "bronze";
+    detail.trophies[1].trophyGroupId = "001";
+    detail.trophies[1].trophyHidden = true;
+    detail.trophies[1].earned = true;
+    detail.trophies[1].earnedDateTime = "2026-01-02T03:04:05Z";
+    detail.trophies[1].hasProgress = true;
+    detail.trophies[1].progress = 4000000000LL;
+    detail.trophies[1].progressTarget = 5000000000LL;
+    detail.trophies[1].progressRate = 80;
+    detail.trophies[1].progressedDateTime = "2026-01-02T03:04:05Z";
+
+    return detail;
+}
+
+uint32_t fnv1a(const std::string& bytes, size_t from)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = from; i < bytes.size(); i++)
+    {
+        hash ^= static_cast<uint8_t>(bytes[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Rewrites a header field and reseals the checksum, so the test reaches the structural
+// checks that sit behind it.
+template <typename T>
+std::string forge(std::string bytes, size_t at, T value)
+{
+    std::memcpy(bytes.data() + at, &value, sizeof(T));
+    uint32_t sum = fnv1a(bytes, 32);
+    std::memcpy(bytes.data() + 24, &sum, sizeof(sum));
+    return bytes;
+}
+
+} // namespace
+
+TEST(summary_round_trips_through_a_snapshot)
+{
+    TrophySummary summary;
+    summary.accountId = "1234567890123456789";
+    summary.trophyLevel = 328;
+    summary.tier = 4;
+    summary.progress = 61;
+    summary.trophyPoint = 123456;
+    summary.earnedTrophies = {2000, 600, 150, 40};
+
+    TrophySummary decoded;
+    int64_t savedAt = 0;
+    CHECK(decodeSnapshot(encodeSnapshot(summary, 1760000000), decoded, savedAt));
+    CHECK_EQ(savedAt, int64_t(1760000000));
+    CHECK_EQ(decoded.accountId, summary.accountId);
+    CHECK_EQ(decoded.trophyLevel, 328);
+    CHECK_EQ(decoded.tier, 4);
+    CHECK_EQ(decoded.trophyPoint, 123456);
+    CHECK_EQ(decoded.earnedTrophies.platinum, 40);
+}
+
+TEST(library_round_trips_through_a_snapshot)
+{
+    std::vector<TrophyTitle> titles = sampleLibrary();
+
+    std::vector<TrophyTitle> decoded;
+    int64_t savedAt = 0;
+    CHECK(decodeSnapshot(encodeSnapshot(titles, 7), decoded, savedAt));
+    CHECK_EQ(savedAt, int64_t(7));
+    CHECK_EQ(decoded.size(), titles.size());
+
+    for (size_t i = 0; i < titles.size() && i < decoded.size(); i++)
+    {
+        CHECK_EQ(decoded[i].npCommunicationId, titles[i].npCommunicationId);
+        CHECK_EQ(decoded[i].npServiceName, titles[i].npServiceName);
+        CHECK_EQ(decoded[i].trophyTitleName, titles[i].trophyTitleName);
+        CHECK_EQ(decoded[i].trophyTitleIconUrl, titles[i].trophyTitleIconUrl);
+        CHECK_EQ(decoded[i].hasTrophyGroups, titles[i].hasTrophyGroups);
+        CHECK_EQ(decoded[i].hiddenFlag, titles[i].hiddenFlag);
+        CHECK_EQ(decoded[i].trophyGroupCount, titles[i].trophyGroupCount);
+        CHECK_EQ(decoded[i].definedTrophies.total(), titles[i].definedTrophies.total());
+        CHECK_EQ(decoded[i].earnedTrophies.gold, titles[i].earnedTrophies.gold);
+        CHECK_EQ(decoded[i].progress, titles[i].progress);
+        CHECK_EQ(decoded[i].lastUpdatedDateTime, titles[i].lastUpdatedDateTime);
+    }
+}
+
+TEST(empty_library_round_trips_through_a_snapshot)
+{
+    std::vector<TrophyTitle> decoded = sampleLibrary();
+    int64_t savedAt = 0;
+    CHECK(decodeSnapshot(encodeSnapshot(std::vector<TrophyTitle>{}, 9), decoded, savedAt));
+    CHECK(decoded.empty());
+}
+
+TEST(detail_round_trips_through_a_snapshot)
+{
+    TitleDetail detail = sampleDetail();
+
+    TitleDetail decoded;
+    int64_t savedAt = 0;
+    CHECK(decodeSnapshot(encodeSnapshot(detail, 11), decoded, savedAt));
+    CHECK_EQ(decoded.npCommunicationId, detail.npCommunicationId);
+    CHECK_EQ(decoded.lastUpdatedDateTime, detail.lastUpdatedDateTime);
+    CHECK_EQ(decoded.groups.size(), size_t(2));
+    CHECK_EQ(decoded.groups[0].trophyGroupName, std::string("Base game"));
+    CHECK_EQ(decoded.groups[0].earnedTrophies.bronze, 3);
+    CHECK_EQ(decoded.groups[0].progress, 9);
+    CHECK_EQ(decoded.trophies.size(), size_t(2));
+    CHECK_EQ(decoded.trophies[0].trophyRare, 0);
+    CHECK_EQ(decoded.trophies[0].trophyEarnedRate, 1.25);
+    CHECK_EQ(decoded.trophies[1].trophyId, 42);
+    CHECK_EQ(decoded.trophies[1].trophyHidden, true);
+    CHECK_EQ(decoded.trophies[1].earned, true);
+    CHECK_EQ(decoded.trophies[1].hasProgress, true);
+    CHECK_EQ(decoded.trophies[1].progress, int64_t(4000000000LL));
+    CHECK_EQ(decoded.trophies[1].progressTarget, int64_t(5000000000LL));
+    CHECK_EQ(decoded.trophies[1].progressRate, 80);
+    CHECK_EQ(decoded.trophies[1].progressedDateTime, detail.trophies[1].progressedDateTime);
+}
+
+TEST(snapshot_strings_are_stored_once)
+{
+    std::vector<TrophyTitle> titles(50);
+    for (TrophyTitle& title : titles)
+    {
+        title.npCommunicationId = "NPWR00001_00";
+        title.trophyTitleIconUrl = std::string(200, 'x');
+    }
+
+    std::string bytes = encodeSnapshot(titles, 0);
+    CHECK(bytes.size() < 50 * 106 + 32 + 16 + 400);
+}
+
+TEST(snapshot_of_the_wrong_kind_is_rejected)
+{
+    std::vector<TrophyTitle> titles;
+    TitleDetail detail;
+    TrophySummary summary;
+    int64_t savedAt = 0;
+
+    std::string library = encodeSnapshot(sampleLibrary(), 1);
+    CHECK(!decodeSnapshot(library, detail, savedAt));
+    CHECK(!decodeSnapshot(library, summary, savedAt));
+    CHECK(!decodeSnapshot(encodeSnapshot(sampleDetail(), 1), titles, savedAt));
+}
+
+TEST(detail_snapshot_without_trophies_is_a_miss)
+{
+    TitleDetail detail = sampleDetail();
+    detail.trophies.clear();
+
+    TitleDetail decoded;
+    int64_t savedAt = 0;
+    CHECK(!decodeSnapshot(encodeSnapshot(detail, 1), decoded, savedAt));
+}
+
+TEST(every_truncation_of_a_snapshot_is_rejected)
+{
+    std::string bytes = encodeSnapshot(sampleDetail(), 1);
+
+    int accepted = 0;
+    for (size_t length = 0; length < bytes.size(); length++)
+    {
+        TitleDetail decoded;
+        int64_t savedAt = 0;
+        if (decodeSnapshot(std::string_view(bytes).substr(0, length), decoded, savedAt))
+            accepted++;
+    }
+    CHECK_EQ(accepted, 0);
+}
+
+TEST(every_flipped_byte_in_a_snapshot_is_rejected)
+{
+    std::string bytes = encodeSnapshot(sampleLibrary(), 1);
+
+    int accepted = 0;
+    for (size_t i = 0; i < bytes.size(); i++)
+    {
+        // savedAt and the reserved word are not covered by the checksum.
+        if ((i >= 8 && i < 16) || (i >= 28 && i < 32))
+            continue;
+
+        std::string damaged = bytes;
+        damaged[i] = static_cast<char>(damaged[i] ^ 0x5A);
+
+        std::vector<TrophyTitle> decoded;
+        int64_t savedAt = 0;
+        if (decodeSnapshot(damaged, decoded, savedAt))
+            accepted++;
+    }
+    CHECK_EQ(accepted, 0);
+}
+
+TEST(snapshot_with_a_resealed_bad_layout_is_rejected)
+{
+    std::string bytes = encodeSnapshot(sampleLibrary(), 1);
+    std::vector<TrophyTitle> decoded;
+    int64_t savedAt = 0;
+
+    // Section table: tag, record size, count, offset, starting just after the header.
+    CHECK(!decodeSnapshot(forge(bytes, 32 + 8, uint32_t(1000)), decoded, savedAt));
+    CHECK(!decodeSnapshot(forge(bytes, 32 + 4, uint32_t(64)), decoded, savedAt));
+    CHECK(!decodeSnapshot(forge(bytes, 32 + 12, uint32_t(0xFFFFFFF0)), decoded, savedAt));
+    CHECK(!decodeSnapshot(forge(bytes, 20, uint32_t(0x7FFFFFFF)), decoded, savedAt));
+    CHECK(!decodeSnapshot(forge(bytes, 16, uint32_t(0x10000000)), decoded, savedAt));
+    CHECK(!decodeSnapshot(forge(bytes, 4, uint16_t(SNAPSHOT_VERSION + 1)), decoded, savedAt));
+
+    // A string reference that runs off the end of the string table.
+    CHECK(!decodeSnapshot(forge(bytes, 32 + 16 + 4, uint32_t(0x00100000)), decoded, savedAt));
+}
+
+TEST(larger_records_from_a_newer_writer_are_still_read)
+{
+    std::vector<TrophyTitle> one(1, sampleLibrary().front());
+    std::string bytes = encodeSnapshot(one, 1);
+
+    // Widen the record by four bytes, as a writer appending a field would.
+    uint32_t recordSize = 0;
+    std::memcpy(&recordSize, bytes.data() + 32 + 4, sizeof(recordSize));
+    bytes.insert(32 + 16 + recordSize, 4, '\0');
+    bytes = forge(bytes, 32 + 4, recordSize + 4);
+
+    std::vector<TrophyTitle> decoded;
+    int64_t savedAt = 0;
+    CHECK(decodeSnapshot(bytes, decoded, savedAt));
+    CHECK_EQ(decoded.size(), size_t(1));
+    if (!decoded.empty())
+        CHECK_EQ(decoded[0].trophyTitleName, one[0].trophyTitleName);
+}
+
+TEST(snapshot_exports_the_legacy_json_document)
+{
+    std::string json;
+    CHECK(snapshotToJson(encodeSnapshot(sampleDetail(), 1760000000), json));
+
+    TitleDetail parsed;
+    int64_t savedAt = 0;
+    CHECK(parseCachedDetail(json, parsed, savedAt));
+    CHECK_EQ(savedAt, int64_t(1760000000));
+    CHECK_EQ(parsed.trophies.size(), size_t(2));
+    CHECK_EQ(parsed.groups.size(), size_t(2));
+
+    std::vector<TrophyTitle> titles;
+    CHECK(snapshotToJson(encodeSnapshot(sampleLibrary(), 5), json));
+    CHECK(parseCachedLibrary(json, titles, savedAt));
+    CHECK_EQ(titles.size(), size_t(3));
+
+    CHECK(!snapshotToJson("not a snapshot", json));
+}
+
+// A JSON cache from before the snapshots loads, keeps its save time, and is replaced by a
+// snapshot beside it.
+TEST(legacy_json_cache_is_loaded_then_migrated)
+{
+    std::string path = std::format("/tmp/akira_snapshot_library_{}.bin", getpid());
+    std::string legacyPath = legacyCachePath(path);
+    CHECK_EQ(legacyPath, std::format("/tmp/akira_snapshot_library_{}.json", getpid()));
+    remove(path.c_str());
+
+    std::string json;
+    CHECK(snapshotToJson(encodeSnapshot(sampleLibrary(), 1700000000), json));
+    FILE* file = fopen(legacyPath.c_str(), "wb");
+    fwrite(json.data(), 1, json.size(), file);
+    fclose(file);
+
+    std::vector<TrophyTitle> titles;
+    int64_t savedAt = 0;
+    CHECK(loadCacheFile(path, titles, savedAt));
+    CHECK_EQ(titles.size(), size_t(3));
+    CHECK_EQ(savedAt, int64_t(1700000000));
+
+    struct stat st;
+    CHECK(stat(legacyPath.c_str(), &st) != 0);
+    CHECK(stat(path.c_str(), &st) == 0);
+
+    titles.clear();
+    savedAt = 0;
+    CHECK(loadCacheFile(path, titles, savedAt));
+    CHECK_EQ(titles.size(), size_t(3));
+    CHECK_EQ(savedAt, int64_t(1700000000));
+
+    TrophySummary summary;
+    CHECK(!loadCacheFile(std::format("/tmp/akira_snapshot_missing_{}.bin", getpid()), summary, savedAt));
+    remove(path.c_str());
+}
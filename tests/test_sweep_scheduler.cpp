@@ -0,0 +1,277 @@
+#include "test_util.hpp"
+
+#include "core/discovery_sweep.hpp"
+#include "core/sweep_scheduler.hpp"
+
+#include <arpa/inet.h>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace akira::discovery;
+
+namespace {
+
+uint32_t ipNet(const char* s)
+{
+    struct in_addr ina = {};
+    inet_pton(AF_INET, s, &ina);
+    return ina.s_addr;
+}
+
+uint32_t ipHost(const char* s)
+{
+    return ntohl(ipNet(s));
+}
+
+std::string netToStr(uint32_t sAddrNet)
+{
+    struct in_addr ina = {};
+    ina.s_addr = sAddrNet;
+    char buf[INET_ADDRSTRLEN] = {};
+    inet_ntop(AF_INET, &ina, buf, sizeof(buf));
+    return std::string(buf);
+}
+
+size_t packets(const std::vector<SweepProbe>& probes)
+{
+    size_t n = 0;
+    for (const SweepProbe& probe : probes)
+        n += (probe.protocols & SWEEP_PS4 ? 1 : 0) + (probe.protocols & SWEEP_PS5 ? 1 : 0);
+    return n;
+}
+
+} // namespace
+
+TEST(sweep_scheduler_covers_a_subnet_then_backs_off_silent_hosts)
+{
+    SweepScheduler scheduler;
+    CHECK(scheduler.addSubnet(ipHost("192.168.50.0"), 24));
+    CHECK_EQ(scheduler.hostCount(), size_t(254));
+
+    // 64 packets a tick is 32 addresses on both protocols: the /24 takes eight ticks.
+    std::set<uint32_t> seen;
+    int64_t now = 1000;
+    int ticks = 0;
+    for (; ticks < 20 && seen.size() < 254; ticks++, now += 250)
+    {
+        std::vector<SweepProbe> probes = scheduler.next(now);
+        CHECK(packets(probes) <= 64);
+        for (const SweepProbe& probe : probes)
+        {
+            CHECK_EQ(int(probe.protocols), int(SWEEP_BOTH));
+            seen.insert(probe.addrNet);
+        }
+    }
+    CHECK_EQ(ticks, 8);
+    CHECK_EQ(seen.size(), size_t(254));
+    CHECK(!seen.count(ipNet("192.168.50.0")));
+    CHECK(!seen.count(ipNet("192.168.50.255")));
+
+    // Silent everywhere: nothing more until the first backoff runs out...
+    CHECK(scheduler.next(now).empty());
+    CHECK(scheduler.next(now + 10000).empty());
+    CHECK_EQ(scheduler.stats().passes, uint64_t(1));
+
+    // ...then the whole subnet again, after which the wait doubles.
+    size_t second = 0;
+    int64_t retry = 1000 + 15000;
+    for (int i = 0; i < 20; i++)
+        second += scheduler.next(retry + i * 250).size();
+    CHECK_EQ(second, size_t(254));
+    CHECK(scheduler.next(retry + 20000).empty());
+    CHECK(!scheduler.next(retry + 31000).empty());
+}
+
+TEST(sweep_scheduler_reprobes_responders_first_on_their_protocol)
+{
+    SweepScheduler::Config config;
+    config.packetsPerTick = 8;
+    SweepScheduler scheduler(config);
+    CHECK(scheduler.addSubnet(ipHost("10.0.7.0"), 24));
+
+    scheduler.next(0);
+    scheduler.noteResponse(ipNet("10.0.7.200"), SWEEP_PS5, 100);
+    scheduler.noteResponse(ipNet("10.0.7.20"), SWEEP_PS4, 200);
+    scheduler.noteResponse(ipNet("10.9.9.9"), SWEEP_PS4, 200);
+    CHECK_EQ(int(scheduler.protocolsOf(ipNet("10.0.7.200"))), int(SWEEP_PS5));
+    CHECK_EQ(int(scheduler.protocolsOf(ipNet("10.0.7.20"))), int(SWEEP_PS4));
+    CHECK_EQ(int(scheduler.protocolsOf(ipNet("10.9.9.9"))), 0);
+    CHECK_EQ(scheduler.stats().responders, size_t(2));
+
+    // Due a second after answering, most recent first, one packet each; the sweep gets
+    // what is left of the budget.
+    std::vector<SweepProbe> probes = scheduler.next(1200);
+    CHECK(probes.size() >= 2);
+    CHECK_EQ(netToStr(probes[0].addrNet), std::string("10.0.7.20"));
+    CHECK_EQ(int(probes[0].protocols), int(SWEEP_PS4));
+    CHECK_EQ(netToStr(probes[1].addrNet), std::string("10.0.7.200"));
+    CHECK_EQ(int(probes[1].protocols), int(SWEEP_PS5));
+    CHECK_EQ(packets(probes), size_t(8));
+
+    // A reply that does not name its protocol keeps the known one.
+    scheduler.noteResponse(ipNet("10.0.7.200"), SWEEP_BOTH, 1300);
+    CHECK_EQ(int(scheduler.protocolsOf(ipNet("10.0.7.200"))), int(SWEEP_PS5));
+
+    // The sweep itself never probes a responder.
+    bool sweptResponder = false;
+    for (int64_t t = 1250; t < 40000; t += 250)
+    {
+        for (const SweepProbe& probe : scheduler.next(t))
+            sweptResponder = sweptResponder ||
+                (probe.addrNet == ipNet("10.0.7.200") && probe.protocols == SWEEP_BOTH);
+        scheduler.noteResponse(ipNet("10.0.7.200"), SWEEP_PS5, t);
+    }
+    CHECK(!sweptResponder);
+}
+
+TEST(sweep_scheduler_backs_off_then_forgets_a_quiet_responder)
+{
+    SweepScheduler::Config config;
+    config.packetsPerTick = 4;
+    SweepScheduler scheduler(config);
+    CHECK(scheduler.addSubnet(ipHost("10.0.7.40"), 30));
+    scheduler.noteResponse(ipNet("10.0.7.41"), SWEEP_PS4, 0);
+
+    std::vector<int64_t> probedAt;
+    for (int64_t t = 0; t < 30 * 60 * 1000; t += 250)
+    {
+        for (const SweepProbe& probe : scheduler.next(t))
+        {
+            if (probe.addrNet == ipNet("10.0.7.41") && probe.protocols == SWEEP_PS4)
+                probedAt.push_back(t);
+        }
+    }
+
+    // A second apart until three have gone unanswered, then 15s, 30s, 60s... until it
+    // is forgotten.
+    CHECK(probedAt.size() >= 7);
+    CHECK_EQ(probedAt[0], int64_t(1000));
+    CHECK_EQ(probedAt[1], int64_t(2000));
+    CHECK_EQ(probedAt[2], int64_t(3000));
+    CHECK_EQ(probedAt[3], int64_t(4000));
+    CHECK_EQ(probedAt[4], int64_t(19000));
+    CHECK_EQ(probedAt[5], int64_t(49000));
+    CHECK_EQ(probedAt[6], int64_t(109000));
+    CHECK_EQ(probedAt.size(), size_t(config.forgetAfterMisses));
+    CHECK_EQ(scheduler.stats().responders, size_t(0));
+    CHECK_EQ(int(scheduler.protocolsOf(ipNet("10.0.7.41"))), 0);
+}
+
+TEST(sweep_scheduler_interleaves_wide_subnets_and_finishes_hot_blocks_first)
+{
+    SweepScheduler scheduler;
+    CHECK(!scheduler.addSubnet(ipHost("172.16.0.0"), 15));
+    CHECK(scheduler.addSubnet(ipHost("172.16.0.0"), 16));
+    CHECK_EQ(scheduler.hostCount(), size_t(65534));
+    CHECK(scheduler.addSubnet(ipHost("172.16.9.0"), 24));
+    CHECK_EQ(scheduler.hostCount(), size_t(65534));
+
+    SweepScheduler::Config small;
+    small.maxHosts = 1000;
+    SweepScheduler capped(small);
+    CHECK(!capped.addSubnet(ipHost("172.16.0.0"), 22));
+    CHECK(capped.addSubnet(ipHost("172.16.0.0"), 23));
+    CHECK_EQ(capped.hostCount(), size_t(510));
+
+    CHECK(scheduler.contains(ipNet("172.16.200.0")));
+    CHECK(scheduler.contains(ipNet("172.16.200.255")));
+    CHECK(!scheduler.contains(ipNet("172.16.0.0")));
+    CHECK(!scheduler.contains(ipNet("172.16.255.255")));
+    CHECK(!scheduler.contains(ipNet("172.17.0.1")));
+
+    // Host byte .1 of every /24 comes before .2 of any.
+    std::vector<SweepProbe> first = scheduler.next(0);
+    CHECK_EQ(first.size(), size_t(32));
+    CHECK_EQ(netToStr(first[0].addrNet), std::string("172.16.0.1"));
+    CHECK_EQ(netToStr(first[1].addrNet), std::string("172.16.1.1"));
+    CHECK_EQ(netToStr(first[31].addrNet), std::string("172.16.31.1"));
+
+    std::set<uint32_t> seen;
+    for (const SweepProbe& probe : first)
+        seen.insert(probe.addrNet);
+
+    // A console in 172.16.77.x: the rest of that /24, .0 and .255 included, is swept next.
+    scheduler.noteResponse(ipNet("172.16.77.23"), SWEEP_PS5, 100);
+    std::set<std::string> hot;
+    for (int i = 0; i < 8; i++)
+    {
+        for (const SweepProbe& probe : scheduler.next(250 + i * 250))
+        {
+            if (probe.protocols != SWEEP_BOTH)
+                continue;
+            seen.insert(probe.addrNet);
+            std::string addr = netToStr(probe.addrNet);
+            if (addr.rfind("172.16.77.", 0) == 0)
+                hot.insert(addr);
+        }
+    }
+    CHECK_EQ(hot.size(), size_t(255));
+    CHECK(!hot.count("172.16.77.23"));
+    CHECK(hot.count("172.16.77.0"));
+    CHECK(hot.count("172.16.77.255"));
+
+    // The interleaved walk picks up where it left off.
+    std::vector<SweepProbe> after = scheduler.next(2250);
+    CHECK(!after.empty());
+    CHECK_EQ(netToStr(after.back().addrNet), std::string("172.16.62.1"));
+
+    // Every host once per pass, network and broadcast never; the console keeps answering.
+    size_t probes = seen.size();
+    for (const SweepProbe& probe : after)
+    {
+        if (probe.protocols == SWEEP_BOTH)
+            seen.insert(probe.addrNet), probes++;
+    }
+    for (int64_t t = 2500; scheduler.stats().passes == 0; t += 250)
+    {
+        for (const SweepProbe& probe : scheduler.next(t))
+        {
+            if (probe.protocols == SWEEP_BOTH)
+                seen.insert(probe.addrNet), probes++;
+            else
+                scheduler.noteResponse(probe.addrNet, SWEEP_PS5, t);
+        }
+    }
+    CHECK_EQ(seen.size(), size_t(65533));
+    CHECK_EQ(probes, seen.size());
+    CHECK(!seen.count(ipNet("172.16.0.0")));
+    CHECK(!seen.count(ipNet("172.16.255.255")));
+    CHECK(!seen.count(ipNet("172.16.77.23")));
+}
+
+// A /16 gets a /24's worth of addresses at the full tick rate, then 32 a second, so the
+// router is not made to ARP for hundreds of empty addresses a second for half an hour.
+TEST(sweep_scheduler_paces_a_wide_subnet_after_the_first_burst)
+{
+    SweepScheduler scheduler;
+    CHECK(scheduler.addSubnet(ipHost("10.0.0.0"), 16));
+
+    size_t burst = 0;
+    int64_t now = 0;
+    for (int i = 0; i < 8; i++, now += 250)
+        burst += scheduler.next(now).size();
+    CHECK_EQ(burst, size_t(256));
+
+    // What the bucket earned during the burst goes out next.
+    while (scheduler.next(now).size() == 32)
+        now += 250;
+    now += 250;
+
+    size_t sustained = 0;
+    for (int i = 0; i < 40; i++, now += 250)
+    {
+        std::vector<SweepProbe> probes = scheduler.next(now);
+        CHECK(probes.size() <= 9);
+        sustained += probes.size();
+    }
+    CHECK(sustained >= 10 * 32 - 8 && sustained <= 10 * 32 + 8);
+
+    // Once the sweep goes quiet the bucket refills, and a /24 is swept at full rate again.
+    SweepScheduler lan;
+    CHECK(lan.addSubnet(ipHost("192.168.50.0"), 24));
+    for (int i = 0; i < 8; i++)
+        lan.next(i * 250);
+    CHECK_EQ(lan.next(15000).size(), size_t(32));
+}
@@ -0,0 +1,101 @@
+#include "test_util.hpp"
+
+#include "util/text_layout.hpp"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+// Every codepoint is 10 px wide and rows are 20 px tall.
+class FakeMetrics : public GlyphMetrics {
+public:
+    float width(std::string_view text) const override
+    {
+        float width = 0;
+        for (unsigned char c : text)
+            if ((c & 0xC0) != 0x80)
+                width += 10;
+        return width;
+    }
+
+    float lineHeight() const override { return 20; }
+};
+
+std::vector<std::string> rowTexts(std::string_view text, const std::vector<TextRow>& rows)
+{
+    std::vector<std::string> out;
+    for (const TextRow& row : rows)
+        out.emplace_back(text.substr(row.begin, row.end - row.begin));
+    return out;
+}
+
+std::vector<std::string> wrapped(std::string_view text, float width)
+{
+    return rowTexts(text, wrapText(text, width, FakeMetrics()));
+}
+
+} // namespace
+
+TEST(wrap_text_breaks_at_spaces_newlines_and_inside_long_words)
+{
+    using Rows = std::vector<std::string>;
+
+    CHECK(wrapped("", 100) == Rows{""});
+    CHECK(wrapped("short", 100) == Rows{"short"});
+    // The space at a break is dropped; a row exactly as wide as the text still fits it.
+    CHECK(wrapped("hello world again", 100) == (Rows{"hello", "world", "again"}));
+    CHECK(wrapped("hello world again", 110) == (Rows{"hello world", "again"}));
+    CHECK(wrapped("ab cd ef gh", 50) == (Rows{"ab cd", "ef gh"}));
+    CHECK(wrapped("one\n\ntwo", 100) == (Rows{"one", "", "two"}));
+
+    // A word wider than the row is split, and what is left of it is joined by what follows.
+    CHECK(wrapped("abcdefghij k", 40) == (Rows{"abcd", "efgh", "ij k"}));
+    // Multi-byte codepoints are never split.
+    CHECK(wrapped("\xC3\xA9\xC3\xA9\xC3\xA9", 20) == (Rows{"\xC3\xA9\xC3\xA9", "\xC3\xA9"}));
+    // A row narrower than one glyph still makes progress.
+    CHECK(wrapped("abc", 5) == (Rows{"a", "b", "c"}));
+}
+
+TEST(text_layout_cache_wraps_only_visible_new_lines_once)
+{
+    FakeMetrics metrics;
+    TextLayoutCache cache(100);
+    cache.setGeometry(300, 16);
+
+    for (int i = 0; i < 100; i++)
+        cache.append("line " + std::to_string(i) + " with some words");
+
+    // 60 px holds three one-row lines; only those and the one that did not fit are wrapped.
+    TextLayoutCache::Tail tail = cache.layoutTail(60, metrics);
+    CHECK_EQ(tail.first, size_t(97));
+    CHECK_EQ(tail.height, 60.0f);
+    CHECK_EQ(cache.wrapCount(), uint64_t(4));
+
+    // Idle frames reuse everything.
+    cache.setGeometry(300, 16);
+    cache.layoutTail(60, metrics);
+    CHECK_EQ(cache.wrapCount(), uint64_t(4));
+
+    // An appended line costs one wrap, and the oldest line beyond the cap goes.
+    cache.append("new");
+    tail = cache.layoutTail(60, metrics);
+    CHECK_EQ(cache.size(), size_t(100));
+    CHECK_EQ(tail.first, size_t(97));
+    CHECK_EQ(cache.line(tail.first).text, std::string("line 98 with some words"));
+    CHECK_EQ(cache.wrapCount(), uint64_t(5));
+
+    // A narrower view rewraps the visible lines: "line 99 with some words" takes two rows
+    // at 120 px, so only it and "new" fit.
+    CHECK(cache.setGeometry(120, 16));
+    tail = cache.layoutTail(60, metrics);
+    CHECK_EQ(tail.first, size_t(98));
+    CHECK_EQ(cache.line(tail.first).rows.size(), size_t(2));
+    CHECK_EQ(tail.height, 60.0f);
+
+    // A line taller than the whole view is not shown, as with nvgTextBox before.
+    cache.clear();
+    cache.append("a b c d e f g h");
+    tail = cache.layoutTail(20, metrics);
+    CHECK_EQ(tail.first, cache.size());
+}
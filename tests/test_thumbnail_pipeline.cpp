@@ -0,0 +1,255 @@
+#include "test_util.hpp"
+
+#include "util/thumbnail_pipeline.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+RgbaImage solid(int width, int height, uint8_t r, uint8_t g, uint8_t b, uint8_t a)
+{
+    RgbaImage image;
+    image.width = width;
+    image.height = height;
+    for (int i = 0; i < width * height; i++)
+        image.pixels.insert(image.pixels.end(), {r, g, b, a});
+    return image;
+}
+
+const uint8_t* pixelAt(const RgbaImage& image, int x, int y)
+{
+    return image.pixels.data() + (size_t(y) * image.width + x) * 4;
+}
+
+// Stand-in for PNG: an 8-byte width/height header, then straight RGBA.
+std::vector<uint8_t> encode(const RgbaImage& image)
+{
+    std::vector<uint8_t> out(8);
+    std::memcpy(out.data(), &image.width, 4);
+    std::memcpy(out.data() + 4, &image.height, 4);
+    out.insert(out.end(), image.pixels.begin(), image.pixels.end());
+    return out;
+}
+
+bool decodeRaw(const std::vector<uint8_t>& encoded, RgbaImage& out)
+{
+    if (encoded.size() < 8)
+        return false;
+    std::memcpy(&out.width, encoded.data(), 4);
+    std::memcpy(&out.height, encoded.data() + 4, 4);
+    out.pixels.assign(encoded.begin() + 8, encoded.end());
+    return out.pixels.size() == size_t(out.width) * out.height * 4;
+}
+
+// Collects deliveries the way brls::sync would, to be run on the "UI thread" by pump().
+struct Mailbox {
+    std::mutex mutex;
+    std::vector<std::function<void()>> posted;
+
+    ThumbnailPipeline::Deliver hook()
+    {
+        return [this](std::function<void()> task) {
+            std::lock_guard<std::mutex> lock(mutex);
+            posted.push_back(std::move(task));
+        };
+    }
+
+    // Runs what has been posted, waiting up to a second for at least `expected` tasks.
+    size_t pump(size_t expected)
+    {
+        std::vector<std::function<void()>> tasks;
+        for (int spin = 0; spin < 1000; spin++)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (posted.size() >= expected)
+                {
+                    tasks.swap(posted);
+                    break;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        for (auto& task : tasks)
+            task();
+        return tasks.size();
+    }
+};
+
+} // namespace
+
+TEST(thumbnail_downscale_fills_the_box_and_keeps_the_aspect)
+{
+    RgbaImage icon = solid(512, 512, 200, 100, 50, 255);
+    RgbaImage small = downscalePremultiplied(icon, 96, 96);
+    CHECK_EQ(small.width, 96);
+    CHECK_EQ(small.height, 96);
+    CHECK_EQ(small.bytes(), size_t(96 * 96 * 4));
+
+    // A flat colour stays exactly flat through the filter.
+    bool flat = true;
+    for (size_t i = 0; i < small.pixels.size(); i += 4)
+        flat = flat && small.pixels[i] == 200 && small.pixels[i + 1] == 100 && small.pixels[i + 2] == 50 &&
+            small.pixels[i + 3] == 255;
+    CHECK(flat);
+
+    RgbaImage wide = downscalePremultiplied(solid(1920, 1080, 0, 0, 0, 255), 444, 267);
+    CHECK_EQ(wide.width, 444);
+    CHECK_EQ(wide.height, 267);
+
+    // The overflow is cut evenly: a bar down the middle stays in the middle.
+    RgbaImage banner = solid(300, 100, 0, 0, 0, 255);
+    for (int y = 0; y < 100; y++)
+        for (int x = 140; x < 160; x++)
+            banner.pixels[(size_t(y) * 300 + x) * 4] = 255;
+    RgbaImage square = downscalePremultiplied(banner, 50, 50);
+    CHECK_EQ(square.width, 50);
+    CHECK_EQ(square.height, 50);
+    CHECK_EQ(int(pixelAt(square, 0, 25)[0]), 0);
+    CHECK_EQ(int(pixelAt(square, 24, 25)[0]), 255);
+    CHECK_EQ(int(pixelAt(square, 25, 25)[0]), 255);
+    CHECK_EQ(int(pixelAt(square, 49, 25)[0]), 0);
+
+    // Already inside the box: only premultiplied.
+    RgbaImage kept = downscalePremultiplied(solid(40, 30, 255, 255, 255, 128), 96, 96);
+    CHECK_EQ(kept.width, 40);
+    CHECK_EQ(kept.height, 30);
+    CHECK_EQ(int(pixelAt(kept, 5, 5)[0]), 128);
+    CHECK_EQ(int(pixelAt(kept, 5, 5)[3]), 128);
+
+    CHECK(downscalePremultiplied(RgbaImage{4, 4, {}}, 2, 2).pixels.empty());
+}
+
+TEST(thumbnail_downscale_averages_by_area_after_premultiplying)
+{
+    // Transparent red beside opaque blue: no red may bleed into the edge.
+    RgbaImage pair = solid(2, 2, 0, 0, 255, 255);
+    for (int y = 0; y < 2; y++)
+    {
+        uint8_t* left = pair.pixels.data() + y * 8;
+        left[0] = 255;
+        left[2] = 0;
+        left[3] = 0;
+    }
+    RgbaImage merged = downscalePremultiplied(pair, 1, 1);
+    CHECK_EQ(merged.width, 1);
+    CHECK_EQ(int(merged.pixels[0]), 0);
+    CHECK_EQ(int(merged.pixels[2]), 128);
+    CHECK_EQ(int(merged.pixels[3]), 128);
+
+    // Three columns into two: each output covers one and a half source pixels.
+    RgbaImage ramp = solid(3, 3, 0, 0, 0, 255);
+    for (int y = 0; y < 3; y++)
+    {
+        ramp.pixels[y * 12 + 4] = 90;
+        ramp.pixels[y * 12 + 8] = 180;
+    }
+    RgbaImage halved = downscalePremultiplied(ramp, 2, 2);
+    CHECK_EQ(halved.width, 2);
+    CHECK(std::abs(int(pixelAt(halved, 0, 1)[0]) - 30) <= 1);
+    CHECK(std::abs(int(pixelAt(halved, 1, 1)[0]) - 150) <= 1);
+}
+
+TEST(thumbnail_pipeline_decodes_off_thread_and_caches_by_url_and_size)
+{
+    Mailbox mailbox;
+    ThumbnailPipeline pipeline(decodeRaw, mailbox.hook(), 1024 * 1024);
+    std::vector<uint8_t> bytes = encode(solid(64, 64, 10, 20, 30, 255));
+
+    std::thread::id caller = std::this_thread::get_id();
+    std::atomic<bool> offThread{false};
+    ThumbnailPipeline::Decoder spy = [&](const std::vector<uint8_t>& in, RgbaImage& out) {
+        offThread = std::this_thread::get_id() != caller;
+        return decodeRaw(in, out);
+    };
+    ThumbnailPipeline watched(spy, mailbox.hook(), 1024 * 1024);
+
+    int delivered = 0;
+    ThumbnailPipeline::Thumbnail got;
+    watched.request("icon", bytes, 32, 32, ThumbnailPipeline::Priority::Visible,
+        [&](const std::string& url, const ThumbnailPipeline::Thumbnail& thumbnail) {
+            delivered++;
+            got = thumbnail;
+        });
+    CHECK_EQ(delivered, 0);
+    CHECK_EQ(mailbox.pump(1), size_t(1));
+    CHECK_EQ(delivered, 1);
+    CHECK(offThread.load());
+    CHECK(got && got->width == 32 && got->height == 32);
+
+    // Cached: answered before request() returns, with nothing posted.
+    watched.request("icon", bytes, 32, 32, ThumbnailPipeline::Priority::Visible,
+        [&](const std::string&, const ThumbnailPipeline::Thumbnail& thumbnail) {
+            delivered++;
+            CHECK(thumbnail == got);
+        });
+    CHECK_EQ(delivered, 2);
+    CHECK(watched.cached("icon", 32, 32) == got);
+    CHECK(watched.cached("icon", 48, 48) == nullptr);
+    CHECK_EQ(watched.metrics().entries, size_t(1));
+
+    // Bytes that do not decode come back as null and are not remembered.
+    pipeline.request("broken", {1, 2, 3}, 32, 32, ThumbnailPipeline::Priority::Visible,
+        [&](const std::string&, const ThumbnailPipeline::Thumbnail& thumbnail) {
+            delivered++;
+            CHECK(thumbnail == nullptr);
+        });
+    mailbox.pump(1);
+    CHECK_EQ(delivered, 3);
+    CHECK(pipeline.cached("broken", 32, 32) == nullptr);
+}
+
+TEST(thumbnail_pipeline_joins_duplicates_and_serves_visible_cells_first)
+{
+    Mailbox mailbox;
+    std::atomic<bool> gate{false};
+    std::mutex orderMutex;
+    std::vector<int> order;
+
+    ThumbnailPipeline pipeline(
+        [&](const std::vector<uint8_t>& in, RgbaImage& out) {
+            while (!gate.load())
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            {
+                std::lock_guard<std::mutex> lock(orderMutex);
+                order.push_back(in.empty() ? -1 : in.back());
+            }
+            out = solid(8, 8, 0, 0, 0, 255);
+            return true;
+        },
+        mailbox.hook(), 1024 * 1024);
+
+    auto tagged = [](uint8_t tag) { return std::vector<uint8_t>{tag}; };
+    int calls = 0;
+    auto count = [&calls](const std::string&, const ThumbnailPipeline::Thumbnail&) { calls++; };
+
+    // The first job parks the worker on the gate; the rest queue up behind it.
+    pipeline.request("blocker", tagged(0), 4, 4, ThumbnailPipeline::Priority::Visible, count);
+    for (int spin = 0; spin < 1000 && pipeline.queued() > 0; spin++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    pipeline.request("a", tagged(1), 4, 4, ThumbnailPipeline::Priority::Ahead, nullptr);
+    pipeline.request("b", tagged(2), 4, 4, ThumbnailPipeline::Priority::Ahead, nullptr);
+    pipeline.request("c", tagged(3), 4, 4, ThumbnailPipeline::Priority::Visible, count);
+    pipeline.request("c", tagged(3), 4, 4, ThumbnailPipeline::Priority::Visible, count);
+    // A cell binding "b" pulls the queued prefetch forward.
+    pipeline.request("b", tagged(2), 4, 4, ThumbnailPipeline::Priority::Visible, count);
+    CHECK_EQ(pipeline.queued(), size_t(3));
+
+    gate = true;
+    for (int spin = 0; spin < 1000 && calls < 4; spin++)
+        mailbox.pump(0), std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    CHECK_EQ(calls, 4);
+    CHECK(order == (std::vector<int>{0, 2, 3, 1}));
+
+    pipeline.stop();
+    pipeline.request("late", tagged(4), 4, 4, ThumbnailPipeline::Priority::Visible, count);
+    CHECK_EQ(pipeline.queued(), size_t(0));
+}
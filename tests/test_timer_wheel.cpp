@@ -0,0 +1,232 @@
+#include "test_util.hpp"
+
+#include "core/rate_limiter.hpp"
+#include "core/timer_wheel.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace {
+
+void fire(TimerWheel& wheel, int64_t nowMs)
+{
+    std::vector<TimerWheel::Callback> due;
+    wheel.advance(nowMs, due);
+    for (auto& callback : due)
+        callback();
+}
+
+// One pool worker on a fake clock. Tasks cost REQUEST_MS of clock time each; delayed tasks
+// sit on a TimerWheel until due, as they do in HttpPool.
+struct FakePool {
+    static constexpr int64_t REQUEST_MS = 20;
+
+    int64_t now = 0;
+    TimerWheel wheel{10, 64, 0};
+    std::deque<std::function<void()>> ready;
+    std::deque<std::function<void()>> tasks;
+
+    void submit(std::function<void()> task) { tasks.push_back(std::move(task)); }
+
+    void submitAfter(int64_t delayMs, std::function<void()> task)
+    {
+        wheel.schedule(now + delayMs, [this, task]() { ready.push_back(task); });
+    }
+
+    void run()
+    {
+        while (!ready.empty() || !tasks.empty() || !wheel.empty())
+        {
+            std::vector<TimerWheel::Callback> due;
+            wheel.advance(now, due);
+            for (auto& release : due)
+                release();
+
+            std::deque<std::function<void()>>& from = !ready.empty() ? ready : tasks;
+            if (from.empty())
+            {
+                now = wheel.nextDueMs();
+                continue;
+            }
+
+            std::function<void()> task = std::move(from.front());
+            from.pop_front();
+            task();
+        }
+    }
+};
+
+struct Trace {
+    std::vector<int64_t> governedSent;
+    std::vector<int64_t> governedDone;
+    std::vector<int64_t> otherDone;
+};
+
+// Throttled requests the way governedGet used to handle them: the worker sleeps for its slot.
+void blockingGovernedGet(FakePool& pool, BurstWindow& burst, Trace& trace)
+{
+    for (int64_t wait = burst.acquire(pool.now); wait > 0; wait = burst.acquire(pool.now))
+        pool.now += wait;
+
+    trace.governedSent.push_back(pool.now);
+    pool.now += FakePool::REQUEST_MS;
+    trace.governedDone.push_back(pool.now);
+}
+
+// The continuation form: a closed slot parks the request and frees the worker.
+void governedStep(FakePool& pool, BurstWindow& burst, Trace& trace)
+{
+    int64_t wait = burst.acquire(pool.now);
+    if (wait > 0)
+    {
+        pool.submitAfter(wait, [&pool, &burst, &trace]() { governedStep(pool, burst, trace); });
+        return;
+    }
+
+    trace.governedSent.push_back(pool.now);
+    pool.now += FakePool::REQUEST_MS;
+    trace.governedDone.push_back(pool.now);
+}
+
+Trace simulate(bool continuation)
+{
+    FakePool pool;
+    BurstWindow burst(5, 1000);
+    Trace trace;
+
+    for (int i = 0; i < 20; i++)
+    {
+        if (continuation)
+            pool.submit([&]() { governedStep(pool, burst, trace); });
+        else
+            pool.submit([&]() { blockingGovernedGet(pool, burst, trace); });
+    }
+    for (int i = 0; i < 5; i++)
+    {
+        pool.submit([&]() {
+            pool.now += FakePool::REQUEST_MS;
+            trace.otherDone.push_back(pool.now);
+        });
+    }
+
+    pool.run();
+    return trace;
+}
+
+int maxInAnyWindow(const std::vector<int64_t>& sent, int64_t windowMs)
+{
+    int worst = 0;
+    for (size_t i = 0; i < sent.size(); i++)
+    {
+        int inWindow = 0;
+        for (int64_t at : sent)
+            inWindow += at >= sent[i] && at < sent[i] + windowMs;
+        worst = std::max(worst, inWindow);
+    }
+    return worst;
+}
+
+} // namespace
+
+TEST(timer_wheel_fires_nothing_before_its_deadline)
+{
+    TimerWheel wheel(10, 8, 0);
+    int fired = 0;
+    wheel.schedule(35, [&]() { fired++; });
+
+    fire(wheel, 30);
+    CHECK_EQ(fired, 0);
+    CHECK_EQ(wheel.nextDueMs(), 40);
+
+    fire(wheel, 39);
+    CHECK_EQ(fired, 0);
+    fire(wheel, 40);
+    CHECK_EQ(fired, 1);
+    CHECK(wheel.empty());
+    CHECK_EQ(wheel.nextDueMs(), TimerWheel::NOTHING_DUE);
+}
+
+TEST(timer_wheel_releases_in_deadline_order)
+{
+    TimerWheel wheel(10, 8, 0);
+    std::vector<int> order;
+    wheel.schedule(50, [&]() { order.push_back(3); });
+    wheel.schedule(20, [&]() { order.push_back(1); });
+    wheel.schedule(20, [&]() { order.push_back(2); });
+    wheel.schedule(500, [&]() { order.push_back(4); });
+
+    fire(wheel, 100);
+    CHECK_EQ(order.size(), 3u);
+    CHECK(order == (std::vector<int>{1, 2, 3}));
+    CHECK_EQ(wheel.size(), 1u);
+}
+
+TEST(timer_wheel_holds_deadlines_beyond_one_revolution)
+{
+    TimerWheel wheel(10, 8, 0);
+    int fired = 0;
+    wheel.schedule(250, [&]() { fired++; });
+    CHECK_EQ(wheel.nextDueMs(), 250);
+
+    for (int64_t t = 10; t < 250; t += 10)
+        fire(wheel, t);
+    CHECK_EQ(fired, 0);
+
+    fire(wheel, 250);
+    CHECK_EQ(fired, 1);
+}
+
+TEST(timer_wheel_catches_up_after_a_long_stall)
+{
+    TimerWheel wheel(10, 8, 0);
+    int fired = 0;
+    for (int64_t due : {15, 70, 200, 990})
+        wheel.schedule(due, [&]() { fired++; });
+
+    fire(wheel, 5000);
+    CHECK_EQ(fired, 4);
+    CHECK(wheel.empty());
+}
+
+TEST(timer_wheel_past_deadlines_fire_on_the_next_tick)
+{
+    TimerWheel wheel(10, 8, 1000);
+    int fired = 0;
+    wheel.schedule(400, [&]() { fired++; });
+
+    fire(wheel, 1000);
+    CHECK_EQ(fired, 0);
+    fire(wheel, 1010);
+    CHECK_EQ(fired, 1);
+}
+
+TEST(burst_window_reports_when_a_slot_opens)
+{
+    BurstWindow burst(2, 1000);
+    CHECK_EQ(burst.acquire(0), 0);
+    CHECK_EQ(burst.acquire(100), 0);
+    CHECK_EQ(burst.acquire(200), 800);
+    CHECK_EQ(burst.acquire(999), 1);
+    CHECK_EQ(burst.acquire(1000), 0);
+    CHECK_EQ(burst.acquire(1050), 50);
+}
+
+TEST(parked_requests_leave_the_worker_free_for_other_work)
+{
+    Trace blocking = simulate(false);
+    Trace parked = simulate(true);
+
+    CHECK_EQ(parked.governedDone.size(), 20u);
+    CHECK_EQ(parked.otherDone.size(), 5u);
+
+    // Unrelated work no longer queues behind the throttle...
+    CHECK(*std::max_element(blocking.otherDone.begin(), blocking.otherDone.end()) > 3000);
+    CHECK(*std::max_element(parked.otherDone.begin(), parked.otherDone.end()) <= 300);
+
+    // ...while throttled requests still go out as fast as the burst limit allows.
+    CHECK(maxInAnyWindow(parked.governedSent, 1000) <= 5);
+    CHECK(parked.governedDone.back() <= blocking.governedDone.back());
+    CHECK(parked.governedDone.back() <= 3000 + 5 * FakePool::REQUEST_MS + 10);
+}
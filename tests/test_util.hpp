@@ -1,6 +1,7 @@
 #ifndef AKIRA_TEST_UTIL_HPP
 #define AKIRA_TEST_UTIL_HPP
 
+#include <chrono>
 #include <cstdio>
 #include <functional>
 #include <iostream>
@@ -24,6 +25,35 @@ struct Register {
     }
 };
 
+std::vector<TestCase>& benchRegistry();
+
+struct RegisterBench {
+    RegisterBench(const char* name, std::function<void()> body)
+    {
+        benchRegistry().push_back({name, std::move(body)});
+    }
+};
+
+// Runs body `iterations` times and prints the mean cost per call. The return value of
+// body is handed to sink() so the optimiser cannot drop the work.
+void sink(const void* value);
+
+template <typename Body>
+double measure(const char* label, int iterations, Body&& body)
+{
+    auto started = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        auto result = body();
+        sink(&result);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - started;
+
+    double perCall = std::chrono::duration<double, std::micro>(elapsed).count() / iterations;
+    std::printf("      %-44s %12.2f us/op  (%d iterations)\n", label, perCall, iterations);
+    return perCall;
+}
+
 } // namespace tests
 
 #define TEST(name)                                                          \
@@ -31,6 +61,11 @@ struct Register {
     static tests::Register register_##name(#name, name);                    \
     static void name()
 
+#define BENCH(name)                                                         \
+    static void name();                                                     \
+    static tests::RegisterBench register_##name(#name, name);               \
+    static void name()
+
 #define CHECK(cond)                                                         \
     do {                                                                    \
         if (!(cond)) {                                                      \
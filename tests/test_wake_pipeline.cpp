@@ -0,0 +1,150 @@
+#include "test_util.hpp"
+
+#include "core/console_probe.hpp"
+#include "core/wake_pipeline.hpp"
+#include "console_standin.hpp"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+WakePipeline::Config fastConfig()
+{
+    WakePipeline::Config config;
+    config.firstPollMs = 20;
+    config.maxPollMs = 200;
+    config.pollTimeoutMs = 30;
+    config.rewakeMs = 5000;
+    config.deadlineMs = 3000;
+    return config;
+}
+
+// Wakes and polls the stand-in the way Host does a real console.
+WakePipeline::Ops opsFor(sim::BootingConsole& console, ConsoleProbe& probe, uint64_t credential)
+{
+    WakePipeline::Ops ops;
+    ops.wake = [&console, &probe, credential] {
+        return probe.sendWake("127.0.0.1", console.port(), credential, true);
+    };
+    ops.poll = [&console, &probe](int timeoutMs) {
+        return probe.query("127.0.0.1", console.port(), true, timeoutMs);
+    };
+    return ops;
+}
+
+std::vector<std::string> stageNames(const WakePipeline::Result& result)
+{
+    std::vector<std::string> names;
+    for (const ConnectPrewarm::Timing& timing : result.timeline)
+        names.push_back(timing.stage);
+    return names;
+}
+
+} // namespace
+
+TEST(console_probe_wire_format)
+{
+    CHECK_EQ(ConsoleProbe::searchRequest(true),
+        std::string("SRCH * HTTP/1.1\ndevice-discovery-protocol-version:00030010\n"));
+    CHECK_EQ(ConsoleProbe::wakeRequest(305441741, false),
+        std::string("WAKEUP * HTTP/1.1\nclient-type:vr\nauth-type:R\nmodel:w\napp-type:r\n"
+                    "user-credential:305441741\ndevice-discovery-protocol-version:00020020\n"));
+    CHECK_EQ(ConsoleProbe::discoveryPort(true), 9302);
+    CHECK_EQ(ConsoleProbe::discoveryPort(false), 987);
+
+    std::string ready = "HTTP/1.1 200 Ok\nhost-id:ABCDEF\nhost-type:PS5\n";
+    std::string standby = "HTTP/1.1 620 Server Standby\nhost-id:ABCDEF\n";
+    CHECK(ConsoleProbe::parseReply(ready.data(), ready.size()) == ConsoleStatus::Ready);
+    CHECK(ConsoleProbe::parseReply(standby.data(), standby.size()) == ConsoleStatus::Standby);
+    CHECK(ConsoleProbe::parseReply("SRCH * HTTP/1.1\n", 16) == ConsoleStatus::Unknown);
+    CHECK(ConsoleProbe::parseReply("HTTP/1.1 ", 9) == ConsoleStatus::Unknown);
+}
+
+// A console that goes quiet mid-boot is caught within a few polls of coming up.
+TEST(wake_pipeline_catches_a_booting_console)
+{
+    sim::BootingConsole console({});
+    ConsoleProbe probe;
+
+    WakePipeline pipeline(fastConfig());
+    WakePipeline::Result result = pipeline.run(opsFor(console, probe, console.credential()));
+    auto returnedAt = Clock::now();
+
+    CHECK(result.outcome == WakePipeline::Outcome::Ready);
+    CHECK_EQ(result.wakes, 1);
+    CHECK_EQ(console.wakes(), 1);
+    CHECK(stageNames(result) == (std::vector<std::string>{"wake", "boot"}));
+    CHECK(returnedAt >= console.bootedAt());
+    CHECK(returnedAt - console.bootedAt() < std::chrono::milliseconds(150));
+    CHECK(result.timeline[1].ok);
+    CHECK(result.elapsedMs < 400 + 150);
+}
+
+TEST(wake_pipeline_resends_a_lost_wake)
+{
+    sim::BootingConsole::Options options;
+    options.dropWakes = 1;
+    options.silentAfterMs = 30;
+    options.silentForMs = 30;
+    options.bootMs = 120;
+    sim::BootingConsole console(options);
+    ConsoleProbe probe;
+
+    WakePipeline::Config config = fastConfig();
+    config.rewakeMs = 150;
+    WakePipeline pipeline(config);
+    WakePipeline::Result result = pipeline.run(opsFor(console, probe, console.credential()));
+
+    CHECK(result.outcome == WakePipeline::Outcome::Ready);
+    CHECK_EQ(result.wakes, 2);
+    CHECK_EQ(console.wakes(), 2);
+}
+
+TEST(wake_pipeline_gives_up_on_timeout_cancel_and_failed_wake)
+{
+    sim::BootingConsole console({});
+    ConsoleProbe probe;
+
+    {
+        // The wrong credential never wakes it.
+        WakePipeline::Config config = fastConfig();
+        config.deadlineMs = 300;
+        WakePipeline pipeline(config);
+        WakePipeline::Result result = pipeline.run(opsFor(console, probe, 42));
+        CHECK(result.outcome == WakePipeline::Outcome::TimedOut);
+        CHECK(!result.timeline[1].ok);
+        CHECK(result.polls > 2);
+    }
+    {
+        // Cancelling stops the polls at once.
+        WakePipeline pipeline(fastConfig());
+        WakePipeline::Ops ops = opsFor(console, probe, 42);
+
+        std::thread canceller([&pipeline] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            pipeline.cancel();
+        });
+        WakePipeline::Result result = pipeline.run(ops);
+        canceller.join();
+
+        CHECK(result.outcome == WakePipeline::Outcome::Cancelled);
+        CHECK(result.timeline[1].durationMs < 100 + 80);
+        CHECK_EQ(result.timeline.size(), size_t(2));
+    }
+    {
+        WakePipeline pipeline(fastConfig());
+        WakePipeline::Ops ops;
+        int polls = 0;
+        ops.wake = [] { return false; };
+        ops.poll = [&polls](int) { polls++; return ConsoleStatus::Ready; };
+        WakePipeline::Result result = pipeline.run(ops);
+        CHECK(result.outcome == WakePipeline::Outcome::WakeFailed);
+        CHECK_EQ(polls, 0);
+        CHECK_EQ(result.timeline.size(), size_t(1));
+    }
+}